@@ -38,15 +38,30 @@
 
 #include "tstream.h"
 #include "tenv.h"
+#include <climits>
+#include <cstring>
 #include <deque>
+#include <map>
+#include <memory>
 #include <numeric>
 #include <sstream>
+#include <unordered_map>
+#include <atomic>
+#include <functional>
 #ifdef _WIN32
 #include <crtdbg.h>
+#else
+#include <cerrno>
+#include <fcntl.h>
 #endif
 
 // Qt includes
 #include <QThreadStorage>
+#include <QMutex>
+#include <QThread>
+#include <QWaitCondition>
+#include <QElapsedTimer>
+#include <QFile>
 
 //------------------------------------------------------------------------------
 
@@ -65,7 +80,6 @@ class ImageInfo;
 
 // std::ofstream os("C:\\cache.txt");
 
-TUINT32 HistoryCount = 0;
 //------------------------------------------------------------------------------
 
 class TheCodec final : public TRasterCodecLz4 {
@@ -103,7 +117,6 @@ public:
       : m_cantCompress(false)
       , m_builder(builder)
       , m_imageInfo(imageInfo)
-      , m_historyCount(0)
       , m_modified(false)
       , m_palette(palette) {}
 
@@ -117,8 +130,6 @@ public:
   bool m_cantCompress;
   ImageBuilder *m_builder;
   ImageInfo *m_imageInfo;
-  std::string m_id;
-  TUINT32 m_historyCount;
   bool m_modified;
   TPalette *m_palette;
 };
@@ -479,11 +490,200 @@ TImageP CompressedOnMemoryCacheItem::getImage() const {
     return m_builder->build(m_imageInfo, ras, m_palette);
 }
 
+//************************************************************************************************
+//    SwapSlab  definition
+//************************************************************************************************
+
+//! The cache swap file. Images shipped to disk are stored in blocks of a
+//! single file, which is memory-mapped by segments and allocated through
+//! free lists. Blocks are read and written directly from the mapping.
+class SwapSlab {
+  struct Segment {
+    UCHAR *m_data;
+    TUINT64 m_size;
+    std::map<TUINT64, TUINT64> m_free;  // Free blocks (offset -> size)
+  };
+
+  QFile m_file;
+  TUINT64 m_fileSize;
+  std::vector<Segment> m_segments;
+  QMutex m_mutex;
+
+public:
+  SwapSlab(const TFilePath &fp);
+  ~SwapSlab();
+
+  //! Returns a block of the specified size, or 0 if the swap file could not
+  //! be grown.
+  UCHAR *allocate(TUINT64 size);
+  void release(UCHAR *data, TUINT64 size);
+
+private:
+  static TUINT64 blockSize(TUINT64 size) {
+    const TUINT64 alignment = 4096;
+    return (size + alignment - 1) & ~(alignment - 1);
+  }
+
+  Segment *addSegment(TUINT64 size);
+  bool reserve(TUINT64 size);
+  bool writeZeros(TUINT64 size);
+};
+
+typedef std::shared_ptr<SwapSlab> SwapSlabP;
+
+//------------------------------------------------------------------------------
+
+SwapSlab::SwapSlab(const TFilePath &fp)
+    : m_file(fp.getQString()), m_fileSize(0) {
+  m_file.open(QIODevice::ReadWrite | QIODevice::Truncate);
+}
+
+//------------------------------------------------------------------------------
+
+SwapSlab::~SwapSlab() {
+  for (Segment &segment : m_segments) m_file.unmap(segment.m_data);
+  m_file.remove();
+}
+
+//------------------------------------------------------------------------------
+
+SwapSlab::Segment *SwapSlab::addSegment(TUINT64 size) {
+  // Segments are mapped at offsets aligned to the allocation granularity of
+  // all platforms (64 KB on Windows)
+  const TUINT64 minSegmentSize = 64 << 20, granularity = 64 << 10;
+
+  size = std::max(size, minSegmentSize);
+  size = (size + granularity - 1) & ~(granularity - 1);
+
+  if (!m_file.isOpen() || !reserve(size)) {
+    m_file.resize(m_fileSize);
+    return 0;
+  }
+
+  UCHAR *data = m_file.map(m_fileSize, size);
+  if (!data) {
+    m_file.resize(m_fileSize);
+    return 0;
+  }
+
+  m_fileSize += size;
+
+  Segment segment;
+  segment.m_data    = data;
+  segment.m_size    = size;
+  segment.m_free[0] = size;
+  m_segments.push_back(segment);
+
+  return &m_segments.back();
+}
+
+//------------------------------------------------------------------------------
+
+//! Grows the file by the specified size, allocating its disk space for real:
+//! a plain resize leaves a sparse file, and the first write to a mapped page
+//! that can't be backed on a full disk would raise SIGBUS.
+bool SwapSlab::reserve(TUINT64 size) {
+#if defined(_WIN32)
+  // Resizing allocates the clusters of a non-sparse file
+  return m_file.resize(m_fileSize + size);
+#elif defined(__APPLE__)
+  return writeZeros(size);
+#else
+  int err = posix_fallocate(m_file.handle(), m_fileSize, size);
+  if (err == EINVAL || err == EOPNOTSUPP) return writeZeros(size);
+  return err == 0;
+#endif
+}
+
+//------------------------------------------------------------------------------
+
+bool SwapSlab::writeZeros(TUINT64 size) {
+  const TUINT64 chunkSize = 1 << 20;
+  std::vector<char> zeros(chunkSize, 0);
+
+  if (!m_file.seek(m_fileSize)) return false;
+  for (TUINT64 written = 0; written < size; written += chunkSize) {
+    qint64 count = std::min(chunkSize, size - written);
+    if (m_file.write(zeros.data(), count) != count) return false;
+  }
+
+  return m_file.flush();
+}
+
+//------------------------------------------------------------------------------
+
+UCHAR *SwapSlab::allocate(TUINT64 size) {
+  size = blockSize(size);
+
+  QMutexLocker sl(&m_mutex);
+
+  // First fit among the free blocks
+  for (Segment &segment : m_segments) {
+    std::map<TUINT64, TUINT64>::iterator it;
+    for (it = segment.m_free.begin(); it != segment.m_free.end(); ++it) {
+      if (it->second < size) continue;
+
+      TUINT64 offset = it->first, freeSize = it->second;
+      segment.m_free.erase(it);
+      if (freeSize > size) segment.m_free[offset + size] = freeSize - size;
+
+      return segment.m_data + offset;
+    }
+  }
+
+  Segment *segment = addSegment(size);
+  if (!segment) return 0;
+
+  segment->m_free.erase(0);
+  if (segment->m_size > size) segment->m_free[size] = segment->m_size - size;
+
+  return segment->m_data;
+}
+
 //------------------------------------------------------------------------------
 
+void SwapSlab::release(UCHAR *data, TUINT64 size) {
+  size = blockSize(size);
+
+  QMutexLocker sl(&m_mutex);
+
+  for (Segment &segment : m_segments) {
+    if (data < segment.m_data || data >= segment.m_data + segment.m_size)
+      continue;
+
+    TUINT64 offset = data - segment.m_data;
+
+    // Merge with the adjacent free blocks
+    std::map<TUINT64, TUINT64>::iterator next =
+        segment.m_free.lower_bound(offset);
+    if (next != segment.m_free.end() && offset + size == next->first) {
+      size += next->second;
+      next = segment.m_free.erase(next);
+    }
+    if (next != segment.m_free.begin()) {
+      std::map<TUINT64, TUINT64>::iterator prev = next;
+      --prev;
+      if (prev->first + prev->second == offset) {
+        prev->second += size;
+        return;
+      }
+    }
+
+    segment.m_free[offset] = size;
+    return;
+  }
+
+  assert(false);
+}
+
+//************************************************************************************************
+//    On disk cache items
+//************************************************************************************************
+
 class CompressedOnDiskCacheItem final : public CacheItem {
 public:
-  CompressedOnDiskCacheItem(const TFilePath &fp, const TRasterP &compressedRas,
+  CompressedOnDiskCacheItem(const SwapSlabP &slab,
+                            const TRasterP &compressedRas,
                             ImageBuilder *builder, ImageInfo *info,
                             TPalette *palette);
 
@@ -491,7 +691,10 @@ public:
 
   TUINT32 getSize() const override { return 0; }
   TImageP getImage() const override;
-  TFilePath m_fp;
+
+  SwapSlabP m_slab;
+  UCHAR *m_data;  //!< The block in the swap file, 0 if it could not be stored
+  TUINT32 m_dataSize;
 };
 
 #ifdef _WIN32
@@ -505,18 +708,17 @@ typedef TDerivedSmartPointerT<CompressedOnDiskCacheItem, CacheItem>
 //------------------------------------------------------------------------------
 
 CompressedOnDiskCacheItem::CompressedOnDiskCacheItem(
-    const TFilePath &fp, const TRasterP &compressedRas, ImageBuilder *builder,
+    const SwapSlabP &slab, const TRasterP &compressedRas, ImageBuilder *builder,
     ImageInfo *info, TPalette *palette)
-    : CacheItem(builder, info, palette), m_fp(fp) {
-  compressedRas->lock();
-
-  Tofstream oss(m_fp);
+    : CacheItem(builder, info, palette), m_slab(slab), m_data(0) {
   assert(compressedRas->getLy() == 1 && compressedRas->getPixelSize() == 1);
-  TUINT32 size = compressedRas->getLx();
-  oss.write((char *)&size, sizeof(TUINT32));
-  oss.write((char *)compressedRas->getRawData(), size);
-  assert(!oss.fail());
+  m_dataSize = compressedRas->getLx();
+
+  if (m_slab) m_data = m_slab->allocate(m_dataSize);
+  if (!m_data) return;
 
+  compressedRas->lock();
+  memcpy(m_data, compressedRas->getRawData(), m_dataSize);
   compressedRas->unlock();
 }
 
@@ -524,24 +726,22 @@ CompressedOnDiskCacheItem::CompressedOnDiskCacheItem(
 
 CompressedOnDiskCacheItem::~CompressedOnDiskCacheItem() {
   delete m_imageInfo;
-  TSystem::deleteFile(m_fp);
+  if (m_data) m_slab->release(m_data, m_dataSize);
 }
 
 //------------------------------------------------------------------------------
 
 TImageP CompressedOnDiskCacheItem::getImage() const {
-  Tifstream is(m_fp);
-  TUINT32 dataSize;
-  is.read((char *)&dataSize, sizeof(TUINT32));
-  TRasterGR8P ras(dataSize, 1);
-  ras->lock();
-  UCHAR *data = ras->getRawData();
-  is.read((char *)data, dataSize);
-  assert(!is.fail());
-  ras->unlock();
-  CompressedOnMemoryCacheItem item(ras, m_builder->clone(),
-                                   m_imageInfo->clone(), m_palette);
-  return item.getImage();
+  assert(m_data);
+
+  // Decompress straight from the mapped block
+  TRasterP ras;
+  TheCodec::instance()->decompress(m_data, m_dataSize, ras, false);
+#ifdef _DEBUGTOONZ
+  ras->m_cashed = true;
+#endif
+
+  return m_builder->build(m_imageInfo, ras, m_palette);
 }
 
 //------------------------------------------------------------------------------
@@ -550,7 +750,7 @@ class UncompressedOnDiskCacheItem final : public CacheItem {
   int m_pixelsize;
 
 public:
-  UncompressedOnDiskCacheItem(const TFilePath &fp, const TImageP &img,
+  UncompressedOnDiskCacheItem(const SwapSlabP &slab, const TImageP &img,
                               TPalette *palette);
 
   ~UncompressedOnDiskCacheItem();
@@ -559,7 +759,9 @@ public:
   TImageP getImage() const override;
   // TRaster32P getRaster32() const;
 
-  TFilePath m_fp;
+  SwapSlabP m_slab;
+  UCHAR *m_data;  //!< The block in the swap file, 0 if it could not be stored
+  TUINT32 m_dataSize;
 };
 #ifdef _WIN32
 template class DVAPI TSmartPointerT<UncompressedOnDiskCacheItem>;
@@ -571,10 +773,10 @@ typedef TDerivedSmartPointerT<UncompressedOnDiskCacheItem, CacheItem>
 
 //------------------------------------------------------------------------------
 
-UncompressedOnDiskCacheItem::UncompressedOnDiskCacheItem(const TFilePath &fp,
+UncompressedOnDiskCacheItem::UncompressedOnDiskCacheItem(const SwapSlabP &slab,
                                                          const TImageP &image,
                                                          TPalette *palette)
-    : CacheItem(0, 0, 0), m_fp(fp) {
+    : CacheItem(0, 0, 0), m_slab(slab), m_data(0) {
   TRasterImageP ri = image;
 
   TRasterP ras;
@@ -600,26 +802,23 @@ UncompressedOnDiskCacheItem::UncompressedOnDiskCacheItem(const TFilePath &fp,
 
   m_builder = 0;
 
-  int dataSize = ras->getLx() * ras->getLy() * ras->getPixelSize();
-
   int lx      = ras->getLx();
   int ly      = ras->getLy();
   int wrap    = ras->getWrap();
   m_pixelsize = ras->getPixelSize();
+  m_dataSize  = lx * ly * m_pixelsize;
+
+  if (m_slab) m_data = m_slab->allocate(m_dataSize);
+  if (!m_data) return;
 
-  Tofstream oss(m_fp);
-  // oss.write((char*)&dataSize, sizeof(TUINT32));
-  // assert(!oss.fail());
   ras->lock();
-  if (lx == wrap) {
-    oss.write((char *)ras->getRawData(), dataSize);
-    assert(!oss.fail());
-  } else {
-    char *buf = (char *)ras->getRawData();
-    for (int i = 0; i < ly; i++, buf += wrap) {
-      oss.write(buf, lx * m_pixelsize);
-      assert(!oss.fail());
-    }
+  if (lx == wrap)
+    memcpy(m_data, ras->getRawData(), m_dataSize);
+  else {
+    UCHAR *buf = ras->getRawData(), *data = m_data;
+    int rowSize = lx * m_pixelsize;
+    for (int i = 0; i < ly; i++, buf += wrap * m_pixelsize, data += rowSize)
+      memcpy(data, buf, rowSize);
   }
   ras->unlock();
 }
@@ -628,18 +827,13 @@ UncompressedOnDiskCacheItem::UncompressedOnDiskCacheItem(const TFilePath &fp,
 
 UncompressedOnDiskCacheItem::~UncompressedOnDiskCacheItem() {
   delete m_imageInfo;
-  TSystem::deleteFile(m_fp);
+  if (m_data) m_slab->release(m_data, m_dataSize);
 }
 
 //------------------------------------------------------------------------------
 
 TImageP UncompressedOnDiskCacheItem::getImage() const {
-  Tifstream is(m_fp);
-  TUINT32 dataSize =
-      m_imageInfo->m_size.lx * m_imageInfo->m_size.ly * m_pixelsize;
-
-  // is.read((char*)&dataSize, sizeof(TUINT32));
-  // assert(unsigned(m_lx*m_ly*m_pixelsize)==dataSize);
+  assert(m_data);
 
   TRasterP ras;
 
@@ -657,8 +851,7 @@ TImageP UncompressedOnDiskCacheItem::getImage() const {
     else
       assert(false);
     ras->lock();
-    char *data = (char *)ras->getRawData();
-    is.read(data, dataSize);
+    memcpy(ras->getRawData(), m_data, m_dataSize);
     ras->unlock();
 #ifdef _DEBUGTOONZ
     ras->m_cashed = true;
@@ -672,8 +865,7 @@ TImageP UncompressedOnDiskCacheItem::getImage() const {
     if (tii) {
       ras = (TRasterP)(TRasterCM32P(tii->m_size));
       ras->lock();
-      char *data = (char *)ras->getRawData();
-      is.read(data, dataSize);
+      memcpy(ras->getRawData(), m_data, m_dataSize);
       ras->unlock();
 #ifdef _DEBUG
       ras->m_cashed = true;
@@ -702,9 +894,171 @@ std::string TImageCache::getUniqueId(void) {
   return "IMAGECACHEUNIQUEID" + ss.str();
 }
 
+//************************************************************************************************
+//    Cache shards
+//************************************************************************************************
+
+namespace {
+
+const int ShardCount = 16;  // Must be a power of 2
+
+//! The cache record of an id. An id may have both an uncompressed image and a
+//! compressed copy of it. Entries with an uncompressed image are linked in the
+//! LRU list of their shard, least recently used first - or in its held list,
+//! once found checked out by a compression pass.
+struct CacheEntry {
+  CacheItemP m_uncompressed;  //!< An UncompressedOnMemoryCacheItem
+  CacheItemP m_compressed;    //!< Compressed on memory, or any item on disk
+  const std::string *m_id;    //!< The id, stored once as the shard's map key
+  CacheEntry *m_prev, *m_next;
+  TUINT64 m_lastAccess;
+  TUINT32 m_memUsage;  //!< Bytes accounted to the shard when linked: the
+                       //!  raster of a checked out image may be replaced
+
+  CacheEntry()
+      : m_id(0), m_prev(0), m_next(0), m_lastAccess(0), m_memUsage(0) {}
+};
+
+typedef std::unordered_map<std::string, CacheEntry> EntriesMap;
+typedef std::unordered_map<std::string, std::string> AliasesMap;
+
+//------------------------------------------------------------------------------
+
+//! A partition of the cache ids, selected by hash. Each shard has its own lock,
+//! so that threads working on different images don't contend.
+class CacheShard {
+public:
+  TThread::Mutex m_mutex;
+  EntriesMap m_entries;
+  AliasesMap m_aliases;  // for duplicated items (when id1!=id2 but
+                         // image1==image2): key is dup id, value is main id
+  CacheEntry *m_lruHead, *m_lruTail;
+  CacheEntry *m_heldHead, *m_heldTail;  // Entries found checked out
+  std::atomic<TINT64> m_memUsage;  // Bytes of the images in both lists
+
+  CacheShard()
+      : m_lruHead(0)
+      , m_lruTail(0)
+      , m_heldHead(0)
+      , m_heldTail(0)
+      , m_memUsage(0) {}
+
+  void lruPush(CacheEntry *entry, TUINT64 access) {
+    entry->m_memUsage = entry->m_uncompressed->getSize();
+    m_memUsage += entry->m_memUsage;
+    entry->m_lastAccess = access;
+    entry->m_prev       = m_lruTail;
+    entry->m_next       = 0;
+    if (m_lruTail)
+      m_lruTail->m_next = entry;
+    else
+      m_lruHead = entry;
+    m_lruTail = entry;
+  }
+
+  void lruRemove(CacheEntry *entry) {
+    m_memUsage -= entry->m_memUsage;
+    entry->m_memUsage = 0;
+    unlink(entry);
+  }
+
+  void lruTouch(CacheEntry *entry, TUINT64 access) {
+    lruRemove(entry);
+    lruPush(entry, access);
+  }
+
+  //! Moves an entry of the LRU list to the held list.
+  void lruHold(CacheEntry *entry) {
+    unlink(entry);
+    entry->m_prev = m_heldTail;
+    if (m_heldTail)
+      m_heldTail->m_next = entry;
+    else
+      m_heldHead = entry;
+    m_heldTail = entry;
+  }
+
+  //! Gives the held entries back to the head of the LRU list, in constant
+  //! time.
+  void lruReturnHeld() {
+    if (!m_heldHead) return;
+    m_heldTail->m_next = m_lruHead;
+    if (m_lruHead)
+      m_lruHead->m_prev = m_heldTail;
+    else
+      m_lruTail = m_heldTail;
+    m_lruHead  = m_heldHead;
+    m_heldHead = m_heldTail = 0;
+  }
+
+  void clear() {
+    m_entries.clear();
+    m_aliases.clear();
+    m_lruHead  = m_lruTail = 0;
+    m_heldHead = m_heldTail = 0;
+    m_memUsage = 0;
+  }
+
+private:
+  //! Unlinks an entry from whichever list contains it.
+  void unlink(CacheEntry *entry) {
+    if (entry->m_prev)
+      entry->m_prev->m_next = entry->m_next;
+    else if (m_lruHead == entry)
+      m_lruHead = entry->m_next;
+    else
+      m_heldHead = entry->m_next;
+    if (entry->m_next)
+      entry->m_next->m_prev = entry->m_prev;
+    else if (m_lruTail == entry)
+      m_lruTail = entry->m_prev;
+    else
+      m_heldTail = entry->m_prev;
+    entry->m_prev = entry->m_next = 0;
+  }
+};
+
+//------------------------------------------------------------------------------
+
+//! A partition of the image pointers index, used to detect images added under
+//! multiple ids. Its lock is never held while acquiring other locks.
+class PointerShard {
+public:
+  TThread::Mutex m_mutex;
+  std::unordered_map<void *, std::string> m_ids;
+};
+
+//------------------------------------------------------------------------------
+
+inline bool isSceneIndependent(const std::string &id) {
+  return id.size() >= 2 && id[0] == '$' && id[1] == ':';
+}
+
+}  // namespace
+
+//************************************************************************************************
+//    TImageCache::Imp  definition
+//************************************************************************************************
+
 class TImageCache::Imp {
 public:
-  Imp() : m_rootDir() {
+  class Maintainer;
+
+  Imp()
+      : m_rootDir()
+      , m_access(0)
+      , m_fileid(0)
+      , m_lowWatermark(0)
+      , m_highWatermark(0)
+      , m_compressedBytes(0)
+      , m_spilledBytes(0)
+      , m_stallTime(0) {
+    UINT high       = TImageCache::getDefaultHighWatermark();
+    m_lowWatermark  = high - high / 4;
+    m_highWatermark = high;
+
+    startMaintainer();
+
     // ATTENZIONE: e' molto piu' veloce se si usa memoria fisica
     // invece che virtuale: la virtuale e' tanta, non c'e' quindi bisogno
     // di comprimere le immagini, che grandi come sono vengono swappate su disco
@@ -715,6 +1069,8 @@ public:
   }
 
   ~Imp() {
+    stopMaintainer();
+    m_swapSlab.reset();
     if (m_rootDir != TFilePath()) TSystem::rmDirTree(m_rootDir);
   }
 
@@ -726,6 +1082,66 @@ public:
       return TSystem::memoryShortage();
   }
 
+  //! Returns the bytes held by the uncompressed images in memory.
+  TINT64 uncompressedMemUsage() const {
+    TINT64 size = 0;
+    for (int s = 0; s != ShardCount; ++s) size += m_shards[s].m_memUsage;
+    return size;
+  }
+
+  //! Returns true when the maintenance thread should start compressing.
+  bool aboveHighWatermark() {
+    TINT64 high = m_highWatermark;
+    return notEnoughMemory() ||
+           (high > 0 && uncompressedMemUsage() > (high << 10));
+  }
+
+  //! Returns true when the maintenance thread can stop compressing.
+  bool belowLowWatermark() {
+    TINT64 high = m_highWatermark, low = m_lowWatermark;
+    return !notEnoughMemory() &&
+           (high == 0 || uncompressedMemUsage() <= (low << 10));
+  }
+
+  CacheShard &shardOf(const std::string &id) {
+    return m_shards[std::hash<std::string>()(id) & (ShardCount - 1)];
+  }
+
+  PointerShard &pointerShardOf(void *pointer) {
+    return m_pointerShards[(size_t(pointer) >> 4) & (ShardCount - 1)];
+  }
+
+  void setPointerId(void *pointer, const std::string &id);
+  bool getPointerId(void *pointer, std::string &id);
+  void erasePointerId(void *pointer, const std::string &id);
+
+  //! Returns the swap file, creating it the first time.
+  SwapSlabP swapSlab() {
+    QMutexLocker sl(&m_swapMutex);
+
+    assert(m_rootDir != TFilePath());
+    if (!m_swapSlab && m_rootDir != TFilePath())
+      m_swapSlab.reset(new SwapSlab(
+          m_rootDir + TFilePath("swap" + std::to_string(m_fileid++))));
+
+    return m_swapSlab;
+  }
+
+  // The following require the lock of the shard containing the entry
+  void releaseEntry(CacheShard &shard, CacheEntry &entry);
+  CacheEntry *firstCompressible(CacheShard &shard);
+  bool compressEntry(CacheShard &shard, CacheEntry &entry);
+  bool spillEntry(CacheEntry &entry);
+
+  CacheItemP compressItem(const CacheItemP &item);
+  bool compressOldest();
+  void spillCompressed();
+  bool takeAlias(const std::string &id, std::string &aliasId);
+
+  void startMaintainer();
+  void stopMaintainer();
+  void maintain();
+
   void doCompress();
   void doCompress(std::string id);
   UCHAR *compressAndMalloc(TUINT32 requestedSize);  // compress in the cache
@@ -744,24 +1160,119 @@ public:
   bool m_isEnabled;
 #endif
 
-  std::map<std::string, CacheItemP> m_uncompressedItems;
-  std::map<TUINT32, std::string> m_itemHistory;
-  std::map<std::string, CacheItemP> m_compressedItems;
-  std::map<void *, std::string>
-      m_itemsByImagePointer;  // items ordered by ImageP.getPointer()
-  std::map<std::string, std::string> m_duplicatedItems;  // for duplicated items
-                                                         // (when id1!=id2 but
-                                                         // image1==image2) in
-                                                         // the map: key is dup
-                                                         // id, value is main id
+  CacheShard m_shards[ShardCount];
+  PointerShard m_pointerShards[ShardCount];
+
+  std::atomic<TUINT64> m_access;  // LRU clock, shared by all shards
+  int m_fileid;
+
+  SwapSlabP m_swapSlab;
+  QMutex m_swapMutex;
+
   // memoria fisica totale della macchina che non puo' essere utilizzata;
   TINT64 m_reservedMemory;
-  TThread::Mutex m_mutex;
 
-  static int m_fileid;
+  // Serializes the compression passes (and the use of the codec's buffer)
+  QMutex m_compressMutex;
+
+  Maintainer *m_maintainer;
+  std::atomic<UINT> m_lowWatermark, m_highWatermark;  // KB
+
+  std::atomic<TUINT64> m_compressedBytes, m_spilledBytes, m_stallTime;
+
+  QMutex m_handlersMutex;
+  std::vector<std::function<void()>> m_memoryPressureHandlers;
+};
+
+//************************************************************************************************
+//    TImageCache::Imp::Maintainer  definition
+//************************************************************************************************
+
+//! The cache maintenance thread. It compresses the least recently used images
+//! (and ships compressed ones to disk) whenever the cache grows beyond its
+//! high watermark, until it falls below the low one - so that threads adding
+//! or retrieving images don't pay for it.
+class TImageCache::Imp::Maintainer final : public QThread {
+  TImageCache::Imp *m_imp;
+
+  QMutex m_mutex;
+  QWaitCondition m_wakeUp, m_passDone;
+  int m_passCount;
+  bool m_requested, m_busy, m_quit;
+
+public:
+  Maintainer(TImageCache::Imp *imp)
+      : m_imp(imp)
+      , m_passCount(0)
+      , m_requested(false)
+      , m_busy(false)
+      , m_quit(false) {}
+
+  void request() {
+    QMutexLocker sl(&m_mutex);
+    m_requested = true;
+    m_wakeUp.wakeOne();
+  }
+
+  //! Requests a maintenance pass and waits for it to complete, up to the
+  //! specified time (ms).
+  void waitPass(unsigned long timeout) {
+    QMutexLocker sl(&m_mutex);
+
+    // A running pass may have already passed over the images being waited for
+    int passCount = m_passCount + (m_busy ? 2 : 1);
+    m_requested   = true;
+    m_wakeUp.wakeOne();
+
+    while (m_passCount < passCount && !m_quit)
+      if (!m_passDone.wait(&m_mutex, timeout)) break;
+  }
+
+  void quit() {
+    QMutexLocker sl(&m_mutex);
+    m_quit = true;
+    m_wakeUp.wakeAll();
+    m_passDone.wakeAll();
+  }
+
+protected:
+  void run() override {
+    QMutexLocker sl(&m_mutex);
+
+    while (!m_quit) {
+      // Memory shortages are polled too, since they may also come from
+      // allocations outside the cache
+      if (!m_requested) m_wakeUp.wait(&m_mutex, 500);
+      if (m_quit) break;
+
+      m_requested = false;
+      m_busy      = true;
+      sl.unlock();
+
+      if (m_imp->aboveHighWatermark()) m_imp->maintain();
+
+      sl.relock();
+      m_busy = false;
+      ++m_passCount;
+      m_passDone.wakeAll();
+    }
+  }
 };
 
-int TImageCache::Imp::m_fileid;
+//------------------------------------------------------------------------------
+
+void TImageCache::Imp::startMaintainer() {
+  m_maintainer = new Maintainer(this);
+  m_maintainer->start(QThread::LowPriority);
+}
+
+//------------------------------------------------------------------------------
+
+void TImageCache::Imp::stopMaintainer() {
+  m_maintainer->quit();
+  m_maintainer->wait();
+  delete m_maintainer;
+}
 
 //------------------------------------------------------------------------------
 namespace {
@@ -798,278 +1309,313 @@ inline TINT32 hasExternalReferences(const TImageP &img) {
 
   return std::max(refCount, img->getRefCount()) > 1;
 }
+
+// Returns true whether the uncompressed item can be compressed or shipped
+// to disk.
+inline bool isCompressible(const CacheItemP &item) {
+  UncompressedOnMemoryCacheItemP uitem = item;
+  return !(item->m_cantCompress ||
+           (uitem &&
+            (!uitem->m_image || hasExternalReferences(uitem->m_image))));
 }
+}  // namespace
+
 //------------------------------------------------------------------------------
 
-void TImageCache::Imp::doCompress() {
-  // se la memoria usata per mantenere le immagini decompresse e' superiore
-  // a un dato valore, comprimo alcune immagini non compresse non checked-out
-  // in modo da liberare memoria
+void TImageCache::Imp::setPointerId(void *pointer, const std::string &id) {
+  PointerShard &shard = pointerShardOf(pointer);
+  TThread::MutexLocker sl(&shard.m_mutex);
+  shard.m_ids[pointer] = id;
+}
 
-  // per il momento scorre tutte le immagini alla ricerca di immagini
-  // non compresse non checked-out
+//------------------------------------------------------------------------------
 
-  TThread::MutexLocker sl(&m_mutex);
+bool TImageCache::Imp::getPointerId(void *pointer, std::string &id) {
+  PointerShard &shard = pointerShardOf(pointer);
+  TThread::MutexLocker sl(&shard.m_mutex);
 
-  std::map<TUINT32, std::string>::iterator itu = m_itemHistory.begin();
+  std::unordered_map<void *, std::string>::iterator it =
+      shard.m_ids.find(pointer);
+  if (it == shard.m_ids.end()) return false;
 
-  for (; itu != m_itemHistory.end() && notEnoughMemory();) {
-    std::map<std::string, CacheItemP>::iterator it =
-        m_uncompressedItems.find(itu->second);
-    assert(it != m_uncompressedItems.end());
-    CacheItemP item = it->second;
+  id = it->second;
+  return true;
+}
 
-    UncompressedOnMemoryCacheItemP uitem = item;
-    if (item->m_cantCompress ||
-        (uitem && (!uitem->m_image || hasExternalReferences(uitem->m_image)))) {
-      ++itu;
-      continue;
-    }
-    std::string id = it->first;
+//------------------------------------------------------------------------------
 
-#ifdef _WIN32
-    assert(itu->first == it->second->m_historyCount);
-    itu = m_itemHistory.erase(itu);
-    m_itemsByImagePointer.erase(getPointer(item->getImage()));
-    m_uncompressedItems.erase(it);
-#else
-    std::map<TUINT32, std::string>::iterator itu2 = itu;
-    itu++;
-    m_itemHistory.erase(itu2);
-    m_itemsByImagePointer.erase(item->getImage().getPointer());
-    m_uncompressedItems.erase(it);
-#endif
+void TImageCache::Imp::erasePointerId(void *pointer, const std::string &id) {
+  PointerShard &shard = pointerShardOf(pointer);
+  TThread::MutexLocker sl(&shard.m_mutex);
 
-    if (m_compressedItems.find(id) == m_compressedItems.end()) {
-      assert(uitem);
-      item->m_cantCompress = true;
-      CacheItemP newItem   = new CompressedOnMemoryCacheItem(
-          item->getImage());  // WARNING the codec buffer allocation can CHANGE
-                              // the cache.
-      item->m_cantCompress = false;
-      if (newItem->getSize() ==
-          0)  /// non c'era memoria sufficiente per il buffer compresso....
-      {
-        assert(m_rootDir != TFilePath());
-        TFilePath fp =
-            m_rootDir + TFilePath(std::to_string(TImageCache::Imp::m_fileid++));
-        newItem = new UncompressedOnDiskCacheItem(
-            fp, item->getImage(), item->getImage()->getPalette());
-      }
-      m_compressedItems[id] = newItem;
-      item                  = CacheItemP();
-      uitem                 = UncompressedOnMemoryCacheItemP();
-      // doCompress();//restart, since iterators could have been changed (see
-      // comment above)
-      // return;
-      itu = m_itemHistory.begin();
+  // The pointer may have been rebound to another id in the meantime
+  std::unordered_map<void *, std::string>::iterator it =
+      shard.m_ids.find(pointer);
+  if (it != shard.m_ids.end() && it->second == id) shard.m_ids.erase(it);
+}
+
+//------------------------------------------------------------------------------
+
+void TImageCache::Imp::releaseEntry(CacheShard &shard, CacheEntry &entry) {
+  if (entry.m_uncompressed) {
+    shard.lruRemove(&entry);
+    erasePointerId(getPointer(entry.m_uncompressed->getImage()), *entry.m_id);
+    entry.m_uncompressed = CacheItemP();
+  }
+  entry.m_compressed = CacheItemP();
+}
+
+//------------------------------------------------------------------------------
+
+//! Returns the least recently used compressible entry of the shard. Checked
+//! out entries met on the way are set aside in the held list, so that each
+//! is skipped once rather than at every call: the cost is amortized O(1) per
+//! compressed image. When the LRU list runs dry, the held entries are given
+//! back and scanned once more, since their holders may have released them.
+CacheEntry *TImageCache::Imp::firstCompressible(CacheShard &shard) {
+  for (int pass = 0; pass != 2; ++pass) {
+    while (CacheEntry *entry = shard.m_lruHead) {
+      if (isCompressible(entry->m_uncompressed)) return entry;
+      shard.lruHold(entry);
     }
+    if (pass == 0) shard.lruReturnHeld();
   }
 
-  // se il quantitativo di memoria utilizzata e' superiore a un dato valore,
-  // sposto
-  // su disco alcune immagini compresse in modo da liberare memoria
+  return 0;
+}
 
-  if (itu != m_itemHistory.end())  // memory is enough!
-    return;
+//------------------------------------------------------------------------------
 
-  std::map<std::string, CacheItemP>::iterator itc = m_compressedItems.begin();
-  for (; itc != m_compressedItems.end() && notEnoughMemory(); ++itc) {
-    CacheItemP item = itc->second;
-    if (item->m_cantCompress) continue;
+CacheItemP TImageCache::Imp::compressItem(const CacheItemP &item) {
+  item->m_cantCompress = true;
+  CacheItemP newItem   = new CompressedOnMemoryCacheItem(
+      item->getImage());  // WARNING the codec buffer allocation can CHANGE
+                          // the cache.
+  item->m_cantCompress = false;
+  if (newItem->getSize() ==
+      0)  /// non c'era memoria sufficiente per il buffer compresso....
+  {
+    UncompressedOnDiskCacheItem *uditem = new UncompressedOnDiskCacheItem(
+        swapSlab(), item->getImage(), item->getImage()->getPalette());
+    newItem = uditem;
+    if (!uditem->m_data) return CacheItemP();
 
-    CompressedOnMemoryCacheItemP citem = itc->second;
-    if (citem) {
-      assert(m_rootDir != TFilePath());
-      TFilePath fp =
-          m_rootDir + TFilePath(std::to_string(TImageCache::Imp::m_fileid++));
+    m_spilledBytes += item->getSize();
+  } else
+    m_compressedBytes += item->getSize();
 
-      CacheItemP newItem = new CompressedOnDiskCacheItem(
-          fp, citem->m_compressedRas, citem->m_builder->clone(),
-          citem->m_imageInfo->clone(), citem->m_palette);
+  return newItem;
+}
 
-      itc->second                   = 0;
-      m_compressedItems[itc->first] = newItem;
-    }
+//------------------------------------------------------------------------------
+
+bool TImageCache::Imp::compressEntry(CacheShard &shard, CacheEntry &entry) {
+  CacheItemP item = entry.m_uncompressed;
+  assert(item);
+
+  if (!entry.m_compressed) {
+    CacheItemP newItem = compressItem(item);
+    if (!newItem) return false;
+
+    entry.m_compressed = newItem;
   }
+
+  shard.lruRemove(&entry);
+  entry.m_uncompressed = CacheItemP();
+  erasePointerId(getPointer(item->getImage()), *entry.m_id);
+
+  return true;
 }
 
 //------------------------------------------------------------------------------
 
-void TImageCache::Imp::doCompress(std::string id) {
-  TThread::MutexLocker sl(&m_mutex);
+bool TImageCache::Imp::spillEntry(CacheEntry &entry) {
+  if (!entry.m_compressed || entry.m_compressed->m_cantCompress) return false;
 
-  // search id in m_uncompressedItems
-  std::map<std::string, CacheItemP>::iterator it = m_uncompressedItems.find(id);
-  if (it == m_uncompressedItems.end()) return;  // id not found: return
+  CompressedOnMemoryCacheItemP citem = entry.m_compressed;
+  if (!citem) return false;
 
-  // is item suitable for compression ?
-  CacheItemP item                      = it->second;
-  UncompressedOnMemoryCacheItemP uitem = item;
-  if (item->m_cantCompress ||
-      (uitem && (!uitem->m_image || hasExternalReferences(uitem->m_image))))
-    return;
+  CompressedOnDiskCacheItem *cditem = new CompressedOnDiskCacheItem(
+      swapSlab(), citem->m_compressedRas, citem->m_builder->clone(),
+      citem->m_imageInfo->clone(), citem->m_palette);
+  CacheItemP newItem = cditem;
+  if (!cditem->m_data) return false;
 
-  // search id in m_itemHistory
-  std::map<TUINT32, std::string>::iterator itu = m_itemHistory.begin();
-  while (itu != m_itemHistory.end() && itu->second != id) ++itu;
-  if (itu == m_itemHistory.end()) return;  // id not found: return
+  entry.m_compressed = newItem;
+  m_spilledBytes += citem->getSize();
+  return true;
+}
 
-// delete itu from m_itemHistory
-#ifdef _WIN32
-  assert(itu->first == it->second->m_historyCount);
-  itu = m_itemHistory.erase(itu);
-  m_itemsByImagePointer.erase(getPointer(item->getImage()));
-#else
-  std::map<TUINT32, std::string>::iterator itu2 = itu;
-  itu++;
-  m_itemHistory.erase(itu2);
-  m_itemsByImagePointer.erase(item->getImage().getPointer());
-#endif
+//------------------------------------------------------------------------------
 
-  // delete item from m_uncompressedItems
-  m_uncompressedItems.erase(it);
+//! Compresses the least recently used compressible image among all shards.
+//! Returns false if no image could be compressed.
+bool TImageCache::Imp::compressOldest() {
+  int oldestShard      = -1;
+  TUINT64 oldestAccess = 0;
 
-  // check if item has been already compressed. this should never happen
-  if (m_compressedItems.find(id) != m_compressedItems.end()) return;
+  for (int s = 0; s != ShardCount; ++s) {
+    CacheShard &shard = m_shards[s];
+    TThread::MutexLocker sl(&shard.m_mutex);
 
-  assert(uitem);
-  item->m_cantCompress = true;  // ??
-  CacheItemP newItem   = new CompressedOnMemoryCacheItem(
-      item->getImage());  // WARNING the codec buffer  allocation can CHANGE the
-                          // cache.
-  item->m_cantCompress = false;  // ??
-  if (newItem->getSize() ==
-      0)  /// non c'era memoria sufficiente per il buffer compresso....
-  {
-    assert(m_rootDir != TFilePath());
-    TFilePath fp =
-        m_rootDir + TFilePath(std::to_string(TImageCache::Imp::m_fileid++));
-    newItem = new UncompressedOnDiskCacheItem(fp, item->getImage(),
-                                              item->getImage()->getPalette());
+    CacheEntry *entry = firstCompressible(shard);
+    if (entry && (oldestShard < 0 || entry->m_lastAccess < oldestAccess)) {
+      oldestShard  = s;
+      oldestAccess = entry->m_lastAccess;
+    }
+  }
+
+  if (oldestShard < 0) return false;
+
+  CacheShard &shard = m_shards[oldestShard];
+  TThread::MutexLocker sl(&shard.m_mutex);
+
+  // The shard could have changed since it was scanned
+  CacheEntry *entry = firstCompressible(shard);
+  return !entry || compressEntry(shard, *entry);
+}
+
+//------------------------------------------------------------------------------
+
+void TImageCache::Imp::spillCompressed() {
+  for (int s = 0; s != ShardCount && notEnoughMemory(); ++s) {
+    CacheShard &shard = m_shards[s];
+    TThread::MutexLocker sl(&shard.m_mutex);
+
+    EntriesMap::iterator it;
+    for (it = shard.m_entries.begin();
+         it != shard.m_entries.end() && notEnoughMemory(); ++it)
+      spillEntry(it->second);
   }
-  m_compressedItems[id] = newItem;
-  item                  = CacheItemP();
-  uitem                 = UncompressedOnMemoryCacheItemP();
 }
 
-/*
+//------------------------------------------------------------------------------
+
+void TImageCache::Imp::maintain() {
+  // se la memoria usata per mantenere le immagini decompresse e' superiore
+  // a un dato valore, comprimo alcune immagini non compresse non checked-out
+  // in modo da liberare memoria
+  QMutexLocker cl(&m_compressMutex);
+
+  if (notEnoughMemory()) {
+    QMutexLocker hl(&m_handlersMutex);
+    for (const std::function<void()> &handler : m_memoryPressureHandlers)
+      handler();
+  }
+
+  while (!belowLowWatermark() && compressOldest()) {
+  }
+
   // se il quantitativo di memoria utilizzata e' superiore a un dato valore,
-  sposto
-  // su disco alcune immagini compresse in modo da liberare memoria
+  // sposto su disco alcune immagini compresse in modo da liberare memoria
+  if (notEnoughMemory()) spillCompressed();
+}
+
+//------------------------------------------------------------------------------
+
+void TImageCache::Imp::doCompress() {
+  if (!aboveHighWatermark()) return;
 
-  if (itu != m_itemHistory.end()) //memory is enough!
+  if (!notEnoughMemory()) {
+    m_maintainer->request();
     return;
+  }
 
-  std::map<std::string, CacheItemP>::iterator itc = m_compressedItems.begin();
-  for ( ; itc != m_compressedItems.end() && notEnoughMemory(); ++itc)
-        {
-          CacheItemP item = itc->second;
-          if (item->m_cantCompress)
-                  continue;
-
-          CompressedOnMemoryCacheItemP citem = itc->second;
-          if (citem)
-                {
-                  assert(m_rootDir!=TFilePath());
-                  TFilePath fp = m_rootDir +
-  TFilePath(toString(TImageCache::Imp::m_fileid++));
-
-                  CacheItemP newItem = new CompressedOnDiskCacheItem(fp,
-  citem->m_compressedRas,
-                                                                                                                                                                                                                           citem->m_builder->clone(), citem->m_imageInfo->clone());
-
-                  itc->second = 0;
-                  m_compressedItems[itc->first] = newItem;
-                }
-        }
-  */
+  // Memory is actually short: wait for the maintainer to free some, rather
+  // than letting the cache grow further
+  QElapsedTimer timer;
+  timer.start();
+
+  m_maintainer->waitPass(200);
+
+  m_stallTime += timer.elapsed();
+}
 
 //------------------------------------------------------------------------------
 
-UCHAR *TImageCache::Imp::compressAndMalloc(TUINT32 size) {
-  UCHAR *buf = 0;
+void TImageCache::Imp::doCompress(std::string id) {
+  QMutexLocker cl(&m_compressMutex);
+
+  CacheShard &shard = shardOf(id);
+  TThread::MutexLocker sl(&shard.m_mutex);
 
-  TThread::MutexLocker sl(&m_mutex);
+  // search id among the uncompressed items
+  EntriesMap::iterator it = shard.m_entries.find(id);
+  if (it == shard.m_entries.end() || !it->second.m_uncompressed)
+    return;  // id not found: return
 
-  TheCodec::instance()->reset();
+  // is item suitable for compression ?
+  if (!isCompressible(it->second.m_uncompressed)) return;
 
-  // if (size!=0)
-  //  size = size>>10;
+  compressEntry(shard, it->second);
+}
 
-  // assert(size==0 || TBigMemoryManager::instance()->isActive());
+//------------------------------------------------------------------------------
 
-  std::map<TUINT32, std::string>::iterator itu = m_itemHistory.begin();
-  while (
-      (buf = TBigMemoryManager::instance()->getBuffer(size)) == 0 &&
-      itu !=
-          m_itemHistory
-              .end())  //>TBigMemoryManager::instance()->getAvailableMemoryinKb()))
-  {
-    std::map<std::string, CacheItemP>::iterator it =
-        m_uncompressedItems.find(itu->second);
-    assert(it != m_uncompressedItems.end());
-    CacheItemP item = it->second;
-
-    UncompressedOnMemoryCacheItemP uitem = item;
-    if (item->m_cantCompress ||
-        (uitem && (!uitem->m_image || hasExternalReferences(uitem->m_image)))) {
-      ++itu;
-      continue;
-    }
+UCHAR *TImageCache::Imp::compressAndMalloc(TUINT32 size) {
+  UCHAR *buf                 = 0;
+  TBigMemoryManager *manager = TBigMemoryManager::instance();
+
+  // Release the codec's buffer, unless a compression is using it
+  if (m_compressMutex.tryLock()) {
+    TheCodec::instance()->reset();
+    m_compressMutex.unlock();
+  }
+
+  // This is invoked by raster allocations, which may happen while the calling
+  // thread holds a shard lock: other shards are only try-locked, not to
+  // deadlock against threads doing the same.
+
+  int s;
+  for (s = 0; s != ShardCount && (buf = manager->getBuffer(size)) == 0; ++s) {
+    CacheShard &shard = m_shards[s];
+    if (!shard.m_mutex.tryLock()) continue;
+
+    shard.lruReturnHeld();
+    CacheEntry *entry = shard.m_lruHead;
+    while (entry && (buf = manager->getBuffer(size)) == 0) {
+      CacheEntry *next = entry->m_next;
+
+      if (isCompressible(entry->m_uncompressed)) {
+        CacheItemP item = entry->m_uncompressed;
+        if (!entry->m_compressed) {
+          UncompressedOnDiskCacheItem *uditem =
+              new UncompressedOnDiskCacheItem(swapSlab(), item->getImage(),
+                                              item->getImage()->getPalette());
+          CacheItemP newItem = uditem;
+          if (!uditem->m_data) {
+            entry = next;
+            continue;
+          }
+
+          entry->m_compressed = newItem;
+          m_spilledBytes += item->getSize();
+        }
 
-    if (m_compressedItems.find(it->first) == m_compressedItems.end()) {
-      assert(uitem);
-      CacheItemP newItem;
-      // newItem = new CompressedOnMemoryCacheItem(item->getImage());
-      // if (newItem->getSize()==0)
-      //  {
-      assert(m_rootDir != TFilePath());
-      TFilePath fp =
-          m_rootDir + TFilePath(std::to_string(TImageCache::Imp::m_fileid++));
-      newItem = new UncompressedOnDiskCacheItem(fp, item->getImage(),
-                                                item->getImage()->getPalette());
-      //  }
-
-      m_compressedItems[it->first] = newItem;
+        shard.lruRemove(entry);
+        entry->m_uncompressed = CacheItemP();
+        erasePointerId(getPointer(item->getImage()), *entry->m_id);
+      }
+
+      entry = next;
     }
 
-#ifdef _WIN32
-    assert(itu->first == it->second->m_historyCount);
-    itu = m_itemHistory.erase(itu);
-    m_itemsByImagePointer.erase(getPointer(item->getImage()));
-    m_uncompressedItems.erase(it);
-#else
-    std::map<TUINT32, std::string>::iterator itu2 = itu;
-    itu++;
-    m_itemHistory.erase(itu2);
-    m_itemsByImagePointer.erase(item->getImage().getPointer());
-    m_uncompressedItems.erase(it);
-#endif
+    shard.m_mutex.unlock();
   }
 
   if (buf != 0) return buf;
 
-  std::map<std::string, CacheItemP>::iterator itc = m_compressedItems.begin();
-  for (; itc != m_compressedItems.end() &&
-         (buf = TBigMemoryManager::instance()->getBuffer(size)) == 0;
-       ++itc) {
-    CacheItemP item = itc->second;
-    if (item->m_cantCompress) continue;
-
-    CompressedOnMemoryCacheItemP citem = itc->second;
-    if (citem) {
-      assert(m_rootDir != TFilePath());
-      TFilePath fp =
-          m_rootDir + TFilePath(std::to_string(TImageCache::Imp::m_fileid++));
-
-      CacheItemP newItem = new CompressedOnDiskCacheItem(
-          fp, citem->m_compressedRas, citem->m_builder->clone(),
-          citem->m_imageInfo->clone(), citem->m_palette);
-
-      itc->second                   = 0;
-      m_compressedItems[itc->first] = newItem;
-    }
+  for (s = 0; s != ShardCount && (buf = manager->getBuffer(size)) == 0; ++s) {
+    CacheShard &shard = m_shards[s];
+    if (!shard.m_mutex.tryLock()) continue;
+
+    EntriesMap::iterator it;
+    for (it = shard.m_entries.begin(); it != shard.m_entries.end() &&
+                                       (buf = manager->getBuffer(size)) == 0;
+         ++it)
+      spillEntry(it->second);
+
+    shard.m_mutex.unlock();
   }
 
   return buf;
@@ -1183,156 +1729,131 @@ void TImageCache::add(const std::string &id, const TImageP &img,
 
 void TImageCache::Imp::add(const std::string &id, const TImageP &img,
                            bool overwrite) {
-  TThread::MutexLocker sl(&m_mutex);
+  CacheShard &shard = shardOf(id);
 
-#ifdef LEVO
-  std::map<std::string, CacheItemP>::iterator it1 = m_uncompressedItems.begin();
+  {
+    TThread::MutexLocker sl(&shard.m_mutex);
 
-  for (; it1 != m_uncompressedItems.end(); ++it1) {
-    UncompressedOnMemoryCacheItemP item =
-        (UncompressedOnMemoryCacheItemP)it1->second;
-    // m_memUsage -= item->getSize();
-    assert(item);
-    TImageP refImg = item->getImage();
-    if (refImg.getPointer() == img.getPointer() && it1->first != id)
-      assert(!"opps gia' esiste in cache!");
-  }
+#ifdef _DEBUGTOONZ
+    TRasterImageP rimg = (TRasterImageP)img;
+    TToonzImageP timg  = (TToonzImageP)img;
 #endif
 
-  std::map<std::string, CacheItemP>::iterator itUncompr =
-      m_uncompressedItems.find(id);
-  std::map<std::string, CacheItemP>::iterator itCompr =
-      m_compressedItems.find(id);
+    EntriesMap::iterator it = shard.m_entries.find(id);
+    if (it !=
+        shard.m_entries.end())  // already present in cache with same id...
+    {
+      if (!overwrite) return;
 
-#ifdef _DEBUGTOONZ
-  TRasterImageP rimg = (TRasterImageP)img;
-  TToonzImageP timg  = (TToonzImageP)img;
-#endif
+      releaseEntry(shard, it->second);
+    } else {
+      AliasesMap::iterator dt = shard.m_aliases.find(id);
+      if ((dt != shard.m_aliases.end()) && !overwrite) return;
 
-  if (itUncompr != m_uncompressedItems.end() ||
-      itCompr !=
-          m_compressedItems.end())  // already present in cache with same id...
-  {
-    if (overwrite) {
-#ifdef _DEBUGTOONZ
-      if (rimg)
-        rimg->getRaster()->m_cashed = true;
-      else if (timg)
-        timg->getRaster()->m_cashed = true;
-#endif
-      std::map<std::string, CacheItemP>::iterator it;
-
-      if (itUncompr != m_uncompressedItems.end()) {
-        assert(m_itemHistory.find(itUncompr->second->m_historyCount) !=
-               m_itemHistory.end());
-        m_itemHistory.erase(itUncompr->second->m_historyCount);
-        m_itemsByImagePointer.erase(getPointer(itUncompr->second->getImage()));
-        m_uncompressedItems.erase(itUncompr);
+      std::string mainId;
+      if (getPointerId(getPointer(img), mainId) &&
+          mainId != id)  // already present in cache with another id...
+      {
+        shard.m_aliases[id] = mainId;
+        return;
       }
-      if (itCompr != m_compressedItems.end()) m_compressedItems.erase(id);
-    } else
-      return;
-  } else {
-    std::map<std::string, std::string>::iterator dt =
-        m_duplicatedItems.find(id);
-    if ((dt != m_duplicatedItems.end()) && !overwrite) return;
-
-    std::map<void *, std::string>::iterator it;
-    if ((it = m_itemsByImagePointer.find(getPointer(img))) !=
-        m_itemsByImagePointer
-            .end())  // already present in cache with another id...
-    {
-      m_duplicatedItems[id] = it->second;
-      return;
-    }
 
-    if (dt != m_duplicatedItems.end()) m_duplicatedItems.erase(dt);
-  }
+      if (dt != shard.m_aliases.end()) shard.m_aliases.erase(dt);
 
-  CacheItemP item;
+      it = shard.m_entries.insert(std::make_pair(id, CacheEntry())).first;
+      it->second.m_id = &it->first;
+    }
 
 #ifdef _DEBUGTOONZ
-  if (rimg)
-    rimg->getRaster()->m_cashed = true;
-  else if (timg)
-    timg->getRaster()->m_cashed = true;
+    if (rimg)
+      rimg->getRaster()->m_cashed = true;
+    else if (timg)
+      timg->getRaster()->m_cashed = true;
 #endif
 
-  item = new UncompressedOnMemoryCacheItem(img);
+    CacheItemP item = new UncompressedOnMemoryCacheItem(img);
 #ifdef TNZCORE_LIGHT
-  item->m_cantCompress = false;
+    item->m_cantCompress = false;
 #else
-  item->m_cantCompress = (TVectorImageP(img) ? true : false);
+    item->m_cantCompress = (TVectorImageP(img) ? true : false);
 #endif
-  item->m_id                             = id;
-  m_uncompressedItems[id]                = item;
-  m_itemsByImagePointer[getPointer(img)] = id;
-  item->m_historyCount                   = HistoryCount;
-  m_itemHistory[HistoryCount]            = id;
-  HistoryCount++;
 
-  doCompress();
+    CacheEntry &entry    = it->second;
+    entry.m_uncompressed = item;
+    shard.lruPush(&entry, ++m_access);
+    setPointerId(getPointer(img), id);
+  }
 
-#ifdef _DEBUGTOONZ
-// int itemCount =
-// m_imp->m_uncompressedItems.size()+m_imp->m_compressedItems.size();
-// m_imp->outputDebug();
-#endif
+  doCompress();
 }
 
+//------------------------------------------------------------------------------
+
 void TImageCache::remove(const std::string &id) { m_imp->remove(id); }
 
 //------------------------------------------------------------------------------
 
+//! Unbinds one of the duplicated ids of id, and returns it in aliasId.
+bool TImageCache::Imp::takeAlias(const std::string &id, std::string &aliasId) {
+  for (int s = 0; s != ShardCount; ++s) {
+    CacheShard &shard = m_shards[s];
+    TThread::MutexLocker sl(&shard.m_mutex);
+
+    AliasesMap::iterator it;
+    for (it = shard.m_aliases.begin(); it != shard.m_aliases.end(); ++it)
+      if (it->second == id) {
+        aliasId = it->first;
+        shard.m_aliases.erase(it);
+        return true;
+      }
+  }
+
+  return false;
+}
+
+//------------------------------------------------------------------------------
+
 void TImageCache::Imp::remove(const std::string &id) {
   if (CacheInstance == 0)
     return;  // the remove can be called when exiting from toonz...after the
              // imagecache was already freed!
 
   assert(check == magic);
-  TThread::MutexLocker sl(&m_mutex);
 
-  std::map<std::string, std::string>::iterator it1;
-  if ((it1 = m_duplicatedItems.find(id)) !=
-      m_duplicatedItems.end())  // it's a duplicated id...
+  CacheShard &shard = shardOf(id);
+
   {
-    m_duplicatedItems.erase(it1);
-    return;
+    TThread::MutexLocker sl(&shard.m_mutex);
+    if (shard.m_aliases.erase(id) > 0)  // it's a duplicated id...
+      return;
   }
 
-  for (it1 = m_duplicatedItems.begin(); it1 != m_duplicatedItems.end(); ++it1)
-    if (it1->second == id) break;
-
-  if (it1 != m_duplicatedItems.end())  // it has duplicated, so cannot erase it;
-                                       // I erase the duplicate, and assign its
-                                       // id has the main id
+  std::string sonId;
+  if (takeAlias(id, sonId))  // it has duplicated, so cannot erase it;
+                             // I erase the duplicate, and assign its
+                             // id has the main id
   {
-    std::string sonId = it1->first;
-    m_duplicatedItems.erase(it1);
     remap(sonId, id);
     return;
   }
 
-  std::map<std::string, CacheItemP>::iterator it = m_uncompressedItems.find(id);
-  std::map<std::string, CacheItemP>::iterator itc = m_compressedItems.find(id);
-  if (it != m_uncompressedItems.end()) {
-    const CacheItemP &item = it->second;
-    assert((UncompressedOnMemoryCacheItemP)item);
-    assert(m_itemHistory.find(it->second->m_historyCount) !=
-           m_itemHistory.end());
-    m_itemHistory.erase(it->second->m_historyCount);
-    m_itemsByImagePointer.erase(getPointer(it->second->getImage()));
+  TThread::MutexLocker sl(&shard.m_mutex);
+
+  EntriesMap::iterator it = shard.m_entries.find(id);
+  if (it == shard.m_entries.end()) return;
 
 #ifdef _DEBUGTOONZ
-    if ((TRasterImageP)it->second->getImage())
-      ((TRasterImageP)it->second->getImage())->getRaster()->m_cashed = false;
-    else if ((TToonzImageP)it->second->getImage())
-      ((TToonzImageP)it->second->getImage())->getRaster()->m_cashed = false;
+  if (it->second.m_uncompressed) {
+    TImageP img = it->second.m_uncompressed->getImage();
+    if ((TRasterImageP)img)
+      ((TRasterImageP)img)->getRaster()->m_cashed = false;
+    else if ((TToonzImageP)img)
+      ((TToonzImageP)img)->getRaster()->m_cashed = false;
+  }
 #endif
 
-    m_uncompressedItems.erase(it);
-  }
-  if (itc != m_compressedItems.end()) m_compressedItems.erase(itc);
+  releaseEntry(shard, it->second);
+  shard.m_entries.erase(it);
 }
 
 //------------------------------------------------------------------------------
@@ -1343,50 +1864,93 @@ void TImageCache::remap(const std::string &dstId, const std::string &srcId) {
 
 void TImageCache::Imp::remap(const std::string &dstId,
                              const std::string &srcId) {
-  TThread::MutexLocker sl(&m_mutex);
-  std::map<std::string, CacheItemP>::iterator it =
-      m_uncompressedItems.find(srcId);
-  if (it != m_uncompressedItems.end()) {
-    CacheItemP citem = it->second;
-    assert(m_itemHistory.find(citem->m_historyCount) != m_itemHistory.end());
-    m_itemHistory.erase(citem->m_historyCount);
-    m_itemsByImagePointer.erase(getPointer(citem->getImage()));
-    m_uncompressedItems.erase(it);
+  if (dstId == srcId) return;
 
-    m_uncompressedItems[dstId]                           = citem;
-    m_itemHistory[citem->m_historyCount]                 = dstId;
-    m_itemsByImagePointer[getPointer(citem->getImage())] = dstId;
+  // Detach the images and duplicate binding of srcId
+  CacheItemP uncompressed, compressed;
+  std::string mainId;
+  bool hasEntry = false, isAlias = false;
+  {
+    CacheShard &shard = shardOf(srcId);
+    TThread::MutexLocker sl(&shard.m_mutex);
+
+    EntriesMap::iterator it = shard.m_entries.find(srcId);
+    if (it != shard.m_entries.end()) {
+      CacheEntry &entry = it->second;
+      if (entry.m_uncompressed) shard.lruRemove(&entry);
+
+      uncompressed = entry.m_uncompressed;
+      compressed   = entry.m_compressed;
+      hasEntry     = true;
+      shard.m_entries.erase(it);
+    }
+
+    AliasesMap::iterator dt = shard.m_aliases.find(srcId);
+    if (dt != shard.m_aliases.end()) {
+      mainId  = dt->second;
+      isAlias = true;
+      shard.m_aliases.erase(dt);
+    }
   }
-  it = m_compressedItems.find(srcId);
-  if (it != m_compressedItems.end()) {
-    CacheItemP citem = it->second;
-    m_compressedItems.erase(it);
-    m_compressedItems[dstId] = citem;
+
+  // Bind them to dstId
+  {
+    CacheShard &shard = shardOf(dstId);
+    TThread::MutexLocker sl(&shard.m_mutex);
+
+    if (hasEntry) {
+      EntriesMap::iterator it = shard.m_entries.find(dstId);
+      if (it == shard.m_entries.end()) {
+        it = shard.m_entries.insert(std::make_pair(dstId, CacheEntry())).first;
+        it->second.m_id = &it->first;
+      } else
+        releaseEntry(shard, it->second);
+
+      CacheEntry &entry    = it->second;
+      entry.m_uncompressed = uncompressed;
+      entry.m_compressed   = compressed;
+      if (uncompressed) {
+        shard.lruPush(&entry, ++m_access);
+        setPointerId(getPointer(uncompressed->getImage()), dstId);
+      }
+
+      shard.m_aliases.erase(dstId);
+    }
+
+    if (isAlias) shard.m_aliases[dstId] = mainId;
   }
-  std::map<std::string, std::string>::iterator it2 =
-      m_duplicatedItems.find(srcId);
-  if (it2 != m_duplicatedItems.end()) {
-    std::string id = it2->second;
-    m_duplicatedItems.erase(it2);
-    m_duplicatedItems[dstId] = id;
+
+  // Redirect the duplicates of srcId
+  for (int s = 0; s != ShardCount; ++s) {
+    CacheShard &shard = m_shards[s];
+    TThread::MutexLocker sl(&shard.m_mutex);
+
+    AliasesMap::iterator it;
+    for (it = shard.m_aliases.begin(); it != shard.m_aliases.end(); ++it)
+      if (it->second == srcId) it->second = dstId;
   }
-  for (it2 = m_duplicatedItems.begin(); it2 != m_duplicatedItems.end(); ++it2)
-    if (it2->second == srcId) it2->second = dstId;
 }
 
 //------------------------------------------------------------------------------
 
 void TImageCache::remapIcons(const std::string &dstId,
                              const std::string &srcId) {
-  std::map<std::string, CacheItemP>::iterator it;
   std::map<std::string, std::string> table;
   std::string prefix = srcId + ":";
   int j              = (int)prefix.length();
-  for (it = m_imp->m_uncompressedItems.begin();
-       it != m_imp->m_uncompressedItems.end(); ++it) {
-    std::string id                      = it->first;
-    if (id.find(prefix) == 0) table[id] = dstId + ":" + id.substr(j);
+
+  for (int s = 0; s != ShardCount; ++s) {
+    CacheShard &shard = m_imp->m_shards[s];
+    TThread::MutexLocker sl(&shard.m_mutex);
+
+    EntriesMap::iterator it;
+    for (it = shard.m_entries.begin(); it != shard.m_entries.end(); ++it) {
+      const std::string &id = it->first;
+      if (it->second.m_uncompressed && id.find(prefix) == 0)
+        table[id] = dstId + ":" + id.substr(j);
+    }
   }
+
   for (std::map<std::string, std::string>::iterator it2 = table.begin();
        it2 != table.end(); ++it2) {
     remap(it2->second, it2->first);
@@ -1396,238 +1960,80 @@ void TImageCache::remapIcons(const std::string &dstId,
 //------------------------------------------------------------------------------
 
 void TImageCache::clear(bool deleteFolder) {
-  TThread::MutexLocker sl(&m_imp->m_mutex);
-  m_imp->m_uncompressedItems.clear();
-  m_imp->m_itemHistory.clear();
-  m_imp->m_compressedItems.clear();
-  m_imp->m_duplicatedItems.clear();
-  m_imp->m_itemsByImagePointer.clear();
-  if (deleteFolder && m_imp->m_rootDir != TFilePath())
-    TSystem::rmDirTree(m_imp->m_rootDir);
-}
-
-//------------------------------------------------------------------------------
-
-void TImageCache::clearSceneImages() {
-  TThread::MutexLocker sl(&m_imp->m_mutex);
-
-  // note the ';' - which follows ':' in the ascii table
-  m_imp->m_uncompressedItems.erase(
-      m_imp->m_uncompressedItems.begin(),
-      m_imp->m_uncompressedItems.lower_bound("$:"));
-  m_imp->m_uncompressedItems.erase(m_imp->m_uncompressedItems.lower_bound("$;"),
-                                   m_imp->m_uncompressedItems.end());
-
-  m_imp->m_compressedItems.erase(m_imp->m_compressedItems.begin(),
-                                 m_imp->m_compressedItems.lower_bound("$:"));
-  m_imp->m_compressedItems.erase(m_imp->m_compressedItems.lower_bound("$;"),
-                                 m_imp->m_compressedItems.end());
-
-  m_imp->m_duplicatedItems.erase(m_imp->m_duplicatedItems.begin(),
-                                 m_imp->m_duplicatedItems.lower_bound("$:"));
-  m_imp->m_duplicatedItems.erase(m_imp->m_duplicatedItems.lower_bound("$;"),
-                                 m_imp->m_duplicatedItems.end());
-
-  // Clear maps whose id is on the second of map pairs.
-
-  std::map<TUINT32, std::string>::iterator it;
-  for (it = m_imp->m_itemHistory.begin(); it != m_imp->m_itemHistory.end();) {
-    if (it->second.size() >= 2 && it->second[0] == '$' && it->second[1] == ':')
-      ++it;
-    else {
-      std::map<TUINT32, std::string>::iterator app = it;
-      app++;
-      m_imp->m_itemHistory.erase(it);
-      it = app;
-    }
+  for (int s = 0; s != ShardCount; ++s) {
+    CacheShard &shard = m_imp->m_shards[s];
+    TThread::MutexLocker sl(&shard.m_mutex);
+    shard.clear();
   }
-
-  std::map<void *, std::string>::iterator jt;
-  for (jt = m_imp->m_itemsByImagePointer.begin();
-       jt != m_imp->m_itemsByImagePointer.end();) {
-    if (jt->second.size() >= 2 && jt->second[0] == '$' && jt->second[1] == ':')
-      ++jt;
-    else {
-      std::map<void *, std::string>::iterator app = jt;
-      app++;
-      m_imp->m_itemsByImagePointer.erase(jt);
-      jt = app;
-    }
-  }
-}
-
-//------------------------------------------------------------------------------
-
-bool TImageCache::isCached(const std::string &id) const {
-  TThread::MutexLocker sl(&m_imp->m_mutex);
-  return (m_imp->m_uncompressedItems.find(id) !=
-              m_imp->m_uncompressedItems.end() ||
-          m_imp->m_compressedItems.find(id) != m_imp->m_compressedItems.end() ||
-          m_imp->m_duplicatedItems.find(id) != m_imp->m_duplicatedItems.end());
-}
-
-//------------------------------------------------------------------------------
-#ifdef LEVO
-
-bool TImageCache::getSize(const std::string &id, TDimension &size) const {
-  QMutexLocker sl(&m_imp->m_mutex);
-
-  std::map<std::string, CacheItemP>::iterator it =
-      m_imp->m_uncompressedItems.find(id);
-  if (it != m_imp->m_uncompressedItems.end()) {
-    UncompressedOnMemoryCacheItemP uncompressed = it->second;
-    assert(uncompressed);
-    TToonzImageP ti = uncompressed->getImage();
-    if (ti) {
-      size = ti->getSize();
-      return true;
-    }
-
-    TRasterImageP ri = uncompressed->getImage();
-    if (ri && ri->getRaster()) {
-      size = ri->getRaster()->getSize();
-      return true;
-    }
-    return false;
+  for (int s = 0; s != ShardCount; ++s) {
+    PointerShard &shard = m_imp->m_pointerShards[s];
+    TThread::MutexLocker sl(&shard.m_mutex);
+    shard.m_ids.clear();
   }
-  std::map<std::string, CacheItemP>::iterator itc =
-      m_imp->m_compressedItems.find(id);
-  if (itc == m_imp->m_compressedItems.end()) return false;
-  CacheItemP cacheItem = itc->second;
-
-  if (cacheItem->m_imageInfo) {
-    RasterImageInfo *rimageInfo =
-        dynamic_cast<RasterImageInfo *>(cacheItem->m_imageInfo);
-    if (rimageInfo) {
-      size = rimageInfo->m_size;
-      return true;
-    }
-    ToonzImageInfo *timageInfo =
-        dynamic_cast<ToonzImageInfo *>(cacheItem->m_imageInfo);
-    if (timageInfo) {
-      size = timageInfo->m_size;
-      return true;
+  if (deleteFolder) {
+    {
+      // The swap file is removed as soon as no item uses it
+      QMutexLocker sl(&m_imp->m_swapMutex);
+      m_imp->m_swapSlab.reset();
     }
+    if (m_imp->m_rootDir != TFilePath()) TSystem::rmDirTree(m_imp->m_rootDir);
   }
-
-  return false;
 }
 
 //------------------------------------------------------------------------------
 
-bool TImageCache::getSavebox(const std::string &id, TRect &savebox) const {
-  QMutexLocker sl(&m_imp->m_mutex);
-
-  std::map<std::string, CacheItemP>::iterator it =
-      m_imp->m_uncompressedItems.find(id);
-  if (it != m_imp->m_uncompressedItems.end()) {
-    UncompressedOnMemoryCacheItemP uncompressed = it->second;
-    assert(uncompressed);
-
-    TToonzImageP ti = uncompressed->getImage();
-    if (ti) {
-      savebox = ti->getSavebox();
-      return true;
-    }
-    TRasterImageP ri = uncompressed->getImage();
-    if (ri) {
-      savebox = ri->getSavebox();
-      return true;
+void TImageCache::clearSceneImages() {
+  // Scene-independent images have the "$:" id prefix
+  for (int s = 0; s != ShardCount; ++s) {
+    CacheShard &shard = m_imp->m_shards[s];
+    TThread::MutexLocker sl(&shard.m_mutex);
+
+    EntriesMap::iterator it;
+    for (it = shard.m_entries.begin(); it != shard.m_entries.end();) {
+      if (isSceneIndependent(it->first))
+        ++it;
+      else {
+        m_imp->releaseEntry(shard, it->second);
+        it = shard.m_entries.erase(it);
+      }
     }
-    return false;
-  }
-  std::map<std::string, CacheItemP>::iterator itc =
-      m_imp->m_compressedItems.find(id);
-  if (itc == m_imp->m_compressedItems.end()) return false;
-
-  CacheItemP cacheItem = itc->second;
 
-  assert(cacheItem->m_imageInfo);
-
-  RasterImageInfo *rimageInfo =
-      dynamic_cast<RasterImageInfo *>(cacheItem->m_imageInfo);
-  if (rimageInfo) {
-    savebox = rimageInfo->m_savebox;
-    return true;
-  }
-#ifndef TNZCORE_LIGHT
-  ToonzImageInfo *timageInfo =
-      dynamic_cast<ToonzImageInfo *>(cacheItem->m_imageInfo);
-  if (timageInfo) {
-    savebox = timageInfo->m_savebox;
-    return true;
+    AliasesMap::iterator dt;
+    for (dt = shard.m_aliases.begin(); dt != shard.m_aliases.end();) {
+      if (isSceneIndependent(dt->first))
+        ++dt;
+      else
+        dt = shard.m_aliases.erase(dt);
+    }
   }
-#endif
-  return false;
 }
 
 //------------------------------------------------------------------------------
 
-bool TImageCache::getDpi(const std::string &id, double &dpiX,
-                         double &dpiY) const {
-  QMutexLocker sl(&m_imp->m_mutex);
-
-  std::map<std::string, CacheItemP>::iterator it =
-      m_imp->m_uncompressedItems.find(id);
-  if (it != m_imp->m_uncompressedItems.end()) {
-    UncompressedOnMemoryCacheItemP uncompressed = it->second;
-    assert(uncompressed);
-    TToonzImageP ti = uncompressed->getImage();
-    if (ti) {
-      ti->getDpi(dpiX, dpiY);
-      return true;
-    }
-    TRasterImageP ri = uncompressed->getImage();
-    if (ri) {
-      ri->getDpi(dpiX, dpiY);
-      return true;
-    }
-    return false;
-  }
-  std::map<std::string, CacheItemP>::iterator itc =
-      m_imp->m_compressedItems.find(id);
-  if (itc == m_imp->m_compressedItems.end()) return false;
-  CacheItemP cacheItem = itc->second;
-  assert(cacheItem->m_imageInfo);
-
-  RasterImageInfo *rimageInfo =
-      dynamic_cast<RasterImageInfo *>(cacheItem->m_imageInfo);
-  if (rimageInfo) {
-    dpiX = rimageInfo->m_dpix;
-    dpiY = rimageInfo->m_dpiy;
-    return true;
-  }
-#ifndef TNZCORE_LIGHT
-  ToonzImageInfo *timageInfo =
-      dynamic_cast<ToonzImageInfo *>(cacheItem->m_imageInfo);
-  if (timageInfo) {
-    dpiX = timageInfo->m_dpix;
-    dpiY = timageInfo->m_dpiy;
-    return true;
-  }
-#endif
-  return false;
+bool TImageCache::isCached(const std::string &id) const {
+  CacheShard &shard = m_imp->shardOf(id);
+  TThread::MutexLocker sl(&shard.m_mutex);
+  return (shard.m_entries.find(id) != shard.m_entries.end() ||
+          shard.m_aliases.find(id) != shard.m_aliases.end());
 }
 
 //------------------------------------------------------------------------------
-#endif
 
 bool TImageCache::getSubsampling(const std::string &id, int &subs) const {
-  TThread::MutexLocker sl(&m_imp->m_mutex);
-
-  std::map<std::string, std::string>::iterator it1;
-  if ((it1 = m_imp->m_duplicatedItems.find(id)) !=
-      m_imp->m_duplicatedItems.end()) {
-    assert(m_imp->m_duplicatedItems.find(it1->second) ==
-           m_imp->m_duplicatedItems.end());
-    return getSubsampling(it1->second, subs);
+  CacheShard &shard = m_imp->shardOf(id);
+  TThread::MutexLocker sl(&shard.m_mutex);
+
+  AliasesMap::iterator dt = shard.m_aliases.find(id);
+  if (dt != shard.m_aliases.end()) {
+    std::string mainId = dt->second;
+    sl.unlock();
+    return getSubsampling(mainId, subs);
   }
 
-  std::map<std::string, CacheItemP>::iterator it =
-      m_imp->m_uncompressedItems.find(id);
-  if (it != m_imp->m_uncompressedItems.end()) {
-    UncompressedOnMemoryCacheItemP uncompressed = it->second;
-    assert(uncompressed);
+  EntriesMap::iterator it = shard.m_entries.find(id);
+  if (it == shard.m_entries.end()) return false;
+
+  if (UncompressedOnMemoryCacheItemP uncompressed = it->second.m_uncompressed) {
 #ifndef TNZCORE_LIGHT
     if (TToonzImageP ti = uncompressed->getImage()) {
       subs = ti->getSubsampling();
@@ -1642,11 +2048,9 @@ bool TImageCache::getSubsampling(const std::string &id, int &subs) const {
     } else
       return false;
   }
-  std::map<std::string, CacheItemP>::iterator itc =
-      m_imp->m_compressedItems.find(id);
-  if (itc == m_imp->m_compressedItems.end()) return false;
-  CacheItemP cacheItem = itc->second;
-  assert(cacheItem->m_imageInfo);
+
+  CacheItemP cacheItem = it->second.m_compressed;
+  assert(cacheItem && cacheItem->m_imageInfo);
   if (RasterImageInfo *rimageInfo =
           dynamic_cast<RasterImageInfo *>(cacheItem->m_imageInfo)) {
     subs = rimageInfo->m_subs;
@@ -1666,26 +2070,24 @@ bool TImageCache::getSubsampling(const std::string &id, int &subs) const {
 //------------------------------------------------------------------------------
 
 bool TImageCache::hasBeenModified(const std::string &id, bool reset) const {
-  TThread::MutexLocker sl(&m_imp->m_mutex);
-
-  std::map<std::string, std::string>::iterator it;
-  if ((it = m_imp->m_duplicatedItems.find(id)) !=
-      m_imp->m_duplicatedItems.end()) {
-    assert(m_imp->m_duplicatedItems.find(it->second) ==
-           m_imp->m_duplicatedItems.end());
-    return hasBeenModified(it->second, reset);
+  CacheShard &shard = m_imp->shardOf(id);
+  TThread::MutexLocker sl(&shard.m_mutex);
+
+  AliasesMap::iterator dt = shard.m_aliases.find(id);
+  if (dt != shard.m_aliases.end()) {
+    std::string mainId = dt->second;
+    sl.unlock();
+    return hasBeenModified(mainId, reset);
   }
 
-  TImageP img;
-
-  std::map<std::string, CacheItemP>::iterator itu =
-      m_imp->m_uncompressedItems.find(id);
-  if (itu != m_imp->m_uncompressedItems.end()) {
-    if (reset && itu->second->m_modified) {
-      itu->second->m_modified = false;
+  EntriesMap::iterator it = shard.m_entries.find(id);
+  if (it != shard.m_entries.end() && it->second.m_uncompressed) {
+    CacheItemP item = it->second.m_uncompressed;
+    if (reset && item->m_modified) {
+      item->m_modified = false;
       return true;
     } else
-      return itu->second->m_modified;
+      return item->m_modified;
   }
   return true;  // not present in cache==modified (for particle purposes...)
 }
@@ -1699,79 +2101,64 @@ TImageP TImageCache::get(const std::string &id, bool toBeModified) const {
 //------------------------------------------------------------------------------
 
 TImageP TImageCache::Imp::get(const std::string &id, bool toBeModified) {
-  TThread::MutexLocker sl(&m_mutex);
-
-  std::map<std::string, std::string>::const_iterator it;
-  if ((it = m_duplicatedItems.find(id)) != m_duplicatedItems.end()) {
-    assert(m_duplicatedItems.find(it->second) == m_duplicatedItems.end());
-    return get(it->second, toBeModified);
-  }
+  CacheShard &shard = shardOf(id);
 
   TImageP img;
+  CacheItemP uncompressed;
+  {
+    TThread::MutexLocker sl(&shard.m_mutex);
 
-  std::map<std::string, CacheItemP>::iterator itu =
-      m_uncompressedItems.find(id);
-  if (itu != m_uncompressedItems.end()) {
-    img = itu->second->getImage();
-    if (itu->second->m_historyCount !=
-        HistoryCount - 1)  // significa che l'ultimo get non era sulla stessa
-                           // immagine, quindi  serve aggiornare l'history!
-    {
-      assert(m_itemHistory.find(itu->second->m_historyCount) !=
-             m_itemHistory.end());
-      m_itemHistory.erase(itu->second->m_historyCount);
-      m_itemHistory[HistoryCount] = id;
-      itu->second->m_historyCount = HistoryCount;
-      HistoryCount++;
-    }
-    if (toBeModified) {
-      itu->second->m_modified = true;
-      std::map<std::string, CacheItemP>::iterator itc =
-          m_compressedItems.find(id);
-      if (itc != m_compressedItems.end()) m_compressedItems.erase(itc);
+    EntriesMap::iterator it = shard.m_entries.find(id);
+    if (it == shard.m_entries.end()) {
+      AliasesMap::iterator dt = shard.m_aliases.find(id);
+      if (dt == shard.m_aliases.end()) return 0;
+
+      std::string mainId = dt->second;
+      sl.unlock();
+      return get(mainId, toBeModified);
     }
-    return img;
-  }
 
-  std::map<std::string, CacheItemP>::iterator itc = m_compressedItems.find(id);
-  if (itc == m_compressedItems.end()) return 0;
+    CacheEntry &entry = it->second;
+    if (entry.m_uncompressed) {
+      shard.lruTouch(&entry, ++m_access);
+      if (toBeModified) {
+        entry.m_uncompressed->m_modified = true;
+        entry.m_compressed               = CacheItemP();
+      }
+      return entry.m_uncompressed->getImage();
+    }
 
-  CacheItemP cacheItem = itc->second;
+    CacheItemP cacheItem = entry.m_compressed;
+    assert(cacheItem);
 
-  img = cacheItem->getImage();
+    img = cacheItem->getImage();
 
-  CacheItemP uncompressed;
-  uncompressed                    = new UncompressedOnMemoryCacheItem(img);
-  m_uncompressedItems[itc->first] = uncompressed;
-  m_itemsByImagePointer[getPointer(img)] = itc->first;
+    uncompressed         = new UncompressedOnMemoryCacheItem(img);
+    entry.m_uncompressed = uncompressed;
+    shard.lruPush(&entry, ++m_access);
+    setPointerId(getPointer(img), id);
 
-  m_itemHistory[HistoryCount]  = itc->first;
-  uncompressed->m_historyCount = HistoryCount;
-  HistoryCount++;
+    if (CompressedOnMemoryCacheItemP(cacheItem))
+    // l'immagine compressa non la tengo insieme alla
+    // uncompressa se e' troppo grande
+    {
+      if (10 * cacheItem->getSize() > uncompressed->getSize())
+        entry.m_compressed = CacheItemP();
+    } else
+      assert((CompressedOnDiskCacheItemP)cacheItem ||
+             (UncompressedOnDiskCacheItemP)
+                 cacheItem);  // deve essere compressa!
 
-  if (CompressedOnMemoryCacheItemP(cacheItem))
-  // l'immagine compressa non la tengo insieme alla
-  // uncompressa se e' troppo grande
-  {
-    if (10 * cacheItem->getSize() > uncompressed->getSize()) {
-      m_compressedItems.erase(itc);
-      itc = m_compressedItems.end();
+    if (toBeModified && entry.m_compressed) {
+      uncompressed->m_modified = true;
+      entry.m_compressed       = CacheItemP();
     }
-  } else
-    assert((CompressedOnDiskCacheItemP)cacheItem ||
-           (UncompressedOnDiskCacheItemP)cacheItem);  // deve essere compressa!
-
-  if (toBeModified && itc != m_compressedItems.end()) {
-    uncompressed->m_modified = true;
-    m_compressedItems.erase(itc);
   }
 
-  uncompressed->m_cantCompress = toBeModified;
   // se la memoria utilizzata e' superiore al massimo consentito, comprime
+  // (img is referenced here, so it will not be compressed back)
   doCompress();
 
-  uncompressed->m_cantCompress = false;
-
 //#define DO_MEMCHECK
 #ifdef DO_MEMCHECK
   assert(_CrtCheckMemory());
@@ -1782,26 +2169,22 @@ TImageP TImageCache::Imp::get(const std::string &id, bool toBeModified) {
 
 //------------------------------------------------------------------------------
 
-namespace {
-
-class AccumulateMemUsage {
-public:
-  int operator()(int oldValue, std::pair<std::string, CacheItemP> item) {
-    return oldValue + item.second->getSize();
-  }
-};
-}
-
 UINT TImageCache::getMemUsage() const {
-  TThread::MutexLocker sl(&m_imp->m_mutex);
+  UINT ret = 0;
 
-  int ret = std::accumulate(m_imp->m_uncompressedItems.begin(),
-                            m_imp->m_uncompressedItems.end(), 0,
-                            AccumulateMemUsage());
+  for (int s = 0; s != ShardCount; ++s) {
+    CacheShard &shard = m_imp->m_shards[s];
+    TThread::MutexLocker sl(&shard.m_mutex);
+
+    EntriesMap::iterator it;
+    for (it = shard.m_entries.begin(); it != shard.m_entries.end(); ++it) {
+      if (it->second.m_uncompressed)
+        ret += it->second.m_uncompressed->getSize();
+      if (it->second.m_compressed) ret += it->second.m_compressed->getSize();
+    }
+  }
 
-  return ret + std::accumulate(m_imp->m_compressedItems.begin(),
-                               m_imp->m_compressedItems.end(), 0,
-                               AccumulateMemUsage());
+  return ret;
 }
 
 //------------------------------------------------------------------------------
@@ -1811,13 +2194,14 @@ UINT TImageCache::getDiskUsage() const { return 0; }
 //------------------------------------------------------------------------------
 
 UINT TImageCache::getMemUsage(const std::string &id) const {
-  std::map<std::string, CacheItemP>::iterator it =
-      m_imp->m_uncompressedItems.find(id);
-  if (it != m_imp->m_uncompressedItems.end()) return it->second->getSize();
+  CacheShard &shard = m_imp->shardOf(id);
+  TThread::MutexLocker sl(&shard.m_mutex);
 
-  it = m_imp->m_compressedItems.find(id);
-  if (it != m_imp->m_compressedItems.end()) return it->second->getSize();
-  return 0;
+  EntriesMap::iterator it = shard.m_entries.find(id);
+  if (it == shard.m_entries.end()) return 0;
+
+  if (it->second.m_uncompressed) return it->second.m_uncompressed->getSize();
+  return it->second.m_compressed->getSize();
 }
 
 //------------------------------------------------------------------------------
@@ -1825,14 +2209,7 @@ UINT TImageCache::getMemUsage(const std::string &id) const {
 //! Returns the uncompressed image size (in KB) of the image associated with
 //! passd id, or 0 if none was found.
 UINT TImageCache::getUncompressedMemUsage(const std::string &id) const {
-  std::map<std::string, CacheItemP>::iterator it =
-      m_imp->m_uncompressedItems.find(id);
-  if (it != m_imp->m_uncompressedItems.end()) return it->second->getSize();
-
-  it = m_imp->m_compressedItems.find(id);
-  if (it != m_imp->m_compressedItems.end()) return it->second->getSize();
-
-  return 0;
+  return getMemUsage(id);
 }
 
 //------------------------------------------------------------------------------
@@ -1851,10 +2228,14 @@ UINT TImageCache::getDiskUsage(const std::string &id) const { return 0; }
 
 void TImageCache::dump(std::ostream &os) const {
   os << "mem: " << getMemUsage() << std::endl;
-  std::map<std::string, CacheItemP>::iterator it =
-      m_imp->m_uncompressedItems.begin();
-  for (; it != m_imp->m_uncompressedItems.end(); ++it) {
-    os << it->first << std::endl;
+
+  for (int s = 0; s != ShardCount; ++s) {
+    CacheShard &shard = m_imp->m_shards[s];
+    TThread::MutexLocker sl(&shard.m_mutex);
+
+    shard.lruReturnHeld();
+    for (CacheEntry *entry = shard.m_lruHead; entry; entry = entry->m_next)
+      os << *entry->m_id << std::endl;
   }
 }
 
@@ -1867,7 +2248,6 @@ void TImageCache::outputMap(UINT chunkRequested, std::string filename) {
 //------------------------------------------------------------------------------
 
 void TImageCache::Imp::outputMap(UINT chunkRequested, std::string filename) {
-  TThread::MutexLocker sl(&m_mutex);
   //#ifdef _DEBUG
   // static int Count = 0;
 
@@ -1891,37 +2271,41 @@ void TImageCache::Imp::outputMap(UINT chunkRequested, std::string filename) {
   TUINT64 umsize  = 0;
   TUINT64 udsize  = 0;
 
-  std::map<std::string, CacheItemP>::iterator itu = m_uncompressedItems.begin();
+  for (int s = 0; s != ShardCount; ++s) {
+    CacheShard &shard = m_shards[s];
+    TThread::MutexLocker sl(&shard.m_mutex);
+
+    EntriesMap::iterator it;
+    for (it = shard.m_entries.begin(); it != shard.m_entries.end(); ++it) {
+      if (UncompressedOnMemoryCacheItemP uitem = it->second.m_uncompressed) {
+        if (uitem->m_image && hasExternalReferences(uitem->m_image)) {
+          umcount1++;
+          umsize1 += (TUINT64)(uitem->getSize() / 1024.0);
+        } else if (uitem->m_cantCompress) {
+          umcount2++;
+          umsize2 += (TUINT64)(uitem->getSize() / 1024.0);
+        } else {
+          umcount3++;
+          umsize3 += (TUINT64)(uitem->getSize() / 1024.0);
+        }
+      }
 
-  for (; itu != m_uncompressedItems.end(); ++itu) {
-    UncompressedOnMemoryCacheItemP uitem = itu->second;
-    if (uitem->m_image && hasExternalReferences(uitem->m_image)) {
-      umcount1++;
-      umsize1 += (TUINT64)(itu->second->getSize() / 1024.0);
-    } else if (uitem->m_cantCompress) {
-      umcount2++;
-      umsize2 += (TUINT64)(itu->second->getSize() / 1024.0);
-    } else {
-      umcount3++;
-      umsize3 += (TUINT64)(itu->second->getSize() / 1024.0);
-    }
-  }
-  std::map<std::string, CacheItemP>::iterator itc = m_compressedItems.begin();
-  for (; itc != m_compressedItems.end(); ++itc) {
-    CacheItemP boh                      = itc->second;
-    CompressedOnMemoryCacheItemP cmitem = itc->second;
-    CompressedOnDiskCacheItemP cditem   = itc->second;
-    UncompressedOnDiskCacheItemP uditem = itc->second;
-    if (cmitem) {
-      cmcount++;
-      cmsize += cmitem->getSize();
-    } else if (cditem) {
-      cdcount++;
-      cdsize += cditem->getSize();
-    } else {
-      assert(uditem);
-      udcount++;
-      udsize += uditem->getSize();
+      if (CacheItemP citem = it->second.m_compressed) {
+        CompressedOnMemoryCacheItemP cmitem = citem;
+        CompressedOnDiskCacheItemP cditem   = citem;
+        UncompressedOnDiskCacheItemP uditem = citem;
+        if (cmitem) {
+          cmcount++;
+          cmsize += cmitem->getSize();
+        } else if (cditem) {
+          cdcount++;
+          cdsize += cditem->getSize();
+        } else {
+          assert(uditem);
+          udcount++;
+          udsize += uditem->getSize();
+        }
+      }
     }
   }
 
@@ -1970,6 +2354,51 @@ void TImageCache::compress(const std::string &id) { m_imp->doCompress(id); }
 
 //------------------------------------------------------------------------------
 
+void TImageCache::setWatermarks(UINT lowWatermark, UINT highWatermark) {
+  assert(lowWatermark <= highWatermark);
+
+  m_imp->m_lowWatermark  = lowWatermark;
+  m_imp->m_highWatermark = highWatermark;
+
+  m_imp->m_maintainer->request();
+}
+
+//------------------------------------------------------------------------------
+
+UINT TImageCache::getDefaultHighWatermark() {
+  TINT64 size = TSystem::getMemorySize(true) / 4;
+  return (UINT)std::min<TINT64>(std::max<TINT64>(size, 64 << 10), UINT_MAX);
+}
+
+//------------------------------------------------------------------------------
+
+void TImageCache::getWatermarks(UINT &lowWatermark,
+                                UINT &highWatermark) const {
+  lowWatermark  = m_imp->m_lowWatermark;
+  highWatermark = m_imp->m_highWatermark;
+}
+
+//------------------------------------------------------------------------------
+
+TImageCache::Statistics TImageCache::getStatistics() const {
+  Statistics stats;
+  stats.m_compressedBytes = m_imp->m_compressedBytes;
+  stats.m_spilledBytes    = m_imp->m_spilledBytes;
+  stats.m_stallTime       = m_imp->m_stallTime;
+
+  return stats;
+}
+
+//------------------------------------------------------------------------------
+
+void TImageCache::addMemoryPressureHandler(
+    const std::function<void()> &handler) {
+  QMutexLocker hl(&m_imp->m_handlersMutex);
+  m_imp->m_memoryPressureHandlers.push_back(handler);
+}
+
+//------------------------------------------------------------------------------
+
 #ifndef TNZCORE_LIGHT
 
 void TImageCache::add(const QString &id, const TImageP &img, bool overwrite) {
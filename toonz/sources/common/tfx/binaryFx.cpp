@@ -10,6 +10,7 @@
 #include "tfxparam.h"
 #include "trasterfx.h"
 #include "tbasefx.h"
+#include "trenderer.h"
 
 //******************************************************************************************
 //    Local namespace
@@ -149,12 +150,20 @@ void TImageCombinationFx::doCompute(TTile &tile, double frame,
   TRectD tileRectD(tile.m_pos, TDimensionD(tileSize.lx, tileSize.ly));
 
   // Render the first viable port directly on tile
-  (*port)->compute(tile, frame,
-                   info);  // Should we do it only if the bbox is not empty?
-
-  // Then, render each subsequent port and process() it on top of tile
+  std::vector<std::function<void()>> computes;
+  computes.push_back([&tile, port, frame, &info]() {
+    (*port)->compute(tile, frame,
+                     info);  // Should we do it only if the bbox is not empty?
+  });
+
+  // Then, render each subsequent port - they will be process()ed on top of
+  // tile once all the inputs are available. Since the inputs are independent
+  // branches of the fx tree, the renderer may compute them concurrently.
   bool canRestrict = !requiresFullRect();
 
+  std::vector<TRasterFxPort *> ports;
+  std::vector<TRectD> computeRects;
+
   for (--p; p >= 0; --p) {
     port = static_cast<TRasterFxPort *>(getInputPort(p));
     if (!(port && port->getFx()))  // Skip empty ports
@@ -176,28 +185,51 @@ void TImageCombinationFx::doCompute(TTile &tile, double frame,
           tile.m_pos);  // Make it coherent with tile's pixel geometry
     }
 
-    // Calculate the input port and perform processing
     TDimension computeSize(tround(computeRect.getLx()),
                            tround(computeRect.getLy()));
     if ((computeSize.lx > 0) && (computeSize.ly > 0)) {
-      TTile inTile;  // Observe its locality - not incidental
-      (*port)->allocateAndCompute(inTile, computeRect.getP00(), computeSize,
-                                  tile.getRaster(), frame, info);
-
-      // Invoke process() to deal with the actual fx processing
-      TRasterP up(inTile.getRaster()), down(tile.getRaster());
-
-      if (canRestrict) {
-        // Extract from tile the part corresponding to inTile
-        TRect downRect(convert(computeRect.getP00() - tile.m_pos), computeSize);
-        down = down->extract(downRect);
-      }
-
-      assert(up->getSize() == down->getSize());
-      process(up, down, frame);  // This is the point with the max concentration
-                                 // of allocated resources
+      ports.push_back(port);
+      computeRects.push_back(computeRect);
     }
   }
+
+  std::vector<TTile> inTiles(ports.size());
+  TRasterP templateRas(tile.getRaster());
+
+  for (unsigned int i = 0; i < ports.size(); ++i) {
+    computes.push_back([&, i]() {
+      const TRectD &computeRect = computeRects[i];
+      TDimension computeSize(tround(computeRect.getLx()),
+                             tround(computeRect.getLy()));
+
+      (*ports[i])->allocateAndCompute(inTiles[i], computeRect.getP00(),
+                                      computeSize, templateRas, frame, info);
+    });
+  }
+
+  TRenderer::runSubtasks(computes);
+
+  // Perform processing, in the ports order
+  for (unsigned int i = 0; i < ports.size(); ++i) {
+    const TRectD &computeRect = computeRects[i];
+    TDimension computeSize(tround(computeRect.getLx()),
+                           tround(computeRect.getLy()));
+
+    // Invoke process() to deal with the actual fx processing
+    TRasterP up(inTiles[i].getRaster()), down(tile.getRaster());
+
+    if (canRestrict) {
+      // Extract from tile the part corresponding to inTile
+      TRect downRect(convert(computeRect.getP00() - tile.m_pos), computeSize);
+      down = down->extract(downRect);
+    }
+
+    assert(up->getSize() == down->getSize());
+    process(up, down, frame);  // This is the point with the max concentration
+                               // of allocated resources
+
+    inTiles[i].setRaster(TRasterP());
+  }
 }
 
 //-------------------------------------------------------------------------------------
@@ -4,6 +4,7 @@
 
 #include "trenderer.h"
 #include "tcacheresourcepool.h"
+#include "trendertrace.h"
 
 #include "tfxcachemanager.h"
 
@@ -39,6 +40,17 @@ QString prefixSubTiles("#SubTiles.txt | ");
 
 #endif  // DIAGNOSTICS
 
+namespace {
+inline void traceCacheAccess(bool hit, const TRectD &rect) {
+  TRenderTrace *trace = TRenderTrace::instance();
+  if (trace->isEnabled())
+    trace->addInstantEvent(hit ? "Cache hit" : "Cache miss", "cache",
+                           TRenderTrace::arg("lx", tround(rect.getLx())) +
+                               "," +
+                               TRenderTrace::arg("ly", tround(rect.getLy())));
+}
+}  // namespace
+
 //****************************************************************************************************
 //    Explanation
 //****************************************************************************************************
@@ -740,8 +752,12 @@ void ResourceBuilder::build(const TRectD &tileRect) {
                       1);
 #endif
 
-    if (download(m_data.second)) return;
+    if (download(m_data.second)) {
+      traceCacheAccess(true, tileRect);
+      return;
+    }
 
+    traceCacheAccess(false, tileRect);
     compute(tileRect);
 
     // Since there is an associated resource, the calculated content is
@@ -800,7 +816,10 @@ void ResourceBuilder::build(const TRectD &tileRect) {
       TRect tileRectI(tileData.m_rect.x0, tileData.m_rect.y0,
                       tileData.m_rect.x1 - 1, tileData.m_rect.y1 - 1);
 
-      if (m_data.second->canDownloadAll(tileRectI)) {
+      bool canDownload = m_data.second->canDownloadAll(tileRectI);
+      traceCacheAccess(canDownload, tileData.m_rect);
+
+      if (canDownload) {
         if (!tileData.m_calculated && tileData.m_refCount > 0) {
           /*#ifdef WRITESTACK
 QString renderStr(DIAGNOSTICS_GLOSTRGET("compRenderStr"));
@@ -0,0 +1,418 @@
+
+
+// TnzCore includes
+#include "tsystem.h"
+#include "traster.h"
+#include "tconvert.h"
+
+// TnzBase includes
+#include "trasterfx.h"
+#include "ttile.h"
+
+// Qt includes
+#include <QMutex>
+#include <QFile>
+#include <QDir>
+#include <QFileInfo>
+#include <QDateTime>
+#include <QCryptographicHash>
+#include <QCoreApplication>
+
+// STD includes
+#include <atomic>
+#include <unordered_map>
+#include <algorithm>
+
+#include "tpersistentrendercache.h"
+
+//****************************************************************************
+//    Local namespace stuff
+//****************************************************************************
+
+namespace {
+
+const char *const entryExtension = ".tile";
+
+// Marks aliases depending on unsaved data. Results bearing it must never
+// reach the disk, since they could not be told apart from those of the
+// saved data in later sessions.
+const char *const volatileStamp = "{unsaved}";
+
+const TINT32 fileMagic   = 0x43525054;  // "TPRC"
+const TINT32 fileVersion = 1;
+
+struct EntryHeader {
+  TINT32 m_magic, m_version;
+  TINT32 m_lx, m_ly;
+  TINT32 m_type;
+  TINT32 m_linear;
+};
+
+//-----------------------------------------------------------------------
+
+// Only the raster types flowing through fx computations are supported
+enum RasterType { UNSUPPORTED, RGBM32, RGBM64, RGBMFLOAT };
+
+inline int rasterType(const TRasterP &ras) {
+  if ((TRaster32P)ras) return RGBM32;
+  if ((TRaster64P)ras) return RGBM64;
+  if ((TRasterFP)ras) return RGBMFLOAT;
+
+  return UNSUPPORTED;
+}
+
+//-----------------------------------------------------------------------
+
+inline TINT64 currentTime() {
+  return QDateTime::currentDateTime().toMSecsSinceEpoch();
+}
+
+}  // namespace
+
+//****************************************************************************
+//    TPersistentRenderCache::Imp  definition
+//****************************************************************************
+
+class TPersistentRenderCache::Imp {
+public:
+  struct Entry {
+    TINT64 m_size;
+    TINT64 m_lastAccess;
+  };
+
+  typedef std::unordered_map<std::string, Entry> EntriesMap;
+
+public:
+  QMutex m_mutex;
+
+  TFilePath m_root;
+  std::atomic<bool> m_enabled;
+
+  EntriesMap m_entries;  //!< Entries found in the cache folder
+  TINT64 m_size;         //!< Total size of the entries, in bytes
+  bool m_scanned;        //!< Whether the cache folder was already scanned
+
+  int m_maxSizeMB;
+  int m_minComputeTime;
+
+public:
+  Imp()
+      : m_enabled(false)
+      , m_size(0)
+      , m_scanned(false)
+      , m_maxSizeMB(2048)
+      , m_minComputeTime(50) {}
+
+  TFilePath entryPath(const std::string &key) const {
+    return m_root + TFilePath(key + entryExtension);
+  }
+
+  void scan();
+  void purge();
+};
+
+//-----------------------------------------------------------------------
+
+//! Builds the entries index from the cache folder content. Entries written
+//! by previous sessions take their last access time from the files'
+//! modification time, which is refreshed on each hit.
+void TPersistentRenderCache::Imp::scan() {
+  if (m_scanned) return;
+  m_scanned = true;
+
+  QDir dir(m_root.getQString());
+  QFileInfoList infos = dir.entryInfoList(
+      QStringList(QString("*") + entryExtension), QDir::Files);
+
+  for (const QFileInfo &info : infos) {
+    Entry &entry       = m_entries[info.completeBaseName().toStdString()];
+    entry.m_size       = info.size();
+    entry.m_lastAccess = info.lastModified().toMSecsSinceEpoch();
+
+    m_size += entry.m_size;
+  }
+}
+
+//-----------------------------------------------------------------------
+
+//! Removes the least recently accessed entries until the cache is back
+//! below 90% of its maximum size.
+void TPersistentRenderCache::Imp::purge() {
+  TINT64 maxSize = TINT64(m_maxSizeMB) << 20;
+  if (m_size <= maxSize) return;
+
+  std::vector<std::pair<TINT64, EntriesMap::iterator>> byAccess;
+  byAccess.reserve(m_entries.size());
+
+  EntriesMap::iterator it;
+  for (it = m_entries.begin(); it != m_entries.end(); ++it)
+    byAccess.push_back(std::make_pair(it->second.m_lastAccess, it));
+
+  std::sort(byAccess.begin(), byAccess.end(),
+            [](const std::pair<TINT64, EntriesMap::iterator> &a,
+               const std::pair<TINT64, EntriesMap::iterator> &b) {
+              return a.first < b.first;
+            });
+
+  TINT64 lowSize = maxSize - maxSize / 10;
+
+  unsigned int i;
+  for (i = 0; i < byAccess.size() && m_size > lowSize; ++i) {
+    EntriesMap::iterator jt = byAccess[i].second;
+
+    QFile::remove(entryPath(jt->first).getQString());
+    m_size -= jt->second.m_size;
+    m_entries.erase(jt);
+  }
+}
+
+//****************************************************************************
+//    TPersistentRenderCache  implementation
+//****************************************************************************
+
+TPersistentRenderCache::TPersistentRenderCache() : m_imp(new Imp) {}
+
+//-----------------------------------------------------------------------
+
+TPersistentRenderCache::~TPersistentRenderCache() {}
+
+//-----------------------------------------------------------------------
+
+TPersistentRenderCache *TPersistentRenderCache::instance() {
+  static TPersistentRenderCache theInstance;
+  return &theInstance;
+}
+
+//-----------------------------------------------------------------------
+
+void TPersistentRenderCache::setRoot(const TFilePath &root) {
+  QMutexLocker locker(&m_imp->m_mutex);
+
+  m_imp->m_enabled = false;
+  m_imp->m_root    = root;
+  m_imp->m_entries.clear();
+  m_imp->m_size    = 0;
+  m_imp->m_scanned = false;
+
+  if (root.isEmpty()) return;
+
+  if (!TFileStatus(root).doesExist()) {
+    try {
+      TSystem::mkDir(root);
+    } catch (...) {
+      return;
+    }
+  }
+
+  m_imp->m_enabled = TFileStatus(root).isWritableDir();
+}
+
+//-----------------------------------------------------------------------
+
+TFilePath TPersistentRenderCache::getRoot() const {
+  QMutexLocker locker(&m_imp->m_mutex);
+  return m_imp->m_root;
+}
+
+//-----------------------------------------------------------------------
+
+bool TPersistentRenderCache::isEnabled() const { return m_imp->m_enabled; }
+
+//-----------------------------------------------------------------------
+
+void TPersistentRenderCache::setMaximumSize(int sizeMB) {
+  QMutexLocker locker(&m_imp->m_mutex);
+
+  m_imp->m_maxSizeMB = std::max(sizeMB, 0);
+  if (m_imp->m_enabled) {
+    m_imp->scan();
+    m_imp->purge();
+  }
+}
+
+//-----------------------------------------------------------------------
+
+int TPersistentRenderCache::getMaximumSize() const {
+  return m_imp->m_maxSizeMB;
+}
+
+//-----------------------------------------------------------------------
+
+void TPersistentRenderCache::setMinimumComputeTime(int ms) {
+  m_imp->m_minComputeTime = ms;
+}
+
+//-----------------------------------------------------------------------
+
+int TPersistentRenderCache::getMinimumComputeTime() const {
+  return m_imp->m_minComputeTime;
+}
+
+//-----------------------------------------------------------------------
+
+std::string TPersistentRenderCache::fileStamp(const TFilePath &decodedPath,
+                                              bool isDirty) const {
+  if (isDirty) return volatileStamp;
+
+  TFileStatus fs(decodedPath);
+  if (!fs.doesExist()) return volatileStamp;
+
+  return "{" +
+         std::to_string(fs.getLastModificationTime().toMSecsSinceEpoch()) +
+         "," + std::to_string(fs.getSize()) + "}";
+}
+
+//-----------------------------------------------------------------------
+
+std::string TPersistentRenderCache::getKey(const std::string &alias,
+                                           const TRenderSettings &rs,
+                                           const TTile &tile) const {
+  if (alias.empty() || alias.find(volatileStamp) != std::string::npos)
+    return std::string();
+
+  TRasterP ras(tile.getRaster());
+  int type = rasterType(ras);
+  if (type == UNSUPPORTED) return std::string();
+
+  std::string desc = alias + "|" + rs.toString() + "|" +
+                     std::to_string(rs.m_stereoscopicShift) + "," +
+                     std::to_string(rs.m_getFullSizeBBox) + "|" +
+                     std::to_string(tile.m_pos.x) + "," +
+                     std::to_string(tile.m_pos.y) + "," +
+                     std::to_string(ras->getLx()) + "," +
+                     std::to_string(ras->getLy()) + "," +
+                     std::to_string(type);
+
+  return QCryptographicHash::hash(QByteArray(desc.data(), (int)desc.size()),
+                                  QCryptographicHash::Sha1)
+      .toHex()
+      .toStdString();
+}
+
+//-----------------------------------------------------------------------
+
+bool TPersistentRenderCache::load(const std::string &key, TTile &tile) {
+  if (key.empty() || !m_imp->m_enabled) return false;
+
+  TFilePath fp;
+  {
+    QMutexLocker locker(&m_imp->m_mutex);
+    m_imp->scan();
+
+    Imp::EntriesMap::iterator it = m_imp->m_entries.find(key);
+    if (it == m_imp->m_entries.end()) return false;
+
+    it->second.m_lastAccess = currentTime();
+    fp                      = m_imp->entryPath(key);
+  }
+
+  TRasterP ras(tile.getRaster());
+
+  QFile file(fp.getQString());
+  if (!file.open(QIODevice::ReadOnly)) return false;
+
+  EntryHeader header;
+  if (file.read((char *)&header, sizeof(EntryHeader)) != sizeof(EntryHeader) ||
+      header.m_magic != fileMagic || header.m_version != fileVersion ||
+      header.m_lx != ras->getLx() || header.m_ly != ras->getLy() ||
+      header.m_type != rasterType(ras) ||
+      (header.m_linear != 0) != ras->isLinear())
+    return false;
+
+  qint64 rowSize = qint64(ras->getLx()) * ras->getPixelSize();
+  bool ok        = true;
+
+  ras->lock();
+  for (int y = 0; ok && y < ras->getLy(); ++y)
+    ok = (file.read((char *)ras->getRawData(0, y), rowSize) == rowSize);
+  ras->unlock();
+
+  if (!ok) {
+    ras->clear();
+    return false;
+  }
+
+  file.close();
+
+  // Refresh the access time seen by later sessions
+  try {
+    TSystem::touchFile(fp);
+  } catch (...) {
+  }
+
+  return true;
+}
+
+//-----------------------------------------------------------------------
+
+void TPersistentRenderCache::save(const std::string &key, const TTile &tile) {
+  if (key.empty() || !m_imp->m_enabled) return;
+
+  TRasterP ras(tile.getRaster());
+
+  TFilePath fp;
+  {
+    QMutexLocker locker(&m_imp->m_mutex);
+    m_imp->scan();
+
+    if (m_imp->m_entries.count(key)) return;
+    fp = m_imp->entryPath(key);
+  }
+
+  // Write to a temporary file first, so that concurrent processes sharing
+  // the same folder never read a partially written entry
+  static std::atomic<unsigned int> tempCount(0);
+  QString tempPath = fp.getQString() + "." +
+                     QString::number(QCoreApplication::applicationPid()) +
+                     "." + QString::number(++tempCount) + ".tmp";
+
+  EntryHeader header = {fileMagic,       fileVersion,    ras->getLx(),
+                        ras->getLy(),    rasterType(ras), ras->isLinear()};
+
+  qint64 rowSize = qint64(ras->getLx()) * ras->getPixelSize();
+  bool ok;
+  {
+    QFile file(tempPath);
+    if (!file.open(QIODevice::WriteOnly)) return;
+
+    ok = (file.write((const char *)&header, sizeof(EntryHeader)) ==
+          sizeof(EntryHeader));
+
+    ras->lock();
+    for (int y = 0; ok && y < ras->getLy(); ++y)
+      ok = (file.write((const char *)ras->getRawData(0, y), rowSize) ==
+            rowSize);
+    ras->unlock();
+  }
+
+  if (!ok || !QFile::rename(tempPath, fp.getQString())) {
+    QFile::remove(tempPath);
+    return;
+  }
+
+  QMutexLocker locker(&m_imp->m_mutex);
+  if (m_imp->m_entries.count(key)) return;  // Saved by another thread
+
+  Imp::Entry &entry  = m_imp->m_entries[key];
+  entry.m_size       = sizeof(EntryHeader) + rowSize * ras->getLy();
+  entry.m_lastAccess = currentTime();
+
+  m_imp->m_size += entry.m_size;
+  m_imp->purge();
+}
+
+//-----------------------------------------------------------------------
+
+void TPersistentRenderCache::clear() {
+  QMutexLocker locker(&m_imp->m_mutex);
+  if (m_imp->m_root.isEmpty()) return;
+
+  m_imp->scan();
+
+  Imp::EntriesMap::iterator it;
+  for (it = m_imp->m_entries.begin(); it != m_imp->m_entries.end(); ++it)
+    QFile::remove(m_imp->entryPath(it->first).getQString());
+
+  m_imp->m_entries.clear();
+  m_imp->m_size = 0;
+}
@@ -0,0 +1,297 @@
+
+
+// TnzCore includes
+#include "tpixel.h"
+#include "timagecache.h"
+
+// TnzBase includes
+#include "trendertrace.h"
+
+// Qt includes
+#include <QMutex>
+
+// STD includes
+#include <map>
+#include <tuple>
+#include <vector>
+#include <algorithm>
+
+#include "trasterarena.h"
+
+//****************************************************************************
+//    Local namespace stuff
+//****************************************************************************
+
+namespace {
+
+// Rasters below this size are cheap to allocate and not worth recycling
+const TINT64 minRecycledSize = 256 << 10;
+
+//-----------------------------------------------------------------------
+
+//! Rounds up the specified height to a multiple of a power of 2 step, at most
+//! 1/16 of it - wasting less than 6.25% of each class raster, while letting
+//! slightly different requests share the same class. Widths are not rounded,
+//! since extracted rasters would otherwise have a wrap exceeding their width.
+int classHeight(int d) {
+  int step = 1;
+  while (step * 32 <= d) step <<= 1;
+
+  return (d + step - 1) / step * step;
+}
+
+//-----------------------------------------------------------------------
+
+TRasterP createRaster(const TDimension &size, int bpp) {
+  switch (bpp) {
+  case 32:
+    return TRaster32P(size);
+  case 64:
+    return TRaster64P(size);
+  case 128:
+    return TRasterFP(size);
+  default:
+    assert(false);
+  }
+
+  return TRasterP();
+}
+
+//-----------------------------------------------------------------------
+
+inline TINT64 rasterBytes(const TRasterP &ras) {
+  return TINT64(ras->getLx()) * ras->getLy() * ras->getPixelSize();
+}
+
+}  // namespace
+
+//****************************************************************************
+//    TRasterArena::Imp  definition
+//****************************************************************************
+
+class TRasterArena::Imp {
+public:
+  struct Slot {
+    TRasterP m_raster;
+    TINT64 m_lastUse;
+  };
+
+  //! Size classes are keyed by (lx, ly, bpp)
+  typedef std::tuple<int, int, int> ClassKey;
+  typedef std::map<ClassKey, std::vector<Slot>> ClassesMap;
+
+public:
+  QMutex m_mutex;
+
+  ClassesMap m_classes;
+  TINT64 m_tick;  //!< Incremented on each use, orders the slots by use
+
+  int m_maxIdleSizeMB;
+  Counters m_counters;
+
+public:
+  Imp() : m_tick(0), m_maxIdleSizeMB(256) {
+    m_counters.m_allocationsCount = m_counters.m_allocatedBytes = 0;
+    m_counters.m_recyclesCount = m_counters.m_directCount = 0;
+    m_counters.m_size = 0;
+  }
+
+  //! A slot is idle when the arena holds the only reference to its raster
+  static bool isIdle(const Slot &slot) {
+    return slot.m_raster->getRefCount() == 1;
+  }
+
+  void release(TINT64 maxIdleSize);
+};
+
+//-----------------------------------------------------------------------
+
+//! Releases the least recently used idle slots until their total size is
+//! below maxIdleSize. The mutex must be locked by the caller.
+void TRasterArena::Imp::release(TINT64 maxIdleSize) {
+  struct IdleSlot {
+    TINT64 m_lastUse;
+    ClassesMap::iterator m_class;
+    TRaster *m_raster;
+  };
+
+  std::vector<IdleSlot> idleSlots;
+  TINT64 idleSize = 0;
+
+  ClassesMap::iterator it;
+  for (it = m_classes.begin(); it != m_classes.end(); ++it)
+    for (const Slot &slot : it->second)
+      if (isIdle(slot)) {
+        IdleSlot idleSlot = {slot.m_lastUse, it, slot.m_raster.getPointer()};
+        idleSlots.push_back(idleSlot);
+        idleSize += rasterBytes(slot.m_raster);
+      }
+
+  if (idleSize <= maxIdleSize) return;
+
+  std::sort(idleSlots.begin(), idleSlots.end(),
+            [](const IdleSlot &a, const IdleSlot &b) {
+              return a.m_lastUse < b.m_lastUse;
+            });
+
+  unsigned int i;
+  for (i = 0; i < idleSlots.size() && idleSize > maxIdleSize; ++i) {
+    std::vector<Slot> &classSlots = idleSlots[i].m_class->second;
+
+    std::vector<Slot>::iterator jt = classSlots.begin();
+    while (jt->m_raster.getPointer() != idleSlots[i].m_raster) ++jt;
+
+    TINT64 bytes = rasterBytes(jt->m_raster);
+    idleSize -= bytes;
+    m_counters.m_size -= bytes;
+
+    classSlots.erase(jt);
+  }
+
+  for (it = m_classes.begin(); it != m_classes.end();)
+    if (it->second.empty())
+      m_classes.erase(it++);
+    else
+      ++it;
+}
+
+//****************************************************************************
+//    TRasterArena  implementation
+//****************************************************************************
+
+TRasterArena::TRasterArena() : m_imp(new Imp) {
+  // Idle rasters are invisible to the image cache: drop them first when
+  // memory runs short
+  TImageCache::instance()->addMemoryPressureHandler(
+      []() { TRasterArena::instance()->clear(); });
+}
+
+//-----------------------------------------------------------------------
+
+TRasterArena::~TRasterArena() {}
+
+//-----------------------------------------------------------------------
+
+TRasterArena *TRasterArena::instance() {
+  static TRasterArena theInstance;
+  return &theInstance;
+}
+
+//-----------------------------------------------------------------------
+
+TRasterP TRasterArena::getRaster(const TDimension &size, int bpp) {
+  assert(size.lx > 0 && size.ly > 0);
+
+  if (TINT64(size.lx) * size.ly * (bpp >> 3) < minRecycledSize) {
+    {
+      QMutexLocker locker(&m_imp->m_mutex);
+      ++m_imp->m_counters.m_directCount;
+    }
+
+    return createRaster(size, bpp);
+  }
+
+  TDimension classSize(size.lx, classHeight(size.ly));
+  Imp::ClassKey key(classSize.lx, classSize.ly, bpp);
+
+  TRasterP classRas;
+  {
+    QMutexLocker locker(&m_imp->m_mutex);
+
+    Imp::ClassesMap::iterator it = m_imp->m_classes.find(key);
+    if (it != m_imp->m_classes.end()) {
+      for (Imp::Slot &slot : it->second)
+        if (Imp::isIdle(slot)) {
+          // Referencing the raster under lock makes it busy for other threads
+          classRas       = slot.m_raster;
+          slot.m_lastUse = ++m_imp->m_tick;
+          break;
+        }
+    }
+
+    if (classRas) {
+      ++m_imp->m_counters.m_recyclesCount;
+      classRas->setLinear(false);
+    }
+  }
+
+  if (classRas) {
+    if (classSize == size) {
+      classRas->clear();
+      return classRas;
+    }
+
+    TRasterP ras(classRas->extract(0, 0, size.lx - 1, size.ly - 1));
+    ras->clear();
+    return ras;
+  }
+
+  // Allocate a new class raster outside the lock - new rasters are already
+  // cleared
+  classRas = createRaster(classSize, bpp);
+  if (!classRas) return TRasterP();
+
+  TINT64 bytes = rasterBytes(classRas);
+
+  TRenderTrace *trace = TRenderTrace::instance();
+  if (trace->isEnabled())
+    trace->addInstantEvent("Allocate raster", "memory",
+                           TRenderTrace::arg("lx", classSize.lx) + "," +
+                               TRenderTrace::arg("ly", classSize.ly) + "," +
+                               TRenderTrace::arg("bytes", bytes));
+
+  {
+    QMutexLocker locker(&m_imp->m_mutex);
+
+    Imp::Slot slot = {classRas, ++m_imp->m_tick};
+    m_imp->m_classes[key].push_back(slot);
+
+    ++m_imp->m_counters.m_allocationsCount;
+    m_imp->m_counters.m_allocatedBytes += bytes;
+    m_imp->m_counters.m_size += bytes;
+
+    // Growing the arena may have pushed the idle rasters above the limit
+    m_imp->release(TINT64(m_imp->m_maxIdleSizeMB) << 20);
+  }
+
+  return (classSize == size)
+             ? classRas
+             : classRas->extract(0, 0, size.lx - 1, size.ly - 1);
+}
+
+//-----------------------------------------------------------------------
+
+void TRasterArena::setMaximumIdleSize(int sizeMB) {
+  QMutexLocker locker(&m_imp->m_mutex);
+
+  m_imp->m_maxIdleSizeMB = std::max(sizeMB, 0);
+  m_imp->release(TINT64(m_imp->m_maxIdleSizeMB) << 20);
+}
+
+//-----------------------------------------------------------------------
+
+int TRasterArena::getMaximumIdleSize() const {
+  QMutexLocker locker(&m_imp->m_mutex);
+  return m_imp->m_maxIdleSizeMB;
+}
+
+//-----------------------------------------------------------------------
+
+void TRasterArena::trim() {
+  QMutexLocker locker(&m_imp->m_mutex);
+  m_imp->release(TINT64(m_imp->m_maxIdleSizeMB) << 20);
+}
+
+//-----------------------------------------------------------------------
+
+void TRasterArena::clear() {
+  QMutexLocker locker(&m_imp->m_mutex);
+  m_imp->release(0);
+}
+
+//-----------------------------------------------------------------------
+
+TRasterArena::Counters TRasterArena::getCounters() const {
+  QMutexLocker locker(&m_imp->m_mutex);
+  return m_imp->m_counters;
+}
@@ -17,6 +17,8 @@
 // TnzBase includes
 #include "trenderresourcemanager.h"
 #include "tpredictivecachemanager.h"
+#include "trendertrace.h"
+#include "trasterarena.h"
 
 // Qt includes
 #include <QEventLoop>
@@ -25,13 +27,18 @@
 #include <QReadLocker>
 #include <QWriteLocker>
 #include <QThreadStorage>
+#include <QMutex>
+#include <QWaitCondition>
 
 // Debug
 // #define DIAGNOSTICS
 // #include "diagnostics.h"
 
 #include <queue>
+#include <deque>
 #include <functional>
+#include <atomic>
+#include <exception>
 
 #include <QOffscreenSurface>
 #include <QSurfaceFormat>
@@ -57,6 +64,16 @@ QThreadStorage<unsigned long *> renderIdsStorage;
 
 //-------------------------------------------------------------------------------
 
+// Lets raster operations split their work among the subtask threads - both
+// inside render processes and in the viewers.
+struct SubtasksRunnerInstaller {
+  SubtasksRunnerInstaller() {
+    TRop::setSubtasksRunner(&TRenderer::runSubtasks);
+  }
+} subtasksRunnerInstaller;
+
+//-------------------------------------------------------------------------------
+
 // Interlacing functions for field-based rendering
 inline void interlace(TRasterP f0, const TRasterP &f1, int field) {
   if (f0->getPixelSize() != f1->getPixelSize())
@@ -89,192 +106,6 @@ inline void interlace(TRasterP f0, const TRasterP &f1, int field) {
 }
 }  // anonymous namespace
 
-//================================================================================
-//    Preliminaries - output rasters management
-//================================================================================
-
-//===================
-//    RasterItem
-//-------------------
-
-//! The RasterItem class represents a reusable output raster for rendering
-//! purposes.
-//! RasterItems are used as TRenderer's output rasters in order to avoid the
-//! overhead
-//! of allocating one raster for each rendered frame.
-//! Each frame-rendering task will lock a RasterItem as preallocated output
-//! before starting the
-//! render, therefore changing the \b RasterItem::m_busy attribute accordingly.
-//! As each frame is rendered on a separate thread, the number of RasterItems
-//! that
-//! TRenderer will allocate depends on the number of rendering threads specified
-//! to it.
-
-//! \sa RasterPool, TRenderer classes
-
-class RasterItem {
-  std::string m_rasterId;
-
-public:
-  int m_bpp;
-  bool m_busy;
-
-  //---------------------------------------------------------
-
-  RasterItem(const TDimension &size, int bpp, bool busyFlag)
-      : m_rasterId(""), m_bpp(bpp), m_busy(busyFlag) {
-    TRasterP raster;
-    if (bpp == 32)
-      raster = TRaster32P(size);
-    else if (bpp == 64)
-      raster = TRaster64P(size);
-    else if (bpp == 128)
-      raster = TRasterFP(size);
-    else
-      assert(false);
-
-    m_rasterId = TImageCache::instance()->getUniqueId();
-    TImageCache::instance()->add(m_rasterId, TRasterImageP(raster));
-  }
-
-  //---------------------------------------------------------
-
-  ~RasterItem() { TImageCache::instance()->remove(m_rasterId); }
-
-  //---------------------------------------------------------
-
-  TRasterP getRaster() const {
-    TRasterImageP rimg =
-        (TRasterImageP)TImageCache::instance()->get(m_rasterId, true);
-    return rimg ? rimg->getRaster() : TRasterP();
-  }
-
-private:
-  // not implemented
-  RasterItem();
-  RasterItem(const TRaster &RasterItem);
-};
-
-//================================================================================
-
-//===================
-//    RasterPool
-//-------------------
-
-//! Stores a list of RasterItems under TRenderer's requests.
-class RasterPool {
-  TDimension m_size;
-  int m_bpp;
-
-  typedef std::list<RasterItem *> RasterRepository;
-  RasterRepository m_rasterRepository;
-
-  TThread::Mutex m_repositoryLock;
-
-public:
-  RasterPool() : m_size(-1, -1) {}
-  ~RasterPool();
-
-  void setRasterSpecs(const TDimension &size, int bpp);
-  void getRasterSpecs(TDimension &size, int &bpp) {
-    size = m_size;
-    bpp  = m_bpp;
-  }
-
-  TRasterP getRaster();
-  TRasterP getRaster(const TDimension &size, int bpp);
-
-  void releaseRaster(const TRasterP &r);
-
-  void clear();
-};
-
-//---------------------------------------------------------
-
-void RasterPool::clear() {
-  QMutexLocker sl(&m_repositoryLock);
-  clearPointerContainer(m_rasterRepository);
-}
-
-//---------------------------------------------------------
-
-void RasterPool::setRasterSpecs(const TDimension &size, int bpp) {
-  if (size != m_size || bpp != m_bpp) {
-    m_size = size;
-    m_bpp  = bpp;
-    clear();
-  }
-}
-
-//---------------------------------------------------------
-
-TRasterP RasterPool::getRaster(const TDimension &size, int bpp) {
-  assert(size == m_size && bpp == m_bpp);
-  return getRaster();
-}
-
-//---------------------------------------------------------
-
-//! Returns for the first not-busy raster
-TRasterP RasterPool::getRaster() {
-  QMutexLocker sl(&m_repositoryLock);
-
-  RasterRepository::iterator it = m_rasterRepository.begin();
-  while (it != m_rasterRepository.end()) {
-    RasterItem *rasItem = *it;
-    if (rasItem->m_busy == false) {
-      TRasterP raster = rasItem->getRaster();
-
-      if (!raster) {
-        delete rasItem;
-        m_rasterRepository.erase(it++);
-        continue;
-      }
-
-      rasItem->m_busy = true;
-      raster->clear();
-      return raster;
-    }
-
-    ++it;
-  }
-
-  RasterItem *rasItem = new RasterItem(m_size, m_bpp, true);
-  m_rasterRepository.push_back(rasItem);
-
-  return rasItem->getRaster();
-}
-
-//---------------------------------------------------------
-
-//! Cerca il raster \b r in m_rasterRepository; se lo trova setta a \b false il
-//! campo \b m_busy.
-void RasterPool::releaseRaster(const TRasterP &r) {
-  if (!r) return;
-
-  QMutexLocker sl(&m_repositoryLock);
-  for (RasterRepository::iterator it = m_rasterRepository.begin();
-       it != m_rasterRepository.end(); ++it) {
-    RasterItem *rasItem = *it;
-    if (rasItem->getRaster()->getRawData() == r->getRawData()) {
-      assert(rasItem->m_busy);
-      rasItem->m_busy = false;
-      return;
-    }
-  }
-}
-
-//---------------------------------------------------------
-
-RasterPool::~RasterPool() {
-  /*if (m_rasterRepository.size())
-TSystem::outputDebug("~RasterPool: itemCount = " + toString
-((int)m_rasterRepository.size())+" (should be 0)\n");*/
-
-  // Release all raster items
-  clear();
-}
-
 //================================================================================
 //    Internal rendering classes declaration
 //================================================================================
@@ -317,7 +148,6 @@ public:
   Executor m_executor;
 
   bool m_precomputingEnabled;
-  RasterPool m_rasterPool;
 
   std::vector<TRenderResourceManager *> m_managers;
 
@@ -425,6 +255,310 @@ public:
   void onFinished(TThread::RunnableP) override;
 };
 
+//================================================================================
+
+//===================
+//    SubtaskPool
+//-------------------
+
+/*!
+  The SubtaskPool executes independent parts of a frame computation (typically
+  the input branches of an fx) on a set of worker threads, so that a single
+  frame can be rendered using more than one core.
+
+  Each worker owns a task deque: subtasks spawned by a worker are pushed on
+  its own deque and popped back in LIFO order, while idle workers steal from
+  the other deques' front. Subtasks spawned by ordinary render threads go to
+  a shared injection deque.
+
+  The thread spawning a group of subtasks claims and executes any of them
+  that was not already picked up by a worker before waiting for the others -
+  so nested spawns can never wait on a subtask that nobody is executing.
+
+  Subtasks are spawned only while the busy render threads are less than the
+  available cores - batch renders already saturating them through frame-level
+  parallelism just execute the subtasks in sequence.
+*/
+class SubtaskPool {
+  struct Group {
+    QMutex m_mutex;
+    QWaitCondition m_done;
+    int m_pending;
+    std::exception_ptr m_exception;
+
+    TRendererImpP m_rendererImp;
+    unsigned long m_renderId;
+
+    Group() : m_pending(0), m_renderId((unsigned long)-1) {}
+  };
+
+  //! Shared with the subtasks: a worker may still be releasing the group's
+  //! mutex after its last subtask woke the spawning thread up
+  typedef std::shared_ptr<Group> GroupP;
+
+  struct Subtask {
+    std::function<void()> m_func;
+    GroupP m_group;
+    std::atomic<bool> m_claimed;
+
+    Subtask(const std::function<void()> &func, const GroupP &group)
+        : m_func(func), m_group(group), m_claimed(false) {}
+  };
+
+  typedef std::shared_ptr<Subtask> SubtaskP;
+
+  struct Queue {
+    QMutex m_mutex;
+    std::deque<SubtaskP> m_tasks;
+  };
+
+  class Worker final : public QThread {
+    SubtaskPool *m_pool;
+    int m_index;
+
+  public:
+    Worker(SubtaskPool *pool, int index) : m_pool(pool), m_index(index) {}
+    void run() override { m_pool->workerLoop(m_index); }
+  };
+
+  //! Queue 0 is the injection one, queue i > 0 belongs to worker i
+  std::vector<std::unique_ptr<Queue>> m_queues;
+  std::vector<Worker *> m_workers;
+
+  QMutex m_sleepMutex;
+  QWaitCondition m_wake;
+  std::atomic<int> m_queuedCount;
+  std::atomic<bool> m_quit;
+
+  int m_threadsCount;
+  std::atomic<int> m_busyThreads;
+
+  static thread_local int m_currentWorker;
+
+public:
+  SubtaskPool();
+  ~SubtaskPool();
+
+  static SubtaskPool *instance() {
+    static SubtaskPool theInstance;
+    return &theInstance;
+  }
+
+  //! Declares that the invoking thread is (or is no longer) busy rendering
+  void addBusyThreads(int count) { m_busyThreads += count; }
+  int idleThreadsCount() const {
+    return std::max(m_threadsCount - m_busyThreads, 0);
+  }
+
+  void run(const std::vector<std::function<void()>> &funcs);
+
+private:
+  void start();
+  void push(const SubtaskP &task);
+  SubtaskP take(int index);
+  void execute(const SubtaskP &task);
+  void workerLoop(int index);
+};
+
+thread_local int SubtaskPool::m_currentWorker = 0;
+
+//---------------------------------------------------------
+
+SubtaskPool::SubtaskPool()
+    : m_queuedCount(0)
+    , m_quit(false)
+    , m_threadsCount(QThread::idealThreadCount())
+    , m_busyThreads(0) {}
+
+//---------------------------------------------------------
+
+SubtaskPool::~SubtaskPool() {
+  m_quit = true;
+  {
+    QMutexLocker sl(&m_sleepMutex);
+    m_wake.wakeAll();
+  }
+
+  for (Worker *worker : m_workers) {
+    worker->wait();
+    delete worker;
+  }
+}
+
+//---------------------------------------------------------
+
+void SubtaskPool::start() {
+  // The invoking render thread accounts for one core
+  int workersCount = m_threadsCount - 1;
+
+  m_queues.emplace_back(new Queue);
+  for (int i = 1; i <= workersCount; ++i) {
+    m_queues.emplace_back(new Queue);
+    m_workers.push_back(new Worker(this, i));
+  }
+
+  for (Worker *worker : m_workers) worker->start();
+}
+
+//---------------------------------------------------------
+
+void SubtaskPool::push(const SubtaskP &task) {
+  Queue &queue = *m_queues[m_currentWorker];
+  {
+    QMutexLocker sl(&queue.m_mutex);
+    queue.m_tasks.push_back(task);
+  }
+
+  ++m_queuedCount;
+
+  QMutexLocker sl(&m_sleepMutex);
+  m_wake.wakeOne();
+}
+
+//---------------------------------------------------------
+
+SubtaskPool::SubtaskP SubtaskPool::take(int index) {
+  SubtaskP task;
+
+  // Own tasks first, most recent ones on top
+  {
+    Queue &queue = *m_queues[index];
+    QMutexLocker sl(&queue.m_mutex);
+    if (!queue.m_tasks.empty()) {
+      task = queue.m_tasks.back();
+      queue.m_tasks.pop_back();
+    }
+  }
+
+  // Then steal the oldest tasks from the injection queue and other workers
+  int i, queuesCount = m_queues.size();
+  for (i = 0; !task && i < queuesCount; ++i) {
+    if (i == index) continue;
+
+    Queue &queue = *m_queues[i];
+    QMutexLocker sl(&queue.m_mutex);
+    if (!queue.m_tasks.empty()) {
+      task = queue.m_tasks.front();
+      queue.m_tasks.pop_front();
+    }
+  }
+
+  if (task) --m_queuedCount;
+  return task;
+}
+
+//---------------------------------------------------------
+
+void SubtaskPool::execute(const SubtaskP &task) {
+  if (task->m_claimed.exchange(true)) return;
+
+  GroupP group = task->m_group;
+
+  // Install the spawning thread's render process, if any
+  if (group->m_rendererImp) {
+    rendererStorage.setLocalData(
+        new (TRendererImp *)(group->m_rendererImp.getPointer()));
+    renderIdsStorage.setLocalData(new unsigned long(group->m_renderId));
+  }
+
+  ++m_busyThreads;
+
+  std::exception_ptr exception;
+  try {
+    task->m_func();
+  } catch (...) {
+    exception = std::current_exception();
+  }
+
+  --m_busyThreads;
+
+  rendererStorage.setLocalData(0);
+  renderIdsStorage.setLocalData(0);
+
+  QMutexLocker sl(&group->m_mutex);
+  if (exception && !group->m_exception) group->m_exception = exception;
+  if (--group->m_pending == 0) group->m_done.wakeAll();
+}
+
+//---------------------------------------------------------
+
+void SubtaskPool::workerLoop(int index) {
+  m_currentWorker = index;
+
+  while (!m_quit) {
+    SubtaskP task = take(index);
+    if (task) {
+      execute(task);
+      continue;
+    }
+
+    QMutexLocker sl(&m_sleepMutex);
+    if (m_queuedCount == 0 && !m_quit) m_wake.wait(&m_sleepMutex);
+  }
+}
+
+//---------------------------------------------------------
+
+void SubtaskPool::run(const std::vector<std::function<void()>> &funcs) {
+  TRendererImp **rendererImp = rendererStorage.localData();
+
+  if (funcs.size() < 2 || idleThreadsCount() == 0) {
+    for (const std::function<void()> &func : funcs) func();
+    return;
+  }
+
+  {
+    static QMutex startMutex;
+    QMutexLocker sl(&startMutex);
+    if (m_queues.empty()) start();
+  }
+
+  GroupP group = std::make_shared<Group>();
+  if (rendererImp) group->m_rendererImp = *rendererImp;
+  group->m_renderId = TRenderer::renderId();
+
+  // Spawn all the functions but the first, which is executed right away
+  std::vector<SubtaskP> tasks;
+  tasks.reserve(funcs.size() - 1);
+
+  group->m_pending = funcs.size() - 1;
+  for (unsigned int i = 1; i < funcs.size(); ++i) {
+    tasks.push_back(std::make_shared<Subtask>(funcs[i], group));
+    push(tasks.back());
+  }
+
+  std::exception_ptr exception;
+  try {
+    funcs[0]();
+  } catch (...) {
+    exception = std::current_exception();
+  }
+
+  // Execute the subtasks nobody picked up in the meantime
+  for (const SubtaskP &task : tasks) {
+    if (task->m_claimed.exchange(true)) continue;
+
+    try {
+      task->m_func();
+    } catch (...) {
+      if (!exception) exception = std::current_exception();
+    }
+
+    QMutexLocker sl(&group->m_mutex);
+    --group->m_pending;
+  }
+
+  // Wait for those being executed by the workers
+  {
+    QMutexLocker sl(&group->m_mutex);
+    while (group->m_pending > 0) group->m_done.wait(&group->m_mutex);
+
+    if (!exception) exception = group->m_exception;
+  }
+
+  if (exception) std::rethrow_exception(exception);
+}
+
 //================================================================================
 //    Implementations
 //================================================================================
@@ -614,6 +748,25 @@ void TRenderer::setThreadsCount(int nThreads) {
 
 //---------------------------------------------------------
 
+//! Executes the passed functions, concurrently if there are cores left idle
+//! by the active render processes, and returns when all of them completed.
+//! Exceptions thrown by the functions are rethrown here. Subtasks spawned
+//! from inside a rendering thread belong to its render process.
+void TRenderer::runSubtasks(const std::vector<std::function<void()>> &funcs) {
+  SubtaskPool::instance()->run(funcs);
+}
+
+//---------------------------------------------------------
+
+//! Returns the number of cores currently left idle by the active render
+//! processes - that is, how many subtasks could be run concurrently with the
+//! invoking thread by runSubtasks().
+int TRenderer::idleThreadsCount() {
+  return SubtaskPool::instance()->idleThreadsCount();
+}
+
+//---------------------------------------------------------
+
 void TRenderer::addPort(TRenderPort *port) { m_imp->addPort(port); }
 
 //---------------------------------------------------------
@@ -900,8 +1053,7 @@ TRenderPort::~TRenderPort() {}
 
 //---------------------------------------------------------
 
-//! Setta \b m_renderArea a \b area e pulisce l'istanza corrente di \b
-//! RasterPool.
+//! Setta \b m_renderArea a \b area.
 void TRenderPort::setRenderArea(const TRectD &area) { m_renderArea = area; }
 
 //---------------------------------------------------------
@@ -973,6 +1125,9 @@ void RenderTask::run() {
       new (TRendererImp *)(m_rendererImp.getPointer()));
   renderIdsStorage.setLocalData(new unsigned long(m_renderId));
 
+  SubtaskPool *subtaskPool = SubtaskPool::instance();
+  subtaskPool->addBusyThreads(1);
+
   // Inform the managers of frame start
   m_rendererImp->declareFrameStart(t);
 
@@ -981,6 +1136,14 @@ void RenderTask::run() {
     if (fx) const_cast<TFx *>(fx)->callStartRenderFrameHandler(&m_info, t);
   }
 
+  TRenderTrace::Scope traceScope("frame");
+  if (traceScope.isActive()) {
+    traceScope.setName("Frame");
+    traceScope.addArg("frame", QString::number(t + 1).toStdString());
+    traceScope.addArg("lx", m_frameSize.lx);
+    traceScope.addArg("ly", m_frameSize.ly);
+  }
+
   try {
     onFrameStarted();
 
@@ -1031,6 +1194,25 @@ void RenderTask::run() {
   // Inform the managers of frame end
   m_rendererImp->declareFrameEnd(t);
 
+  if (traceScope.isActive()) {
+    TImageCache::Statistics cacheStats =
+        TImageCache::instance()->getStatistics();
+
+    TRenderTrace::instance()->addCounterEvent(
+        "Image cache (KB)", TImageCache::instance()->getMemUsage());
+    TRenderTrace::instance()->addCounterEvent(
+        "Image cache compressed (KB)", cacheStats.m_compressedBytes >> 10);
+    TRenderTrace::instance()->addCounterEvent(
+        "Image cache spilled (KB)", cacheStats.m_spilledBytes >> 10);
+    TRenderTrace::instance()->addCounterEvent("Image cache stalls (ms)",
+                                              cacheStats.m_stallTime);
+    TRenderTrace::instance()->addCounterEvent(
+        "Raster arena (KB)",
+        TRasterArena::instance()->getCounters().m_size >> 10);
+  }
+
+  subtaskPool->addBusyThreads(-1);
+
   // Uninstall the renderer from current thread
   rendererStorage.setLocalData(0);
   renderIdsStorage.setLocalData(0);
@@ -1045,20 +1227,18 @@ void RenderTask::run() {
 void RenderTask::buildTile(TTile &tile) {
   tile.m_pos = m_framePos;
   tile.setRaster(
-      m_rendererImp->m_rasterPool.getRaster(m_frameSize, m_info.m_bpp));
+      TRasterArena::instance()->getRaster(m_frameSize, m_info.m_bpp));
   // set the linear flag
   tile.getRaster()->setLinear(m_info.m_linearColorSpace);
 }
 
 //---------------------------------------------------------
 
+//! Releases the frame rasters, which return to the raster arena as soon as
+//! the render ports release them too.
 void RenderTask::releaseTiles() {
-  m_rendererImp->m_rasterPool.releaseRaster(m_tileA.getRaster());
   m_tileA.setRaster(TRasterP());
-  if (m_fieldRender || m_stereoscopic) {
-    m_rendererImp->m_rasterPool.releaseRaster(m_tileB.getRaster());
-    m_tileB.setRaster(TRasterP());
-  }
+  if (m_fieldRender || m_stereoscopic) m_tileB.setRaster(TRasterP());
 }
 
 //---------------------------------------------------------
@@ -1153,9 +1333,10 @@ void RenderTask::onFinished(TThread::RunnableP) {
     rendererStorage.setLocalData(0);
     renderIdsStorage.setLocalData(0);
 
-    rendererImp->m_rasterPool
-        .clear();  // Isn't this misplaced? Should be in the block
-  }                // below...
+    // Release the idle rasters in excess - the others are kept for the
+    // next renders
+    TRasterArena::instance()->trim();
+  }
 
   // If no rendering task (of this or other render instances) is found...
   if (rendererImp->m_undoneTasks == 0) {
@@ -1360,9 +1541,6 @@ void TRendererImp::startRendering(
   TRectD camBox(TPointD(pos.x / info.m_shrinkX, pos.y / info.m_shrinkY),
                 TDimensionD(frameSize.lx, frameSize.ly));
 
-  // Refresh the raster pool specs
-  m_rasterPool.setRasterSpecs(frameSize, info.m_bpp);
-
   // Set a temporary active instance count - so that hasToDie(renderId) returns
   // false
   RenderInstanceInfos *renderInfos;
@@ -0,0 +1,259 @@
+
+
+// TnzCore includes
+#include "tconvert.h"
+
+// Qt includes
+#include <QMutex>
+#include <QFile>
+#include <QElapsedTimer>
+#include <QCoreApplication>
+
+// STD includes
+#include <cstdlib>
+#include <set>
+#include <vector>
+
+#include "trendertrace.h"
+
+//****************************************************************************
+//    Local namespace stuff
+//****************************************************************************
+
+namespace {
+
+// Small, stable ids are easier to read in trace viewers than native ones
+int currentThreadId() {
+  static std::atomic<int> threadsCount(0);
+  thread_local int threadId = ++threadsCount;
+
+  return threadId;
+}
+
+//-----------------------------------------------------------------------
+
+std::string escaped(const std::string &str) {
+  std::string result;
+  result.reserve(str.size());
+
+  for (char c : str) {
+    switch (c) {
+    case '"':
+      result += "\\\"";
+      break;
+    case '\\':
+      result += "\\\\";
+      break;
+    case '\n':
+      result += "\\n";
+      break;
+    case '\t':
+      result += "\\t";
+      break;
+    default:
+      if ((unsigned char)c >= 0x20) result += c;
+    }
+  }
+
+  return result;
+}
+
+}  // namespace
+
+//****************************************************************************
+//    TRenderTrace::Imp  definition
+//****************************************************************************
+
+class TRenderTrace::Imp {
+public:
+  QMutex m_mutex;
+
+  TFilePath m_path;
+  QElapsedTimer m_timer;
+  qint64 m_pid;
+
+  std::vector<std::string> m_events;  //!< Already JSON-formatted events
+  std::set<int> m_namedThreads;
+
+public:
+  Imp() : m_pid(QCoreApplication::applicationPid()) {}
+
+  void addEvent(std::string &&event, int threadId);
+};
+
+//-----------------------------------------------------------------------
+
+void TRenderTrace::Imp::addEvent(std::string &&event, int threadId) {
+  QMutexLocker locker(&m_mutex);
+
+  if (m_namedThreads.insert(threadId).second)
+    m_events.push_back(
+        "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":" +
+        std::to_string(m_pid) + ",\"tid\":" + std::to_string(threadId) +
+        ",\"args\":{\"name\":\"Thread " + std::to_string(threadId) + "\"}}");
+
+  m_events.push_back(std::move(event));
+}
+
+//****************************************************************************
+//    TRenderTrace::Scope  implementation
+//****************************************************************************
+
+TRenderTrace::Scope::Scope(const char *category)
+    : m_category(category)
+    , m_begin(0)
+    , m_active(TRenderTrace::instance()->isEnabled()) {
+  if (m_active) m_begin = TRenderTrace::instance()->now();
+}
+
+//-----------------------------------------------------------------------
+
+TRenderTrace::Scope::~Scope() {
+  if (!m_active) return;
+
+  TRenderTrace *trace = TRenderTrace::instance();
+  trace->addCompleteEvent(m_name, m_category, m_begin, trace->now(), m_args);
+}
+
+//-----------------------------------------------------------------------
+
+void TRenderTrace::Scope::addArg(const std::string &name,
+                                 const std::string &value) {
+  if (!m_args.empty()) m_args += ",";
+  m_args += TRenderTrace::arg(name, value);
+}
+
+//-----------------------------------------------------------------------
+
+void TRenderTrace::Scope::addArg(const std::string &name, TINT64 value) {
+  if (!m_args.empty()) m_args += ",";
+  m_args += TRenderTrace::arg(name, value);
+}
+
+//****************************************************************************
+//    TRenderTrace  implementation
+//****************************************************************************
+
+TRenderTrace::TRenderTrace() : m_imp(new Imp), m_enabled(false) {
+  const char *path = std::getenv("TOONZ_RENDER_TRACE");
+  if (path && *path) start(TFilePath(path));
+}
+
+//-----------------------------------------------------------------------
+
+TRenderTrace::~TRenderTrace() { stop(); }
+
+//-----------------------------------------------------------------------
+
+TRenderTrace *TRenderTrace::instance() {
+  static TRenderTrace theInstance;
+  return &theInstance;
+}
+
+//-----------------------------------------------------------------------
+
+void TRenderTrace::start(const TFilePath &path) {
+  QMutexLocker locker(&m_imp->m_mutex);
+
+  m_imp->m_path = path;
+  m_imp->m_events.clear();
+  m_imp->m_namedThreads.clear();
+  m_imp->m_timer.start();
+
+  m_enabled = true;
+}
+
+//-----------------------------------------------------------------------
+
+bool TRenderTrace::stop() {
+  QMutexLocker locker(&m_imp->m_mutex);
+
+  if (!m_enabled) return true;
+  m_enabled = false;
+
+  QFile file(m_imp->m_path.getQString());
+  if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate)) return false;
+
+  std::string contents = "{\"traceEvents\":[\n";
+
+  std::vector<std::string>::iterator it, end = m_imp->m_events.end();
+  for (it = m_imp->m_events.begin(); it != end; ++it) {
+    if (it != m_imp->m_events.begin()) contents += ",\n";
+    contents += *it;
+  }
+
+  contents += "\n],\"displayTimeUnit\":\"ms\"}\n";
+
+  m_imp->m_events.clear();
+
+  return file.write(contents.data(), contents.size()) ==
+         (qint64)contents.size();
+}
+
+//-----------------------------------------------------------------------
+
+TINT64 TRenderTrace::now() const {
+  return m_imp->m_timer.nsecsElapsed() / 1000;
+}
+
+//-----------------------------------------------------------------------
+
+std::string TRenderTrace::arg(const std::string &name,
+                              const std::string &value) {
+  return "\"" + escaped(name) + "\":\"" + escaped(value) + "\"";
+}
+
+//-----------------------------------------------------------------------
+
+std::string TRenderTrace::arg(const std::string &name, TINT64 value) {
+  return "\"" + escaped(name) + "\":" + std::to_string(value);
+}
+
+//-----------------------------------------------------------------------
+
+void TRenderTrace::addCompleteEvent(const std::string &name,
+                                    const char *category, TINT64 begin,
+                                    TINT64 end, const std::string &args) {
+  if (!m_enabled) return;
+
+  int threadId = currentThreadId();
+  m_imp->addEvent("{\"name\":\"" + escaped(name) + "\",\"cat\":\"" +
+                      category + "\",\"ph\":\"X\",\"ts\":" +
+                      std::to_string(begin) +
+                      ",\"dur\":" + std::to_string(end - begin) +
+                      ",\"pid\":" + std::to_string(m_imp->m_pid) +
+                      ",\"tid\":" + std::to_string(threadId) + ",\"args\":{" +
+                      args + "}}",
+                  threadId);
+}
+
+//-----------------------------------------------------------------------
+
+void TRenderTrace::addInstantEvent(const std::string &name,
+                                   const char *category,
+                                   const std::string &args) {
+  if (!m_enabled) return;
+
+  int threadId = currentThreadId();
+  m_imp->addEvent("{\"name\":\"" + escaped(name) + "\",\"cat\":\"" +
+                      category + "\",\"ph\":\"i\",\"s\":\"t\",\"ts\":" +
+                      std::to_string(now()) +
+                      ",\"pid\":" + std::to_string(m_imp->m_pid) +
+                      ",\"tid\":" + std::to_string(threadId) + ",\"args\":{" +
+                      args + "}}",
+                  threadId);
+}
+
+//-----------------------------------------------------------------------
+
+void TRenderTrace::addCounterEvent(const std::string &name, TINT64 value) {
+  if (!m_enabled) return;
+
+  int threadId = currentThreadId();
+  m_imp->addEvent("{\"name\":\"" + escaped(name) +
+                      "\",\"ph\":\"C\",\"ts\":" + std::to_string(now()) +
+                      ",\"pid\":" + std::to_string(m_imp->m_pid) +
+                      ",\"tid\":" + std::to_string(threadId) + ",\"args\":{" +
+                      arg("value", value) + "}}",
+                  threadId);
+}
@@ -252,6 +252,7 @@ void readRaster_copyLines(const TRasterPT<Pix> &ras, Tiio::Reader *reader,
   rgbm_pixel_type *lineIn = (rgbm_pixel_type *)lineBuffer;
 
   if (reader->getRowOrder() == Tiio::BOTTOM2TOP) {
+    reader->setReadRegion(x0, y0, x1, y1);
     int start = reader->skipLines(y0);
     int stop  = y1 + 1;
 
@@ -268,6 +269,7 @@ void readRaster_copyLines(const TRasterPT<Pix> &ras, Tiio::Reader *reader,
     }
   } else  // TOP2BOTTOM
   {
+    reader->setReadRegion(x0, inLy - 1 - y1, x1, inLy - 1 - y0);
     reader->skipLines(inLy - y1 - 1);
 
     for (int y = y1; y >= y0; --y) {
@@ -300,6 +302,7 @@ void readRaster(const TRasterPT<Pix> &ras, Tiio::Reader *reader, int x0, int y0,
     ptrdiff_t linePad = -x0 * ras->getPixelSize();
 
     if (reader->getRowOrder() == Tiio::BOTTOM2TOP) {
+      reader->setReadRegion(x0, y0, x1, y1);
       int start = reader->skipLines(y0);
       int stop  = y1 + 1;
 
@@ -311,6 +314,7 @@ void readRaster(const TRasterPT<Pix> &ras, Tiio::Reader *reader, int x0, int y0,
         }
     } else  // TOP2BOTTOM
     {
+      reader->setReadRegion(x0, inLy - 1 - y1, x1, inLy - 1 - y0);
       reader->skipLines(inLy - y1 - 1);
 
       for (int y = y1; y >= y0; --y) {
@@ -351,7 +355,9 @@ TImageP TImageReader::load0() {
       x1 = std::min(x1, m_region.x1);
       y1 = std::min(y1, m_region.y1);
 
-      if (x0 >= x1 || y0 >= y1) return TImageP();
+      // A single row or column is a valid region - tiles overlapping the
+      // image by one pixel need it
+      if (x0 > x1 || y0 > y1) return TImageP();
     }
 
     if (m_shrink > 1) {
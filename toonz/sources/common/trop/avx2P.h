@@ -0,0 +1,35 @@
+#pragma once
+
+#ifndef AVX2_P_INCLUDED
+#define AVX2_P_INCLUDED
+
+#include "tpixel.h"
+
+/*
+  AVX2 kernels are compiled on x86 targets only, without requiring the whole
+  library to be built for AVX2: each kernel function is marked with
+  AVX2_TARGET, and must be invoked only when TSystem::getCPUExtensions()
+  reports TSystem::CpuSupportsAvx2.
+
+  The 32-bit kernels treat pixels as 32-bit words with the matte in the most
+  significant byte, and are independent of the order of the color channels.
+*/
+
+#if defined(TNZ_MACHINE_CHANNEL_ORDER_BGRM) ||                                \
+    defined(TNZ_MACHINE_CHANNEL_ORDER_RGBM)
+
+#if defined(_MSC_VER) && defined(x64)
+#define USE_AVX2
+#define AVX2_TARGET
+#elif defined(__GNUC__) && defined(__x86_64__)
+#define USE_AVX2
+#define AVX2_TARGET __attribute__((target("avx2")))
+#endif
+
+#endif
+
+#ifdef USE_AVX2
+#include <immintrin.h>
+#endif
+
+#endif  // AVX2_P_INCLUDED
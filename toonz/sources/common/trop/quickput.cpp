@@ -4,6 +4,7 @@
 #include "loop_macros.h"
 #include "tpixelutils.h"
 #include "quickputP.h"
+#include "tsystem.h"
 
 #ifndef TNZCORE_LIGHT
 #include "tpalette.h"
@@ -73,6 +74,373 @@ inline TPixel32 applyColorScaleCMapped(const TPixel32 &color,
 
 //------------------------------------------------------------------------------
 
+//! Invokes processRow(y) for each y in [yMin, yMax]. Rows are split in bands
+//! run through TRop::runSubtasks(), so processRow must only write the dn
+//! pixels of its own row.
+template <typename ProcessRow>
+void forEachRow(int yMin, int yMax, const ProcessRow &processRow) {
+  int rowsCount  = yMax - yMin + 1;
+  int bandsCount = std::min(TSystem::getProcessorCount(), rowsCount / 32);
+
+  if (bandsCount < 2) {
+    for (int y = yMin; y <= yMax; ++y) processRow(y);
+    return;
+  }
+
+  std::vector<std::function<void()>> bands;
+  for (int b = 0; b < bandsCount; ++b) {
+    int y0 = yMin + rowsCount * b / bandsCount;
+    int y1 = yMin + rowsCount * (b + 1) / bandsCount;
+
+    bands.push_back([&processRow, y0, y1]() {
+      for (int y = y0; y < y1; ++y) processRow(y);
+    });
+  }
+
+  TRop::runSubtasks(bands);
+}
+
+//------------------------------------------------------------------------------
+
+//! Scanline walker shared by the nearest-neighbour quickput kernels: invokes
+//! putPixel(dnPix, upPix) for each pixel of dn whose pre-image through aff
+//! falls inside up.
+template <typename DnPix, typename UpPix, typename PutPixel>
+void quickPutAffine(const TRasterPT<DnPix> &dn, const TRasterPT<UpPix> &up,
+                    const TAffine &aff, const PutPixel &putPixel) {
+  //  se aff e' degenere la controimmagine di up e' un segmento (o un punto)
+  if ((aff.a11 * aff.a22 - aff.a12 * aff.a21) == 0) return;
+
+  //  contatore bit di shift
+  const int PADN = 16;
+
+  //  max dimensioni di up gestibili (limite imposto dal numero di bit
+  //  disponibili per la parte intera di xL, yL)
+  assert(std::max(up->getLx(), up->getLy()) <
+         (1 << (8 * sizeof(int) - PADN - 1)));
+
+  TRectD boundingBoxD =
+      TRectD(convert(dn->getBounds())) *
+      (aff * TRectD(-0.5, -0.5, up->getLx() - 0.5, up->getLy() - 0.5));
+
+  //  clipping
+  if (boundingBoxD.x0 >= boundingBoxD.x1 || boundingBoxD.y0 >= boundingBoxD.y1)
+    return;
+
+  //  clipping su dn
+  int yMin = std::max(tfloor(boundingBoxD.y0), 0);
+  int yMax = std::min(tceil(boundingBoxD.y1), dn->getLy() - 1);
+  int xMin = std::max(tfloor(boundingBoxD.x0), 0);
+  int xMax = std::min(tceil(boundingBoxD.x1), dn->getLx() - 1);
+
+  //  inversa di aff
+  TAffine invAff = inv(aff);
+
+  //  nel disegnare la y-esima scanline di dn, il passaggio al pixel
+  //  successivo comporta l'incremento (deltaXL, deltaYL) delle coordinate
+  //  "TLonghizzate" (round) del pixel corrispondente di up
+  int deltaXL = tround(invAff.a11 * (1 << PADN));
+  int deltaYL = tround(invAff.a21 * (1 << PADN));
+
+  //  se aff "TLonghizzata" (round) e' degenere la controimmagine di up e' un
+  //  segmento (o un punto)
+  if ((deltaXL == 0) && (deltaYL == 0)) return;
+
+  //  TINT32 predecessori di up->getLx() e up->getLy()
+  int lxPred = up->getLx() * (1 << PADN) - 1;
+  int lyPred = up->getLy() * (1 << PADN) - 1;
+
+  int dnWrap = dn->getWrap();
+  int upWrap = up->getWrap();
+  dn->lock();
+  up->lock();
+
+  DnPix *dnBasePix       = dn->pixels();
+  const UpPix *upBasePix = up->pixels();
+
+  //  scorre le scanline di boundingBoxD
+  forEachRow(yMin, yMax, [&](int y) {
+    //  il segmento [a, b] di up e' la controimmagine mediante aff della
+    //  porzione di scanline [(xMin, y), (xMax, y)] di dn. I suoi punti
+    //  (xL0 + k*deltaXL, yL0 + k*deltaYL), k = 0, ..., (xMax - xMin)
+    //  cadono in up per k = kMin, ..., kMax
+    TPointD a = invAff * TPointD(xMin, y);
+
+    //  (xL0, yL0) inizializzati per il round
+    int xL0 = tround((a.x + 0.5) * (1 << PADN));
+    int yL0 = tround((a.y + 0.5) * (1 << PADN));
+
+    //  calcola kMinX, kMaxX, kMinY, kMaxY
+    int kMinX = 0, kMaxX = xMax - xMin;  //  clipping su dn
+    int kMinY = 0, kMaxY = xMax - xMin;  //  clipping su dn
+
+    //  calcola kMinX, kMaxX
+    if (deltaXL == 0) {
+      // [a, b] verticale esterno ad up+(bordo destro/basso)
+      if ((xL0 < 0) || (lxPred < xL0)) return;
+    } else if (deltaXL > 0) {
+      //  [a, b] esterno ad up+(bordo destro/basso)
+      if (lxPred < xL0) return;
+
+      kMaxX = (lxPred - xL0) / deltaXL;  //  floor
+      if (xL0 < 0) {
+        kMinX = ((-xL0) + deltaXL - 1) / deltaXL;  //  ceil
+      }
+    } else  //  (deltaXL < 0)
+    {
+      //  [a, b] esterno ad up+(bordo destro/basso)
+      if (xL0 < 0) return;
+
+      kMaxX = xL0 / (-deltaXL);  //  floor
+      if (lxPred < xL0) {
+        kMinX = (xL0 - lxPred - deltaXL - 1) / (-deltaXL);  //  ceil
+      }
+    }
+
+    //  calcola kMinY, kMaxY
+    if (deltaYL == 0) {
+      //  [a, b] orizzontale esterno ad up+(bordo destro/basso)
+      if ((yL0 < 0) || (lyPred < yL0)) return;
+    } else if (deltaYL > 0) {
+      //  [a, b] esterno ad up+(bordo destro/basso)
+      if (lyPred < yL0) return;
+
+      kMaxY = (lyPred - yL0) / deltaYL;  //  floor
+      if (yL0 < 0) {
+        kMinY = ((-yL0) + deltaYL - 1) / deltaYL;  //  ceil
+      }
+    } else  //  (deltaYL < 0)
+    {
+      //  [a, b] esterno ad up+(bordo destro/basso)
+      if (yL0 < 0) return;
+
+      kMaxY = yL0 / (-deltaYL);  //  floor
+      if (lyPred < yL0) {
+        kMinY = (yL0 - lyPred - deltaYL - 1) / (-deltaYL);  //  ceil
+      }
+    }
+
+    //  calcola kMin, kMax effettuando anche il clipping su dn
+    int kMin = std::max({kMinX, kMinY, (int)0});
+    int kMax = std::min({kMaxX, kMaxY, xMax - xMin});
+
+    DnPix *dnRow    = dnBasePix + y * dnWrap;
+    DnPix *dnPix    = dnRow + xMin + kMin;
+    DnPix *dnEndPix = dnRow + xMin + kMax + 1;
+
+    //  (xL, yL) sono le coordinate (inizializzate per il round)
+    //  in versione "TLonghizzata" del pixel corrente di up
+    int xL = xL0 + (kMin - 1) * deltaXL;  //  inizializza xL
+    int yL = yL0 + (kMin - 1) * deltaYL;  //  inizializza yL
+
+    //  scorre i pixel sulla y-esima scanline di boundingBoxD
+    for (; dnPix < dnEndPix; ++dnPix) {
+      xL += deltaXL;
+      yL += deltaYL;
+
+      //  il punto di up TPointD(xL/(1<<PADN), yL/(1<<PADN)) e'
+      //  approssimato con (xI, yI)
+      int xI = xL >> PADN;  //  round
+      int yI = yL >> PADN;  //  round
+
+      assert((0 <= xI) && (xI <= up->getLx() - 1) && (0 <= yI) &&
+             (yI <= up->getLy() - 1));
+
+      putPixel(*dnPix, upBasePix[yI * upWrap + xI]);
+    }
+  });
+
+  dn->unlock();
+  up->unlock();
+}
+
+//------------------------------------------------------------------------------
+
+//! Variant of quickPutAffine() for aff = TAffine(sx, 0, tx, 0, sy, ty). The
+//! up column sampled by each dn column is the same on all the scanlines, and
+//! is computed only once.
+template <typename DnPix, typename UpPix, typename PutPixel>
+void quickPutScaled(const TRasterPT<DnPix> &dn, const TRasterPT<UpPix> &up,
+                    double sx, double sy, double tx, double ty,
+                    const PutPixel &putPixel) {
+  //  se aff := TAffine(sx, 0, tx, 0, sy, ty) e' degenere la controimmagine
+  //  di up e' un segmento (o un punto)
+  if ((sx == 0) || (sy == 0)) return;
+
+  //  contatore bit di shift
+  const int PADN = 16;
+
+  //  max dimensioni di up gestibili (limite imposto dal numero di bit
+  //  disponibili per la parte intera di xL, yL)
+  assert(std::max(up->getLx(), up->getLy()) <
+         (1 << (8 * sizeof(int) - PADN - 1)));
+
+  TAffine aff(sx, 0, tx, 0, sy, ty);
+  TRectD boundingBoxD =
+      TRectD(convert(dn->getBounds())) *
+      (aff * TRectD(-0.5, -0.5, up->getLx() - 0.5, up->getLy() - 0.5));
+
+  //  clipping
+  if (boundingBoxD.x0 >= boundingBoxD.x1 || boundingBoxD.y0 >= boundingBoxD.y1)
+    return;
+
+  //  clipping su dn
+  int yMin = std::max(tfloor(boundingBoxD.y0), 0);
+  int yMax = std::min(tceil(boundingBoxD.y1), dn->getLy() - 1);
+  int xMin = std::max(tfloor(boundingBoxD.x0), 0);
+  int xMax = std::min(tceil(boundingBoxD.x1), dn->getLx() - 1);
+
+  //  inversa di aff
+  TAffine invAff = inv(aff);
+
+  //  il passaggio al pixel successivo di dn in x (risp. in y) comporta
+  //  l'incremento deltaXL (risp. deltaYL) della coordinata "TLonghizzata"
+  //  (round) del pixel corrispondente di up
+  int deltaXL = tround(invAff.a11 * (1 << PADN));
+  int deltaYL = tround(invAff.a22 * (1 << PADN));
+
+  //  se aff "TLonghizzata" (round) e' degenere la controimmagine di up e' un
+  //  segmento (o un punto)
+  if ((deltaXL == 0) || (deltaYL == 0)) return;
+
+  //  (xL0, yL0) sono le coordinate di invAff*(xMin, yMin) (inizializzate per
+  //  il round) in versione "TLonghizzata"
+  TPointD a = invAff * TPointD(xMin, yMin);
+  int xL0   = tround((a.x + 0.5) * (1 << PADN));
+  int yL0   = tround((a.y + 0.5) * (1 << PADN));
+
+  //  calcola kMinX, kMaxX, kMinY, kMaxY
+  int kMinX = 0, kMaxX = xMax - xMin;  //  clipping su dn
+  int kMinY = 0, kMaxY = yMax - yMin;  //  clipping su dn
+
+  //  TINT32 predecessori di up->getLx() e up->getLy()
+  int lxPred = up->getLx() * (1 << PADN) - 1;
+  int lyPred = up->getLy() * (1 << PADN) - 1;
+
+  //  calcola kMinY, kMaxY
+  if (deltaYL > 0)  //  (deltaYL != 0)
+  {
+    assert(yL0 <= lyPred);
+
+    kMaxY = (lyPred - yL0) / deltaYL;  //  floor
+    if (yL0 < 0) {
+      kMinY = ((-yL0) + deltaYL - 1) / deltaYL;  //  ceil
+    }
+  } else  //  (deltaYL < 0)
+  {
+    assert(0 <= yL0);
+
+    kMaxY = yL0 / (-deltaYL);  //  floor
+    if (lyPred < yL0) {
+      kMinY = (yL0 - lyPred - deltaYL - 1) / (-deltaYL);  //  ceil
+    }
+  }
+
+  //  clipping su dn
+  kMinY = std::max(kMinY, (int)0);
+  kMaxY = std::min(kMaxY, yMax - yMin);
+
+  //  calcola kMinX, kMaxX
+  if (deltaXL > 0)  //  (deltaXL != 0)
+  {
+    assert(xL0 <= lxPred);
+
+    kMaxX = (lxPred - xL0) / deltaXL;  //  floor
+    if (xL0 < 0) {
+      kMinX = ((-xL0) + deltaXL - 1) / deltaXL;  //  ceil
+    }
+  } else  //  (deltaXL < 0)
+  {
+    assert(0 <= xL0);
+
+    kMaxX = xL0 / (-deltaXL);  //  floor
+    if (lxPred < xL0) {
+      kMinX = (xL0 - lxPred - deltaXL - 1) / (-deltaXL);  //  ceil
+    }
+  }
+
+  //  clipping su dn
+  kMinX = std::max(kMinX, (int)0);
+  kMaxX = std::min(kMaxX, xMax - xMin);
+
+  if (kMinX > kMaxX) return;
+
+  //  colonne di up campionate dalle colonne xMin + kX di dn
+  std::vector<int> upColumns(kMaxX - kMinX + 1);
+  for (int kX = kMinX; kX <= kMaxX; ++kX) {
+    int xI = (xL0 + kX * deltaXL) >> PADN;  //  round
+    assert((0 <= xI) && (xI <= up->getLx() - 1));
+
+    upColumns[kX - kMinX] = xI;
+  }
+
+  int columnsCount = kMaxX - kMinX + 1;
+
+  int dnWrap = dn->getWrap();
+  int upWrap = up->getWrap();
+  dn->lock();
+  up->lock();
+
+  DnPix *dnBasePix       = dn->pixels();
+  const UpPix *upBasePix = up->pixels();
+
+  //  scorre le scanline yMin + kY di dn
+  forEachRow(yMin + kMinY, yMin + kMaxY, [&](int y) {
+    int yI = (yL0 + (y - yMin) * deltaYL) >> PADN;  //  round
+    assert((0 <= yI) && (yI <= up->getLy() - 1));
+
+    const UpPix *upRow = upBasePix + yI * upWrap;
+    DnPix *dnPix       = dnBasePix + y * dnWrap + xMin + kMinX;
+
+    for (int k = 0; k < columnsCount; ++k)
+      putPixel(dnPix[k], upRow[upColumns[k]]);
+  });
+
+  dn->unlock();
+  up->unlock();
+}
+
+//------------------------------------------------------------------------------
+
+//! Puts 32-bit pixels with the options of the viewer's columns.
+class OverPixel32 {
+  TPixel32 m_colorScale;
+  bool m_doPremultiply, m_whiteTransp, m_firstColumn,
+      m_doRasterDarkenBlendedView;
+
+public:
+  OverPixel32(const TPixel32 &colorScale, bool doPremultiply, bool whiteTransp,
+              bool firstColumn, bool doRasterDarkenBlendedView)
+      : m_colorScale(colorScale)
+      , m_doPremultiply(doPremultiply)
+      , m_whiteTransp(whiteTransp)
+      , m_firstColumn(firstColumn)
+      , m_doRasterDarkenBlendedView(doRasterDarkenBlendedView) {}
+
+  void operator()(TPixel32 &dnPix, TPixel32 upPix) const {
+    if (m_firstColumn) upPix.m = 255;
+    if (upPix.m == 0 || (m_whiteTransp && upPix == TPixel::White)) return;
+
+    if (m_colorScale != TPixel32::Black)
+      upPix = applyColorScale(upPix, m_colorScale, m_doPremultiply);
+
+    if (m_doRasterDarkenBlendedView)
+      dnPix = quickOverPixDarkenBlended(dnPix, upPix);
+    else {
+      if (upPix.m == 255)
+        dnPix = upPix;
+      else if (m_doPremultiply)
+        dnPix = quickOverPixPremult(dnPix, upPix);
+      else
+        dnPix = quickOverPix(dnPix, upPix);
+    }
+  }
+};
+
+//=============================================================================
+//=============================================================================
+//=============================================================================
+
 void doQuickPutFilter(const TRaster32P &dn, const TRaster32P &up,
                       const TAffine &aff) {
   //  se aff e' degenere la controimmagine di up e' un segmento (o un punto)
@@ -340,21 +708,89 @@ void doQuickPutNoFilter(const TRaster32P &dn, const TRaster32P &up,
                         const TAffine &aff, const TPixel32 &colorScale,
                         bool doPremultiply, bool whiteTransp, bool firstColumn,
                         bool doRasterDarkenBlendedView) {
-  //  se aff := TAffine(sx, 0, tx, 0, sy, ty) e' degenere la controimmagine
-  //  di up e' un segmento (o un punto)
-  if ((aff.a11 * aff.a22 - aff.a12 * aff.a21) == 0) return;
+  quickPutAffine(dn, up, aff,
+                 OverPixel32(colorScale, doPremultiply, whiteTransp,
+                             firstColumn, doRasterDarkenBlendedView));
+}
 
-  //  contatore bit di shift
+//=============================================================================
+//=============================================================================
+//=============================================================================
+
+//! Puts up over dn converting its pixels to the dn pixel type. Used for all
+//! the raster types combinations without viewer-specific options.
+template <typename DnPix, typename UpPix>
+void doQuickPutNoFilter(const TRasterPT<DnPix> &dn, const TRasterPT<UpPix> &up,
+                        const TAffine &aff, bool doPremultiply,
+                        bool firstColumn) {
+  const typename UpPix::Channel maxM = UpPix::maxChannelValue;
+
+  auto putPixel = [=](DnPix &dnPix, UpPix upPix) {
+    if (firstColumn) upPix.m = maxM;
+    if (upPix.m <= 0) return;
+
+    DnPix upPixDn = PixelConverter<DnPix>::from(upPix);
+    if (upPix.m >= maxM)
+      dnPix = upPixDn;
+    else if (doPremultiply)
+      dnPix = quickOverPixPremult(dnPix, upPixDn);
+    else
+      dnPix = quickOverPix(dnPix, upPixDn);
+  };
+
+  quickPutAffine(dn, up, aff, putPixel);
+}
+//=============================================================================
+//=============================================================================
+//=============================================================================
+
+void doQuickPutNoFilter(const TRaster32P &dn, const TRasterGR8P &up,
+                        const TAffine &aff, const TPixel32 &colorScale) {
+  auto putPixel = [&colorScale](TPixel32 &dnPix, const TPixelGR8 &upPix) {
+    if (colorScale == TPixel32::Black) {
+      if (upPix.value == 0)
+        dnPix.r = dnPix.g = dnPix.b = 0;
+      else if (upPix.value == 255)
+        dnPix.r = dnPix.g = dnPix.b = upPix.value;
+      else
+        dnPix = quickOverPix(dnPix, upPix);
+      dnPix.m = 255;
+    } else {
+      TPixel32 upPix32(upPix.value, upPix.value, upPix.value, 255);
+      upPix32 = applyColorScale(upPix32, colorScale);
+
+      if (upPix32.m == 255)
+        dnPix = upPix32;
+      else
+        dnPix = quickOverPix(dnPix, upPix32);
+    }
+  };
+
+  quickPutAffine(dn, up, aff, putPixel);
+}
+
+//=============================================================================
+
+void doQuickPutFilter(const TRaster32P &dn, const TRaster32P &up, double sx,
+                      double sy, double tx, double ty) {
+  //  se aff := TAffine(sx, 0, tx, 0, sy, ty) e' degenere la controimmagine
+  //  di up e' un segmento (o un punto)
+  if ((sx == 0) || (sy == 0)) return;
+
+  //  contatore bit di shift
   const int PADN = 16;
 
-  //  max dimensioni di up gestibili (limite imposto dal numero di bit
-  //  disponibili per la parte intera di xL, yL)
+  //  maschera del filtro bilineare
+  const int MASKN = (1 << PADN) - 1;
+
   assert(std::max(up->getLx(), up->getLy()) <
          (1 << (8 * sizeof(int) - PADN - 1)));
 
-  TRectD boundingBoxD =
-      TRectD(convert(dn->getBounds())) *
-      (aff * TRectD(-0.5, -0.5, up->getLx() - 0.5, up->getLy() - 0.5));
+  //  max dimensioni di up gestibili (limite imposto dal numero di bit
+  //  disponibili per la parte intera di xL, yL)
+  TAffine aff(sx, 0, tx, 0, sy, ty);
+  TRectD boundingBoxD = TRectD(convert(dn->getSize())) *
+                        (aff * TRectD(0, 0, up->getLx() - 2, up->getLy() - 2));
 
   //  clipping
   if (boundingBoxD.x0 >= boundingBoxD.x1 || boundingBoxD.y0 >= boundingBoxD.y1)
@@ -375,11 +811,16 @@ void doQuickPutNoFilter(const TRaster32P &dn, const TRaster32P &up,
   //  inversa di aff
   TAffine invAff = inv(aff);
 
-  //  nel disegnare la y-esima scanline di dn, il passaggio al pixel
-  //  successivo comporta l'incremento (deltaXD, deltaYD) delle coordinate del
-  //  pixel corrispondente di up
+  //	nello scorrere le scanline di boundingBoxD, il passaggio alla scanline
+  //    successiva comporta l'incremento (0, deltaYD) delle coordinate dei
+  //    pixels corrispondenti di up
+
+  //    nel disegnare la y-esima scanline di dn, il passaggio al pixel
+  //    successivo comporta l'incremento (deltaXD, 0) delle coordinate del
+  //    pixel corrispondente di up
+
   double deltaXD = invAff.a11;
-  double deltaYD = invAff.a21;
+  double deltaYD = invAff.a22;
 
   //  deltaXD "TLonghizzato" (round)
   int deltaXL = tround(deltaXD * (1 << PADN));
@@ -389,205 +830,269 @@ void doQuickPutNoFilter(const TRaster32P &dn, const TRaster32P &up,
 
   //  se aff "TLonghizzata" (round) e' degenere la controimmagine di up e' un
   //  segmento (o un punto)
-  if ((deltaXL == 0) && (deltaYL == 0)) return;
+  if ((deltaXL == 0) || (deltaYL == 0)) return;
 
-  //  TINT32 predecessore di up->getLx()
-  int lxPred = up->getLx() * (1 << PADN) - 1;
+  //	(1)  equazione (kX, kY)-parametrica di boundingBoxD:
+  //	       (xMin, yMin) + kX*(1, 0) + kY*(0, 1),
+  //	         kX = 0, ..., (xMax - xMin),
+  //             kY = 0, ..., (yMax - yMin)
 
-  //  TINT32 predecessore di up->getLy()
-  int lyPred = up->getLy() * (1 << PADN) - 1;
+  //	(2)  equazione (kX, kY)-parametrica dell'immagine
+  //         mediante invAff di (1):
+  //	       invAff*(xMin, yMin) + kX*(deltaXD, 0) + kY*(0, deltaYD),
+  //	         kX = kMinX, ..., kMaxX
+  //               con 0 <= kMinX <= kMaxX <= (xMax - xMin)
+  //
+  //	         kY = kMinY, ..., kMaxY
+  //               con 0 <= kMinY <= kMaxY <= (yMax - yMin)
+
+  //  calcola kMinX, kMaxX, kMinY, kMaxY intersecando la (2) con i lati di up
+
+  //  il segmento [a, b] di up (con gli estremi eventualmente invertiti) e'
+  //  la controimmagine
+  //  mediante aff della porzione di scanline  [ (xMin, yMin), (xMax, yMin) ]
+  //  di dn
+
+  //  TPointD b = invAff*TPointD(xMax, yMin);
+  TPointD a = invAff * TPointD(xMin, yMin);
+
+  //  (xL0, yL0) sono le coordinate di a (inizializzate per il round) in
+  //  versione "TLonghizzata"
+  //
+  //    0 <= xL0 + kX*deltaXL
+  //      <= (up->getLx() - 2)*(1<<PADN),
+  //    0 <= kMinX <= kX
+  //      <= kMaxX <= (xMax - xMin)
+  //
+  //	0 <= yL0 + kY*deltaYL
+  //      <= (up->getLy() - 2)*(1<<PADN),
+  //    0 <= kMinY <= kY
+  //      <= kMaxY <= (yMax - yMin)
+  int xL0 = tround(a.x * (1 << PADN));  //  xL0 inizializzato
+  int yL0 = tround(a.y * (1 << PADN));  //  yL0 inizializzato
+
+  //  calcola kMinY, kMaxY, kMinX, kMaxX intersecando la (2) con i lati
+  //  di up
+  int kMinX = 0, kMaxX = xMax - xMin;  //  clipping su dn
+  int kMinY = 0, kMaxY = yMax - yMin;  //  clipping su dn
+
+  //  TINT32 predecessore di (up->getLx() - 1)
+  int lxPred = (up->getLx() - 2) * (1 << PADN);
+
+  //  TINT32 predecessore di (up->getLy() - 1)
+  int lyPred = (up->getLy() - 2) * (1 << PADN);
+
+  //  0 <= xL0 + k*deltaXL
+  //    <= (up->getLx() - 2)*(1<<PADN)
+  //             <=>
+  //  0 <= xL0 + k*deltaXL <= lxPred
+  //
+  //  0 <= yL0 + k*deltaYL
+  //    <= (up->getLy() - 2)*(1<<PADN)
+  //             <=>
+  //  0 <= yL0 + k*deltaYL <= lyPred
+
+  //  calcola kMinY, kMaxY intersecando la (2) con
+  //  i lati (y = yMin) e (y = yMax) di up
+  if (deltaYL > 0)  //  (deltaYL != 0)
+  {
+    //  [a, b] interno ad up contratto
+    assert(yL0 <= lyPred);
+    kMaxY = (lyPred - yL0) / deltaYL;  //  floor
+    if (yL0 < 0) {
+      kMinY = ((-yL0) + deltaYL - 1) / deltaYL;  //  ceil
+    }
+  } else  //  (deltaYL < 0)
+  {
+    //  [a, b] interno ad up contratto
+    assert(0 <= yL0);
+
+    kMaxY = yL0 / (-deltaYL);  //  floor
+    if (lyPred < yL0) {
+      kMinY = (yL0 - lyPred - deltaYL - 1) / (-deltaYL);  //  ceil
+    }
+  }
+  //	calcola kMinY, kMaxY effettuando anche il clippind su dn
+  kMinY = std::max(kMinY, (int)0);
+  kMaxY = std::min(kMaxY, yMax - yMin);
+
+  //  calcola kMinX, kMaxX intersecando la (2) con
+  //  i lati (x = xMin) e (x = xMax) di up
+  if (deltaXL > 0)  //  (deltaXL != 0)
+  {
+    //  [a, b] interno ad up contratto
+    assert(xL0 <= lxPred);
+
+    kMaxX = (lxPred - xL0) / deltaXL;  //  floor
+    if (xL0 < 0) {
+      kMinX = ((-xL0) + deltaXL - 1) / deltaXL;  //  ceil
+    }
+  } else  //  (deltaXL < 0)
+  {
+    //  [a, b] interno ad up contratto
+    assert(0 <= xL0);
+
+    kMaxX = xL0 / (-deltaXL);  //  floor
+    if (lxPred < xL0) {
+      kMinX = (xL0 - lxPred - deltaXL - 1) / (-deltaXL);  //  ceil
+    }
+  }
+  //  calcola kMinX, kMaxX effettuando anche il clippind su dn
+  kMinX = std::max(kMinX, (int)0);
+  kMaxX = std::min(kMaxX, xMax - xMin);
 
   int dnWrap = dn->getWrap();
   int upWrap = up->getWrap();
   dn->lock();
   up->lock();
 
-  TPixel32 *dnRow     = dn->pixels(yMin);
   TPixel32 *upBasePix = up->pixels();
+  TPixel32 *dnRow     = dn->pixels(yMin + kMinY);
 
-  //  scorre le scanline di boundingBoxD
-  for (int y = yMin; y <= yMax; y++, dnRow += dnWrap) {
-    //  (1)  equazione k-parametrica della y-esima scanline di boundingBoxD:
-    //       (xMin, y) + k*(1, 0),  k = 0, ..., (xMax - xMin)
+  //  (xL, yL) sono le coordinate (inizializzate per il round)
+  //  in versione "TLonghizzata" del pixel corrente di up
 
-    //  (2)  equazione k-parametrica dell'immagine mediante invAff di (1):
-    //       invAff*(xMin, y) + k*(deltaXD, deltaYD),
-    //       k = kMin, ..., kMax con 0 <= kMin <= kMax <= (xMax - xMin)
+  //  inizializza yL
+  int yL = yL0 + (kMinY - 1) * deltaYL;
 
-    //  calcola kMin, kMax per la scanline corrente
-    //  intersecando la (2) con i lati di up
+  //  scorre le scanline di boundingBoxD
+  for (int kY = kMinY; kY <= kMaxY; kY++, dnRow += dnWrap) {
+    //  inizializza xL
+    int xL = xL0 + (kMinX - 1) * deltaXL;
+    yL += deltaYL;
+    //  il punto di up TPointD(xL/(1<<PADN), yL/(1<<PADN)) e' approssimato
+    //  con (xI, yI)
+    int yI = yL >> PADN;  //  troncato
 
-    //  il segmento [a, b] di up e' la controimmagine mediante aff della
-    //  porzione di scanline  [ (xMin, y), (xMax, y) ] di dn
+    //  filtro bilineare 4 pixels: calcolo degli y-pesi
+    int yWeight1 = (yL & MASKN);
+    int yWeight0 = (1 << PADN) - yWeight1;
 
-    //  TPointD b = invAff*TPointD(xMax, y);
-    TPointD a = invAff * TPointD(xMin, y);
+    TPixel32 *dnPix    = dnRow + xMin + kMinX;
+    TPixel32 *dnEndPix = dnRow + xMin + kMaxX + 1;
 
-    //  (xL0, yL0) sono le coordinate di a (inizializzate per il round)
-    //  in versione "TLonghizzata"
-    //  0 <= xL0 + k*deltaXL
-    //    <  up->getLx()*(1<<PADN)
-    //
-    //  0 <= kMinX
-    //    <= kMin
-    //    <= k
-    //    <= kMax
-    //    <= kMaxX
-    //    <= (xMax - xMin)
-    //
-    //  0 <= yL0 + k*deltaYL
-    //    < up->getLy()*(1<<PADN)
+    //  scorre i pixel sulla (yMin + kY)-esima scanline di dn
+    for (; dnPix < dnEndPix; ++dnPix) {
+      xL += deltaXL;
+      //  il punto di up TPointD(xL/(1<<PADN), yL/(1<<PADN)) e'
+      //  approssimato con (xI, yI)
+      int xI = xL >> PADN;  //  troncato
 
-    //  0 <= kMinY
-    //    <= kMin
-    //    <= k
-    //    <= kMax
-    //    <= kMaxY
-    //    <= (xMax - xMin)
+      assert((0 <= xI) && (xI <= up->getLx() - 1) && (0 <= yI) &&
+             (yI <= up->getLy() - 1));
 
-    //  xL0 inizializzato per il round
-    int xL0 = tround((a.x + 0.5) * (1 << PADN));
+      //  (xI, yI)
+      TPixel32 *upPix00 = upBasePix + (yI * upWrap + xI);
 
-    //  yL0 inizializzato per il round
-    int yL0 = tround((a.y + 0.5) * (1 << PADN));
+      //  (xI + 1, yI)
+      TPixel32 *upPix10 = upPix00 + 1;
 
-    //  calcola kMinX, kMaxX, kMinY, kMaxY
-    int kMinX = 0, kMaxX = xMax - xMin;  //  clipping su dn
-    int kMinY = 0, kMaxY = xMax - xMin;  //  clipping su dn
+      //  (xI, yI + 1)
+      TPixel32 *upPix01 = upPix00 + upWrap;
 
-    //  0 <= xL0 + k*deltaXL
-    //    < up->getLx()*(1<<PADN)
-    //           <=>
-    //  0 <= xL0 + k*deltaXL
-    //    <= lxPred
-    //
-    //  0 <= yL0 + k*deltaYL
-    //    < up->getLy()*(1<<PADN)
-    //           <=>
-    //  0 <= yL0 + k*deltaYL
-    //    <= lyPred
+      //  (xI + 1, yI + 1)
+      TPixel32 *upPix11 = upPix00 + upWrap + 1;
 
-    //  calcola kMinX, kMaxX
-    if (deltaXL == 0) {
-      // [a, b] verticale esterno ad up+(bordo destro/basso)
-      if ((xL0 < 0) || (lxPred < xL0)) continue;
-      //  altrimenti usa solo
-      //  kMinY, kMaxY ((deltaXL != 0) || (deltaYL != 0))
-    } else if (deltaXL > 0) {
-      //  [a, b] esterno ad up+(bordo destro/basso)
-      if (lxPred < xL0) continue;
+      //  filtro bilineare 4 pixels: calcolo degli x-pesi
+      int xWeight1 = (xL & MASKN);
+      int xWeight0 = (1 << PADN) - xWeight1;
 
-      kMaxX = (lxPred - xL0) / deltaXL;  //  floor
-      if (xL0 < 0) {
-        kMinX = ((-xL0) + deltaXL - 1) / deltaXL;  //  ceil
-      }
-    } else  //  (deltaXL < 0)
-    {
-      //  [a, b] esterno ad up+(bordo destro/basso)
-      if (xL0 < 0) continue;
-
-      kMaxX = xL0 / (-deltaXL);  //  floor
-      if (lxPred < xL0) {
-        kMinX = (xL0 - lxPred - deltaXL - 1) / (-deltaXL);  //  ceil
-      }
-    }
-
-    //  calcola kMinY, kMaxY
-    if (deltaYL == 0) {
-      //  [a, b] orizzontale esterno ad up+(bordo destro/basso)
-      if ((yL0 < 0) || (lyPred < yL0)) continue;
-      // altrimenti usa solo
-      // kMinX, kMaxX ((deltaXL != 0) || (deltaYL != 0))
-    } else if (deltaYL > 0) {
-      //  [a, b] esterno ad up+(bordo destro/basso)
-      if (lyPred < yL0) continue;
-
-      kMaxY = (lyPred - yL0) / deltaYL;  //  floor
-      if (yL0 < 0) {
-        kMinY = ((-yL0) + deltaYL - 1) / deltaYL;  //  ceil
-      }
-    } else  //  (deltaYL < 0)
-    {
-      //  [a, b] esterno ad up+(bordo destro/basso)
-      if (yL0 < 0) continue;
-
-      kMaxY = yL0 / (-deltaYL);  //  floor
-      if (lyPred < yL0) {
-        kMinY = (yL0 - lyPred - deltaYL - 1) / (-deltaYL);  //  ceil
-      }
-    }
+      //  filtro bilineare 4 pixels: media pesata sui singoli canali
+      int rColDownTmp =
+          (xWeight0 * (upPix00->r) + xWeight1 * ((upPix10)->r)) >> PADN;
 
-    //  calcola kMin, kMax effettuando anche il clippind su dn
-    int kMin = std::max({kMinX, kMinY, (int)0});
-    int kMax = std::min({kMaxX, kMaxY, xMax - xMin});
+      int gColDownTmp =
+          (xWeight0 * (upPix00->g) + xWeight1 * ((upPix10)->g)) >> PADN;
 
-    TPixel32 *dnPix    = dnRow + xMin + kMin;
-    TPixel32 *dnEndPix = dnRow + xMin + kMax + 1;
+      int bColDownTmp =
+          (xWeight0 * (upPix00->b) + xWeight1 * ((upPix10)->b)) >> PADN;
 
-    //  (xL, yL) sono le coordinate (inizializzate per il round)
-    //  in versione "TLonghizzata" del pixel corrente di up
-    int xL = xL0 + (kMin - 1) * deltaXL;  //  inizializza xL
-    int yL = yL0 + (kMin - 1) * deltaYL;  //  inizializza yL
+      int rColUpTmp =
+          (xWeight0 * ((upPix01)->r) + xWeight1 * ((upPix11)->r)) >> PADN;
 
-    //  scorre i pixel sulla y-esima scanline di boundingBoxD
-    for (; dnPix < dnEndPix; ++dnPix) {
-      xL += deltaXL;
-      yL += deltaYL;
+      int gColUpTmp =
+          (xWeight0 * ((upPix01)->g) + xWeight1 * ((upPix11)->g)) >> PADN;
 
-      //  il punto di up TPointD(xL/(1<<PADN), yL/(1<<PADN)) e'
-      //  approssimato con (xI, yI)
-      int xI = xL >> PADN;  //  round
-      int yI = yL >> PADN;  //  round
+      int bColUpTmp =
+          (xWeight0 * ((upPix01)->b) + xWeight1 * ((upPix11)->b)) >> PADN;
 
-      assert((0 <= xI) && (xI <= up->getLx() - 1) && (0 <= yI) &&
-             (yI <= up->getLy() - 1));
+      unsigned char rCol =
+          (unsigned char)((yWeight0 * rColDownTmp + yWeight1 * rColUpTmp) >>
+                          PADN);
 
-      TPixel32 upPix = *(upBasePix + (yI * upWrap + xI));
+      unsigned char gCol =
+          (unsigned char)((yWeight0 * gColDownTmp + yWeight1 * gColUpTmp) >>
+                          PADN);
 
-      if (firstColumn) upPix.m = 255;
-      if (upPix.m == 0 || (whiteTransp && upPix == TPixel::White)) continue;
+      unsigned char bCol =
+          (unsigned char)((yWeight0 * bColDownTmp + yWeight1 * bColUpTmp) >>
+                          PADN);
 
-      if (colorScale != TPixel32::Black)
-        upPix = applyColorScale(upPix, colorScale, doPremultiply);
+      TPixel32 upPix = TPixel32(rCol, gCol, bCol, upPix00->m);
 
-      if (doRasterDarkenBlendedView)
-        *dnPix = quickOverPixDarkenBlended(*dnPix, upPix);
-      else {
-        if (upPix.m == 255)
-          *dnPix = upPix;
-        else if (doPremultiply)
-          *dnPix = quickOverPixPremult(*dnPix, upPix);
-        else
-          *dnPix = quickOverPix(*dnPix, upPix);
-      }
+      if (upPix.m == 0)
+        continue;
+      else if (upPix.m == 255)
+        *dnPix = upPix;
+      else
+        *dnPix = quickOverPix(*dnPix, upPix);
     }
   }
   dn->unlock();
   up->unlock();
 }
-
 //=============================================================================
 //=============================================================================
 //=============================================================================
+void doQuickPutNoFilter(const TRaster32P &dn, const TRaster32P &up, double sx,
+                        double sy, double tx, double ty,
+                        const TPixel32 &colorScale, bool doPremultiply,
+                        bool whiteTransp, bool firstColumn,
+                        bool doRasterDarkenBlendedView) {
+  quickPutScaled(dn, up, sx, sy, tx, ty,
+                 OverPixel32(colorScale, doPremultiply, whiteTransp,
+                             firstColumn, doRasterDarkenBlendedView));
+}
 
-void doQuickPutNoFilter(const TRaster32P &dn, const TRaster64P &up,
-                        const TAffine &aff, bool doPremultiply,
-                        bool firstColumn) {
-  //  se aff := TAffine(sx, 0, tx, 0, sy, ty) e' degenere la controimmagine
-  //  di up e' un segmento (o un punto)
+//=============================================================================
+void doQuickPutNoFilter(const TRaster32P &dn, const TRasterGR8P &up, double sx,
+                        double sy, double tx, double ty,
+                        const TPixel32 &colorScale) {
+  auto putPixel = [&colorScale](TPixel32 &dnPix, const TPixelGR8 &upPix) {
+    if (colorScale == TPixel32::Black) {
+      dnPix.r = dnPix.g = dnPix.b = upPix.value;
+      dnPix.m                     = 255;
+    } else {
+      TPixel32 upPix32(upPix.value, upPix.value, upPix.value, 255);
+      upPix32 = applyColorScale(upPix32, colorScale);
+
+      if (upPix32.m == 255)
+        dnPix = upPix32;
+      else
+        dnPix = quickOverPix(dnPix, upPix32);
+    }
+  };
+
+  quickPutScaled(dn, up, sx, sy, tx, ty, putPixel);
+}
+
+void doQuickResampleFilter(const TRaster32P &dn, const TRaster32P &up,
+                           const TAffine &aff) {
+  //  se aff e' degenere la controimmagine di up e' un segmento (o un punto)
   if ((aff.a11 * aff.a22 - aff.a12 * aff.a21) == 0) return;
 
   //  contatore bit di shift
   const int PADN = 16;
 
-  //  max dimensioni di up gestibili (limite imposto dal numero di bit
-  //  disponibili per la parte intera di xL, yL)
+  //  maschera del filtro bilineare
+  const int MASKN = (1 << PADN) - 1;
   assert(std::max(up->getLx(), up->getLy()) <
          (1 << (8 * sizeof(int) - PADN - 1)));
+  //  max dimensioni di up gestibili (limite imposto dal numero di bit
+  //  disponibili per la parte intera di xL, yL)
 
-  TRectD boundingBoxD =
-      TRectD(convert(dn->getBounds())) *
-      (aff * TRectD(-0.5, -0.5, up->getLx() - 0.5, up->getLy() - 0.5));
+  TRectD boundingBoxD = TRectD(convert(dn->getSize())) *
+                        (aff * TRectD(0, 0, up->getLx() - 2, up->getLy() - 2));
 
   //  clipping
   if (boundingBoxD.x0 >= boundingBoxD.x1 || boundingBoxD.y0 >= boundingBoxD.y1)
@@ -605,12 +1110,11 @@ void doQuickPutNoFilter(const TRaster32P &dn, const TRaster64P &up,
   //  clipping x su dn
   int xMax = std::min(tceil(boundingBoxD.x1), dn->getLx() - 1);
 
-  //  inversa di aff
-  TAffine invAff = inv(aff);
+  TAffine invAff = inv(aff);  //  inversa di aff
 
   //  nel disegnare la y-esima scanline di dn, il passaggio al pixel
-  //  successivo comporta l'incremento (deltaXD, deltaYD) delle coordinate del
-  //  pixel corrispondente di up
+  //  successivo comporta l'incremento (deltaXD, deltaYD) delle coordinate
+  //  del pixel corrispondente di up
   double deltaXD = invAff.a11;
   double deltaYD = invAff.a21;
 
@@ -624,11 +1128,11 @@ void doQuickPutNoFilter(const TRaster32P &dn, const TRaster64P &up,
   //  segmento (o un punto)
   if ((deltaXL == 0) && (deltaYL == 0)) return;
 
-  //  TINT32 predecessore di up->getLx()
-  int lxPred = up->getLx() * (1 << PADN) - 1;
+  // naturale predecessore di up->getLx() - 1
+  int lxPred = (up->getLx() - 2) * (1 << PADN);
 
-  //  TINT32 predecessore di up->getLy()
-  int lyPred = up->getLy() * (1 << PADN) - 1;
+  //  naturale predecessore di up->getLy() - 1
+  int lyPred = (up->getLy() - 2) * (1 << PADN);
 
   int dnWrap = dn->getWrap();
   int upWrap = up->getWrap();
@@ -636,19 +1140,20 @@ void doQuickPutNoFilter(const TRaster32P &dn, const TRaster64P &up,
   up->lock();
 
   TPixel32 *dnRow     = dn->pixels(yMin);
-  TPixel64 *upBasePix = up->pixels();
+  TPixel32 *upBasePix = up->pixels();
 
   //  scorre le scanline di boundingBoxD
   for (int y = yMin; y <= yMax; y++, dnRow += dnWrap) {
     //  (1)  equazione k-parametrica della y-esima scanline di boundingBoxD:
-    //       (xMin, y) + k*(1, 0),  k = 0, ..., (xMax - xMin)
-
+    //         (xMin, y) + k*(1, 0),  k = 0, ..., (xMax - xMin)
+    //
     //  (2)  equazione k-parametrica dell'immagine mediante invAff di (1):
-    //       invAff*(xMin, y) + k*(deltaXD, deltaYD),
-    //       k = kMin, ..., kMax con 0 <= kMin <= kMax <= (xMax - xMin)
+    //         invAff*(xMin, y) + k*(deltaXD, deltaYD),
+    //           k = kMin, ..., kMax
+    //           con 0 <= kMin <= kMax <= (xMax - xMin)
 
-    //  calcola kMin, kMax per la scanline corrente
-    //  intersecando la (2) con i lati di up
+    //  calcola kMin, kMax per la scanline corrente intersecando
+    //  la (2) con i lati di up
 
     //  il segmento [a, b] di up e' la controimmagine mediante aff della
     //  porzione di scanline  [ (xMin, y), (xMax, y) ] di dn
@@ -656,21 +1161,18 @@ void doQuickPutNoFilter(const TRaster32P &dn, const TRaster64P &up,
     //  TPointD b = invAff*TPointD(xMax, y);
     TPointD a = invAff * TPointD(xMin, y);
 
-    //  (xL0, yL0) sono le coordinate di a (inizializzate per il round)
-    //  in versione "TLonghizzata"
+    //  (xL0, yL0) sono le coordinate di a in versione "TLonghizzata"
     //  0 <= xL0 + k*deltaXL
-    //    <  up->getLx()*(1<<PADN)
-    //
+    //    <= (up->getLx() - 2)*(1<<PADN),
     //  0 <= kMinX
     //    <= kMin
     //    <= k
     //    <= kMax
     //    <= kMaxX
     //    <= (xMax - xMin)
-    //
-    //  0 <= yL0 + k*deltaYL
-    //    < up->getLy()*(1<<PADN)
 
+    //  0 <= yL0 + k*deltaYL
+    //    <= (up->getLy() - 2)*(1<<PADN),
     //  0 <= kMinY
     //    <= kMin
     //    <= k
@@ -678,36 +1180,32 @@ void doQuickPutNoFilter(const TRaster32P &dn, const TRaster64P &up,
     //    <= kMaxY
     //    <= (xMax - xMin)
 
-    //  xL0 inizializzato per il round
-    int xL0 = tround((a.x + 0.5) * (1 << PADN));
+    //  xL0 inizializzato
+    int xL0 = tround(a.x * (1 << PADN));
 
-    //  yL0 inizializzato per il round
-    int yL0 = tround((a.y + 0.5) * (1 << PADN));
+    //  yL0 inizializzato
+    int yL0 = tround(a.y * (1 << PADN));
 
     //  calcola kMinX, kMaxX, kMinY, kMaxY
     int kMinX = 0, kMaxX = xMax - xMin;  //  clipping su dn
     int kMinY = 0, kMaxY = xMax - xMin;  //  clipping su dn
 
-    //  0 <= xL0 + k*deltaXL
-    //    < up->getLx()*(1<<PADN)
-    //           <=>
-    //  0 <= xL0 + k*deltaXL
-    //    <= lxPred
-    //
-    //  0 <= yL0 + k*deltaYL
-    //    < up->getLy()*(1<<PADN)
-    //           <=>
-    //  0 <= yL0 + k*deltaYL
-    //    <= lyPred
+    //  0 <= xL0 + k*deltaXL <= (up->getLx() - 2)*(1<<PADN)
+    //             <=>
+    //  0 <= xL0 + k*deltaXL <= lxPred
+
+    //  0 <= yL0 + k*deltaYL <= (up->getLy() - 2)*(1<<PADN)
+    //             <=>
+    //  0 <= yL0 + k*deltaYL <= lyPred
 
     //  calcola kMinX, kMaxX
     if (deltaXL == 0) {
-      // [a, b] verticale esterno ad up+(bordo destro/basso)
+      //  [a, b] verticale esterno ad up contratto
       if ((xL0 < 0) || (lxPred < xL0)) continue;
       //  altrimenti usa solo
       //  kMinY, kMaxY ((deltaXL != 0) || (deltaYL != 0))
     } else if (deltaXL > 0) {
-      //  [a, b] esterno ad up+(bordo destro/basso)
+      //  [a, b] esterno ad up+(bordo destro)
       if (lxPred < xL0) continue;
 
       kMaxX = (lxPred - xL0) / deltaXL;  //  floor
@@ -716,7 +1214,7 @@ void doQuickPutNoFilter(const TRaster32P &dn, const TRaster64P &up,
       }
     } else  //  (deltaXL < 0)
     {
-      //  [a, b] esterno ad up+(bordo destro/basso)
+      //  [a, b] esterno ad up contratto
       if (xL0 < 0) continue;
 
       kMaxX = xL0 / (-deltaXL);  //  floor
@@ -727,12 +1225,12 @@ void doQuickPutNoFilter(const TRaster32P &dn, const TRaster64P &up,
 
     //  calcola kMinY, kMaxY
     if (deltaYL == 0) {
-      //  [a, b] orizzontale esterno ad up+(bordo destro/basso)
+      // [a, b] orizzontale esterno ad up contratto
       if ((yL0 < 0) || (lyPred < yL0)) continue;
-      // altrimenti usa solo
-      // kMinX, kMaxX ((deltaXL != 0) || (deltaYL != 0))
+      //  altrimenti usa solo
+      //  kMinX, kMaxX ((deltaXL != 0) || (deltaYL != 0))
     } else if (deltaYL > 0) {
-      //  [a, b] esterno ad up+(bordo destro/basso)
+      //  [a, b] esterno ad up contratto
       if (lyPred < yL0) continue;
 
       kMaxY = (lyPred - yL0) / deltaYL;  //  floor
@@ -741,7 +1239,7 @@ void doQuickPutNoFilter(const TRaster32P &dn, const TRaster64P &up,
       }
     } else  //  (deltaYL < 0)
     {
-      //  [a, b] esterno ad up+(bordo destro/basso)
+      //  [a, b] esterno ad up contratto
       if (yL0 < 0) continue;
 
       kMaxY = yL0 / (-deltaYL);  //  floor
@@ -758,7 +1256,7 @@ void doQuickPutNoFilter(const TRaster32P &dn, const TRaster64P &up,
     TPixel32 *dnEndPix = dnRow + xMin + kMax + 1;
 
     //  (xL, yL) sono le coordinate (inizializzate per il round)
-    //  in versione "TLonghizzata" del pixel corrente di up
+    //  in versione "longhizzata" del pixel corrente di up
     int xL = xL0 + (kMin - 1) * deltaXL;  //  inizializza xL
     int yL = yL0 + (kMin - 1) * deltaYL;  //  inizializza yL
 
@@ -766,71 +1264,110 @@ void doQuickPutNoFilter(const TRaster32P &dn, const TRaster64P &up,
     for (; dnPix < dnEndPix; ++dnPix) {
       xL += deltaXL;
       yL += deltaYL;
-
       //  il punto di up TPointD(xL/(1<<PADN), yL/(1<<PADN)) e'
       //  approssimato con (xI, yI)
-      int xI = xL >> PADN;  //  round
-      int yI = yL >> PADN;  //  round
+      int xI = xL >> PADN;  //	troncato
+      int yI = yL >> PADN;  //	troncato
 
       assert((0 <= xI) && (xI <= up->getLx() - 1) && (0 <= yI) &&
              (yI <= up->getLy() - 1));
 
-      TPixel64 *upPix = upBasePix + (yI * upWrap + xI);
-      if (firstColumn) upPix->m = 65535;
-      if (upPix->m == 0)
-        continue;
-      else if (upPix->m == 65535)
-        *dnPix = PixelConverter<TPixel32>::from(*upPix);
-      else if (doPremultiply)
-        *dnPix =
-            quickOverPixPremult(*dnPix, PixelConverter<TPixel32>::from(*upPix));
-      else
-        *dnPix = quickOverPix(*dnPix, PixelConverter<TPixel32>::from(*upPix));
-    }
-  }
-  dn->unlock();
-  up->unlock();
-}
-//=============================================================================
-//=============================================================================
-//=============================================================================
+      //  (xI, yI)
+      TPixel32 *upPix00 = upBasePix + (yI * upWrap + xI);
 
-void doQuickPutNoFilter(const TRaster32P &dn, const TRasterGR8P &up,
-                        const TAffine &aff, const TPixel32 &colorScale) {
-  if ((aff.a11 * aff.a22 - aff.a12 * aff.a21) == 0) return;
-  const int PADN = 16;
-  assert(std::max(up->getLx(), up->getLy()) <
-         (1 << (8 * sizeof(int) - PADN - 1)));
+      //  (xI + 1, yI)
+      TPixel32 *upPix10 = upPix00 + 1;
 
-  TRectD boundingBoxD =
-      TRectD(convert(dn->getBounds())) *
-      (aff * TRectD(-0.5, -0.5, up->getLx() - 0.5, up->getLy() - 0.5));
+      //  (xI, yI + 1)
+      TPixel32 *upPix01 = upPix00 + upWrap;
 
-  if (boundingBoxD.x0 >= boundingBoxD.x1 || boundingBoxD.y0 >= boundingBoxD.y1)
-    return;
+      //  (xI + 1, yI + 1)
+      TPixel32 *upPix11 = upPix00 + upWrap + 1;
 
-  int yMin = std::max(tfloor(boundingBoxD.y0), 0);
+      //  filtro bilineare 4 pixels: calcolo dei pesi
+      int xWeight1 = (xL & MASKN);
+      int xWeight0 = (1 << PADN) - xWeight1;
+      int yWeight1 = (yL & MASKN);
+      int yWeight0 = (1 << PADN) - yWeight1;
 
-  int yMax = std::min(tceil(boundingBoxD.y1), dn->getLy() - 1);
+      //  filtro bilineare 4 pixels: media pesata sui singoli canali
+      int rColDownTmp =
+          (xWeight0 * (upPix00->r) + xWeight1 * ((upPix10)->r)) >> PADN;
 
-  int xMin = std::max(tfloor(boundingBoxD.x0), 0);
+      int gColDownTmp =
+          (xWeight0 * (upPix00->g) + xWeight1 * ((upPix10)->g)) >> PADN;
 
-  int xMax = std::min(tceil(boundingBoxD.x1), dn->getLx() - 1);
+      int bColDownTmp =
+          (xWeight0 * (upPix00->b) + xWeight1 * ((upPix10)->b)) >> PADN;
 
-  TAffine invAff = inv(aff);
+      int mColDownTmp =
+          (xWeight0 * (upPix00->m) + xWeight1 * ((upPix10)->m)) >> PADN;
 
-  double deltaXD = invAff.a11;
-  double deltaYD = invAff.a21;
+      int rColUpTmp =
+          (xWeight0 * ((upPix01)->r) + xWeight1 * ((upPix11)->r)) >> PADN;
 
-  int deltaXL = tround(deltaXD * (1 << PADN));
+      int gColUpTmp =
+          (xWeight0 * ((upPix01)->g) + xWeight1 * ((upPix11)->g)) >> PADN;
 
-  int deltaYL = tround(deltaYD * (1 << PADN));
+      int bColUpTmp =
+          (xWeight0 * ((upPix01)->b) + xWeight1 * ((upPix11)->b)) >> PADN;
 
-  if ((deltaXL == 0) && (deltaYL == 0)) return;
+      int mColUpTmp =
+          (xWeight0 * ((upPix01)->m) + xWeight1 * ((upPix11)->m)) >> PADN;
 
-  int lxPred = up->getLx() * (1 << PADN) - 1;
+      dnPix->r =
+          (unsigned char)((yWeight0 * rColDownTmp + yWeight1 * rColUpTmp) >>
+                          PADN);
+      dnPix->g =
+          (unsigned char)((yWeight0 * gColDownTmp + yWeight1 * gColUpTmp) >>
+                          PADN);
+      dnPix->b =
+          (unsigned char)((yWeight0 * bColDownTmp + yWeight1 * bColUpTmp) >>
+                          PADN);
+      dnPix->m =
+          (unsigned char)((yWeight0 * mColDownTmp + yWeight1 * mColUpTmp) >>
+                          PADN);
+    }
+  }
+  dn->unlock();
+  up->unlock();
+}
+//=============================================================================
+//=============================================================================
+//=============================================================================
 
-  int lyPred = up->getLy() * (1 << PADN) - 1;
+void doQuickResampleFilter(const TRaster32P &dn, const TRasterGR8P &up,
+                           const TAffine &aff) {
+  if ((aff.a11 * aff.a22 - aff.a12 * aff.a21) == 0) return;
+
+  const int PADN = 16;
+
+  const int MASKN = (1 << PADN) - 1;
+  assert(std::max(up->getLx(), up->getLy()) <
+         (1 << (8 * sizeof(int) - PADN - 1)));
+
+  TRectD boundingBoxD = TRectD(convert(dn->getSize())) *
+                        (aff * TRectD(0, 0, up->getLx() - 2, up->getLy() - 2));
+
+  //  clipping
+  if (boundingBoxD.x0 >= boundingBoxD.x1 || boundingBoxD.y0 >= boundingBoxD.y1)
+    return;
+
+  int yMin = std::max(tfloor(boundingBoxD.y0), 0);
+  int yMax = std::min(tceil(boundingBoxD.y1), dn->getLy() - 1);
+  int xMin = std::max(tfloor(boundingBoxD.x0), 0);
+  int xMax = std::min(tceil(boundingBoxD.x1), dn->getLx() - 1);
+
+  TAffine invAff = inv(aff);  //  inversa di aff
+
+  double deltaXD = invAff.a11;
+  double deltaYD = invAff.a21;
+  int deltaXL    = tround(deltaXD * (1 << PADN));
+  int deltaYL    = tround(deltaYD * (1 << PADN));
+  if ((deltaXL == 0) && (deltaYL == 0)) return;
+
+  int lxPred = (up->getLx() - 2) * (1 << PADN);
+  int lyPred = (up->getLy() - 2) * (1 << PADN);
 
   int dnWrap = dn->getWrap();
   int upWrap = up->getWrap();
@@ -842,11 +1379,8 @@ void doQuickPutNoFilter(const TRaster32P &dn, const TRasterGR8P &up,
 
   for (int y = yMin; y <= yMax; y++, dnRow += dnWrap) {
     TPointD a = invAff * TPointD(xMin, y);
-
-    int xL0 = tround((a.x + 0.5) * (1 << PADN));
-
-    int yL0 = tround((a.y + 0.5) * (1 << PADN));
-
+    int xL0   = tround(a.x * (1 << PADN));
+    int yL0   = tround(a.y * (1 << PADN));
     int kMinX = 0, kMaxX = xMax - xMin;  //  clipping su dn
     int kMinY = 0, kMaxY = xMax - xMin;  //  clipping su dn
 
@@ -859,9 +1393,7 @@ void doQuickPutNoFilter(const TRaster32P &dn, const TRasterGR8P &up,
       if (xL0 < 0) {
         kMinX = ((-xL0) + deltaXL - 1) / deltaXL;  //  ceil
       }
-    } else  //  (deltaXL < 0)
-    {
-      //  [a, b] esterno ad up+(bordo destro/basso)
+    } else {
       if (xL0 < 0) continue;
 
       kMaxX = xL0 / (-deltaXL);  //  floor
@@ -870,14 +1402,9 @@ void doQuickPutNoFilter(const TRaster32P &dn, const TRasterGR8P &up,
       }
     }
 
-    //  calcola kMinY, kMaxY
     if (deltaYL == 0) {
-      //  [a, b] orizzontale esterno ad up+(bordo destro/basso)
       if ((yL0 < 0) || (lyPred < yL0)) continue;
-      // altrimenti usa solo
-      // kMinX, kMaxX ((deltaXL != 0) || (deltaYL != 0))
     } else if (deltaYL > 0) {
-      //  [a, b] esterno ad up+(bordo destro/basso)
       if (lyPred < yL0) continue;
 
       kMaxY = (lyPred - yL0) / deltaYL;  //  floor
@@ -886,7 +1413,6 @@ void doQuickPutNoFilter(const TRaster32P &dn, const TRasterGR8P &up,
       }
     } else  //  (deltaYL < 0)
     {
-      //  [a, b] esterno ad up+(bordo destro/basso)
       if (yL0 < 0) continue;
 
       kMaxY = yL0 / (-deltaYL);  //  floor
@@ -895,49 +1421,56 @@ void doQuickPutNoFilter(const TRaster32P &dn, const TRasterGR8P &up,
       }
     }
 
-    //  calcola kMin, kMax effettuando anche il clippind su dn
     int kMin = std::max({kMinX, kMinY, (int)0});
     int kMax = std::min({kMaxX, kMaxY, xMax - xMin});
 
     TPixel32 *dnPix    = dnRow + xMin + kMin;
     TPixel32 *dnEndPix = dnRow + xMin + kMax + 1;
 
-    //  (xL, yL) sono le coordinate (inizializzate per il round)
-    //  in versione "TLonghizzata" del pixel corrente di up
     int xL = xL0 + (kMin - 1) * deltaXL;  //  inizializza xL
     int yL = yL0 + (kMin - 1) * deltaYL;  //  inizializza yL
 
-    //  scorre i pixel sulla y-esima scanline di boundingBoxD
     for (; dnPix < dnEndPix; ++dnPix) {
       xL += deltaXL;
       yL += deltaYL;
 
-      //  il punto di up TPointD(xL/(1<<PADN), yL/(1<<PADN)) e'
-      //  approssimato con (xI, yI)
-      int xI = xL >> PADN;  //  round
-      int yI = yL >> PADN;  //  round
+      int xI = xL >> PADN;  //	troncato
+      int yI = yL >> PADN;  //	troncato
 
       assert((0 <= xI) && (xI <= up->getLx() - 1) && (0 <= yI) &&
              (yI <= up->getLy() - 1));
 
-      TPixelGR8 *upPix = upBasePix + (yI * upWrap + xI);
-      if (colorScale == TPixel32::Black) {
-        if (upPix->value == 0)
-          dnPix->r = dnPix->g = dnPix->b = 0;
-        else if (upPix->value == 255)
-          dnPix->r = dnPix->g = dnPix->b = upPix->value;
-        else
-          *dnPix = quickOverPix(*dnPix, *upPix);
-        dnPix->m = 255;
-      } else {
-        TPixel32 upPix32(upPix->value, upPix->value, upPix->value, 255);
-        upPix32 = applyColorScale(upPix32, colorScale);
+      //  (xI, yI)
+      TPixelGR8 *upPix00 = upBasePix + (yI * upWrap + xI);
 
-        if (upPix32.m == 255)
-          *dnPix = upPix32;
-        else
-          *dnPix = quickOverPix(*dnPix, upPix32);
-      }
+      //  (xI + 1, yI)
+      TPixelGR8 *upPix10 = upPix00 + 1;
+
+      //  (xI, yI + 1)
+      TPixelGR8 *upPix01 = upPix00 + upWrap;
+
+      //  (xI + 1, yI + 1)
+      TPixelGR8 *upPix11 = upPix00 + upWrap + 1;
+
+      //  filtro bilineare 4 pixels: calcolo dei pesi
+      int xWeight1 = (xL & MASKN);
+      int xWeight0 = (1 << PADN) - xWeight1;
+      int yWeight1 = (yL & MASKN);
+      int yWeight0 = (1 << PADN) - yWeight1;
+
+      //  filtro bilineare 4 pixels: media pesata sui singoli canali
+      int colDownTmp =
+          (xWeight0 * (upPix00->value) + xWeight1 * ((upPix10)->value)) >> PADN;
+
+      int colUpTmp =
+          (xWeight0 * ((upPix01)->value) + xWeight1 * ((upPix11)->value)) >>
+          PADN;
+
+      dnPix->r = dnPix->g = dnPix->b =
+          (unsigned char)((yWeight0 * colDownTmp + yWeight1 * colUpTmp) >>
+                          PADN);
+
+      dnPix->m = 255;
     }
   }
   dn->unlock();
@@ -945,19 +1478,13 @@ void doQuickPutNoFilter(const TRaster32P &dn, const TRasterGR8P &up,
 }
 //=============================================================================
 //=============================================================================
+//=============================================================================
 
-void doQuickPutNoFilter(const TRaster64P &dn, const TRaster64P &up,
-                        const TAffine &aff, bool doPremultiply,
-                        bool firstColumn) {
-  //  se aff := TAffine(sx, 0, tx, 0, sy, ty) e' degenere la controimmagine
-  //  di up e' un segmento (o un punto)
+void doQuickResampleColorFilter(const TRaster32P &dn, const TRaster32P &up,
+                                const TAffine &aff, UCHAR colorMask) {
   if ((aff.a11 * aff.a22 - aff.a12 * aff.a21) == 0) return;
-
-  //  contatore bit di shift
   const int PADN = 16;
 
-  //  max dimensioni di up gestibili (limite imposto dal numero di bit
-  //  disponibili per la parte intera di xL, yL)
   assert(std::max(up->getLx(), up->getLy()) <
          (1 << (8 * sizeof(int) - PADN - 1)));
 
@@ -965,223 +1492,116 @@ void doQuickPutNoFilter(const TRaster64P &dn, const TRaster64P &up,
       TRectD(convert(dn->getBounds())) *
       (aff * TRectD(-0.5, -0.5, up->getLx() - 0.5, up->getLy() - 0.5));
 
-  //  clipping
   if (boundingBoxD.x0 >= boundingBoxD.x1 || boundingBoxD.y0 >= boundingBoxD.y1)
     return;
 
-  //  clipping y su dn
-  int yMin = std::max(tfloor(boundingBoxD.y0), 0);
-
-  //  clipping y su dn
-  int yMax = std::min(tceil(boundingBoxD.y1), dn->getLy() - 1);
-
-  //  clipping x su dn
-  int xMin = std::max(tfloor(boundingBoxD.x0), 0);
-
-  //  clipping x su dn
-  int xMax = std::min(tceil(boundingBoxD.x1), dn->getLx() - 1);
+  int yMin = std::max(tfloor(boundingBoxD.y0), 0);  //  clipping y su dn
+  int yMax =
+      std::min(tceil(boundingBoxD.y1), dn->getLy() - 1);  //  clipping y su dn
+  int xMin = std::max(tfloor(boundingBoxD.x0), 0);        //  clipping x su dn
+  int xMax =
+      std::min(tceil(boundingBoxD.x1), dn->getLx() - 1);  //  clipping x su dn
 
-  //  inversa di aff
-  TAffine invAff = inv(aff);
+  TAffine invAff = inv(aff);  //  inversa di aff
 
-  //  nel disegnare la y-esima scanline di dn, il passaggio al pixel
-  //  successivo comporta l'incremento (deltaXD, deltaYD) delle coordinate del
-  //  pixel corrispondente di up
   double deltaXD = invAff.a11;
   double deltaYD = invAff.a21;
-
-  //  deltaXD "TLonghizzato" (round)
-  int deltaXL = tround(deltaXD * (1 << PADN));
-
-  //  deltaYD "TLonghizzato" (round)
-  int deltaYL = tround(deltaYD * (1 << PADN));
-
-  //  se aff "TLonghizzata" (round) e' degenere la controimmagine di up e' un
-  //  segmento (o un punto)
+  int deltaXL =
+      tround(deltaXD * (1 << PADN));  //  deltaXD "TLonghizzato" (round)
+  int deltaYL =
+      tround(deltaYD * (1 << PADN));  //  deltaYD "TLonghizzato" (round)
   if ((deltaXL == 0) && (deltaYL == 0)) return;
 
-  //  TINT32 predecessore di up->getLx()
-  int lxPred = up->getLx() * (1 << PADN) - 1;
-
-  //  TINT32 predecessore di up->getLy()
-  int lyPred = up->getLy() * (1 << PADN) - 1;
+  int lxPred =
+      up->getLx() * (1 << PADN) - 1;  //  TINT32 predecessore di up->getLx()
+  int lyPred =
+      up->getLy() * (1 << PADN) - 1;  //  TINT32 predecessore di up->getLy()
 
   int dnWrap = dn->getWrap();
   int upWrap = up->getWrap();
   dn->lock();
   up->lock();
 
-  TPixel64 *dnRow     = dn->pixels(yMin);
-  TPixel64 *upBasePix = up->pixels();
+  TPixel32 *dnRow     = dn->pixels(yMin);
+  TPixel32 *upBasePix = up->pixels();
 
-  //  scorre le scanline di boundingBoxD
   for (int y = yMin; y <= yMax; y++, dnRow += dnWrap) {
-    //  (1)  equazione k-parametrica della y-esima scanline di boundingBoxD:
-    //       (xMin, y) + k*(1, 0),  k = 0, ..., (xMax - xMin)
-
-    //  (2)  equazione k-parametrica dell'immagine mediante invAff di (1):
-    //       invAff*(xMin, y) + k*(deltaXD, deltaYD),
-    //       k = kMin, ..., kMax con 0 <= kMin <= kMax <= (xMax - xMin)
-
-    //  calcola kMin, kMax per la scanline corrente
-    //  intersecando la (2) con i lati di up
-
-    //  il segmento [a, b] di up e' la controimmagine mediante aff della
-    //  porzione di scanline  [ (xMin, y), (xMax, y) ] di dn
-
-    //  TPointD b = invAff*TPointD(xMax, y);
     TPointD a = invAff * TPointD(xMin, y);
-
-    //  (xL0, yL0) sono le coordinate di a (inizializzate per il round)
-    //  in versione "TLonghizzata"
-    //  0 <= xL0 + k*deltaXL
-    //    <  up->getLx()*(1<<PADN)
-    //
-    //  0 <= kMinX
-    //    <= kMin
-    //    <= k
-    //    <= kMax
-    //    <= kMaxX
-    //    <= (xMax - xMin)
-    //
-    //  0 <= yL0 + k*deltaYL
-    //    < up->getLy()*(1<<PADN)
-
-    //  0 <= kMinY
-    //    <= kMin
-    //    <= k
-    //    <= kMax
-    //    <= kMaxY
-    //    <= (xMax - xMin)
-
-    //  xL0 inizializzato per il round
-    int xL0 = tround((a.x + 0.5) * (1 << PADN));
-
-    //  yL0 inizializzato per il round
-    int yL0 = tround((a.y + 0.5) * (1 << PADN));
-
-    //  calcola kMinX, kMaxX, kMinY, kMaxY
+    int xL0   = tround((a.x + 0.5) * (1 << PADN));
+    int yL0   = tround((a.y + 0.5) * (1 << PADN));
     int kMinX = 0, kMaxX = xMax - xMin;  //  clipping su dn
     int kMinY = 0, kMaxY = xMax - xMin;  //  clipping su dn
-
-    //  0 <= xL0 + k*deltaXL
-    //    < up->getLx()*(1<<PADN)
-    //           <=>
-    //  0 <= xL0 + k*deltaXL
-    //    <= lxPred
-    //
-    //  0 <= yL0 + k*deltaYL
-    //    < up->getLy()*(1<<PADN)
-    //           <=>
-    //  0 <= yL0 + k*deltaYL
-    //    <= lyPred
-
-    //  calcola kMinX, kMaxX
     if (deltaXL == 0) {
-      // [a, b] verticale esterno ad up+(bordo destro/basso)
       if ((xL0 < 0) || (lxPred < xL0)) continue;
-      //  altrimenti usa solo
-      //  kMinY, kMaxY ((deltaXL != 0) || (deltaYL != 0))
     } else if (deltaXL > 0) {
-      //  [a, b] esterno ad up+(bordo destro/basso)
       if (lxPred < xL0) continue;
 
-      kMaxX = (lxPred - xL0) / deltaXL;  //  floor
-      if (xL0 < 0) {
-        kMinX = ((-xL0) + deltaXL - 1) / deltaXL;  //  ceil
-      }
-    } else  //  (deltaXL < 0)
+      kMaxX = (lxPred - xL0) / deltaXL;                       //  floor
+      if (xL0 < 0) kMinX = ((-xL0) + deltaXL - 1) / deltaXL;  //  ceil
+    } else                                                    //  (deltaXL < 0)
     {
-      //  [a, b] esterno ad up+(bordo destro/basso)
       if (xL0 < 0) continue;
-
       kMaxX = xL0 / (-deltaXL);  //  floor
-      if (lxPred < xL0) {
+      if (lxPred < xL0)
         kMinX = (xL0 - lxPred - deltaXL - 1) / (-deltaXL);  //  ceil
-      }
     }
-
-    //  calcola kMinY, kMaxY
     if (deltaYL == 0) {
-      //  [a, b] orizzontale esterno ad up+(bordo destro/basso)
       if ((yL0 < 0) || (lyPred < yL0)) continue;
-      // altrimenti usa solo
-      // kMinX, kMaxX ((deltaXL != 0) || (deltaYL != 0))
     } else if (deltaYL > 0) {
-      //  [a, b] esterno ad up+(bordo destro/basso)
       if (lyPred < yL0) continue;
 
-      kMaxY = (lyPred - yL0) / deltaYL;  //  floor
-      if (yL0 < 0) {
-        kMinY = ((-yL0) + deltaYL - 1) / deltaYL;  //  ceil
-      }
-    } else  //  (deltaYL < 0)
+      kMaxY = (lyPred - yL0) / deltaYL;                       //  floor
+      if (yL0 < 0) kMinY = ((-yL0) + deltaYL - 1) / deltaYL;  //  ceil
+    } else                                                    //  (deltaYL < 0)
     {
-      //  [a, b] esterno ad up+(bordo destro/basso)
       if (yL0 < 0) continue;
 
       kMaxY = yL0 / (-deltaYL);  //  floor
-      if (lyPred < yL0) {
+      if (lyPred < yL0)
         kMinY = (yL0 - lyPred - deltaYL - 1) / (-deltaYL);  //  ceil
-      }
     }
-
-    //  calcola kMin, kMax effettuando anche il clippind su dn
-    int kMin = std::max({kMinX, kMinY, (int)0});
-    int kMax = std::min({kMaxX, kMaxY, xMax - xMin});
-
-    TPixel64 *dnPix    = dnRow + xMin + kMin;
-    TPixel64 *dnEndPix = dnRow + xMin + kMax + 1;
-
-    //  (xL, yL) sono le coordinate (inizializzate per il round)
-    //  in versione "TLonghizzata" del pixel corrente di up
-    int xL = xL0 + (kMin - 1) * deltaXL;  //  inizializza xL
-    int yL = yL0 + (kMin - 1) * deltaYL;  //  inizializza yL
-
-    //  scorre i pixel sulla y-esima scanline di boundingBoxD
+    int kMin           = std::max({kMinX, kMinY, (int)0});
+    int kMax           = std::min({kMaxX, kMaxY, xMax - xMin});
+    TPixel32 *dnPix    = dnRow + xMin + kMin;
+    TPixel32 *dnEndPix = dnRow + xMin + kMax + 1;
+    int xL             = xL0 + (kMin - 1) * deltaXL;  //  inizializza xL
+    int yL             = yL0 + (kMin - 1) * deltaYL;  //  inizializza yL
     for (; dnPix < dnEndPix; ++dnPix) {
       xL += deltaXL;
       yL += deltaYL;
-
-      //  il punto di up TPointD(xL/(1<<PADN), yL/(1<<PADN)) e'
-      //  approssimato con (xI, yI)
       int xI = xL >> PADN;  //  round
       int yI = yL >> PADN;  //  round
 
       assert((0 <= xI) && (xI <= up->getLx() - 1) && (0 <= yI) &&
              (yI <= up->getLy() - 1));
 
-      TPixel64 upPix = *(upBasePix + (yI * upWrap + xI));
-
-      if (firstColumn) upPix.m = 65535;
-      if (upPix.m == 0) continue;
-
-      if (upPix.m == 65535)
-        *dnPix = upPix;
-      else if (doPremultiply)
-        *dnPix = quickOverPixPremult(*dnPix, upPix);
-      else
-        *dnPix = quickOverPix(*dnPix, upPix);
+      if (colorMask == TRop::MChan)
+        dnPix->r = dnPix->g = dnPix->b = (upBasePix + (yI * upWrap + xI))->m;
+      else {
+        TPixel32 *pix = upBasePix + (yI * upWrap + xI);
+        dnPix->r      = ((colorMask & TRop::RChan) ? pix->r : 0);
+        dnPix->g      = ((colorMask & TRop::GChan) ? pix->g : 0);
+        dnPix->b      = ((colorMask & TRop::BChan) ? pix->b : 0);
+      }
+      dnPix->m = 255;
     }
   }
   dn->unlock();
   up->unlock();
 }
+//=============================================================================
+//=============================================================================
+//=============================================================================
 
+//=============================================================================
+//=============================================================================
 //=============================================================================
 
-void doQuickPutNoFilter(const TRaster64P &dn, const TRasterFP &up,
-                        const TAffine &aff, bool doPremultiply,
-                        bool firstColumn) {
-  //  se aff := TAffine(sx, 0, tx, 0, sy, ty) e' degenere la controimmagine
-  //  di up e' un segmento (o un punto)
+void doQuickResampleColorFilter(const TRaster32P &dn, const TRaster64P &up,
+                                const TAffine &aff, UCHAR colorMask) {
   if ((aff.a11 * aff.a22 - aff.a12 * aff.a21) == 0) return;
-
-  //  contatore bit di shift
   const int PADN = 16;
 
-  //  max dimensioni di up gestibili (limite imposto dal numero di bit
-  //  disponibili per la parte intera di xL, yL)
   assert(std::max(up->getLx(), up->getLy()) <
          (1 << (8 * sizeof(int) - PADN - 1)));
 
@@ -1189,230 +1609,129 @@ void doQuickPutNoFilter(const TRaster64P &dn, const TRasterFP &up,
       TRectD(convert(dn->getBounds())) *
       (aff * TRectD(-0.5, -0.5, up->getLx() - 0.5, up->getLy() - 0.5));
 
-  //  clipping
   if (boundingBoxD.x0 >= boundingBoxD.x1 || boundingBoxD.y0 >= boundingBoxD.y1)
     return;
 
-  //  clipping y su dn
-  int yMin = std::max(tfloor(boundingBoxD.y0), 0);
-
-  //  clipping y su dn
-  int yMax = std::min(tceil(boundingBoxD.y1), dn->getLy() - 1);
-
-  //  clipping x su dn
-  int xMin = std::max(tfloor(boundingBoxD.x0), 0);
-
-  //  clipping x su dn
-  int xMax = std::min(tceil(boundingBoxD.x1), dn->getLx() - 1);
+  int yMin = std::max(tfloor(boundingBoxD.y0), 0);  //  clipping y su dn
+  int yMax =
+      std::min(tceil(boundingBoxD.y1), dn->getLy() - 1);  //  clipping y su dn
+  int xMin = std::max(tfloor(boundingBoxD.x0), 0);        //  clipping x su dn
+  int xMax =
+      std::min(tceil(boundingBoxD.x1), dn->getLx() - 1);  //  clipping x su dn
 
-  //  inversa di aff
-  TAffine invAff = inv(aff);
+  TAffine invAff = inv(aff);  //  inversa di aff
 
-  //  nel disegnare la y-esima scanline di dn, il passaggio al pixel
-  //  successivo comporta l'incremento (deltaXD, deltaYD) delle coordinate del
-  //  pixel corrispondente di up
   double deltaXD = invAff.a11;
   double deltaYD = invAff.a21;
-
-  //  deltaXD "TLonghizzato" (round)
-  int deltaXL = tround(deltaXD * (1 << PADN));
-
-  //  deltaYD "TLonghizzato" (round)
-  int deltaYL = tround(deltaYD * (1 << PADN));
-
-  //  se aff "TLonghizzata" (round) e' degenere la controimmagine di up e' un
-  //  segmento (o un punto)
+  int deltaXL =
+      tround(deltaXD * (1 << PADN));  //  deltaXD "TLonghizzato" (round)
+  int deltaYL =
+      tround(deltaYD * (1 << PADN));  //  deltaYD "TLonghizzato" (round)
   if ((deltaXL == 0) && (deltaYL == 0)) return;
 
-  //  TINT32 predecessore di up->getLx()
-  int lxPred = up->getLx() * (1 << PADN) - 1;
-
-  //  TINT32 predecessore di up->getLy()
-  int lyPred = up->getLy() * (1 << PADN) - 1;
+  int lxPred =
+      up->getLx() * (1 << PADN) - 1;  //  TINT32 predecessore di up->getLx()
+  int lyPred =
+      up->getLy() * (1 << PADN) - 1;  //  TINT32 predecessore di up->getLy()
 
   int dnWrap = dn->getWrap();
   int upWrap = up->getWrap();
   dn->lock();
   up->lock();
 
-  TPixel64 *dnRow    = dn->pixels(yMin);
-  TPixelF *upBasePix = up->pixels();
+  TPixel32 *dnRow     = dn->pixels(yMin);
+  TPixel64 *upBasePix = up->pixels();
 
-  //  scorre le scanline di boundingBoxD
   for (int y = yMin; y <= yMax; y++, dnRow += dnWrap) {
-    //  (1)  equazione k-parametrica della y-esima scanline di boundingBoxD:
-    //       (xMin, y) + k*(1, 0),  k = 0, ..., (xMax - xMin)
-
-    //  (2)  equazione k-parametrica dell'immagine mediante invAff di (1):
-    //       invAff*(xMin, y) + k*(deltaXD, deltaYD),
-    //       k = kMin, ..., kMax con 0 <= kMin <= kMax <= (xMax - xMin)
-
-    //  calcola kMin, kMax per la scanline corrente
-    //  intersecando la (2) con i lati di up
-
-    //  il segmento [a, b] di up e' la controimmagine mediante aff della
-    //  porzione di scanline  [ (xMin, y), (xMax, y) ] di dn
-
-    //  TPointD b = invAff*TPointD(xMax, y);
     TPointD a = invAff * TPointD(xMin, y);
-
-    //  (xL0, yL0) sono le coordinate di a (inizializzate per il round)
-    //  in versione "TLonghizzata"
-    //  0 <= xL0 + k*deltaXL
-    //    <  up->getLx()*(1<<PADN)
-    //
-    //  0 <= kMinX
-    //    <= kMin
-    //    <= k
-    //    <= kMax
-    //    <= kMaxX
-    //    <= (xMax - xMin)
-    //
-    //  0 <= yL0 + k*deltaYL
-    //    < up->getLy()*(1<<PADN)
-
-    //  0 <= kMinY
-    //    <= kMin
-    //    <= k
-    //    <= kMax
-    //    <= kMaxY
-    //    <= (xMax - xMin)
-
-    //  xL0 inizializzato per il round
-    int xL0 = tround((a.x + 0.5) * (1 << PADN));
-
-    //  yL0 inizializzato per il round
-    int yL0 = tround((a.y + 0.5) * (1 << PADN));
-
-    //  calcola kMinX, kMaxX, kMinY, kMaxY
+    int xL0   = tround((a.x + 0.5) * (1 << PADN));
+    int yL0   = tround((a.y + 0.5) * (1 << PADN));
     int kMinX = 0, kMaxX = xMax - xMin;  //  clipping su dn
     int kMinY = 0, kMaxY = xMax - xMin;  //  clipping su dn
-
-    //  0 <= xL0 + k*deltaXL
-    //    < up->getLx()*(1<<PADN)
-    //           <=>
-    //  0 <= xL0 + k*deltaXL
-    //    <= lxPred
-    //
-    //  0 <= yL0 + k*deltaYL
-    //    < up->getLy()*(1<<PADN)
-    //           <=>
-    //  0 <= yL0 + k*deltaYL
-    //    <= lyPred
-
-    //  calcola kMinX, kMaxX
     if (deltaXL == 0) {
-      // [a, b] verticale esterno ad up+(bordo destro/basso)
       if ((xL0 < 0) || (lxPred < xL0)) continue;
-      //  altrimenti usa solo
-      //  kMinY, kMaxY ((deltaXL != 0) || (deltaYL != 0))
     } else if (deltaXL > 0) {
-      //  [a, b] esterno ad up+(bordo destro/basso)
       if (lxPred < xL0) continue;
 
-      kMaxX = (lxPred - xL0) / deltaXL;  //  floor
-      if (xL0 < 0) {
-        kMinX = ((-xL0) + deltaXL - 1) / deltaXL;  //  ceil
-      }
-    } else  //  (deltaXL < 0)
+      kMaxX = (lxPred - xL0) / deltaXL;                       //  floor
+      if (xL0 < 0) kMinX = ((-xL0) + deltaXL - 1) / deltaXL;  //  ceil
+    } else                                                    //  (deltaXL < 0)
     {
-      //  [a, b] esterno ad up+(bordo destro/basso)
       if (xL0 < 0) continue;
-
       kMaxX = xL0 / (-deltaXL);  //  floor
-      if (lxPred < xL0) {
+      if (lxPred < xL0)
         kMinX = (xL0 - lxPred - deltaXL - 1) / (-deltaXL);  //  ceil
-      }
     }
-
-    //  calcola kMinY, kMaxY
     if (deltaYL == 0) {
-      //  [a, b] orizzontale esterno ad up+(bordo destro/basso)
       if ((yL0 < 0) || (lyPred < yL0)) continue;
-      // altrimenti usa solo
-      // kMinX, kMaxX ((deltaXL != 0) || (deltaYL != 0))
     } else if (deltaYL > 0) {
-      //  [a, b] esterno ad up+(bordo destro/basso)
       if (lyPred < yL0) continue;
 
-      kMaxY = (lyPred - yL0) / deltaYL;  //  floor
-      if (yL0 < 0) {
-        kMinY = ((-yL0) + deltaYL - 1) / deltaYL;  //  ceil
-      }
-    } else  //  (deltaYL < 0)
+      kMaxY = (lyPred - yL0) / deltaYL;                       //  floor
+      if (yL0 < 0) kMinY = ((-yL0) + deltaYL - 1) / deltaYL;  //  ceil
+    } else                                                    //  (deltaYL < 0)
     {
-      //  [a, b] esterno ad up+(bordo destro/basso)
       if (yL0 < 0) continue;
 
       kMaxY = yL0 / (-deltaYL);  //  floor
-      if (lyPred < yL0) {
+      if (lyPred < yL0)
         kMinY = (yL0 - lyPred - deltaYL - 1) / (-deltaYL);  //  ceil
-      }
     }
-
-    //  calcola kMin, kMax effettuando anche il clippind su dn
-    int kMin = std::max({kMinX, kMinY, (int)0});
-    int kMax = std::min({kMaxX, kMaxY, xMax - xMin});
-
-    TPixel64 *dnPix    = dnRow + xMin + kMin;
-    TPixel64 *dnEndPix = dnRow + xMin + kMax + 1;
-
-    //  (xL, yL) sono le coordinate (inizializzate per il round)
-    //  in versione "TLonghizzata" del pixel corrente di up
-    int xL = xL0 + (kMin - 1) * deltaXL;  //  inizializza xL
-    int yL = yL0 + (kMin - 1) * deltaYL;  //  inizializza yL
-
-    //  scorre i pixel sulla y-esima scanline di boundingBoxD
+    int kMin           = std::max({kMinX, kMinY, (int)0});
+    int kMax           = std::min({kMaxX, kMaxY, xMax - xMin});
+    TPixel32 *dnPix    = dnRow + xMin + kMin;
+    TPixel32 *dnEndPix = dnRow + xMin + kMax + 1;
+    int xL             = xL0 + (kMin - 1) * deltaXL;  //  inizializza xL
+    int yL             = yL0 + (kMin - 1) * deltaYL;  //  inizializza yL
     for (; dnPix < dnEndPix; ++dnPix) {
       xL += deltaXL;
       yL += deltaYL;
-
-      //  il punto di up TPointD(xL/(1<<PADN), yL/(1<<PADN)) e'
-      //  approssimato con (xI, yI)
       int xI = xL >> PADN;  //  round
       int yI = yL >> PADN;  //  round
 
       assert((0 <= xI) && (xI <= up->getLx() - 1) && (0 <= yI) &&
              (yI <= up->getLy() - 1));
 
-      TPixelF upPix = *(upBasePix + (yI * upWrap + xI));
-
-      if (firstColumn) upPix.m = 1.0;
-      if (upPix.m <= 0.0) continue;
-
-      TPixel64 upPix64 = toPixel64(upPix);
-      if (upPix.m >= 1.f)
-        *dnPix = upPix64;
-      else if (doPremultiply)
-        *dnPix = quickOverPixPremult(*dnPix, upPix64);
-      else
-        *dnPix = quickOverPix(*dnPix, upPix64);
+      if (colorMask == TRop::MChan)
+        dnPix->r = dnPix->g = dnPix->b =
+            byteFromUshort((upBasePix + (yI * upWrap + xI))->m);
+      else {
+        TPixel64 *pix = upBasePix + (yI * upWrap + xI);
+        dnPix->r = byteFromUshort(((colorMask & TRop::RChan) ? pix->r : 0));
+        dnPix->g = byteFromUshort(((colorMask & TRop::GChan) ? pix->g : 0));
+        dnPix->b = byteFromUshort(((colorMask & TRop::BChan) ? pix->b : 0));
+      }
+      dnPix->m = 255;
     }
   }
   dn->unlock();
   up->unlock();
 }
-
+//=============================================================================
+//=============================================================================
 //=============================================================================
 
-void doQuickPutNoFilter(const TRasterFP &dn, const TRasterFP &up,
-                        const TAffine &aff, bool doPremultiply,
-                        bool firstColumn) {
+void doQuickResampleFilter(const TRaster32P &dn, const TRaster32P &up,
+                           double sx, double sy, double tx, double ty) {
   //  se aff := TAffine(sx, 0, tx, 0, sy, ty) e' degenere la controimmagine
   //  di up e' un segmento (o un punto)
-  if ((aff.a11 * aff.a22 - aff.a12 * aff.a21) == 0) return;
+  if ((sx == 0) || (sy == 0)) return;
 
   //  contatore bit di shift
   const int PADN = 16;
 
+  //  maschera del filtro bilineare
+  const int MASKN = (1 << PADN) - 1;
+
   //  max dimensioni di up gestibili (limite imposto dal numero di bit
-  //  disponibili per la parte intera di xL, yL)
+  // disponibili per la parte intera di xL, yL)
   assert(std::max(up->getLx(), up->getLy()) <
          (1 << (8 * sizeof(int) - PADN - 1)));
 
+  TAffine aff(sx, 0, tx, 0, sy, ty);
   TRectD boundingBoxD =
-      TRectD(convert(dn->getBounds())) *
-      (aff * TRectD(-0.5, -0.5, up->getLx() - 0.5, up->getLy() - 0.5));
+      TRectD(convert(dn->getSize())) *
+      (aff * TRectD(0, 0, up->getLx() - /*1*/ 2, up->getLy() - /*1*/ 2));
 
   //  clipping
   if (boundingBoxD.x0 >= boundingBoxD.x1 || boundingBoxD.y0 >= boundingBoxD.y1)
@@ -1433,210 +1752,245 @@ void doQuickPutNoFilter(const TRasterFP &dn, const TRasterFP &up,
   //  inversa di aff
   TAffine invAff = inv(aff);
 
+  //  nello scorrere le scanline di boundingBoxD, il passaggio alla scanline
+  //  successiva comporta l'incremento (0, deltaYD) delle coordinate dei
+  //  pixels corrispondenti di up
+
   //  nel disegnare la y-esima scanline di dn, il passaggio al pixel
-  //  successivo comporta l'incremento (deltaXD, deltaYD) delle coordinate del
+  //  successivo comporta l'incremento (deltaXD, 0) delle coordinate del
   //  pixel corrispondente di up
+
   double deltaXD = invAff.a11;
-  double deltaYD = invAff.a21;
+  double deltaYD = invAff.a22;
+  int deltaXL =
+      tround(deltaXD * (1 << PADN));  //  deltaXD "TLonghizzato" (round)
+  int deltaYL =
+      tround(deltaYD * (1 << PADN));  //  deltaYD "TLonghizzato" (round)
 
-  //  deltaXD "TLonghizzato" (round)
-  int deltaXL = tround(deltaXD * (1 << PADN));
+  //  se aff "TLonghizzata" (round) e' degenere la controimmagine di up e'
+  //  un segmento (o un punto)
+  if ((deltaXL == 0) || (deltaYL == 0)) return;
 
-  //  deltaYD "TLonghizzato" (round)
-  int deltaYL = tround(deltaYD * (1 << PADN));
+  //  (1)  equazione (kX, kY)-parametrica di boundingBoxD:
+  //         (xMin, yMin) + kX*(1, 0) + kY*(0, 1),
+  //           kX = 0, ..., (xMax - xMin),
+  //           kY = 0, ..., (yMax - yMin)
 
-  //  se aff "TLonghizzata" (round) e' degenere la controimmagine di up e' un
-  //  segmento (o un punto)
-  if ((deltaXL == 0) && (deltaYL == 0)) return;
+  //  (2)  equazione (kX, kY)-parametrica dell'immagine mediante invAff di (1):
+  //         invAff*(xMin, yMin) + kX*(deltaXD, 0) + kY*(0, deltaYD),
+  //           kX = kMinX, ..., kMaxX
+  //             con 0 <= kMinX <= kMaxX <= (xMax - xMin)
+  //
+  //           kY = kMinY, ..., kMaxY
+  //             con 0 <= kMinY <= kMaxY <= (yMax - yMin)
 
-  //  TINT32 predecessore di up->getLx()
-  int lxPred = up->getLx() * (1 << PADN) - 1;
+  //  calcola kMinX, kMaxX, kMinY, kMaxY intersecando la (2) con i lati di up
 
-  //  TINT32 predecessore di up->getLy()
-  int lyPred = up->getLy() * (1 << PADN) - 1;
-
-  int dnWrap = dn->getWrap();
-  int upWrap = up->getWrap();
-  dn->lock();
-  up->lock();
-
-  TPixelF *dnRow     = dn->pixels(yMin);
-  TPixelF *upBasePix = up->pixels();
+  //  il segmento [a, b] di up (con gli estremi eventualmente invertiti) e'
+  //  la controimmagine mediante aff della porzione di scanline
+  //  [ (xMin, yMin), (xMax, yMin) ] di dn
 
-  //  scorre le scanline di boundingBoxD
-  for (int y = yMin; y <= yMax; y++, dnRow += dnWrap) {
-    //  (1)  equazione k-parametrica della y-esima scanline di boundingBoxD:
-    //       (xMin, y) + k*(1, 0),  k = 0, ..., (xMax - xMin)
+  //  TPointD b = invAff*TPointD(xMax, yMin);
+  TPointD a = invAff * TPointD(xMin, yMin);
 
-    //  (2)  equazione k-parametrica dell'immagine mediante invAff di (1):
-    //       invAff*(xMin, y) + k*(deltaXD, deltaYD),
-    //       k = kMin, ..., kMax con 0 <= kMin <= kMax <= (xMax - xMin)
+  //  (xL0, yL0) sono le coordinate di a (inizializzate per il round)
+  //  in versione "TLonghizzata"
+  //  0 <= xL0 + kX*deltaXL <= (up->getLx() - 2)*(1<<PADN),
+  //  0 <= kMinX <= kX <= kMaxX <= (xMax - xMin)
+  //  0 <= yL0 + kY*deltaYL <= (up->getLy() - 2)*(1<<PADN),
+  //  0 <= kMinY <= kY <= kMaxY <= (yMax - yMin)
 
-    //  calcola kMin, kMax per la scanline corrente
-    //  intersecando la (2) con i lati di up
+  int xL0 = tround(a.x * (1 << PADN));  //  xL0 inizializzato
+  int yL0 = tround(a.y * (1 << PADN));  //  yL0 inizializzato
 
-    //  il segmento [a, b] di up e' la controimmagine mediante aff della
-    //  porzione di scanline  [ (xMin, y), (xMax, y) ] di dn
+  //  calcola kMinY, kMaxY, kMinX, kMaxX intersecando la (2) con i lati di up
+  int kMinX = 0, kMaxX = xMax - xMin;  //  clipping su dn
+  int kMinY = 0, kMaxY = yMax - yMin;  //  clipping su dn
 
-    //  TPointD b = invAff*TPointD(xMax, y);
-    TPointD a = invAff * TPointD(xMin, y);
+  //  TINT32 predecessore di (up->getLx() - 1)
+  int lxPred = (up->getLx() - /*1*/ 2) * (1 << PADN);
 
-    //  (xL0, yL0) sono le coordinate di a (inizializzate per il round)
-    //  in versione "TLonghizzata"
-    //  0 <= xL0 + k*deltaXL
-    //    <  up->getLx()*(1<<PADN)
-    //
-    //  0 <= kMinX
-    //    <= kMin
-    //    <= k
-    //    <= kMax
-    //    <= kMaxX
-    //    <= (xMax - xMin)
-    //
-    //  0 <= yL0 + k*deltaYL
-    //    < up->getLy()*(1<<PADN)
+  //  TINT32 predecessore di (up->getLy() - 1)
+  int lyPred = (up->getLy() - /*1*/ 2) * (1 << PADN);
 
-    //  0 <= kMinY
-    //    <= kMin
-    //    <= k
-    //    <= kMax
-    //    <= kMaxY
-    //    <= (xMax - xMin)
+  //  0 <= xL0 + k*deltaXL <= (up->getLx() - 2)*(1<<PADN)
+  //               <=>
+  //  0 <= xL0 + k*deltaXL <= lxPred
 
-    //  xL0 inizializzato per il round
-    int xL0 = tround((a.x + 0.5) * (1 << PADN));
+  //  0 <= yL0 + k*deltaYL <= (up->getLy() - 2)*(1<<PADN)
+  //               <=>
+  //  0 <= yL0 + k*deltaYL <= lyPred
 
-    //  yL0 inizializzato per il round
-    int yL0 = tround((a.y + 0.5) * (1 << PADN));
+  //  calcola kMinY, kMaxY intersecando la (2) con i lati
+  //  (y = yMin) e (y = yMax) di up
+  if (deltaYL > 0)  //  (deltaYL != 0)
+  {
+    //  [a, b] interno ad up contratto
+    assert(yL0 <= lyPred);
 
-    //  calcola kMinX, kMaxX, kMinY, kMaxY
-    int kMinX = 0, kMaxX = xMax - xMin;  //  clipping su dn
-    int kMinY = 0, kMaxY = xMax - xMin;  //  clipping su dn
+    kMaxY = (lyPred - yL0) / deltaYL;  //  floor
+    if (yL0 < 0) {
+      kMinY = ((-yL0) + deltaYL - 1) / deltaYL;  //  ceil
+    }
+  } else  //  (deltaYL < 0)
+  {
+    //  [a, b] interno ad up contratto
+    assert(0 <= yL0);
 
-    //  0 <= xL0 + k*deltaXL
-    //    < up->getLx()*(1<<PADN)
-    //           <=>
-    //  0 <= xL0 + k*deltaXL
-    //    <= lxPred
-    //
-    //  0 <= yL0 + k*deltaYL
-    //    < up->getLy()*(1<<PADN)
-    //           <=>
-    //  0 <= yL0 + k*deltaYL
-    //    <= lyPred
+    kMaxY = yL0 / (-deltaYL);  //  floor
+    if (lyPred < yL0) {
+      kMinY = (yL0 - lyPred - deltaYL - 1) / (-deltaYL);  //  ceil
+    }
+  }
+  //  calcola kMinY, kMaxY effettuando anche il clippind su dn
+  kMinY = std::max(kMinY, (int)0);
+  kMaxY = std::min(kMaxY, yMax - yMin);
 
-    //  calcola kMinX, kMaxX
-    if (deltaXL == 0) {
-      // [a, b] verticale esterno ad up+(bordo destro/basso)
-      if ((xL0 < 0) || (lxPred < xL0)) continue;
-      //  altrimenti usa solo
-      //  kMinY, kMaxY ((deltaXL != 0) || (deltaYL != 0))
-    } else if (deltaXL > 0) {
-      //  [a, b] esterno ad up+(bordo destro/basso)
-      if (lxPred < xL0) continue;
+  //  calcola kMinX, kMaxX intersecando la (2) con i lati
+  //  (x = xMin) e (x = xMax) di up
+  if (deltaXL > 0)  //  (deltaXL != 0)
+  {
+    //  [a, b] interno ad up contratto
+    assert(xL0 <= lxPred);
 
-      kMaxX = (lxPred - xL0) / deltaXL;  //  floor
-      if (xL0 < 0) {
-        kMinX = ((-xL0) + deltaXL - 1) / deltaXL;  //  ceil
-      }
-    } else  //  (deltaXL < 0)
-    {
-      //  [a, b] esterno ad up+(bordo destro/basso)
-      if (xL0 < 0) continue;
+    kMaxX = (lxPred - xL0) / deltaXL;  //  floor
+    if (xL0 < 0) {
+      kMinX = ((-xL0) + deltaXL - 1) / deltaXL;  //  ceil
+    }
+  } else  //  (deltaXL < 0)
+  {
+    //  [a, b] interno ad up contratto
+    assert(0 <= xL0);
 
-      kMaxX = xL0 / (-deltaXL);  //  floor
-      if (lxPred < xL0) {
-        kMinX = (xL0 - lxPred - deltaXL - 1) / (-deltaXL);  //  ceil
-      }
+    kMaxX = xL0 / (-deltaXL);  //  floor
+    if (lxPred < xL0) {
+      kMinX = (xL0 - lxPred - deltaXL - 1) / (-deltaXL);  //  ceil
     }
+  }
+  //  calcola kMinX, kMaxX effettuando anche il clippind su dn
+  kMinX = std::max(kMinX, (int)0);
+  kMaxX = std::min(kMaxX, xMax - xMin);
 
-    //  calcola kMinY, kMaxY
-    if (deltaYL == 0) {
-      //  [a, b] orizzontale esterno ad up+(bordo destro/basso)
-      if ((yL0 < 0) || (lyPred < yL0)) continue;
-      // altrimenti usa solo
-      // kMinX, kMaxX ((deltaXL != 0) || (deltaYL != 0))
-    } else if (deltaYL > 0) {
-      //  [a, b] esterno ad up+(bordo destro/basso)
-      if (lyPred < yL0) continue;
+  int dnWrap = dn->getWrap();
+  int upWrap = up->getWrap();
 
-      kMaxY = (lyPred - yL0) / deltaYL;  //  floor
-      if (yL0 < 0) {
-        kMinY = ((-yL0) + deltaYL - 1) / deltaYL;  //  ceil
-      }
-    } else  //  (deltaYL < 0)
-    {
-      //  [a, b] esterno ad up+(bordo destro/basso)
-      if (yL0 < 0) continue;
+  dn->lock();
+  up->lock();
+  TPixel32 *upBasePix = up->pixels();
+  TPixel32 *dnRow     = dn->pixels(yMin + kMinY);
 
-      kMaxY = yL0 / (-deltaYL);  //  floor
-      if (lyPred < yL0) {
-        kMinY = (yL0 - lyPred - deltaYL - 1) / (-deltaYL);  //  ceil
-      }
-    }
+  //  (xL, yL) sono le coordinate (inizializzate per il round)
+  //  in versione "TLonghizzata"
+  //  del pixel corrente di up
+  int yL = yL0 + (kMinY - 1) * deltaYL;  //  inizializza yL
 
-    //  calcola kMin, kMax effettuando anche il clippind su dn
-    int kMin = std::max({kMinX, kMinY, (int)0});
-    int kMax = std::min({kMaxX, kMaxY, xMax - xMin});
+  //  scorre le scanline di boundingBoxD
+  for (int kY = kMinY; kY <= kMaxY; kY++, dnRow += dnWrap) {
+    int xL = xL0 + (kMinX - 1) * deltaXL;  //  inizializza xL
+    yL += deltaYL;
+    //  il punto di up TPointD(xL/(1<<PADN), yL/(1<<PADN)) e' approssimato
+    //  con (xI, yI)
+    int yI = yL >> PADN;  //  troncato
 
-    TPixelF *dnPix    = dnRow + xMin + kMin;
-    TPixelF *dnEndPix = dnRow + xMin + kMax + 1;
+    //  filtro bilineare 4 pixels: calcolo degli y-pesi
+    int yWeight1 = (yL & MASKN);
+    int yWeight0 = (1 << PADN) - yWeight1;
 
-    //  (xL, yL) sono le coordinate (inizializzate per il round)
-    //  in versione "TLonghizzata" del pixel corrente di up
-    int xL = xL0 + (kMin - 1) * deltaXL;  //  inizializza xL
-    int yL = yL0 + (kMin - 1) * deltaYL;  //  inizializza yL
+    TPixel32 *dnPix    = dnRow + xMin + kMinX;
+    TPixel32 *dnEndPix = dnRow + xMin + kMaxX + 1;
 
-    //  scorre i pixel sulla y-esima scanline di boundingBoxD
+    //  scorre i pixel sulla (yMin + kY)-esima scanline di dn
     for (; dnPix < dnEndPix; ++dnPix) {
       xL += deltaXL;
-      yL += deltaYL;
-
       //  il punto di up TPointD(xL/(1<<PADN), yL/(1<<PADN)) e'
       //  approssimato con (xI, yI)
-      int xI = xL >> PADN;  //  round
-      int yI = yL >> PADN;  //  round
+      int xI = xL >> PADN;  //  troncato
 
       assert((0 <= xI) && (xI <= up->getLx() - 1) && (0 <= yI) &&
              (yI <= up->getLy() - 1));
 
-      TPixelF upPix = *(upBasePix + (yI * upWrap + xI));
+      //  (xI, yI)
+      TPixel32 *upPix00 = upBasePix + (yI * upWrap + xI);
+
+      //  (xI + 1, yI)
+      TPixel32 *upPix10 = upPix00 + 1;
 
-      if (firstColumn) upPix.m = 1.0;
-      if (upPix.m <= 0.0) continue;
+      //  (xI, yI + 1)
+      TPixel32 *upPix01 = upPix00 + upWrap;
 
-      if (upPix.m >= 1.f)
-        *dnPix = upPix;
-      else if (doPremultiply)
-        *dnPix = quickOverPixPremult(*dnPix, upPix);
-      else
-        *dnPix = quickOverPix(*dnPix, upPix);
+      //  (xI + 1, yI + 1)
+      TPixel32 *upPix11 = upPix00 + upWrap + 1;
+
+      //  filtro bilineare 4 pixels: calcolo degli x-pesi
+      int xWeight1 = (xL & MASKN);
+      int xWeight0 = (1 << PADN) - xWeight1;
+
+      //  filtro bilineare 4 pixels: media pesata sui singoli canali
+      int rColDownTmp =
+          (xWeight0 * (upPix00->r) + xWeight1 * ((upPix10)->r)) >> PADN;
+
+      int gColDownTmp =
+          (xWeight0 * (upPix00->g) + xWeight1 * ((upPix10)->g)) >> PADN;
+
+      int bColDownTmp =
+          (xWeight0 * (upPix00->b) + xWeight1 * ((upPix10)->b)) >> PADN;
+
+      int mColDownTmp =
+          (xWeight0 * (upPix00->m) + xWeight1 * ((upPix10)->m)) >> PADN;
+
+      int rColUpTmp =
+          (xWeight0 * ((upPix01)->r) + xWeight1 * ((upPix11)->r)) >> PADN;
+
+      int gColUpTmp =
+          (xWeight0 * ((upPix01)->g) + xWeight1 * ((upPix11)->g)) >> PADN;
+
+      int bColUpTmp =
+          (xWeight0 * ((upPix01)->b) + xWeight1 * ((upPix11)->b)) >> PADN;
+
+      int mColUpTmp =
+          (xWeight0 * ((upPix01)->m) + xWeight1 * ((upPix11)->m)) >> PADN;
+
+      dnPix->r =
+          (unsigned char)((yWeight0 * rColDownTmp + yWeight1 * rColUpTmp) >>
+                          PADN);
+      dnPix->g =
+          (unsigned char)((yWeight0 * gColDownTmp + yWeight1 * gColUpTmp) >>
+                          PADN);
+      dnPix->b =
+          (unsigned char)((yWeight0 * bColDownTmp + yWeight1 * bColUpTmp) >>
+                          PADN);
+      dnPix->m =
+          (unsigned char)((yWeight0 * mColDownTmp + yWeight1 * mColUpTmp) >>
+                          PADN);
     }
   }
   dn->unlock();
   up->unlock();
 }
 
-//=============================================================================
+//------------------------------------------------------------------------------------------
 
-void doQuickPutNoFilter(const TRaster64P &dn, const TRaster32P &up,
-                        const TAffine &aff, bool doPremultiply,
-                        bool firstColumn) {
+void doQuickResampleFilter(const TRaster32P &dn, const TRasterGR8P &up,
+                           double sx, double sy, double tx, double ty) {
   //  se aff := TAffine(sx, 0, tx, 0, sy, ty) e' degenere la controimmagine
   //  di up e' un segmento (o un punto)
-  if ((aff.a11 * aff.a22 - aff.a12 * aff.a21) == 0) return;
+  if ((sx == 0) || (sy == 0)) return;
 
   //  contatore bit di shift
   const int PADN = 16;
 
+  //  maschera del filtro bilineare
+  const int MASKN = (1 << PADN) - 1;
+
   //  max dimensioni di up gestibili (limite imposto dal numero di bit
-  //  disponibili per la parte intera di xL, yL)
+  // disponibili per la parte intera di xL, yL)
   assert(std::max(up->getLx(), up->getLy()) <
          (1 << (8 * sizeof(int) - PADN - 1)));
 
+  TAffine aff(sx, 0, tx, 0, sy, ty);
   TRectD boundingBoxD =
-      TRectD(convert(dn->getBounds())) *
-      (aff * TRectD(-0.5, -0.5, up->getLx() - 0.5, up->getLy() - 0.5));
+      TRectD(convert(dn->getSize())) *
+      (aff * TRectD(0, 0, up->getLx() - /*1*/ 2, up->getLy() - /*1*/ 2));
 
   //  clipping
   if (boundingBoxD.x0 >= boundingBoxD.x1 || boundingBoxD.y0 >= boundingBoxD.y1)
@@ -1657,2619 +2011,190 @@ void doQuickPutNoFilter(const TRaster64P &dn, const TRaster32P &up,
   //  inversa di aff
   TAffine invAff = inv(aff);
 
+  //  nello scorrere le scanline di boundingBoxD, il passaggio alla scanline
+  //  successiva comporta l'incremento (0, deltaYD) delle coordinate dei
+  //  pixels corrispondenti di up
+
   //  nel disegnare la y-esima scanline di dn, il passaggio al pixel
-  //  successivo comporta l'incremento (deltaXD, deltaYD) delle coordinate del
+  //  successivo comporta l'incremento (deltaXD, 0) delle coordinate del
   //  pixel corrispondente di up
-  double deltaXD = invAff.a11;
-  double deltaYD = invAff.a21;
-
-  //  deltaXD "TLonghizzato" (round)
-  int deltaXL = tround(deltaXD * (1 << PADN));
 
-  //  deltaYD "TLonghizzato" (round)
-  int deltaYL = tround(deltaYD * (1 << PADN));
+  double deltaXD = invAff.a11;
+  double deltaYD = invAff.a22;
+  int deltaXL =
+      tround(deltaXD * (1 << PADN));  //  deltaXD "TLonghizzato" (round)
+  int deltaYL =
+      tround(deltaYD * (1 << PADN));  //  deltaYD "TLonghizzato" (round)
 
-  //  se aff "TLonghizzata" (round) e' degenere la controimmagine di up e' un
-  //  segmento (o un punto)
-  if ((deltaXL == 0) && (deltaYL == 0)) return;
+  //  se aff "TLonghizzata" (round) e' degenere la controimmagine di up e'
+  //  un segmento (o un punto)
+  if ((deltaXL == 0) || (deltaYL == 0)) return;
 
-  //  TINT32 predecessore di up->getLx()
-  int lxPred = up->getLx() * (1 << PADN) - 1;
+  //  (1)  equazione (kX, kY)-parametrica di boundingBoxD:
+  //         (xMin, yMin) + kX*(1, 0) + kY*(0, 1),
+  //           kX = 0, ..., (xMax - xMin),
+  //           kY = 0, ..., (yMax - yMin)
 
-  //  TINT32 predecessore di up->getLy()
-  int lyPred = up->getLy() * (1 << PADN) - 1;
+  //  (2)  equazione (kX, kY)-parametrica dell'immagine mediante invAff di (1):
+  //         invAff*(xMin, yMin) + kX*(deltaXD, 0) + kY*(0, deltaYD),
+  //           kX = kMinX, ..., kMaxX
+  //             con 0 <= kMinX <= kMaxX <= (xMax - xMin)
+  //
+  //           kY = kMinY, ..., kMaxY
+  //             con 0 <= kMinY <= kMaxY <= (yMax - yMin)
 
-  int dnWrap = dn->getWrap();
-  int upWrap = up->getWrap();
-  dn->lock();
-  up->lock();
+  //  calcola kMinX, kMaxX, kMinY, kMaxY intersecando la (2) con i lati di up
 
-  TPixel64 *dnRow     = dn->pixels(yMin);
-  TPixel32 *upBasePix = up->pixels();
+  //  il segmento [a, b] di up (con gli estremi eventualmente invertiti) e'
+  //  la controimmagine mediante aff della porzione di scanline
+  //  [ (xMin, yMin), (xMax, yMin) ] di dn
 
-  //  scorre le scanline di boundingBoxD
-  for (int y = yMin; y <= yMax; y++, dnRow += dnWrap) {
-    //  (1)  equazione k-parametrica della y-esima scanline di boundingBoxD:
-    //       (xMin, y) + k*(1, 0),  k = 0, ..., (xMax - xMin)
+  //  TPointD b = invAff*TPointD(xMax, yMin);
+  TPointD a = invAff * TPointD(xMin, yMin);
 
-    //  (2)  equazione k-parametrica dell'immagine mediante invAff di (1):
-    //       invAff*(xMin, y) + k*(deltaXD, deltaYD),
-    //       k = kMin, ..., kMax con 0 <= kMin <= kMax <= (xMax - xMin)
+  //  (xL0, yL0) sono le coordinate di a (inizializzate per il round)
+  //  in versione "TLonghizzata"
+  //  0 <= xL0 + kX*deltaXL <= (up->getLx() - 2)*(1<<PADN),
+  //  0 <= kMinX <= kX <= kMaxX <= (xMax - xMin)
+  //  0 <= yL0 + kY*deltaYL <= (up->getLy() - 2)*(1<<PADN),
+  //  0 <= kMinY <= kY <= kMaxY <= (yMax - yMin)
 
-    //  calcola kMin, kMax per la scanline corrente
-    //  intersecando la (2) con i lati di up
+  int xL0 = tround(a.x * (1 << PADN));  //  xL0 inizializzato
+  int yL0 = tround(a.y * (1 << PADN));  //  yL0 inizializzato
 
-    //  il segmento [a, b] di up e' la controimmagine mediante aff della
-    //  porzione di scanline  [ (xMin, y), (xMax, y) ] di dn
+  //  calcola kMinY, kMaxY, kMinX, kMaxX intersecando la (2) con i lati di up
+  int kMinX = 0, kMaxX = xMax - xMin;  //  clipping su dn
+  int kMinY = 0, kMaxY = yMax - yMin;  //  clipping su dn
 
-    //  TPointD b = invAff*TPointD(xMax, y);
-    TPointD a = invAff * TPointD(xMin, y);
+  //  TINT32 predecessore di (up->getLx() - 1)
+  int lxPred = (up->getLx() - /*1*/ 2) * (1 << PADN);
 
-    //  (xL0, yL0) sono le coordinate di a (inizializzate per il round)
-    //  in versione "TLonghizzata"
-    //  0 <= xL0 + k*deltaXL
-    //    <  up->getLx()*(1<<PADN)
-    //
-    //  0 <= kMinX
-    //    <= kMin
-    //    <= k
-    //    <= kMax
-    //    <= kMaxX
-    //    <= (xMax - xMin)
-    //
-    //  0 <= yL0 + k*deltaYL
-    //    < up->getLy()*(1<<PADN)
+  //  TINT32 predecessore di (up->getLy() - 1)
+  int lyPred = (up->getLy() - /*1*/ 2) * (1 << PADN);
 
-    //  0 <= kMinY
-    //    <= kMin
-    //    <= k
-    //    <= kMax
-    //    <= kMaxY
-    //    <= (xMax - xMin)
+  //  0 <= xL0 + k*deltaXL <= (up->getLx() - 2)*(1<<PADN)
+  //               <=>
+  //  0 <= xL0 + k*deltaXL <= lxPred
 
-    //  xL0 inizializzato per il round
-    int xL0 = tround((a.x + 0.5) * (1 << PADN));
+  //  0 <= yL0 + k*deltaYL <= (up->getLy() - 2)*(1<<PADN)
+  //               <=>
+  //  0 <= yL0 + k*deltaYL <= lyPred
 
-    //  yL0 inizializzato per il round
-    int yL0 = tround((a.y + 0.5) * (1 << PADN));
+  //  calcola kMinY, kMaxY intersecando la (2) con i lati
+  //  (y = yMin) e (y = yMax) di up
+  if (deltaYL > 0)  //  (deltaYL != 0)
+  {
+    //  [a, b] interno ad up contratto
+    assert(yL0 <= lyPred);
 
-    //  calcola kMinX, kMaxX, kMinY, kMaxY
-    int kMinX = 0, kMaxX = xMax - xMin;  //  clipping su dn
-    int kMinY = 0, kMaxY = xMax - xMin;  //  clipping su dn
+    kMaxY = (lyPred - yL0) / deltaYL;  //  floor
+    if (yL0 < 0) {
+      kMinY = ((-yL0) + deltaYL - 1) / deltaYL;  //  ceil
+    }
+  } else  //  (deltaYL < 0)
+  {
+    //  [a, b] interno ad up contratto
+    assert(0 <= yL0);
 
-    //  0 <= xL0 + k*deltaXL
-    //    < up->getLx()*(1<<PADN)
-    //           <=>
-    //  0 <= xL0 + k*deltaXL
-    //    <= lxPred
-    //
-    //  0 <= yL0 + k*deltaYL
-    //    < up->getLy()*(1<<PADN)
-    //           <=>
-    //  0 <= yL0 + k*deltaYL
-    //    <= lyPred
+    kMaxY = yL0 / (-deltaYL);  //  floor
+    if (lyPred < yL0) {
+      kMinY = (yL0 - lyPred - deltaYL - 1) / (-deltaYL);  //  ceil
+    }
+  }
+  //  calcola kMinY, kMaxY effettuando anche il clippind su dn
+  kMinY = std::max(kMinY, (int)0);
+  kMaxY = std::min(kMaxY, yMax - yMin);
 
-    //  calcola kMinX, kMaxX
-    if (deltaXL == 0) {
-      // [a, b] verticale esterno ad up+(bordo destro/basso)
-      if ((xL0 < 0) || (lxPred < xL0)) continue;
-      //  altrimenti usa solo
-      //  kMinY, kMaxY ((deltaXL != 0) || (deltaYL != 0))
-    } else if (deltaXL > 0) {
-      //  [a, b] esterno ad up+(bordo destro/basso)
-      if (lxPred < xL0) continue;
+  //  calcola kMinX, kMaxX intersecando la (2) con i lati
+  //  (x = xMin) e (x = xMax) di up
+  if (deltaXL > 0)  //  (deltaXL != 0)
+  {
+    //  [a, b] interno ad up contratto
+    assert(xL0 <= lxPred);
 
-      kMaxX = (lxPred - xL0) / deltaXL;  //  floor
-      if (xL0 < 0) {
-        kMinX = ((-xL0) + deltaXL - 1) / deltaXL;  //  ceil
-      }
-    } else  //  (deltaXL < 0)
-    {
-      //  [a, b] esterno ad up+(bordo destro/basso)
-      if (xL0 < 0) continue;
+    kMaxX = (lxPred - xL0) / deltaXL;  //  floor
+    if (xL0 < 0) {
+      kMinX = ((-xL0) + deltaXL - 1) / deltaXL;  //  ceil
+    }
+  } else  //  (deltaXL < 0)
+  {
+    //  [a, b] interno ad up contratto
+    assert(0 <= xL0);
 
-      kMaxX = xL0 / (-deltaXL);  //  floor
-      if (lxPred < xL0) {
-        kMinX = (xL0 - lxPred - deltaXL - 1) / (-deltaXL);  //  ceil
-      }
+    kMaxX = xL0 / (-deltaXL);  //  floor
+    if (lxPred < xL0) {
+      kMinX = (xL0 - lxPred - deltaXL - 1) / (-deltaXL);  //  ceil
     }
+  }
+  //  calcola kMinX, kMaxX effettuando anche il clippind su dn
+  kMinX = std::max(kMinX, (int)0);
+  kMaxX = std::min(kMaxX, xMax - xMin);
 
-    //  calcola kMinY, kMaxY
-    if (deltaYL == 0) {
-      //  [a, b] orizzontale esterno ad up+(bordo destro/basso)
-      if ((yL0 < 0) || (lyPred < yL0)) continue;
-      // altrimenti usa solo
-      // kMinX, kMaxX ((deltaXL != 0) || (deltaYL != 0))
-    } else if (deltaYL > 0) {
-      //  [a, b] esterno ad up+(bordo destro/basso)
-      if (lyPred < yL0) continue;
+  int dnWrap = dn->getWrap();
+  int upWrap = up->getWrap();
 
-      kMaxY = (lyPred - yL0) / deltaYL;  //  floor
-      if (yL0 < 0) {
-        kMinY = ((-yL0) + deltaYL - 1) / deltaYL;  //  ceil
-      }
-    } else  //  (deltaYL < 0)
-    {
-      //  [a, b] esterno ad up+(bordo destro/basso)
-      if (yL0 < 0) continue;
+  dn->lock();
+  up->lock();
+  TPixelGR8 *upBasePix = up->pixels();
+  TPixel32 *dnRow      = dn->pixels(yMin + kMinY);
 
-      kMaxY = yL0 / (-deltaYL);  //  floor
-      if (lyPred < yL0) {
-        kMinY = (yL0 - lyPred - deltaYL - 1) / (-deltaYL);  //  ceil
-      }
-    }
+  //  (xL, yL) sono le coordinate (inizializzate per il round)
+  //  in versione "TLonghizzata"
+  //  del pixel corrente di up
+  int yL = yL0 + (kMinY - 1) * deltaYL;  //  inizializza yL
 
-    //  calcola kMin, kMax effettuando anche il clippind su dn
-    int kMin = std::max({kMinX, kMinY, (int)0});
-    int kMax = std::min({kMaxX, kMaxY, xMax - xMin});
+  //  scorre le scanline di boundingBoxD
+  for (int kY = kMinY; kY <= kMaxY; kY++, dnRow += dnWrap) {
+    int xL = xL0 + (kMinX - 1) * deltaXL;  //  inizializza xL
+    yL += deltaYL;
+    //  il punto di up TPointD(xL/(1<<PADN), yL/(1<<PADN)) e' approssimato
+    //  con (xI, yI)
+    int yI = yL >> PADN;  //  troncato
 
-    TPixel64 *dnPix    = dnRow + xMin + kMin;
-    TPixel64 *dnEndPix = dnRow + xMin + kMax + 1;
+    //  filtro bilineare 4 pixels: calcolo degli y-pesi
+    int yWeight1 = (yL & MASKN);
+    int yWeight0 = (1 << PADN) - yWeight1;
 
-    //  (xL, yL) sono le coordinate (inizializzate per il round)
-    //  in versione "TLonghizzata" del pixel corrente di up
-    int xL = xL0 + (kMin - 1) * deltaXL;  //  inizializza xL
-    int yL = yL0 + (kMin - 1) * deltaYL;  //  inizializza yL
+    TPixel32 *dnPix    = dnRow + xMin + kMinX;
+    TPixel32 *dnEndPix = dnRow + xMin + kMaxX + 1;
 
-    //  scorre i pixel sulla y-esima scanline di boundingBoxD
+    //  scorre i pixel sulla (yMin + kY)-esima scanline di dn
     for (; dnPix < dnEndPix; ++dnPix) {
       xL += deltaXL;
-      yL += deltaYL;
-
       //  il punto di up TPointD(xL/(1<<PADN), yL/(1<<PADN)) e'
       //  approssimato con (xI, yI)
-      int xI = xL >> PADN;  //  round
-      int yI = yL >> PADN;  //  round
+      int xI = xL >> PADN;  //  troncato
 
       assert((0 <= xI) && (xI <= up->getLx() - 1) && (0 <= yI) &&
              (yI <= up->getLy() - 1));
 
-      TPixel32 upPix = *(upBasePix + (yI * upWrap + xI));
-
-      if (firstColumn) upPix.m = 255;
-      if (upPix.m == 0) continue;
+      //  (xI, yI)
+      TPixelGR8 *upPix00 = upBasePix + (yI * upWrap + xI);
 
-      TPixel64 upPix64 = toPixel64(upPix);
-      if (upPix.m == 255)
-        *dnPix = upPix64;
-      else if (doPremultiply)
-        *dnPix = quickOverPixPremult(*dnPix, upPix64);
-      else
-        *dnPix = quickOverPix(*dnPix, upPix64);
-    }
-  }
-  dn->unlock();
-  up->unlock();
-}
+      //  (xI + 1, yI)
+      TPixelGR8 *upPix10 = upPix00 + 1;
 
-//=============================================================================
+      //  (xI, yI + 1)
+      TPixelGR8 *upPix01 = upPix00 + upWrap;
 
-void doQuickPutFilter(const TRaster32P &dn, const TRaster32P &up, double sx,
-                      double sy, double tx, double ty) {
-  //  se aff := TAffine(sx, 0, tx, 0, sy, ty) e' degenere la controimmagine
-  //  di up e' un segmento (o un punto)
-  if ((sx == 0) || (sy == 0)) return;
-
-  //  contatore bit di shift
-  const int PADN = 16;
-
-  //  maschera del filtro bilineare
-  const int MASKN = (1 << PADN) - 1;
-
-  assert(std::max(up->getLx(), up->getLy()) <
-         (1 << (8 * sizeof(int) - PADN - 1)));
-
-  //  max dimensioni di up gestibili (limite imposto dal numero di bit
-  //  disponibili per la parte intera di xL, yL)
-  TAffine aff(sx, 0, tx, 0, sy, ty);
-  TRectD boundingBoxD = TRectD(convert(dn->getSize())) *
-                        (aff * TRectD(0, 0, up->getLx() - 2, up->getLy() - 2));
-
-  //  clipping
-  if (boundingBoxD.x0 >= boundingBoxD.x1 || boundingBoxD.y0 >= boundingBoxD.y1)
-    return;
-
-  //  clipping y su dn
-  int yMin = std::max(tfloor(boundingBoxD.y0), 0);
-
-  //  clipping y su dn
-  int yMax = std::min(tceil(boundingBoxD.y1), dn->getLy() - 1);
-
-  //  clipping x su dn
-  int xMin = std::max(tfloor(boundingBoxD.x0), 0);
-
-  //  clipping x su dn
-  int xMax = std::min(tceil(boundingBoxD.x1), dn->getLx() - 1);
-
-  //  inversa di aff
-  TAffine invAff = inv(aff);
-
-  //	nello scorrere le scanline di boundingBoxD, il passaggio alla scanline
-  //    successiva comporta l'incremento (0, deltaYD) delle coordinate dei
-  //    pixels corrispondenti di up
-
-  //    nel disegnare la y-esima scanline di dn, il passaggio al pixel
-  //    successivo comporta l'incremento (deltaXD, 0) delle coordinate del
-  //    pixel corrispondente di up
-
-  double deltaXD = invAff.a11;
-  double deltaYD = invAff.a22;
-
-  //  deltaXD "TLonghizzato" (round)
-  int deltaXL = tround(deltaXD * (1 << PADN));
-
-  //  deltaYD "TLonghizzato" (round)
-  int deltaYL = tround(deltaYD * (1 << PADN));
-
-  //  se aff "TLonghizzata" (round) e' degenere la controimmagine di up e' un
-  //  segmento (o un punto)
-  if ((deltaXL == 0) || (deltaYL == 0)) return;
-
-  //	(1)  equazione (kX, kY)-parametrica di boundingBoxD:
-  //	       (xMin, yMin) + kX*(1, 0) + kY*(0, 1),
-  //	         kX = 0, ..., (xMax - xMin),
-  //             kY = 0, ..., (yMax - yMin)
-
-  //	(2)  equazione (kX, kY)-parametrica dell'immagine
-  //         mediante invAff di (1):
-  //	       invAff*(xMin, yMin) + kX*(deltaXD, 0) + kY*(0, deltaYD),
-  //	         kX = kMinX, ..., kMaxX
-  //               con 0 <= kMinX <= kMaxX <= (xMax - xMin)
-  //
-  //	         kY = kMinY, ..., kMaxY
-  //               con 0 <= kMinY <= kMaxY <= (yMax - yMin)
-
-  //  calcola kMinX, kMaxX, kMinY, kMaxY intersecando la (2) con i lati di up
-
-  //  il segmento [a, b] di up (con gli estremi eventualmente invertiti) e'
-  //  la controimmagine
-  //  mediante aff della porzione di scanline  [ (xMin, yMin), (xMax, yMin) ]
-  //  di dn
-
-  //  TPointD b = invAff*TPointD(xMax, yMin);
-  TPointD a = invAff * TPointD(xMin, yMin);
-
-  //  (xL0, yL0) sono le coordinate di a (inizializzate per il round) in
-  //  versione "TLonghizzata"
-  //
-  //    0 <= xL0 + kX*deltaXL
-  //      <= (up->getLx() - 2)*(1<<PADN),
-  //    0 <= kMinX <= kX
-  //      <= kMaxX <= (xMax - xMin)
-  //
-  //	0 <= yL0 + kY*deltaYL
-  //      <= (up->getLy() - 2)*(1<<PADN),
-  //    0 <= kMinY <= kY
-  //      <= kMaxY <= (yMax - yMin)
-  int xL0 = tround(a.x * (1 << PADN));  //  xL0 inizializzato
-  int yL0 = tround(a.y * (1 << PADN));  //  yL0 inizializzato
-
-  //  calcola kMinY, kMaxY, kMinX, kMaxX intersecando la (2) con i lati
-  //  di up
-  int kMinX = 0, kMaxX = xMax - xMin;  //  clipping su dn
-  int kMinY = 0, kMaxY = yMax - yMin;  //  clipping su dn
-
-  //  TINT32 predecessore di (up->getLx() - 1)
-  int lxPred = (up->getLx() - 2) * (1 << PADN);
-
-  //  TINT32 predecessore di (up->getLy() - 1)
-  int lyPred = (up->getLy() - 2) * (1 << PADN);
-
-  //  0 <= xL0 + k*deltaXL
-  //    <= (up->getLx() - 2)*(1<<PADN)
-  //             <=>
-  //  0 <= xL0 + k*deltaXL <= lxPred
-  //
-  //  0 <= yL0 + k*deltaYL
-  //    <= (up->getLy() - 2)*(1<<PADN)
-  //             <=>
-  //  0 <= yL0 + k*deltaYL <= lyPred
-
-  //  calcola kMinY, kMaxY intersecando la (2) con
-  //  i lati (y = yMin) e (y = yMax) di up
-  if (deltaYL > 0)  //  (deltaYL != 0)
-  {
-    //  [a, b] interno ad up contratto
-    assert(yL0 <= lyPred);
-    kMaxY = (lyPred - yL0) / deltaYL;  //  floor
-    if (yL0 < 0) {
-      kMinY = ((-yL0) + deltaYL - 1) / deltaYL;  //  ceil
-    }
-  } else  //  (deltaYL < 0)
-  {
-    //  [a, b] interno ad up contratto
-    assert(0 <= yL0);
-
-    kMaxY = yL0 / (-deltaYL);  //  floor
-    if (lyPred < yL0) {
-      kMinY = (yL0 - lyPred - deltaYL - 1) / (-deltaYL);  //  ceil
-    }
-  }
-  //	calcola kMinY, kMaxY effettuando anche il clippind su dn
-  kMinY = std::max(kMinY, (int)0);
-  kMaxY = std::min(kMaxY, yMax - yMin);
-
-  //  calcola kMinX, kMaxX intersecando la (2) con
-  //  i lati (x = xMin) e (x = xMax) di up
-  if (deltaXL > 0)  //  (deltaXL != 0)
-  {
-    //  [a, b] interno ad up contratto
-    assert(xL0 <= lxPred);
-
-    kMaxX = (lxPred - xL0) / deltaXL;  //  floor
-    if (xL0 < 0) {
-      kMinX = ((-xL0) + deltaXL - 1) / deltaXL;  //  ceil
-    }
-  } else  //  (deltaXL < 0)
-  {
-    //  [a, b] interno ad up contratto
-    assert(0 <= xL0);
-
-    kMaxX = xL0 / (-deltaXL);  //  floor
-    if (lxPred < xL0) {
-      kMinX = (xL0 - lxPred - deltaXL - 1) / (-deltaXL);  //  ceil
-    }
-  }
-  //  calcola kMinX, kMaxX effettuando anche il clippind su dn
-  kMinX = std::max(kMinX, (int)0);
-  kMaxX = std::min(kMaxX, xMax - xMin);
-
-  int dnWrap = dn->getWrap();
-  int upWrap = up->getWrap();
-  dn->lock();
-  up->lock();
-
-  TPixel32 *upBasePix = up->pixels();
-  TPixel32 *dnRow     = dn->pixels(yMin + kMinY);
-
-  //  (xL, yL) sono le coordinate (inizializzate per il round)
-  //  in versione "TLonghizzata" del pixel corrente di up
-
-  //  inizializza yL
-  int yL = yL0 + (kMinY - 1) * deltaYL;
-
-  //  scorre le scanline di boundingBoxD
-  for (int kY = kMinY; kY <= kMaxY; kY++, dnRow += dnWrap) {
-    //  inizializza xL
-    int xL = xL0 + (kMinX - 1) * deltaXL;
-    yL += deltaYL;
-    //  il punto di up TPointD(xL/(1<<PADN), yL/(1<<PADN)) e' approssimato
-    //  con (xI, yI)
-    int yI = yL >> PADN;  //  troncato
-
-    //  filtro bilineare 4 pixels: calcolo degli y-pesi
-    int yWeight1 = (yL & MASKN);
-    int yWeight0 = (1 << PADN) - yWeight1;
-
-    TPixel32 *dnPix    = dnRow + xMin + kMinX;
-    TPixel32 *dnEndPix = dnRow + xMin + kMaxX + 1;
-
-    //  scorre i pixel sulla (yMin + kY)-esima scanline di dn
-    for (; dnPix < dnEndPix; ++dnPix) {
-      xL += deltaXL;
-      //  il punto di up TPointD(xL/(1<<PADN), yL/(1<<PADN)) e'
-      //  approssimato con (xI, yI)
-      int xI = xL >> PADN;  //  troncato
-
-      assert((0 <= xI) && (xI <= up->getLx() - 1) && (0 <= yI) &&
-             (yI <= up->getLy() - 1));
-
-      //  (xI, yI)
-      TPixel32 *upPix00 = upBasePix + (yI * upWrap + xI);
-
-      //  (xI + 1, yI)
-      TPixel32 *upPix10 = upPix00 + 1;
-
-      //  (xI, yI + 1)
-      TPixel32 *upPix01 = upPix00 + upWrap;
-
-      //  (xI + 1, yI + 1)
-      TPixel32 *upPix11 = upPix00 + upWrap + 1;
+      //  (xI + 1, yI + 1)
+      TPixelGR8 *upPix11 = upPix00 + upWrap + 1;
 
       //  filtro bilineare 4 pixels: calcolo degli x-pesi
       int xWeight1 = (xL & MASKN);
       int xWeight0 = (1 << PADN) - xWeight1;
 
       //  filtro bilineare 4 pixels: media pesata sui singoli canali
-      int rColDownTmp =
-          (xWeight0 * (upPix00->r) + xWeight1 * ((upPix10)->r)) >> PADN;
-
-      int gColDownTmp =
-          (xWeight0 * (upPix00->g) + xWeight1 * ((upPix10)->g)) >> PADN;
-
-      int bColDownTmp =
-          (xWeight0 * (upPix00->b) + xWeight1 * ((upPix10)->b)) >> PADN;
-
-      int rColUpTmp =
-          (xWeight0 * ((upPix01)->r) + xWeight1 * ((upPix11)->r)) >> PADN;
-
-      int gColUpTmp =
-          (xWeight0 * ((upPix01)->g) + xWeight1 * ((upPix11)->g)) >> PADN;
-
-      int bColUpTmp =
-          (xWeight0 * ((upPix01)->b) + xWeight1 * ((upPix11)->b)) >> PADN;
-
-      unsigned char rCol =
-          (unsigned char)((yWeight0 * rColDownTmp + yWeight1 * rColUpTmp) >>
-                          PADN);
-
-      unsigned char gCol =
-          (unsigned char)((yWeight0 * gColDownTmp + yWeight1 * gColUpTmp) >>
-                          PADN);
-
-      unsigned char bCol =
-          (unsigned char)((yWeight0 * bColDownTmp + yWeight1 * bColUpTmp) >>
-                          PADN);
+      int colDownTmp =
+          (xWeight0 * (upPix00->value) + xWeight1 * (upPix10->value)) >> PADN;
 
-      TPixel32 upPix = TPixel32(rCol, gCol, bCol, upPix00->m);
+      int colUpTmp =
+          (xWeight0 * ((upPix01)->value) + xWeight1 * (upPix11->value)) >> PADN;
 
-      if (upPix.m == 0)
-        continue;
-      else if (upPix.m == 255)
-        *dnPix = upPix;
-      else
-        *dnPix = quickOverPix(*dnPix, upPix);
-    }
-  }
-  dn->unlock();
-  up->unlock();
-}
-//=============================================================================
-//=============================================================================
-//=============================================================================
-void doQuickPutNoFilter(const TRaster32P &dn, const TRaster32P &up, double sx,
-                        double sy, double tx, double ty,
-                        const TPixel32 &colorScale, bool doPremultiply,
-                        bool whiteTransp, bool firstColumn,
-                        bool doRasterDarkenBlendedView) {
-  //  se aff := TAffine(sx, 0, tx, 0, sy, ty) e' degenere la controimmagine
-  //  di up e' un segmento (o un punto)
-  if ((sx == 0) || (sy == 0)) return;
-
-  //  contatore bit di shift
-  const int PADN = 16;
-  assert(std::max(up->getLx(), up->getLy()) <
-         (1 << (8 * sizeof(int) - PADN - 1)));
-  //  max dimensioni di up gestibili (limite imposto dal numero di bit
-  // disponibili per la parte intera di xL, yL)
-
-  TAffine aff(sx, 0, tx, 0, sy, ty);
-  TRectD boundingBoxD =
-      TRectD(convert(dn->getBounds())) *
-      (aff * TRectD(-0.5, -0.5, up->getLx() - 0.5, up->getLy() - 0.5));
-
-  //  clipping
-  if (boundingBoxD.x0 >= boundingBoxD.x1 || boundingBoxD.y0 >= boundingBoxD.y1)
-    return;
-
-  //  clipping y su dn
-  int yMin = std::max(tfloor(boundingBoxD.y0), 0);
-
-  //  clipping y su dn
-  int yMax = std::min(tceil(boundingBoxD.y1), dn->getLy() - 1);
-
-  //  clipping x su dn
-  int xMin = std::max(tfloor(boundingBoxD.x0), 0);
-
-  //  clipping x su dn
-  int xMax = std::min(tceil(boundingBoxD.x1), dn->getLx() - 1);
-
-  TAffine invAff = inv(aff);  //  inversa di aff
-
-  //  nello scorrere le scanline di boundingBoxD, il passaggio alla scanline
-  //  successiva comporta l'incremento (0, deltaYD) delle coordinate dei
-  //  pixels corrispondenti di up
-
-  //  nel disegnare la y-esima scanline di dn, il passaggio al pixel
-  //  successivo comporta l'incremento (deltaXD, 0) delle coordinate del
-  //  pixel corrispondente di up
-
-  double deltaXD = invAff.a11;
-  double deltaYD = invAff.a22;
-
-  //  deltaXD "TLonghizzato" (round)
-  int deltaXL = tround(deltaXD * (1 << PADN));
-
-  //  deltaYD "TLonghizzato" (round)
-  int deltaYL = tround(deltaYD * (1 << PADN));
-
-  //  se aff "TLonghizzata" (round) e' degenere la controimmagine di up e' un
-  //  segmento (o un punto)
-  if ((deltaXL == 0) || (deltaYL == 0)) return;
-
-  //	(1)  equazione (kX, kY)-parametrica di boundingBoxD:
-  //	       (xMin, yMin) + kX*(1, 0) + kY*(0, 1),
-  //	         kX = 0, ..., (xMax - xMin),
-  //             kY = 0, ..., (yMax - yMin)
-
-  //	(2)  equazione (kX, kY)-parametrica dell'immagine
-  //         mediante invAff di (1):
-  //	       invAff*(xMin, yMin) + kX*(deltaXD, 0) + kY*(0, deltaYD),
-  //	         kX = kMinX, ..., kMaxX
-  //             con 0 <= kMinX <= kMaxX <= (xMax - xMin)
-  //
-  //             kY = kMinY, ..., kMaxY
-  //             con 0 <= kMinY <= kMaxY <= (yMax - yMin)
-
-  //  calcola kMinX, kMaxX, kMinY, kMaxY intersecando la (2) con i lati di up
-
-  //  il segmento [a, b] di up e' la controimmagine mediante aff della
-  // porzione di scanline  [ (xMin, yMin), (xMax, yMin) ] di dn
-
-  //  TPointD b = invAff*TPointD(xMax, yMin);
-  TPointD a = invAff * TPointD(xMin, yMin);
-
-  //  (xL0, yL0) sono le coordinate di a (inizializzate per il round)
-  // in versione "TLonghizzata"
-  //	0 <= xL0 + kX*deltaXL
-  //      < up->getLx()*(1<<PADN),
-  //
-  //    0 <= kMinX
-  //      <= kX
-  //      <= kMaxX
-  //      <= (xMax - xMin)
-
-  //	0 <= yL0 + kY*deltaYL
-  //      < up->getLy()*(1<<PADN),
-  //
-  //    0 <= kMinY
-  //      <= kY
-  //      <= kMaxY
-  //      <= (yMax - yMin)
-
-  //  xL0 inizializzato per il round
-  int xL0 = tround((a.x + 0.5) * (1 << PADN));
-
-  //  yL0 inizializzato per il round
-  int yL0 = tround((a.y + 0.5) * (1 << PADN));
-
-  //  calcola kMinY, kMaxY, kMinX, kMaxX intersecando la (2) con i lati di up
-  int kMinX = 0, kMaxX = xMax - xMin;  //  clipping su dn
-  int kMinY = 0, kMaxY = yMax - yMin;  //  clipping su dn
-
-  //  TINT32 predecessore di up->getLx()
-  int lxPred = up->getLx() * (1 << PADN) - 1;
-
-  //  TINT32 predecessore di up->getLy()
-  int lyPred = up->getLy() * (1 << PADN) - 1;
-
-  //  0 <= xL0 + k*deltaXL < up->getLx()*(1<<PADN)
-  //            <=>
-  //  0 <= xL0 + k*deltaXL <= lxPred
-
-  //  0 <= yL0 + k*deltaYL < up->getLy()*(1<<PADN)
-  //            <=>
-  //  0 <= yL0 + k*deltaYL <= lyPred
-
-  //  calcola kMinY, kMaxY intersecando la (2) con i lati
-  //  (y = yMin) e (y = yMax) di up
-  if (deltaYL > 0)  //  (deltaYL != 0)
-  {
-    //  [a, b] interno ad up+(bordo destro/basso)
-    assert(yL0 <= lyPred);
-
-    kMaxY = (lyPred - yL0) / deltaYL;  //  floor
-    if (yL0 < 0) {
-      kMinY = ((-yL0) + deltaYL - 1) / deltaYL;  //  ceil
-    }
-  } else  //  (deltaYL < 0)
-  {
-    //  [a, b] interno ad up+(bordo destro/basso)
-    assert(0 <= yL0);
-
-    kMaxY = yL0 / (-deltaYL);  //  floor
-    if (lyPred < yL0) {
-      kMinY = (yL0 - lyPred - deltaYL - 1) / (-deltaYL);  //  ceil
-    }
-  }
-  //  calcola kMinY, kMaxY effettuando anche il clippind su dn
-  kMinY = std::max(kMinY, (int)0);
-  kMaxY = std::min(kMaxY, yMax - yMin);
-
-  //  calcola kMinX, kMaxX intersecando la (2) con i lati
-  //  (x = xMin) e (x = xMax) di up
-  if (deltaXL > 0)  //  (deltaXL != 0)
-  {
-    //  [a, b] interno ad up+(bordo destro/basso)
-    assert(xL0 <= lxPred);
-
-    kMaxX = (lxPred - xL0) / deltaXL;  //  floor
-    if (xL0 < 0) {
-      kMinX = ((-xL0) + deltaXL - 1) / deltaXL;  //  ceil
-    }
-  } else  //  (deltaXL < 0)
-  {
-    //  [a, b] interno ad up+(bordo destro/basso)
-    assert(0 <= xL0);
-
-    kMaxX = xL0 / (-deltaXL);  //  floor
-    if (lxPred < xL0) {
-      kMinX = (xL0 - lxPred - deltaXL - 1) / (-deltaXL);  //  ceil
-    }
-  }
-  //  calcola kMinX, kMaxX effettuando anche il clippind su dn
-  kMinX = std::max(kMinX, (int)0);
-  kMaxX = std::min(kMaxX, xMax - xMin);
-
-  int dnWrap = dn->getWrap();
-  int upWrap = up->getWrap();
-  dn->lock();
-  up->lock();
-
-  TPixel32 *upBasePix = up->pixels();
-  TPixel32 *dnRow     = dn->pixels(yMin + kMinY);
-
-  //  (xL, yL) sono le coordinate (inizializzate per il round)
-  //  in versione "TLonghizzata" del pixel corrente di up
-
-  //  inizializza yL
-  int yL = yL0 + (kMinY - 1) * deltaYL;
-
-  //  scorre le scanline di boundingBoxD
-  for (int kY = kMinY; kY <= kMaxY; kY++, dnRow += dnWrap) {
-    //  inizializza xL
-    int xL = xL0 + (kMinX - 1) * deltaXL;
-    yL += deltaYL;
-
-    //  il punto di up TPointD(xL/(1<<PADN), yL/(1<<PADN)) e' approssimato
-    //  con (xI, yI)
-    int yI = yL >> PADN;  //  round
-
-    TPixel32 *dnPix    = dnRow + xMin + kMinX;
-    TPixel32 *dnEndPix = dnRow + xMin + kMaxX + 1;
-
-    //  scorre i pixel sulla (yMin + kY)-esima scanline di dn
-    for (; dnPix < dnEndPix; ++dnPix) {
-      xL += deltaXL;
-      //  il punto di up TPointD(xL/(1<<PADN), yL/(1<<PADN)) e'
-      //  approssimato con (xI, yI)
-      int xI = xL >> PADN;  //	round
-
-      assert((0 <= xI) && (xI <= up->getLx() - 1) && (0 <= yI) &&
-             (yI <= up->getLy() - 1));
-
-      TPixel32 upPix = *(upBasePix + (yI * upWrap + xI));
-
-      if (firstColumn) upPix.m = 255;
-
-      if (upPix.m == 0 || (whiteTransp && upPix == TPixel::White)) continue;
-
-      if (colorScale != TPixel32::Black)
-        upPix = applyColorScale(upPix, colorScale, doPremultiply);
-
-      if (doRasterDarkenBlendedView)
-        *dnPix = quickOverPixDarkenBlended(*dnPix, upPix);
-      else {
-        if (upPix.m == 255)
-          *dnPix = upPix;
-        else if (doPremultiply)
-          *dnPix = quickOverPixPremult(*dnPix, upPix);
-        else
-          *dnPix = quickOverPix(*dnPix, upPix);
-      }
-    }
-  }
-  dn->unlock();
-  up->unlock();
-}
-
-//=============================================================================
-void doQuickPutNoFilter(const TRaster32P &dn, const TRasterGR8P &up, double sx,
-                        double sy, double tx, double ty,
-                        const TPixel32 &colorScale) {
-  if ((sx == 0) || (sy == 0)) return;
-
-  const int PADN = 16;
-  assert(std::max(up->getLx(), up->getLy()) <
-         (1 << (8 * sizeof(int) - PADN - 1)));
-
-  TAffine aff(sx, 0, tx, 0, sy, ty);
-  TRectD boundingBoxD =
-      TRectD(convert(dn->getBounds())) *
-      (aff * TRectD(-0.5, -0.5, up->getLx() - 0.5, up->getLy() - 0.5));
-
-  if (boundingBoxD.x0 >= boundingBoxD.x1 || boundingBoxD.y0 >= boundingBoxD.y1)
-    return;
-
-  int yMin = std::max(tfloor(boundingBoxD.y0), 0);
-  int yMax = std::min(tceil(boundingBoxD.y1), dn->getLy() - 1);
-  int xMin = std::max(tfloor(boundingBoxD.x0), 0);
-  int xMax = std::min(tceil(boundingBoxD.x1), dn->getLx() - 1);
-
-  TAffine invAff = inv(aff);  //  inversa di aff
-
-  double deltaXD = invAff.a11;
-  double deltaYD = invAff.a22;
-  int deltaXL    = tround(deltaXD * (1 << PADN));
-  int deltaYL    = tround(deltaYD * (1 << PADN));
-  if ((deltaXL == 0) || (deltaYL == 0)) return;
-  TPointD a = invAff * TPointD(xMin, yMin);
-
-  int xL0   = tround((a.x + 0.5) * (1 << PADN));
-  int yL0   = tround((a.y + 0.5) * (1 << PADN));
-  int kMinX = 0, kMaxX = xMax - xMin;  //  clipping su dn
-  int kMinY = 0, kMaxY = yMax - yMin;  //  clipping su dn
-  int lxPred = up->getLx() * (1 << PADN) - 1;
-  int lyPred = up->getLy() * (1 << PADN) - 1;
-
-  if (deltaYL > 0)  //  (deltaYL != 0)
-  {
-    assert(yL0 <= lyPred);
-
-    kMaxY = (lyPred - yL0) / deltaYL;  //  floor
-    if (yL0 < 0) {
-      kMinY = ((-yL0) + deltaYL - 1) / deltaYL;  //  ceil
-    }
-  } else  //  (deltaYL < 0)
-  {
-    assert(0 <= yL0);
-
-    kMaxY = yL0 / (-deltaYL);  //  floor
-    if (lyPred < yL0) {
-      kMinY = (yL0 - lyPred - deltaYL - 1) / (-deltaYL);  //  ceil
-    }
-  }
-  kMinY = std::max(kMinY, (int)0);
-  kMaxY = std::min(kMaxY, yMax - yMin);
-
-  if (deltaXL > 0)  //  (deltaXL != 0)
-  {
-    assert(xL0 <= lxPred);
-
-    kMaxX = (lxPred - xL0) / deltaXL;  //  floor
-    if (xL0 < 0) {
-      kMinX = ((-xL0) + deltaXL - 1) / deltaXL;  //  ceil
-    }
-  } else  //  (deltaXL < 0)
-  {
-    assert(0 <= xL0);
-
-    kMaxX = xL0 / (-deltaXL);  //  floor
-    if (lxPred < xL0) {
-      kMinX = (xL0 - lxPred - deltaXL - 1) / (-deltaXL);  //  ceil
-    }
-  }
-  kMinX = std::max(kMinX, (int)0);
-  kMaxX = std::min(kMaxX, xMax - xMin);
-
-  int dnWrap = dn->getWrap();
-  int upWrap = up->getWrap();
-  dn->lock();
-  up->lock();
-
-  TPixelGR8 *upBasePix = up->pixels();
-  TPixel32 *dnRow      = dn->pixels(yMin + kMinY);
-
-  int yL = yL0 + (kMinY - 1) * deltaYL;
-
-  for (int kY = kMinY; kY <= kMaxY; kY++, dnRow += dnWrap) {
-    //  inizializza xL
-    int xL = xL0 + (kMinX - 1) * deltaXL;
-    yL += deltaYL;
-
-    //  il punto di up TPointD(xL/(1<<PADN), yL/(1<<PADN)) e' approssimato
-    //  con (xI, yI)
-    int yI = yL >> PADN;  //  round
-
-    TPixel32 *dnPix    = dnRow + xMin + kMinX;
-    TPixel32 *dnEndPix = dnRow + xMin + kMaxX + 1;
-
-    //  scorre i pixel sulla (yMin + kY)-esima scanline di dn
-    for (; dnPix < dnEndPix; ++dnPix) {
-      xL += deltaXL;
-      int xI = xL >> PADN;  //	round
-
-      assert((0 <= xI) && (xI <= up->getLx() - 1) && (0 <= yI) &&
-             (yI <= up->getLy() - 1));
-
-      TPixelGR8 *upPix = upBasePix + (yI * upWrap + xI);
-      if (colorScale == TPixel32::Black) {
-        dnPix->r = dnPix->g = dnPix->b = upPix->value;
-        dnPix->m                       = 255;
-      } else {
-        TPixel32 upPix32(upPix->value, upPix->value, upPix->value, 255);
-        upPix32 = applyColorScale(upPix32, colorScale);
-
-        if (upPix32.m == 255)
-          *dnPix = upPix32;
-        else
-          *dnPix = quickOverPix(*dnPix, upPix32);
-      }
-
-      /*
-if (upPix->value == 0)
-dnPix->r = dnPix->g = dnPix->b = dnPix->m = upPix->value;
-else if (upPix->value == 255)
-dnPix->r = dnPix->g = dnPix->b = dnPix->m = upPix->value;
-else
-*dnPix = quickOverPix(*dnPix, *upPix);
-*/
-    }
-  }
-  dn->unlock();
-  up->unlock();
-}
-
-void doQuickResampleFilter(const TRaster32P &dn, const TRaster32P &up,
-                           const TAffine &aff) {
-  //  se aff e' degenere la controimmagine di up e' un segmento (o un punto)
-  if ((aff.a11 * aff.a22 - aff.a12 * aff.a21) == 0) return;
-
-  //  contatore bit di shift
-  const int PADN = 16;
-
-  //  maschera del filtro bilineare
-  const int MASKN = (1 << PADN) - 1;
-  assert(std::max(up->getLx(), up->getLy()) <
-         (1 << (8 * sizeof(int) - PADN - 1)));
-  //  max dimensioni di up gestibili (limite imposto dal numero di bit
-  //  disponibili per la parte intera di xL, yL)
-
-  TRectD boundingBoxD = TRectD(convert(dn->getSize())) *
-                        (aff * TRectD(0, 0, up->getLx() - 2, up->getLy() - 2));
-
-  //  clipping
-  if (boundingBoxD.x0 >= boundingBoxD.x1 || boundingBoxD.y0 >= boundingBoxD.y1)
-    return;
-
-  //  clipping y su dn
-  int yMin = std::max(tfloor(boundingBoxD.y0), 0);
-
-  //  clipping y su dn
-  int yMax = std::min(tceil(boundingBoxD.y1), dn->getLy() - 1);
-
-  //  clipping x su dn
-  int xMin = std::max(tfloor(boundingBoxD.x0), 0);
-
-  //  clipping x su dn
-  int xMax = std::min(tceil(boundingBoxD.x1), dn->getLx() - 1);
-
-  TAffine invAff = inv(aff);  //  inversa di aff
-
-  //  nel disegnare la y-esima scanline di dn, il passaggio al pixel
-  //  successivo comporta l'incremento (deltaXD, deltaYD) delle coordinate
-  //  del pixel corrispondente di up
-  double deltaXD = invAff.a11;
-  double deltaYD = invAff.a21;
-
-  //  deltaXD "TLonghizzato" (round)
-  int deltaXL = tround(deltaXD * (1 << PADN));
-
-  //  deltaYD "TLonghizzato" (round)
-  int deltaYL = tround(deltaYD * (1 << PADN));
-
-  //  se aff "TLonghizzata" (round) e' degenere la controimmagine di up e' un
-  //  segmento (o un punto)
-  if ((deltaXL == 0) && (deltaYL == 0)) return;
-
-  // naturale predecessore di up->getLx() - 1
-  int lxPred = (up->getLx() - 2) * (1 << PADN);
-
-  //  naturale predecessore di up->getLy() - 1
-  int lyPred = (up->getLy() - 2) * (1 << PADN);
-
-  int dnWrap = dn->getWrap();
-  int upWrap = up->getWrap();
-  dn->lock();
-  up->lock();
-
-  TPixel32 *dnRow     = dn->pixels(yMin);
-  TPixel32 *upBasePix = up->pixels();
-
-  //  scorre le scanline di boundingBoxD
-  for (int y = yMin; y <= yMax; y++, dnRow += dnWrap) {
-    //  (1)  equazione k-parametrica della y-esima scanline di boundingBoxD:
-    //         (xMin, y) + k*(1, 0),  k = 0, ..., (xMax - xMin)
-    //
-    //  (2)  equazione k-parametrica dell'immagine mediante invAff di (1):
-    //         invAff*(xMin, y) + k*(deltaXD, deltaYD),
-    //           k = kMin, ..., kMax
-    //           con 0 <= kMin <= kMax <= (xMax - xMin)
-
-    //  calcola kMin, kMax per la scanline corrente intersecando
-    //  la (2) con i lati di up
-
-    //  il segmento [a, b] di up e' la controimmagine mediante aff della
-    //  porzione di scanline  [ (xMin, y), (xMax, y) ] di dn
-
-    //  TPointD b = invAff*TPointD(xMax, y);
-    TPointD a = invAff * TPointD(xMin, y);
-
-    //  (xL0, yL0) sono le coordinate di a in versione "TLonghizzata"
-    //  0 <= xL0 + k*deltaXL
-    //    <= (up->getLx() - 2)*(1<<PADN),
-    //  0 <= kMinX
-    //    <= kMin
-    //    <= k
-    //    <= kMax
-    //    <= kMaxX
-    //    <= (xMax - xMin)
-
-    //  0 <= yL0 + k*deltaYL
-    //    <= (up->getLy() - 2)*(1<<PADN),
-    //  0 <= kMinY
-    //    <= kMin
-    //    <= k
-    //    <= kMax
-    //    <= kMaxY
-    //    <= (xMax - xMin)
-
-    //  xL0 inizializzato
-    int xL0 = tround(a.x * (1 << PADN));
-
-    //  yL0 inizializzato
-    int yL0 = tround(a.y * (1 << PADN));
-
-    //  calcola kMinX, kMaxX, kMinY, kMaxY
-    int kMinX = 0, kMaxX = xMax - xMin;  //  clipping su dn
-    int kMinY = 0, kMaxY = xMax - xMin;  //  clipping su dn
-
-    //  0 <= xL0 + k*deltaXL <= (up->getLx() - 2)*(1<<PADN)
-    //             <=>
-    //  0 <= xL0 + k*deltaXL <= lxPred
-
-    //  0 <= yL0 + k*deltaYL <= (up->getLy() - 2)*(1<<PADN)
-    //             <=>
-    //  0 <= yL0 + k*deltaYL <= lyPred
-
-    //  calcola kMinX, kMaxX
-    if (deltaXL == 0) {
-      //  [a, b] verticale esterno ad up contratto
-      if ((xL0 < 0) || (lxPred < xL0)) continue;
-      //  altrimenti usa solo
-      //  kMinY, kMaxY ((deltaXL != 0) || (deltaYL != 0))
-    } else if (deltaXL > 0) {
-      //  [a, b] esterno ad up+(bordo destro)
-      if (lxPred < xL0) continue;
-
-      kMaxX = (lxPred - xL0) / deltaXL;  //  floor
-      if (xL0 < 0) {
-        kMinX = ((-xL0) + deltaXL - 1) / deltaXL;  //  ceil
-      }
-    } else  //  (deltaXL < 0)
-    {
-      //  [a, b] esterno ad up contratto
-      if (xL0 < 0) continue;
-
-      kMaxX = xL0 / (-deltaXL);  //  floor
-      if (lxPred < xL0) {
-        kMinX = (xL0 - lxPred - deltaXL - 1) / (-deltaXL);  //  ceil
-      }
-    }
-
-    //  calcola kMinY, kMaxY
-    if (deltaYL == 0) {
-      // [a, b] orizzontale esterno ad up contratto
-      if ((yL0 < 0) || (lyPred < yL0)) continue;
-      //  altrimenti usa solo
-      //  kMinX, kMaxX ((deltaXL != 0) || (deltaYL != 0))
-    } else if (deltaYL > 0) {
-      //  [a, b] esterno ad up contratto
-      if (lyPred < yL0) continue;
-
-      kMaxY = (lyPred - yL0) / deltaYL;  //  floor
-      if (yL0 < 0) {
-        kMinY = ((-yL0) + deltaYL - 1) / deltaYL;  //  ceil
-      }
-    } else  //  (deltaYL < 0)
-    {
-      //  [a, b] esterno ad up contratto
-      if (yL0 < 0) continue;
-
-      kMaxY = yL0 / (-deltaYL);  //  floor
-      if (lyPred < yL0) {
-        kMinY = (yL0 - lyPred - deltaYL - 1) / (-deltaYL);  //  ceil
-      }
-    }
-
-    //  calcola kMin, kMax effettuando anche il clippind su dn
-    int kMin = std::max({kMinX, kMinY, (int)0});
-    int kMax = std::min({kMaxX, kMaxY, xMax - xMin});
-
-    TPixel32 *dnPix    = dnRow + xMin + kMin;
-    TPixel32 *dnEndPix = dnRow + xMin + kMax + 1;
-
-    //  (xL, yL) sono le coordinate (inizializzate per il round)
-    //  in versione "longhizzata" del pixel corrente di up
-    int xL = xL0 + (kMin - 1) * deltaXL;  //  inizializza xL
-    int yL = yL0 + (kMin - 1) * deltaYL;  //  inizializza yL
-
-    //  scorre i pixel sulla y-esima scanline di boundingBoxD
-    for (; dnPix < dnEndPix; ++dnPix) {
-      xL += deltaXL;
-      yL += deltaYL;
-      //  il punto di up TPointD(xL/(1<<PADN), yL/(1<<PADN)) e'
-      //  approssimato con (xI, yI)
-      int xI = xL >> PADN;  //	troncato
-      int yI = yL >> PADN;  //	troncato
-
-      assert((0 <= xI) && (xI <= up->getLx() - 1) && (0 <= yI) &&
-             (yI <= up->getLy() - 1));
-
-      //  (xI, yI)
-      TPixel32 *upPix00 = upBasePix + (yI * upWrap + xI);
-
-      //  (xI + 1, yI)
-      TPixel32 *upPix10 = upPix00 + 1;
-
-      //  (xI, yI + 1)
-      TPixel32 *upPix01 = upPix00 + upWrap;
-
-      //  (xI + 1, yI + 1)
-      TPixel32 *upPix11 = upPix00 + upWrap + 1;
-
-      //  filtro bilineare 4 pixels: calcolo dei pesi
-      int xWeight1 = (xL & MASKN);
-      int xWeight0 = (1 << PADN) - xWeight1;
-      int yWeight1 = (yL & MASKN);
-      int yWeight0 = (1 << PADN) - yWeight1;
-
-      //  filtro bilineare 4 pixels: media pesata sui singoli canali
-      int rColDownTmp =
-          (xWeight0 * (upPix00->r) + xWeight1 * ((upPix10)->r)) >> PADN;
-
-      int gColDownTmp =
-          (xWeight0 * (upPix00->g) + xWeight1 * ((upPix10)->g)) >> PADN;
-
-      int bColDownTmp =
-          (xWeight0 * (upPix00->b) + xWeight1 * ((upPix10)->b)) >> PADN;
-
-      int mColDownTmp =
-          (xWeight0 * (upPix00->m) + xWeight1 * ((upPix10)->m)) >> PADN;
-
-      int rColUpTmp =
-          (xWeight0 * ((upPix01)->r) + xWeight1 * ((upPix11)->r)) >> PADN;
-
-      int gColUpTmp =
-          (xWeight0 * ((upPix01)->g) + xWeight1 * ((upPix11)->g)) >> PADN;
-
-      int bColUpTmp =
-          (xWeight0 * ((upPix01)->b) + xWeight1 * ((upPix11)->b)) >> PADN;
-
-      int mColUpTmp =
-          (xWeight0 * ((upPix01)->m) + xWeight1 * ((upPix11)->m)) >> PADN;
-
-      dnPix->r =
-          (unsigned char)((yWeight0 * rColDownTmp + yWeight1 * rColUpTmp) >>
-                          PADN);
-      dnPix->g =
-          (unsigned char)((yWeight0 * gColDownTmp + yWeight1 * gColUpTmp) >>
-                          PADN);
-      dnPix->b =
-          (unsigned char)((yWeight0 * bColDownTmp + yWeight1 * bColUpTmp) >>
-                          PADN);
-      dnPix->m =
-          (unsigned char)((yWeight0 * mColDownTmp + yWeight1 * mColUpTmp) >>
-                          PADN);
-    }
-  }
-  dn->unlock();
-  up->unlock();
-}
-//=============================================================================
-//=============================================================================
-//=============================================================================
-
-void doQuickResampleFilter(const TRaster32P &dn, const TRasterGR8P &up,
-                           const TAffine &aff) {
-  if ((aff.a11 * aff.a22 - aff.a12 * aff.a21) == 0) return;
-
-  const int PADN = 16;
-
-  const int MASKN = (1 << PADN) - 1;
-  assert(std::max(up->getLx(), up->getLy()) <
-         (1 << (8 * sizeof(int) - PADN - 1)));
-
-  TRectD boundingBoxD = TRectD(convert(dn->getSize())) *
-                        (aff * TRectD(0, 0, up->getLx() - 2, up->getLy() - 2));
-
-  //  clipping
-  if (boundingBoxD.x0 >= boundingBoxD.x1 || boundingBoxD.y0 >= boundingBoxD.y1)
-    return;
-
-  int yMin = std::max(tfloor(boundingBoxD.y0), 0);
-  int yMax = std::min(tceil(boundingBoxD.y1), dn->getLy() - 1);
-  int xMin = std::max(tfloor(boundingBoxD.x0), 0);
-  int xMax = std::min(tceil(boundingBoxD.x1), dn->getLx() - 1);
-
-  TAffine invAff = inv(aff);  //  inversa di aff
-
-  double deltaXD = invAff.a11;
-  double deltaYD = invAff.a21;
-  int deltaXL    = tround(deltaXD * (1 << PADN));
-  int deltaYL    = tround(deltaYD * (1 << PADN));
-  if ((deltaXL == 0) && (deltaYL == 0)) return;
-
-  int lxPred = (up->getLx() - 2) * (1 << PADN);
-  int lyPred = (up->getLy() - 2) * (1 << PADN);
-
-  int dnWrap = dn->getWrap();
-  int upWrap = up->getWrap();
-  dn->lock();
-  up->lock();
-
-  TPixel32 *dnRow      = dn->pixels(yMin);
-  TPixelGR8 *upBasePix = up->pixels();
-
-  for (int y = yMin; y <= yMax; y++, dnRow += dnWrap) {
-    TPointD a = invAff * TPointD(xMin, y);
-    int xL0   = tround(a.x * (1 << PADN));
-    int yL0   = tround(a.y * (1 << PADN));
-    int kMinX = 0, kMaxX = xMax - xMin;  //  clipping su dn
-    int kMinY = 0, kMaxY = xMax - xMin;  //  clipping su dn
-
-    if (deltaXL == 0) {
-      if ((xL0 < 0) || (lxPred < xL0)) continue;
-    } else if (deltaXL > 0) {
-      if (lxPred < xL0) continue;
-
-      kMaxX = (lxPred - xL0) / deltaXL;  //  floor
-      if (xL0 < 0) {
-        kMinX = ((-xL0) + deltaXL - 1) / deltaXL;  //  ceil
-      }
-    } else {
-      if (xL0 < 0) continue;
-
-      kMaxX = xL0 / (-deltaXL);  //  floor
-      if (lxPred < xL0) {
-        kMinX = (xL0 - lxPred - deltaXL - 1) / (-deltaXL);  //  ceil
-      }
-    }
-
-    if (deltaYL == 0) {
-      if ((yL0 < 0) || (lyPred < yL0)) continue;
-    } else if (deltaYL > 0) {
-      if (lyPred < yL0) continue;
-
-      kMaxY = (lyPred - yL0) / deltaYL;  //  floor
-      if (yL0 < 0) {
-        kMinY = ((-yL0) + deltaYL - 1) / deltaYL;  //  ceil
-      }
-    } else  //  (deltaYL < 0)
-    {
-      if (yL0 < 0) continue;
-
-      kMaxY = yL0 / (-deltaYL);  //  floor
-      if (lyPred < yL0) {
-        kMinY = (yL0 - lyPred - deltaYL - 1) / (-deltaYL);  //  ceil
-      }
-    }
-
-    int kMin = std::max({kMinX, kMinY, (int)0});
-    int kMax = std::min({kMaxX, kMaxY, xMax - xMin});
-
-    TPixel32 *dnPix    = dnRow + xMin + kMin;
-    TPixel32 *dnEndPix = dnRow + xMin + kMax + 1;
-
-    int xL = xL0 + (kMin - 1) * deltaXL;  //  inizializza xL
-    int yL = yL0 + (kMin - 1) * deltaYL;  //  inizializza yL
-
-    for (; dnPix < dnEndPix; ++dnPix) {
-      xL += deltaXL;
-      yL += deltaYL;
-
-      int xI = xL >> PADN;  //	troncato
-      int yI = yL >> PADN;  //	troncato
-
-      assert((0 <= xI) && (xI <= up->getLx() - 1) && (0 <= yI) &&
-             (yI <= up->getLy() - 1));
-
-      //  (xI, yI)
-      TPixelGR8 *upPix00 = upBasePix + (yI * upWrap + xI);
-
-      //  (xI + 1, yI)
-      TPixelGR8 *upPix10 = upPix00 + 1;
-
-      //  (xI, yI + 1)
-      TPixelGR8 *upPix01 = upPix00 + upWrap;
-
-      //  (xI + 1, yI + 1)
-      TPixelGR8 *upPix11 = upPix00 + upWrap + 1;
-
-      //  filtro bilineare 4 pixels: calcolo dei pesi
-      int xWeight1 = (xL & MASKN);
-      int xWeight0 = (1 << PADN) - xWeight1;
-      int yWeight1 = (yL & MASKN);
-      int yWeight0 = (1 << PADN) - yWeight1;
-
-      //  filtro bilineare 4 pixels: media pesata sui singoli canali
-      int colDownTmp =
-          (xWeight0 * (upPix00->value) + xWeight1 * ((upPix10)->value)) >> PADN;
-
-      int colUpTmp =
-          (xWeight0 * ((upPix01)->value) + xWeight1 * ((upPix11)->value)) >>
-          PADN;
-
-      dnPix->r = dnPix->g = dnPix->b =
-          (unsigned char)((yWeight0 * colDownTmp + yWeight1 * colUpTmp) >>
-                          PADN);
-
-      dnPix->m = 255;
-    }
-  }
-  dn->unlock();
-  up->unlock();
-}
-//=============================================================================
-//=============================================================================
-//=============================================================================
-
-void doQuickResampleColorFilter(const TRaster32P &dn, const TRaster32P &up,
-                                const TAffine &aff, UCHAR colorMask) {
-  if ((aff.a11 * aff.a22 - aff.a12 * aff.a21) == 0) return;
-  const int PADN = 16;
-
-  assert(std::max(up->getLx(), up->getLy()) <
-         (1 << (8 * sizeof(int) - PADN - 1)));
-
-  TRectD boundingBoxD =
-      TRectD(convert(dn->getBounds())) *
-      (aff * TRectD(-0.5, -0.5, up->getLx() - 0.5, up->getLy() - 0.5));
-
-  if (boundingBoxD.x0 >= boundingBoxD.x1 || boundingBoxD.y0 >= boundingBoxD.y1)
-    return;
-
-  int yMin = std::max(tfloor(boundingBoxD.y0), 0);  //  clipping y su dn
-  int yMax =
-      std::min(tceil(boundingBoxD.y1), dn->getLy() - 1);  //  clipping y su dn
-  int xMin = std::max(tfloor(boundingBoxD.x0), 0);        //  clipping x su dn
-  int xMax =
-      std::min(tceil(boundingBoxD.x1), dn->getLx() - 1);  //  clipping x su dn
-
-  TAffine invAff = inv(aff);  //  inversa di aff
-
-  double deltaXD = invAff.a11;
-  double deltaYD = invAff.a21;
-  int deltaXL =
-      tround(deltaXD * (1 << PADN));  //  deltaXD "TLonghizzato" (round)
-  int deltaYL =
-      tround(deltaYD * (1 << PADN));  //  deltaYD "TLonghizzato" (round)
-  if ((deltaXL == 0) && (deltaYL == 0)) return;
-
-  int lxPred =
-      up->getLx() * (1 << PADN) - 1;  //  TINT32 predecessore di up->getLx()
-  int lyPred =
-      up->getLy() * (1 << PADN) - 1;  //  TINT32 predecessore di up->getLy()
-
-  int dnWrap = dn->getWrap();
-  int upWrap = up->getWrap();
-  dn->lock();
-  up->lock();
-
-  TPixel32 *dnRow     = dn->pixels(yMin);
-  TPixel32 *upBasePix = up->pixels();
-
-  for (int y = yMin; y <= yMax; y++, dnRow += dnWrap) {
-    TPointD a = invAff * TPointD(xMin, y);
-    int xL0   = tround((a.x + 0.5) * (1 << PADN));
-    int yL0   = tround((a.y + 0.5) * (1 << PADN));
-    int kMinX = 0, kMaxX = xMax - xMin;  //  clipping su dn
-    int kMinY = 0, kMaxY = xMax - xMin;  //  clipping su dn
-    if (deltaXL == 0) {
-      if ((xL0 < 0) || (lxPred < xL0)) continue;
-    } else if (deltaXL > 0) {
-      if (lxPred < xL0) continue;
-
-      kMaxX = (lxPred - xL0) / deltaXL;                       //  floor
-      if (xL0 < 0) kMinX = ((-xL0) + deltaXL - 1) / deltaXL;  //  ceil
-    } else                                                    //  (deltaXL < 0)
-    {
-      if (xL0 < 0) continue;
-      kMaxX = xL0 / (-deltaXL);  //  floor
-      if (lxPred < xL0)
-        kMinX = (xL0 - lxPred - deltaXL - 1) / (-deltaXL);  //  ceil
-    }
-    if (deltaYL == 0) {
-      if ((yL0 < 0) || (lyPred < yL0)) continue;
-    } else if (deltaYL > 0) {
-      if (lyPred < yL0) continue;
-
-      kMaxY = (lyPred - yL0) / deltaYL;                       //  floor
-      if (yL0 < 0) kMinY = ((-yL0) + deltaYL - 1) / deltaYL;  //  ceil
-    } else                                                    //  (deltaYL < 0)
-    {
-      if (yL0 < 0) continue;
-
-      kMaxY = yL0 / (-deltaYL);  //  floor
-      if (lyPred < yL0)
-        kMinY = (yL0 - lyPred - deltaYL - 1) / (-deltaYL);  //  ceil
-    }
-    int kMin           = std::max({kMinX, kMinY, (int)0});
-    int kMax           = std::min({kMaxX, kMaxY, xMax - xMin});
-    TPixel32 *dnPix    = dnRow + xMin + kMin;
-    TPixel32 *dnEndPix = dnRow + xMin + kMax + 1;
-    int xL             = xL0 + (kMin - 1) * deltaXL;  //  inizializza xL
-    int yL             = yL0 + (kMin - 1) * deltaYL;  //  inizializza yL
-    for (; dnPix < dnEndPix; ++dnPix) {
-      xL += deltaXL;
-      yL += deltaYL;
-      int xI = xL >> PADN;  //  round
-      int yI = yL >> PADN;  //  round
-
-      assert((0 <= xI) && (xI <= up->getLx() - 1) && (0 <= yI) &&
-             (yI <= up->getLy() - 1));
-
-      if (colorMask == TRop::MChan)
-        dnPix->r = dnPix->g = dnPix->b = (upBasePix + (yI * upWrap + xI))->m;
-      else {
-        TPixel32 *pix = upBasePix + (yI * upWrap + xI);
-        dnPix->r      = ((colorMask & TRop::RChan) ? pix->r : 0);
-        dnPix->g      = ((colorMask & TRop::GChan) ? pix->g : 0);
-        dnPix->b      = ((colorMask & TRop::BChan) ? pix->b : 0);
-      }
-      dnPix->m = 255;
-    }
-  }
-  dn->unlock();
-  up->unlock();
-}
-//=============================================================================
-//=============================================================================
-//=============================================================================
-
-//=============================================================================
-//=============================================================================
-//=============================================================================
-
-void doQuickResampleColorFilter(const TRaster32P &dn, const TRaster64P &up,
-                                const TAffine &aff, UCHAR colorMask) {
-  if ((aff.a11 * aff.a22 - aff.a12 * aff.a21) == 0) return;
-  const int PADN = 16;
-
-  assert(std::max(up->getLx(), up->getLy()) <
-         (1 << (8 * sizeof(int) - PADN - 1)));
-
-  TRectD boundingBoxD =
-      TRectD(convert(dn->getBounds())) *
-      (aff * TRectD(-0.5, -0.5, up->getLx() - 0.5, up->getLy() - 0.5));
-
-  if (boundingBoxD.x0 >= boundingBoxD.x1 || boundingBoxD.y0 >= boundingBoxD.y1)
-    return;
-
-  int yMin = std::max(tfloor(boundingBoxD.y0), 0);  //  clipping y su dn
-  int yMax =
-      std::min(tceil(boundingBoxD.y1), dn->getLy() - 1);  //  clipping y su dn
-  int xMin = std::max(tfloor(boundingBoxD.x0), 0);        //  clipping x su dn
-  int xMax =
-      std::min(tceil(boundingBoxD.x1), dn->getLx() - 1);  //  clipping x su dn
-
-  TAffine invAff = inv(aff);  //  inversa di aff
-
-  double deltaXD = invAff.a11;
-  double deltaYD = invAff.a21;
-  int deltaXL =
-      tround(deltaXD * (1 << PADN));  //  deltaXD "TLonghizzato" (round)
-  int deltaYL =
-      tround(deltaYD * (1 << PADN));  //  deltaYD "TLonghizzato" (round)
-  if ((deltaXL == 0) && (deltaYL == 0)) return;
-
-  int lxPred =
-      up->getLx() * (1 << PADN) - 1;  //  TINT32 predecessore di up->getLx()
-  int lyPred =
-      up->getLy() * (1 << PADN) - 1;  //  TINT32 predecessore di up->getLy()
-
-  int dnWrap = dn->getWrap();
-  int upWrap = up->getWrap();
-  dn->lock();
-  up->lock();
-
-  TPixel32 *dnRow     = dn->pixels(yMin);
-  TPixel64 *upBasePix = up->pixels();
-
-  for (int y = yMin; y <= yMax; y++, dnRow += dnWrap) {
-    TPointD a = invAff * TPointD(xMin, y);
-    int xL0   = tround((a.x + 0.5) * (1 << PADN));
-    int yL0   = tround((a.y + 0.5) * (1 << PADN));
-    int kMinX = 0, kMaxX = xMax - xMin;  //  clipping su dn
-    int kMinY = 0, kMaxY = xMax - xMin;  //  clipping su dn
-    if (deltaXL == 0) {
-      if ((xL0 < 0) || (lxPred < xL0)) continue;
-    } else if (deltaXL > 0) {
-      if (lxPred < xL0) continue;
-
-      kMaxX = (lxPred - xL0) / deltaXL;                       //  floor
-      if (xL0 < 0) kMinX = ((-xL0) + deltaXL - 1) / deltaXL;  //  ceil
-    } else                                                    //  (deltaXL < 0)
-    {
-      if (xL0 < 0) continue;
-      kMaxX = xL0 / (-deltaXL);  //  floor
-      if (lxPred < xL0)
-        kMinX = (xL0 - lxPred - deltaXL - 1) / (-deltaXL);  //  ceil
-    }
-    if (deltaYL == 0) {
-      if ((yL0 < 0) || (lyPred < yL0)) continue;
-    } else if (deltaYL > 0) {
-      if (lyPred < yL0) continue;
-
-      kMaxY = (lyPred - yL0) / deltaYL;                       //  floor
-      if (yL0 < 0) kMinY = ((-yL0) + deltaYL - 1) / deltaYL;  //  ceil
-    } else                                                    //  (deltaYL < 0)
-    {
-      if (yL0 < 0) continue;
-
-      kMaxY = yL0 / (-deltaYL);  //  floor
-      if (lyPred < yL0)
-        kMinY = (yL0 - lyPred - deltaYL - 1) / (-deltaYL);  //  ceil
-    }
-    int kMin           = std::max({kMinX, kMinY, (int)0});
-    int kMax           = std::min({kMaxX, kMaxY, xMax - xMin});
-    TPixel32 *dnPix    = dnRow + xMin + kMin;
-    TPixel32 *dnEndPix = dnRow + xMin + kMax + 1;
-    int xL             = xL0 + (kMin - 1) * deltaXL;  //  inizializza xL
-    int yL             = yL0 + (kMin - 1) * deltaYL;  //  inizializza yL
-    for (; dnPix < dnEndPix; ++dnPix) {
-      xL += deltaXL;
-      yL += deltaYL;
-      int xI = xL >> PADN;  //  round
-      int yI = yL >> PADN;  //  round
-
-      assert((0 <= xI) && (xI <= up->getLx() - 1) && (0 <= yI) &&
-             (yI <= up->getLy() - 1));
-
-      if (colorMask == TRop::MChan)
-        dnPix->r = dnPix->g = dnPix->b =
-            byteFromUshort((upBasePix + (yI * upWrap + xI))->m);
-      else {
-        TPixel64 *pix = upBasePix + (yI * upWrap + xI);
-        dnPix->r = byteFromUshort(((colorMask & TRop::RChan) ? pix->r : 0));
-        dnPix->g = byteFromUshort(((colorMask & TRop::GChan) ? pix->g : 0));
-        dnPix->b = byteFromUshort(((colorMask & TRop::BChan) ? pix->b : 0));
-      }
-      dnPix->m = 255;
-    }
-  }
-  dn->unlock();
-  up->unlock();
-}
-//=============================================================================
-//=============================================================================
-//=============================================================================
-
-void doQuickResampleFilter(const TRaster32P &dn, const TRaster32P &up,
-                           double sx, double sy, double tx, double ty) {
-  //  se aff := TAffine(sx, 0, tx, 0, sy, ty) e' degenere la controimmagine
-  //  di up e' un segmento (o un punto)
-  if ((sx == 0) || (sy == 0)) return;
-
-  //  contatore bit di shift
-  const int PADN = 16;
-
-  //  maschera del filtro bilineare
-  const int MASKN = (1 << PADN) - 1;
-
-  //  max dimensioni di up gestibili (limite imposto dal numero di bit
-  // disponibili per la parte intera di xL, yL)
-  assert(std::max(up->getLx(), up->getLy()) <
-         (1 << (8 * sizeof(int) - PADN - 1)));
-
-  TAffine aff(sx, 0, tx, 0, sy, ty);
-  TRectD boundingBoxD =
-      TRectD(convert(dn->getSize())) *
-      (aff * TRectD(0, 0, up->getLx() - /*1*/ 2, up->getLy() - /*1*/ 2));
-
-  //  clipping
-  if (boundingBoxD.x0 >= boundingBoxD.x1 || boundingBoxD.y0 >= boundingBoxD.y1)
-    return;
-
-  //  clipping y su dn
-  int yMin = std::max(tfloor(boundingBoxD.y0), 0);
-
-  //  clipping y su dn
-  int yMax = std::min(tceil(boundingBoxD.y1), dn->getLy() - 1);
-
-  //  clipping x su dn
-  int xMin = std::max(tfloor(boundingBoxD.x0), 0);
-
-  //  clipping x su dn
-  int xMax = std::min(tceil(boundingBoxD.x1), dn->getLx() - 1);
-
-  //  inversa di aff
-  TAffine invAff = inv(aff);
-
-  //  nello scorrere le scanline di boundingBoxD, il passaggio alla scanline
-  //  successiva comporta l'incremento (0, deltaYD) delle coordinate dei
-  //  pixels corrispondenti di up
-
-  //  nel disegnare la y-esima scanline di dn, il passaggio al pixel
-  //  successivo comporta l'incremento (deltaXD, 0) delle coordinate del
-  //  pixel corrispondente di up
-
-  double deltaXD = invAff.a11;
-  double deltaYD = invAff.a22;
-  int deltaXL =
-      tround(deltaXD * (1 << PADN));  //  deltaXD "TLonghizzato" (round)
-  int deltaYL =
-      tround(deltaYD * (1 << PADN));  //  deltaYD "TLonghizzato" (round)
-
-  //  se aff "TLonghizzata" (round) e' degenere la controimmagine di up e'
-  //  un segmento (o un punto)
-  if ((deltaXL == 0) || (deltaYL == 0)) return;
-
-  //  (1)  equazione (kX, kY)-parametrica di boundingBoxD:
-  //         (xMin, yMin) + kX*(1, 0) + kY*(0, 1),
-  //           kX = 0, ..., (xMax - xMin),
-  //           kY = 0, ..., (yMax - yMin)
-
-  //  (2)  equazione (kX, kY)-parametrica dell'immagine mediante invAff di (1):
-  //         invAff*(xMin, yMin) + kX*(deltaXD, 0) + kY*(0, deltaYD),
-  //           kX = kMinX, ..., kMaxX
-  //             con 0 <= kMinX <= kMaxX <= (xMax - xMin)
-  //
-  //           kY = kMinY, ..., kMaxY
-  //             con 0 <= kMinY <= kMaxY <= (yMax - yMin)
-
-  //  calcola kMinX, kMaxX, kMinY, kMaxY intersecando la (2) con i lati di up
-
-  //  il segmento [a, b] di up (con gli estremi eventualmente invertiti) e'
-  //  la controimmagine mediante aff della porzione di scanline
-  //  [ (xMin, yMin), (xMax, yMin) ] di dn
-
-  //  TPointD b = invAff*TPointD(xMax, yMin);
-  TPointD a = invAff * TPointD(xMin, yMin);
-
-  //  (xL0, yL0) sono le coordinate di a (inizializzate per il round)
-  //  in versione "TLonghizzata"
-  //  0 <= xL0 + kX*deltaXL <= (up->getLx() - 2)*(1<<PADN),
-  //  0 <= kMinX <= kX <= kMaxX <= (xMax - xMin)
-  //  0 <= yL0 + kY*deltaYL <= (up->getLy() - 2)*(1<<PADN),
-  //  0 <= kMinY <= kY <= kMaxY <= (yMax - yMin)
-
-  int xL0 = tround(a.x * (1 << PADN));  //  xL0 inizializzato
-  int yL0 = tround(a.y * (1 << PADN));  //  yL0 inizializzato
-
-  //  calcola kMinY, kMaxY, kMinX, kMaxX intersecando la (2) con i lati di up
-  int kMinX = 0, kMaxX = xMax - xMin;  //  clipping su dn
-  int kMinY = 0, kMaxY = yMax - yMin;  //  clipping su dn
-
-  //  TINT32 predecessore di (up->getLx() - 1)
-  int lxPred = (up->getLx() - /*1*/ 2) * (1 << PADN);
-
-  //  TINT32 predecessore di (up->getLy() - 1)
-  int lyPred = (up->getLy() - /*1*/ 2) * (1 << PADN);
-
-  //  0 <= xL0 + k*deltaXL <= (up->getLx() - 2)*(1<<PADN)
-  //               <=>
-  //  0 <= xL0 + k*deltaXL <= lxPred
-
-  //  0 <= yL0 + k*deltaYL <= (up->getLy() - 2)*(1<<PADN)
-  //               <=>
-  //  0 <= yL0 + k*deltaYL <= lyPred
-
-  //  calcola kMinY, kMaxY intersecando la (2) con i lati
-  //  (y = yMin) e (y = yMax) di up
-  if (deltaYL > 0)  //  (deltaYL != 0)
-  {
-    //  [a, b] interno ad up contratto
-    assert(yL0 <= lyPred);
-
-    kMaxY = (lyPred - yL0) / deltaYL;  //  floor
-    if (yL0 < 0) {
-      kMinY = ((-yL0) + deltaYL - 1) / deltaYL;  //  ceil
-    }
-  } else  //  (deltaYL < 0)
-  {
-    //  [a, b] interno ad up contratto
-    assert(0 <= yL0);
-
-    kMaxY = yL0 / (-deltaYL);  //  floor
-    if (lyPred < yL0) {
-      kMinY = (yL0 - lyPred - deltaYL - 1) / (-deltaYL);  //  ceil
-    }
-  }
-  //  calcola kMinY, kMaxY effettuando anche il clippind su dn
-  kMinY = std::max(kMinY, (int)0);
-  kMaxY = std::min(kMaxY, yMax - yMin);
-
-  //  calcola kMinX, kMaxX intersecando la (2) con i lati
-  //  (x = xMin) e (x = xMax) di up
-  if (deltaXL > 0)  //  (deltaXL != 0)
-  {
-    //  [a, b] interno ad up contratto
-    assert(xL0 <= lxPred);
-
-    kMaxX = (lxPred - xL0) / deltaXL;  //  floor
-    if (xL0 < 0) {
-      kMinX = ((-xL0) + deltaXL - 1) / deltaXL;  //  ceil
-    }
-  } else  //  (deltaXL < 0)
-  {
-    //  [a, b] interno ad up contratto
-    assert(0 <= xL0);
-
-    kMaxX = xL0 / (-deltaXL);  //  floor
-    if (lxPred < xL0) {
-      kMinX = (xL0 - lxPred - deltaXL - 1) / (-deltaXL);  //  ceil
-    }
-  }
-  //  calcola kMinX, kMaxX effettuando anche il clippind su dn
-  kMinX = std::max(kMinX, (int)0);
-  kMaxX = std::min(kMaxX, xMax - xMin);
-
-  int dnWrap = dn->getWrap();
-  int upWrap = up->getWrap();
-
-  dn->lock();
-  up->lock();
-  TPixel32 *upBasePix = up->pixels();
-  TPixel32 *dnRow     = dn->pixels(yMin + kMinY);
-
-  //  (xL, yL) sono le coordinate (inizializzate per il round)
-  //  in versione "TLonghizzata"
-  //  del pixel corrente di up
-  int yL = yL0 + (kMinY - 1) * deltaYL;  //  inizializza yL
-
-  //  scorre le scanline di boundingBoxD
-  for (int kY = kMinY; kY <= kMaxY; kY++, dnRow += dnWrap) {
-    int xL = xL0 + (kMinX - 1) * deltaXL;  //  inizializza xL
-    yL += deltaYL;
-    //  il punto di up TPointD(xL/(1<<PADN), yL/(1<<PADN)) e' approssimato
-    //  con (xI, yI)
-    int yI = yL >> PADN;  //  troncato
-
-    //  filtro bilineare 4 pixels: calcolo degli y-pesi
-    int yWeight1 = (yL & MASKN);
-    int yWeight0 = (1 << PADN) - yWeight1;
-
-    TPixel32 *dnPix    = dnRow + xMin + kMinX;
-    TPixel32 *dnEndPix = dnRow + xMin + kMaxX + 1;
-
-    //  scorre i pixel sulla (yMin + kY)-esima scanline di dn
-    for (; dnPix < dnEndPix; ++dnPix) {
-      xL += deltaXL;
-      //  il punto di up TPointD(xL/(1<<PADN), yL/(1<<PADN)) e'
-      //  approssimato con (xI, yI)
-      int xI = xL >> PADN;  //  troncato
-
-      assert((0 <= xI) && (xI <= up->getLx() - 1) && (0 <= yI) &&
-             (yI <= up->getLy() - 1));
-
-      //  (xI, yI)
-      TPixel32 *upPix00 = upBasePix + (yI * upWrap + xI);
-
-      //  (xI + 1, yI)
-      TPixel32 *upPix10 = upPix00 + 1;
-
-      //  (xI, yI + 1)
-      TPixel32 *upPix01 = upPix00 + upWrap;
-
-      //  (xI + 1, yI + 1)
-      TPixel32 *upPix11 = upPix00 + upWrap + 1;
-
-      //  filtro bilineare 4 pixels: calcolo degli x-pesi
-      int xWeight1 = (xL & MASKN);
-      int xWeight0 = (1 << PADN) - xWeight1;
-
-      //  filtro bilineare 4 pixels: media pesata sui singoli canali
-      int rColDownTmp =
-          (xWeight0 * (upPix00->r) + xWeight1 * ((upPix10)->r)) >> PADN;
-
-      int gColDownTmp =
-          (xWeight0 * (upPix00->g) + xWeight1 * ((upPix10)->g)) >> PADN;
-
-      int bColDownTmp =
-          (xWeight0 * (upPix00->b) + xWeight1 * ((upPix10)->b)) >> PADN;
-
-      int mColDownTmp =
-          (xWeight0 * (upPix00->m) + xWeight1 * ((upPix10)->m)) >> PADN;
-
-      int rColUpTmp =
-          (xWeight0 * ((upPix01)->r) + xWeight1 * ((upPix11)->r)) >> PADN;
-
-      int gColUpTmp =
-          (xWeight0 * ((upPix01)->g) + xWeight1 * ((upPix11)->g)) >> PADN;
-
-      int bColUpTmp =
-          (xWeight0 * ((upPix01)->b) + xWeight1 * ((upPix11)->b)) >> PADN;
-
-      int mColUpTmp =
-          (xWeight0 * ((upPix01)->m) + xWeight1 * ((upPix11)->m)) >> PADN;
-
-      dnPix->r =
-          (unsigned char)((yWeight0 * rColDownTmp + yWeight1 * rColUpTmp) >>
-                          PADN);
-      dnPix->g =
-          (unsigned char)((yWeight0 * gColDownTmp + yWeight1 * gColUpTmp) >>
-                          PADN);
-      dnPix->b =
-          (unsigned char)((yWeight0 * bColDownTmp + yWeight1 * bColUpTmp) >>
-                          PADN);
-      dnPix->m =
-          (unsigned char)((yWeight0 * mColDownTmp + yWeight1 * mColUpTmp) >>
-                          PADN);
-    }
-  }
-  dn->unlock();
-  up->unlock();
-}
-
-//------------------------------------------------------------------------------------------
-
-void doQuickResampleFilter(const TRaster32P &dn, const TRasterGR8P &up,
-                           double sx, double sy, double tx, double ty) {
-  //  se aff := TAffine(sx, 0, tx, 0, sy, ty) e' degenere la controimmagine
-  //  di up e' un segmento (o un punto)
-  if ((sx == 0) || (sy == 0)) return;
-
-  //  contatore bit di shift
-  const int PADN = 16;
-
-  //  maschera del filtro bilineare
-  const int MASKN = (1 << PADN) - 1;
-
-  //  max dimensioni di up gestibili (limite imposto dal numero di bit
-  // disponibili per la parte intera di xL, yL)
-  assert(std::max(up->getLx(), up->getLy()) <
-         (1 << (8 * sizeof(int) - PADN - 1)));
-
-  TAffine aff(sx, 0, tx, 0, sy, ty);
-  TRectD boundingBoxD =
-      TRectD(convert(dn->getSize())) *
-      (aff * TRectD(0, 0, up->getLx() - /*1*/ 2, up->getLy() - /*1*/ 2));
-
-  //  clipping
-  if (boundingBoxD.x0 >= boundingBoxD.x1 || boundingBoxD.y0 >= boundingBoxD.y1)
-    return;
-
-  //  clipping y su dn
-  int yMin = std::max(tfloor(boundingBoxD.y0), 0);
-
-  //  clipping y su dn
-  int yMax = std::min(tceil(boundingBoxD.y1), dn->getLy() - 1);
-
-  //  clipping x su dn
-  int xMin = std::max(tfloor(boundingBoxD.x0), 0);
-
-  //  clipping x su dn
-  int xMax = std::min(tceil(boundingBoxD.x1), dn->getLx() - 1);
-
-  //  inversa di aff
-  TAffine invAff = inv(aff);
-
-  //  nello scorrere le scanline di boundingBoxD, il passaggio alla scanline
-  //  successiva comporta l'incremento (0, deltaYD) delle coordinate dei
-  //  pixels corrispondenti di up
-
-  //  nel disegnare la y-esima scanline di dn, il passaggio al pixel
-  //  successivo comporta l'incremento (deltaXD, 0) delle coordinate del
-  //  pixel corrispondente di up
-
-  double deltaXD = invAff.a11;
-  double deltaYD = invAff.a22;
-  int deltaXL =
-      tround(deltaXD * (1 << PADN));  //  deltaXD "TLonghizzato" (round)
-  int deltaYL =
-      tround(deltaYD * (1 << PADN));  //  deltaYD "TLonghizzato" (round)
-
-  //  se aff "TLonghizzata" (round) e' degenere la controimmagine di up e'
-  //  un segmento (o un punto)
-  if ((deltaXL == 0) || (deltaYL == 0)) return;
-
-  //  (1)  equazione (kX, kY)-parametrica di boundingBoxD:
-  //         (xMin, yMin) + kX*(1, 0) + kY*(0, 1),
-  //           kX = 0, ..., (xMax - xMin),
-  //           kY = 0, ..., (yMax - yMin)
-
-  //  (2)  equazione (kX, kY)-parametrica dell'immagine mediante invAff di (1):
-  //         invAff*(xMin, yMin) + kX*(deltaXD, 0) + kY*(0, deltaYD),
-  //           kX = kMinX, ..., kMaxX
-  //             con 0 <= kMinX <= kMaxX <= (xMax - xMin)
-  //
-  //           kY = kMinY, ..., kMaxY
-  //             con 0 <= kMinY <= kMaxY <= (yMax - yMin)
-
-  //  calcola kMinX, kMaxX, kMinY, kMaxY intersecando la (2) con i lati di up
-
-  //  il segmento [a, b] di up (con gli estremi eventualmente invertiti) e'
-  //  la controimmagine mediante aff della porzione di scanline
-  //  [ (xMin, yMin), (xMax, yMin) ] di dn
-
-  //  TPointD b = invAff*TPointD(xMax, yMin);
-  TPointD a = invAff * TPointD(xMin, yMin);
-
-  //  (xL0, yL0) sono le coordinate di a (inizializzate per il round)
-  //  in versione "TLonghizzata"
-  //  0 <= xL0 + kX*deltaXL <= (up->getLx() - 2)*(1<<PADN),
-  //  0 <= kMinX <= kX <= kMaxX <= (xMax - xMin)
-  //  0 <= yL0 + kY*deltaYL <= (up->getLy() - 2)*(1<<PADN),
-  //  0 <= kMinY <= kY <= kMaxY <= (yMax - yMin)
-
-  int xL0 = tround(a.x * (1 << PADN));  //  xL0 inizializzato
-  int yL0 = tround(a.y * (1 << PADN));  //  yL0 inizializzato
-
-  //  calcola kMinY, kMaxY, kMinX, kMaxX intersecando la (2) con i lati di up
-  int kMinX = 0, kMaxX = xMax - xMin;  //  clipping su dn
-  int kMinY = 0, kMaxY = yMax - yMin;  //  clipping su dn
-
-  //  TINT32 predecessore di (up->getLx() - 1)
-  int lxPred = (up->getLx() - /*1*/ 2) * (1 << PADN);
-
-  //  TINT32 predecessore di (up->getLy() - 1)
-  int lyPred = (up->getLy() - /*1*/ 2) * (1 << PADN);
-
-  //  0 <= xL0 + k*deltaXL <= (up->getLx() - 2)*(1<<PADN)
-  //               <=>
-  //  0 <= xL0 + k*deltaXL <= lxPred
-
-  //  0 <= yL0 + k*deltaYL <= (up->getLy() - 2)*(1<<PADN)
-  //               <=>
-  //  0 <= yL0 + k*deltaYL <= lyPred
-
-  //  calcola kMinY, kMaxY intersecando la (2) con i lati
-  //  (y = yMin) e (y = yMax) di up
-  if (deltaYL > 0)  //  (deltaYL != 0)
-  {
-    //  [a, b] interno ad up contratto
-    assert(yL0 <= lyPred);
-
-    kMaxY = (lyPred - yL0) / deltaYL;  //  floor
-    if (yL0 < 0) {
-      kMinY = ((-yL0) + deltaYL - 1) / deltaYL;  //  ceil
-    }
-  } else  //  (deltaYL < 0)
-  {
-    //  [a, b] interno ad up contratto
-    assert(0 <= yL0);
-
-    kMaxY = yL0 / (-deltaYL);  //  floor
-    if (lyPred < yL0) {
-      kMinY = (yL0 - lyPred - deltaYL - 1) / (-deltaYL);  //  ceil
-    }
-  }
-  //  calcola kMinY, kMaxY effettuando anche il clippind su dn
-  kMinY = std::max(kMinY, (int)0);
-  kMaxY = std::min(kMaxY, yMax - yMin);
-
-  //  calcola kMinX, kMaxX intersecando la (2) con i lati
-  //  (x = xMin) e (x = xMax) di up
-  if (deltaXL > 0)  //  (deltaXL != 0)
-  {
-    //  [a, b] interno ad up contratto
-    assert(xL0 <= lxPred);
-
-    kMaxX = (lxPred - xL0) / deltaXL;  //  floor
-    if (xL0 < 0) {
-      kMinX = ((-xL0) + deltaXL - 1) / deltaXL;  //  ceil
-    }
-  } else  //  (deltaXL < 0)
-  {
-    //  [a, b] interno ad up contratto
-    assert(0 <= xL0);
-
-    kMaxX = xL0 / (-deltaXL);  //  floor
-    if (lxPred < xL0) {
-      kMinX = (xL0 - lxPred - deltaXL - 1) / (-deltaXL);  //  ceil
-    }
-  }
-  //  calcola kMinX, kMaxX effettuando anche il clippind su dn
-  kMinX = std::max(kMinX, (int)0);
-  kMaxX = std::min(kMaxX, xMax - xMin);
-
-  int dnWrap = dn->getWrap();
-  int upWrap = up->getWrap();
-
-  dn->lock();
-  up->lock();
-  TPixelGR8 *upBasePix = up->pixels();
-  TPixel32 *dnRow      = dn->pixels(yMin + kMinY);
-
-  //  (xL, yL) sono le coordinate (inizializzate per il round)
-  //  in versione "TLonghizzata"
-  //  del pixel corrente di up
-  int yL = yL0 + (kMinY - 1) * deltaYL;  //  inizializza yL
-
-  //  scorre le scanline di boundingBoxD
-  for (int kY = kMinY; kY <= kMaxY; kY++, dnRow += dnWrap) {
-    int xL = xL0 + (kMinX - 1) * deltaXL;  //  inizializza xL
-    yL += deltaYL;
-    //  il punto di up TPointD(xL/(1<<PADN), yL/(1<<PADN)) e' approssimato
-    //  con (xI, yI)
-    int yI = yL >> PADN;  //  troncato
-
-    //  filtro bilineare 4 pixels: calcolo degli y-pesi
-    int yWeight1 = (yL & MASKN);
-    int yWeight0 = (1 << PADN) - yWeight1;
-
-    TPixel32 *dnPix    = dnRow + xMin + kMinX;
-    TPixel32 *dnEndPix = dnRow + xMin + kMaxX + 1;
-
-    //  scorre i pixel sulla (yMin + kY)-esima scanline di dn
-    for (; dnPix < dnEndPix; ++dnPix) {
-      xL += deltaXL;
-      //  il punto di up TPointD(xL/(1<<PADN), yL/(1<<PADN)) e'
-      //  approssimato con (xI, yI)
-      int xI = xL >> PADN;  //  troncato
-
-      assert((0 <= xI) && (xI <= up->getLx() - 1) && (0 <= yI) &&
-             (yI <= up->getLy() - 1));
-
-      //  (xI, yI)
-      TPixelGR8 *upPix00 = upBasePix + (yI * upWrap + xI);
-
-      //  (xI + 1, yI)
-      TPixelGR8 *upPix10 = upPix00 + 1;
-
-      //  (xI, yI + 1)
-      TPixelGR8 *upPix01 = upPix00 + upWrap;
-
-      //  (xI + 1, yI + 1)
-      TPixelGR8 *upPix11 = upPix00 + upWrap + 1;
-
-      //  filtro bilineare 4 pixels: calcolo degli x-pesi
-      int xWeight1 = (xL & MASKN);
-      int xWeight0 = (1 << PADN) - xWeight1;
-
-      //  filtro bilineare 4 pixels: media pesata sui singoli canali
-      int colDownTmp =
-          (xWeight0 * (upPix00->value) + xWeight1 * (upPix10->value)) >> PADN;
-
-      int colUpTmp =
-          (xWeight0 * ((upPix01)->value) + xWeight1 * (upPix11->value)) >> PADN;
-
-      dnPix->m = 255;
-      dnPix->r = dnPix->g = dnPix->b =
-          (unsigned char)((yWeight0 * colDownTmp + yWeight1 * colUpTmp) >>
-                          PADN);
-    }
-  }
-  dn->unlock();
-  up->unlock();
-}
-
-//=============================================================================
-//=============================================================================
-//=============================================================================
-template <typename PIX>
-void doQuickResampleNoFilter(const TRasterPT<PIX> &dn, const TRasterPT<PIX> &up,
-                             double sx, double sy, double tx, double ty) {
-  //  se aff := TAffine(sx, 0, tx, 0, sy, ty) e' degenere la controimmagine
-  //  di up e' un segmento (o un punto)
-  if ((sx == 0) || (sy == 0)) return;
-
-  //  contatore bit di shift
-  const int PADN = 16;
-
-  //  max dimensioni di up gestibili (limite imposto dal numero di bit
-  //  disponibili per la parte intera di xL, yL)
-  assert(std::max(up->getLx(), up->getLy()) <
-         (1 << (8 * sizeof(int) - PADN - 1)));
-
-  TAffine aff(sx, 0, tx, 0, sy, ty);
-  TRectD boundingBoxD =
-      TRectD(convert(dn->getBounds())) *
-      (aff * TRectD(-0.5, -0.5, up->getLx() - 0.5, up->getLy() - 0.5));
-  //  clipping
-  if (boundingBoxD.x0 >= boundingBoxD.x1 || boundingBoxD.y0 >= boundingBoxD.y1)
-    return;
-
-  //  clipping y su dn
-  int yMin = std::max(tfloor(boundingBoxD.y0), 0);
-
-  //  clipping y su dn
-  int yMax = std::min(tceil(boundingBoxD.y1), dn->getLy() - 1);
-
-  //  clipping x su dn
-  int xMin = std::max(tfloor(boundingBoxD.x0), 0);
-
-  //  clipping x su dn
-  int xMax = std::min(tceil(boundingBoxD.x1), dn->getLx() - 1);
-
-  TAffine invAff = inv(aff);  //  inversa di aff
-
-  //  nello scorrere le scanline di boundingBoxD, il passaggio alla scanline
-  //  successiva comporta l'incremento (0, deltaYD) delle coordinate dei
-  //  pixels corrispondenti di up
-
-  //  nel disegnare la y-esima scanline di dn, il passaggio al pixel
-  //  successivo comporta l'incremento (deltaXD, 0) delle coordinate del
-  //  pixel corrispondente di up
-
-  double deltaXD = invAff.a11;
-  double deltaYD = invAff.a22;
-  int deltaXL =
-      tround(deltaXD * (1 << PADN));  //  deltaXD "TLonghizzato" (round)
-  int deltaYL =
-      tround(deltaYD * (1 << PADN));  //  deltaYD "TLonghizzato" (round)
-
-  //  se aff "TLonghizzata" (round) e' degenere la controimmagine di up e' un
-  //  segmento (o un punto)
-  if ((deltaXL == 0) || (deltaYL == 0)) return;
-
-  //  (1)  equazione (kX, kY)-parametrica di boundingBoxD:
-  //         (xMin, yMin) + kX*(1, 0) + kY*(0, 1),
-  //           kX = 0, ..., (xMax - xMin),
-  //           kY = 0, ..., (yMax - yMin)
-
-  //  (2)  equazione (kX, kY)-parametrica dell'immagine mediante invAff di (1):
-  //         invAff*(xMin, yMin) + kX*(deltaXD, 0) + kY*(0, deltaYD),
-  //           kX = kMinX, ..., kMaxX
-  //             con 0 <= kMinX <= kMaxX <= (xMax - xMin)
-  //           kY = kMinY, ..., kMaxY
-  //             con 0 <= kMinY <= kMaxY <= (yMax - yMin)
-
-  //  calcola kMinX, kMaxX, kMinY, kMaxY intersecando la (2) con i lati di up
-
-  //  il segmento [a, b] di up e' la controimmagine mediante aff della
-  //  porzione di scanline  [ (xMin, yMin), (xMax, yMin) ] di dn
-
-  //  TPointD b = invAff*TPointD(xMax, yMin);
-  TPointD a = invAff * TPointD(xMin, yMin);
-
-  //  (xL0, yL0) sono le coordinate di a (inizializzate per il round)
-  //  in versione "TLonghizzata"
-  //  0 <= xL0 + kX*deltaXL < up->getLx()*(1<<PADN),
-  //  0 <= kMinX <= kX <= kMaxX <= (xMax - xMin)
-
-  //  0 <= yL0 + kY*deltaYL < up->getLy()*(1<<PADN),
-  //  0 <= kMinY <= kY <= kMaxY <= (yMax - yMin)
-  int xL0 =
-      tround((a.x + 0.5) * (1 << PADN));  //  xL0 inizializzato per il round
-  int yL0 =
-      tround((a.y + 0.5) * (1 << PADN));  //  yL0 inizializzato per il round
-
-  //  calcola kMinY, kMaxY, kMinX, kMaxX intersecando la (2) con i lati di up
-  int kMinX = 0, kMaxX = xMax - xMin;  //  clipping su dn
-  int kMinY = 0, kMaxY = yMax - yMin;  //  clipping su dn
-  int lxPred =
-      up->getLx() * (1 << PADN) - 1;  //  TINT32 predecessore di up->getLx()
-  int lyPred =
-      up->getLy() * (1 << PADN) - 1;  //  TINT32 predecessore di up->getLy()
-
-  //  0 <= xL0 + k*deltaXL < up->getLx()*(1<<PADN)
-  //                  <=>
-  //  0 <= xL0 + k*deltaXL <= lxPred
-
-  //  0 <= yL0 + k*deltaYL < up->getLy()*(1<<PADN)
-  //                  <=>
-  //  0 <= yL0 + k*deltaYL <= lyPred
-
-  //  calcola kMinY, kMaxY  intersecando la (2) con i lati
-  //  (y = yMin) e (y = yMax) di up
-  if (deltaYL > 0)  //  (deltaYL != 0)
-  {
-    assert(yL0 <= lyPred);  //  [a, b] interno ad up+(bordo destro/basso)
-    kMaxY = (lyPred - yL0) / deltaYL;  //  floor
-    if (yL0 < 0) {
-      kMinY = ((-yL0) + deltaYL - 1) / deltaYL;  //  ceil
-    }
-  } else  //  (deltaYL < 0)
-  {
-    //  [a, b] interno ad up+(bordo destro/basso)
-    assert(0 <= yL0);
-
-    kMaxY = yL0 / (-deltaYL);  //  floor
-    if (lyPred < yL0) {
-      kMinY = (yL0 - lyPred - deltaYL - 1) / (-deltaYL);  //  ceil
-    }
-  }
-  //	calcola kMinY, kMaxY effettuando anche il clippind su dn
-  kMinY = std::max(kMinY, (int)0);
-  kMaxY = std::min(kMaxY, yMax - yMin);
-
-  //  calcola kMinX, kMaxX  intersecando la (2) con i lati
-  //  (x = xMin) e (x = xMax) di up
-  if (deltaXL > 0)  //  (deltaXL != 0)
-  {
-    //  [a, b] interno ad up+(bordo destro/basso)
-    assert(xL0 <= lxPred);
-
-    kMaxX = (lxPred - xL0) / deltaXL;  //  floor
-    if (xL0 < 0) {
-      kMinX = ((-xL0) + deltaXL - 1) / deltaXL;  //  ceil
-    }
-  } else  //  (deltaXL < 0)
-  {
-    //  [a, b] interno ad up+(bordo destro/basso)
-    assert(0 <= xL0);
-
-    kMaxX = xL0 / (-deltaXL);  //  floor
-    if (lxPred < xL0) {
-      kMinX = (xL0 - lxPred - deltaXL - 1) / (-deltaXL);  //  ceil
-    }
-  }
-  //  calcola kMinX, kMaxX effettuando anche il clippind su dn
-  kMinX = std::max(kMinX, (int)0);
-  kMaxX = std::min(kMaxX, xMax - xMin);
-
-  int dnWrap = dn->getWrap();
-  int upWrap = up->getWrap();
-  dn->lock();
-  up->lock();
-
-  PIX *upBasePix = up->pixels();
-  PIX *dnRow     = dn->pixels(yMin + kMinY);
-
-  //  (xL, yL) sono le coordinate (inizializzate per il round)
-  //  in versione "TLonghizzata" del pixel corrente di up
-  int yL = yL0 + (kMinY - 1) * deltaYL;  //  inizializza yL
-
-  //  scorre le scanline di boundingBoxD
-  for (int kY = kMinY; kY <= kMaxY; kY++, dnRow += dnWrap) {
-    int xL = xL0 + (kMinX - 1) * deltaXL;  //  inizializza xL
-    yL += deltaYL;
-    //  il punto di up TPointD(xL/(1<<PADN), yL/(1<<PADN)) e' approssimato
-    //  con (xI, yI)
-    int yI = yL >> PADN;  //  round
-
-    PIX *dnPix    = dnRow + xMin + kMinX;
-    PIX *dnEndPix = dnRow + xMin + kMaxX + 1;
-
-    //  scorre i pixel sulla (yMin + kY)-esima scanline di dn
-    for (; dnPix < dnEndPix; ++dnPix) {
-      xL += deltaXL;
-      //  il punto di up TPointD(xL/(1<<PADN), yL/(1<<PADN)) e'
-      //  approssimato con (xI, yI)
-      int xI = xL >> PADN;  //  round
-
-      assert((0 <= xI) && (xI <= up->getLx() - 1) && (0 <= yI) &&
-             (yI <= up->getLy() - 1));
-
-      *dnPix = *(upBasePix + (yI * upWrap + xI));
-    }
-  }
-
-  dn->unlock();
-  up->unlock();
-}
-
-//=============================================================================
-//=============================================================================
-//=============================================================================
-
-#ifndef TNZCORE_LIGHT
-
-//=============================================================================
-//=============================================================================
-//=============================================================================
-//=============================================================================
-//
-// doQuickPutCmapped
-//
-//=============================================================================
-
-void doQuickPutCmapped(const TRaster32P &dn, const TRasterCM32P &up,
-                       const TPaletteP &palette, const TAffine &aff,
-                       const TPixel32 &globalColorScale, bool inksOnly) {
-  //  se aff := TAffine(sx, 0, tx, 0, sy, ty) e' degenere la controimmagine
-  //  di up e' un segmento (o un punto)
-  if ((aff.a11 * aff.a22 - aff.a12 * aff.a21) == 0) return;
-
-  //  contatore bit di shift
-  const int PADN = 16;
-
-  //  max dimensioni di up gestibili (limite imposto dal numero di bit
-  //  disponibili per la parte intera di xL, yL)
-  assert(std::max(up->getLx(), up->getLy()) <
-         (1 << (8 * sizeof(int) - PADN - 1)));
-
-  TRectD boundingBoxD =
-      TRectD(convert(dn->getBounds())) *
-      (aff * TRectD(-0.5, -0.5, up->getLx() - 0.5, up->getLy() - 0.5));
-
-  //  clipping
-  if (boundingBoxD.x0 >= boundingBoxD.x1 || boundingBoxD.y0 >= boundingBoxD.y1)
-    return;
-
-  //  clipping y su dn
-  int yMin = std::max(tfloor(boundingBoxD.y0), 0);
-
-  //  clipping y su dn
-  int yMax = std::min(tceil(boundingBoxD.y1), dn->getLy() - 1);
-
-  //  clipping x su dn
-  int xMin = std::max(tfloor(boundingBoxD.x0), 0);
-
-  //  clipping x su dn
-  int xMax = std::min(tceil(boundingBoxD.x1), dn->getLx() - 1);
-
-  //  inversa di aff
-  TAffine invAff = inv(aff);
-
-  //  nel disegnare la y-esima scanline di dn, il passaggio al pixel
-  //  successivo comporta l'incremento (deltaXD, deltaYD) delle coordinate del
-  //  pixel corrispondente di up
-  double deltaXD = invAff.a11;
-  double deltaYD = invAff.a21;
-
-  //  deltaXD "TLonghizzato" (round)
-  int deltaXL = tround(deltaXD * (1 << PADN));
-
-  //  deltaYD "TLonghizzato" (round)
-  int deltaYL = tround(deltaYD * (1 << PADN));
-
-  //  se aff "TLonghizzata" (round) e' degenere la controimmagine di up e' un
-  //  segmento (o un punto)
-  if ((deltaXL == 0) && (deltaYL == 0)) return;
-
-  //  TINT32 predecessore di up->getLx()
-  int lxPred = up->getLx() * (1 << PADN) - 1;
-
-  //  TINT32 predecessore di up->getLy()
-  int lyPred = up->getLy() * (1 << PADN) - 1;
-
-  int dnWrap = dn->getWrap();
-  int upWrap = up->getWrap();
-
-  std::vector<TPixel32> colors(palette->getStyleCount());
-  // vector<TPixel32> inks(palette->getStyleCount());
-
-  if (globalColorScale != TPixel::Black)
-    for (int i = 0; i < palette->getStyleCount(); i++)
-      colors[i] = applyColorScaleCMapped(
-          palette->getStyle(i)->getAverageColor(), globalColorScale);
-  else
-    for (int i = 0; i < palette->getStyleCount(); i++)
-      colors[i] = ::premultiply(palette->getStyle(i)->getAverageColor());
-
-  dn->lock();
-  up->lock();
-
-  TPixel32 *dnRow       = dn->pixels(yMin);
-  TPixelCM32 *upBasePix = up->pixels();
-
-  //  scorre le scanline di boundingBoxD
-  for (int y = yMin; y <= yMax; y++, dnRow += dnWrap) {
-    //  (1)  equazione k-parametrica della y-esima scanline di boundingBoxD:
-    //       (xMin, y) + k*(1, 0),  k = 0, ..., (xMax - xMin)
-
-    //  (2)  equazione k-parametrica dell'immagine mediante invAff di (1):
-    //       invAff*(xMin, y) + k*(deltaXD, deltaYD),
-    //       k = kMin, ..., kMax con 0 <= kMin <= kMax <= (xMax - xMin)
-
-    //  calcola kMin, kMax per la scanline corrente
-    //  intersecando la (2) con i lati di up
-
-    //  il segmento [a, b] di up e' la controimmagine mediante aff della
-    //  porzione di scanline  [ (xMin, y), (xMax, y) ] di dn
-
-    //  TPointD b = invAff*TPointD(xMax, y);
-    TPointD a = invAff * TPointD(xMin, y);
-
-    //  (xL0, yL0) sono le coordinate di a (inizializzate per il round)
-    //  in versione "TLonghizzata"
-    //  0 <= xL0 + k*deltaXL
-    //    <  up->getLx()*(1<<PADN)
-    //
-    //  0 <= kMinX
-    //    <= kMin
-    //    <= k
-    //    <= kMax
-    //    <= kMaxX
-    //    <= (xMax - xMin)
-    //
-    //  0 <= yL0 + k*deltaYL
-    //    < up->getLy()*(1<<PADN)
-
-    //  0 <= kMinY
-    //    <= kMin
-    //    <= k
-    //    <= kMax
-    //    <= kMaxY
-    //    <= (xMax - xMin)
-
-    //  xL0 inizializzato per il round
-    int xL0 = tround((a.x + 0.5) * (1 << PADN));
-
-    //  yL0 inizializzato per il round
-    int yL0 = tround((a.y + 0.5) * (1 << PADN));
-
-    //  calcola kMinX, kMaxX, kMinY, kMaxY
-    int kMinX = 0, kMaxX = xMax - xMin;  //  clipping su dn
-    int kMinY = 0, kMaxY = xMax - xMin;  //  clipping su dn
-
-    //  0 <= xL0 + k*deltaXL
-    //    < up->getLx()*(1<<PADN)
-    //           <=>
-    //  0 <= xL0 + k*deltaXL
-    //    <= lxPred
-    //
-    //  0 <= yL0 + k*deltaYL
-    //    < up->getLy()*(1<<PADN)
-    //           <=>
-    //  0 <= yL0 + k*deltaYL
-    //    <= lyPred
-
-    //  calcola kMinX, kMaxX
-    if (deltaXL == 0) {
-      // [a, b] verticale esterno ad up+(bordo destro/basso)
-      if ((xL0 < 0) || (lxPred < xL0)) continue;
-      //  altrimenti usa solo
-      //  kMinY, kMaxY ((deltaXL != 0) || (deltaYL != 0))
-    } else if (deltaXL > 0) {
-      //  [a, b] esterno ad up+(bordo destro/basso)
-      if (lxPred < xL0) continue;
-
-      kMaxX = (lxPred - xL0) / deltaXL;  //  floor
-      if (xL0 < 0) {
-        kMinX = ((-xL0) + deltaXL - 1) / deltaXL;  //  ceil
-      }
-    } else  //  (deltaXL < 0)
-    {
-      //  [a, b] esterno ad up+(bordo destro/basso)
-      if (xL0 < 0) continue;
-
-      kMaxX = xL0 / (-deltaXL);  //  floor
-      if (lxPred < xL0) {
-        kMinX = (xL0 - lxPred - deltaXL - 1) / (-deltaXL);  //  ceil
-      }
-    }
-
-    //  calcola kMinY, kMaxY
-    if (deltaYL == 0) {
-      //  [a, b] orizzontale esterno ad up+(bordo destro/basso)
-      if ((yL0 < 0) || (lyPred < yL0)) continue;
-      // altrimenti usa solo
-      // kMinX, kMaxX ((deltaXL != 0) || (deltaYL != 0))
-    } else if (deltaYL > 0) {
-      //  [a, b] esterno ad up+(bordo destro/basso)
-      if (lyPred < yL0) continue;
-
-      kMaxY = (lyPred - yL0) / deltaYL;  //  floor
-      if (yL0 < 0) {
-        kMinY = ((-yL0) + deltaYL - 1) / deltaYL;  //  ceil
-      }
-    } else  //  (deltaYL < 0)
-    {
-      //  [a, b] esterno ad up+(bordo destro/basso)
-      if (yL0 < 0) continue;
-
-      kMaxY = yL0 / (-deltaYL);  //  floor
-      if (lyPred < yL0) {
-        kMinY = (yL0 - lyPred - deltaYL - 1) / (-deltaYL);  //  ceil
-      }
-    }
-
-    //  calcola kMin, kMax effettuando anche il clippind su dn
-    int kMin = std::max({kMinX, kMinY, (int)0});
-    int kMax = std::min({kMaxX, kMaxY, xMax - xMin});
-
-    TPixel32 *dnPix    = dnRow + xMin + kMin;
-    TPixel32 *dnEndPix = dnRow + xMin + kMax + 1;
-
-    //  (xL, yL) sono le coordinate (inizializzate per il round)
-    //  in versione "TLonghizzata" del pixel corrente di up
-    int xL = xL0 + (kMin - 1) * deltaXL;  //  inizializza xL
-    int yL = yL0 + (kMin - 1) * deltaYL;  //  inizializza yL
-
-    //  scorre i pixel sulla y-esima scanline di boundingBoxD
-    for (; dnPix < dnEndPix; ++dnPix) {
-      xL += deltaXL;
-      yL += deltaYL;
-
-      //  il punto di up TPointD(xL/(1<<PADN), yL/(1<<PADN)) e'
-      //  approssimato con (xI, yI)
-      int xI = xL >> PADN;  //  round
-      int yI = yL >> PADN;  //  round
-
-      assert((0 <= xI) && (xI <= up->getLx() - 1) && (0 <= yI) &&
-             (yI <= up->getLy() - 1));
-
-      TPixelCM32 *upPix = upBasePix + (yI * upWrap + xI);
-      int t             = upPix->getTone();
-      int p             = upPix->getPaint();
-
-      if (t == 0xff && p == 0)
-        continue;
-      else {
-        int i = upPix->getInk();
-        TPixel32 colorUp;
-        if (inksOnly) switch (t) {
-          case 0:
-            colorUp = colors[i];
-            break;
-          case 255:
-            colorUp = TPixel::Transparent;
-            break;
-          default:
-            colorUp = antialias(colors[i], 255 - t);
-            break;
-          }
-        else
-          switch (t) {
-          case 0:
-            colorUp = colors[i];
-            break;
-          case 255:
-            colorUp = colors[p];
-            break;
-          default:
-            colorUp = blend(colors[i], colors[p], t, TPixelCM32::getMaxTone());
-            break;
-          }
-
-        if (colorUp.m == 255)
-          *dnPix = colorUp;
-        else if (colorUp.m != 0)
-          *dnPix = quickOverPix(*dnPix, colorUp);
-      }
-    }
-  }
-  dn->unlock();
-  up->unlock();
-}
-
-//=============================================================================
-//
-// doQuickPutCmapped + transparencyCheck + inkCheck + paintcheck
-//
-//=============================================================================
-/*
-TPixel TransparencyCheckBlackBgInk = TPixel(255,255,255); //bg
-TPixel TransparencyCheckWhiteBgInk = TPixel(0,0,0);    //ink
-TPixel TransparencyCheckPaint = TPixel(127,127,127);  //paint*/
-
-void doQuickPutCmapped(const TRaster32P &dn, const TRasterCM32P &up,
-                       const TPaletteP &palette, const TAffine &aff,
-                       const TRop::CmappedQuickputSettings &s)
-/*const TPixel32& globalColorScale,
-                 bool inksOnly,
-                 bool transparencyCheck,
-                 bool blackBgCheck,
-                 int inkIndex,
-                 int paintIndex)*/
-{
-  if ((aff.a11 * aff.a22 - aff.a12 * aff.a21) == 0) return;
-  const int PADN = 16;
-  assert(std::max(up->getLx(), up->getLy()) <
-         (1 << (8 * sizeof(int) - PADN - 1)));
-  TRectD boundingBoxD =
-      TRectD(convert(dn->getBounds())) *
-      (aff * TRectD(-0.5, -0.5, up->getLx() - 0.5, up->getLy() - 0.5));
-  if (boundingBoxD.x0 >= boundingBoxD.x1 || boundingBoxD.y0 >= boundingBoxD.y1)
-    return;
-  int yMin       = std::max(tfloor(boundingBoxD.y0), 0);
-  int yMax       = std::min(tceil(boundingBoxD.y1), dn->getLy() - 1);
-  int xMin       = std::max(tfloor(boundingBoxD.x0), 0);
-  int xMax       = std::min(tceil(boundingBoxD.x1), dn->getLx() - 1);
-  TAffine invAff = inv(aff);
-  double deltaXD = invAff.a11;
-  double deltaYD = invAff.a21;
-  int deltaXL    = tround(deltaXD * (1 << PADN));
-  int deltaYL    = tround(deltaYD * (1 << PADN));
-  if ((deltaXL == 0) && (deltaYL == 0)) return;
-  int lxPred = up->getLx() * (1 << PADN) - 1;
-  int lyPred = up->getLy() * (1 << PADN) - 1;
-  int dnWrap = dn->getWrap();
-  int upWrap = up->getWrap();
-  std::vector<TPixel32> paints(palette->getStyleCount());
-  std::vector<TPixel32> inks(palette->getStyleCount());
-
-  if (s.m_transparencyCheck && !s.m_isOnionSkin) {
-    for (int i = 0; i < palette->getStyleCount(); i++) {
-      // if the style's autopaint flag is ON, show its original color
-      // so that users can easily find lines left unpainted.
-      if (i == s.m_gapCheckIndex || palette->getStyle(i)->getFlags() != 0) {
-        paints[i] = inks[i] = applyColorScaleCMapped(
-            palette->getStyle(i)->getAverageColor(), s.m_globalColorScale);
-      } else {
-        paints[i] = s.m_transpCheckPaint;
-        inks[i]   = s.m_blackBgCheck ? s.m_transpCheckBg : s.m_transpCheckInk;
-      }
-    }
-  } else if (s.m_globalColorScale == TPixel::Black)
-    for (int i = 0; i < palette->getStyleCount(); i++)
-      paints[i] = inks[i] =
-          ::premultiply(palette->getStyle(i)->getAverageColor());
-  else
-    for (int i = 0; i < palette->getStyleCount(); i++)
-      paints[i] = inks[i] = applyColorScaleCMapped(
-          palette->getStyle(i)->getAverageColor(), s.m_globalColorScale);
-
-  dn->lock();
-  up->lock();
-
-  TPixel32 *dnRow       = dn->pixels(yMin);
-  TPixelCM32 *upBasePix = up->pixels();
-  for (int y = yMin; y <= yMax; y++, dnRow += dnWrap) {
-    TPointD a = invAff * TPointD(xMin, y);
-    int xL0   = tround((a.x + 0.5) * (1 << PADN));
-    int yL0   = tround((a.y + 0.5) * (1 << PADN));
-    int kMinX = 0, kMaxX = xMax - xMin;
-    int kMinY = 0, kMaxY = xMax - xMin;
-    if (deltaXL == 0) {
-      if ((xL0 < 0) || (lxPred < xL0)) continue;
-    } else if (deltaXL > 0) {
-      if (lxPred < xL0) continue;
-
-      kMaxX = (lxPred - xL0) / deltaXL;                       //  floor
-      if (xL0 < 0) kMinX = ((-xL0) + deltaXL - 1) / deltaXL;  //  ceil
-    } else {
-      if (xL0 < 0) continue;
-
-      kMaxX = xL0 / (-deltaXL);  //  floor
-      if (lxPred < xL0)
-        kMinX = (xL0 - lxPred - deltaXL - 1) / (-deltaXL);  //  ceil
-    }
-    if (deltaYL == 0) {
-      if ((yL0 < 0) || (lyPred < yL0)) continue;
-    } else if (deltaYL > 0) {
-      if (lyPred < yL0) continue;
-
-      kMaxY = (lyPred - yL0) / deltaYL;
-      if (yL0 < 0) kMinY = ((-yL0) + deltaYL - 1) / deltaYL;
-    } else {
-      if (yL0 < 0) continue;
-      kMaxY = yL0 / (-deltaYL);  //  floor
-      if (lyPred < yL0)
-        kMinY = (yL0 - lyPred - deltaYL - 1) / (-deltaYL);  //  ceil
-    }
-    int kMin = std::max({kMinX, kMinY, (int)0});
-    int kMax = std::min({kMaxX, kMaxY, xMax - xMin});
-
-    TPixel32 *dnPix    = dnRow + xMin + kMin;
-    TPixel32 *dnEndPix = dnRow + xMin + kMax + 1;
-    int xL             = xL0 + (kMin - 1) * deltaXL;
-    int yL             = yL0 + (kMin - 1) * deltaYL;
-    for (; dnPix < dnEndPix; ++dnPix) {
-      xL += deltaXL;
-      yL += deltaYL;
-      int xI = xL >> PADN;
-      int yI = yL >> PADN;
-      assert((0 <= xI) && (xI <= up->getLx() - 1) && (0 <= yI) &&
-             (yI <= up->getLy() - 1));
-      TPixelCM32 *upPix = upBasePix + (yI * upWrap + xI);
-      int t             = upPix->getTone();
-      int p             = upPix->getPaint();
-
-      if (t == 0xff && p == 0)
-        continue;
-      else {
-        int i = upPix->getInk();
-        TPixel32 colorUp;
-        if (s.m_inksOnly) switch (t) {
-          case 0:
-            colorUp = (i == s.m_inkIndex) ? TPixel::Red : inks[i];
-            break;
-          case 255:
-            colorUp = TPixel::Transparent;
-            break;
-          default: {
-            TPixel inkColor;
-            if (i == s.m_inkIndex) {
-              inkColor = TPixel::Red;
-              if (p == 0) {
-                t = t / 2;  // transparency check(for a bug!) darken
-                            // semitrasparent pixels; ghibli likes it, and wants
-                            // it also for ink checks...
-                // otherwise, ramps goes always from reds towards grey...
-              }
-            } else
-              inkColor = inks[i];
-
-            colorUp = antialias(inkColor, 255 - t);
-            break;
-          }
-          }
-        else
-          switch (t) {
-          case 0:
-            colorUp = (i == s.m_inkIndex) ? TPixel::Red : inks[i];
-            break;
-          case 255:
-            colorUp = (p == s.m_paintIndex) ? TPixel::Red : paints[p];
-            break;
-          default: {
-            TPixel paintColor = (p == s.m_paintIndex) ? TPixel::Red : paints[p];
-            TPixel inkColor;
-            if (i == s.m_inkIndex) {
-              inkColor = TPixel::Red;
-              if (p == 0) {
-                paintColor = TPixel::Transparent;
-              }
-            } else
-              inkColor = inks[i];
-
-            if (s.m_transparencyCheck) t = t / 2;
-
-            colorUp = blend(inkColor, paintColor, t, TPixelCM32::getMaxTone());
-            break;
-          }
-          }
-
-        if (colorUp.m == 255)
-          *dnPix = colorUp;
-        else if (colorUp.m != 0)
-          *dnPix = quickOverPix(*dnPix, colorUp);
-      }
+      dnPix->m = 255;
+      dnPix->r = dnPix->g = dnPix->b =
+          (unsigned char)((yWeight0 * colDownTmp + yWeight1 * colUpTmp) >>
+                          PADN);
     }
   }
   dn->unlock();
@@ -4278,26 +2203,26 @@ void doQuickPutCmapped(const TRaster32P &dn, const TRasterCM32P &up,
 
 //=============================================================================
 //=============================================================================
-void doQuickPutCmapped(const TRaster32P &dn, const TRasterCM32P &up,
-                       const TPaletteP &palette, double sx, double sy,
-                       double tx, double ty, const TPixel32 &globalColorScale,
-                       bool inksOnly) {
+//=============================================================================
+template <typename PIX>
+void doQuickResampleNoFilter(const TRasterPT<PIX> &dn, const TRasterPT<PIX> &up,
+                             double sx, double sy, double tx, double ty) {
   //  se aff := TAffine(sx, 0, tx, 0, sy, ty) e' degenere la controimmagine
   //  di up e' un segmento (o un punto)
   if ((sx == 0) || (sy == 0)) return;
 
   //  contatore bit di shift
   const int PADN = 16;
+
+  //  max dimensioni di up gestibili (limite imposto dal numero di bit
+  //  disponibili per la parte intera di xL, yL)
   assert(std::max(up->getLx(), up->getLy()) <
          (1 << (8 * sizeof(int) - PADN - 1)));
-  //  max dimensioni di up gestibili (limite imposto dal numero di bit
-  // disponibili per la parte intera di xL, yL)
 
   TAffine aff(sx, 0, tx, 0, sy, ty);
   TRectD boundingBoxD =
       TRectD(convert(dn->getBounds())) *
       (aff * TRectD(-0.5, -0.5, up->getLx() - 0.5, up->getLy() - 0.5));
-
   //  clipping
   if (boundingBoxD.x0 >= boundingBoxD.x1 || boundingBoxD.y0 >= boundingBoxD.y1)
     return;
@@ -4326,88 +2251,68 @@ void doQuickPutCmapped(const TRaster32P &dn, const TRasterCM32P &up,
 
   double deltaXD = invAff.a11;
   double deltaYD = invAff.a22;
-
-  //  deltaXD "TLonghizzato" (round)
-  int deltaXL = tround(deltaXD * (1 << PADN));
-
-  //  deltaYD "TLonghizzato" (round)
-  int deltaYL = tround(deltaYD * (1 << PADN));
+  int deltaXL =
+      tround(deltaXD * (1 << PADN));  //  deltaXD "TLonghizzato" (round)
+  int deltaYL =
+      tround(deltaYD * (1 << PADN));  //  deltaYD "TLonghizzato" (round)
 
   //  se aff "TLonghizzata" (round) e' degenere la controimmagine di up e' un
   //  segmento (o un punto)
   if ((deltaXL == 0) || (deltaYL == 0)) return;
 
-  //	(1)  equazione (kX, kY)-parametrica di boundingBoxD:
-  //	       (xMin, yMin) + kX*(1, 0) + kY*(0, 1),
-  //	         kX = 0, ..., (xMax - xMin),
-  //             kY = 0, ..., (yMax - yMin)
+  //  (1)  equazione (kX, kY)-parametrica di boundingBoxD:
+  //         (xMin, yMin) + kX*(1, 0) + kY*(0, 1),
+  //           kX = 0, ..., (xMax - xMin),
+  //           kY = 0, ..., (yMax - yMin)
 
-  //	(2)  equazione (kX, kY)-parametrica dell'immagine
-  //         mediante invAff di (1):
-  //	       invAff*(xMin, yMin) + kX*(deltaXD, 0) + kY*(0, deltaYD),
-  //	         kX = kMinX, ..., kMaxX
+  //  (2)  equazione (kX, kY)-parametrica dell'immagine mediante invAff di (1):
+  //         invAff*(xMin, yMin) + kX*(deltaXD, 0) + kY*(0, deltaYD),
+  //           kX = kMinX, ..., kMaxX
   //             con 0 <= kMinX <= kMaxX <= (xMax - xMin)
-  //
-  //             kY = kMinY, ..., kMaxY
+  //           kY = kMinY, ..., kMaxY
   //             con 0 <= kMinY <= kMaxY <= (yMax - yMin)
 
   //  calcola kMinX, kMaxX, kMinY, kMaxY intersecando la (2) con i lati di up
 
   //  il segmento [a, b] di up e' la controimmagine mediante aff della
-  // porzione di scanline  [ (xMin, yMin), (xMax, yMin) ] di dn
+  //  porzione di scanline  [ (xMin, yMin), (xMax, yMin) ] di dn
 
   //  TPointD b = invAff*TPointD(xMax, yMin);
   TPointD a = invAff * TPointD(xMin, yMin);
 
   //  (xL0, yL0) sono le coordinate di a (inizializzate per il round)
-  // in versione "TLonghizzata"
-  //	0 <= xL0 + kX*deltaXL
-  //      < up->getLx()*(1<<PADN),
-  //
-  //    0 <= kMinX
-  //      <= kX
-  //      <= kMaxX
-  //      <= (xMax - xMin)
-
-  //	0 <= yL0 + kY*deltaYL
-  //      < up->getLy()*(1<<PADN),
-  //
-  //    0 <= kMinY
-  //      <= kY
-  //      <= kMaxY
-  //      <= (yMax - yMin)
-
-  //  xL0 inizializzato per il round
-  int xL0 = tround((a.x + 0.5) * (1 << PADN));
+  //  in versione "TLonghizzata"
+  //  0 <= xL0 + kX*deltaXL < up->getLx()*(1<<PADN),
+  //  0 <= kMinX <= kX <= kMaxX <= (xMax - xMin)
 
-  //  yL0 inizializzato per il round
-  int yL0 = tround((a.y + 0.5) * (1 << PADN));
+  //  0 <= yL0 + kY*deltaYL < up->getLy()*(1<<PADN),
+  //  0 <= kMinY <= kY <= kMaxY <= (yMax - yMin)
+  int xL0 =
+      tround((a.x + 0.5) * (1 << PADN));  //  xL0 inizializzato per il round
+  int yL0 =
+      tround((a.y + 0.5) * (1 << PADN));  //  yL0 inizializzato per il round
 
   //  calcola kMinY, kMaxY, kMinX, kMaxX intersecando la (2) con i lati di up
   int kMinX = 0, kMaxX = xMax - xMin;  //  clipping su dn
   int kMinY = 0, kMaxY = yMax - yMin;  //  clipping su dn
-
-  //  TINT32 predecessore di up->getLx()
-  int lxPred = up->getLx() * (1 << PADN) - 1;
-
-  //  TINT32 predecessore di up->getLy()
-  int lyPred = up->getLy() * (1 << PADN) - 1;
+  int lxPred =
+      up->getLx() * (1 << PADN) - 1;  //  TINT32 predecessore di up->getLx()
+  int lyPred =
+      up->getLy() * (1 << PADN) - 1;  //  TINT32 predecessore di up->getLy()
 
   //  0 <= xL0 + k*deltaXL < up->getLx()*(1<<PADN)
-  //            <=>
+  //                  <=>
   //  0 <= xL0 + k*deltaXL <= lxPred
 
   //  0 <= yL0 + k*deltaYL < up->getLy()*(1<<PADN)
-  //            <=>
+  //                  <=>
   //  0 <= yL0 + k*deltaYL <= lyPred
 
-  //  calcola kMinY, kMaxY intersecando la (2) con i lati
+  //  calcola kMinY, kMaxY  intersecando la (2) con i lati
   //  (y = yMin) e (y = yMax) di up
   if (deltaYL > 0)  //  (deltaYL != 0)
   {
-    //  [a, b] interno ad up+(bordo destro/basso)
-    assert(yL0 <= lyPred);
-
+    assert(yL0 <= lyPred);  //  [a, b] interno ad up+(bordo destro/basso)
     kMaxY = (lyPred - yL0) / deltaYL;  //  floor
     if (yL0 < 0) {
       kMinY = ((-yL0) + deltaYL - 1) / deltaYL;  //  ceil
@@ -4422,11 +2327,11 @@ void doQuickPutCmapped(const TRaster32P &dn, const TRasterCM32P &up,
       kMinY = (yL0 - lyPred - deltaYL - 1) / (-deltaYL);  //  ceil
     }
   }
-  //  calcola kMinY, kMaxY effettuando anche il clippind su dn
+  //	calcola kMinY, kMaxY effettuando anche il clippind su dn
   kMinY = std::max(kMinY, (int)0);
   kMaxY = std::min(kMaxY, yMax - yMin);
 
-  //  calcola kMinX, kMaxX intersecando la (2) con i lati
+  //  calcola kMinX, kMaxX  intersecando la (2) con i lati
   //  (x = xMin) e (x = xMax) di up
   if (deltaXL > 0)  //  (deltaXL != 0)
   {
@@ -4453,100 +2358,262 @@ void doQuickPutCmapped(const TRaster32P &dn, const TRasterCM32P &up,
 
   int dnWrap = dn->getWrap();
   int upWrap = up->getWrap();
-
-  int count = std::max({palette->getStyleCount(), TPixelCM32::getMaxInk(),
-                        TPixelCM32::getMaxPaint()});
-
-  std::vector<TPixel32> paints(count, TPixel32::Red);
-  std::vector<TPixel32> inks(count, TPixel32::Red);
-  if (globalColorScale != TPixel::Black)
-    for (int i = 0; i < palette->getStyleCount(); i++)
-      paints[i] = inks[i] = applyColorScaleCMapped(
-          palette->getStyle(i)->getAverageColor(), globalColorScale);
-  else
-    for (int i = 0; i < palette->getStyleCount(); i++)
-      paints[i] = inks[i] =
-          ::premultiply(palette->getStyle(i)->getAverageColor());
-
   dn->lock();
   up->lock();
-  TPixelCM32 *upBasePix = up->pixels();
-  TPixel32 *dnRow       = dn->pixels(yMin + kMinY);
+
+  PIX *upBasePix = up->pixels();
+  PIX *dnRow     = dn->pixels(yMin + kMinY);
 
   //  (xL, yL) sono le coordinate (inizializzate per il round)
   //  in versione "TLonghizzata" del pixel corrente di up
-
-  //  inizializza yL
-  int yL = yL0 + (kMinY - 1) * deltaYL;
+  int yL = yL0 + (kMinY - 1) * deltaYL;  //  inizializza yL
 
   //  scorre le scanline di boundingBoxD
   for (int kY = kMinY; kY <= kMaxY; kY++, dnRow += dnWrap) {
-    //  inizializza xL
-    int xL = xL0 + (kMinX - 1) * deltaXL;
+    int xL = xL0 + (kMinX - 1) * deltaXL;  //  inizializza xL
     yL += deltaYL;
-
     //  il punto di up TPointD(xL/(1<<PADN), yL/(1<<PADN)) e' approssimato
     //  con (xI, yI)
     int yI = yL >> PADN;  //  round
 
-    TPixel32 *dnPix    = dnRow + xMin + kMinX;
-    TPixel32 *dnEndPix = dnRow + xMin + kMaxX + 1;
+    PIX *dnPix    = dnRow + xMin + kMinX;
+    PIX *dnEndPix = dnRow + xMin + kMaxX + 1;
 
     //  scorre i pixel sulla (yMin + kY)-esima scanline di dn
     for (; dnPix < dnEndPix; ++dnPix) {
       xL += deltaXL;
       //  il punto di up TPointD(xL/(1<<PADN), yL/(1<<PADN)) e'
       //  approssimato con (xI, yI)
-      int xI = xL >> PADN;  //	round
+      int xI = xL >> PADN;  //  round
 
       assert((0 <= xI) && (xI <= up->getLx() - 1) && (0 <= yI) &&
              (yI <= up->getLy() - 1));
 
-      TPixelCM32 *upPix = upBasePix + (yI * upWrap + xI);
-      int t             = upPix->getTone();
-      int p             = upPix->getPaint();
-      assert(0 <= t && t < 256);
-      assert(0 <= p && p < (int)paints.size());
+      *dnPix = *(upBasePix + (yI * upWrap + xI));
+    }
+  }
 
-      if (t == 0xff && p == 0)
-        continue;
-      else {
-        int i = upPix->getInk();
-        assert(0 <= i && i < (int)inks.size());
-        TPixel32 colorUp;
-        if (inksOnly) switch (t) {
-          case 0:
-            colorUp = inks[i];
-            break;
-          case 255:
-            colorUp = TPixel::Transparent;
-            break;
-          default:
-            colorUp = antialias(inks[i], 255 - t);
-            break;
+  dn->unlock();
+  up->unlock();
+}
+
+//=============================================================================
+//=============================================================================
+//=============================================================================
+
+#ifndef TNZCORE_LIGHT
+
+//! Returns the premultiplied colors of the palette styles, scaled by
+//! globalColorScale. Indices beyond the palette styles map to red.
+std::vector<TPixel32> getStyleColors(const TPaletteP &palette,
+                                     const TPixel32 &globalColorScale) {
+  int count = std::max({palette->getStyleCount(), TPixelCM32::getMaxInk() + 1,
+                        TPixelCM32::getMaxPaint() + 1});
+  std::vector<TPixel32> colors(count, TPixel32::Red);
+
+  if (globalColorScale != TPixel::Black)
+    for (int i = 0; i < palette->getStyleCount(); i++)
+      colors[i] = applyColorScaleCMapped(
+          palette->getStyle(i)->getAverageColor(), globalColorScale);
+  else
+    for (int i = 0; i < palette->getStyleCount(); i++)
+      colors[i] = ::premultiply(palette->getStyle(i)->getAverageColor());
+
+  return colors;
+}
+
+//------------------------------------------------------------------------------
+
+//! Puts colormapped pixels, given the colors of their styles.
+class CmappedPixel {
+  const std::vector<TPixel32> &m_colors;
+  bool m_inksOnly;
+
+public:
+  CmappedPixel(const std::vector<TPixel32> &colors, bool inksOnly)
+      : m_colors(colors), m_inksOnly(inksOnly) {}
+
+  void operator()(TPixel32 &dnPix, const TPixelCM32 &upPix) const {
+    int t = upPix.getTone();
+    int p = upPix.getPaint();
+    assert(0 <= t && t < 256);
+    assert(0 <= p && p < (int)m_colors.size());
+
+    if (t == 0xff && p == 0) return;
+
+    int i = upPix.getInk();
+    assert(0 <= i && i < (int)m_colors.size());
+
+    TPixel32 colorUp;
+    if (m_inksOnly) switch (t) {
+      case 0:
+        colorUp = m_colors[i];
+        break;
+      case 255:
+        colorUp = TPixel::Transparent;
+        break;
+      default:
+        colorUp = antialias(m_colors[i], 255 - t);
+        break;
+      }
+    else
+      switch (t) {
+      case 0:
+        colorUp = m_colors[i];
+        break;
+      case 255:
+        colorUp = m_colors[p];
+        break;
+      default:
+        colorUp = blend(m_colors[i], m_colors[p], t, TPixelCM32::getMaxTone());
+        break;
+      }
+
+    if (colorUp.m == 255)
+      dnPix = colorUp;
+    else if (colorUp.m != 0)
+      dnPix = quickOverPix(dnPix, colorUp);
+  }
+};
+
+//=============================================================================
+//=============================================================================
+//=============================================================================
+//=============================================================================
+//=============================================================================
+//=============================================================================
+//=============================================================================
+//
+// doQuickPutCmapped
+//
+//=============================================================================
+
+void doQuickPutCmapped(const TRaster32P &dn, const TRasterCM32P &up,
+                       const TPaletteP &palette, const TAffine &aff,
+                       const TPixel32 &globalColorScale, bool inksOnly) {
+  std::vector<TPixel32> colors = getStyleColors(palette, globalColorScale);
+  quickPutAffine(dn, up, aff, CmappedPixel(colors, inksOnly));
+}
+
+//=============================================================================
+//
+// doQuickPutCmapped + transparencyCheck + inkCheck + paintcheck
+//
+//=============================================================================
+/*
+TPixel TransparencyCheckBlackBgInk = TPixel(255,255,255); //bg
+TPixel TransparencyCheckWhiteBgInk = TPixel(0,0,0);    //ink
+TPixel TransparencyCheckPaint = TPixel(127,127,127);  //paint*/
+
+void doQuickPutCmapped(const TRaster32P &dn, const TRasterCM32P &up,
+                       const TPaletteP &palette, const TAffine &aff,
+                       const TRop::CmappedQuickputSettings &s)
+/*const TPixel32& globalColorScale,
+                 bool inksOnly,
+                 bool transparencyCheck,
+                 bool blackBgCheck,
+                 int inkIndex,
+                 int paintIndex)*/
+{
+  std::vector<TPixel32> paints(palette->getStyleCount());
+  std::vector<TPixel32> inks(palette->getStyleCount());
+
+  if (s.m_transparencyCheck && !s.m_isOnionSkin) {
+    for (int i = 0; i < palette->getStyleCount(); i++) {
+      // if the style's autopaint flag is ON, show its original color
+      // so that users can easily find lines left unpainted.
+      if (i == s.m_gapCheckIndex || palette->getStyle(i)->getFlags() != 0) {
+        paints[i] = inks[i] = applyColorScaleCMapped(
+            palette->getStyle(i)->getAverageColor(), s.m_globalColorScale);
+      } else {
+        paints[i] = s.m_transpCheckPaint;
+        inks[i]   = s.m_blackBgCheck ? s.m_transpCheckBg : s.m_transpCheckInk;
+      }
+    }
+  } else if (s.m_globalColorScale == TPixel::Black)
+    for (int i = 0; i < palette->getStyleCount(); i++)
+      paints[i] = inks[i] =
+          ::premultiply(palette->getStyle(i)->getAverageColor());
+  else
+    for (int i = 0; i < palette->getStyleCount(); i++)
+      paints[i] = inks[i] = applyColorScaleCMapped(
+          palette->getStyle(i)->getAverageColor(), s.m_globalColorScale);
+
+  auto putPixel = [&](TPixel32 &dnPix, const TPixelCM32 &upPix) {
+    int t = upPix.getTone();
+    int p = upPix.getPaint();
+
+    if (t == 0xff && p == 0) return;
+
+    int i = upPix.getInk();
+    TPixel32 colorUp;
+    if (s.m_inksOnly) switch (t) {
+      case 0:
+        colorUp = (i == s.m_inkIndex) ? TPixel::Red : inks[i];
+        break;
+      case 255:
+        colorUp = TPixel::Transparent;
+        break;
+      default: {
+        TPixel inkColor;
+        if (i == s.m_inkIndex) {
+          inkColor = TPixel::Red;
+          if (p == 0) {
+            t = t / 2;  // transparency check(for a bug!) darken
+                        // semitrasparent pixels; ghibli likes it, and wants
+                        // it also for ink checks...
+            // otherwise, ramps goes always from reds towards grey...
           }
-        else
-          switch (t) {
-          case 0:
-            colorUp = inks[i];
-            break;
-          case 255:
-            colorUp = paints[p];
-            break;
-          default:
-            colorUp = blend(inks[i], paints[p], t, TPixelCM32::getMaxTone());
-            break;
+        } else
+          inkColor = inks[i];
+
+        colorUp = antialias(inkColor, 255 - t);
+        break;
+      }
+      }
+    else
+      switch (t) {
+      case 0:
+        colorUp = (i == s.m_inkIndex) ? TPixel::Red : inks[i];
+        break;
+      case 255:
+        colorUp = (p == s.m_paintIndex) ? TPixel::Red : paints[p];
+        break;
+      default: {
+        TPixel paintColor = (p == s.m_paintIndex) ? TPixel::Red : paints[p];
+        TPixel inkColor;
+        if (i == s.m_inkIndex) {
+          inkColor = TPixel::Red;
+          if (p == 0) {
+            paintColor = TPixel::Transparent;
           }
+        } else
+          inkColor = inks[i];
+
+        if (s.m_transparencyCheck) t = t / 2;
 
-        if (colorUp.m == 255)
-          *dnPix = colorUp;
-        else if (colorUp.m != 0)
-          *dnPix = quickOverPix(*dnPix, colorUp);
+        colorUp = blend(inkColor, paintColor, t, TPixelCM32::getMaxTone());
+        break;
       }
-    }
-  }
-  dn->unlock();
-  up->unlock();
+      }
+
+    if (colorUp.m == 255)
+      dnPix = colorUp;
+    else if (colorUp.m != 0)
+      dnPix = quickOverPix(dnPix, colorUp);
+  };
+
+  quickPutAffine(dn, up, aff, putPixel);
+}
+
+//=============================================================================
+//=============================================================================
+void doQuickPutCmapped(const TRaster32P &dn, const TRasterCM32P &up,
+                       const TPaletteP &palette, double sx, double sy,
+                       double tx, double ty, const TPixel32 &globalColorScale,
+                       bool inksOnly) {
+  std::vector<TPixel32> colors = getStyleColors(palette, globalColorScale);
+  quickPutScaled(dn, up, sx, sy, tx, ty, CmappedPixel(colors, inksOnly));
 }
 
 //=============================================================================
@@ -5207,6 +3274,12 @@ void quickPut(const TRasterP &dn, const TRasterP &up, const TAffine &aff,
     doQuickPutNoFilter(dn64, upF, aff, doPremultiply, firstColumn);
   else if (dnF && upF)
     doQuickPutNoFilter(dnF, upF, aff, doPremultiply, firstColumn);
+  else if (dnF && up32)
+    doQuickPutNoFilter(dnF, up32, aff, doPremultiply, firstColumn);
+  else if (dnF && up64)
+    doQuickPutNoFilter(dnF, up64, aff, doPremultiply, firstColumn);
+  else if (dn32 && upF)
+    doQuickPutNoFilter(dn32, upF, aff, doPremultiply, firstColumn);
   else
     throw TRopException("raster type mismatch");
 }
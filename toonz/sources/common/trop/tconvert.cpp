@@ -6,6 +6,8 @@
 #include "tpixelgr.h"
 #include "trandom.h"
 #include "tpixelutils.h"
+#include "tsystem.h"
+#include "avx2P.h"
 
 //******************************************************************
 //    Conversion functions
@@ -417,6 +419,124 @@ static void do_convert(const TRaster64P &dst, const TRasterFP &src) {
   }
 }
 
+//******************************************************************
+//    AVX2 conversion functions
+//******************************************************************
+
+#ifdef USE_AVX2
+
+//! Same results as do_convert(const TRaster64P &, const TRaster32P &)
+AVX2_TARGET static void do_convert_AVX2(const TRaster64P &dst,
+                                        const TRaster32P &src) {
+  assert(dst->getSize() == src->getSize());
+  int lx = src->getLx();
+  for (int y = 0; y < src->getLy(); y++) {
+    TPixel64 *outPix   = dst->pixels(y);
+    TPixel32 *inPix    = src->pixels(y);
+    TPixel32 *inEndPix = inPix + lx;
+
+    // 4 pixels at a time - each channel c becomes c | c << 8
+    for (; inEndPix - inPix >= 4; outPix += 4, inPix += 4) {
+      __m256i c = _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i *)inPix));
+      _mm256_storeu_si256((__m256i *)outPix,
+                          _mm256_or_si256(c, _mm256_slli_epi16(c, 8)));
+    }
+
+    for (; inPix < inEndPix; ++outPix, ++inPix) {
+      outPix->r = ushortFromByte(inPix->r);
+      outPix->g = ushortFromByte(inPix->g);
+      outPix->b = ushortFromByte(inPix->b);
+      outPix->m = ushortFromByte(inPix->m);
+    }
+  }
+}
+
+//-----------------------------------------------------------------------------
+
+//! Same results as do_convert(const TRasterFP &, const TRaster32P &)
+AVX2_TARGET static void do_convert_AVX2(const TRasterFP &dst,
+                                        const TRaster32P &src) {
+  const __m256 maxValue = _mm256_set1_ps((float)TPixel32::maxChannelValue);
+
+  assert(dst->getSize() == src->getSize());
+  int lx = src->getLx();
+  for (int y = 0; y < src->getLy(); y++) {
+    TPixelF *outPix    = dst->pixels(y);
+    TPixel32 *inPix    = src->pixels(y);
+    TPixel32 *inEndPix = inPix + lx;
+
+    // 2 pixels at a time
+    for (; inEndPix - inPix >= 2; outPix += 2, inPix += 2) {
+      __m256i c = _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i *)inPix));
+      _mm256_storeu_ps((float *)outPix,
+                       _mm256_div_ps(_mm256_cvtepi32_ps(c), maxValue));
+    }
+
+    for (; inPix < inEndPix; ++outPix, ++inPix) {
+      outPix->r = (float)inPix->r / (float)TPixel32::maxChannelValue;
+      outPix->g = (float)inPix->g / (float)TPixel32::maxChannelValue;
+      outPix->b = (float)inPix->b / (float)TPixel32::maxChannelValue;
+      outPix->m = (float)inPix->m / (float)TPixel32::maxChannelValue;
+    }
+  }
+}
+
+//-----------------------------------------------------------------------------
+
+//! Same results as do_convert(const TRaster32P &, const TRasterFP &)
+AVX2_TARGET static void do_convert_AVX2(const TRaster32P &dst,
+                                        const TRasterFP &src) {
+  auto clamp01 = [](float val) {
+    return (val < 0.f) ? 0.f : (val > 1.f) ? 1.f : val;
+  };
+
+  const __m256 zeros    = _mm256_setzero_ps();
+  const __m256 ones     = _mm256_set1_ps(1.f);
+  const __m256 halves   = _mm256_set1_ps(0.5f);
+  const __m256 maxValue = _mm256_set1_ps((float)TPixel32::maxChannelValue);
+
+  // Restores the pixels order after the in-lane packs below
+  const __m256i pixelsOrder = _mm256_setr_epi32(0, 4, 1, 5, 2, 6, 3, 7);
+
+  __m256i c[4];
+
+  assert(dst->getSize() == src->getSize());
+  int lx = src->getLx();
+  for (int y = 0; y < src->getLy(); y++) {
+    TPixel32 *outPix  = dst->pixels(y);
+    TPixelF *inPix    = src->pixels(y);
+    TPixelF *inEndPix = inPix + lx;
+
+    // 8 pixels at a time
+    for (; inEndPix - inPix >= 8; outPix += 8, inPix += 8) {
+      for (int i = 0; i < 4; ++i) {
+        __m256 v = _mm256_loadu_ps((const float *)(inPix + 2 * i));
+        v        = _mm256_min_ps(_mm256_max_ps(v, zeros), ones);
+        c[i]     = _mm256_cvttps_epi32(
+            _mm256_add_ps(_mm256_mul_ps(v, maxValue), halves));
+      }
+
+      __m256i packed = _mm256_packus_epi16(_mm256_packus_epi32(c[0], c[1]),
+                                           _mm256_packus_epi32(c[2], c[3]));
+      _mm256_storeu_si256((__m256i *)outPix,
+                          _mm256_permutevar8x32_epi32(packed, pixelsOrder));
+    }
+
+    for (; inPix < inEndPix; ++outPix, ++inPix) {
+      outPix->r = (TPixel32::Channel)(
+          clamp01(inPix->r) * (float)TPixel32::maxChannelValue + 0.5f);
+      outPix->g = (TPixel32::Channel)(
+          clamp01(inPix->g) * (float)TPixel32::maxChannelValue + 0.5f);
+      outPix->b = (TPixel32::Channel)(
+          clamp01(inPix->b) * (float)TPixel32::maxChannelValue + 0.5f);
+      outPix->m = (TPixel32::Channel)(
+          clamp01(inPix->m) * (float)TPixel32::maxChannelValue + 0.5f);
+    }
+  }
+}
+
+#endif
+
 //******************************************************************
 //    Main conversion function
 //******************************************************************
@@ -442,9 +562,14 @@ void TRop::convert(TRasterP dst, const TRasterP &src) {
   src->lock();
   dst->lock();
 
-  if (dst64 && src32)
-    do_convert(dst64, src32);
-  else if (dst8 && src32)
+  if (dst64 && src32) {
+#ifdef USE_AVX2
+    if (TSystem::getCPUExtensions() & TSystem::CpuSupportsAvx2)
+      do_convert_AVX2(dst64, src32);
+    else
+#endif
+      do_convert(dst64, src32);
+  } else if (dst8 && src32)
     do_convert(dst8, src32);
   else if (dst16 && src32)
     do_convert(dst16, src32);
@@ -463,13 +588,23 @@ void TRop::convert(TRasterP dst, const TRasterP &src) {
   else if (dstCm && src8)
     do_convert(dstCm, src8);  //
   // conversion from/to double
-  else if (dstF && src32)
-    do_convert(dstF, src32);
-  else if (dstF && src64)
+  else if (dstF && src32) {
+#ifdef USE_AVX2
+    if (TSystem::getCPUExtensions() & TSystem::CpuSupportsAvx2)
+      do_convert_AVX2(dstF, src32);
+    else
+#endif
+      do_convert(dstF, src32);
+  } else if (dstF && src64)
     do_convert(dstF, src64);
-  else if (dst32 && srcF)
-    do_convert(dst32, srcF);
-  else if (dst64 && srcF)
+  else if (dst32 && srcF) {
+#ifdef USE_AVX2
+    if (TSystem::getCPUExtensions() & TSystem::CpuSupportsAvx2)
+      do_convert_AVX2(dst32, srcF);
+    else
+#endif
+      do_convert(dst32, srcF);
+  } else if (dst64 && srcF)
     do_convert(dst64, srcF);
   else {
     dst->unlock();
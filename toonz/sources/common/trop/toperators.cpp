@@ -3,6 +3,8 @@
 #include "trop.h"
 #include "tpixel.h"
 #include "tpixelutils.h"
+#include "tsystem.h"
+#include "avx2P.h"
 
 // calls to _mm_* functions disabled in code for now (marked as comment)
 // so disable include <emmintrin.h>
@@ -1878,12 +1880,100 @@ void TRop::overlay(const TRasterP &rup, const TRasterP &rdown,
 */
 //-----------------------------------------------------------------------------
 
+#ifdef USE_AVX2
+
+namespace {
+
+//! Same results as premult(TPixel32 &), 8 pixels at a time
+AVX2_TARGET void do_premultiply_AVX2(const TRaster32P &ras) {
+  const __m256i channelMask = _mm256_set1_epi32(0xff);
+  const __m256i matteMask   = _mm256_set1_epi32(0xff000000);
+  const __m256i magicFac    = _mm256_set1_epi32(257U * 256U + 1U);
+  const __m256i half        = _mm256_set1_epi32(1U << 23);
+
+  int lx = ras->getLx();
+  for (int y = 0; y < ras->getLy(); ++y) {
+    TPixel32 *pix = ras->pixels(y), *endPix = pix + lx;
+
+    for (; endPix - pix >= 8; pix += 8) {
+      __m256i p   = _mm256_loadu_si256((const __m256i *)pix);
+      __m256i fac = _mm256_mullo_epi32(_mm256_srli_epi32(p, 24), magicFac);
+
+      __m256i result = _mm256_and_si256(p, matteMask);
+      for (int shift = 0; shift < 24; shift += 8) {
+        __m256i c = _mm256_and_si256(_mm256_srli_epi32(p, shift), channelMask);
+        c = _mm256_add_epi32(_mm256_mullo_epi32(c, fac), half);
+        c = _mm256_srli_epi32(c, 24);
+        result = _mm256_or_si256(result, _mm256_slli_epi32(c, shift));
+      }
+
+      _mm256_storeu_si256((__m256i *)pix, result);
+    }
+
+    for (; pix < endPix; ++pix) premult(*pix);
+  }
+}
+
+//-----------------------------------------------------------------------------
+
+//! Same results as depremult(TPixel32 &) on non-transparent pixels, 8 pixels
+//! at a time
+AVX2_TARGET void do_depremultiply_AVX2(const TRaster32P &ras) {
+  const __m256i zeros       = _mm256_setzero_si256();
+  const __m256i channelMask = _mm256_set1_epi32(0xff);
+  const __m256i matteMask   = _mm256_set1_epi32(0xff000000);
+  const __m256 maxValue     = _mm256_set1_ps(255.f);
+
+  int lx = ras->getLx();
+  for (int y = 0; y < ras->getLy(); ++y) {
+    TPixel32 *pix = ras->pixels(y), *endPix = pix + lx;
+
+    for (; endPix - pix >= 8; pix += 8) {
+      __m256i p = _mm256_loadu_si256((const __m256i *)pix);
+      __m256i m = _mm256_srli_epi32(p, 24);
+
+      __m256 fac = _mm256_div_ps(maxValue, _mm256_cvtepi32_ps(m));
+
+      __m256i result = _mm256_and_si256(p, matteMask);
+      for (int shift = 0; shift < 24; shift += 8) {
+        __m256i c = _mm256_and_si256(_mm256_srli_epi32(p, shift), channelMask);
+        __m256 cf = _mm256_min_ps(_mm256_mul_ps(_mm256_cvtepi32_ps(c), fac),
+                                  maxValue);
+        result    = _mm256_or_si256(
+            result, _mm256_slli_epi32(_mm256_cvttps_epi32(cf), shift));
+      }
+
+      // Transparent pixels are left untouched
+      result = _mm256_blendv_epi8(result, p, _mm256_cmpeq_epi32(m, zeros));
+
+      _mm256_storeu_si256((__m256i *)pix, result);
+    }
+
+    for (; pix < endPix; ++pix)
+      if (pix->m != 0) depremult(*pix);
+  }
+}
+
+}  // namespace
+
+#endif
+
+//-----------------------------------------------------------------------------
+
 void TRop::premultiply(const TRasterP &ras) {
   ras->lock();
   TRaster32P ras32 = ras;
   TRaster64P ras64 = ras;
   TRasterFP rasF   = ras;
   if (ras32) {
+#ifdef USE_AVX2
+    if (TSystem::getCPUExtensions() & TSystem::CpuSupportsAvx2) {
+      do_premultiply_AVX2(ras32);
+      ras->unlock();
+      return;
+    }
+#endif
+
     TPixel32 *endPix, *upPix = 0, *upRow = ras32->pixels();
     TPixel32 *lastPix =
         upRow + ras32->getWrap() * (ras32->getLy() - 1) + ras32->getLx();
@@ -1941,6 +2031,14 @@ void TRop::depremultiply(const TRasterP &ras) {
   TRaster64P ras64 = ras;
   TRasterFP rasF   = ras;
   if (ras32) {
+#ifdef USE_AVX2
+    if (TSystem::getCPUExtensions() & TSystem::CpuSupportsAvx2) {
+      do_depremultiply_AVX2(ras32);
+      ras->unlock();
+      return;
+    }
+#endif
+
     TPixel32 *endPix, *upPix = 0, *upRow = ras32->pixels();
     TPixel32 *lastPix =
         upRow + ras32->getWrap() * (ras32->getLy() - 1) + ras32->getLx();
@@ -27,6 +27,8 @@ using namespace TConsts;
 #endif
 
 #include <memory>
+#include <vector>
+#include <functional>
 
 //===========================================================================
 /*
@@ -1109,12 +1111,13 @@ void resample_main_rgbm(TRasterPT<T> rout, const TRasterPT<T> &rin,
                         int min_pix_ref_u, int min_pix_ref_v, int max_pix_ref_u,
                         int max_pix_ref_v, int n_pix, int *pix_ref_u,
                         int *pix_ref_v, int *pix_ref_f, int *pix_ref_g,
-                        short *filter) {
+                        short *filter, const UCHAR *calc, int calc_bytewrap,
+                        int out_y0, int out_y1) {
   const T *buffer_in;
   T *buffer_out;
   T *pix_out;
   int lu, lv, wrap_in, mu, mv;
-  int lx, ly, wrap_out;
+  int lx, wrap_out;
   int out_x, out_y;
   double out_x_, out_y_;
   double out_u_, out_v_;
@@ -1129,9 +1132,6 @@ void resample_main_rgbm(TRasterPT<T> rout, const TRasterPT<T> &rin,
   int inside_nonempty;
   int outside_min_u, outside_min_v;
   int outside_max_u, outside_max_v;
-  UCHAR *calc;
-  int calc_allocsize;
-  int calc_bytewrap;
   UCHAR calc_value;
   bool must_calc;
   T pix_value, default_value(0, 0, 0, 0);
@@ -1153,20 +1153,11 @@ void resample_main_rgbm(TRasterPT<T> rout, const TRasterPT<T> &rin,
     return;
   }
 
-  calc           = 0;
-  calc_allocsize = 0;
-
-  // Create a bit array, each indicating whether a pixel has to be calculated or
-  // not
-  create_calc(rin, min_pix_ref_u, max_pix_ref_u, min_pix_ref_v, max_pix_ref_v,
-              calc, calc_allocsize, calc_bytewrap);
-
   buffer_in  = rin->pixels();
   buffer_out = rout->pixels();
   lu         = rin->getLx();
   lx         = rout->getLx();
   lv         = rin->getLy();
-  ly         = rout->getLy();
   wrap_in    = rin->getWrap();
   wrap_out   = rout->getWrap();
   mu         = lu - 1;
@@ -1183,7 +1174,8 @@ void resample_main_rgbm(TRasterPT<T> rout, const TRasterPT<T> &rin,
   outside_max_v   = mv - min_pix_ref_v;
 
   // For every pixel of the output image
-  for (out_y = 0, out_y_ = 0.5; out_y < ly; out_y++, out_y_ += 1.0) {
+  for (out_y = out_y0, out_y_ = out_y0 + 0.5; out_y < out_y1;
+       out_y++, out_y_ += 1.0) {
     for (out_x = 0, out_x_ = 0.5; out_x < lx; out_x++, out_x_ += 1.0) {
       pix_out = buffer_out + out_y * wrap_out + out_x;
 
@@ -1343,8 +1335,6 @@ void resample_main_rgbm(TRasterPT<T> rout, const TRasterPT<T> &rin,
         *pix_out = default_value;
     }
   }
-
-  delete[] calc;
 }
 
 //---------------------------------------------------------------------------
@@ -1354,14 +1344,15 @@ void resample_main_rgbm<TPixelF, double>(
     TRasterFP rout, const TRasterFP &rin, const TAffine &aff_xy2uv,
     const TAffine &aff0_uv2fg, int min_pix_ref_u, int min_pix_ref_v,
     int max_pix_ref_u, int max_pix_ref_v, int n_pix, int *pix_ref_u,
-    int *pix_ref_v, int *pix_ref_f, int *pix_ref_g, short *filter) {
+    int *pix_ref_v, int *pix_ref_f, int *pix_ref_g, short *filter,
+    const UCHAR *calc, int calc_bytewrap, int out_y0, int out_y1) {
   const double max_filter_val = 32767.0;
 
   const TPixelF *buffer_in;
   TPixelF *buffer_out;
   TPixelF *pix_out;
   int lu, lv, wrap_in, mu, mv;
-  int lx, ly, wrap_out;
+  int lx, wrap_out;
   int out_x, out_y;
   double out_x_, out_y_;
   double out_u_, out_v_;
@@ -1376,9 +1367,6 @@ void resample_main_rgbm<TPixelF, double>(
   int inside_nonempty;
   int outside_min_u, outside_min_v;
   int outside_max_u, outside_max_v;
-  UCHAR *calc;
-  int calc_allocsize;
-  int calc_bytewrap;
   UCHAR calc_value;
   bool must_calc;
   TPixelF pix_value, default_value(0.f, 0.f, 0.f, 0.f);
@@ -1400,20 +1388,11 @@ void resample_main_rgbm<TPixelF, double>(
     return;
   }
 
-  calc           = 0;
-  calc_allocsize = 0;
-
-  // Create a bit array, each indicating whether a pixel has to be calculated or
-  // not
-  create_calc(rin, min_pix_ref_u, max_pix_ref_u, min_pix_ref_v, max_pix_ref_v,
-              calc, calc_allocsize, calc_bytewrap);
-
   buffer_in  = rin->pixels();
   buffer_out = rout->pixels();
   lu         = rin->getLx();
   lx         = rout->getLx();
   lv         = rin->getLy();
-  ly         = rout->getLy();
   wrap_in    = rin->getWrap();
   wrap_out   = rout->getWrap();
   mu         = lu - 1;
@@ -1430,7 +1409,8 @@ void resample_main_rgbm<TPixelF, double>(
   outside_max_v   = mv - min_pix_ref_v;
 
   // For every pixel of the output image
-  for (out_y = 0, out_y_ = 0.5; out_y < ly; out_y++, out_y_ += 1.0) {
+  for (out_y = out_y0, out_y_ = out_y0 + 0.5; out_y < out_y1;
+       out_y++, out_y_ += 1.0) {
     for (out_x = 0, out_x_ = 0.5; out_x < lx; out_x++, out_x_ += 1.0) {
       pix_out = buffer_out + out_y * wrap_out + out_x;
 
@@ -1592,8 +1572,6 @@ void resample_main_rgbm<TPixelF, double>(
         *pix_out = default_value;
     }
   }
-
-  delete[] calc;
 }
 
 //---------------------------------------------------------------------------
@@ -1625,12 +1603,13 @@ void resample_main_rgbm_SSE2(TRasterPT<T> rout, const TRasterPT<T> &rin,
                              int min_pix_ref_v, int max_pix_ref_u,
                              int max_pix_ref_v, int n_pix, int *pix_ref_u,
                              int *pix_ref_v, int *pix_ref_f, int *pix_ref_g,
-                             short *filter) {
+                             short *filter, const UCHAR *calc,
+                             int calc_bytewrap, int out_y0, int out_y1) {
   __m128i zeros = _mm_setzero_si128();
   const T *buffer_in;
   T *buffer_out;
   int lu, lv, wrap_in, mu, mv;
-  int lx, ly, wrap_out;
+  int lx, wrap_out;
   int out_x, out_y;
   double out_x_, out_y_;
   double out_u_, out_v_;
@@ -1647,9 +1626,6 @@ void resample_main_rgbm_SSE2(TRasterPT<T> rout, const TRasterPT<T> &rin,
   // double outside_max_u_,  outside_max_v_;
   int outside_min_u, outside_min_v;
   int outside_max_u, outside_max_v;
-  UCHAR *calc;
-  int calc_allocsize;
-  int calc_bytewrap;
   UCHAR calc_value;
   bool must_calc;
   T pix_value;
@@ -1681,17 +1657,11 @@ void resample_main_rgbm_SSE2(TRasterPT<T> rout, const TRasterPT<T> &rin,
     resample_clear_rgbm(rout, default_value);
     return;
   }
-  calc           = 0;
-  calc_allocsize = 0;
-  create_calc(rin, min_pix_ref_u, max_pix_ref_u, min_pix_ref_v, max_pix_ref_v,
-              calc, calc_allocsize, calc_bytewrap);
-
   buffer_in  = rin->pixels();
   buffer_out = rout->pixels();
   lu         = rin->getLx();
   lx         = rout->getLx();
   lv         = rin->getLy();
-  ly         = rout->getLy();
   wrap_in    = rin->getWrap();
   wrap_out   = rout->getWrap();
   mu         = lu - 1;
@@ -1707,7 +1677,8 @@ void resample_main_rgbm_SSE2(TRasterPT<T> rout, const TRasterPT<T> &rin,
   outside_max_u   = mu - min_pix_ref_u;
   outside_max_v   = mv - min_pix_ref_v;
 
-  for (out_y = 0, out_y_ = 0.5; out_y < ly; out_y++, out_y_ += 1.0) {
+  for (out_y = out_y0, out_y_ = out_y0 + 0.5; out_y < out_y1;
+       out_y++, out_y_ += 1.0) {
     for (out_x = 0, out_x_ = 0.5; out_x < lx; out_x++, out_x_ += 1.0) {
       pix_out = buffer_out + out_y * wrap_out + out_x;
 
@@ -1838,7 +1809,6 @@ void resample_main_rgbm_SSE2(TRasterPT<T> rout, const TRasterPT<T> &rin,
         }
     }
   }
-  if (calc) delete[] calc;
 }
 
 namespace {
@@ -2512,6 +2482,206 @@ TCALLOC (colval,    lu);*/
 
 //---------------------------------------------------------------------------
 
+template <class T>
+inline void setResampledPixel(T &pix, double r, double g, double b, double m) {
+  auto toChannel = [](double val) {
+    int channel = troundp(std::max(val, 0.0));
+    return (typename T::Channel)std::min(channel, (int)T::maxChannelValue);
+  };
+
+  pix.r = toChannel(r);
+  pix.g = toChannel(g);
+  pix.b = toChannel(b);
+  pix.m = toChannel(m);
+}
+
+template <>
+inline void setResampledPixel(TPixelF &pix, double r, double g, double b,
+                              double m) {
+  pix.r = r;
+  pix.g = g;
+  pix.b = b;
+  pix.m = std::min(std::max(m, 0.0), 1.0);
+}
+
+//---------------------------------------------------------------------------
+
+/*!
+  Version of resample_main_rgbm() for affines without rotation or shear
+  components. In this case the fg image of each filter position depends on
+  u or v only, so the filter weights separate into horizontal and vertical
+  ones - and the convolution is performed in two 1D passes, costing
+  (n_u + n_v) rather than (n_u * n_v) operations per output pixel.
+
+  The weights of each output column and row are precomputed. The horizontal
+  pass result for the source rows needed by the [out_y0, out_y1) output rows
+  is stored in floating point, so results may differ from
+  resample_main_rgbm() by a rounding unit.
+*/
+template <class T>
+void resample_main_rgbm_separable(TRasterPT<T> rout, const TRasterPT<T> &rin,
+                                  const TAffine &aff_xy2uv,
+                                  const TAffine &aff0_uv2fg, int min_pix_ref_u,
+                                  int min_pix_ref_v, int max_pix_ref_u,
+                                  int max_pix_ref_v, int n_pix, int *pix_ref_u,
+                                  int *pix_ref_v, int *pix_ref_f,
+                                  int *pix_ref_g, short *filter, int out_y0,
+                                  int out_y1) {
+  // Weights of a source column (or row) for an output column (or row). Out of
+  // image positions, marked by pix == -1, weigh as 0-padding.
+  struct Tap {
+    int pix;
+    float weight;
+  };
+
+  // Filter taps of an output column (or row)
+  struct Taps {
+    int first;  //!< First tap in the taps array, or -1 if out of image
+    float sum_weights;
+  };
+
+  assert(aff_xy2uv.a12 == 0.0 && aff_xy2uv.a21 == 0.0);
+
+  const T *buffer_in = rin->pixels();
+  T *buffer_out      = rout->pixels();
+  int lu = rin->getLx(), lv = rin->getLy(), wrap_in = rin->getWrap();
+  int lx = rout->getLx(), wrap_out = rout->getWrap();
+  T default_value(0, 0, 0, 0);
+  int i, k;
+
+  // The pix_ref_* arrays enumerate the product of the u and v filter
+  // positions - extract the 1D ones
+  std::vector<int> ref_f(max_pix_ref_u - min_pix_ref_u + 1, c_maxint);
+  std::vector<int> ref_g(max_pix_ref_v - min_pix_ref_v + 1, c_maxint);
+  for (i = 0; i < n_pix; ++i) {
+    ref_f[pix_ref_u[i] - min_pix_ref_u] = pix_ref_f[i];
+    ref_g[pix_ref_v[i] - min_pix_ref_v] = pix_ref_g[i];
+  }
+
+  std::vector<Tap> taps_u, taps_v;
+  std::vector<Taps> cols(lx), rows(out_y1 - out_y0);
+
+  // Builds the taps of an output column (or row) whose pre-image is out_,
+  // given the affine coefficient and the 1D filter positions of its axis
+  auto buildTaps = [filter](double out_, double uv2fg, int min_pix_ref,
+                            int max_pix_ref, int l,
+                            const std::vector<int> &ref_fg,
+                            std::vector<Tap> &taps) {
+    Taps result = {-1, 0.f};
+
+    int ref = intLE(out_);
+    if (ref < -max_pix_ref || ref > l - 1 - min_pix_ref) return result;
+
+    int ref_out_fg = tround(uv2fg * (ref - out_));
+
+    result.first = (int)taps.size();
+    for (int d = min_pix_ref; d <= max_pix_ref; ++d) {
+      if (ref_fg[d - min_pix_ref] == c_maxint) continue;
+
+      Tap tap = {ref + d, (float)filter[ref_fg[d - min_pix_ref] + ref_out_fg]};
+      if (tap.pix < 0 || tap.pix >= l) tap.pix = -1;
+
+      result.sum_weights += tap.weight;
+      taps.push_back(tap);
+    }
+
+    return result;
+  };
+
+  int n_u = 0, n_v = 0;
+  for (k = 0; k < (int)ref_f.size(); ++k) n_u += (ref_f[k] != c_maxint);
+  for (k = 0; k < (int)ref_g.size(); ++k) n_v += (ref_g[k] != c_maxint);
+
+  double out_x_, out_y_;
+  int out_x, out_y;
+
+  for (out_x = 0, out_x_ = 0.5; out_x < lx; out_x++, out_x_ += 1.0)
+    cols[out_x] =
+        buildTaps(affMV1(aff_xy2uv, out_x_, 0.5), aff0_uv2fg.a11,
+                  min_pix_ref_u, max_pix_ref_u, lu, ref_f, taps_u);
+
+  int min_v = lv, max_v = -1;
+  for (out_y = out_y0, out_y_ = out_y0 + 0.5; out_y < out_y1;
+       out_y++, out_y_ += 1.0) {
+    Taps &row = rows[out_y - out_y0];
+    row = buildTaps(affMV2(aff_xy2uv, 0.5, out_y_), aff0_uv2fg.a22,
+                    min_pix_ref_v, max_pix_ref_v, lv, ref_g, taps_v);
+
+    if (row.first >= 0)
+      for (k = 0; k < n_v; ++k) {
+        int v = taps_v[row.first + k].pix;
+        if (v < 0) continue;
+
+        min_v = std::min(min_v, v);
+        max_v = std::max(max_v, v);
+      }
+  }
+
+  // Horizontal pass, on the source rows in [min_v, max_v]
+  std::vector<TPixelF> hpass;
+  if (min_v <= max_v) hpass.resize((max_v - min_v + 1) * lx);
+
+  for (int v = min_v; v <= max_v; ++v) {
+    const T *row_in    = buffer_in + v * wrap_in;
+    TPixelF *hpass_out = &hpass[(v - min_v) * lx];
+
+    for (out_x = 0; out_x < lx; ++out_x, ++hpass_out) {
+      if (cols[out_x].first < 0) continue;
+
+      const Tap *tap = &taps_u[cols[out_x].first];
+      float r = 0.f, g = 0.f, b = 0.f, m = 0.f;
+      for (k = 0; k < n_u; ++k, ++tap) {
+        if (tap->pix < 0) continue;
+
+        const T &pix = row_in[tap->pix];
+        r += pix.r * tap->weight;
+        g += pix.g * tap->weight;
+        b += pix.b * tap->weight;
+        m += pix.m * tap->weight;
+      }
+
+      hpass_out->r = r;
+      hpass_out->g = g;
+      hpass_out->b = b;
+      hpass_out->m = m;
+    }
+  }
+
+  // Vertical pass
+  for (out_y = out_y0; out_y < out_y1; ++out_y) {
+    const Taps &row = rows[out_y - out_y0];
+    T *pix_out      = buffer_out + out_y * wrap_out;
+
+    for (out_x = 0; out_x < lx; ++out_x, ++pix_out) {
+      const Taps &col = cols[out_x];
+      if (row.first < 0 || col.first < 0 ||
+          row.sum_weights * col.sum_weights == 0.f) {
+        *pix_out = default_value;
+        continue;
+      }
+
+      const Tap *tap = &taps_v[row.first];
+      double r = 0.0, g = 0.0, b = 0.0, m = 0.0;
+      for (k = 0; k < n_v; ++k, ++tap) {
+        if (tap->pix < 0) continue;
+
+        const TPixelF &pix = hpass[(tap->pix - min_v) * lx + out_x];
+        r += (double)pix.r * tap->weight;
+        g += (double)pix.g * tap->weight;
+        b += (double)pix.b * tap->weight;
+        m += (double)pix.m * tap->weight;
+      }
+
+      double inv_sum_weights =
+          1.0 / ((double)row.sum_weights * col.sum_weights);
+      setResampledPixel(*pix_out, r * inv_sum_weights, g * inv_sum_weights,
+                        b * inv_sum_weights, m * inv_sum_weights);
+    }
+  }
+}
+
+//---------------------------------------------------------------------------
+
 // #define USE_STATIC_VARS
 
 //---------------------------------------------------------------------------
@@ -2821,30 +2991,70 @@ void rop_resample_rgbm(TRasterPT<T> rout, const TRasterPT<T> &rin,
     }
   }
 
+  // Scale-only affines let the filter be applied in two 1D passes
+  bool separable = (aff_uv2xy.a12 == 0.0 && aff_uv2xy.a21 == 0.0);
+
+  UCHAR *calc        = 0;
+  int calc_allocsize = 0;
+  int calc_bytewrap  = 0;
+
+  if (!separable)
+    // Create a bit array, each indicating whether a pixel has to be calculated
+    // or not
+    create_calc(rin, min_pix_ref_u, max_pix_ref_u, min_pix_ref_v,
+                max_pix_ref_v, calc, calc_allocsize, calc_bytewrap);
+
+  std::unique_ptr<UCHAR[]> calcHolder(calc);
+
+  // Output rows are independent - compute them in horizontal bands, which
+  // may run concurrently
+  int ly         = rout->getLy();
+  int bandsCount = std::max(std::min(TSystem::getProcessorCount(), ly / 32), 1);
+
+  std::vector<std::function<void()>> bands;
+  for (int b = 0; b < bandsCount; ++b) {
+    int out_y0 = ly * b / bandsCount, out_y1 = ly * (b + 1) / bandsCount;
+
+    bands.push_back([&, out_y0, out_y1]() {
+      if (separable)
+        resample_main_rgbm_separable<T>(
+            rout, rin, aff_xy2uv, aff0_uv2fg, min_pix_ref_u, min_pix_ref_v,
+            max_pix_ref_u, max_pix_ref_v, n_pix, pix_ref_u.get(),
+            pix_ref_v.get(), pix_ref_f.get(), pix_ref_g.get(), filter, out_y0,
+            out_y1);
+      else
 #ifdef USE_SSE2
-  if ((TSystem::getCPUExtensions() & TSystem::CpuSupportsSse2) &&
-      T::maxChannelValue == 255)
-    resample_main_rgbm_SSE2<T>(rout, rin, aff_xy2uv, aff0_uv2fg, min_pix_ref_u,
-                               min_pix_ref_v, max_pix_ref_u, max_pix_ref_v,
-                               n_pix, pix_ref_u.get(), pix_ref_v.get(),
-                               pix_ref_f.get(), pix_ref_g.get(), filter);
-  else
+          if ((TSystem::getCPUExtensions() & TSystem::CpuSupportsSse2) &&
+              T::maxChannelValue == 255)
+        resample_main_rgbm_SSE2<T>(
+            rout, rin, aff_xy2uv, aff0_uv2fg, min_pix_ref_u, min_pix_ref_v,
+            max_pix_ref_u, max_pix_ref_v, n_pix, pix_ref_u.get(),
+            pix_ref_v.get(), pix_ref_f.get(), pix_ref_g.get(), filter, calc,
+            calc_bytewrap, out_y0, out_y1);
+      else
 #endif
-      if (std::is_same<T, TPixelF>::value)
-    resample_main_rgbm<T, double>(
-        rout, rin, aff_xy2uv, aff0_uv2fg, min_pix_ref_u, min_pix_ref_v,
-        max_pix_ref_u, max_pix_ref_v, n_pix, pix_ref_u.get(), pix_ref_v.get(),
-        pix_ref_f.get(), pix_ref_g.get(), filter);
-  else if (n_pix >= 512 || T::maxChannelValue > 255)
-    resample_main_rgbm<T, TINT64>(
-        rout, rin, aff_xy2uv, aff0_uv2fg, min_pix_ref_u, min_pix_ref_v,
-        max_pix_ref_u, max_pix_ref_v, n_pix, pix_ref_u.get(), pix_ref_v.get(),
-        pix_ref_f.get(), pix_ref_g.get(), filter);
-  else
-    resample_main_rgbm<T, TINT32>(
-        rout, rin, aff_xy2uv, aff0_uv2fg, min_pix_ref_u, min_pix_ref_v,
-        max_pix_ref_u, max_pix_ref_v, n_pix, pix_ref_u.get(), pix_ref_v.get(),
-        pix_ref_f.get(), pix_ref_g.get(), filter);
+          if (std::is_same<T, TPixelF>::value)
+        resample_main_rgbm<T, double>(
+            rout, rin, aff_xy2uv, aff0_uv2fg, min_pix_ref_u, min_pix_ref_v,
+            max_pix_ref_u, max_pix_ref_v, n_pix, pix_ref_u.get(),
+            pix_ref_v.get(), pix_ref_f.get(), pix_ref_g.get(), filter, calc,
+            calc_bytewrap, out_y0, out_y1);
+      else if (n_pix >= 512 || T::maxChannelValue > 255)
+        resample_main_rgbm<T, TINT64>(
+            rout, rin, aff_xy2uv, aff0_uv2fg, min_pix_ref_u, min_pix_ref_v,
+            max_pix_ref_u, max_pix_ref_v, n_pix, pix_ref_u.get(),
+            pix_ref_v.get(), pix_ref_f.get(), pix_ref_g.get(), filter, calc,
+            calc_bytewrap, out_y0, out_y1);
+      else
+        resample_main_rgbm<T, TINT32>(
+            rout, rin, aff_xy2uv, aff0_uv2fg, min_pix_ref_u, min_pix_ref_v,
+            max_pix_ref_u, max_pix_ref_v, n_pix, pix_ref_u.get(),
+            pix_ref_v.get(), pix_ref_f.get(), pix_ref_g.get(), filter, calc,
+            calc_bytewrap, out_y0, out_y1);
+    });
+  }
+
+  TRop::runSubtasks(bands);
 }
 
 //---------------------------------------------------------------------------
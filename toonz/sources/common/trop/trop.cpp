@@ -11,10 +11,14 @@
 #endif
 #include "tpixelutils.h"
 
+#include <atomic>
+
 TString TRopException::getMessage() const { return ::to_wstring(message); }
 
 namespace {
 
+std::atomic<TRop::SubtasksRunner> subtasksRunner(nullptr);
+
 bool isOpaque32(TRaster32P &ras) {
   ras->lock();
   UCHAR *m0 = &(ras->pixels()->m);
@@ -39,6 +43,20 @@ bool isOpaque32(TRaster32P &ras) {
 
 }  // namespace
 
+void TRop::runSubtasks(const std::vector<std::function<void()>> &funcs) {
+  SubtasksRunner runner = subtasksRunner;
+  if (runner)
+    runner(funcs);
+  else
+    for (const std::function<void()> &func : funcs) func();
+}
+
+void TRop::setSubtasksRunner(SubtasksRunner runner) {
+  subtasksRunner = runner;
+}
+
+TRop::SubtasksRunner TRop::getSubtasksRunner() { return subtasksRunner; }
+
 bool TRop::isOpaque(TRasterP ras) {
   TRaster32P ras32 = ras;
   if (ras32)
@@ -23,190 +23,159 @@ extern "C" {
 #include "toonz4.6/raster.h"
 }
 
-#if defined(_WIN32) && defined(x64)
-#define USE_SSE2
-#endif
+#include "avx2P.h"
+
+//-----------------------------------------------------------------------------
+
+bool renderRas32(const TTile &tileOut, const TTile &tileIn,
+                 const TPaletteP palette);
 
-#ifdef USE_SSE2
-#include <emmintrin.h>
+//-----------------------------------------------------------------------------
 
-//---------------------------------------------------------
+const TPixel32 c_transparencyCheckPaint = TPixel32(80, 80, 80, 255);
+const TPixel32 c_transparencyCheckInk   = TPixel32::Black;
 
 namespace {
 
-DV_ALIGNED(16) class TPixelFloat {
-public:
-  TPixelFloat() : b(0), g(0), r(0), m(0) {}
+//! Converts a row of colormapped pixels, given the (premultiplied) colors of
+//! all the possible ink and paint indices.
+void convertRow(const TPixelCM32 *pixIn, TPixel32 *pix32, int lx,
+                const TPixel32 *inks, const TPixel32 *paints) {
+  const TPixelCM32 *endPixIn = pixIn + lx;
+
+  while (pixIn < endPixIn) {
+    int t = pixIn->getTone();
+    int p = pixIn->getPaint();
+    int i = pixIn->getInk();
+
+    if (t == TPixelCM32::getMaxTone())
+      *pix32++ = paints[p];
+    else if (t == 0)
+      *pix32++ = inks[i];
+    else
+      *pix32++ = blend(inks[i], paints[p], t, TPixelCM32::getMaxTone());
 
-  TPixelFloat(float rr, float gg, float bb, float mm)
-      : b(bb), g(gg), r(rr), m(mm) {}
+    ++pixIn;
+  }
+}
 
-  TPixelFloat(const TPixel32 &pix) : b(pix.b), g(pix.g), r(pix.r), m(pix.m) {}
+//-----------------------------------------------------------------------------
 
-  float b, g, r, m;
-};
+#ifdef USE_AVX2
 
-}  // anonymous namespace
+//! AVX2 version of convertRow(), converting 8 pixels at a time: ink and paint
+//! colors are gathered from the tables, and blended by tone in 16 bits. The
+//! blend reproduces blend() exactly - pure ink and paint pixels included, so
+//! they need no separate case.
+AVX2_TARGET void convertRow_AVX2(const TPixelCM32 *pixIn, TPixel32 *pix32,
+                                 int lx, const TPixel32 *inks,
+                                 const TPixel32 *paints) {
+  assert(TPixelCM32::getMaxTone() == 255);
 
-#endif
+  const __m256i zeros     = _mm256_setzero_si256();
+  const __m256i paintMask = _mm256_set1_epi32(0xfff);
+  const __m256i maxTone   = _mm256_set1_epi16(255);
 
-//-----------------------------------------------------------------------------
+  // x / 255 == (x * 0x8081) >> 23 for all 16-bit x
+  const __m256i div255 = _mm256_set1_epi16((short)0x8081);
 
-bool renderRas32(const TTile &tileOut, const TTile &tileIn,
-                 const TPaletteP palette);
+  // Replicates the tone (lowest byte) of each pixel on its 4 channels
+  const __m256i toneShuffle = _mm256_setr_epi8(
+      0, 0, 0, 0, 4, 4, 4, 4, 8, 8, 8, 8, 12, 12, 12, 12, 0, 0, 0, 0, 4, 4, 4,
+      4, 8, 8, 8, 8, 12, 12, 12, 12);
 
-//-----------------------------------------------------------------------------
+  int x = 0;
+  for (; x + 8 <= lx; x += 8) {
+    __m256i cm = _mm256_loadu_si256((const __m256i *)(pixIn + x));
 
-const TPixel32 c_transparencyCheckPaint = TPixel32(80, 80, 80, 255);
-const TPixel32 c_transparencyCheckInk   = TPixel32::Black;
+    __m256i inkIds   = _mm256_srli_epi32(cm, 20);
+    __m256i paintIds = _mm256_and_si256(_mm256_srli_epi32(cm, 8), paintMask);
+
+    __m256i ink   = _mm256_i32gather_epi32((const int *)inks, inkIds, 4);
+    __m256i paint = _mm256_i32gather_epi32((const int *)paints, paintIds, 4);
+    __m256i tone  = _mm256_shuffle_epi8(cm, toneShuffle);
+
+    // out = ((255 - t) * ink + t * paint) / 255, on each channel
+    __m256i toneLo = _mm256_unpacklo_epi8(tone, zeros);
+    __m256i toneHi = _mm256_unpackhi_epi8(tone, zeros);
+
+    __m256i outLo = _mm256_add_epi16(
+        _mm256_mullo_epi16(_mm256_unpacklo_epi8(ink, zeros),
+                           _mm256_sub_epi16(maxTone, toneLo)),
+        _mm256_mullo_epi16(_mm256_unpacklo_epi8(paint, zeros), toneLo));
+    __m256i outHi = _mm256_add_epi16(
+        _mm256_mullo_epi16(_mm256_unpackhi_epi8(ink, zeros),
+                           _mm256_sub_epi16(maxTone, toneHi)),
+        _mm256_mullo_epi16(_mm256_unpackhi_epi8(paint, zeros), toneHi));
+
+    outLo = _mm256_srli_epi16(_mm256_mulhi_epu16(outLo, div255), 7);
+    outHi = _mm256_srli_epi16(_mm256_mulhi_epu16(outHi, div255), 7);
+
+    _mm256_storeu_si256((__m256i *)(pix32 + x),
+                        _mm256_packus_epi16(outLo, outHi));
+  }
+
+  convertRow(pixIn + x, pix32 + x, lx - x, inks, paints);
+}
+
+#endif
+
+}  // namespace
+
+//-----------------------------------------------------------------------------
 
 void TRop::convert(const TRaster32P &rasOut, const TRasterCM32P &rasIn,
                    const TPaletteP palette, bool transparencyCheck) {
   int count = palette->getStyleCount();
-  int count2 =
-      std::max({count, TPixelCM32::getMaxInk(), TPixelCM32::getMaxPaint()});
 
-  // per poter utilizzare lo switch (piu' efficiente) si utilizza 255
-  // anziche' TPixelCM32::getMaxTone()
-  assert(TPixelCM32::getMaxTone() == 255);
+  // The color tables cover all the indices a pixel may store, so that the
+  // conversion does not need to check them
+  int count2 = std::max({count, TPixelCM32::getMaxInk() + 1,
+                         TPixelCM32::getMaxPaint() + 1});
 
   int rasLx = rasOut->getLx();
   int rasLy = rasOut->getLy();
 
+  std::vector<TPixel32> paints(count2, TPixel32(255, 0, 0));
+  std::vector<TPixel32> inks(count2, TPixel32(255, 0, 0));
+  if (transparencyCheck) {
+    for (int i = 0; i < count; i++) {
+      paints[i] = c_transparencyCheckPaint;
+      inks[i]   = c_transparencyCheckInk;
+    }
+    paints[0] = TPixel32::Transparent;
+  } else
+    for (int i = 0; i < count; i++)
+      paints[i] = inks[i] =
+          ::premultiply(palette->getStyle(i)->getAverageColor());
+
+  void (*doConvertRow)(const TPixelCM32 *, TPixel32 *, int, const TPixel32 *,
+                       const TPixel32 *) = convertRow;
+#ifdef USE_AVX2
+  if (TSystem::getCPUExtensions() & TSystem::CpuSupportsAvx2)
+    doConvertRow = convertRow_AVX2;
+#endif
+
   rasOut->lock();
   rasIn->lock();
-#ifdef USE_SSE2
-  if (TSystem::getCPUExtensions() & TSystem::CpuSupportsSse2) {
-    __m128i zeros = _mm_setzero_si128();
-    TPixelFloat *paints =
-        (TPixelFloat *)_aligned_malloc(count2 * sizeof(TPixelFloat), 16);
-    TPixelFloat *inks =
-        (TPixelFloat *)_aligned_malloc(count2 * sizeof(TPixelFloat), 16);
-
-    std::vector<TPixel32> paints2(count2);
-    std::vector<TPixel32> inks2(count2);
-    if (transparencyCheck) {
-      for (int i = 0; i < palette->getStyleCount(); i++) {
-        paints2[i] = c_transparencyCheckPaint;
-        inks2[i]   = c_transparencyCheckInk;
-        paints[i]  = TPixelFloat(paints2[i]);
-        inks[i]    = TPixelFloat(inks2[i]);
-      }
-      paints2[0] = TPixel32::Transparent;
-      paints[0]  = TPixelFloat(TPixel32::Transparent);
-    }
-    /*
-else if (true)
-{
-            for(int i=0;i<palette->getStyleCount();i++)
-{
-paints2[i] = c_transparencyCheckPaint;
-                    inks2[i]   = c_transparencyCheckInk;
-paints[i]  = TPixelFloat(paints2[i]);
-                    inks[i]    = TPixelFloat(inks2[i]);
-            paints2[i] = TPixel32::Transparent;
-            paints[i] = TPixelFloat(TPixel32::Transparent);
-}
-            paints2[0] = TPixel32::Transparent;
-            paints[0] = TPixelFloat(TPixel32::Transparent);
-}
-*/
-    else
-      for (int i = 0; i < palette->getStyleCount(); i++) {
-        TPixel32 color = ::premultiply(palette->getStyle(i)->getAverageColor());
-        paints[i] = inks[i] = TPixelFloat(color);
-        paints2[i] = inks2[i] = color;
-      }
 
-    float maxTone     = (float)TPixelCM32::getMaxTone();
-    __m128 den_packed = _mm_load1_ps(&maxTone);
-
-    for (int y = 0; y < rasLy; ++y) {
-      TPixel32 *pix32   = rasOut->pixels(y);
-      TPixelCM32 *pixIn = rasIn->pixels(y);
-
-      TPixelCM32 *endPixIn = pixIn + rasLx;
-
-      while (pixIn < endPixIn) {
-        int tt = pixIn->getTone();
-        int p  = pixIn->getPaint();
-        int i  = pixIn->getInk();
-        switch (tt) {
-        case 255:
-          *pix32++ = paints2[p];
-          break;
-        case 0:
-          *pix32++ = inks2[i];
-          break;
-        default: {
-          float t         = (float)tt;
-          __m128 a_packed = _mm_load_ps((float *)&(inks[i]));
-          __m128 b_packed = _mm_load_ps((float *)&(paints[p]));
-
-          __m128 num_packed  = _mm_load1_ps(&t);
-          __m128 diff_packed = _mm_sub_ps(den_packed, num_packed);
-
-          // calcola in modo vettoriale out = ((den-num)*a + num*b)/den
-          __m128 outPix_packed = _mm_mul_ps(diff_packed, a_packed);
-          __m128 tmpPix_packed = _mm_mul_ps(num_packed, b_packed);
-
-          outPix_packed = _mm_add_ps(outPix_packed, tmpPix_packed);
-          outPix_packed = _mm_div_ps(outPix_packed, den_packed);
-
-          // converte i canali da float a char
-          __m128i outPix_packed_i = _mm_cvtps_epi32(outPix_packed);
-          outPix_packed_i         = _mm_packs_epi32(outPix_packed_i, zeros);
-          outPix_packed_i         = _mm_packus_epi16(outPix_packed_i, zeros);
-
-          *(DWORD *)(pix32) = _mm_cvtsi128_si32(outPix_packed_i);
-          ++pix32;
-        }
-        }
-        ++pixIn;
-      }
-    }
+  // Rows are converted in bands, possibly concurrently
+  int bandsCount =
+      std::max(std::min(TSystem::getProcessorCount(), rasLy / 32), 1);
 
-    _aligned_free(paints);
-    _aligned_free(inks);
+  std::vector<std::function<void()>> bands;
+  for (int b = 0; b < bandsCount; ++b) {
+    int y0 = rasLy * b / bandsCount, y1 = rasLy * (b + 1) / bandsCount;
 
-  } else  // SSE2 not supported
-#endif    // _WIN32
-  {
+    bands.push_back([&, y0, y1]() {
+      for (int y = y0; y < y1; ++y)
+        doConvertRow(rasIn->pixels(y), rasOut->pixels(y), rasLx, &inks[0],
+                     &paints[0]);
+    });
+  }
 
-    std::vector<TPixel32> paints(count2, TPixel32(255, 0, 0));
-    std::vector<TPixel32> inks(count2, TPixel32(255, 0, 0));
-    if (transparencyCheck) {
-      for (int i = 0; i < palette->getStyleCount(); i++) {
-        paints[i] = c_transparencyCheckPaint;
-        inks[i]   = c_transparencyCheckInk;
-      }
-      paints[0] = TPixel32::Transparent;
-    } else
-      for (int i = 0; i < palette->getStyleCount(); i++)
-        paints[i] = inks[i] =
-            ::premultiply(palette->getStyle(i)->getAverageColor());
-
-    for (int y = 0; y < rasLy; ++y) {
-      TPixel32 *pix32      = rasOut->pixels(y);
-      TPixelCM32 *pixIn    = rasIn->pixels(y);
-      TPixelCM32 *endPixIn = pixIn + rasLx;
-
-      while (pixIn < endPixIn) {
-        int t = pixIn->getTone();
-        int p = pixIn->getPaint();
-        int i = pixIn->getInk();
-
-        if (t == TPixelCM32::getMaxTone())
-          *pix32++ = paints[p];
-        else if (t == 0)
-          *pix32++ = inks[i];
-        else
-          *pix32++ = blend(inks[i], paints[p], t, TPixelCM32::getMaxTone());
+  TRop::runSubtasks(bands);
 
-        ++pixIn;
-      }
-    }
-  }
   rasOut->unlock();
   rasIn->unlock();
 }
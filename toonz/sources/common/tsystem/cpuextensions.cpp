@@ -7,17 +7,102 @@
 #include <emmintrin.h>
 #endif
 
+#include <cstdlib>
+
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#include <intrin.h>
+#define USE_CPUID
+#elif defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <cpuid.h>
+#define USE_CPUID
+#endif
+
 using namespace TSystem;
 
-#ifdef x64
-long TSystem::getCPUExtensions() {
-  return TSystem::CpuSupportsSse |
-         TSystem::CpuSupportsSse2;  // TSystem::CPUExtensionsNone
+namespace {
+
+//! Returns the environment mask limiting the reported extensions - mainly
+//! used to compare the kernels of different instruction sets.
+long CPUExtensionsMask() {
+  const char *mask = std::getenv("TOONZ_CPU_EXTENSIONS");
+  return (mask && *mask) ? std::strtol(mask, 0, 0) : ~0L;
+}
+
+}  // namespace
+
+#if defined(x64) || !defined(_MSC_VER)
+
+namespace {
+
+#ifdef USE_CPUID
+
+void cpuid(unsigned int leaf, unsigned int subleaf, unsigned int regs[4]) {
+#ifdef _MSC_VER
+  __cpuidex((int *)regs, leaf, subleaf);
+#else
+  __cpuid_count(leaf, subleaf, regs[0], regs[1], regs[2], regs[3]);
+#endif
+}
+
+//------------------------------------------------------------------------------
+
+//! Returns the XCR0 register, telling which register states the OS saves
+//! on context switches
+unsigned long long xgetbv0() {
+#ifdef _MSC_VER
+  return _xgetbv(0);
+#else
+  unsigned int eax, edx;
+  __asm__ __volatile__("xgetbv" : "=a"(eax), "=d"(edx) : "c"(0));
+  return ((unsigned long long)edx << 32) | eax;
+#endif
+}
+
+//------------------------------------------------------------------------------
+
+long CPUCheckForExtensions() {
+  unsigned int regs[4];  // eax, ebx, ecx, edx
+
+  cpuid(0, 0, regs);
+  unsigned int maxLeaf = regs[0];
+  if (maxLeaf < 1) return CPUExtensionsNone;
+
+  long extensions = CPUExtensionsNone;
+
+  cpuid(1, 0, regs);
+  if (regs[3] & (1U << 25)) extensions |= CpuSupportsSse;
+  if (regs[3] & (1U << 26)) extensions |= CpuSupportsSse2;
+
+  // AVX registers are usable only if the OS saves them (OSXSAVE and AVX bits)
+  const unsigned int osxsaveAvx = (1U << 27) | (1U << 28);
+  if ((regs[2] & osxsaveAvx) != osxsaveAvx || maxLeaf < 7) return extensions;
+
+  unsigned long long xcr0 = xgetbv0();
+  if ((xcr0 & 0x06) != 0x06) return extensions;  // XMM and YMM states
+
+  cpuid(7, 0, regs);
+  if (regs[1] & (1U << 5)) extensions |= CpuSupportsAvx2;
+  if ((regs[1] & (1U << 16)) && (xcr0 & 0xe6) == 0xe6)  // Opmask and ZMM
+    extensions |= CpuSupportsAvx512;
+
+  return extensions;
 }
 
 #else
-#ifndef _MSC_VER
-long TSystem::getCPUExtensions() { return TSystem::CPUExtensionsNone; }
+
+long CPUCheckForExtensions() { return CPUExtensionsNone; }
+
+#endif
+
+}  // namespace
+
+//------------------------------------------------------------------------------
+
+long TSystem::getCPUExtensions() {
+  static const long extensions = CPUCheckForExtensions() & CPUExtensionsMask();
+  return extensions;
+}
+
 #else
 namespace {
 
@@ -154,12 +239,11 @@ long TSystem::getCPUExtensions() {
   }
 
   if (CPUExtensionsEnabled)
-    return CPUExtensionsAvailable;
+    return CPUExtensionsAvailable & CPUExtensionsMask();
   else
     return TSystem::CPUExtensionsNone;
 }
 
-#endif
 #endif
 //------------------------------------------------------------------------------
 /*
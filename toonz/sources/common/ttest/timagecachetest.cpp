@@ -0,0 +1,149 @@
+#include "ttest.h"
+#include "timagecache.h"
+#include "trasterimage.h"
+#include "tstopwatch.h"
+
+#include <QThread>
+
+#include <algorithm>
+#include <iostream>
+#include <thread>
+
+using namespace std;
+
+namespace {
+
+TRasterImageP makeImage(int lx, int ly, int seed) {
+  TRaster32P ras(lx, ly);
+  for (int y = 0; y < ly; ++y) {
+    TPixel32 *pix = ras->pixels(y), *endPix = pix + lx;
+    for (int x = 0; pix != endPix; ++pix, ++x)
+      *pix = TPixel32((x + seed) & 0xff, (y + seed) & 0xff, seed & 0xff);
+  }
+  return TRasterImageP(ras);
+}
+
+//! Lets the cache maintainer compress \b count images of \b imageBytes each,
+//! and returns the elapsed time in ms - or -1 on timeout.
+int waitCompression(int count, TUINT64 imageBytes) {
+  TImageCache *cache = TImageCache::instance();
+
+  TImageCache::Statistics stats = cache->getStatistics();
+  TUINT64 start  = stats.m_compressedBytes + stats.m_spilledBytes;
+  TUINT64 target = start + count * imageBytes;
+
+  TStopWatch sw;
+  sw.start();
+  cache->setWatermarks(1, 1);
+  for (;;) {
+    stats = cache->getStatistics();
+    if (stats.m_compressedBytes + stats.m_spilledBytes >= target) break;
+    if (sw.getTotalTime() > 60000) return -1;
+    QThread::msleep(1);
+  }
+  sw.stop();
+  return (int)sw.getTotalTime();
+}
+
+}  // namespace
+
+//==============================================================================
+
+//! Measures the compression of the least recently used images when most of
+//! the cache is checked out. Finding each compressible image must not
+//! depend on the number of checked out ones.
+class ImageCacheEvictionBench final : public TTest {
+public:
+  ImageCacheEvictionBench() : TTest("bench_imagecache_eviction") {}
+
+  void test() override {
+    const int lx = 64, ly = 64, freeCount = 2000;
+    const TUINT64 imageBytes = lx * ly * sizeof(TPixel32);
+
+    TImageCache *cache = TImageCache::instance();
+    UINT low, high;
+    cache->getWatermarks(low, high);
+
+    const int heldCounts[] = {0, 2000, 8000};
+    for (int h = 0; h != 3; ++h) {
+      int heldCount = heldCounts[h];
+      cache->setWatermarks(0, 0);
+
+      // The checked out images are the least recently used ones
+      vector<TImageP> held;
+      vector<string> ids;
+      int i;
+      for (i = 0; i != heldCount + freeCount; ++i) {
+        TImageP img = makeImage(lx, ly, i);
+        ids.push_back(cache->getUniqueId());
+        cache->add(ids.back(), img);
+        if (i < heldCount) held.push_back(img);
+      }
+
+      int ms = waitCompression(freeCount, imageBytes);
+      if (ms < 0)
+        cout << "  FAILED: " << freeCount << " images not compressed behind "
+             << heldCount << " checked out within 60 s" << endl;
+      else
+        cout << "  " << freeCount << " images compressed behind " << heldCount
+             << " checked out: " << ms << " ms" << endl;
+
+      cache->setWatermarks(0, 0);
+      held.clear();
+      for (i = 0; i != (int)ids.size(); ++i) cache->remove(ids[i]);
+    }
+
+    cache->setWatermarks(low, high);
+  }
+} imageCacheEvictionBench;
+
+//==============================================================================
+
+//! Measures add/get/remove operations on the cache from one and from many
+//! threads, each working on its own images. The throughput should grow with
+//! the threads count, rather than collapse on the cache's lock.
+class ImageCacheConcurrencyBench final : public TTest {
+public:
+  ImageCacheConcurrencyBench() : TTest("bench_imagecache_concurrency") {}
+
+  void test() override {
+    const int lx = 16, ly = 16, iterations = 20000;
+
+    TImageCache *cache = TImageCache::instance();
+    UINT low, high;
+    cache->getWatermarks(low, high);
+    cache->setWatermarks(0, 0);
+
+    int threadCounts[] = {1, std::max(2, QThread::idealThreadCount())};
+    double singleRate  = 0.0;
+    for (int t = 0; t != 2; ++t) {
+      int threadCount = threadCounts[t];
+
+      auto work = [&](int seed) {
+        TImageP img = makeImage(lx, ly, seed);
+        string id  = cache->getUniqueId();
+        for (int i = 0; i != iterations; ++i) {
+          cache->add(id, img);
+          cache->get(id, false);
+          cache->remove(id);
+        }
+      };
+
+      TStopWatch sw;
+      sw.start();
+      vector<std::thread> threads;
+      for (int i = 0; i != threadCount; ++i) threads.emplace_back(work, i);
+      for (std::thread &thread : threads) thread.join();
+      sw.stop();
+
+      double rate = 3.0 * iterations * threadCount /
+                    std::max<double>(sw.getTotalTime(), 1) * 1000.0;
+      if (t == 0) singleRate = rate;
+
+      cout << "  " << threadCount << " threads: " << TINT64(rate)
+           << " ops/s (x" << rate / singleRate << ")" << endl;
+    }
+
+    cache->setWatermarks(low, high);
+  }
+} imageCacheConcurrencyBench;
@@ -0,0 +1,68 @@
+#include "ttest.h"
+#include "timage_io.h"
+#include "trasterimage.h"
+#include "tsystem.h"
+
+#include <iostream>
+
+using namespace std;
+
+//==============================================================================
+
+//! Loads regions overlapping the image by a single row or column, as render
+//! tiles touching the image's edges do. They must load just that row or
+//! column, rather than nothing.
+class ImageReaderEdgeRegionTest final : public TTest {
+public:
+  ImageReaderEdgeRegionTest() : TTest("test_imagereader_edge_region") {}
+
+  void test() override {
+    const int lx = 16, ly = 8;
+
+    TRaster32P ras(lx, ly);
+    for (int y = 0; y < ly; ++y) {
+      TPixel32 *pix = ras->pixels(y);
+      for (int x = 0; x < lx; ++x) pix[x] = TPixel32(x * 16, y * 32, 0, 255);
+    }
+
+    TFilePath fp = TSystem::getTempDir() + "imagereader_edge_region.tif";
+    TImageWriter::save(fp, ras);
+
+    const TRect regions[] = {
+        TRect(lx - 1, 0, 2 * lx, ly - 1),       // right column
+        TRect(-lx, 0, 0, ly - 1),               // left column
+        TRect(0, ly - 1, lx - 1, 2 * ly),       // top row
+        TRect(0, -ly, lx - 1, 0),               // bottom row
+        TRect(lx - 1, ly - 1, 2 * lx, 2 * ly),  // corner pixel
+    };
+
+    for (const TRect &region : regions) {
+      TImageReaderP ir(fp);
+      ir->setRegion(region);
+
+      cout << "  region (" << region.x0 << ", " << region.y0 << ") - ("
+           << region.x1 << ", " << region.y1 << "): ";
+
+      TRasterImageP ri = ir->load();
+      if (!ri) {
+        cout << "FAILED: nothing loaded" << endl;
+        break;
+      }
+
+      TRect loaded = region * ras->getBounds();
+      if (ri->getRaster()->getSize() != loaded.getSize()) {
+        cout << "FAILED: loaded " << ri->getRaster()->getLx() << "x"
+             << ri->getRaster()->getLy() << ", expected " << loaded.getLx()
+             << "x" << loaded.getLy() << endl;
+        break;
+      }
+      if (!areEqual(ri->getRaster(), ras->extract(loaded))) {
+        cout << "FAILED: loaded pixels differ from the image" << endl;
+        break;
+      }
+      cout << "loaded " << loaded.getLx() << "x" << loaded.getLy() << endl;
+    }
+
+    TSystem::deleteFile(fp);
+  }
+} imageReaderEdgeRegionTest;
@@ -0,0 +1,333 @@
+#include "ttest.h"
+#include "trop.h"
+#include "tropcm.h"
+#include "tpalette.h"
+#include "tpixelutils.h"
+#include "tsystem.h"
+#include "tstopwatch.h"
+
+#include <algorithm>
+#include <functional>
+#include <future>
+#include <iostream>
+
+using namespace std;
+
+//==============================================================================
+//
+//  Throughput of the TRop kernels. Each kernel is checked against a plain
+//  per-pixel reference, and both are timed: the reference stands for the
+//  scalar code, while TRop runs the best path for this machine (set the
+//  TOONZ_CPU_EXTENSIONS environment variable to 0x30 to compare with SSE2).
+//
+//==============================================================================
+
+namespace {
+
+const int benchLx = 3840, benchLy = 2160, benchReps = 10;
+
+//! Fills a raster with premultiplied pixels from a fixed pseudo-random
+//! sequence, with plenty of fully opaque and fully transparent ones.
+void fillRandom(const TRaster32P &ras, unsigned int seed) {
+  for (int y = 0; y < ras->getLy(); ++y) {
+    TPixel32 *pix = ras->pixels(y), *endPix = pix + ras->getLx();
+    for (; pix != endPix; ++pix) {
+      seed = seed * 1664525U + 1013904223U;
+
+      int m = (seed >> 24) & 0xff;
+      if (m < 32)
+        m = 0;
+      else if (m > 224)
+        m = 255;
+
+      pix->r = ((seed >> 16) & 0xff) * m / 255;
+      pix->g = ((seed >> 8) & 0xff) * m / 255;
+      pix->b = ((seed >> 4) & 0xff) * m / 255;
+      pix->m = m;
+    }
+  }
+}
+
+//-----------------------------------------------------------------------
+
+//! Returns the throughput of \b func, processing \b pixels at each call, in
+//! megapixels per second.
+double mpixPerSec(const std::function<void()> &func,
+                  double pixels = double(benchLx) * benchLy) {
+  TStopWatch sw;
+  sw.start();
+  for (int i = 0; i != benchReps; ++i) func();
+  sw.stop();
+
+  double ms = std::max<TUINT32>(sw.getTotalTime(), 1);
+  return pixels * benchReps / ms * 1e-3;
+}
+
+//-----------------------------------------------------------------------
+
+void report(const char *kernel, double ropRate, double refRate) {
+  cout << "  " << kernel << ": " << ropRate << " Mpix/s (reference "
+       << refRate << " Mpix/s, x" << ropRate / refRate << ")" << endl;
+}
+
+//-----------------------------------------------------------------------
+
+//! Returns whether \b a and \b b are identical. Otherwise, reports the first
+//! differing pixel as a failure of \b kernel.
+template <class PIX>
+bool checkIdentical(const char *kernel, const TRasterPT<PIX> &a,
+                    const TRasterPT<PIX> &b) {
+  for (int y = 0; y < a->getLy(); ++y) {
+    const PIX *pix      = a->pixels(y), *endPix = pix + a->getLx();
+    const PIX *mismatch = std::mismatch(pix, endPix, b->pixels(y)).first;
+    if (mismatch != endPix) {
+      cout << "  FAILED: " << kernel << " differs from the reference at ("
+           << mismatch - pix << ", " << y << ")" << endl;
+      return false;
+    }
+  }
+  return true;
+}
+
+//-----------------------------------------------------------------------
+
+// The references below reproduce the scalar code of the TRop kernels
+
+void overRef(const TRaster32P &out, const TRaster32P &up) {
+  const UINT max = 255;
+  for (int y = 0; y < out->getLy(); ++y) {
+    TPixel32 *outPix = out->pixels(y), *endPix = outPix + out->getLx();
+    const TPixel32 *upPix = up->pixels(y);
+
+    for (; outPix != endPix; ++outPix, ++upPix) {
+      if (upPix->m == max)
+        *outPix = *upPix;
+      else if (upPix->m > 0) {
+        TUINT32 r = upPix->r + (outPix->r * (max - upPix->m)) / 255.0;
+        TUINT32 g = upPix->g + (outPix->g * (max - upPix->m)) / 255.0;
+        TUINT32 b = upPix->b + (outPix->b * (max - upPix->m)) / 255.0;
+
+        outPix->r = std::min(r, max);
+        outPix->g = std::min(g, max);
+        outPix->b = std::min(b, max);
+        outPix->m = upPix->m + (outPix->m * (max - upPix->m)) / 255.0;
+      }
+    }
+  }
+}
+
+void premultiplyRef(const TRaster32P &ras) {
+  for (int y = 0; y < ras->getLy(); ++y) {
+    TPixel32 *pix = ras->pixels(y), *endPix = pix + ras->getLx();
+    for (; pix != endPix; ++pix) premult(*pix);
+  }
+}
+
+void depremultiplyRef(const TRaster32P &ras) {
+  for (int y = 0; y < ras->getLy(); ++y) {
+    TPixel32 *pix = ras->pixels(y), *endPix = pix + ras->getLx();
+    for (; pix != endPix; ++pix)
+      if (pix->m != 0) depremult(*pix);
+  }
+}
+
+void convertRef(const TRaster64P &dst, const TRaster32P &src) {
+  for (int y = 0; y < src->getLy(); ++y) {
+    const TPixel32 *pix = src->pixels(y), *endPix = pix + src->getLx();
+    TPixel64 *outPix    = dst->pixels(y);
+    for (; pix != endPix; ++pix, ++outPix)
+      *outPix = TPixel64(ushortFromByte(pix->r), ushortFromByte(pix->g),
+                         ushortFromByte(pix->b), ushortFromByte(pix->m));
+  }
+}
+
+void convertRef(const TRasterFP &dst, const TRaster32P &src) {
+  for (int y = 0; y < src->getLy(); ++y) {
+    const TPixel32 *pix = src->pixels(y), *endPix = pix + src->getLx();
+    TPixelF *outPix     = dst->pixels(y);
+    for (; pix != endPix; ++pix, ++outPix)
+      *outPix = TPixelF(pix->r / 255.f, pix->g / 255.f, pix->b / 255.f,
+                        pix->m / 255.f);
+  }
+}
+
+void convertRef(const TRaster32P &dst, const TRasterFP &src) {
+  auto toByte = [](float val) {
+    return (UCHAR)(std::min(std::max(val, 0.f), 1.f) * 255.f + 0.5f);
+  };
+
+  for (int y = 0; y < src->getLy(); ++y) {
+    const TPixelF *pix = src->pixels(y), *endPix = pix + src->getLx();
+    TPixel32 *outPix   = dst->pixels(y);
+    for (; pix != endPix; ++pix, ++outPix)
+      *outPix = TPixel32(toByte(pix->r), toByte(pix->g), toByte(pix->b),
+                         toByte(pix->m));
+  }
+}
+
+//! Converts a colormapped raster the way the scalar rows of TRop::convert() do.
+void convertRef(const TRaster32P &dst, const TRasterCM32P &src,
+                const TPaletteP &palette) {
+  std::vector<TPixel32> colors(palette->getStyleCount());
+  for (int s = 0; s != (int)colors.size(); ++s)
+    colors[s] = premultiply(palette->getStyle(s)->getAverageColor());
+
+  const int maxTone = TPixelCM32::getMaxTone();
+  for (int y = 0; y < src->getLy(); ++y) {
+    const TPixelCM32 *pix = src->pixels(y), *endPix = pix + src->getLx();
+    TPixel32 *outPix      = dst->pixels(y);
+    for (; pix != endPix; ++pix, ++outPix) {
+      int t = pix->getTone();
+      if (t == maxTone)
+        *outPix = colors[pix->getPaint()];
+      else if (t == 0)
+        *outPix = colors[pix->getInk()];
+      else
+        *outPix = blend(colors[pix->getInk()], colors[pix->getPaint()], t,
+                        maxTone);
+    }
+  }
+}
+
+//-----------------------------------------------------------------------
+
+//! Runs the resample() bands on std::async threads, like a render would on
+//! its idle workers.
+void runOnThreads(const std::vector<std::function<void()>> &funcs) {
+  std::vector<std::future<void>> futures;
+  for (const std::function<void()> &func : funcs)
+    futures.push_back(std::async(std::launch::async, func));
+  for (std::future<void> &future : futures) future.get();
+}
+
+}  // namespace
+
+//==============================================================================
+
+class TRopKernelsBench final : public TTest {
+public:
+  TRopKernelsBench() : TTest("bench_trop_kernels") {}
+
+  void test() override {
+    cout << "  CPU extensions: 0x" << hex << TSystem::getCPUExtensions() << dec
+         << endl;
+
+    TRaster32P src(benchLx, benchLy), up(benchLx, benchLy);
+    fillRandom(src, 1);
+    fillRandom(up, 2);
+
+    TRaster32P a(benchLx, benchLy), b(benchLx, benchLy);
+
+    // over
+    a->copy(src), b->copy(src);
+    TRop::over(a, up), overRef(b, up);
+    if (checkIdentical("over 32", a, b))
+      report("over 32",
+             mpixPerSec([&]() { a->copy(src), TRop::over(a, up); }),
+             mpixPerSec([&]() { b->copy(src), overRef(b, up); }));
+
+    // premultiply, depremultiply
+    a->copy(src), b->copy(src);
+    TRop::premultiply(a), premultiplyRef(b);
+    if (checkIdentical("premultiply 32", a, b))
+      report("premultiply 32", mpixPerSec([&]() { TRop::premultiply(a); }),
+             mpixPerSec([&]() { premultiplyRef(b); }));
+
+    a->copy(src), b->copy(src);
+    TRop::depremultiply(a), depremultiplyRef(b);
+    if (checkIdentical("depremultiply 32", a, b))
+      report("depremultiply 32",
+             mpixPerSec([&]() { a->copy(src), TRop::depremultiply(a); }),
+             mpixPerSec([&]() { b->copy(src), depremultiplyRef(b); }));
+
+    // convert
+    TRaster64P a64(benchLx, benchLy), b64(benchLx, benchLy);
+    TRop::convert(a64, src), convertRef(b64, src);
+    if (checkIdentical("convert 32 -> 64", a64, b64))
+      report("convert 32 -> 64",
+             mpixPerSec([&]() { TRop::convert(a64, src); }),
+             mpixPerSec([&]() { convertRef(b64, src); }));
+
+    TRasterFP aF(benchLx, benchLy), bF(benchLx, benchLy);
+    TRop::convert(aF, src), convertRef(bF, src);
+    if (checkIdentical("convert 32 -> float", aF, bF))
+      report("convert 32 -> float",
+             mpixPerSec([&]() { TRop::convert(aF, src); }),
+             mpixPerSec([&]() { convertRef(bF, src); }));
+
+    TRop::convert(a, aF), convertRef(b, aF);
+    if (checkIdentical("convert float -> 32", a, b))
+      report("convert float -> 32",
+             mpixPerSec([&]() { TRop::convert(a, aF); }),
+             mpixPerSec([&]() { convertRef(b, aF); }));
+
+    // convert colormapped, with random tones and some translucent styles
+    TPaletteP palette = new TPalette();
+    unsigned int seed = 4;
+    while (palette->getStyleCount() < 64) {
+      seed = seed * 1664525U + 1013904223U;
+      palette->addStyle(TPixel32(seed >> 24, seed >> 16, seed >> 8,
+                                 (seed & 0x300) ? 255 : seed & 0xff));
+    }
+
+    TRasterCM32P cm(benchLx, benchLy);
+    for (int y = 0; y < benchLy; ++y) {
+      TPixelCM32 *pix = cm->pixels(y), *endPix = pix + benchLx;
+      for (; pix != endPix; ++pix) {
+        seed = seed * 1664525U + 1013904223U;
+        *pix = TPixelCM32(seed >> 26, (seed >> 20) & 0x3f, (seed >> 8) & 0xff);
+      }
+    }
+
+    TRop::convert(a, cm, palette), convertRef(b, cm, palette);
+    if (checkIdentical("convert colormapped -> 32", a, b))
+      report("convert colormapped -> 32",
+             mpixPerSec([&]() { TRop::convert(a, cm, palette); }),
+             mpixPerSec([&]() { convertRef(b, cm, palette); }));
+  }
+} tropKernelsBench;
+
+//==============================================================================
+
+//! Measures TRop::resample() on 32-bit rasters. Scale-only transforms take the
+//! separable path, rotations the 2D one; both are timed with the bands run
+//! in sequence and on threads.
+class TRopResampleBench final : public TTest {
+public:
+  TRopResampleBench() : TTest("bench_trop_resample") {}
+
+  void test() override {
+    TRaster32P src(benchLx, benchLy), out(benchLx / 2, benchLy / 2);
+    fillRandom(src, 3);
+
+    const TPointD center(0.25 * benchLx, 0.25 * benchLy);
+    const TAffine scale    = TScale(0.5);
+    const TAffine rotation = TTranslation(center) * TRotation(10) *
+                             TTranslation(-center) * TScale(0.5);
+
+    const TRop::ResampleFilterType filters[] = {TRop::Triangle, TRop::Hann3};
+    const char *const filterNames[]          = {"triangle", "hann3"};
+    const TRop::SubtasksRunner runners[]     = {0, &runOnThreads};
+    const char *const runnerNames[]          = {"sequential", "threaded"};
+    const double outPixels = double(out->getLx()) * out->getLy();
+
+    // The render runner may be installed: compare without it, then restore it
+    TRop::SubtasksRunner oldRunner = TRop::getSubtasksRunner();
+    for (int r = 0; r != 2; ++r) {
+      TRop::setSubtasksRunner(runners[r]);
+      for (int f = 0; f != 2; ++f) {
+        double scaleRate = mpixPerSec(
+            [&]() { TRop::resample(out, src, scale, filters[f]); }, outPixels);
+        double rotationRate = mpixPerSec(
+            [&]() { TRop::resample(out, src, rotation, filters[f]); },
+            outPixels);
+
+        cout << "  resample " << filterNames[f] << ", " << runnerNames[r]
+             << ": scale " << scaleRate << " Mpix/s, rotation "
+             << rotationRate << " Mpix/s" << endl;
+      }
+    }
+
+    TRop::setSubtasksRunner(oldRunner);
+  }
+} tropResampleBench;
@@ -0,0 +1,119 @@
+#include "ttest.h"
+#include "tlevel_io.h"
+#include "ttoonzimage.h"
+#include "tpalette.h"
+#include "tsystem.h"
+#include "tstopwatch.h"
+
+#include <QByteArray>
+
+#include <algorithm>
+#include <cstdlib>
+#include <iostream>
+#include <thread>
+
+using namespace std;
+
+namespace {
+
+const int tlvLx = 1920, tlvLy = 1080, tlvFrames = 48;
+
+//! Writes a level of painted areas crossed by antialiased ink lines, moving
+//! from frame to frame - so that frames compress about as real ones do.
+void writeLevel(const TFilePath &fp) {
+  TPaletteP palette = new TPalette();
+  while (palette->getStyleCount() < 4)
+    palette->addStyle(TPixel32(palette->getStyleCount() * 60, 128, 0));
+
+  TLevelWriterP lw(fp);
+  lw->setPalette(palette.getPointer());
+
+  for (int f = 0; f != tlvFrames; ++f) {
+    TRasterCM32P ras(tlvLx, tlvLy);
+    for (int y = 0; y < tlvLy; ++y) {
+      TPixelCM32 *pix = ras->pixels(y);
+      for (int x = 0; x < tlvLx; ++x) {
+        int paint = 1 + ((x + 8 * f) / 64 + y / 64) % 3;
+        int d     = (x + y + 4 * f) % 48;
+        int tone  = (d < 8) ? std::abs(d - 4) * 63 : 255;
+        pix[x]    = TPixelCM32(1, paint, tone);
+      }
+    }
+
+    TToonzImageP ti(ras, ras->getBounds());
+    ti->setPalette(palette.getPointer());
+    lw->getFrameWriter(TFrameId(f + 1))->save(ti);
+  }
+}
+
+//! Opens \b readerCount readers of the level, then loads all of its frames
+//! with each reader loading every readerCount-th frame on its own thread.
+void readLevel(const TFilePath &fp, int readerCount, TUINT32 &openMs,
+               TUINT32 &loadMs) {
+  TStopWatch openSw;
+  openSw.start();
+  vector<TLevelReaderP> readers;
+  for (int r = 0; r != readerCount; ++r) {
+    readers.push_back(TLevelReaderP(fp));
+    readers.back()->loadInfo();
+  }
+  openSw.stop();
+
+  TStopWatch loadSw;
+  loadSw.start();
+  vector<std::thread> threads;
+  for (int r = 0; r != readerCount; ++r)
+    threads.emplace_back([&, r]() {
+      for (int f = r; f < tlvFrames; f += readerCount)
+        readers[r]->getFrameReader(TFrameId(f + 1))->load();
+    });
+  for (std::thread &thread : threads) thread.join();
+  loadSw.stop();
+
+  openMs = openSw.getTotalTime();
+  loadMs = loadSw.getTotalTime();
+}
+
+}  // namespace
+
+//==============================================================================
+
+//! Measures opening a large TLV and loading its frames from several readers,
+//! as render threads do. Readers share the parsed frame index and read
+//! frames from a mapping of the file; TOONZ_TLV_PLAIN_READS gives the
+//! baseline, where each reader parses the file and reads through its FILE.
+class TlvReadsBench final : public TTest {
+public:
+  TlvReadsBench() : TTest("bench_tlv_reads") {}
+
+  void test() override {
+    TFilePath fp = TSystem::getTempDir() + "bench_tlv_reads.tlv";
+    writeLevel(fp);
+
+    QByteArray plainReads = qgetenv("TOONZ_TLV_PLAIN_READS");
+
+    // Warm up the file cache, so that both paths read from memory
+    TUINT32 openMs, loadMs;
+    readLevel(fp, 1, openMs, loadMs);
+
+    const int readerCounts[] = {1, 4, 8};
+    for (int c = 0; c != 3; ++c) {
+      TUINT32 plainOpenMs, plainLoadMs;
+      qputenv("TOONZ_TLV_PLAIN_READS", "1");
+      readLevel(fp, readerCounts[c], plainOpenMs, plainLoadMs);
+
+      qunsetenv("TOONZ_TLV_PLAIN_READS");
+      readLevel(fp, readerCounts[c], openMs, loadMs);
+
+      cout << "  " << readerCounts[c] << " readers: open " << openMs
+           << " ms (per-reader " << plainOpenMs << " ms), load " << tlvFrames
+           << " frames " << loadMs << " ms (per-reader " << plainLoadMs
+           << " ms)" << endl;
+    }
+
+    if (!plainReads.isNull()) qputenv("TOONZ_TLV_PLAIN_READS", plainReads);
+
+    TSystem::removeFileOrLevel(fp);
+    TSystem::removeFileOrLevel(fp.withType("tpl"));
+  }
+} tlvReadsBench;
@@ -0,0 +1,199 @@
+#include "ttest.h"
+#include "tvectorimage.h"
+#include "tvectorrenderdata.h"
+#include "tsimplecolorstyles.h"
+#include "tofflinegl.h"
+#include "tpalette.h"
+#include "tstroke.h"
+#include "tstopwatch.h"
+
+#include <QByteArray>
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <memory>
+
+using namespace std;
+
+namespace {
+
+//! Returns a pseudo-random number in [0, 1), from the specified seed.
+double random01(unsigned int &seed) {
+  seed = seed * 1664525U + 1013904223U;
+  return (seed >> 8) / double(1 << 24);
+}
+
+//-----------------------------------------------------------------------
+
+//! Returns a vector image with the specified number of short strokes,
+//! scattered on a square wide enough to keep their density constant.
+TVectorImageP makeScatteredStrokes(int count, unsigned int seed) {
+  const double strokeLength = 40.0, side = 20.0 * std::sqrt(double(count));
+
+  TVectorImageP vi = new TVectorImage();
+  for (int s = 0; s != count; ++s) {
+    TPointD p(side * random01(seed), side * random01(seed));
+    TPointD d(strokeLength * (random01(seed) - 0.5),
+              strokeLength * (random01(seed) - 0.5));
+    TPointD bend(0.25 * d.y, -0.25 * d.x);
+
+    vector<TThickPoint> points;
+    points.push_back(TThickPoint(p, 1));
+    points.push_back(TThickPoint(p + 0.5 * d + bend, 1));
+    points.push_back(TThickPoint(p + d, 1));
+
+    vi->addStroke(new TStroke(points));
+  }
+
+  return vi;
+}
+
+//-----------------------------------------------------------------------
+
+//! Returns a horizontal wavy stroke of the specified chunks count, starting
+//! at the specified point.
+TStroke *makeWavyStroke(int chunksCount, const TPointD &p) {
+  vector<TThickPoint> points;
+  for (int i = 0; i <= 2 * chunksCount; ++i)
+    points.push_back(
+        TThickPoint(p.x + 10.0 * i, p.y + 30.0 * std::sin(0.35 * i), 2));
+
+  return new TStroke(points);
+}
+
+}  // namespace
+
+//==============================================================================
+
+//! Measures the regions computation on images of many short strokes, at
+//! constant density. Intersection candidates are found through a grid of
+//! the stroke bboxes, so the time should grow about linearly with the
+//! strokes count - rather than with its square.
+class ComputeRegionsBench final : public TTest {
+public:
+  ComputeRegionsBench() : TTest("bench_compute_regions") {}
+
+  void test() override {
+    const int counts[] = {1250, 2500, 5000};
+    for (int c = 0; c != 3; ++c) {
+      TVectorImageP vi = makeScatteredStrokes(counts[c], 1);
+
+      TStopWatch sw;
+      sw.start();
+      vi->findRegions();
+      sw.stop();
+
+      cout << "  " << counts[c] << " strokes: " << sw.getTotalTime()
+           << " ms, " << vi->getRegionCount() << " regions" << endl;
+    }
+  }
+} computeRegionsBench;
+
+//==============================================================================
+
+//! Measures the lookup of stroke parameters at given lengths, one at a time
+//! and batched, on a 100 chunks wavy stroke. Both must give the same results.
+class StrokeLengthLookupBench final : public TTest {
+public:
+  StrokeLengthLookupBench() : TTest("bench_stroke_length_lookup") {}
+
+  void test() override {
+    const int chunksCount = 100, lookupsCount = 4099, reps = 10;
+
+    std::unique_ptr<TStroke> strokePtr(makeWavyStroke(chunksCount, TPointD()));
+    TStroke &stroke = *strokePtr;
+    double length   = stroke.getLength();  // Builds the length cache
+
+    vector<double> lengths(lookupsCount), single(lookupsCount), batched;
+    for (int l = 0; l != lookupsCount; ++l)
+      lengths[l] = length * l / (lookupsCount - 1);
+
+    TStopWatch singleSw;
+    singleSw.start();
+    for (int r = 0; r != reps; ++r)
+      for (int l = 0; l != lookupsCount; ++l)
+        single[l] = stroke.getParameterAtLength(lengths[l]);
+    singleSw.stop();
+
+    TStopWatch batchedSw;
+    batchedSw.start();
+    for (int r = 0; r != reps; ++r)
+      stroke.getParametersAtLength(lengths, batched);
+    batchedSw.stop();
+
+    double maxDiff = 0.0;
+    for (int l = 0; l != lookupsCount; ++l)
+      maxDiff = std::max(maxDiff, std::abs(single[l] - batched[l]));
+
+    cout << "  " << lookupsCount << " lookups on " << chunksCount
+         << " chunks: single " << singleSw.getTotalTime() / double(reps)
+         << " ms, batched " << batchedSw.getTotalTime() / double(reps)
+         << " ms, max difference " << maxDiff << endl;
+    if (!(maxDiff < 1e-9))
+      cout << "  FAILED: batched lookups differ from single ones" << endl;
+  }
+} strokeLengthLookupBench;
+
+//==============================================================================
+
+//! Measures the rendering of strokes drawn with a wide center line style,
+//! which looks up the stroke parameter at each unit of length. Lookups start
+//! from the per-chunk length samples, or search the whole chunk when
+//! TOONZ_STROKE_NO_LENGTH_SAMPLES is set - as they did before the samples.
+class StyledStrokesRenderBench final : public TTest {
+public:
+  StyledStrokesRenderBench() : TTest("bench_styled_strokes_render") {}
+
+  void test() override {
+    const int size = 1024, strokesCount = 40, chunksCount = 100, reps = 5;
+
+    QByteArray noSamples = qgetenv("TOONZ_STROKE_NO_LENGTH_SAMPLES");
+
+    TPaletteP palette = new TPalette();
+    int styleId =
+        palette->addStyle(new TCenterLineStrokeStyle(TPixel32::Black, 0, 2));
+
+    TVectorRenderData rd(TAffine(), TRect(0, 0, size - 1, size - 1),
+                         palette.getPointer(), 0, true);
+
+    TOfflineGL gl(TDimension(size, size));
+    gl.makeCurrent();
+
+    TUINT32 times[2];
+    for (int m = 0; m != 2; ++m) {
+      // The lookup method is chosen when the strokes' length cache is built
+      if (m == 0)
+        qputenv("TOONZ_STROKE_NO_LENGTH_SAMPLES", "1");
+      else
+        qunsetenv("TOONZ_STROKE_NO_LENGTH_SAMPLES");
+
+      TVectorImageP vi = new TVectorImage();
+      vi->setPalette(palette.getPointer());
+      for (int s = 0; s != strokesCount; ++s) {
+        TStroke *stroke = makeWavyStroke(chunksCount, TPointD(10, 25 * s + 20));
+        stroke->setStyle(styleId);
+        stroke->getLength();
+        vi->addStroke(stroke);
+      }
+
+      TStopWatch sw;
+      sw.start();
+      for (int r = 0; r != reps; ++r) {
+        gl.clear(TPixel32::White);
+        gl.draw(vi, rd);
+      }
+      gl.getRaster();  // Waits for the drawing to complete
+      sw.stop();
+
+      times[m] = sw.getTotalTime() / reps;
+    }
+
+    if (!noSamples.isNull())
+      qputenv("TOONZ_STROKE_NO_LENGTH_SAMPLES", noSamples);
+
+    cout << "  " << strokesCount << " strokes of " << chunksCount
+         << " chunks: " << times[1] << " ms per render (whole chunk search "
+         << times[0] << " ms)" << endl;
+  }
+} styledStrokesRenderBench;
@@ -0,0 +1,106 @@
+#include "ttest.h"
+#include "tvectorrasterizer.h"
+#include "tvectorimage.h"
+#include "tvectorrenderdata.h"
+#include "tofflinegl.h"
+#include "tpalette.h"
+#include "tstroke.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <iostream>
+
+using namespace std;
+
+namespace {
+
+//! Returns a closed square stroke of the specified half side.
+TStroke *makeSquare(double r, double thick) {
+  const TPointD corners[] = {TPointD(-r, -r), TPointD(r, -r), TPointD(r, r),
+                             TPointD(-r, r)};
+
+  vector<TThickPoint> points;
+  for (int c = 0; c != 4; ++c) {
+    const TPointD &p = corners[c], &q = corners[(c + 1) % 4];
+    points.push_back(TThickPoint(p, thick));
+    points.push_back(TThickPoint(0.5 * (p + q), thick));
+  }
+  points.push_back(points.front());
+
+  TStroke *stroke = new TStroke(points);
+  stroke->setSelfLoop();
+  return stroke;
+}
+
+}  // namespace
+
+//==============================================================================
+
+//! Draws a filled square with the CPU rasterizer and through OpenGL, which
+//! must give the same image up to the antialiasing of the edges.
+class VectorRasterizerParityTest final : public TTest {
+public:
+  VectorRasterizerParityTest() : TTest("test_vectorrasterizer_parity") {}
+
+  void test() override {
+    const int size = 64;
+
+    TPaletteP palette = new TPalette();
+    int inkId         = palette->addStyle(TPixel32(0, 0, 255));
+    int paintId       = palette->addStyle(TPixel32(255, 128, 0));
+
+    TVectorImageP vi = new TVectorImage();
+    vi->setPalette(palette.getPointer());
+
+    TStroke *stroke = makeSquare(20, 2);
+    stroke->setStyle(inkId);
+    vi->addStroke(stroke);
+    vi->findRegions();
+    vi->fill(TPointD(), paintId);
+
+    TVectorRenderData rd(TTranslation(0.5 * size, 0.5 * size),
+                         TRect(0, 0, size - 1, size - 1),
+                         palette.getPointer(), 0, true);
+
+    TRaster32P cpuRas(size, size);
+    cpuRas->clear();
+    if (!rasterizeVectorImage(cpuRas, rd, vi.getPointer())) {
+      cout << "  FAILED: rasterizeVectorImage" << endl;
+      return;
+    }
+
+    TOfflineGL gl(TDimension(size, size));
+    gl.makeCurrent();
+    gl.clear(TPixel32::Transparent);
+    gl.draw(vi, rd);
+    TRaster32P glRas = gl.getRaster();
+
+    // Pixels away from the edges must be identical, the others close
+    int maxDiff = 0, failures = 0;
+    TINT64 cpuCoverage = 0, glCoverage = 0;
+    for (int y = 0; y < size; ++y) {
+      const TPixel32 *cpuPix = cpuRas->pixels(y), *glPix = glRas->pixels(y);
+      for (int x = 0; x < size; ++x) {
+        cpuCoverage += cpuPix[x].m, glCoverage += glPix[x].m;
+
+        int diff = std::max({abs(cpuPix[x].r - glPix[x].r),
+                             abs(cpuPix[x].g - glPix[x].g),
+                             abs(cpuPix[x].b - glPix[x].b),
+                             abs(cpuPix[x].m - glPix[x].m)});
+        maxDiff = std::max(maxDiff, diff);
+
+        int dx = abs(abs(x - size / 2) - 20), dy = abs(abs(y - size / 2) - 20);
+        if (std::min(dx, dy) > 3 && diff != 0) ++failures;
+      }
+    }
+
+    cout << "  max pixel difference: " << maxDiff
+         << ", coverage: cpu " << cpuCoverage << " gl " << glCoverage << endl;
+
+    if (failures)
+      cout << "  FAILED: " << failures << " pixels away from the edges differ"
+           << endl;
+    if (std::abs(cpuCoverage - glCoverage) * 50 >= glCoverage)
+      cout << "  FAILED: coverages differ by 2% or more" << endl;
+  }
+} vectorRasterizerParityTest;
@@ -16,6 +16,7 @@
 #include "tl2lautocloser.h"
 #include "tcomputeregions.h"
 #include <vector>
+#include <set>
 
 #include "tcurveutil.h"
 
@@ -897,6 +898,8 @@ assert(v[b.m_nextBranch].m_nextBranch==i);
 //-----------------------------------------------------------------------------
 
 void TVectorImage::Imp::eraseIntersection(int index) {
+  m_regionsMatchIntersections = false;
+
   vector<int> autocloseStrokes;
   doEraseIntersection(index, &autocloseStrokes);
 
@@ -2221,6 +2224,133 @@ void addIntersection(IntersectionData &intData, const vector<VIStroke *> &s,
 
 //-----------------------------------------------------------------------------
 
+namespace {
+
+//! Uniform grid of stroke bboxes, used to find the strokes whose bbox
+//! overlaps a given one without testing all the image's strokes.
+class StrokeBBoxGrid {
+  struct Entry {
+    int m_index;
+    TRectD m_bbox;
+  };
+
+  std::vector<Entry> m_entries;
+  std::vector<std::vector<int>> m_cells;  //!< Entries, by cell
+  std::vector<int> m_largeEntries;  //!< Entries spanning too many cells
+
+  TRectD m_bbox;
+  double m_cellLx, m_cellLy;
+  int m_cols, m_rows;
+
+public:
+  StrokeBBoxGrid() : m_cellLx(1.0), m_cellLy(1.0), m_cols(0), m_rows(0) {}
+
+  void add(int index, const TRectD &bbox) {
+    Entry entry = {index, bbox};
+    m_entries.push_back(entry);
+  }
+
+  void build();
+
+  //! Returns the indices, not less than \b minIndex and in ascending order,
+  //! of the strokes whose bbox overlaps the specified one.
+  void query(const TRectD &bbox, int minIndex, vector<int> &indices) const;
+
+private:
+  void getCells(const TRectD &bbox, int &c0, int &r0, int &c1, int &r1) const {
+    c0 = tcrop((int)((bbox.x0 - m_bbox.x0) / m_cellLx), 0, m_cols - 1);
+    c1 = tcrop((int)((bbox.x1 - m_bbox.x0) / m_cellLx), 0, m_cols - 1);
+    r0 = tcrop((int)((bbox.y0 - m_bbox.y0) / m_cellLy), 0, m_rows - 1);
+    r1 = tcrop((int)((bbox.y1 - m_bbox.y0) / m_cellLy), 0, m_rows - 1);
+  }
+};
+
+//-----------------------------------------------------------------------------
+
+void StrokeBBoxGrid::build() {
+  const int maxCellsPerSide = 256, maxCellsPerEntry = 64;
+
+  int e, entriesCount = (int)m_entries.size();
+  if (entriesCount == 0) return;
+
+  double sizesSum = 0.0;
+
+  m_bbox = m_entries[0].m_bbox;
+  for (e = 0; e < entriesCount; ++e) {
+    const TRectD &bbox = m_entries[e].m_bbox;
+
+    m_bbox += bbox;
+    sizesSum += bbox.getLx() + bbox.getLy();
+  }
+
+  // Cells are about as large as the average stroke, and as many as strokes
+  double cellSize = std::max(
+      0.5 * sizesSum / entriesCount,
+      sqrt(m_bbox.getLx() * m_bbox.getLy() / entriesCount));
+  if (cellSize <= 0.0) cellSize = 1.0;
+
+  m_cols = tcrop((int)(m_bbox.getLx() / cellSize) + 1, 1, maxCellsPerSide);
+  m_rows = tcrop((int)(m_bbox.getLy() / cellSize) + 1, 1, maxCellsPerSide);
+
+  m_cellLx = std::max(m_bbox.getLx() / m_cols, TConsts::epsilon);
+  m_cellLy = std::max(m_bbox.getLy() / m_rows, TConsts::epsilon);
+
+  m_cells.resize(m_cols * m_rows);
+
+  for (e = 0; e < entriesCount; ++e) {
+    int c, r, c0, r0, c1, r1;
+    getCells(m_entries[e].m_bbox, c0, r0, c1, r1);
+
+    if ((c1 - c0 + 1) * (r1 - r0 + 1) > maxCellsPerEntry) {
+      m_largeEntries.push_back(e);
+      continue;
+    }
+
+    for (r = r0; r <= r1; ++r)
+      for (c = c0; c <= c1; ++c) m_cells[r * m_cols + c].push_back(e);
+  }
+}
+
+//-----------------------------------------------------------------------------
+
+void StrokeBBoxGrid::query(const TRectD &bbox, int minIndex,
+                           vector<int> &indices) const {
+  indices.clear();
+  if (m_entries.empty() || !m_bbox.overlaps(bbox)) return;
+
+  struct locals {
+    static void test(const Entry &entry, const TRectD &bbox, int minIndex,
+                     vector<int> &indices) {
+      if (entry.m_index >= minIndex && entry.m_bbox.overlaps(bbox))
+        indices.push_back(entry.m_index);
+    }
+  };
+
+  int c, r, c0, r0, c1, r1;
+  getCells(bbox, c0, r0, c1, r1);
+
+  for (r = r0; r <= r1; ++r)
+    for (c = c0; c <= c1; ++c) {
+      const vector<int> &cell = m_cells[r * m_cols + c];
+
+      vector<int>::const_iterator et, eEnd = cell.end();
+      for (et = cell.begin(); et != eEnd; ++et)
+        locals::test(m_entries[*et], bbox, minIndex, indices);
+    }
+
+  vector<int>::const_iterator et, eEnd = m_largeEntries.end();
+  for (et = m_largeEntries.begin(); et != eEnd; ++et)
+    locals::test(m_entries[*et], bbox, minIndex, indices);
+
+  // Entries spanning multiple cells are found multiple times
+  std::sort(indices.begin(), indices.end());
+  indices.erase(std::unique(indices.begin(), indices.end()), indices.end());
+}
+
+}  // namespace
+
+//-----------------------------------------------------------------------------
+
 void TVectorImage::Imp::findIntersections() {
   vector<VIStroke *> &strokeArray = m_strokes;
   IntersectionData &intData       = *m_intersectionData;
@@ -2268,44 +2398,63 @@ void TVectorImage::Imp::findIntersections() {
 
   map<pair<int, int>, vector<DoublePair>> intersectionMap;
 
+  // Only pairs of strokes with overlapping bboxes need to be tested. Old
+  // strokes are paired with the new ones only, so they are looked up in a
+  // separate grid.
+  vector<TRectD> bboxes(strokeSize);
+  StrokeBBoxGrid strokesGrid, newStrokesGrid;
+
+  for (i = 0; i < strokeSize; i++) {
+    if (strokeArray[i]->m_isPoint) continue;
+
+    bboxes[i] = strokeArray[i]->m_s->getBBox();
+
+    strokesGrid.add(i, bboxes[i]);
+    if (strokeArray[i]->m_isNewForFill) newStrokesGrid.add(i, bboxes[i]);
+  }
+
+  strokesGrid.build();
+  newStrokesGrid.build();
+
+  vector<int> candidates;
+  UINT c;
+
   for (i = 0; i < strokeSize; i++) {
     TStroke *s1 = strokeArray[i]->m_s;
     if (strokeArray[i]->m_isPoint) continue;
-    for (j = i; j < strokeSize /*&& (strokeArray[i]->getBBox().x1>=
-                                  strokeArray[j]->getBBox().x0)*/
-         ;
-         j++) {
+
+    const StrokeBBoxGrid &grid =
+        strokeArray[i]->m_isNewForFill ? strokesGrid : newStrokesGrid;
+    grid.query(bboxes[i], i, candidates);
+
+    for (c = 0; c < candidates.size(); c++) {
+      j           = candidates[c];
       TStroke *s2 = strokeArray[j]->m_s;
 
-      if (strokeArray[j]->m_isPoint ||
-          !(strokeArray[i]->m_isNewForFill || strokeArray[j]->m_isNewForFill))
-        continue;
       if (strokeArray[i]->m_groupId != strokeArray[j]->m_groupId) continue;
 
       vector<DoublePair> parIntersections;
-      if (s1->getBBox().overlaps(s2->getBBox())) {
-        UINT size = intData.m_intList.size();
-
-        if (intersect(s1, s2, parIntersections, false)) {
-          // if (i==0 && j==1) parIntersections.erase(parIntersections.begin());
-          intersectionMap[pair<int, int>(i, j)] = parIntersections;
-          addIntersections(intData, strokeArray, i, j, parIntersections,
-                           strokeSize, isVectorized);
-        } else
-          intersectionMap[pair<int, int>(i, j)] = vector<DoublePair>();
+      UINT size = intData.m_intList.size();
 
-        if (!strokeArray[i]->m_isNewForFill &&
-            size != intData.m_intList.size() &&
-            !strokeArray[i]->m_edgeList.empty())  // aggiunte nuove intersezioni
-        {
-          intData.m_intersectedStrokeArray.push_back(IntersectedStrokeEdges(i));
-          list<TEdge *> &_list =
-              intData.m_intersectedStrokeArray.back().m_edgeList;
-          list<TEdge *>::const_iterator it;
-          for (it = strokeArray[i]->m_edgeList.begin();
-               it != strokeArray[i]->m_edgeList.end(); ++it)
-            _list.push_back(new TEdge(**it, false));
-        }
+      if (intersect(s1, s2, parIntersections, false)) {
+        // if (i==0 && j==1) parIntersections.erase(parIntersections.begin());
+        intersectionMap[pair<int, int>(i, j)] = parIntersections;
+        addIntersections(intData, strokeArray, i, j, parIntersections,
+                         strokeSize, isVectorized);
+      } else
+        intersectionMap[pair<int, int>(i, j)] = vector<DoublePair>();
+
+      if (!strokeArray[i]->m_isNewForFill &&
+          size != intData.m_intList.size() &&
+          !strokeArray[i]->m_edgeList.empty())  // aggiunte nuove intersezioni
+      {
+        intData.m_intersectedStrokeArray.push_back(IntersectedStrokeEdges(i));
+        list<TEdge *> &_list =
+            intData.m_intersectedStrokeArray.back().m_edgeList;
+        list<TEdge *>::const_iterator it;
+        for (it = strokeArray[i]->m_edgeList.begin();
+             it != strokeArray[i]->m_edgeList.end(); ++it)
+          _list.push_back(new TEdge(**it, false));
       }
     }
   }
@@ -2313,35 +2462,42 @@ void TVectorImage::Imp::findIntersections() {
 #ifdef AUTOCLOSE_ATTIVO
   TL2LAutocloser l2lautocloser;
 
+  // Same as above, with bboxes enlarged by the autoclose distance
+  StrokeBBoxGrid closeStrokesGrid, closeNewStrokesGrid;
+
   for (i = 0; i < strokeSize; i++) {
-    TStroke *s1 = strokeArray[i]->m_s;
     if (strokeArray[i]->m_isPoint) continue;
-    for (j = i; j < strokeSize; j++) {
-      if (strokeArray[i]->m_groupId != strokeArray[j]->m_groupId) continue;
 
-      TStroke *s2 = strokeArray[j]->m_s;
-      if (strokeArray[j]->m_isPoint) continue;
-      if (!(strokeArray[i]->m_isNewForFill || strokeArray[j]->m_isNewForFill))
-        continue;
+    double thick   = strokeArray[i]->m_s->getMaxThickness();
+    double enlarge = (m_autocloseTolerance + 0.7) * (thick > 0 ? thick : 2.5);
+    bboxes[i] = bboxes[i].enlarge(enlarge);
 
-      double enlarge1 =
-          (m_autocloseTolerance + 0.7) *
-          (s1->getMaxThickness() > 0 ? s1->getMaxThickness() : 2.5);
-      double enlarge2 =
-          (m_autocloseTolerance + 0.7) *
-          (s2->getMaxThickness() > 0 ? s2->getMaxThickness() : 2.5);
-
-      if (s1->getBBox().enlarge(enlarge1).overlaps(
-              s2->getBBox().enlarge(enlarge2))) {
-        map<pair<int, int>, vector<DoublePair>>::iterator it =
-            intersectionMap.find(pair<int, int>(i, j));
-        if (it == intersectionMap.end())
-          autoclose(m_autocloseTolerance, strokeArray, i, j, intData,
-                    strokeSize, l2lautocloser, 0, isVectorized);
-        else
-          autoclose(m_autocloseTolerance, strokeArray, i, j, intData,
-                    strokeSize, l2lautocloser, &(it->second), isVectorized);
-      }
+    closeStrokesGrid.add(i, bboxes[i]);
+    if (strokeArray[i]->m_isNewForFill) closeNewStrokesGrid.add(i, bboxes[i]);
+  }
+
+  closeStrokesGrid.build();
+  closeNewStrokesGrid.build();
+
+  for (i = 0; i < strokeSize; i++) {
+    if (strokeArray[i]->m_isPoint) continue;
+
+    const StrokeBBoxGrid &grid =
+        strokeArray[i]->m_isNewForFill ? closeStrokesGrid : closeNewStrokesGrid;
+    grid.query(bboxes[i], i, candidates);
+
+    for (c = 0; c < candidates.size(); c++) {
+      j = candidates[c];
+      if (strokeArray[i]->m_groupId != strokeArray[j]->m_groupId) continue;
+
+      map<pair<int, int>, vector<DoublePair>>::iterator it =
+          intersectionMap.find(pair<int, int>(i, j));
+      if (it == intersectionMap.end())
+        autoclose(m_autocloseTolerance, strokeArray, i, j, intData, strokeSize,
+                  l2lautocloser, 0, isVectorized);
+      else
+        autoclose(m_autocloseTolerance, strokeArray, i, j, intData, strokeSize,
+                  l2lautocloser, &(it->second), isVectorized);
     }
     strokeArray[i]->m_isNewForFill = false;
   }
@@ -2798,13 +2954,233 @@ static void printStrokes1(vector<VIStroke *> &v, int size) {
   }
 }
 
+//-----------------------------------------------------------------------------
+
+namespace {
+
+//! Returns whether the region borders any of the specified strokes, or
+//! overlaps any of the specified areas.
+bool isChangedRegion(const TRegion &r, const std::set<int> &changedStrokes,
+                     const vector<TRectD> &changedAreas) {
+  UINT i;
+  for (i = 0; i < r.getEdgeCount(); i++)
+    if (changedStrokes.count(r.getEdge(i)->m_index)) return true;
+
+  TRectD bbox = r.getBBox();
+  for (i = 0; i < changedAreas.size(); i++)
+    if (bbox.overlaps(changedAreas[i])) return true;
+
+  return false;
+}
+
+//-----------------------------------------------------------------------------
+
+//! Deletes the changed subregions of r, moving their own unchanged
+//! subregions to r.
+void eraseChangedSubregions(TRegion *r, const std::set<int> &changedStrokes,
+                            const vector<TRectD> &changedAreas) {
+  for (int i = (int)r->getSubregionCount() - 1; i >= 0; i--) {
+    TRegion *sub = r->getSubregion(i);
+    eraseChangedSubregions(sub, changedStrokes, changedAreas);
+
+    if (isChangedRegion(*sub, changedStrokes, changedAreas)) {
+      sub->moveSubregionsTo(r);
+      r->deleteSubregion(i);
+      delete sub;
+    }
+  }
+}
+
+//-----------------------------------------------------------------------------
+
+void addRegionTree(TRegion *r, vector<TRegion *> &regions) {
+  regions.push_back(r);
+  for (UINT i = 0; i < r->getSubregionCount(); i++)
+    addRegionTree(r->getSubregion(i), regions);
+}
+
+//-----------------------------------------------------------------------------
+
+//! Follows the face of the intersections graph that region r bounded, just
+//! like findRegion() would do starting from the branch of r's first edge.
+//! Visited branches are marked, while the edge joins and the style
+//! assignments findRegion() would perform are stored in the specified arrays.
+//! Returns false if the face is no longer bounded by r's edges.
+bool followRegion(IntersectedStroke *first, const TRegion &r,
+                  bool minimizeEdges, vector<pair<TEdge *, double>> &edgeEnds,
+                  vector<pair<TEdge *, int>> &edgeStyles) {
+  UINT e = 0, edgeCount = r.getEdgeCount();
+  TEdge *edge = 0;
+  double w1   = 0.0;
+  int currStyle = 0;
+
+  IntersectedStroke *p2 = first;
+  Intersection *p1;
+
+  do {
+    TEdge &branchEdge = p2->m_edge;
+
+    if (branchEdge.m_styleId != 0) {
+      if (currStyle == 0)
+        currStyle = branchEdge.m_styleId;
+      else if (branchEdge.m_styleId != currStyle)
+        return false;
+    } else if (currStyle != 0)
+      edgeStyles.push_back(make_pair(&branchEdge, currStyle));
+
+    if (e < edgeCount && &branchEdge == r.getEdge(e)) {
+      if (edge) edgeEnds.push_back(make_pair(edge, w1));
+
+      edge = r.getEdge(e++);
+      w1   = edge->m_w1;
+    } else if (minimizeEdges && edge &&
+               branchEdge.m_s->getMaxThickness() > 0.0 &&
+               branchEdge.m_index == edge->m_index &&
+               areAlmostEqual(w1, branchEdge.m_w0, 1e-5))
+      w1 = branchEdge.m_w1;  // joined to the previous edge, see addEdge()
+    else
+      return false;
+
+    p1 = p2->m_nextIntersection;
+    p2 = p2->m_nextStroke;
+    if (!p1 || !p2 || !p2->m_nextIntersection || p2->m_visited) return false;
+
+    p2->m_visited = true;
+
+    do {
+      p2 = p2->next();
+      if (!p2) p2 = p1->m_strokeList.first();
+    } while (!p2->m_nextIntersection);
+  } while (p2 != first);
+
+  if (e != edgeCount) return false;
+
+  edgeEnds.push_back(make_pair(edge, w1));
+  return true;
+}
+
+//-----------------------------------------------------------------------------
+
+//! Binds the regions kept from the previous computation to the newly linked
+//! intersections graph, so that only the missing ones need to be found.
+//! Returns false if the graph changed under any of them.
+bool bindRegions(const vector<TRegion *> &regions,
+                 const VIList<Intersection> &intList, bool minimizeEdges) {
+  vector<pair<TEdge *, double>> edgeEnds;
+  vector<pair<TEdge *, int>> edgeStyles;
+  UINT i, j, boundCount = 0;
+
+  for (i = 0; i < regions.size(); i++)
+    for (j = 0; j < regions[i]->getEdgeCount(); j++)
+      regions[i]->getEdge(j)->m_r = regions[i];
+
+  Intersection *p1;
+  IntersectedStroke *p2;
+
+  for (p1 = intList.first(); p1; p1 = p1->next())
+    for (p2 = p1->m_strokeList.first(); p2; p2 = p2->next()) {
+      TRegion *r = p2->m_edge.m_r;
+      if (!r || r->getEdge(0) != &p2->m_edge) continue;
+
+      if (!followRegion(p2, *r, minimizeEdges, edgeEnds, edgeStyles))
+        return false;
+
+      boundCount++;
+    }
+
+  if (boundCount != regions.size()) return false;
+
+  for (i = 0; i < edgeEnds.size(); i++)
+    edgeEnds[i].first->m_w1 = edgeEnds[i].second;
+  for (i = 0; i < edgeStyles.size(); i++)
+    edgeStyles[i].first->m_styleId = edgeStyles[i].second;
+
+  return true;
+}
+
+}  // namespace
+
+//-----------------------------------------------------------------------------
+
+//! Deletes the regions that changing the specified strokes may affect, and
+//! that computeRegions() will then find again. Must be invoked before the
+//! strokes' intersections are erased, as the regions refer to them.
+void TVectorImage::Imp::eraseChangedRegions(
+    const std::vector<int> &strokeIndexArray) {
+  std::set<int> changedStrokes(strokeIndexArray.begin(),
+                               strokeIndexArray.end());
+  vector<TRectD> changedAreas;
+  UINT i;
+
+  // Changed and new strokes will be intersected again, autoclose segments
+  // included
+  for (i = 0; i < m_strokes.size(); i++) {
+    if (!m_strokes[i]->m_isNewForFill && !changedStrokes.count(i)) continue;
+
+    TStroke *s   = m_strokes[i]->m_s;
+    double thick = s->getMaxThickness();
+    changedAreas.push_back(s->getBBox().enlarge(
+        2.0 * (m_autocloseTolerance + 0.7) * (thick > 0 ? thick : 2.5)));
+  }
+
+  // Intersections on changed strokes will be erased, together with the
+  // autoclose segments starting from them (see doEraseIntersection())
+  VIList<Intersection> &intList = m_intersectionData->m_intList;
+  Intersection *p1;
+  IntersectedStroke *p2;
+
+  for (p1 = intList.first(); p1; p1 = p1->next()) {
+    for (p2 = p1->m_strokeList.first(); p2; p2 = p2->next())
+      if (p2->m_edge.m_index >= 0 && changedStrokes.count(p2->m_edge.m_index))
+        break;
+    if (!p2) continue;
+
+    for (p2 = p1->m_strokeList.first(); p2; p2 = p2->next())
+      if (p2->m_edge.m_index < 0 &&
+          (p2->m_edge.m_w0 == 1 || p2->m_edge.m_w0 == 0))
+        changedStrokes.insert(p2->m_edge.m_index);
+  }
+
+  // Regions touching them are affected. Their position is taken on the
+  // unchanged strokes passing there - if none does, the regions there border
+  // a changed stroke anyway.
+  const TPointD margin(1e-3, 1e-3);
+
+  for (p1 = intList.first(); p1; p1 = p1->next()) {
+    for (p2 = p1->m_strokeList.first(); p2; p2 = p2->next())
+      if (changedStrokes.count(p2->m_edge.m_index)) break;
+    if (!p2) continue;
+
+    for (p2 = p1->m_strokeList.first(); p2; p2 = p2->next())
+      if (p2->m_edge.m_s && !changedStrokes.count(p2->m_edge.m_index)) {
+        TPointD p = p2->m_edge.m_s->getPoint(p2->m_edge.m_w0);
+        changedAreas.push_back(TRectD(p - margin, p + margin));
+        break;
+      }
+  }
+
+  vector<TRegion *> regions;
+  regions.swap(m_regions);
+
+  for (i = 0; i < regions.size(); i++) {
+    TRegion *r = regions[i];
+    eraseChangedSubregions(r, changedStrokes, changedAreas);
+
+    if (isChangedRegion(*r, changedStrokes, changedAreas)) {
+      r->moveSubregionsTo(m_regions);
+      delete r;
+    } else
+      m_regions.push_back(r);
+  }
+}
+
 //-----------------------------------------------------------------------------
 void printStrokes1(vector<VIStroke *> &v, int size);
 
 // void testHistory();
 
 // Trova le regioni in una TVectorImage
-int TVectorImage::Imp::computeRegions() {
+int TVectorImage::Imp::computeRegions(bool keepRegions) {
 #ifdef NEW_REGION_FILL
   return 0;
 #endif
@@ -2833,9 +3209,12 @@ return true;
 
   // g_autocloseTolerance = m_autocloseTolerance;
 
-  // Cancella le regioni gia' esistenti per ricalcolarle
-  clearPointerContainer(m_regions);
-  m_regions.clear();
+  // Cancella le regioni gia' esistenti per ricalcolarle - a parte quelle
+  // lasciate da eraseChangedRegions()
+  if (!keepRegions) {
+    clearPointerContainer(m_regions);
+    m_regions.clear();
+  }
 
   // Controlla che ci siano degli stroke
   if (m_strokes.empty()) {
@@ -2861,6 +3240,31 @@ return true;
   for (p1 = intList.first(); p1; p1 = p1->next())
     for (p2 = p1->m_strokeList.first(); p2; p2 = p2->next()) p2->m_edge.m_r = 0;
 
+  if (keepRegions) {
+    vector<TRegion *> keptRegions;
+    for (UINT i = 0; i < m_regions.size(); i++)
+      addRegionTree(m_regions[i], keptRegions);
+
+    if (bindRegions(keptRegions, intList, m_minimizeEdges)) {
+      for (UINT i = 0; i < keptRegions.size(); i++)
+        for (UINT j = 0; j < keptRegions[i]->getEdgeCount(); j++) {
+          TEdge *e = keptRegions[i]->getEdge(j);
+          if (e->m_index >= 0) m_strokes[e->m_index]->addEdge(e);
+        }
+    } else {
+      // The intersections graph changed under some kept region: all the
+      // regions are found again
+      clearPointerContainer(m_regions);
+      m_regions.clear();
+
+      for (p1 = intList.first(); p1; p1 = p1->next())
+        for (p2 = p1->m_strokeList.first(); p2; p2 = p2->next()) {
+          p2->m_edge.m_r = 0;
+          p2->m_visited  = false;
+        }
+    }
+  }
+
   for (p1 = intList.first(); p1; p1 = p1->next()) {
     // Controlla che il punto in questione non sia isolato
     if (p1->m_numInter == 0) continue;
@@ -2921,7 +3325,8 @@ return true;
   advance(it, strokeSize);
   m_strokes.erase(it, m_strokes.end());
 
-  m_areValidRegions = true;
+  m_areValidRegions           = true;
+  m_regionsMatchIntersections = true;
 
 #if defined(_DEBUG)
   checkRegions(m_regions);
@@ -1286,6 +1286,14 @@ void TRegion::moveSubregionsTo(TRegion *r) {
 
 //-----------------------------------------------------------------------------
 
+void TRegion::moveSubregionsTo(std::vector<TRegion *> &regions) {
+  regions.insert(regions.end(), m_imp->m_includedRegionArray.begin(),
+                 m_imp->m_includedRegionArray.end());
+  m_imp->m_includedRegionArray.clear();
+}
+
+//-----------------------------------------------------------------------------
+
 void TRegion::Imp::printContains(const TPointD &p) const {
   std::ofstream of("C:\\temp\\region.txt");
 
@@ -5,10 +5,10 @@
 #include "tstrokeoutline.h"
 #include "tcurves.h"
 #include "tbezier.h"
-#include "tzerofinder.h"
 #include "tcurveutil.h"
 #include "cornerdetector.h"
 
+#include <cstdlib>
 #include <limits>
 
 #include "tstroke.h"
@@ -504,33 +504,9 @@ typedef TBackInserterPointer<TThickQuadratic, QuadStrokeChunkArray>
 
 //---------------------------------------------------------------------------
 
-/*!
-  simple adapter for find zero algorithm
-  */
-struct computeOffset_ {
-  TQuadraticLengthEvaluator m_lengthEval;
-  double m_offset;
-
-  computeOffset_(const TThickQuadratic *ttq, double offset)
-      : m_lengthEval(*ttq), m_offset(offset) {}
-
-  double operator()(double par) {
-    return m_lengthEval.getLengthAt(par) - m_offset;
-  }
-};
-
-//---------------------------------------------------------------------------
-
-/*!
-  simple adapter for find zero algorithm
-  */
-struct computeSpeed_ {
-  const TThickQuadratic *ref_;
-
-  computeSpeed_(const TThickQuadratic *ref) : ref_(ref) {}
-
-  double operator()(double par) { return norm(ref_->getSpeed(par)); }
-};
+//! Number of lengths sampled along each chunk, to seed the lookup of the
+//! parameter at a given length.
+const int lengthSamplesCount = 8;
 
 //---------------------------------------------------------------------------
 }  // end of unnamed namespace
@@ -569,6 +545,15 @@ struct TStroke::Imp {
   //! This vector contains length computed for  each control point of stroke.
   DoubleArray m_partialLengthArray;
 
+  //! This vector contains, for each chunk, its length up to regular steps of
+  //! its parameter (lengthSamplesCount values, the last being the whole
+  //! chunk's).
+  DoubleArray m_chunkLengthSamples;
+
+  //! Whether lookups start from the length samples, or search the whole chunk.
+  //! Setting TOONZ_STROKE_NO_LENGTH_SAMPLES disables them, for comparison.
+  bool m_useLengthSamples;
+
   //! This vector contains parameter computed for each control point of stroke.
   DoubleArray m_parameterValueAtControlPoint;
 
@@ -663,6 +648,21 @@ false ->  ok
 */
   bool retrieveChunkAndItsParamameterAtLength(double s, int &chunk, double &t);
 
+  /*!
+Same as retrieveChunkAndItsParamameterAtLength(), for each of the specified
+lengths. Consecutive lengths in increasing order are cheaper to retrieve.
+*/
+  void retrieveChunksAndParametersAtLength(const std::vector<double> &lengths,
+                                           std::vector<int> &chunks,
+                                           std::vector<double> &ts);
+
+  /*!
+Retrieves the parameter t at which the specified chunk reaches length s,
+given an evaluator set to the chunk.
+*/
+  double getTAtChunkLength(int chunk, double s,
+                           const TQuadraticLengthEvaluator &lengthEval);
+
   /*!
 Retrieve chunk which contains the n-th control point of stroke.
 If control point is between two chunks return the left point.
@@ -743,6 +743,7 @@ void TStroke::Imp::init() {
   m_isValidLength              = false;
   m_isOutlineValid             = false;
   m_areDisabledComputeOfCaches = false;
+  m_useLengthSamples           = true;
   m_selfLoop                   = false;
   m_averageThickness           = 0;
   m_maxThickness               = -1;
@@ -791,6 +792,8 @@ void TStroke::Imp::swapGeometry(Imp &other) throw() {
   std::swap(m_areDisabledComputeOfCaches, other.m_areDisabledComputeOfCaches);
   std::swap(m_bBox, other.m_bBox);
   std::swap(m_partialLengthArray, other.m_partialLengthArray);
+  std::swap(m_chunkLengthSamples, other.m_chunkLengthSamples);
+  std::swap(m_useLengthSamples, other.m_useLengthSamples);
   std::swap(m_parameterValueAtControlPoint,
             other.m_parameterValueAtControlPoint);
   std::swap(m_centerLineArray, other.m_centerLineArray);
@@ -821,9 +824,11 @@ void TStroke::Imp::computeCacheVector() {
                                   (std::numeric_limits<double>::max)());
 
       m_partialLengthArray[0] = 0.0;
+      m_chunkLengthSamples.resize(getChunkCount() * lengthSamplesCount);
+      m_useLengthSamples = !std::getenv("TOONZ_STROKE_NO_LENGTH_SAMPLES");
 
       double length = 0.0;
-      int j         = 0;
+      int j = 0, k, h = 0;
       const TThickQuadratic *tq;
 
       TQuadraticLengthEvaluator lengthEvaluator;
@@ -832,9 +837,15 @@ void TStroke::Imp::computeCacheVector() {
         assert(j <= getControlPointCount());
         tq = getChunk(i);
         lengthEvaluator.setQuad(*tq);
+
+        for (k = 1; k <= lengthSamplesCount; ++k)
+          m_chunkLengthSamples[h++] =
+              lengthEvaluator.getLengthAt(k / (double)lengthSamplesCount);
+
         m_partialLengthArray[j++] = length;
-        m_partialLengthArray[j++] = length + lengthEvaluator.getLengthAt(0.5);
-        length += lengthEvaluator.getLengthAt(1.0);
+        m_partialLengthArray[j++] =
+            length + m_chunkLengthSamples[h - lengthSamplesCount / 2 - 1];
+        length += m_chunkLengthSamples[h - 1];
       }
 
       m_partialLengthArray[j++] = length;
@@ -958,22 +969,8 @@ bool TStroke::Imp::retrieveChunkAndItsParamameterAtLength(double s, int &chunk,
                         : s - m_partialLengthArray[chunk * 2];
 
     // cerco il parametro minimo a meno di una tolleranza epsilon
-
-    const double tol = TConsts::epsilon * 0.1;
-    int err;
-
-    computeOffset_ op(getChunk(chunk), offset);
-    computeSpeed_ op2(getChunk(chunk));
-
-    if (!findZero_Newton(0.0, 1.0, op, op2, tol, tol, 100, t, err))
-      t = -1;  // if can not find a good value set parameter to error value
-
-    // se l'algoritmo di ricerca ha fallito fissa il valore ad uno dei due
-    // estremi
-    if (t == -1) {
-      if (s <= m_partialLengthArray[controlPointOffset]) t = 0.0;
-      t                                                    = 1.0;
-    }
+    TQuadraticLengthEvaluator lengthEval(*getChunk(chunk));
+    t = getTAtChunkLength(chunk, offset, lengthEval);
 
     return false;
   }
@@ -991,6 +988,117 @@ bool TStroke::Imp::retrieveChunkAndItsParamameterAtLength(double s, int &chunk,
 
 //-----------------------------------------------------------------------------
 
+double TStroke::Imp::getTAtChunkLength(
+    int chunk, double s, const TQuadraticLengthEvaluator &lengthEval) {
+  const double *samples = &m_chunkLengthSamples[chunk * lengthSamplesCount];
+
+  if (s <= 0.0) return 0.0;
+  if (s >= samples[lengthSamplesCount - 1]) return 1.0;
+
+  double t0 = 0.0, t1 = 1.0, s0 = 0.0, s1 = samples[lengthSamplesCount - 1];
+  if (m_useLengthSamples) {
+    // Bracket s between two length samples
+    int k =
+        std::upper_bound(samples, samples + lengthSamplesCount, s) - samples;
+
+    t0 = k / (double)lengthSamplesCount;
+    t1 = (k + 1) / (double)lengthSamplesCount;
+    s0 = k ? samples[k - 1] : 0.0, s1 = samples[k];
+  }
+
+  // Newton iterations from the linear guess, bisecting whenever they would
+  // leave the bracket
+  const TThickQuadratic *tq = getChunk(chunk);
+  const double tol          = TConsts::epsilon * 0.1;
+
+  double t = t0 + (t1 - t0) * (s - s0) / (s1 - s0), f, speed, tNext;
+
+  for (int i = 0; i < 100; ++i) {
+    f = lengthEval.getLengthAt(t) - s;
+    if (fabs(f) < tol) break;
+
+    if (f > 0)
+      t1 = t;
+    else
+      t0 = t;
+
+    speed = norm(tq->getSpeed(t));
+    tNext = (speed > 1e-2) ? t - f / speed : t0;
+    if (tNext <= t0 || tNext >= t1) tNext = 0.5 * (t0 + t1);
+
+    if (fabs(tNext - t) < tol) {
+      t = tNext;
+      break;
+    }
+
+    t = tNext;
+  }
+
+  return t;
+}
+
+//-----------------------------------------------------------------------------
+
+void TStroke::Imp::retrieveChunksAndParametersAtLength(
+    const std::vector<double> &lengths, std::vector<int> &chunks,
+    std::vector<double> &ts) {
+  computeCacheVector();
+
+  int i, count = lengths.size(), chunkCount = getChunkCount();
+  chunks.resize(count);
+  ts.resize(count);
+
+  if (chunkCount == 0) {
+    std::fill(chunks.begin(), chunks.end(), 0);
+    std::fill(ts.begin(), ts.end(), 0.0);
+    return;
+  }
+
+  double totalLength = m_partialLengthArray.back();
+
+  // The current chunk's data is kept until a length falls out of it
+  int chunk = -1, c;
+  double chunkStart = 0.0, chunkEnd = -1.0;
+  TQuadraticLengthEvaluator lengthEval;
+
+  for (i = 0; i < count; ++i) {
+    double s = lengths[i];
+
+    if (s <= 0.0) {
+      chunks[i] = 0, ts[i] = 0.0;
+      continue;
+    }
+    if (s >= totalLength) {
+      chunks[i] = chunkCount - 1, ts[i] = 1.0;
+      continue;
+    }
+
+    if (s < chunkStart || s >= chunkEnd) {
+      if (chunk >= 0 && s >= chunkEnd) {
+        // Walk forward - the common case
+        for (c = chunk + 1;
+             c < chunkCount - 1 && m_partialLengthArray[2 * c + 2] <= s; ++c)
+          ;
+      } else {
+        c = std::upper_bound(m_partialLengthArray.begin(),
+                             m_partialLengthArray.end(), s) -
+            m_partialLengthArray.begin();
+        c = (c - 1) >> 1;
+      }
+
+      chunk      = c;
+      chunkStart = m_partialLengthArray[2 * c];
+      chunkEnd   = m_partialLengthArray[2 * c + 2];
+      lengthEval.setQuad(*getChunk(c));
+    }
+
+    chunks[i] = chunk;
+    ts[i]     = getTAtChunkLength(chunk, s - chunkStart, lengthEval);
+  }
+}
+
+//-----------------------------------------------------------------------------
+
 bool TStroke::getChunkAndT(double w, int &chunk, double &t) const {
   return m_imp->retrieveChunkAndItsParamameter(w, chunk, t);
 }
@@ -1242,6 +1350,8 @@ TStroke::TStroke(const TStroke &other)
   copy(other.m_imp->m_partialLengthArray.begin(),
        other.m_imp->m_partialLengthArray.end(),
        back_inserter<DoubleArray>(m_imp->m_partialLengthArray));
+  m_imp->m_chunkLengthSamples = other.m_imp->m_chunkLengthSamples;
+  m_imp->m_useLengthSamples   = other.m_imp->m_useLengthSamples;
   copy(other.m_imp->m_parameterValueAtControlPoint.begin(),
        other.m_imp->m_parameterValueAtControlPoint.end(),
        back_inserter<DoubleArray>(m_imp->m_parameterValueAtControlPoint));
@@ -1957,6 +2067,25 @@ TThickPoint TStroke::getThickPointAtLength(double s) const {
 
 //-----------------------------------------------------------------------------
 
+void TStroke::getThickPointsAtLength(const std::vector<double> &lengths,
+                                     std::vector<TThickPoint> &points) const {
+  assert(!m_imp->m_centerLineArray.empty());
+
+  std::vector<int> chunks;
+  std::vector<double> ts;
+  m_imp->retrieveChunksAndParametersAtLength(lengths, chunks, ts);
+
+  int i, count = lengths.size();
+  points.resize(count);
+
+  if (m_imp->m_centerLineArray.empty()) return;
+
+  for (i = 0; i < count; ++i)
+    points[i] = getChunk(chunks[i])->getThickPoint(ts[i]);
+}
+
+//-----------------------------------------------------------------------------
+
 TThickPoint TStroke::getThickPoint(double w) const {
   assert(!m_imp->m_centerLineArray.empty());
 
@@ -1999,6 +2128,25 @@ double TStroke::getParameterAtLength(double s) const {
 
 //-----------------------------------------------------------------------------
 
+void TStroke::getParametersAtLength(const std::vector<double> &lengths,
+                                    std::vector<double> &ws) const {
+  std::vector<int> chunks;
+  std::vector<double> ts;
+  m_imp->retrieveChunksAndParametersAtLength(lengths, chunks, ts);
+
+  int i, count = lengths.size();
+  ws.assign(count, 0.0);
+
+  if (m_imp->m_centerLineArray.empty()) return;
+
+  for (i = 0; i < count; ++i) {
+    DoublePair p = m_imp->retrieveParametersFromChunk(chunks[i]);
+    ws[i]        = proportion(p.second, ts[i], 1.0, p.first);
+  }
+}
+
+//-----------------------------------------------------------------------------
+
 double TStroke::getParameterAtControlPoint(int n) const {
   double out = -1;
 
@@ -2455,12 +2603,17 @@ TThickPoint TStroke::getCentroid() const {
   double step           = totalLen * 0.1;
   double len            = 0;
   if (step > 10.0) step = 10.0;
-  int count             = 0;
+
+  std::vector<double> lengths;
+  for (; len <= totalLen; len += step) lengths.push_back(len);
+
+  std::vector<TThickPoint> points;
+  getThickPointsAtLength(lengths, points);
+
   TThickPoint point;
-  for (; len <= totalLen; len += step) {
-    count++;
-    point += getThickPointAtLength(len);
-  }
+  int i, count = points.size();
+  for (i = 0; i < count; ++i) point += points[i];
+
   return point * (1.0 / (double)count);
 }
 
@@ -97,6 +97,8 @@ TVectorImage::Imp::Imp(TVectorImage *vi)
     , m_justLoaded(false)
     , m_insideGroup(TGroupId())
     , m_minimizeEdges(true)
+    , m_localRegionComputing(true)
+    , m_regionsMatchIntersections(false)
 #ifdef NEW_REGION_FILL
     , m_regionFinder(0)
 #endif
@@ -1069,6 +1071,15 @@ void TVectorImage::Imp::notifyChangedStrokes(
   }
 
   QMutexLocker sl(m_mutex);
+
+  // Regions away from the changed strokes are kept, provided they were
+  // computed on the current intersections. They refer to the intersections,
+  // so they must be sorted out before those are erased.
+  bool keepRegions = m_localRegionComputing && m_computeRegions &&
+                     !m_notIntersectingStrokes && m_areValidRegions &&
+                     m_regionsMatchIntersections;
+  if (keepRegions) eraseChangedRegions(strokeIndexArray);
+
   for (i = 0; i < (int)strokeIndexArray.size(); i++)  // ATTENZIONE! non si puo'
                                                       // fare eraseIntersection
                                                       // in questo stesso ciclo
@@ -1095,7 +1106,7 @@ void TVectorImage::Imp::notifyChangedStrokes(
       m_strokes[strokeIndexArray[i]]->m_isNewForFill = true;
   }
 
-  computeRegions();  // m_imp->m_strokes, m_imp->m_regions);
+  computeRegions(keepRegions);  // m_imp->m_strokes, m_imp->m_regions);
 
   for (i = 0; i < (int)strokeIndexArray.size(); i++) {
     transferColors(oldEdgeListArray[i],
@@ -1521,6 +1532,12 @@ void TVectorImage::enableMinimizeEdges(bool enabled) {
 
 //-----------------------------------------------------------------------------
 
+void TVectorImage::enableLocalRegionComputing(bool enabled) {
+  m_imp->m_localRegionComputing = enabled;
+}
+
+//-----------------------------------------------------------------------------
+
 TVectorImageP TVectorImage::splitImage(const std::vector<int> &indices,
                                        bool removeFlag) {
   TVectorImageP out             = new TVectorImage;
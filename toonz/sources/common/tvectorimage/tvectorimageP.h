@@ -131,6 +131,9 @@ public:
   bool m_computedAlmostOnce;
   bool m_justLoaded;
   bool m_minimizeEdges;
+  bool m_localRegionComputing;
+  bool m_regionsMatchIntersections;  //!< Whether m_regions were computed on
+                                     //! the current intersections
   bool m_notIntersectingStrokes, m_computeRegions;
   TGroupId m_insideGroup;
 
@@ -153,7 +156,8 @@ public:
 
   void addStrokeRegionRef(UINT strokeIndex, TRegion *region);
 
-  int computeRegions();
+  int computeRegions(bool keepRegions = false);
+  void eraseChangedRegions(const std::vector<int> &strokeIndexArray);
   void reindexEdges(UINT strokeIndex);
   void reindexEdges(const std::vector<int> &indexes, bool areAdded);
 
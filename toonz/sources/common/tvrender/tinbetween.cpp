@@ -618,10 +618,17 @@ static void sample(const TStroke *stroke, int samplingSize,
   double step     = totalLen * samplingFrequency;
   double len      = 0;
 
+  std::vector<double> lengths(samplingSize - 1);
   for (int p = 0; p < samplingSize - 1; p++) {
-    sampledPoint[p] = stroke->getPointAtLength(len);
+    lengths[p] = len;
     len += step;
   }
+
+  std::vector<TThickPoint> points;
+  stroke->getThickPointsAtLength(lengths, points);
+
+  for (int p = 0; p < samplingSize - 1; p++)
+    sampledPoint[p] = convert(points[p]);
   sampledPoint.back() =
       stroke->getControlPoint(stroke->getControlPointCount() - 1);
 }
@@ -126,7 +126,7 @@ void OutlineRegionProp::computeRegionOutline() {
   int subRegionNumber = getRegion()->getSubregionCount();
   TRegionOutline::PointVector app;
 
-  m_outline.m_exterior.clear();
+  m_outline.clear();
 
   computeOutline(getRegion(), app, m_pixelSize);
   m_outline.m_doAntialiasing = true;
@@ -12,18 +12,11 @@
 
 //#include "tlevel_io.h"
 
-#ifndef _WIN32
-#define CALLBACK
-#endif
-// To avoid linking problems with HP ZX2000
-#if defined(LINUX) || defined(FREEBSD)
-#ifdef GLU_VERSION_1_2
-#undef GLU_VERSION_1_2
-#endif
-#ifndef GLU_VERSION_1_1
-#define GLU_VERSION_1_1
-#endif
-#endif
+// STD includes
+#include <algorithm>
+#include <deque>
+#include <limits>
+
 //==================================================================
 
 #ifndef checkErrorsByGL
@@ -40,248 +33,719 @@
   }
 #endif
 
-TglTessellator::GLTess::GLTess() {
-  m_tess = gluNewTess();
-  assert(m_tess);
+//==================================================================
+
+namespace {
+
+//! A contour vertex in the ear clipping lists.
+struct Node {
+  const T3DPointD *m_p;  //!< The original vertex
+  double x, y;
+
+  Node *m_prev, *m_next;  //!< Contour links
+
+  int m_z;                  //!< Z-order index of the vertex
+  Node *m_prevZ, *m_nextZ;  //!< Z-order links
+
+  bool m_steiner;
+
+  Node(const T3DPointD *p)
+      : m_p(p)
+      , x(p->x)
+      , y(p->y)
+      , m_prev(0)
+      , m_next(0)
+      , m_z(0)
+      , m_prevZ(0)
+      , m_nextZ(0)
+      , m_steiner(false) {}
+};
+
+//-------------------------------------------------------------------
+
+/*!
+  Triangulates a polygon with holes by ear clipping, after the earcut
+  algorithm: holes are bridged to the exterior contour, then ears are cut
+  off the resulting single contour. Contours touching or slightly crossing
+  themselves - as region outlines often do near stroke joins - are handled by
+  curing local self-intersections and, as a last resort, by splitting the
+  contour along a diagonal.
+
+  All the state lives in the instance, so distinct instances may run
+  concurrently.
+*/
+class EarClipper {
+  std::deque<Node> m_nodes;  //!< Node storage (addresses must not change)
+  TRegionOutline::PointVector &m_triangles;
+
+  bool m_hashing;  //!< Whether ears are looked up through z-order
+  double m_minX, m_minY, m_invSize;
+
+public:
+  EarClipper(TRegionOutline::PointVector &triangles)
+      : m_triangles(triangles)
+      , m_hashing(false)
+      , m_minX(0)
+      , m_minY(0)
+      , m_invSize(0) {}
+
+  void triangulate(const TRegionOutline::PointVector &exterior,
+                   const std::vector<const TRegionOutline::PointVector *>
+                       &interior);
+
+private:
+  Node *insertNode(const T3DPointD *p, Node *last);
+  void removeNode(Node *p);
+  Node *linkedList(const TRegionOutline::PointVector &points, bool clockwise);
+  Node *filterPoints(Node *start, Node *end = 0);
+  Node *splitPolygon(Node *a, Node *b);
+
+  Node *eliminateHoles(
+      const std::vector<const TRegionOutline::PointVector *> &interior,
+      Node *outerNode);
+  Node *findHoleBridge(Node *hole, Node *outerNode);
+
+  void earcutLinked(Node *ear, int pass = 0);
+  bool isEar(Node *ear) const;
+  bool isEarHashed(Node *ear) const;
+  Node *cureLocalIntersections(Node *start);
+  void splitEarcut(Node *start);
+
+  int zOrder(double x, double y) const;
+  void indexCurve(Node *start) const;
+
+  void addTriangle(const Node *a, const Node *b, const Node *c) {
+    m_triangles.push_back(*a->m_p);
+    m_triangles.push_back(*b->m_p);
+    m_triangles.push_back(*c->m_p);
+  }
+};
+
+//-------------------------------------------------------------------
+
+inline double area(const Node *p, const Node *q, const Node *r) {
+  return (q->y - p->y) * (r->x - q->x) - (q->x - p->x) * (r->y - q->y);
 }
 
-//------------------------------------------------------------------
+inline bool equals(const Node *a, const Node *b) {
+  return a->x == b->x && a->y == b->y;
+}
 
-TglTessellator::GLTess::~GLTess() { gluDeleteTess(m_tess); }
+inline int sign(double val) { return (0.0 < val) - (val < 0.0); }
 
-//==================================================================
+//-------------------------------------------------------------------
 
-namespace {
+inline bool pointInTriangle(double ax, double ay, double bx, double by,
+                            double cx, double cy, double px, double py) {
+  return (cx - px) * (ay - py) >= (ax - px) * (cy - py) &&
+         (ax - px) * (by - py) >= (bx - px) * (ay - py) &&
+         (bx - px) * (cy - py) >= (cx - px) * (by - py);
+}
 
-extern "C" {
-static void CALLBACK tessellateTexture(const GLdouble *tex) {
-  double u = tex[0] * 0.01;
-  double v = tex[1] * 0.01;
-  glTexCoord2d(u, v);
-  glVertex2dv(tex);
+//-------------------------------------------------------------------
+
+//! Tells whether q lies in the bounding box of the pr segment.
+inline bool onSegment(const Node *p, const Node *q, const Node *r) {
+  return q->x <= std::max(p->x, r->x) && q->x >= std::min(p->x, r->x) &&
+         q->y <= std::max(p->y, r->y) && q->y >= std::min(p->y, r->y);
 }
+
+//-------------------------------------------------------------------
+
+bool intersects(const Node *p1, const Node *q1, const Node *p2,
+                const Node *q2) {
+  int o1 = sign(area(p1, q1, p2)), o2 = sign(area(p1, q1, q2)),
+      o3 = sign(area(p2, q2, p1)), o4 = sign(area(p2, q2, q1));
+
+  if (o1 != o2 && o3 != o4) return true;
+
+  // Collinear cases
+  return (o1 == 0 && onSegment(p1, p2, q1)) ||
+         (o2 == 0 && onSegment(p1, q2, q1)) ||
+         (o3 == 0 && onSegment(p2, p1, q2)) ||
+         (o4 == 0 && onSegment(p2, q1, q2));
 }
 
 //-------------------------------------------------------------------
 
-TThread::Mutex CombineDataGuard;
+//! Tells whether the ab diagonal intersects any edge of a's contour.
+bool intersectsPolygon(const Node *a, const Node *b) {
+  const Node *p = a;
+  do {
+    if (p->m_p != a->m_p && p->m_next->m_p != a->m_p && p->m_p != b->m_p &&
+        p->m_next->m_p != b->m_p && intersects(p, p->m_next, a, b))
+      return true;
+    p = p->m_next;
+  } while (p != a);
+
+  return false;
+}
+
+//-------------------------------------------------------------------
 
-static std::list<GLdouble *> Combine_data;
+//! Tells whether the ab diagonal starts inside the contour at a.
+inline bool locallyInside(const Node *a, const Node *b) {
+  return area(a->m_prev, a, a->m_next) < 0
+             ? area(a, b, a->m_next) >= 0 && area(a, a->m_prev, b) >= 0
+             : area(a, b, a->m_prev) < 0 || area(a, a->m_next, b) < 0;
+}
+
+//-------------------------------------------------------------------
+
+//! Tells whether the middle point of the ab diagonal is inside the contour.
+bool middleInside(const Node *a, const Node *b) {
+  const Node *p = a;
+  bool inside   = false;
+  double px = (a->x + b->x) * 0.5, py = (a->y + b->y) * 0.5;
+  do {
+    if (((p->y > py) != (p->m_next->y > py)) && p->m_next->y != p->y &&
+        (px < (p->m_next->x - p->x) * (py - p->y) / (p->m_next->y - p->y) +
+                  p->x))
+      inside = !inside;
+    p = p->m_next;
+  } while (p != a);
+
+  return inside;
+}
+
+//-------------------------------------------------------------------
+
+bool isValidDiagonal(const Node *a, const Node *b) {
+  return a->m_next->m_p != b->m_p && a->m_prev->m_p != b->m_p &&
+         !intersectsPolygon(a, b) &&
+         ((locallyInside(a, b) && locallyInside(b, a) && middleInside(a, b) &&
+           (area(a->m_prev, a, b->m_prev) != 0.0 ||
+            area(a, b->m_prev, b) != 0.0)) ||
+          (equals(a, b) && area(a->m_prev, a, a->m_next) > 0 &&
+           area(b->m_prev, b, b->m_next) > 0));
+}
+
+//-------------------------------------------------------------------
+
+inline bool sectorContainsSector(const Node *m, const Node *p) {
+  return area(m->m_prev, m, p->m_prev) < 0 && area(p->m_next, m, m->m_next) < 0;
+}
+
+//-------------------------------------------------------------------
 
-extern "C" {
-static void CALLBACK myCombine(GLdouble coords[3], GLdouble *d[4], GLfloat w[4],
-                               GLdouble **dataOut) {
-  GLdouble *newCoords = new GLdouble[3];
+Node *getLeftmost(Node *start) {
+  Node *p = start, *leftmost = start;
+  do {
+    if (p->x < leftmost->x || (p->x == leftmost->x && p->y < leftmost->y))
+      leftmost = p;
+    p = p->m_next;
+  } while (p != start);
 
-  newCoords[0] = coords[0];
-  newCoords[1] = coords[1];
-  newCoords[2] = coords[2];
-  Combine_data.push_back(newCoords);
-  *dataOut = newCoords;
+  return leftmost;
 }
+
+//-------------------------------------------------------------------
+
+//! Sorts a z-linked list by z-order (Simon Tatham's merge sort).
+Node *sortLinked(Node *list) {
+  Node *p, *q, *e, *tail;
+  int i, numMerges, pSize, qSize, inSize = 1;
+
+  for (;;) {
+    p    = list;
+    list = tail = 0;
+    numMerges   = 0;
+
+    while (p) {
+      ++numMerges;
+      q     = p;
+      pSize = 0;
+      for (i = 0; i < inSize; ++i) {
+        ++pSize;
+        q = q->m_nextZ;
+        if (!q) break;
+      }
+      qSize = inSize;
+
+      while (pSize > 0 || (qSize > 0 && q)) {
+        if (pSize == 0) {
+          e = q, q = q->m_nextZ, --qSize;
+        } else if (qSize == 0 || !q) {
+          e = p, p = p->m_nextZ, --pSize;
+        } else if (p->m_z <= q->m_z) {
+          e = p, p = p->m_nextZ, --pSize;
+        } else {
+          e = q, q = q->m_nextZ, --qSize;
+        }
+
+        if (tail)
+          tail->m_nextZ = e;
+        else
+          list = e;
+
+        e->m_prevZ = tail;
+        tail       = e;
+      }
+
+      p = q;
+    }
+
+    tail->m_nextZ = 0;
+    if (numMerges <= 1) return list;
+
+    inSize *= 2;
+  }
 }
 
 //===================================================================
 
-// typedef std::vector<T3DPointD>::iterator Vect3D_iter;
+Node *EarClipper::insertNode(const T3DPointD *p, Node *last) {
+  m_nodes.push_back(Node(p));
+  Node *node = &m_nodes.back();
+
+  if (!last)
+    node->m_prev = node->m_next = node;
+  else {
+    node->m_next          = last->m_next;
+    node->m_prev          = last;
+    last->m_next->m_prev = node;
+    last->m_next          = node;
+  }
+
+  return node;
+}
 
 //-------------------------------------------------------------------
+
+void EarClipper::removeNode(Node *p) {
+  p->m_next->m_prev = p->m_prev;
+  p->m_prev->m_next = p->m_next;
+
+  if (p->m_prevZ) p->m_prevZ->m_nextZ = p->m_nextZ;
+  if (p->m_nextZ) p->m_nextZ->m_prevZ = p->m_prevZ;
 }
 
 //-------------------------------------------------------------------
 
-#ifdef _WIN32
-typedef GLvoid(CALLBACK *GluCallback)(void);
-#endif
+//! Links the points in a circular list, with the specified orientation.
+Node *EarClipper::linkedList(const TRegionOutline::PointVector &points,
+                             bool clockwise) {
+  int i, j, count = points.size();
+  if (count == 0) return 0;
 
-#if defined(MACOSX) || defined(LINUX) || defined(FREEBSD) || defined(HAIKU)
+  double sum = 0;
+  for (i = 0, j = count - 1; i < count; j = i++)
+    sum += (points[j].x - points[i].x) * (points[i].y + points[j].y);
 
-typedef GLvoid (*GluCallback)();
+  Node *last = 0;
+  if (clockwise == (sum > 0))
+    for (i = 0; i < count; ++i) last = insertNode(&points[i], last);
+  else
+    for (i = count - 1; i >= 0; --i) last = insertNode(&points[i], last);
 
-#endif
+  if (equals(last, last->m_next)) {
+    removeNode(last);
+    last = last->m_next;
+  }
 
-void TglTessellator::doTessellate(GLTess &glTess, const TColorFunction *cf,
-                                  const bool antiAliasing,
-                                  TRegionOutline outline, const TAffine &aff) {
-  QMutexLocker sl(&CombineDataGuard);
+  return last;
+}
 
-  Combine_data.clear();
-  assert(glTess.m_tess);
+//-------------------------------------------------------------------
 
-  gluTessCallback(glTess.m_tess, GLU_TESS_BEGIN, (GluCallback)glBegin);
-  gluTessCallback(glTess.m_tess, GLU_TESS_END, (GluCallback)glEnd);
+//! Removes duplicate and collinear points.
+Node *EarClipper::filterPoints(Node *start, Node *end) {
+  if (!start) return start;
+  if (!end) end = start;
+
+  Node *p = start;
+  bool again;
+  do {
+    again = false;
+
+    if (!p->m_steiner &&
+        (equals(p, p->m_next) || area(p->m_prev, p, p->m_next) == 0)) {
+      removeNode(p);
+      p = end = p->m_prev;
+      if (p == p->m_next) break;
+      again = true;
+    } else
+      p = p->m_next;
+  } while (again || p != end);
+
+  return end;
+}
 
-  gluTessCallback(glTess.m_tess, GLU_TESS_COMBINE, (GluCallback)myCombine);
+//-------------------------------------------------------------------
 
-#ifdef GLU_VERSION_1_2
-  gluTessBeginPolygon(glTess.m_tess, NULL);
-  gluTessProperty(glTess.m_tess, GLU_TESS_WINDING_RULE,
-                  GLU_TESS_WINDING_POSITIVE);
-#else
-#ifdef GLU_VERSION_1_1
-  gluBeginPolygon(glTess.m_tess);
-#else
-  assert(false);
-#endif
-#endif
+/*!
+  Links a to b with a diagonal. The contour is split in two: a's one now
+  continues to b, while the returned node starts the other one.
+*/
+Node *EarClipper::splitPolygon(Node *a, Node *b) {
+  m_nodes.push_back(Node(a->m_p));
+  Node *a2 = &m_nodes.back();
+  m_nodes.push_back(Node(b->m_p));
+  Node *b2 = &m_nodes.back();
 
-  for (TRegionOutline::Boundary::iterator poly_it = outline.m_exterior.begin();
-       poly_it != outline.m_exterior.end(); ++poly_it) {
-#ifdef GLU_VERSION_1_2
-    gluTessBeginContour(glTess.m_tess);
-#else
-#ifdef GLU_VERSION_1_1
-    gluNextContour(glTess.m_tess, GLU_EXTERIOR);
-#else
-    assert(false);
-#endif
-#endif
+  Node *an = a->m_next, *bp = b->m_prev;
 
-    for (TRegionOutline::PointVector::iterator it = poly_it->begin();
-         it != poly_it->end(); ++it) {
-      // T3DPointD p = *it;
-      it->x = aff.a11 * it->x + aff.a12 * it->y;
-      it->y = aff.a21 * it->x + aff.a22 * it->y;
+  a->m_next = b, b->m_prev = a;
+  a2->m_next = an, an->m_prev = a2;
+  b2->m_next = a2, a2->m_prev = b2;
+  bp->m_next = b2, b2->m_prev = bp;
 
-      gluTessVertex(glTess.m_tess, &(it->x), &(it->x));
-    }
-#ifdef GLU_VERSION_1_2
-    gluTessEndContour(glTess.m_tess);
-#endif
+  return b2;
+}
+
+//-------------------------------------------------------------------
+
+//! Links every hole to the exterior contour, from left to right.
+Node *EarClipper::eliminateHoles(
+    const std::vector<const TRegionOutline::PointVector *> &interior,
+    Node *outerNode) {
+  std::vector<Node *> queue;
+
+  int h, hCount = interior.size();
+  for (h = 0; h < hCount; ++h) {
+    Node *list = linkedList(*interior[h], false);
+    if (!list) continue;
+
+    if (list == list->m_next) list->m_steiner = true;
+    queue.push_back(getLeftmost(list));
   }
 
-  int subRegionNumber = outline.m_interior.size();
-  if (subRegionNumber > 0) {
-    for (TRegionOutline::Boundary::iterator poly_it =
-             outline.m_interior.begin();
-         poly_it != outline.m_interior.end(); ++poly_it) {
-#ifdef GLU_VERSION_1_2
-      gluTessBeginContour(glTess.m_tess);
-#else
-#ifdef GLU_VERSION_1_1
-      gluNextContour(glTess.m_tess, GLU_INTERIOR);
-#else
-      assert(false);
-#endif
-#endif
+  struct locals {
+    static bool isLefter(const Node *a, const Node *b) { return a->x < b->x; }
+  };
+
+  std::sort(queue.begin(), queue.end(), locals::isLefter);
+
+  for (h = 0; h < (int)queue.size(); ++h) {
+    Node *bridge = findHoleBridge(queue[h], outerNode);
+    if (!bridge) continue;
+
+    Node *bridgeReverse = splitPolygon(bridge, queue[h]);
+    filterPoints(bridgeReverse, bridgeReverse->m_next);
+    outerNode = filterPoints(bridge, bridge->m_next);
+  }
+
+  return outerNode;
+}
+
+//-------------------------------------------------------------------
+
+//! Finds an exterior node visible from the hole's leftmost one.
+Node *EarClipper::findHoleBridge(Node *hole, Node *outerNode) {
+  Node *p = outerNode, *m = 0;
+  double hx = hole->x, hy = hole->y;
+  double qx = -(std::numeric_limits<double>::max)();
+
+  // Find the nearest segment crossed by a ray from the hole to the left. Its
+  // endpoint with lesser x will be the candidate.
+  do {
+    if (hy <= p->y && hy >= p->m_next->y && p->m_next->y != p->y) {
+      double x =
+          p->x + (hy - p->y) * (p->m_next->x - p->x) / (p->m_next->y - p->y);
+      if (x <= hx && x > qx) {
+        qx = x;
+        m  = p->x < p->m_next->x ? p : p->m_next;
+        if (x == hx) return m;  // The hole touches the segment
+      }
+    }
+    p = p->m_next;
+  } while (p != outerNode);
+
+  if (!m) return 0;
+
+  // Points inside the triangle formed by the hole node, the ray intersection
+  // and the candidate would hide the latter. Pick among them the one of
+  // minimum angle with the ray.
+  const Node *stop = m;
+  double tanMin    = (std::numeric_limits<double>::max)(), tanCur;
+  double mx = m->x, my = m->y;
+
+  p = m;
+  do {
+    if (hx >= p->x && p->x >= mx && hx != p->x &&
+        pointInTriangle(hy < my ? hx : qx, hy, mx, my, hy < my ? qx : hx, hy,
+                        p->x, p->y)) {
+      tanCur = std::abs(hy - p->y) / (hx - p->x);
+
+      if (locallyInside(p, hole) &&
+          (tanCur < tanMin ||
+           (tanCur == tanMin &&
+            (p->x > m->x || sectorContainsSector(m, p))))) {
+        m      = p;
+        tanMin = tanCur;
+      }
+    }
+    p = p->m_next;
+  } while (p != stop);
+
+  return m;
+}
+
+//-------------------------------------------------------------------
+
+int EarClipper::zOrder(double x_, double y_) const {
+  // Coordinates are mapped to the 15-bit integer range, then interleaved
+  int x = int((x_ - m_minX) * m_invSize), y = int((y_ - m_minY) * m_invSize);
+
+  x = (x | (x << 8)) & 0x00FF00FF;
+  x = (x | (x << 4)) & 0x0F0F0F0F;
+  x = (x | (x << 2)) & 0x33333333;
+  x = (x | (x << 1)) & 0x55555555;
+
+  y = (y | (y << 8)) & 0x00FF00FF;
+  y = (y | (y << 4)) & 0x0F0F0F0F;
+  y = (y | (y << 2)) & 0x33333333;
+  y = (y | (y << 1)) & 0x55555555;
+
+  return x | (y << 1);
+}
+
+//-------------------------------------------------------------------
 
-      for (TRegionOutline::PointVector::reverse_iterator rit =
-               poly_it->rbegin();
-           rit != poly_it->rend(); ++rit) {
-        // T3DPointD p = *rit;
-        rit->x = aff.a11 * rit->x + aff.a12 * rit->y;
-        rit->y = aff.a21 * rit->x + aff.a22 * rit->y;
-        gluTessVertex(glTess.m_tess, &(rit->x), &(rit->x));
+void EarClipper::indexCurve(Node *start) const {
+  Node *p = start;
+  do {
+    if (!p->m_z) p->m_z = zOrder(p->x, p->y);
+    p->m_prevZ = p->m_prev;
+    p->m_nextZ = p->m_next;
+    p          = p->m_next;
+  } while (p != start);
+
+  p->m_prevZ->m_nextZ = 0;
+  p->m_prevZ          = 0;
+
+  sortLinked(p);
+}
+
+//-------------------------------------------------------------------
+
+bool EarClipper::isEar(Node *ear) const {
+  const Node *a = ear->m_prev, *b = ear, *c = ear->m_next;
+  if (area(a, b, c) >= 0) return false;  // Reflex
+
+  // No other vertex may lie inside the ear
+  for (const Node *p = c->m_next; p != a; p = p->m_next)
+    if (pointInTriangle(a->x, a->y, b->x, b->y, c->x, c->y, p->x, p->y) &&
+        area(p->m_prev, p, p->m_next) >= 0)
+      return false;
+
+  return true;
+}
+
+//-------------------------------------------------------------------
+
+bool EarClipper::isEarHashed(Node *ear) const {
+  const Node *a = ear->m_prev, *b = ear, *c = ear->m_next;
+  if (area(a, b, c) >= 0) return false;  // Reflex
+
+  // Only vertices whose z-order falls in the ear's bbox range are checked
+  int minZ = zOrder(std::min(a->x, std::min(b->x, c->x)),
+                    std::min(a->y, std::min(b->y, c->y)));
+  int maxZ = zOrder(std::max(a->x, std::max(b->x, c->x)),
+                    std::max(a->y, std::max(b->y, c->y)));
+
+  const Node *p;
+  for (p = ear->m_nextZ; p && p->m_z <= maxZ; p = p->m_nextZ)
+    if (p != a && p != c &&
+        pointInTriangle(a->x, a->y, b->x, b->y, c->x, c->y, p->x, p->y) &&
+        area(p->m_prev, p, p->m_next) >= 0)
+      return false;
+
+  for (p = ear->m_prevZ; p && p->m_z >= minZ; p = p->m_prevZ)
+    if (p != a && p != c &&
+        pointInTriangle(a->x, a->y, b->x, b->y, c->x, c->y, p->x, p->y) &&
+        area(p->m_prev, p, p->m_next) >= 0)
+      return false;
+
+  return true;
+}
+
+//-------------------------------------------------------------------
+
+//! Cuts off the triangles at small self-intersections, where the edge
+//! before a node crosses the one after its next.
+Node *EarClipper::cureLocalIntersections(Node *start) {
+  Node *p = start;
+  do {
+    Node *a = p->m_prev, *b = p->m_next->m_next;
+
+    if (!equals(a, b) && intersects(a, p, p->m_next, b) &&
+        locallyInside(a, b) && locallyInside(b, a)) {
+      addTriangle(a, p, b);
+
+      removeNode(p);
+      removeNode(p->m_next);
+      p = start = b;
+    }
+    p = p->m_next;
+  } while (p != start);
+
+  return filterPoints(p);
+}
+
+//-------------------------------------------------------------------
+
+//! Splits the contour along a valid diagonal, and triangulates both halves.
+void EarClipper::splitEarcut(Node *start) {
+  Node *a = start;
+  do {
+    for (Node *b = a->m_next->m_next; b != a->m_prev; b = b->m_next) {
+      if (a->m_p != b->m_p && isValidDiagonal(a, b)) {
+        Node *c = splitPolygon(a, b);
+
+        a = filterPoints(a, a->m_next);
+        c = filterPoints(c, c->m_next);
+
+        earcutLinked(a);
+        earcutLinked(c);
+        return;
       }
+    }
+    a = a->m_next;
+  } while (a != start);
+}
 
-#ifdef GLU_VERSION_1_2
-      gluTessEndContour(glTess.m_tess);
-#endif
+//-------------------------------------------------------------------
+
+/*!
+  Cuts ears off the contour until it is exhausted. When no ear can be found,
+  the contour is first cleaned of degenerate points (pass 1), then of local
+  self-intersections (pass 2), and finally split in two.
+*/
+void EarClipper::earcutLinked(Node *ear, int pass) {
+  if (!ear) return;
+
+  if (!pass && m_hashing) indexCurve(ear);
+
+  Node *stop = ear, *prev, *next;
+  while (ear->m_prev != ear->m_next) {
+    prev = ear->m_prev, next = ear->m_next;
+
+    if (m_hashing ? isEarHashed(ear) : isEar(ear)) {
+      addTriangle(prev, ear, next);
+      removeNode(ear);
+
+      // Skipping the next vertex leads to less sliver triangles
+      ear = stop = next->m_next;
+      continue;
+    }
+
+    ear = next;
+
+    if (ear == stop) {
+      if (pass == 0)
+        earcutLinked(filterPoints(ear), 1);
+      else if (pass == 1)
+        earcutLinked(cureLocalIntersections(filterPoints(ear)), 2);
+      else
+        splitEarcut(ear);
+
+      break;
     }
   }
+}
 
-#ifdef GLU_VERSION_1_2
-  gluTessEndPolygon(glTess.m_tess);
-#else
-#ifdef GLU_VERSION_1_1
-  gluEndPolygon(glTess.m_tess);
-#else
-  assert(false);
-#endif
-#endif
+//-------------------------------------------------------------------
+
+void EarClipper::triangulate(
+    const TRegionOutline::PointVector &exterior,
+    const std::vector<const TRegionOutline::PointVector *> &interior) {
+  Node *outerNode = linkedList(exterior, true);
+  if (!outerNode || outerNode->m_next == outerNode->m_prev) return;
+
+  if (!interior.empty()) outerNode = eliminateHoles(interior, outerNode);
+
+  // Bigger polygons look up ear candidates through a z-order curve
+  int i, pointsCount = exterior.size();
+  m_hashing = (pointsCount > 80);
+  if (m_hashing) {
+    double maxX = m_minX = exterior[0].x, maxY = m_minY = exterior[0].y;
+    for (i = 1; i < pointsCount; ++i) {
+      const T3DPointD &p = exterior[i];
+      m_minX = std::min(m_minX, p.x), maxX = std::max(maxX, p.x);
+      m_minY = std::min(m_minY, p.y), maxY = std::max(maxY, p.y);
+    }
 
-  std::list<GLdouble *>::iterator beginIt, endIt;
-  endIt   = Combine_data.end();
-  beginIt = Combine_data.begin();
-  for (; beginIt != endIt; ++beginIt) delete[](*beginIt);
+    double size = std::max(maxX - m_minX, maxY - m_minY);
+    m_invSize   = (size != 0) ? 32767.0 / size : 0.0;
+  }
+
+  earcutLinked(outerNode);
 }
 
-void TglTessellator::doTessellate(GLTess &glTess, const TColorFunction *cf,
-                                  const bool antiAliasing,
-                                  TRegionOutline &outline) {
-  QMutexLocker sl(&CombineDataGuard);
+//-------------------------------------------------------------------
 
-  Combine_data.clear();
-  assert(glTess.m_tess);
+//! Tells whether p lies inside the polygon, by the even-odd rule.
+bool isInside(const TRegionOutline::PointVector &polygon, const T3DPointD &p) {
+  bool inside = false;
 
-  gluTessCallback(glTess.m_tess, GLU_TESS_BEGIN, (GluCallback)glBegin);
-  gluTessCallback(glTess.m_tess, GLU_TESS_END, (GluCallback)glEnd);
+  int i, j, count = polygon.size();
+  for (i = 0, j = count - 1; i < count; j = i++) {
+    const T3DPointD &a = polygon[i], &b = polygon[j];
+    if ((a.y > p.y) != (b.y > p.y) &&
+        p.x < (b.x - a.x) * (p.y - a.y) / (b.y - a.y) + a.x)
+      inside = !inside;
+  }
 
-  gluTessCallback(glTess.m_tess, GLU_TESS_COMBINE, (GluCallback)myCombine);
+  return inside;
+}
 
-#ifdef GLU_VERSION_1_2
-  gluTessBeginPolygon(glTess.m_tess, NULL);
-  gluTessProperty(glTess.m_tess, GLU_TESS_WINDING_RULE,
-                  GLU_TESS_WINDING_POSITIVE);
-#else
-#ifdef GLU_VERSION_1_1
-  gluBeginPolygon(glTess.m_tess);
-#else
-  assert(false);
-#endif
-#endif
+}  // namespace
 
-  for (TRegionOutline::Boundary::iterator poly_it = outline.m_exterior.begin();
-       poly_it != outline.m_exterior.end(); ++poly_it) {
-#ifdef GLU_VERSION_1_2
-    gluTessBeginContour(glTess.m_tess);
-#else
-#ifdef GLU_VERSION_1_1
-    gluNextContour(glTess.m_tess, GLU_EXTERIOR);
-#else
-    assert(false);
-#endif
-#endif
+//==================================================================
 
-    for (TRegionOutline::PointVector::iterator it = poly_it->begin();
-         it != poly_it->end(); ++it)
-      gluTessVertex(glTess.m_tess, &(it->x), &(it->x));
+void TTessellator::triangulate(TRegionOutline &outline) {
+  if (outline.m_trianglesValid) return;
 
-#ifdef GLU_VERSION_1_2
-    gluTessEndContour(glTess.m_tess);
-#endif
-  }
+  outline.m_triangles.clear();
 
-  int subRegionNumber = outline.m_interior.size();
-  if (subRegionNumber > 0) {
-    for (TRegionOutline::Boundary::iterator poly_it =
-             outline.m_interior.begin();
-         poly_it != outline.m_interior.end(); ++poly_it) {
-#ifdef GLU_VERSION_1_2
-      gluTessBeginContour(glTess.m_tess);
-#else
-#ifdef GLU_VERSION_1_1
-      gluNextContour(glTess.m_tess, GLU_INTERIOR);
-#else
-      assert(false);
-#endif
-#endif
+  // Each hole goes with the first exterior contour containing it - or the
+  // last one
+  int e, eCount = outline.m_exterior.size();
+  std::vector<std::vector<const TRegionOutline::PointVector *>> holes(eCount);
 
-      for (TRegionOutline::PointVector::reverse_iterator rit =
-               poly_it->rbegin();
-           rit != poly_it->rend(); ++rit)
-        gluTessVertex(glTess.m_tess, &(rit->x), &(rit->x));
+  if (eCount > 0) {
+    TRegionOutline::Boundary::const_iterator it,
+        end = outline.m_interior.end();
+    for (it = outline.m_interior.begin(); it != end; ++it) {
+      if (it->empty()) continue;
 
-#ifdef GLU_VERSION_1_2
-      gluTessEndContour(glTess.m_tess);
-#endif
+      for (e = 0; e < eCount - 1; ++e)
+        if (isInside(outline.m_exterior[e], it->front())) break;
+
+      holes[e].push_back(&*it);
     }
   }
 
-#ifdef GLU_VERSION_1_2
-  gluTessEndPolygon(glTess.m_tess);
-#else
-#ifdef GLU_VERSION_1_1
-  gluEndPolygon(glTess.m_tess);
-#else
-  assert(false);
-#endif
-#endif
+  for (e = 0; e < eCount; ++e) {
+    EarClipper clipper(outline.m_triangles);
+    clipper.triangulate(outline.m_exterior[e], holes[e]);
+  }
+
+  outline.m_trianglesValid = true;
+}
+
+//==================================================================
+
+void TglTessellator::drawTriangles(const TRegionOutline &outline,
+                                   bool textured) {
+  if (outline.m_triangles.empty()) return;
+
+  static const int stride = sizeof(T3DPointD);
+  const GLdouble *vertices = &outline.m_triangles[0].x;
+
+  glEnableClientState(GL_VERTEX_ARRAY);
+  glVertexPointer(3, GL_DOUBLE, stride, vertices);
+
+  if (textured) {
+    glEnableClientState(GL_TEXTURE_COORD_ARRAY);
+    glTexCoordPointer(2, GL_DOUBLE, stride, vertices);
+  }
+
+  glDrawArrays(GL_TRIANGLES, 0, outline.m_triangles.size());
 
-  std::list<GLdouble *>::iterator beginIt, endIt;
-  endIt   = Combine_data.end();
-  beginIt = Combine_data.begin();
-  for (; beginIt != endIt; ++beginIt) delete[](*beginIt);
+  if (textured) glDisableClientState(GL_TEXTURE_COORD_ARRAY);
+  glDisableClientState(GL_VERTEX_ARRAY);
 }
 
 //------------------------------------------------------------------
@@ -301,56 +765,36 @@ void TglTessellator::tessellate(const TColorFunction *cf,
     tglEnableLineSmooth();
   }
 
-  TglTessellator::GLTess glTess;
-  gluTessCallback(glTess.m_tess, GLU_TESS_VERTEX, (GluCallback)glVertex3dv);
-
   //------------------------//
-  doTessellate(glTess, cf, antiAliasing, outline);
+  triangulate(outline);
+  drawTriangles(outline, false);
   //------------------------//
 
   if (antiAliasing && outline.m_doAntialiasing) {
     tglEnableLineSmooth();
 
+    static const int stride = sizeof(T3DPointD);
+    glEnableClientState(GL_VERTEX_ARRAY);
+
     for (TRegionOutline::Boundary::iterator poly_it =
              outline.m_exterior.begin();
          poly_it != outline.m_exterior.end(); ++poly_it) {
-      std::vector<GLdouble> v;
-      if (poly_it->size() == 0) continue;
-      v.resize(poly_it->size() * 2);
-      int i = 0;
-      for (TRegionOutline::PointVector::iterator it = poly_it->begin();
-           it != poly_it->end(); ++it) {
-        v[i++] = it->x;
-        v[i++] = it->y;
-      }
+      if (poly_it->empty()) continue;
 
-      glEnableClientState(GL_VERTEX_ARRAY);
-
-      glVertexPointer(2, GL_DOUBLE, sizeof(GLdouble) * 2, &v[0]);
-      glDrawArrays(GL_LINE_LOOP, 0, v.size() / 2);
-
-      glDisableClientState(GL_VERTEX_ARRAY);
+      glVertexPointer(3, GL_DOUBLE, stride, &(*poly_it)[0].x);
+      glDrawArrays(GL_LINE_LOOP, 0, poly_it->size());
     }
 
     for (TRegionOutline::Boundary::iterator poly_it =
              outline.m_interior.begin();
          poly_it != outline.m_interior.end(); ++poly_it) {
-      std::vector<GLdouble> v;
-      v.resize(poly_it->size() * 2);
-      int i = 0;
-      for (TRegionOutline::PointVector::iterator it = poly_it->begin();
-           it != poly_it->end(); ++it) {
-        v[i++] = it->x;
-        v[i++] = it->y;
-      }
-      if (v.empty()) continue;
-      glEnableClientState(GL_VERTEX_ARRAY);
+      if (poly_it->empty()) continue;
 
-      glVertexPointer(2, GL_DOUBLE, sizeof(GLdouble) * 2, &v[0]);
-      glDrawArrays(GL_LINE_LOOP, 0, v.size() / 2);
-
-      glDisableClientState(GL_VERTEX_ARRAY);
+      glVertexPointer(3, GL_DOUBLE, stride, &(*poly_it)[0].x);
+      glDrawArrays(GL_LINE_LOOP, 0, poly_it->size());
     }
+
+    glDisableClientState(GL_VERTEX_ARRAY);
   }
 }
 
@@ -377,8 +821,6 @@ void TglTessellator::tessellate(const TColorFunction *cf,
     TRop::resample(r, texture,
                    aff.place(texture->getCenterD(), r->getCenterD()));
     texture = r;
-    glPushMatrix();
-    tglMultMatrix(aff.inv());
   }
 
   // If GL_BRGA isn't present make a proper texture to use (... obsolete?)
@@ -420,20 +862,26 @@ void TglTessellator::tessellate(const TColorFunction *cf,
   texture->unlock();
   if (texImage != texture) texImage->unlock();
 
-  TglTessellator::GLTess glTess;
-  gluTessCallback(glTess.m_tess, GLU_TESS_VERTEX,
-                  (GluCallback)tessellateTexture);
+  // Texture coordinates are the vertex ones, scaled through the texture
+  // matrix - so that cached triangles can be used as they are
+  glMatrixMode(GL_TEXTURE);
+  glPushMatrix();
+  glLoadIdentity();
+  glScaled(0.01, 0.01, 1.0);
+  if (aff != TAffine()) tglMultMatrix(aff);
+  glMatrixMode(GL_MODELVIEW);
   checkErrorsByGL;
 
   //------------------------//
-  if (aff != TAffine())
-    doTessellate(glTess, cf, antiAliasing, outline,
-                 aff);  // Tessellate & render
-  else
-    doTessellate(glTess, cf, antiAliasing, outline);  // Tessellate & render
+  triangulate(outline);
+  drawTriangles(outline, true);  // Render
   checkErrorsByGL;
   //------------------------//
-  if (aff != TAffine()) glPopMatrix();
+
+  glMatrixMode(GL_TEXTURE);
+  glPopMatrix();
+  glMatrixMode(GL_MODELVIEW);
+
   glDeleteTextures(1, &texId);  // Delete & unbind texture
   checkErrorsByGL;
   glDisable(GL_TEXTURE_2D);
@@ -442,6 +890,4 @@ void TglTessellator::tessellate(const TColorFunction *cf,
 
 //------------------------------------------------------------------
 
-// TglTessellator::GLTess TglTessellator::m_glTess;
-
 //=============================================================================
@@ -0,0 +1,544 @@
+
+
+// TnzCore includes
+#include "tvectorimage.h"
+#include "tvectorrenderdata.h"
+#include "tregion.h"
+#include "tstroke.h"
+#include "tstrokeoutline.h"
+#include "tpalette.h"
+#include "tcolorfunctions.h"
+#include "tsimplecolorstyles.h"
+#include "tthreadmessage.h"
+#include "drawutil.h"
+
+// STD includes
+#include <algorithm>
+#include <cmath>
+#include <typeinfo>
+#include <vector>
+
+#include "tvectorrasterizer.h"
+
+//****************************************************************************************
+//    Local namespace stuff
+//****************************************************************************************
+
+namespace {
+
+//! Returns whether the style is a TSolidColorStyle - not one of the styles
+//! derived from it, which are not plain solid colors.
+bool isSolidColor(const TColorStyle *style) {
+  return typeid(*style) == typeid(TSolidColorStyle);
+}
+
+//-----------------------------------------------------------------------------
+
+bool isOThick(const TStroke *s) {
+  int i;
+  for (i = 0; i < s->getControlPointCount(); i++)
+    if (s->getControlPoint(i).thick != 0) return false;
+  return true;
+}
+
+//-----------------------------------------------------------------------------
+
+bool isVisible(const TColorStyle *style, const TColorFunction *cf) {
+  int j, colorCount = style->getColorParamCount();
+  if (colorCount == 0) return true;  // for example texture
+
+  for (j = 0; j < colorCount; ++j) {
+    TPixel32 color = style->getColorParamValue(j);
+    if (cf) color = (*cf)(color);
+    if (color.m != 0) return true;
+  }
+
+  return false;
+}
+
+//-----------------------------------------------------------------------------
+
+double signedArea(const std::vector<TPointD> &polygon) {
+  double area = 0.0;
+
+  int i, n = polygon.size();
+  for (i = 0; i < n; ++i) {
+    const TPointD &p = polygon[i], &q = polygon[(i + 1) % n];
+    area += p.x * q.y - q.x * p.y;
+  }
+
+  return 0.5 * area;
+}
+
+//=============================================================================
+
+//! Accumulates the signed area covered by polygons in each pixel of a raster
+//! rect.
+/*!
+    Each polygon edge adds, to the pixels it crosses, the area between the
+    edge and the pixel's right side - so that summing the accumulated values
+    along a row yields the exact coverage of each pixel. Counter-clockwise
+    polygons add positive coverage, clockwise ones subtract it.
+    \n\n
+    Edges need not be clipped to the rect: the parts on its left are
+    projected on the rect's left side, and the others are discarded.
+*/
+class CoverageBuffer {
+  TRect m_rect;  //!< The covered rect, in raster pixels
+  int m_wrap;
+  std::vector<float> m_buffer;
+
+public:
+  CoverageBuffer(const TRect &rect)
+      : m_rect(rect)
+      , m_wrap(rect.getLx() + 2)
+      , m_buffer(m_wrap * rect.getLy(), 0.0f) {}
+
+  //! Adds an edge, in raster coordinates.
+  void addLine(const TPointD &p0, const TPointD &p1) {
+    TPointD origin(m_rect.x0, m_rect.y0);
+    addClippedLine(p0 - origin, p1 - origin);
+  }
+
+  void addPolygon(const std::vector<TPointD> &polygon, bool hole);
+  void addTriangle(const TPointD &a, const TPointD &b, const TPointD &c);
+
+  //! Composites the specified color over the raster, in the accumulated
+  //! coverage.
+  void over(const TRaster32P &ras, const TPixel32 &color,
+            bool antialias) const;
+
+private:
+  void addClippedLine(TPointD p0, TPointD p1);
+  void accumulate(TPointD p0, TPointD p1);
+};
+
+//-----------------------------------------------------------------------------
+
+void CoverageBuffer::addPolygon(const std::vector<TPointD> &polygon,
+                                bool hole) {
+  int i, n = polygon.size();
+  if (n < 3) return;
+
+  // Holes subtract coverage - whatever the polygon orientation
+  double area = signedArea(polygon);
+  bool reverse = hole ? area > 0 : area < 0;
+
+  for (i = 0; i < n; ++i) {
+    const TPointD &p = polygon[i], &q = polygon[(i + 1) % n];
+    if (reverse)
+      addLine(q, p);
+    else
+      addLine(p, q);
+  }
+}
+
+//-----------------------------------------------------------------------------
+
+void CoverageBuffer::addTriangle(const TPointD &a, const TPointD &b,
+                                 const TPointD &c) {
+  double area = cross(b - a, c - a);
+  if (area > 0)
+    addLine(a, b), addLine(b, c), addLine(c, a);
+  else if (area < 0)
+    addLine(a, c), addLine(c, b), addLine(b, a);
+}
+
+//-----------------------------------------------------------------------------
+
+void CoverageBuffer::addClippedLine(TPointD p0, TPointD p1) {
+  double lx = m_rect.getLx();
+
+  // Split the line where it crosses the rect's sides
+  double t[4] = {0.0, 0.0, 0.0, 1.0};
+  int i, count = 1;
+
+  if (p0.x != p1.x) {
+    double s0 = (0 - p0.x) / (p1.x - p0.x), s1 = (lx - p0.x) / (p1.x - p0.x);
+    if (0.0 < s0 && s0 < 1.0) t[count++] = s0;
+    if (0.0 < s1 && s1 < 1.0) t[count++] = s1;
+    if (count == 3 && t[1] > t[2]) std::swap(t[1], t[2]);
+  }
+  t[count] = 1.0;
+
+  TPointD d(p1 - p0);
+  for (i = 0; i < count; ++i) {
+    TPointD q0(p0 + t[i] * d), q1(p0 + t[i + 1] * d);
+
+    double xm = 0.5 * (q0.x + q1.x);
+    if (xm > lx) continue;
+
+    if (xm < 0)
+      q0.x = q1.x = 0;  // Left parts cover whole pixels
+    else {
+      q0.x = tcrop(q0.x, 0.0, lx);
+      q1.x = tcrop(q1.x, 0.0, lx);
+    }
+
+    accumulate(q0, q1);
+  }
+}
+
+//-----------------------------------------------------------------------------
+
+void CoverageBuffer::accumulate(TPointD p0, TPointD p1) {
+  if (p0.y == p1.y) return;
+
+  // Descending edges enter counter-clockwise polygons from the left
+  double dir = -1.0;
+  if (p0.y > p1.y) std::swap(p0, p1), dir = 1.0;
+
+  double lx = m_rect.getLx(), dxdy = (p1.x - p0.x) / (p1.y - p0.y);
+
+  double x = p0.x;
+  if (p0.y < 0) x -= p0.y * dxdy;
+
+  int y, y0 = std::max((int)std::floor(p0.y), 0),
+         y1 = std::min((int)std::ceil(p1.y), m_rect.getLy());
+
+  for (y = y0; y < y1; ++y) {
+    float *row = &m_buffer[y * m_wrap];
+
+    double dy    = std::min(y + 1.0, p1.y) - std::max((double)y, p0.y);
+    double xNext = x + dxdy * dy;
+    double d     = dy * dir;
+
+    double xa = std::max(std::min(x, xNext), 0.0),
+           xb = std::min(std::max(x, xNext), lx);
+    double xaFloor = std::floor(xa), xbCeil = std::ceil(xb);
+    int xai = (int)xaFloor, xbi = (int)xbCeil;
+
+    if (xbi <= xai + 1) {
+      // The edge crosses a single pixel
+      double xm = 0.5 * (xa + xb) - xaFloor;
+      row[xai] += d - d * xm;
+      row[xai + 1] += d * xm;
+    } else {
+      double s   = 1.0 / (xb - xa);
+      double xaf = xa - xaFloor, xbf = xb - xbCeil + 1.0;
+      double a0 = 0.5 * s * (1.0 - xaf) * (1.0 - xaf), am = 0.5 * s * xbf * xbf;
+
+      row[xai] += d * a0;
+
+      if (xbi == xai + 2)
+        row[xai + 1] += d * (1.0 - a0 - am);
+      else {
+        double a1 = s * (1.5 - xaf);
+        row[xai + 1] += d * (a1 - a0);
+
+        int xi;
+        for (xi = xai + 2; xi < xbi - 1; ++xi) row[xi] += d * s;
+
+        double a2 = a1 + (xbi - xai - 3) * s;
+        row[xbi - 1] += d * (1.0 - a2 - am);
+      }
+
+      row[xbi] += d * am;
+    }
+
+    x = xNext;
+  }
+}
+
+//-----------------------------------------------------------------------------
+
+void CoverageBuffer::over(const TRaster32P &ras, const TPixel32 &color,
+                          bool antialias) const {
+  int x, y, lx = m_rect.getLx(), ly = m_rect.getLy();
+
+  for (y = 0; y < ly; ++y) {
+    const float *row = &m_buffer[y * m_wrap];
+    TPixel32 *pix    = ras->pixels(m_rect.y0 + y) + m_rect.x0;
+
+    float coverage = 0.0f;
+    for (x = 0; x < lx; ++x, ++pix) {
+      coverage += row[x];
+
+      float c = std::min(coverage, 1.0f);
+      if (!antialias) c = (c >= 0.5f) ? 1.0f : 0.0f;
+
+      int m = (int)(c * color.m + 0.5f);
+      if (m <= 0) continue;
+
+      // Straight color over premultiplied pixels
+      int im = 255 - m;
+      pix->r = (color.r * m + pix->r * im + 127) / 255;
+      pix->g = (color.g * m + pix->g * im + 127) / 255;
+      pix->b = (color.b * m + pix->b * im + 127) / 255;
+      pix->m = m + (pix->m * im + 127) / 255;
+    }
+  }
+}
+
+//=============================================================================
+
+class VectorRasterizer {
+  TRaster32P m_ras;
+  const TVectorRenderData &m_rd;
+  const TVectorImage *m_vim;
+
+  double m_pixelSize;
+
+public:
+  VectorRasterizer(const TRaster32P &ras, const TVectorRenderData &rd,
+                   const TVectorImage *vim)
+      : m_ras(ras), m_rd(rd), m_vim(vim) {
+    double det = fabs(rd.m_aff.det());
+    m_pixelSize = (det > 0) ? 1.0 / sqrt(det) : 1.0;
+  }
+
+  bool isSupported() const;
+  void draw();
+
+private:
+  const TColorStyle *getStyle(int styleId) const {
+    return m_rd.m_palette->getStyle(styleId);
+  }
+
+  bool isSupported(const TRegion *r) const;
+  bool isSupported(const TStroke *s) const;
+
+  bool mustDraw(const TRegion *r, const TColorStyle *style) const;
+  bool mustDraw(const TStroke *s, const TColorStyle *style) const;
+
+  bool getRect(const TRectD &bbox, TRect &rect) const;
+  TPixel32 getColor(const TColorStyle *style) const;
+
+  void addRegionBoundary(CoverageBuffer &buffer, const TRegion *r,
+                         bool hole) const;
+
+  void draw(const TRegion *r);
+  void draw(const TStroke *s);
+};
+
+//-----------------------------------------------------------------------------
+
+bool VectorRasterizer::mustDraw(const TRegion *r,
+                                const TColorStyle *style) const {
+  // See tglDraw(const TVectorRenderData &, TRegion *, bool)
+  return r->getStyle() != 0 && isVisible(style, m_rd.m_cf) &&
+         style->isRegionStyle() && style->isEnabled();
+}
+
+//-----------------------------------------------------------------------------
+
+bool VectorRasterizer::mustDraw(const TStroke *s,
+                                const TColorStyle *style) const {
+  // See tglDraw(const TVectorRenderData &, const TStroke *, bool)
+  if (!isVisible(style, m_rd.m_cf)) return false;
+
+  if (!m_rd.m_show0ThickStrokes && isOThick(s) && isSolidColor(style))
+    return false;
+
+  return style->isStrokeStyle() && style->isEnabled();
+}
+
+//-----------------------------------------------------------------------------
+
+bool VectorRasterizer::isSupported(const TRegion *r) const {
+  const TColorStyle *style = getStyle(r->getStyle());
+  if (mustDraw(r, style)) {
+    if (!isSolidColor(style)) return false;
+
+    const TOutlineStyle *outlineStyle =
+        static_cast<const TOutlineStyle *>(style);
+    if (outlineStyle->getRegionOutlineModifier()) return false;
+  }
+
+  UINT i, subregionsCount = r->getSubregionCount();
+  for (i = 0; i < subregionsCount; ++i)
+    if (!isSupported(r->getSubregion(i))) return false;
+
+  return true;
+}
+
+//-----------------------------------------------------------------------------
+
+bool VectorRasterizer::isSupported(const TStroke *s) const {
+  const TColorStyle *style = getStyle(s->getStyle());
+  if (!mustDraw(s, style)) return true;
+
+  // Centerline strokes are drawn as GL lines
+  return isSolidColor(style) && !s->isCenterLine();
+}
+
+//-----------------------------------------------------------------------------
+
+bool VectorRasterizer::isSupported() const {
+  // Render data used only on screen
+  if (m_rd.m_inkCheckEnabled || m_rd.m_ink1CheckEnabled ||
+      m_rd.m_paintCheckEnabled || m_rd.m_tcheckEnabled ||
+      m_rd.m_showGuidedDrawing || m_vim->isInsideGroup() > 0)
+    return false;
+
+  UINT i, count;
+  if (m_rd.m_drawRegions)
+    for (i = 0, count = m_vim->getRegionCount(); i < count; ++i)
+      if (!isSupported(m_vim->getRegion(i))) return false;
+
+  for (i = 0, count = m_vim->getStrokeCount(); i < count; ++i)
+    if (!isSupported(m_vim->getStroke(i))) return false;
+
+  return true;
+}
+
+//-----------------------------------------------------------------------------
+
+//! Returns the raster pixels touched by the specified bbox, in image
+//! coordinates.
+bool VectorRasterizer::getRect(const TRectD &bbox, TRect &rect) const {
+  TRectD rectD(m_rd.m_aff * bbox);
+  rectD *= TRectD(0, 0, m_ras->getLx(), m_ras->getLy());
+
+  if (rectD.x0 >= rectD.x1 || rectD.y0 >= rectD.y1) return false;
+
+  // Antialiased borders may exceed the bbox
+  rect = TRect(tfloor(rectD.x0) - 1, tfloor(rectD.y0) - 1, tceil(rectD.x1),
+               tceil(rectD.y1)) *
+         m_ras->getBounds();
+  return true;
+}
+
+//-----------------------------------------------------------------------------
+
+TPixel32 VectorRasterizer::getColor(const TColorStyle *style) const {
+  TPixel32 color = style->getMainColor();
+  return m_rd.m_cf ? (*m_rd.m_cf)(color) : color;
+}
+
+//-----------------------------------------------------------------------------
+
+void VectorRasterizer::addRegionBoundary(CoverageBuffer &buffer,
+                                         const TRegion *r, bool hole) const {
+  std::vector<TPointD> polygon;
+
+  UINT i, edgesCount = r->getEdgeCount();
+  for (i = 0; i < edgesCount; ++i) {
+    const TEdge *edge = r->getEdge(i);
+    if (edge->m_index >= 0 && edge->m_s)
+      stroke2polyline(polygon, *edge->m_s, m_pixelSize, edge->m_w0,
+                      edge->m_w1);
+  }
+
+  std::vector<TPointD>::iterator pt, pEnd = polygon.end();
+  for (pt = polygon.begin(); pt != pEnd; ++pt) *pt = m_rd.m_aff * *pt;
+
+  buffer.addPolygon(polygon, hole);
+}
+
+//-----------------------------------------------------------------------------
+
+void VectorRasterizer::draw(const TRegion *r) {
+  const TColorStyle *style = getStyle(r->getStyle());
+
+  TRect rect;
+  if (mustDraw(r, style) && getRect(r->getBBox(), rect)) {
+    TPixel32 color = getColor(style);
+
+    if (color.m != 0) {
+      CoverageBuffer buffer(rect);
+
+      // Subregions are holes, filled with their own style below
+      addRegionBoundary(buffer, r, false);
+
+      UINT i, subregionsCount = r->getSubregionCount();
+      for (i = 0; i < subregionsCount; ++i)
+        addRegionBoundary(buffer, r->getSubregion(i), true);
+
+      buffer.over(m_ras, color,
+                  m_rd.m_antiAliasing && m_rd.m_regionAntialias);
+    }
+  }
+
+  UINT i, subregionsCount = r->getSubregionCount();
+  for (i = 0; i < subregionsCount; ++i) draw(r->getSubregion(i));
+}
+
+//-----------------------------------------------------------------------------
+
+void VectorRasterizer::draw(const TStroke *s) {
+  const TColorStyle *style = getStyle(s->getStyle());
+
+  TRect rect;
+  if (!mustDraw(s, style) || !getRect(s->getBBox(), rect)) return;
+
+  TPixel32 color = getColor(style);
+  if (color.m == 0) return;
+
+  TStrokeOutline outline;
+  static_cast<const TOutlineStyle *>(style)->computeOutline(
+      s, outline, TOutlineUtil::OutlineParameter());
+
+  const std::vector<TOutlinePoint> &v = outline.getArray();
+
+  // The outline is a quad strip. Its triangles are all added with positive
+  // orientation, so that overlaps at sharp turns are filled just once.
+  CoverageBuffer buffer(rect);
+
+  const TAffine &aff = m_rd.m_aff;
+
+  int i, count = v.size();
+  for (i = 0; i + 3 < count; i += 2) {
+    TPointD a(aff * TPointD(v[i].x, v[i].y)),
+        b(aff * TPointD(v[i + 1].x, v[i + 1].y)),
+        c(aff * TPointD(v[i + 2].x, v[i + 2].y)),
+        d(aff * TPointD(v[i + 3].x, v[i + 3].y));
+
+    buffer.addTriangle(a, b, d);
+    buffer.addTriangle(a, d, c);
+  }
+
+  buffer.over(m_ras, color, m_rd.m_antiAliasing);
+}
+
+//-----------------------------------------------------------------------------
+
+void VectorRasterizer::draw() {
+  // Same drawing order of tglDraw(): each group's regions, then its strokes
+  UINT strokeIndex = 0, strokesCount = m_vim->getStrokeCount();
+
+  while (strokeIndex < strokesCount) {
+    UINT currStrokeIndex = strokeIndex;
+
+    if (m_rd.m_drawRegions) {
+      UINT r, regionsCount = m_vim->getRegionCount();
+      for (r = 0; r < regionsCount; ++r)
+        if (m_vim->sameGroupStrokeAndRegion(currStrokeIndex, r))
+          draw(m_vim->getRegion(r));
+    }
+
+    for (; strokeIndex < strokesCount &&
+           m_vim->sameGroup(strokeIndex, currStrokeIndex);
+         ++strokeIndex)
+      draw(m_vim->getStroke(strokeIndex));
+  }
+}
+
+}  // namespace
+
+//****************************************************************************************
+//    Vector images software rasterization
+//****************************************************************************************
+
+bool rasterizeVectorImage(const TRaster32P &ras, const TVectorRenderData &rd,
+                          const TVectorImage *vim) {
+  assert(ras && vim);
+  if (!ras || !vim) return false;
+
+  QMutexLocker sl(vim->getMutex());
+
+  TVectorRenderData rdAux(rd);
+  if (!rdAux.m_palette) {
+    rdAux.m_palette = vim->getPalette();
+    if (!rdAux.m_palette) return false;
+  }
+
+  VectorRasterizer rasterizer(ras, rdAux, vim);
+  if (!rasterizer.isSupported()) return false;
+
+  ras->lock();
+  rasterizer.draw();
+  ras->unlock();
+
+  return true;
+}
@@ -1,4 +1,6 @@
 #define TINYEXR_USE_MINIZ 0
+// Decode the image chunks in parallel
+#define TINYEXR_USE_THREAD 1
 #include "zlib.h"
 
 #define TINYEXR_OTMOD_IMPLEMENTATION
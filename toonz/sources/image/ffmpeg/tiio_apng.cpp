@@ -61,9 +61,14 @@ TLevelWriterAPng::TLevelWriterAPng(const TFilePath &path, TPropertyGroup *winfo)
 //-----------------------------------------------------------
 
 TLevelWriterAPng::~TLevelWriterAPng() {
-  QStringList preIArgs;
-  QStringList postIArgs;
+  ffmpegWriter->closeFrameStream();
+  ffmpegWriter->cleanUpFiles();
+}
+
+//-----------------------------------------------------------
 
+void TLevelWriterAPng::buildFfmpegArgs(QStringList &preIArgs,
+                                       QStringList &postIArgs) {
   int outLx = m_lx;
   int outLy = m_ly;
 
@@ -84,9 +89,6 @@ TLevelWriterAPng::~TLevelWriterAPng() {
   postIArgs << "apng";
   postIArgs << "-s";
   postIArgs << QString::number(outLx) + "x" + QString::number(outLy);
-
-  ffmpegWriter->runFfmpeg(preIArgs, postIArgs, false, false, true);
-  ffmpegWriter->cleanUpFiles();
 }
 
 //-----------------------------------------------------------
@@ -114,7 +116,13 @@ void TLevelWriterAPng::save(const TImageP &img, int frameIndex) {
   TRasterImageP image(img);
   m_lx = image->getRaster()->getLx();
   m_ly = image->getRaster()->getLy();
-  ffmpegWriter->createIntermediateImage(img, frameIndex);
+  if (!ffmpegWriter->isFrameStreamOpen()) {
+    QStringList preIArgs, postIArgs;
+    buildFfmpegArgs(preIArgs, postIArgs);
+    ffmpegWriter->openFrameStream(preIArgs, postIArgs,
+                                  TDimension(m_lx, m_ly));
+  }
+  ffmpegWriter->writeFrame(img, frameIndex);
 }
 
 //===========================================================
@@ -177,7 +185,7 @@ TLevelReaderAPng::TLevelReaderAPng(const TFilePath &path) : TLevelReader(path) {
 }
 //-----------------------------------------------------------
 
-TLevelReaderAPng::~TLevelReaderAPng() {}
+TLevelReaderAPng::~TLevelReaderAPng() { delete ffmpegReader; }
 
 //-----------------------------------------------------------
 
@@ -205,11 +213,7 @@ TDimension TLevelReaderAPng::getSize() { return m_size; }
 //------------------------------------------------
 
 TImageP TLevelReaderAPng::load(int frameIndex) {
-  if (!ffmpegFramesCreated) {
-    ffmpegReader->getFramesFromMovie();
-    ffmpegFramesCreated = true;
-  }
-  return ffmpegReader->getImage(frameIndex);
+  return ffmpegReader->decodeFrame(frameIndex);
 }
 
 Tiio::APngWriterProperties::APngWriterProperties()
@@ -59,9 +59,14 @@ TLevelWriterFFMov::TLevelWriterFFMov(const TFilePath &path,
 //-----------------------------------------------------------
 
 TLevelWriterFFMov::~TLevelWriterFFMov() {
-  QStringList preIArgs;
-  QStringList postIArgs;
+  ffmpegWriter->closeFrameStream();
+  ffmpegWriter->cleanUpFiles();
+}
+
+//-----------------------------------------------------------
 
+void TLevelWriterFFMov::buildFfmpegArgs(QStringList &preIArgs,
+                                        QStringList &postIArgs) {
   int outLx = m_lx;
   int outLy = m_ly;
 
@@ -95,9 +100,6 @@ TLevelWriterFFMov::~TLevelWriterFFMov() {
   postIArgs << QString::number(outLx) + "x" + QString::number(outLy);
   postIArgs << "-b";
   postIArgs << QString::number(finalBitrate) + "k";
-
-  ffmpegWriter->runFfmpeg(preIArgs, postIArgs, false, false, true);
-  ffmpegWriter->cleanUpFiles();
 }
 
 //-----------------------------------------------------------
@@ -125,7 +127,13 @@ void TLevelWriterFFMov::save(const TImageP &img, int frameIndex) {
   TRasterImageP image(img);
   m_lx = image->getRaster()->getLx();
   m_ly = image->getRaster()->getLy();
-  ffmpegWriter->createIntermediateImage(img, frameIndex);
+  if (!ffmpegWriter->isFrameStreamOpen()) {
+    QStringList preIArgs, postIArgs;
+    buildFfmpegArgs(preIArgs, postIArgs);
+    ffmpegWriter->openFrameStream(preIArgs, postIArgs,
+                                  TDimension(m_lx, m_ly));
+  }
+  ffmpegWriter->writeFrame(img, frameIndex);
 }
 
 //===========================================================
@@ -189,7 +197,7 @@ TLevelReaderFFMov::TLevelReaderFFMov(const TFilePath &path)
 }
 //-----------------------------------------------------------
 
-TLevelReaderFFMov::~TLevelReaderFFMov() {}
+TLevelReaderFFMov::~TLevelReaderFFMov() { delete ffmpegReader; }
 
 //-----------------------------------------------------------
 
@@ -217,11 +225,7 @@ TDimension TLevelReaderFFMov::getSize() { return m_size; }
 //------------------------------------------------
 
 TImageP TLevelReaderFFMov::load(int frameIndex) {
-  if (!ffmpegFramesCreated) {
-    ffmpegReader->getFramesFromMovie();
-    ffmpegFramesCreated = true;
-  }
-  return ffmpegReader->getImage(frameIndex);
+  return ffmpegReader->decodeFrame(frameIndex);
 }
 
 Tiio::FFMovWriterProperties::FFMovWriterProperties()
@@ -31,6 +31,8 @@ public:
   }
 
 private:
+  void buildFfmpegArgs(QStringList &preIArgs, QStringList &postIArgs);
+
   Ffmpeg *ffmpegWriter;
   int m_lx, m_ly;
   int m_scale;
@@ -58,7 +60,6 @@ public:
   TDimension getSize();
 private:
   Ffmpeg *ffmpegReader;
-  bool ffmpegFramesCreated = false;
   TDimension m_size;
   int m_frameCount, m_lx, m_ly;
 };
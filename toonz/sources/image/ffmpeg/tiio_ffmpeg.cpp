@@ -6,6 +6,9 @@
 #include "tsound.h"
 #include "timageinfo.h"
 #include "toonz/stage.h"
+#include "trop.h"
+#include "tmsgcore.h"
+#include "thirdparty.h"
 
 #include <QProcess>
 #include <QEventLoop>
@@ -13,15 +16,23 @@
 #include <QDir>
 #include <QtGui/QImage>
 #include <QRegExp>
-#include "tmsgcore.h"
-#include "thirdparty.h"
+#include <QThread>
+#include <QMutex>
+#include <QWaitCondition>
+
+#include <map>
+#include <list>
+#include <deque>
+#include <limits>
+#include <algorithm>
 
 Ffmpeg::Ffmpeg() {
-  m_ffmpegTimeout      = ThirdParty::getFFmpegTimeout() * 1000;
-  m_intermediateFormat = "png";
-  m_startNumber        = 2147483647;  // Lowest frame determines starting frame
+  m_ffmpegTimeout = ThirdParty::getFFmpegTimeout() * 1000;
+}
+Ffmpeg::~Ffmpeg() {
+  closeFrameStream();
+  delete m_frameDecoder;
 }
-Ffmpeg::~Ffmpeg() {}
 
 bool Ffmpeg::checkFormat(std::string format) {
   static std::string strResults = "";
@@ -58,86 +69,279 @@ void Ffmpeg::setFrameRate(double fps) { m_frameRate = fps; }
 
 void Ffmpeg::setPath(TFilePath path) { m_path = path; }
 
-void Ffmpeg::createIntermediateImage(const TImageP &img, int frameIndex) {
-  m_frameCount++;
-  frameIndex--;  // ffmpeg start at 0 by default
-  if (frameIndex < m_startNumber) m_startNumber = frameIndex;
-  QString tempPath = getFfmpegCache().getQString() + "//" +
-                     QString::fromStdString(m_path.getName()) + "tempOut" +
-                     QString::number(frameIndex) + "." + m_intermediateFormat;
-  std::string saveStatus = "";
-  TRasterImageP tempImage(img);
-  TRasterImage *image = (TRasterImage *)tempImage->cloneImage();
-
-  m_lx           = image->getRaster()->getLx();
-  m_ly           = image->getRaster()->getLy();
-  m_bpp          = image->getRaster()->getPixelSize();
-  int totalBytes = m_lx * m_ly * m_bpp;
-  image->getRaster()->yMirror();
-
-  // lock raster to get data
-  image->getRaster()->lock();
-  void *buffin = image->getRaster()->getRawData();
-  assert(buffin);
-  void *buffer = malloc(totalBytes);
-  memcpy(buffer, buffin, totalBytes);
-
-  image->getRaster()->unlock();
-
-  // create QImage save format
-  QByteArray ba      = m_intermediateFormat.toUpper().toLatin1();
-  const char *format = ba.data();
-
-  QImage *qi = new QImage((uint8_t *)buffer, m_lx, m_ly, QImage::Format_ARGB32);
-  qi->save(tempPath, format, -1);
-  free(buffer);
-  m_cleanUpList.push_back(tempPath);
-
-  delete qi;
-  delete image;
-}
+//===========================================================
+//
+//  FfmpegFrameStream
+//
+//===========================================================
 
-void Ffmpeg::runFfmpeg(QStringList preIArgs, QStringList postIArgs,
-                       bool includesInPath, bool includesOutPath,
-                       bool overWriteFiles, bool asyncProcess) {
-  QString tempName = "//" + QString::fromStdString(m_path.getName()) +
-                     "tempOut%d." + m_intermediateFormat;
-  tempName = getFfmpegCache().getQString() + tempName;
+/*!
+  Worker thread owning the ffmpeg process of a streaming writer. Frames
+  submitted by Ffmpeg::writeFrame() are queued and written in submission
+  order as raw video to ffmpeg's stdin. Callers are responsible for
+  submitting frames in sequence (MovieRenderer waits for a missing frame
+  before saving the following ones); a frame whose index does not follow
+  the previous one is refused, never written out of order.
+
+  Submitters block while the queue is full, so memory stays bounded by
+  \b m_maxPending frames and \b m_maxPendingBytes bytes whatever the
+  encoding speed.
+*/
+
+class FfmpegFrameStream final : public QThread {
+  QStringList m_args;
+  int m_lx, m_ly, m_timeout, m_maxPending;
+  qint64 m_maxPendingBytes;
+
+  mutable QMutex m_mutex;
+  QWaitCondition m_cond;
+  std::deque<TRaster32P> m_pending;
+  qint64 m_pendingBytes;
+  int m_lastFrame;
+  bool m_started, m_closing, m_failed;
+
+  int m_exitCode;
 
-  QStringList args;
-  args = args + preIArgs;
-  if (!includesInPath) {  // NOTE:  if including the in path, it needs to be in
-                          // the preIArgs argument.
-    if (m_startNumber != 0) {
-      args << "-start_number";
-      args << QString::number(m_startNumber);
+public:
+  FfmpegFrameStream(const QStringList &args, int lx, int ly, int timeout)
+      : m_args(args)
+      , m_lx(lx)
+      , m_ly(ly)
+      , m_timeout(timeout)
+      , m_maxPending(std::max(4, 2 * QThread::idealThreadCount()))
+      , m_maxPendingBytes(256 << 20)
+      , m_pendingBytes(0)
+      , m_lastFrame((std::numeric_limits<int>::min)())
+      , m_started(false)
+      , m_closing(false)
+      , m_failed(false)
+      , m_exitCode(0) {}
+
+  //! Queues a frame for encoding. Returns false, without queueing it, if
+  //! \b frameIndex does not follow the previously pushed frame.
+  bool push(int frameIndex, const TRaster32P &ras) {
+    QMutexLocker locker(&m_mutex);
+    if (frameIndex <= m_lastFrame) return false;
+    m_lastFrame = frameIndex;
+
+    // A single frame is always accepted, even if larger than the byte budget
+    while (!m_pending.empty() && !m_failed &&
+           ((int)m_pending.size() >= m_maxPending ||
+            m_pendingBytes >= m_maxPendingBytes))
+      m_cond.wait(&m_mutex);
+    if (m_failed) return true;
+
+    m_pending.push_back(ras);
+    m_pendingBytes += rasterBytes(ras);
+    m_cond.wakeAll();
+    return true;
+  }
+
+  //! Waits for the ffmpeg process to be launched. Returns false if it could
+  //! not be started.
+  bool waitStarted() {
+    QMutexLocker locker(&m_mutex);
+    while (!m_started) m_cond.wait(&m_mutex);
+    return !m_failed;
+  }
+
+  void close() {
+    QMutexLocker locker(&m_mutex);
+    m_closing = true;
+    m_cond.wakeAll();
+  }
+
+  bool failed() const {
+    QMutexLocker locker(&m_mutex);
+    return m_failed;
+  }
+  int exitCode() const { return m_exitCode; }
+
+protected:
+  void run() override {
+    QProcess ffmpeg;
+    // Nobody reads ffmpeg's output while streaming: it must not fill the pipes
+    ffmpeg.setStandardOutputFile(QProcess::nullDevice());
+    ffmpeg.setStandardErrorFile(QProcess::nullDevice());
+    ThirdParty::runFFmpeg(ffmpeg, m_args);
+    if (!ffmpeg.waitForStarted(m_timeout)) setFailed();
+    setStarted();
+
+    TRaster32P ras;
+    while (takeNext(ras)) {
+      if (!writeRaster(ffmpeg, ras)) setFailed();
+      ras = TRaster32P();
+    }
+
+    if (ffmpeg.state() != QProcess::NotRunning) {
+      ffmpeg.closeWriteChannel();
+      if (!ffmpeg.waitForFinished(m_timeout)) {
+        ffmpeg.kill();
+        ffmpeg.waitForFinished();
+        setFailed();
+      }
     }
-    args << "-i";
-    args << tempName;
+    m_exitCode =
+        (ffmpeg.exitStatus() == QProcess::NormalExit) ? ffmpeg.exitCode() : -1;
+  }
+
+private:
+  static qint64 rasterBytes(const TRaster32P &ras) {
+    return (qint64)ras->getLx() * ras->getLy() * sizeof(TPixel32);
+  }
+
+  void setStarted() {
+    QMutexLocker locker(&m_mutex);
+    m_started = true;
+    m_cond.wakeAll();
+  }
+
+  void setFailed() {
+    QMutexLocker locker(&m_mutex);
+    m_failed = true;
+    m_pending.clear();
+    m_pendingBytes = 0;
+    m_cond.wakeAll();
+  }
+
+  //! Waits for the next frame to be encoded. Returns false once the stream
+  //! is closed and drained, or has failed.
+  bool takeNext(TRaster32P &ras) {
+    QMutexLocker locker(&m_mutex);
+    for (;;) {
+      if (m_failed) return false;
+      if (!m_pending.empty()) {
+        ras = m_pending.front();
+        m_pending.pop_front();
+        m_pendingBytes -= rasterBytes(ras);
+        m_cond.wakeAll();
+        return true;
+      } else if (m_closing)
+        return false;
+      m_cond.wait(&m_mutex);
+    }
+  }
+
+  bool writeRaster(QProcess &ffmpeg, const TRaster32P &ras) {
+    // Toonz rasters are stored bottom-up
+    int rowSize = m_lx * sizeof(TPixel32);
+    ras->lock();
+    for (int y = m_ly - 1; y >= 0; --y)
+      ffmpeg.write((const char *)ras->pixels(y), rowSize);
+    ras->unlock();
+
+    // Back-pressure: let ffmpeg consume the frame before accepting the next
+    while (ffmpeg.bytesToWrite() > 0)
+      if (!ffmpeg.waitForBytesWritten(m_timeout)) return false;
+    return true;
   }
+};
+
+//-----------------------------------------------------------
+
+void Ffmpeg::openFrameStream(QStringList preIArgs, QStringList postIArgs,
+                             const TDimension &size) {
+  assert(!m_frameStream);
+
+  m_lx = size.lx;
+  m_ly = size.ly;
+
+#if defined(TNZ_MACHINE_CHANNEL_ORDER_BGRM)
+  const char *pixFmt = "bgra";
+#elif defined(TNZ_MACHINE_CHANNEL_ORDER_MBGR)
+  const char *pixFmt = "abgr";
+#elif defined(TNZ_MACHINE_CHANNEL_ORDER_RGBM)
+  const char *pixFmt = "rgba";
+#else
+  const char *pixFmt = "argb";
+#endif
+
+  QStringList args;
+  args = args + preIArgs;
+  args << "-f" << "rawvideo";
+  args << "-pix_fmt" << pixFmt;
+  args << "-s" << QString::number(m_lx) + "x" + QString::number(m_ly);
+  args << "-i" << "-";
   if (m_hasSoundTrack) args = args + m_audioArgs;
   args = args + postIArgs;
-  if (overWriteFiles && !includesOutPath) {  // if includesOutPath is true, you
-                                             // need to include the overwrite in
-                                             // your postIArgs.
-    args << "-y";
+  args << "-y";
+  args << m_path.getQString();
+
+  m_frameStream = new FfmpegFrameStream(args, m_lx, m_ly, m_ffmpegTimeout);
+  m_frameStream->start();
+  if (!m_frameStream->waitStarted()) {
+    m_frameStream->close();
+    m_frameStream->wait();
+    delete m_frameStream;
+    m_frameStream = 0;
+    throw TImageException(m_path, "unable to start FFmpeg.");
   }
-  if (!includesOutPath) {
-    args << m_path.getQString();
+}
+
+//-----------------------------------------------------------
+
+void Ffmpeg::writeFrame(const TImageP &img, int frameIndex) {
+  if (!m_frameStream)
+    throw TImageException(m_path, "the movie stream is not open.");
+  if (m_frameStream->failed())
+    throw TImageException(m_path, "FFmpeg stopped encoding the movie.");
+
+  TRasterImageP image(img);
+  if (!image)
+    throw TImageException(m_path, "only raster frames can be encoded.");
+  TRasterP ras = image->getRaster();
+  if (ras->getLx() != m_lx || ras->getLy() != m_ly)
+    throw TImageException(m_path, "frame size differs from the movie size.");
+
+  // The caller may reuse its raster: the stream takes its own 32-bit copy
+  TRaster32P ras32 = ras;
+  if (ras32)
+    ras32 = ras32->clone();
+  else {
+    ras32 = TRaster32P(m_lx, m_ly);
+    TRop::convert(ras32, ras);
   }
 
-  // write the file
-  QProcess ffmpeg;
-  ThirdParty::runFFmpeg(ffmpeg, args);
-  if (waitFfmpeg(ffmpeg, asyncProcess)) {
-    QString results = ffmpeg.readAllStandardError();
-    results += ffmpeg.readAllStandardOutput();
-    int exitCode           = ffmpeg.exitCode();
-    std::string strResults = results.toStdString();
+  if (!m_frameStream->push(frameIndex, ras32))
+    throw TImageException(m_path, "frames must be written in sequence.");
+  if (m_frameStream->failed())
+    throw TImageException(m_path, "FFmpeg stopped encoding the movie.");
+  m_frameCount++;
+}
+
+//-----------------------------------------------------------
+
+bool Ffmpeg::closeFrameStream() {
+  if (!m_frameStream) return true;
+
+  // Wait for the encoding to finish without freezing the event loop
+  QEventLoop eloop;
+  QObject::connect(m_frameStream, &QThread::finished, &eloop,
+                   &QEventLoop::quit);
+  m_frameStream->close();
+  if (!m_frameStream->isFinished()) eloop.exec();
+  m_frameStream->wait();
+
+  bool ok = !m_frameStream->failed() && m_frameStream->exitCode() == 0;
+  if (!ok) {
+    if (m_frameStream->failed())
+      DVGui::warning(
+          QObject::tr("FFmpeg timed out.\n"
+                      "Please check the file for errors.\n"
+                      "If the file doesn't play or is incomplete, \n"
+                      "Please try raising the FFmpeg timeout in Preferences."));
+    else
+      DVGui::warning(QObject::tr("FFmpeg returned error-code: %1")
+                         .arg(m_frameStream->exitCode()));
   }
-  ffmpeg.close();
+
+  delete m_frameStream;
+  m_frameStream = 0;
+  return ok;
 }
 
+//-----------------------------------------------------------
+
 QString Ffmpeg::runFfprobe(QStringList args) {
   QProcess ffmpeg;
   ThirdParty::runFFprobe(ffmpeg, args);
@@ -192,8 +396,11 @@ void Ffmpeg::saveSoundTrack(TSoundTrack *st) {
   int bufSize         = st->getSampleCount() * st->getSampleSize();
   const UCHAR *buffer = st->getRawData();
 
-  m_audioPath = getFfmpegCache().getQString() + "//" +
-                QString::fromStdString(m_path.getName()) + "tempOut.raw";
+  // The soundtrack is the only input ffmpeg reads from a file, as its stdin
+  // carries the frames. Name it after the whole output path, so that movies
+  // of the same name rendered in different folders don't share it.
+  m_audioPath =
+      getFfmpegCache().getQString() + "//" + cleanPathSymbols() + "Audio.raw";
   m_audioFormat = ((st->getSampleType() == TSound::FLOAT) ? "f" : "s") +
                   QString::number(m_bitsPerSample);
   if (m_bitsPerSample > 8) m_audioFormat = m_audioFormat + "le";
@@ -221,16 +428,6 @@ void Ffmpeg::saveSoundTrack(TSoundTrack *st) {
   m_cleanUpList.push_back(m_audioPath);
 }
 
-bool Ffmpeg::checkFilesExist() {
-  QString ffmpegCachePath = getFfmpegCache().getQString();
-  QString tempPath = ffmpegCachePath + "//" + cleanPathSymbols() + "In0001." +
-                     m_intermediateFormat;
-  if (TSystem::doesExistFileOrLevel(TFilePath(tempPath))) {
-    return true;
-  } else
-    return false;
-}
-
 ffmpegFileInfo Ffmpeg::getInfo() {
   QString ffmpegCachePath = getFfmpegCache().getQString();
   QString tempPath = ffmpegCachePath + "//" + cleanPathSymbols() + ".txt";
@@ -267,36 +464,6 @@ ffmpegFileInfo Ffmpeg::getInfo() {
   info.m_frameCount = m_frameCount;
   return info;
 }
-TRasterImageP Ffmpeg::getImage(int frameIndex) {
-  QString ffmpegCachePath = getFfmpegCache().getQString();
-  QString tempPath        = ffmpegCachePath + "//" + cleanPathSymbols();
-  std::string tmpPath     = tempPath.toStdString();
-  // QString tempPath= m_path.getQString();
-  QString number   = QString("%1").arg(frameIndex, 4, 10, QChar('0'));
-  QString tempName = "In" + number + ".png";
-  tempName         = tempPath + tempName;
-
-  // for debugging
-  std::string strPath = tempName.toStdString();
-  if (TSystem::doesExistFileOrLevel(TFilePath(tempName))) {
-    QImage *temp = new QImage(tempName, "PNG");
-    if (temp) {
-      QImage tempToo = temp->convertToFormat(QImage::Format_ARGB32);
-      delete temp;
-      const UCHAR *bits = tempToo.bits();
-
-      TRasterPT<TPixelRGBM32> ret;
-      ret.create(m_lx, m_ly);
-      ret->lock();
-      memcpy(ret->getRawData(), bits, m_lx * m_ly * 4);
-      ret->unlock();
-      ret->yMirror();
-      return TRasterImageP(ret);
-    }
-  }
-  return TRasterImageP();
-}
-
 double Ffmpeg::getFrameRate() {
   QStringList fpsArgs;
   int fpsNum = 0, fpsDen = 0;
@@ -404,95 +571,326 @@ int Ffmpeg::getFrameCount() {
   return m_frameCount;
 }
 
-void Ffmpeg::getFramesFromMovie(int frame) {
-  QString ffmpegCachePath = getFfmpegCache().getQString();
-  QString tempPath        = ffmpegCachePath + "//" + cleanPathSymbols();
-  std::string tmpPath     = tempPath.toStdString();
-  QString tempName        = "In%04d." + m_intermediateFormat;
-  tempName                = tempPath + tempName;
-  QString tempStart;
-  if (frame == -1) {
-    tempStart = "In0001." + m_intermediateFormat;
-    tempStart = tempPath + tempStart;
-  } else {
-    QString number = QString("%1").arg(frame, 4, 10, QChar('0'));
-    tempStart      = tempPath + "In" + number + "." + m_intermediateFormat;
-  }
-  QString tempBase = tempPath + "In";
-  QString addToDelete;
-  if (!TSystem::doesExistFileOrLevel(TFilePath(tempStart))) {
-    // for debugging
-    std::string strPath = tempName.toStdString();
-
-    QStringList preIFrameArgs;
-    QStringList postIFrameArgs;
-    // frameArgs << "-accurate_seek";
-    // frameArgs << "-ss";
-    // frameArgs << "0" + QString::number(frameIndex / m_info->m_frameRate);
-
-    // Detect codec from the input file
-    QStringList probeArgs;
-    probeArgs << "-v" << "error"
-              << "-select_streams" << "v:0"
-              << "-show_entries" << "stream=codec_name"
-              << "-of" << "default=noprint_wrappers=1:nokey=1"
-              << m_path.getQString();
-
-    QString codecName = runFfprobe(probeArgs).trimmed();
-
-    // Set decoder based on detected codec
-    if (codecName.contains("vp9", Qt::CaseInsensitive)) {
-      preIFrameArgs << "-vcodec" << "libvpx-vp9";
-    } else if (codecName.contains("vp8", Qt::CaseInsensitive)) {
-      preIFrameArgs << "-vcodec" << "libvpx";
-    } else if (codecName.contains("av1", Qt::CaseInsensitive)) {
-      preIFrameArgs << "-vcodec" << "libaom-av1";
+QStringList Ffmpeg::getDecoderArgs() {
+  QStringList decoderArgs;
+
+  // Detect codec from the input file
+  QStringList probeArgs;
+  probeArgs << "-v" << "error"
+            << "-select_streams" << "v:0"
+            << "-show_entries" << "stream=codec_name"
+            << "-of" << "default=noprint_wrappers=1:nokey=1"
+            << m_path.getQString();
+
+  QString codecName = runFfprobe(probeArgs).trimmed();
+
+  // Set decoder based on detected codec
+  if (codecName.contains("vp9", Qt::CaseInsensitive)) {
+    decoderArgs << "-vcodec" << "libvpx-vp9";
+  } else if (codecName.contains("vp8", Qt::CaseInsensitive)) {
+    decoderArgs << "-vcodec" << "libvpx";
+  } else if (codecName.contains("av1", Qt::CaseInsensitive)) {
+    decoderArgs << "-vcodec" << "libaom-av1";
+  }
+
+  // Common args
+  decoderArgs << "-threads" << "auto";
+  return decoderArgs;
+}
+
+//-----------------------------------------------------------
+
+std::vector<int> Ffmpeg::getKeyframeIndex() {
+  // Packet flags come from the demuxer alone: no frame has to be decoded
+  QStringList args;
+  args << "-v" << "error"
+       << "-select_streams" << "v:0"
+       << "-show_entries" << "packet=pts_time,flags"
+       << "-of" << "csv=p=0"
+       << m_path.getQString();
+  QStringList lines = runFfprobe(args).split("\n", Qt::SkipEmptyParts);
+
+  std::vector<double> keyTimes;
+  double startTime = (std::numeric_limits<double>::max)();
+  for (const QString &line : lines) {
+    QStringList fields = line.trimmed().split(",");
+    if (fields.size() < 2) continue;
+    bool ok;
+    double time = fields[0].toDouble(&ok);
+    if (!ok) continue;
+    startTime = std::min(startTime, time);
+    if (fields[1].contains('K')) keyTimes.push_back(time);
+  }
+
+  std::vector<int> keyframes;
+  for (double time : keyTimes)
+    keyframes.push_back(tround((time - startTime) * m_frameRate) + 1);
+  std::sort(keyframes.begin(), keyframes.end());
+  keyframes.erase(std::unique(keyframes.begin(), keyframes.end()),
+                  keyframes.end());
+  return keyframes;
+}
+
+//===========================================================
+//
+//  FfmpegFrameDecoder
+//
+//===========================================================
+
+/*!
+  Worker thread owning a persistent ffmpeg process that decodes the movie
+  to raw frames on its stdout. Requested frames are read sequentially from
+  the pipe; the process is restarted with an input seek only when going
+  backwards or when a keyframe lies between the current position and the
+  requested frame, so random access costs at most one GOP decode.
+  The most recently decoded frames are kept in a small LRU.
+*/
+
+class FfmpegFrameDecoder final : public QThread {
+  Ffmpeg *m_ffmpeg;
+  TFilePath m_path;
+  QStringList m_decoderArgs;
+  std::vector<int> m_keyframes;
+  int m_lx, m_ly, m_timeout, m_lruSize;
+  double m_frameRate;
+
+  QMutex m_requestMutex;  //!< Serializes getFrame() callers
+  QMutex m_mutex;
+  QWaitCondition m_cond;
+  int m_request;
+  bool m_hasRequest, m_quit;
+  TRasterP m_result;
+
+  std::map<int, TRasterP> m_lru;
+  std::list<int> m_lruOrder;
+
+  QProcess *m_process;
+  int m_pos;  //!< The next frame the process will output
+
+public:
+  FfmpegFrameDecoder(Ffmpeg *ffmpeg, const TFilePath &path, int lx, int ly,
+                     double frameRate, int timeout)
+      : m_ffmpeg(ffmpeg)
+      , m_path(path)
+      , m_lx(lx)
+      , m_ly(ly)
+      , m_timeout(timeout)
+      , m_frameRate(frameRate)
+      , m_request(0)
+      , m_hasRequest(false)
+      , m_quit(false)
+      , m_process(0)
+      , m_pos(0) {
+    // Keep around 256 MB of decoded frames
+    int frameBytes = std::max(1, m_lx * m_ly * 4);
+    m_lruSize      = tcrop((256 << 20) / frameBytes, 2, 64);
+  }
+
+  ~FfmpegFrameDecoder() {
+    {
+      QMutexLocker locker(&m_mutex);
+      m_quit = true;
+      m_cond.wakeAll();
     }
+    wait();
+  }
 
-    // Common args
-    preIFrameArgs << "-threads" << "auto";
-    preIFrameArgs << "-i" << m_path.getQString();
-    postIFrameArgs << "-y";
-    postIFrameArgs << "-f";
-    postIFrameArgs << "image2";
+  TRasterP getFrame(int frameIndex) {
+    QMutexLocker requestLocker(&m_requestMutex);
+    QMutexLocker locker(&m_mutex);
 
-    postIFrameArgs << tempName;
+    std::map<int, TRasterP>::iterator it = m_lru.find(frameIndex);
+    if (it != m_lru.end()) {
+      touch(frameIndex);
+      return it->second->clone();
+    }
+
+    m_request    = frameIndex;
+    m_hasRequest = true;
+    m_cond.wakeAll();
+    while (m_hasRequest) m_cond.wait(&m_mutex);
 
-    runFfmpeg(preIFrameArgs, postIFrameArgs, true, true, true, false);
+    TRasterP result = m_result;
+    m_result        = TRasterP();
+    return result ? result->clone() : result;
+  }
 
-    QString addToDelete;
-    QString tempBase = tempPath + "In";
-    for (int i = 1; i <= m_frameCount; i++) {
-      QString number = QString("%1").arg(i, 4, 10, QChar('0'));
-      addToDelete    = tempBase + number + "." + m_intermediateFormat;
-      // addToCleanUp(addToDelete);
+protected:
+  void run() override {
+    // The decoder settings are probed here, not to block the caller's thread
+    // longer than needed for the first frame
+    try {
+      m_decoderArgs = m_ffmpeg->getDecoderArgs();
+      m_keyframes   = m_ffmpeg->getKeyframeIndex();
+    } catch (...) {
+      // Decode with ffmpeg's defaults, and seek at every jump
     }
+
+    QMutexLocker locker(&m_mutex);
+    for (;;) {
+      while (!m_hasRequest && !m_quit) m_cond.wait(&m_mutex);
+      if (m_quit) break;
+
+      int frameIndex = m_request;
+      locker.unlock();
+
+      TRasterP ras = decode(frameIndex);
+
+      locker.relock();
+      m_result     = ras;
+      m_hasRequest = false;
+      m_cond.wakeAll();
+    }
+    locker.unlock();
+
+    stopProcess();
   }
+
+private:
+  void touch(int frameIndex) {
+    m_lruOrder.remove(frameIndex);
+    m_lruOrder.push_back(frameIndex);
+  }
+
+  void addToLru(int frameIndex, const TRasterP &ras) {
+    QMutexLocker locker(&m_mutex);
+    m_lru[frameIndex] = ras;
+    touch(frameIndex);
+    while ((int)m_lruOrder.size() > m_lruSize) {
+      m_lru.erase(m_lruOrder.front());
+      m_lruOrder.pop_front();
+    }
+  }
+
+  //! Tells whether reading forward from the current position is cheaper than
+  //! restarting the process with a seek.
+  bool canReadForward(int frameIndex) const {
+    if (!m_process || frameIndex < m_pos) return false;
+    if (m_keyframes.empty()) return frameIndex - m_pos <= 2 * m_frameRate;
+
+    std::vector<int>::const_iterator kt =
+        std::upper_bound(m_keyframes.begin(), m_keyframes.end(), m_pos);
+    return kt == m_keyframes.end() || *kt > frameIndex;
+  }
+
+  TRasterP decode(int frameIndex) {
+    if (frameIndex < 1) return TRasterP();
+    if (!canReadForward(frameIndex) && !startProcess(frameIndex))
+      return TRasterP();
+
+    TRasterP ras;
+    while (m_pos <= frameIndex) {
+      ras = readFrame();
+      if (!ras) {
+        stopProcess();
+        return TRasterP();
+      }
+      addToLru(m_pos++, ras);
+    }
+    return ras;
+  }
+
+  bool startProcess(int frameIndex) {
+    stopProcess();
+
+#if defined(TNZ_MACHINE_CHANNEL_ORDER_BGRM)
+    const char *pixFmt = "bgra";
+#elif defined(TNZ_MACHINE_CHANNEL_ORDER_MBGR)
+    const char *pixFmt = "abgr";
+#elif defined(TNZ_MACHINE_CHANNEL_ORDER_RGBM)
+    const char *pixFmt = "rgba";
+#else
+    const char *pixFmt = "argb";
+#endif
+
+    // An input seek lands on the preceding keyframe and decodes up to the
+    // exact time; the output is resampled to the level's frame rate
+    QStringList args;
+    args << "-v" << "error";
+    if (frameIndex > 1)
+      args << "-ss" << QString::number((frameIndex - 1) / m_frameRate, 'f', 6);
+    args = args + m_decoderArgs;
+    args << "-i" << m_path.getQString();
+    args << "-an" << "-sn";
+    args << "-map" << "0:v:0";
+    args << "-r" << QString::number(m_frameRate);
+    args << "-f" << "rawvideo";
+    args << "-pix_fmt" << pixFmt;
+    args << "-";
+
+    m_process = new QProcess;
+    m_process->setStandardErrorFile(QProcess::nullDevice());
+    ThirdParty::runFFmpeg(*m_process, args);
+    if (!m_process->waitForStarted(m_timeout)) {
+      stopProcess();
+      return false;
+    }
+    m_pos = frameIndex;
+    return true;
+  }
+
+  void stopProcess() {
+    if (!m_process) return;
+    if (m_process->state() != QProcess::NotRunning) {
+      m_process->kill();
+      m_process->waitForFinished();
+    }
+    delete m_process;
+    m_process = 0;
+  }
+
+  TRasterP readFrame() {
+    int rowSize = m_lx * sizeof(TPixel32);
+    TRaster32P ras(m_lx, m_ly);
+    ras->lock();
+
+    // ffmpeg outputs rows top-down, Toonz rasters are bottom-up
+    for (int y = m_ly - 1; y >= 0; --y) {
+      char *row   = (char *)ras->pixels(y);
+      qint64 read = 0;
+      while (read < rowSize) {
+        if (m_process->bytesAvailable() == 0 &&
+            !m_process->waitForReadyRead(m_timeout)) {
+          ras->unlock();
+          return TRasterP();
+        }
+        qint64 count = m_process->read(row + read, rowSize - read);
+        if (count < 0) {
+          ras->unlock();
+          return TRasterP();
+        }
+        read += count;
+      }
+    }
+
+    ras->unlock();
+    return ras;
+  }
+};
+
+//-----------------------------------------------------------
+
+TRasterImageP Ffmpeg::decodeFrame(int frameIndex) {
+  {
+    QMutexLocker locker(&m_decoderMutex);
+    if (!m_frameDecoder) {
+      m_frameDecoder = new FfmpegFrameDecoder(this, m_path, m_lx, m_ly,
+                                              m_frameRate, m_ffmpegTimeout);
+      m_frameDecoder->start();
+    }
+  }
+
+  TRasterP ras = m_frameDecoder->getFrame(frameIndex);
+  return ras ? TRasterImageP(ras) : TRasterImageP();
 }
 
+//-----------------------------------------------------------
+
 QString Ffmpeg::cleanPathSymbols() {
   return m_path.getQString().remove(QRegExp(
       QString::fromUtf8("[-`~!@#$%^&*()_+=|:;<>«»,.?/{}\'\"\\[\\]\\\\]")));
 }
 
-int Ffmpeg::getGifFrameCount() {
-  int frame               = 1;
-  QString ffmpegCachePath = getFfmpegCache().getQString();
-  QString tempPath        = ffmpegCachePath + "//" + cleanPathSymbols();
-  std::string tmpPath     = tempPath.toStdString();
-  QString tempName        = "In%04d." + m_intermediateFormat;
-  tempName                = tempPath + tempName;
-  QString tempStart;
-  tempStart = "In0001." + m_intermediateFormat;
-  tempStart = tempPath + tempStart;
-  while (TSystem::doesExistFileOrLevel(TFilePath(tempStart))) {
-    frame++;
-    QString number = QString("%1").arg(frame, 4, 10, QChar('0'));
-    tempStart      = tempPath + "In" + number + "." + m_intermediateFormat;
-  }
-  return frame - 1;
-}
-
 void Ffmpeg::addToCleanUp(QString path) {
   if (TSystem::doesExistFileOrLevel(TFilePath(path))) {
     m_cleanUpList.push_back(path);
@@ -572,7 +970,7 @@ TLevelReaderFFmpeg::TLevelReaderFFmpeg(const TFilePath &path)
 }
 //-----------------------------------------------------------
 
-TLevelReaderFFmpeg::~TLevelReaderFFmpeg() {}
+TLevelReaderFFmpeg::~TLevelReaderFFmpeg() { delete ffmpegReader; }
 
 //-----------------------------------------------------------
 
@@ -600,9 +998,5 @@ TDimension TLevelReaderFFmpeg::getSize() { return m_size; }
 //------------------------------------------------
 
 TImageP TLevelReaderFFmpeg::load(int frameIndex) {
-  if (!ffmpegFramesCreated) {
-    ffmpegReader->getFramesFromMovie();
-    ffmpegFramesCreated = true;
-  }
-  return ffmpegReader->getImage(frameIndex);
+  return ffmpegReader->decodeFrame(frameIndex);
 }
@@ -9,6 +9,10 @@
 #include <QVector>
 #include <QStringList>
 #include <QProcess>
+#include <QMutex>
+
+class FfmpegFrameStream;
+class FfmpegFrameDecoder;
 
 struct ffmpegFileInfo {
   int m_lx, m_ly, m_frameCount;
@@ -19,39 +23,48 @@ class Ffmpeg {
 public:
   Ffmpeg();
   ~Ffmpeg();
-  void createIntermediateImage(const TImageP &image, int frameIndex);
-  void runFfmpeg(QStringList preIArgs, QStringList postIArgs,
-                 bool includesInPath, bool includesOutPath, bool overWriteFiles,
-                 bool asyncProcess = true);
-  void runFfmpeg(QStringList preIArgs, QStringList postIArgs, TFilePath path);
+  // Streaming writer: frames are piped as raw video to a single ffmpeg
+  // process launched by openFrameStream(), no intermediate frame files are
+  // written.
+  // openFrameStream() throws TImageException if ffmpeg can't be started,
+  // writeFrame() on frames of the wrong size, submitted out of sequence or
+  // once ffmpeg has stopped encoding.
+  void openFrameStream(QStringList preIArgs, QStringList postIArgs,
+                       const TDimension &size);
+  bool isFrameStreamOpen() const { return m_frameStream != 0; }
+  void writeFrame(const TImageP &image, int frameIndex);
+  bool closeFrameStream();
   QString runFfprobe(QStringList args);
   void cleanUpFiles();
   void addToCleanUp(QString);
   void setFrameRate(double fps);
   void setPath(TFilePath path);
   void saveSoundTrack(TSoundTrack *st);
-  bool checkFilesExist();
   static bool checkFormat(std::string format);
   double getFrameRate();
   TDimension getSize();
   int getFrameCount();
-  void getFramesFromMovie(int frame = -1);
-  TRasterImageP getImage(int frameIndex);
+  // Decodes frames on demand through a persistent ffmpeg process
+  TRasterImageP decodeFrame(int frameIndex);
+  QStringList getDecoderArgs();
+  std::vector<int> getKeyframeIndex();
   TFilePath getFfmpegCache();
   ffmpegFileInfo getInfo();
   void disablePrecompute();
-  int getGifFrameCount();
 
 private:
-  QString m_intermediateFormat, m_audioPath, m_audioFormat;
+  QString m_audioPath, m_audioFormat;
   int m_frameCount    = 0, m_lx, m_ly, m_bpp, m_bitsPerSample, m_channelCount,
-      m_ffmpegTimeout = 30000, m_startNumber = 2147483647;
+      m_ffmpegTimeout = 30000;
   double m_frameRate   = 24.0;
   bool m_hasSoundTrack = false;
   TFilePath m_path;
   QVector<QString> m_cleanUpList;
   QStringList m_audioArgs;
   TUINT32 m_sampleRate;
+  FfmpegFrameStream *m_frameStream = 0;
+  FfmpegFrameDecoder *m_frameDecoder = 0;
+  QMutex m_decoderMutex;
   QString cleanPathSymbols();
   bool waitFfmpeg(QProcess &ffmpeg, bool asyncProcess);
 };
@@ -78,7 +91,6 @@ public:
 
 private:
   Ffmpeg *ffmpegReader;
-  bool ffmpegFramesCreated = false;
   TDimension m_size;
   int m_frameCount, m_lx, m_ly;
 };
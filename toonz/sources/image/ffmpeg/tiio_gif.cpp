@@ -62,8 +62,14 @@ TLevelWriterGif::TLevelWriterGif(const TFilePath &path, TPropertyGroup *winfo)
 //-----------------------------------------------------------
 
 TLevelWriterGif::~TLevelWriterGif() {
-  QStringList preIArgs;
-  QStringList postIArgs;
+  ffmpegWriter->closeFrameStream();
+  ffmpegWriter->cleanUpFiles();
+}
+
+//-----------------------------------------------------------
+
+void TLevelWriterGif::buildFfmpegArgs(QStringList &preIArgs,
+                                      QStringList &postIArgs) {
   QStringList palettePreIArgs;
   QStringList palettePostIArgs;
 
@@ -166,9 +172,6 @@ TLevelWriterGif::~TLevelWriterGif() {
   }
 
   std::string outPath = m_path.getQString().toStdString();
-
-  ffmpegWriter->runFfmpeg(preIArgs, postIArgs, false, false, true);
-  ffmpegWriter->cleanUpFiles();
 }
 
 //-----------------------------------------------------------
@@ -197,7 +200,13 @@ void TLevelWriterGif::save(const TImageP &img, int frameIndex) {
   TRasterImageP image(img);
   m_lx = image->getRaster()->getLx();
   m_ly = image->getRaster()->getLy();
-  ffmpegWriter->createIntermediateImage(img, frameIndex);
+  if (!ffmpegWriter->isFrameStreamOpen()) {
+    QStringList preIArgs, postIArgs;
+    buildFfmpegArgs(preIArgs, postIArgs);
+    ffmpegWriter->openFrameStream(preIArgs, postIArgs,
+                                  TDimension(m_lx, m_ly));
+  }
+  ffmpegWriter->writeFrame(img, frameIndex);
 }
 
 //===========================================================
@@ -263,9 +272,7 @@ TLevelReaderGif::TLevelReaderGif(const TFilePath &path)
 }
 //-----------------------------------------------------------
 
-TLevelReaderGif::~TLevelReaderGif() {
-  // ffmpegReader->cleanUpFiles();
-}
+TLevelReaderGif::~TLevelReaderGif() { delete ffmpegReader; }
 
 //-----------------------------------------------------------
 
@@ -294,11 +301,7 @@ TDimension TLevelReaderGif::getSize() { return m_size; }
 //------------------------------------------------
 
 TImageP TLevelReaderGif::load(int frameIndex) {
-  if (!ffmpegFramesCreated) {
-    ffmpegReader->getFramesFromMovie();
-    ffmpegFramesCreated = true;
-  }
-  return ffmpegReader->getImage(frameIndex);
+  return ffmpegReader->decodeFrame(frameIndex);
 }
 
 Tiio::GifWriterProperties::GifWriterProperties()
@@ -33,6 +33,8 @@ public:
   }
 
 private:
+  void buildFfmpegArgs(QStringList &preIArgs, QStringList &postIArgs);
+
   Ffmpeg *ffmpegWriter;
   int m_frameCount, m_lx, m_ly;
   // double m_fps;
@@ -65,7 +67,6 @@ public:
   // void *m_decompressedBuffer;
 private:
   Ffmpeg *ffmpegReader;
-  bool ffmpegFramesCreated = false;
   TDimension m_size;
   int m_frameCount, m_lx, m_ly;
 };
@@ -57,10 +57,14 @@ TLevelWriterMp4::TLevelWriterMp4(const TFilePath &path, TPropertyGroup *winfo)
 //-----------------------------------------------------------
 
 TLevelWriterMp4::~TLevelWriterMp4() {
-  // QProcess createMp4;
-  QStringList preIArgs;
-  QStringList postIArgs;
+  ffmpegWriter->closeFrameStream();
+  ffmpegWriter->cleanUpFiles();
+}
 
+//-----------------------------------------------------------
+
+void TLevelWriterMp4::buildFfmpegArgs(QStringList &preIArgs,
+                                      QStringList &postIArgs) {
   int outLx = m_lx;
   int outLy = m_ly;
 
@@ -90,9 +94,6 @@ TLevelWriterMp4::~TLevelWriterMp4() {
   postIArgs << QString::number(outLx) + "x" + QString::number(outLy);
   postIArgs << "-b";
   postIArgs << QString::number(finalBitrate) + "k";
-
-  ffmpegWriter->runFfmpeg(preIArgs, postIArgs, false, false, true);
-  ffmpegWriter->cleanUpFiles();
 }
 
 //-----------------------------------------------------------
@@ -122,7 +123,13 @@ void TLevelWriterMp4::save(const TImageP &img, int frameIndex) {
   TRasterImageP image(img);
   m_lx = image->getRaster()->getLx();
   m_ly = image->getRaster()->getLy();
-  ffmpegWriter->createIntermediateImage(img, frameIndex);
+  if (!ffmpegWriter->isFrameStreamOpen()) {
+    QStringList preIArgs, postIArgs;
+    buildFfmpegArgs(preIArgs, postIArgs);
+    ffmpegWriter->openFrameStream(preIArgs, postIArgs,
+                                  TDimension(m_lx, m_ly));
+  }
+  ffmpegWriter->writeFrame(img, frameIndex);
 }
 
 //===========================================================
@@ -185,9 +192,7 @@ TLevelReaderMp4::TLevelReaderMp4(const TFilePath &path) : TLevelReader(path) {
 }
 //-----------------------------------------------------------
 
-TLevelReaderMp4::~TLevelReaderMp4() {
-  // ffmpegReader->cleanUpFiles();
-}
+TLevelReaderMp4::~TLevelReaderMp4() { delete ffmpegReader; }
 
 //-----------------------------------------------------------
 
@@ -217,11 +222,7 @@ TDimension TLevelReaderMp4::getSize() { return m_size; }
 //------------------------------------------------
 
 TImageP TLevelReaderMp4::load(int frameIndex) {
-  if (!ffmpegFramesCreated) {
-    ffmpegReader->getFramesFromMovie();
-    ffmpegFramesCreated = true;
-  }
-  return ffmpegReader->getImage(frameIndex);
+  return ffmpegReader->decodeFrame(frameIndex);
 }
 
 Tiio::Mp4WriterProperties::Mp4WriterProperties()
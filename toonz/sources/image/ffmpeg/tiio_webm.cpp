@@ -66,9 +66,14 @@ TLevelWriterWebm::TLevelWriterWebm(const TFilePath &path, TPropertyGroup *winfo)
 //-----------------------------------------------------------
 
 TLevelWriterWebm::~TLevelWriterWebm() {
-  QStringList preIArgs;
-  QStringList postIArgs;
+  ffmpegWriter->closeFrameStream();
+  ffmpegWriter->cleanUpFiles();
+}
 
+//-----------------------------------------------------------
+
+void TLevelWriterWebm::buildFfmpegArgs(QStringList &preIArgs,
+                                       QStringList &postIArgs) {
   // Calculate output dimensions (ensure even)
   int outLx = m_lx;
   int outLy = m_ly;
@@ -157,10 +162,6 @@ TLevelWriterWebm::~TLevelWriterWebm() {
 
   // Debug
   qDebug() << "preIArgs:" << preIArgs << "postIArgs:" << postIArgs;
-
-  // Execute FFmpeg and clean up
-  ffmpegWriter->runFfmpeg(preIArgs, postIArgs, false, false, true);
-  ffmpegWriter->cleanUpFiles();
 }
 
 //-----------------------------------------------------------
@@ -190,7 +191,13 @@ void TLevelWriterWebm::save(const TImageP &img, int frameIndex) {
   TRasterImageP image(img);
   m_lx = image->getRaster()->getLx();
   m_ly = image->getRaster()->getLy();
-  ffmpegWriter->createIntermediateImage(img, frameIndex);
+  if (!ffmpegWriter->isFrameStreamOpen()) {
+    QStringList preIArgs, postIArgs;
+    buildFfmpegArgs(preIArgs, postIArgs);
+    ffmpegWriter->openFrameStream(preIArgs, postIArgs,
+                                  TDimension(m_lx, m_ly));
+  }
+  ffmpegWriter->writeFrame(img, frameIndex);
 }
 
 //===========================================================
@@ -253,9 +260,7 @@ TLevelReaderWebm::TLevelReaderWebm(const TFilePath &path) : TLevelReader(path) {
 }
 //-----------------------------------------------------------
 
-TLevelReaderWebm::~TLevelReaderWebm() {
-  // ffmpegReader->cleanUpFiles();
-}
+TLevelReaderWebm::~TLevelReaderWebm() { delete ffmpegReader; }
 
 //-----------------------------------------------------------
 
@@ -285,11 +290,7 @@ TDimension TLevelReaderWebm::getSize() { return m_size; }
 //------------------------------------------------
 
 TImageP TLevelReaderWebm::load(int frameIndex) {
-  if (!ffmpegFramesCreated) {
-    ffmpegReader->getFramesFromMovie();
-    ffmpegFramesCreated = true;
-  }
-  return ffmpegReader->getImage(frameIndex);
+  return ffmpegReader->decodeFrame(frameIndex);
 }
 
 Tiio::WebmWriterProperties::WebmWriterProperties()
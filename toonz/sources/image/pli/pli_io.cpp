@@ -1,4 +1,5 @@
 #include <memory>
+#include <thread>
 
 #include "tmachine.h"
 #include "pli_io.h"
@@ -13,6 +14,8 @@
 #include "../compatibility/tfile_io.h"
 #include "tenv.h"
 
+#include <QMutex>
+
 /*=====================================================================*/
 
 #if defined(MACOSX)
@@ -149,15 +152,24 @@ MyOfstream &MyOfstream::operator<<(const std::string &s) {
 class MyIfstream  // The input is done without stl; it was crashing in release
                   // version loading textures!!
 {
-private:
+  // The whole file is read on open, so that tags are parsed from memory -
+  // copies share the same data, and can be read concurrently
   bool m_isIrixEndian;
-  FILE *m_fp;
+  QByteArray m_data;
+  TUINT32 m_pos;
 
-public:
-  MyIfstream() : m_isIrixEndian(false) { m_fp = 0; }
-  ~MyIfstream() {
-    if (m_fp) fclose(m_fp);
+  const UCHAR *get(TUINT32 length) {
+    TUINT32 size = (TUINT32)m_data.size();
+    if (m_pos > size || length > size - m_pos)
+      throw TException("corrupted pli file: unexpected end of file");
+
+    const UCHAR *data = (const UCHAR *)m_data.constData() + m_pos;
+    m_pos += length;
+    return data;
   }
+
+public:
+  MyIfstream() : m_isIrixEndian(false), m_pos(0) {}
   void setEndianness(bool isIrixEndian) { m_isIrixEndian = isIrixEndian; }
   MyIfstream &operator>>(TUINT32 &un);
   MyIfstream &operator>>(string &un);
@@ -166,34 +178,48 @@ public:
   MyIfstream &operator>>(char &un);
   void open(const TFilePath &filename);
   void close() {
-    if (m_fp) fclose(m_fp);
-    m_fp = 0;
+    m_data.clear();
+    m_pos = 0;
   }
-  TUINT32 tellg() { return (TUINT32)ftell(m_fp); }
+  TUINT32 size() const { return (TUINT32)m_data.size(); }
+  TUINT32 tellg() { return m_pos; }
   // void seekg(TUINT32 pos, ios_base::seek_dir type);
   void seekg(TUINT32 pos, int type);
-  void read(char *m_buf, int length) {
-    fread((void *)m_buf, sizeof(char), length, m_fp);
-  }
+  void read(char *m_buf, int length) { memcpy(m_buf, get(length), length); }
+  //! Returns the next length bytes without copying them; they are valid
+  //! as long as the stream (or any copy of it) is not closed
+  const UCHAR *readBuf(TUINT32 length) { return get(length); }
 };
 
 /*=====================================================================*/
 
 void MyIfstream::open(const TFilePath &filename) {
+  FILE *fp = 0;
   try {
-    m_fp = fopen(filename, "rb");
+    fp = fopen(filename, "rb");
   } catch (TException &) {
-    throw TImageException(filename, "File not found");
   }
+  if (!fp) throw TImageException(filename, "File not found");
+
+  fseek(fp, 0, SEEK_END);
+  long size = ftell(fp);
+  fseek(fp, 0, SEEK_SET);
+
+  m_data.resize(size > 0 ? (int)size : 0);
+  size = (long)fread(m_data.data(), sizeof(char), m_data.size(), fp);
+  fclose(fp);
+
+  m_data.resize((int)size);
+  m_pos = 0;
 }
 
 /*=====================================================================*/
 
 void MyIfstream::seekg(TUINT32 pos, int type) {
   if (type == ios_base::beg)
-    fseek(m_fp, pos, SEEK_SET);
+    m_pos = pos;
   else if (type == ios_base::cur)
-    fseek(m_fp, pos, SEEK_CUR);
+    m_pos += pos;
   else
     assert(false);
 }
@@ -201,27 +227,21 @@ void MyIfstream::seekg(TUINT32 pos, int type) {
 /*=====================================================================*/
 
 inline MyIfstream &MyIfstream::operator>>(UCHAR &un) {
-  int ret = fread((void *)&un, sizeof(UCHAR), 1, m_fp);
-  if (ret < 1) throw TException("corrupted pli file: unexpected end of file");
-  // read((char *)&un, sizeof(UCHAR));
+  un = *get(sizeof(UCHAR));
   return *this;
 }
 
 /*=====================================================================*/
 
 inline MyIfstream &MyIfstream::operator>>(char &un) {
-  int ret = fread((void *)&un, sizeof(char), 1, m_fp);
-  if (ret < 1) throw TException("corrupted pli file: unexpected end of file");
-  // read((char *)&un, sizeof(char));
+  un = (char)*get(sizeof(char));
   return *this;
 }
 
 /*=====================================================================*/
 
 inline MyIfstream &MyIfstream::operator>>(USHORT &un) {
-  int ret = fread((void *)&un, sizeof(USHORT), 1, m_fp);
-  if (ret < 1) throw TException("corrupted pli file: unexpected end of file");
-  //  read((char *)&un, sizeof(USHORT));
+  memcpy(&un, get(sizeof(USHORT)), sizeof(USHORT));
 
   if (m_isIrixEndian) un = ((un & 0xff00) >> 8) | ((un & 0x00ff) << 8);
   return *this;
@@ -230,9 +250,7 @@ inline MyIfstream &MyIfstream::operator>>(USHORT &un) {
 /*=====================================================================*/
 
 inline MyIfstream &MyIfstream::operator>>(TUINT32 &un) {
-  int ret = fread((void *)&un, sizeof(TUINT32), 1, m_fp);
-  if (ret < 1) throw TException("corrupted pli file: unexpected end of file");
-  // read((char *)&un, sizeof(TUINT32));
+  memcpy(&un, get(sizeof(TUINT32)), sizeof(TUINT32));
 
   if (m_isIrixEndian)
     un = ((un & 0xff000000) >> 24) | ((un & 0x00ff0000) >> 8) |
@@ -243,15 +261,9 @@ inline MyIfstream &MyIfstream::operator>>(TUINT32 &un) {
 /*=====================================================================*/
 
 inline MyIfstream &MyIfstream::operator>>(string &un) {
-  string s = "";
   USHORT length;
   (*this) >> length;
-  for (UINT i = 0; i < length; i++) {
-    UCHAR ch;
-    (*this) >> ch;
-    s.append(1, ch);
-  }
-  un = s;
+  un.assign((const char *)get(length), length);
 
   return *this;
 }
@@ -293,6 +305,10 @@ UINT TStyleParam::getSize() {
 const TUINT32 c_magicNt   = 0x4D494C50;
 const TUINT32 c_magicIrix = 0x504C494D;
 
+// Closes the files carrying a frame index: it follows the offset of the
+// FRAME_INDEX_CNTRL tag, after the END_CNTRL tag
+const TUINT32 c_magicIndex = 0x58494C50;
+
 class TagElem {
 public:
   PliTag *m_tag;
@@ -310,6 +326,16 @@ public:
   }
 };
 
+/*=====================================================================*/
+
+static void deleteTags(TagElem *tag) {
+  while (tag) {
+    TagElem *auxTag = tag;
+    tag             = tag->m_next;
+    delete auxTag;
+  }
+}
+
 /*=====================================================================*/
 class TContentHistory;
 
@@ -326,16 +352,32 @@ public:
   TFilePath m_filePath;
   UCHAR m_currDynamicTypeBytesNum;
   TUINT32 m_tagLength;
-  TUINT32 m_bufLength;
-  std::unique_ptr<UCHAR[]> m_buf;
+  const UCHAR *m_buf;  //!< Data of the last read tag, in m_iChan
   TAffine m_affine;
   int m_precisionScale;
   std::map<TFrameId, int> m_frameOffsInFile;
 
+  //! Tags of the frames loaded by each thread
+  std::map<std::thread::id, TagElem *> m_frameTags;
+  QMutex m_frameTagsMutex;
+
+  //! Frames and tags recorded by writePli() for the frame index
+  struct IndexedFrame {
+    USHORT m_number;
+    QByteArray m_suffix;
+    TUINT32 m_offset;
+  };
+  std::vector<IndexedFrame> m_indexedFrames;
+  std::vector<std::pair<TUINT32, UCHAR>> m_indexedInfoTags;
+
   PliTag *readTextTag();
   PliTag *readPaletteTag();
   PliTag *readPaletteWithAlphaTag();
   PliTag *readThickQuadraticChainTag(bool isLoop);
+  template <int bytesNum>
+  void readQuadratics(TThickQuadratic *quadratic, TUINT32 numQuadratics,
+                      TThickPoint p, TUINT32 bufOffs, double scale,
+                      bool newThicknessWriteMethod);
   PliTag *readColorTag();
   PliTag *readStyleTag();
   PliTag *readGroupTag();
@@ -373,6 +415,7 @@ public:
   TUINT32 writeOutlineOptionsTag(StrokeOutlineOptionsTag *tag);
   TUINT32 writePrecisionScaleTag(PrecisionScaleTag *tag);
   TUINT32 writeAutoCloseToleranceTag(AutoCloseToleranceTag *tag);
+  TUINT32 writeFrameIndexTag();
 
   inline void writeDynamicData(TUINT32 val);
   inline void writeDynamicData(TINT32 val, bool isNegative);
@@ -383,6 +426,9 @@ public:
   UINT findOffsetFromTag(PliTag *tag);
   TagElem *findTag(PliTag *tag);
   USHORT readTagHeader();
+  bool readFrameIndex(std::vector<std::pair<TUINT32, UCHAR>> &infoTags);
+  void readInfoTag(bool &readPalette, TPalette *&palette,
+                   TContentHistory *&history);
 
 public:
   enum errorType {
@@ -490,7 +536,7 @@ ParsedPliImp::ParsedPliImp()
     , m_currTag(NULL)
     , m_iChan()
     , m_oChan(0)
-    , m_bufLength(0)
+    , m_buf(0)
     , m_affine()
     , m_precisionScale(REGION_COMPUTING_PRECISION)
     , m_creator("") {}
@@ -511,7 +557,7 @@ ParsedPliImp::ParsedPliImp(UCHAR majorVersionNumber, UCHAR minorVersionNumber,
     , m_currTag(NULL)
     , m_iChan()
     , m_oChan(0)
-    , m_bufLength(0)
+    , m_buf(0)
     , m_affine(TScale(1.0 / pow(10.0, precision)))
     , m_precisionScale(REGION_COMPUTING_PRECISION)
     , m_creator("") {}
@@ -529,7 +575,7 @@ ParsedPliImp::ParsedPliImp(const TFilePath &filename, bool readInfo)
     , m_currTag(NULL)
     , m_iChan()
     , m_oChan(0)
-    , m_bufLength(0)
+    , m_buf(0)
     , m_precisionScale(REGION_COMPUTING_PRECISION)
     , m_creator("") {
   TUINT32 magic;
@@ -663,6 +709,20 @@ void ParsedPliImp::loadInfo(bool readPlt, TPalette *&palette,
   //  m_frameOffsInFile[i] = -1;
 
   TUINT32 pos = m_iChan.tellg();
+
+  std::vector<std::pair<TUINT32, UCHAR>> infoTags;
+  if (readFrameIndex(infoTags)) {
+    // the frames are skipped altogether
+    for (int i = 0; i < (int)infoTags.size(); i++) {
+      m_iChan.seekg(infoTags[i].first, ios::beg);
+      m_currDynamicTypeBytesNum = infoTags[i].second;
+      readInfoTag(readPlt, palette, history);
+    }
+    return;
+  }
+
+  m_iChan.seekg(pos, ios::beg);
+
   USHORT type;
   while ((type = readTagHeader()) != PliTag::END_CNTRL) {
     if (type == PliTag::IMAGE_BEGIN_GOBJ) {
@@ -690,33 +750,11 @@ void ParsedPliImp::loadInfo(bool readPlt, TPalette *&palette,
 
       // m_iChan.seekg(m_tagLength, ios::cur);
       if (m_majorVersionNumber < 150) m_iChan.seekg(m_tagLength - 2, ios::cur);
-    } else if (type == PliTag::STYLE_NGOBJ) {
-      m_iChan.seekg(pos, ios::beg);
-      TagElem *tagElem = readTag();
-      addTag(*tagElem);
-      tagElem->m_tag = 0;
-      delete tagElem;
-    } else if (type == PliTag::TEXT) {
-      m_iChan.seekg(pos, ios::beg);
-      TagElem *tagElem = readTag();
-      TextTag *textTag = (TextTag *)tagElem->m_tag;
-      history          = new TContentHistory(true);
-      history->deserialize(QString::fromStdString(textTag->m_text));
-      delete tagElem;
-    }
-
-    else if (type == PliTag::GROUP_GOBJ && readPlt)  // la paletta!!!
+    } else if (type == PliTag::STYLE_NGOBJ || type == PliTag::TEXT ||
+               (type == PliTag::GROUP_GOBJ && readPlt))  // la paletta!!!
     {
       m_iChan.seekg(pos, ios::beg);
-      TagElem *tagElem   = readTag();
-      GroupTag *grouptag = (GroupTag *)tagElem->m_tag;
-      if (grouptag->m_type == (UCHAR)GroupTag::PALETTE) {
-        readPlt = false;
-        palette = readPalette((GroupTag *)tagElem->m_tag, m_majorVersionNumber,
-                              m_minorVersionNumber);
-      } else
-        assert(grouptag->m_type == (UCHAR)GroupTag::STROKE);
-      delete tagElem;
+      readInfoTag(readPlt, palette, history);
     } else {
       m_iChan.seekg(m_tagLength, ios::cur);
       switch (type) {
@@ -744,6 +782,113 @@ void ParsedPliImp::loadInfo(bool readPlt, TPalette *&palette,
 
 /*=====================================================================*/
 
+//! Reads the tag at the current position, if it is needed by loadInfo():
+//! styles are kept for the palette group that references them.
+void ParsedPliImp::readInfoTag(bool &readPlt, TPalette *&palette,
+                               TContentHistory *&history) {
+  TagElem *tagElem = readTag();
+  if (!tagElem) return;
+
+  switch (tagElem->m_tag->m_type) {
+  case PliTag::STYLE_NGOBJ:
+    addTag(*tagElem);
+    tagElem->m_tag = 0;
+    break;
+  case PliTag::TEXT: {
+    TextTag *textTag = (TextTag *)tagElem->m_tag;
+    history          = new TContentHistory(true);
+    history->deserialize(QString::fromStdString(textTag->m_text));
+    break;
+  }
+  case PliTag::GROUP_GOBJ: {
+    if (!readPlt) break;
+
+    GroupTag *grouptag = (GroupTag *)tagElem->m_tag;
+    if (grouptag->m_type == (UCHAR)GroupTag::PALETTE) {
+      readPlt = false;
+      palette = readPalette(grouptag, m_majorVersionNumber,
+                            m_minorVersionNumber);
+    } else
+      assert(grouptag->m_type == (UCHAR)GroupTag::STROKE);
+    break;
+  }
+  default:
+    break;
+  }
+
+  delete tagElem;
+}
+
+/*=====================================================================*/
+
+//! Reads the frame index written at the end of the file, filling in the
+//! frame offsets and returning the offsets of the tags needed by loadInfo().
+//! Returns false if there is no valid index - i.e. the file was written by
+//! a previous version, and must be walked tag by tag.
+bool ParsedPliImp::readFrameIndex(
+    std::vector<std::pair<TUINT32, UCHAR>> &infoTags) {
+  TUINT32 size = m_iChan.size();
+  if (size < 8) return false;
+
+  std::map<TFrameId, int> frameOffsInFile;
+  std::vector<std::pair<TUINT32, UCHAR>> tags;
+
+  try {
+    TUINT32 indexOffset, magic;
+    m_iChan.seekg(size - 8, ios::beg);
+    m_iChan >> indexOffset;
+    m_iChan >> magic;
+    if (magic != c_magicIndex || indexOffset >= size - 8) return false;
+
+    m_iChan.seekg(indexOffset, ios::beg);
+    if (readTagHeader() != PliTag::FRAME_INDEX_CNTRL) return false;
+
+    TUINT32 framesCount;
+    m_iChan >> framesCount;
+    if (framesCount != m_framesNumber) return false;
+
+    for (TUINT32 i = 0; i < framesCount; i++) {
+      USHORT frame;
+      TUINT32 suffixLength, offset;
+      m_iChan >> frame;
+      m_iChan >> suffixLength;
+      if (suffixLength > size) return false;
+
+      QByteArray suffix;
+      if (suffixLength > 0) {
+        suffix.resize(suffixLength);
+        m_iChan.read(suffix.data(), suffixLength);
+      }
+
+      m_iChan >> offset;
+      if (offset >= indexOffset) return false;
+
+      frameOffsInFile[TFrameId(frame, QString::fromUtf8(suffix))] = offset;
+    }
+    if (frameOffsInFile.size() != framesCount) return false;
+
+    TUINT32 tagsCount;
+    m_iChan >> tagsCount;
+    for (TUINT32 i = 0; i < tagsCount; i++) {
+      TUINT32 offset;
+      UCHAR bytesNum;
+      m_iChan >> offset;
+      m_iChan >> bytesNum;
+      if (offset >= indexOffset) return false;
+
+      tags.push_back(std::make_pair(offset, bytesNum));
+    }
+  } catch (TException &) {
+    return false;
+  }
+
+  m_frameOffsInFile.swap(frameOffsInFile);
+  infoTags.swap(tags);
+  return true;
+}
+
+/*=====================================================================*/
+
 USHORT ParsedPliImp::readTagHeader() {
   UCHAR ucharTagType, tagLengthId;
   USHORT tagType;
@@ -797,76 +942,53 @@ USHORT ParsedPliImp::readTagHeader() {
 /*=====================================================================*/
 
 ImageTag *ParsedPliImp::loadFrame(const TFrameId &frameNumber) {
-  m_currDynamicTypeBytesNum = 2;
-
-  TagElem *tagElem = m_firstTag;
-  while (tagElem) {
-    TagElem *auxTag = tagElem;
-    tagElem         = tagElem->m_next;
-    delete auxTag;
-  }
-  m_firstTag = 0;
-
-  // PliTag *tag;
-  USHORT type = PliTag::IMAGE_BEGIN_GOBJ;
-  USHORT frame;
-  QByteArray suffix;
-  TFrameId frameId;
-
   // cerco il frame
   std::map<TFrameId, int>::iterator it;
 
   it = m_frameOffsInFile.find(frameNumber);
-
-  if (it != m_frameOffsInFile.end()) {
-    m_iChan.seekg(it->second, ios::beg);
-    frameId = it->first;
-  } else
-    while ((type = readTagHeader()) != PliTag::END_CNTRL) {
-      if (type == PliTag::IMAGE_BEGIN_GOBJ) {
-        m_iChan >> frame;
-
-        if (m_majorVersionNumber >= 150) {
-          TUINT32 suffixLength;
-          m_iChan >> suffixLength;
-          suffix.resize(suffixLength);
-          m_iChan.read(suffix.data(), suffixLength);
-        } else {
-          char letter = 0;
-          if (m_majorVersionNumber > 6 ||
-              (m_majorVersionNumber == 6 && m_minorVersionNumber >= 6)) {
-            m_iChan >> letter;
-            if (letter > 0) suffix = QByteArray(&letter, 1);
-          }
-        }
-
-        frameId                    = TFrameId(frame, QString::fromUtf8(suffix));
-        m_frameOffsInFile[frameId] = m_iChan.tellg();
-        if (frameId == frameNumber) break;
-      } else
-        m_iChan.seekg(m_tagLength, ios::cur);
-    }
-
-  if (type == PliTag::END_CNTRL) {
+  if (it == m_frameOffsInFile.end())
     throw TImageException(TFilePath(), "Pli: frame not found");
-    return 0;
-  }
+
+  // Each frame is parsed from its own copy of the stream, sharing the file
+  // data, so that different threads can load frames concurrently
+  ParsedPliImp parser;
+  parser.m_majorVersionNumber      = m_majorVersionNumber;
+  parser.m_minorVersionNumber      = m_minorVersionNumber;
+  parser.m_isIrixEndian            = m_isIrixEndian;
+  parser.m_thickRatio              = m_thickRatio;
+  parser.m_maxThickness            = m_maxThickness;
+  parser.m_precisionScale          = m_precisionScale;
+  parser.m_currDynamicTypeBytesNum = 2;
+  parser.m_iChan                   = m_iChan;
+  parser.m_iChan.seekg(it->second, ios::beg);
 
   // trovato; leggo i suoi tag
-  while ((tagElem = readTag())) {
-    if (!m_firstTag)
-      m_firstTag = m_lastTag = tagElem;
+  ImageTag *imageTag = 0;
+
+  TagElem *tagElem;
+  while (!imageTag && (tagElem = parser.readTag())) {
+    if (!parser.m_firstTag)
+      parser.m_firstTag = parser.m_lastTag = tagElem;
     else {
-      m_lastTag->m_next = tagElem;
-      m_lastTag         = m_lastTag->m_next;
+      parser.m_lastTag->m_next = tagElem;
+      parser.m_lastTag         = parser.m_lastTag->m_next;
     }
     if (tagElem->m_tag->m_type == PliTag::IMAGE_GOBJ) {
-      assert(((ImageTag *)(tagElem->m_tag))->m_numFrame == frameId);
-      return (ImageTag *)tagElem->m_tag;
+      imageTag = (ImageTag *)tagElem->m_tag;
+      assert(imageTag->m_numFrame == it->first);
     }
   }
 
-  return 0;
+  // the tags of the previous frame loaded by this thread are released
+  QMutexLocker locker(&m_frameTagsMutex);
+
+  TagElem *&frameTags = m_frameTags[std::this_thread::get_id()];
+  deleteTags(frameTags);
+
+  frameTags         = parser.m_firstTag;
+  parser.m_firstTag = parser.m_lastTag = 0;
+
+  return imageTag;
 }
 
 /*=====================================================================*/
@@ -914,13 +1036,8 @@ TagElem *ParsedPliImp::readTag() {
     assert(false);
   }
 
-  if (m_bufLength < m_tagLength) {
-    m_bufLength = m_tagLength;
-    m_buf.reset(new UCHAR[m_bufLength]);
-  }
-
   if (m_tagLength) {
-    m_iChan.read((char *)m_buf.get(), (int)m_tagLength);
+    m_buf = m_iChan.readBuf(m_tagLength);
     CHECK_FOR_READ_ERROR(m_filePath);
   }
 
@@ -1108,7 +1225,7 @@ inline bool ParsedPliImp::readDynamicData(TINT32 &val, TUINT32 &bufOffs) {
 PliTag *ParsedPliImp::readTextTag() {
   if (m_tagLength == 0) return new TextTag("");
 
-  return new TextTag(string((char *)m_buf.get(), m_tagLength));
+  return new TextTag(string((const char *)m_buf, m_tagLength));
 }
 
 /*=====================================================================*/
@@ -1156,11 +1273,50 @@ PliTag *ParsedPliImp::readPaletteWithAlphaTag() {
 
 /*=====================================================================*/
 
+namespace {
+
+//! Decodes a signed value of bytesNum bytes, as read by
+//! ParsedPliImp::readDynamicData()
+template <int bytesNum>
+inline TINT32 decodeDynamicData(const UCHAR *buf, bool isIrixEndian);
+
+template <>
+inline TINT32 decodeDynamicData<1>(const UCHAR *buf, bool) {
+  TINT32 val = buf[0] & 0x7f;
+  return (buf[0] & 0x80) ? -val : val;
+}
+
+template <>
+inline TINT32 decodeDynamicData<2>(const UCHAR *buf, bool isIrixEndian) {
+  if (isIrixEndian) {
+    TINT32 val = (buf[1] | (buf[0] << 8)) & 0x7fff;
+    return (buf[0] & 0x80) ? -val : val;
+  }
+
+  TINT32 val = (buf[0] | (buf[1] << 8)) & 0x7fff;
+  return (buf[1] & 0x80) ? -val : val;
+}
+
+template <>
+inline TINT32 decodeDynamicData<4>(const UCHAR *buf, bool isIrixEndian) {
+  if (isIrixEndian) {
+    TINT32 val = (buf[3] | (buf[2] << 8) | (buf[1] << 16) | (buf[0] << 24)) &
+                 0x7fffffff;
+    return (buf[0] & 0x80) ? -val : val;
+  }
+
+  TINT32 val = (buf[0] | (buf[1] << 8) | (buf[2] << 16) | (buf[3] << 24)) &
+               0x7fffffff;
+  return (buf[3] & 0x80) ? -val : val;
+}
+
+}  // namespace
+
+/*=====================================================================*/
+
 PliTag *ParsedPliImp::readThickQuadraticChainTag(bool isLoop) {
   TThickPoint p;
   TUINT32 bufOffs = 0;
-  double dx1, dy1, dx2, dy2;
-  TINT32 d;
   TUINT32 numQuadratics = 0;
   double scale;
 
@@ -1197,13 +1353,50 @@ PliTag *ParsedPliImp::readThickQuadraticChainTag(bool isLoop) {
   std::unique_ptr<TThickQuadratic[]> quadratic(
       new TThickQuadratic[numQuadratics]);
 
+  // the data size is resolved once for the whole chain, rather than for each
+  // coordinate
+  switch (m_currDynamicTypeBytesNum) {
+  case 1:
+    readQuadratics<1>(quadratic.get(), numQuadratics, p, bufOffs, scale,
+                      newThicknessWriteMethod);
+    break;
+  case 2:
+    readQuadratics<2>(quadratic.get(), numQuadratics, p, bufOffs, scale,
+                      newThicknessWriteMethod);
+    break;
+  case 4:
+    readQuadratics<4>(quadratic.get(), numQuadratics, p, bufOffs, scale,
+                      newThicknessWriteMethod);
+    break;
+  default:
+    assert(false);
+  }
+
+  ThickQuadraticChainTag *tag = new ThickQuadraticChainTag();
+  tag->m_numCurves            = numQuadratics;
+  tag->m_curve                = std::move(quadratic);
+  tag->m_isLoop               = isLoop;
+  tag->m_maxThickness         = maxThickness;
+
+  return tag;
+}
+
+/*=====================================================================*/
+
+template <int bytesNum>
+void ParsedPliImp::readQuadratics(TThickQuadratic *quadratic,
+                                  TUINT32 numQuadratics, TThickPoint p,
+                                  TUINT32 bufOffs, double scale,
+                                  bool newThicknessWriteMethod) {
+  double dx1, dy1, dx2, dy2;
+
   for (unsigned int i = 0; i < numQuadratics; i++) {
     quadratic[i].setThickP0(p);
 
-    readDynamicData(d, bufOffs);
-    dx1 = scale * d;
-    readDynamicData(d, bufOffs);
-    dy1 = scale * d;
+    dx1 = scale * decodeDynamicData<bytesNum>(m_buf + bufOffs, m_isIrixEndian);
+    bufOffs += bytesNum;
+    dy1 = scale * decodeDynamicData<bytesNum>(m_buf + bufOffs, m_isIrixEndian);
+    bufOffs += bytesNum;
 
     if (newThicknessWriteMethod)
       p.thick = m_buf[bufOffs++] * m_thickRatio;
@@ -1219,10 +1412,10 @@ PliTag *ParsedPliImp::readThickQuadraticChainTag(bool isLoop) {
       bufOffs += 2;
     }
 
-    readDynamicData(d, bufOffs);
-    dx2 = scale * d;
-    readDynamicData(d, bufOffs);
-    dy2 = scale * d;
+    dx2 = scale * decodeDynamicData<bytesNum>(m_buf + bufOffs, m_isIrixEndian);
+    bufOffs += bytesNum;
+    dy2 = scale * decodeDynamicData<bytesNum>(m_buf + bufOffs, m_isIrixEndian);
+    bufOffs += bytesNum;
 
     if (dx1 == 0 && dy1 == 0)  // p0==p1, or p1==p2  creates problems (in the
                                // increasecontrolpoints for example) I slightly
@@ -1257,14 +1450,6 @@ PliTag *ParsedPliImp::readThickQuadraticChainTag(bool isLoop) {
 
     quadratic[i].setThickP2(p);
   }
-
-  ThickQuadraticChainTag *tag = new ThickQuadraticChainTag();
-  tag->m_numCurves            = numQuadratics;
-  tag->m_curve                = std::move(quadratic);
-  tag->m_isLoop               = isLoop;
-  tag->m_maxThickness         = maxThickness;
-
-  return tag;
 }
 
 /*=====================================================================*/
@@ -1479,7 +1664,7 @@ UINT ParsedPliImp::readRasterData(TRaster32P &r, TUINT32 &bufOffs) {
   r.create((int)lx, (int)ly);
   UINT size = lx * ly * 4;
   r->lock();
-  memcpy(r->getRawData(), m_buf.get() + bufOffs, size);
+  memcpy(r->getRawData(), m_buf + bufOffs, size);
   r->unlock();
   bufOffs += size;
   return size + 2 + 2;
@@ -1615,7 +1800,7 @@ PliTag *ParsedPliImp::readBitmapTag() {
 
   r.create(lx, ly);
   r->lock();
-  memcpy(r->getRawData(), m_buf.get() + bufOffs, lx * ly * 4);
+  memcpy(r->getRawData(), m_buf + bufOffs, lx * ly * 4);
   r->unlock();
   BitmapTag *tag = new BitmapTag(r);
 
@@ -1643,7 +1828,7 @@ PliTag *ParsedPliImp::readImageTag() {
     readTUINT32Data(suffixLength, bufOffs);
     headerLength += 4;
     if (suffixLength > 0) {
-      suffix = QByteArray((char *)m_buf.get() + bufOffs, suffixLength);
+      suffix = QByteArray((const char *)m_buf + bufOffs, suffixLength);
       bufOffs += suffixLength;
       headerLength += suffixLength;
     }
@@ -1871,6 +2056,15 @@ void ParsedPliImp::writeTag(TagElem *elem) {
     // m_error = UNKNOWN_TAG;
     ;
   }
+
+  // the tags read by loadInfo() are indexed, along with the data size they
+  // were written with
+  if (elem->m_tag->m_type == PliTag::STYLE_NGOBJ ||
+      elem->m_tag->m_type == PliTag::TEXT ||
+      (elem->m_tag->m_type == PliTag::GROUP_GOBJ &&
+       ((GroupTag *)elem->m_tag)->m_type == GroupTag::PALETTE))
+    m_indexedInfoTags.push_back(
+        std::make_pair(elem->m_offset, m_currDynamicTypeBytesNum));
 }
 
 /*=====================================================================*/
@@ -2183,6 +2377,14 @@ TUINT32 ParsedPliImp::writeImageTag(ImageTag *tag) {
     else
       *m_oChan << (UCHAR)0;
   }
+
+  // the frame is indexed as it will be read back
+  IndexedFrame indexedFrame = {
+      (USHORT)tag->m_numFrame.getNumber(),
+      (m_majorVersionNumber >= 150) ? suffix : suffix.left(1),
+      (TUINT32)m_oChan->tellp()};
+  m_indexedFrames.push_back(indexedFrame);
+
   m_currDynamicTypeBytesNum = 3;
 
   objectOffset = new TUINT32[tag->m_numObjects];
@@ -2454,6 +2656,41 @@ TUINT32 ParsedPliImp::writeAutoCloseToleranceTag(AutoCloseToleranceTag *tag) {
 
 /*=====================================================================*/
 
+//! Writes the offsets of the frames and of the tags read by loadInfo(),
+//! recorded while writing them. Previous versions just skip the tag.
+TUINT32 ParsedPliImp::writeFrameIndexTag() {
+  assert(m_oChan);
+
+  TUINT32 tagLength = 4 + 4 + m_indexedInfoTags.size() * (4 + 1);
+  unsigned int i;
+  for (i = 0; i < m_indexedFrames.size(); i++)
+    tagLength += 2 + 4 + m_indexedFrames[i].m_suffix.size() + 4;
+
+  TUINT32 offset =
+      writeTagHeader((UCHAR)PliTag::FRAME_INDEX_CNTRL, tagLength);
+
+  *m_oChan << (TUINT32)m_indexedFrames.size();
+  for (i = 0; i < m_indexedFrames.size(); i++) {
+    IndexedFrame &frame = m_indexedFrames[i];
+
+    *m_oChan << frame.m_number;
+    *m_oChan << (TUINT32)frame.m_suffix.size();
+    if (frame.m_suffix.size() > 0)
+      m_oChan->writeBuf(frame.m_suffix.data(), frame.m_suffix.size());
+    *m_oChan << frame.m_offset;
+  }
+
+  *m_oChan << (TUINT32)m_indexedInfoTags.size();
+  for (i = 0; i < m_indexedInfoTags.size(); i++) {
+    *m_oChan << m_indexedInfoTags[i].first;
+    *m_oChan << m_indexedInfoTags[i].second;
+  }
+
+  return offset;
+}
+
+/*=====================================================================*/
+
 TUINT32 ParsedPliImp::writeGeometricTransformationTag(
     GeometricTransformationTag *tag) {
   assert(m_oChan);
@@ -2615,13 +2852,24 @@ bool ParsedPliImp::writePli(const TFilePath &filename) {
 
   m_currDynamicTypeBytesNum = 2;
 
+  m_indexedFrames.clear();
+  m_indexedInfoTags.clear();
+
   for (TagElem *elem = m_firstTag; elem; elem = elem->m_next) {
     writeTag(elem);
     CHECK_FOR_WRITE_ERROR(filename);
   }
 
+  TUINT32 indexOffset = writeFrameIndexTag();
+
   *m_oChan << (UCHAR)PliTag::END_CNTRL;
 
+  // lets the frame index be found without walking the tags
+  *m_oChan << indexOffset;
+  *m_oChan << c_magicIndex;
+
+  CHECK_FOR_WRITE_ERROR(filename);
+
   m_oChan->close();
   m_oChan = 0;
 
@@ -2726,12 +2974,11 @@ double ParsedPli::getThickRatio() const { return imp->m_thickRatio; }
 /*=====================================================================*/
 
 ParsedPliImp::~ParsedPliImp() {
-  TagElem *tag = m_firstTag;
-  while (tag) {
-    TagElem *auxTag = tag;
-    tag             = tag->m_next;
-    delete auxTag;
-  }
+  deleteTags(m_firstTag);
+
+  std::map<std::thread::id, TagElem *>::iterator it;
+  for (it = m_frameTags.begin(); it != m_frameTags.end(); ++it)
+    deleteTags(it->second);
 }
 
 /*=====================================================================*/
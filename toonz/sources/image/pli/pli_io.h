@@ -80,6 +80,7 @@ public:
     OUTLINE_OPTIONS_GOBJ,
     PRECISION_SCALE_GOBJ,
     AUTOCLOSE_TOLERANCE_GOBJ,
+    FRAME_INDEX_CNTRL,
     // ...
     HOW_MANY_TAG_TYPES
   };
@@ -474,6 +475,11 @@ public:
 
   void loadInfo(bool readPalette, TPalette *&palette,
                 TContentHistory *&history);
+  /*!
+    Parses the specified frame. The returned tags are owned by the ParsedPli,
+    and are valid until the next loadFrame() call from the same thread -
+    different threads may load frames concurrently.
+  */
   ImageTag *loadFrame(const TFrameId &frameId);
   const TFrameId &getFrameNumber(int index);
   int getFrameCount() const;
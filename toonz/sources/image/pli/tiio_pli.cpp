@@ -361,8 +361,11 @@ TImageP TImageReaderPli::doLoad() {
   if (!imageTag)
     throw TImageException(m_path, "Corrupted or invalid image data");
 
-  if (m_lrp->m_mapOfImage[m_frameId].second == false)
-    m_lrp->m_mapOfImage[m_frameId].second = true;
+  {
+    QMutexLocker locker(&m_lrp->m_mutex);
+    if (m_lrp->m_mapOfImage[m_frameId].second == false)
+      m_lrp->m_mapOfImage[m_frameId].second = true;
+  }
 
   // per tutti gli oggetti presenti nel tag
   for (i = 0; i < imageTag->m_numObjects; i++) {
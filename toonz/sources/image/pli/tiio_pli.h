@@ -7,6 +7,8 @@
 
 #include "tlevel_io.h"
 
+#include <QMutex>
+
 class GroupTag;
 class ParsedPli;
 class ImageTag;
@@ -92,6 +94,8 @@ private:
   bool m_init;
   //! struct which contains reference to frame
   std::map<TFrameId, pliFrameInfo> m_mapOfImage;
+  //! frames may be loaded concurrently
+  QMutex m_mutex;
 
   //! Reference to pli palette
   TPixel *m_palette;
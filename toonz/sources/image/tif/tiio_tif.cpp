@@ -10,6 +10,8 @@
 #endif
 
 #include <memory>
+#include <atomic>
+#include <functional>
 
 #include "tiio.h"
 #include "tpixel.h"
@@ -33,23 +35,198 @@ extern "C" {
 #include "windows.h"
 #endif
 
+#include <QMutex>
+#include <QRunnable>
+#include <QSemaphore>
+#include <QThreadPool>
+
+//**************************************************************************
+//    Local namespace stuff
+//**************************************************************************
+
+namespace {
+
+// Upper bound to the size of the strips decoded in advance
+const int maxStripsBufferSize = 64 << 20;
+
+//------------------------------------------------------------
+
+//! A file descriptor shared by the TIFF handles decoding the strips of an
+//! image from different threads. Reads are serialized, decoding is not.
+struct SharedFile {
+  int m_fd;
+  QMutex m_mutex;
+};
+
+struct SharedFileHandle {
+  SharedFile *m_file;
+  TINT64 m_pos;
+};
+
+//------------------------------------------------------------
+
+inline TINT64 seekFd(int fd, TINT64 offset, int whence) {
+#ifdef _WIN32
+  return _lseeki64(fd, offset, whence);
+#else
+  return lseek(fd, offset, whence);
+#endif
+}
+
+//------------------------------------------------------------
+
+tmsize_t sharedReadProc(thandle_t h, void *buf, tmsize_t size) {
+  SharedFileHandle *fh = (SharedFileHandle *)h;
+  QMutexLocker locker(&fh->m_file->m_mutex);
+
+  if (seekFd(fh->m_file->m_fd, fh->m_pos, SEEK_SET) < 0) return -1;
+
+  tmsize_t count = 0;
+  while (count < size) {
+    int ret = read(fh->m_file->m_fd, (char *)buf + count,
+                   (unsigned int)std::min<tmsize_t>(size - count, 1 << 30));
+    if (ret <= 0) break;
+
+    count += ret;
+  }
+
+  fh->m_pos += count;
+  return count;
+}
+
+tmsize_t sharedWriteProc(thandle_t, void *, tmsize_t) { return -1; }
+
+toff_t sharedSizeProc(thandle_t h) {
+  SharedFileHandle *fh = (SharedFileHandle *)h;
+  QMutexLocker locker(&fh->m_file->m_mutex);
+
+  return (toff_t)seekFd(fh->m_file->m_fd, 0, SEEK_END);
+}
+
+toff_t sharedSeekProc(thandle_t h, toff_t offset, int whence) {
+  SharedFileHandle *fh = (SharedFileHandle *)h;
+
+  switch (whence) {
+  case SEEK_SET:
+    fh->m_pos = offset;
+    break;
+  case SEEK_CUR:
+    fh->m_pos += offset;
+    break;
+  case SEEK_END:
+    fh->m_pos = sharedSizeProc(h) + offset;
+    break;
+  }
+
+  return fh->m_pos;
+}
+
+int sharedCloseProc(thandle_t h) {
+  delete (SharedFileHandle *)h;
+  return 0;
+}
+
+int sharedMapProc(thandle_t, void **, toff_t *) { return 0; }
+
+void sharedUnmapProc(thandle_t, void *, toff_t) {}
+
+//------------------------------------------------------------
+
+//! Converts a row of 8-bit RGB(A) samples to the TIFFReadRGBAStrip() layout.
+void convertRow(const UCHAR *in, uint32 *out, int lx, int spp,
+                bool premultiply) {
+  const uint32 *end = out + lx;
+
+  if (spp == 3) {
+    for (; out != end; ++out, in += 3)
+      *out = in[0] | (in[1] << 8) | (in[2] << 16) | 0xff000000;
+  } else if (premultiply) {
+    for (; out != end; ++out, in += 4) {
+      uint32 a = in[3];
+      uint32 r = (in[0] * a + 127) / 255, g = (in[1] * a + 127) / 255,
+             b = (in[2] * a + 127) / 255;
+
+      *out = r | (g << 8) | (b << 16) | (a << 24);
+    }
+  } else {
+    for (; out != end; ++out, in += 4)
+      *out = in[0] | (in[1] << 8) | (in[2] << 16) | ((uint32)in[3] << 24);
+  }
+}
+
+//------------------------------------------------------------
+
+//! Converts a row of 16-bit RGB(A) samples to the TIFFReadRGBAStrip_64()
+//! layout.
+void convertRow(const USHORT *in, USHORT *out, int lx, int spp) {
+  const USHORT *end = out + 4 * lx;
+
+  for (; out != end; out += 4, in += spp) {
+    out[0] = in[0], out[1] = in[1], out[2] = in[2];
+    out[3] = (spp == 4) ? in[3] : 0xffff;
+  }
+}
+
+//------------------------------------------------------------
+
+class DecodeTask final : public QRunnable {
+  std::function<void()> m_decode;
+  QSemaphore *m_done;
+
+public:
+  DecodeTask(const std::function<void()> &decode, QSemaphore *done)
+      : m_decode(decode), m_done(done) {}
+
+  void run() override {
+    m_decode();
+    m_done->release();
+  }
+};
+
+//------------------------------------------------------------
+
+//! Returns the pool decoding the strips of tif images, distinct from the
+//! global one so that decoding does not queue behind unrelated tasks.
+QThreadPool *decodePool() {
+  static QThreadPool pool;
+  return &pool;
+}
+
+}  // namespace
+
 //**************************************************************************
 //    TifReader  implementation
 //**************************************************************************
 
 class TifReader final : public Tiio::Reader {
   TIFF *m_tiff;
+  int m_fd;
   int m_row;
   bool m_tiled, m_stripped;
   int m_rowsPerStrip;
-  int m_stripIndex;
   int m_rowLength;
-  UCHAR *m_stripBuffer;
   double m_xdpi, m_ydpi;
   Tiio::RowOrder m_rowOrder;
   bool is16bitEnabled;
   bool m_isTzi;
+
+  // Strips are decoded in batches, in parallel, into m_tmpRas
   TRasterGR8P m_tmpRas;
+  UCHAR *m_stripBuffer;
+  int m_stripSize;  //!< Bytes of each strip in the buffer
+  int m_firstStrip, m_stripsCount;
+  bool m_strips64;
+  int m_stripsX0, m_stripsX1;  //!< Columns held by the buffered strips
+
+  int m_x0, m_x1, m_lastRow;  //!< Read region, see setReadRegion()
+
+  // Strips of plain RGB(A) images are decoded without the libtiff RGBA
+  // conversion
+  bool m_nativeStrips, m_bottomUp, m_premultiply;
+  int m_spp;
+
+  SharedFile m_sharedFile;
+  std::vector<TIFF *> m_decodeTiffs;
 
 public:
   TifReader(bool isTzi);
@@ -64,31 +241,59 @@ public:
   void enable16BitRead(bool enabled) override { is16bitEnabled = enabled; }
 
   int skipLines(int lineCount) override;
+  void setReadRegion(int x0, int row0, int x1, int row1) override;
   void readLine(char *buffer, int x0, int x1, int shrink) override;
   void readLine(short *buffer, int x0, int x1, int shrink) override;
+
+private:
+  void checkNativeStrips();
+
+  TIFF *getDecodeTiff(int index);
+  UCHAR *getStrip(int stripIndex, bool is64);
+  void decodeStrips(int firstStrip, int count, bool is64);
+  void decodeStrip(TIFF *tiff, int stripIndex, UCHAR *buffer, bool is64,
+                   std::vector<UCHAR> &samples);
 };
 
 //------------------------------------------------------------
 
 TifReader::TifReader(bool isTzi)
     : m_tiff(0)
+    , m_fd(-1)
     , m_row(0)
     , m_rowsPerStrip(0)
-    , m_stripIndex(-1)
-    //, m_stripBuffer(0)
     , m_rowLength(0)
     , m_xdpi(0)
     , m_ydpi(0)
     , m_rowOrder(Tiio::TOP2BOTTOM)
     , is16bitEnabled(true)
     , m_isTzi(isTzi)
-    , m_tmpRas(0) {
+    , m_tmpRas(0)
+    , m_stripBuffer(0)
+    , m_stripSize(0)
+    , m_firstStrip(0)
+    , m_stripsCount(0)
+    , m_strips64(false)
+    , m_stripsX0(0)
+    , m_stripsX1(-1)
+    , m_x0(0)
+    , m_x1(-1)
+    , m_lastRow(-1)
+    , m_nativeStrips(false)
+    , m_bottomUp(false)
+    , m_premultiply(false)
+    , m_spp(0) {
   TIFFSetWarningHandler(0);
+  m_sharedFile.m_fd = -1;
 }
 
 //------------------------------------------------------------
 
 TifReader::~TifReader() {
+  for (TIFF *tiff : m_decodeTiffs)
+    if (tiff) TIFFClose(tiff);
+  if (m_sharedFile.m_fd >= 0) close(m_sharedFile.m_fd);
+
   if (m_tiff) TIFFClose(m_tiff);
 
   if (m_tmpRas) m_tmpRas->unlock();
@@ -99,7 +304,7 @@ TifReader::~TifReader() {
 //------------------------------------------------------------
 
 void TifReader::open(FILE *file) {
-  int fd = fileno(file);
+  int fd = m_fd = fileno(file);
 #if 0
 	m_tiff = TIFFFdOpenNoCloseProc(fd, "", "rb");
 #elif defined(_WIN32) && defined(__GNUC__)
@@ -337,12 +542,7 @@ break;*/
     // m_rowLength = tileWidth * tilesPerRow;
     m_rowLength   = m_info.m_lx;
     int pixelSize = bps == 16 ? 8 : 4;
-    int stripSize = m_rowsPerStrip * m_rowLength * pixelSize;
-
-    m_tmpRas = TRasterGR8P(stripSize, 1);
-    m_tmpRas->lock();
-
-    m_stripBuffer = m_tmpRas->getRawData();
+    m_stripSize   = m_rowsPerStrip * m_rowLength * pixelSize;
   } else {
     m_rowsPerStrip = rps;
     // if(m_rowsPerStrip<=0) m_rowsPerStrip = 1;			//potrei
@@ -354,18 +554,17 @@ break;*/
 
     if (m_rowsPerStrip <= 0) m_rowsPerStrip = m_info.m_ly;
 
-    int stripSize = m_rowsPerStrip * w * 4;  // + 4096;  TIFFStripSize(m_tiff);
+    m_stripSize = m_rowsPerStrip * w * 4;  // + 4096;  TIFFStripSize(m_tiff);
 
-    if (bps == 16) stripSize *= 2;
-
-    m_tmpRas = TRasterGR8P(stripSize, 1);
-    m_tmpRas->lock();
-
-    m_stripBuffer = m_tmpRas->getRawData();
+    if (bps == 16) m_stripSize *= 2;
 
     m_rowLength = m_info.m_lx;  // w;
   }
 
+  m_x1      = m_info.m_lx - 1;
+  m_lastRow = m_info.m_ly - 1;
+  checkNativeStrips();
+
   /*
 int TIFFTileRowSize(m_tiff);
 
@@ -420,67 +619,244 @@ int TifReader::skipLines(int lineCount) {
 
 //------------------------------------------------------------
 
-#include "timage_io.h"
+void TifReader::setReadRegion(int x0, int row0, int x1, int row1) {
+  m_x0      = std::max(x0, 0);
+  m_x1      = std::min(x1, m_info.m_lx - 1);
+  m_lastRow = std::min(row1, m_info.m_ly - 1);
+}
 
-void TifReader::readLine(short *buffer, int x0, int x1, int shrink) {
-  assert(shrink > 0);
+//------------------------------------------------------------
 
-  const int pixelSize = 8;
-  int stripRowSize    = m_rowLength * pixelSize;
+//! Checks whether strips can be decoded directly to the layout returned by
+//! the TIFFReadRGBA*() functions, which is the case of uncompressed-or-not
+//! 8 and 16-bit RGB(A) images stored by rows.
+void TifReader::checkNativeStrips() {
+  m_nativeStrips = false;
+  if (TIFFIsTiled(m_tiff)) return;
+
+  uint16 bps = 0, spp = 0, photometric = 0, planar = 0, sampleFormat = 0,
+         orient = 0, extraCount = 0, *extraTypes = 0;
+  TIFFGetFieldDefaulted(m_tiff, TIFFTAG_BITSPERSAMPLE, &bps);
+  TIFFGetFieldDefaulted(m_tiff, TIFFTAG_SAMPLESPERPIXEL, &spp);
+  TIFFGetField(m_tiff, TIFFTAG_PHOTOMETRIC, &photometric);
+  TIFFGetFieldDefaulted(m_tiff, TIFFTAG_PLANARCONFIG, &planar);
+  TIFFGetFieldDefaulted(m_tiff, TIFFTAG_SAMPLEFORMAT, &sampleFormat);
+  TIFFGetFieldDefaulted(m_tiff, TIFFTAG_ORIENTATION, &orient);
+  TIFFGetFieldDefaulted(m_tiff, TIFFTAG_EXTRASAMPLES, &extraCount,
+                        &extraTypes);
+
+  if (photometric != PHOTOMETRIC_RGB || planar != PLANARCONFIG_CONTIG ||
+      sampleFormat != SAMPLEFORMAT_UINT || (bps != 8 && bps != 16) ||
+      (orient != ORIENTATION_TOPLEFT && orient != ORIENTATION_BOTLEFT))
+    return;
 
-  if (m_row < m_info.m_y0 || m_row > m_info.m_y1) {
-    memset(buffer, 0, (x1 - x0 + 1) * pixelSize);
-    m_row++;
+  if (spp == 4 && extraCount == 1)
+    // Like libtiff, only 8-bit unassociated alpha gets premultiplied
+    m_premultiply = (bps == 8 && extraTypes[0] == EXTRASAMPLE_UNASSALPHA);
+  else if (spp != 3 || extraCount != 0)
+    return;
+
+  m_nativeStrips = true;
+  m_bottomUp     = (orient == ORIENTATION_BOTLEFT);
+  m_spp          = spp;
+}
+
+//------------------------------------------------------------
+
+//! Returns the handle decoding strips from the specified pool thread, or 0
+//! if it could not be opened.
+TIFF *TifReader::getDecodeTiff(int index) {
+  if (index < (int)m_decodeTiffs.size()) return m_decodeTiffs[index];
+
+  if (m_sharedFile.m_fd < 0) {
+    m_sharedFile.m_fd = dup(m_fd);
+    if (m_sharedFile.m_fd < 0) return 0;
+  }
+
+  SharedFileHandle *handle = new SharedFileHandle;
+  handle->m_file           = &m_sharedFile;
+  handle->m_pos            = 0;
+
+  // The handle is deleted by the close proc, even on failure
+  TIFF *tiff = TIFFClientOpen("", "rm", (thandle_t)handle, sharedReadProc,
+                              sharedWriteProc, sharedSeekProc, sharedCloseProc,
+                              sharedSizeProc, sharedMapProc, sharedUnmapProc);
+  m_decodeTiffs.push_back(tiff);
+
+  return tiff;
+}
+
+//------------------------------------------------------------
+
+//! Returns the strip holding the specified row, decoding it if necessary.
+//! Please, observe that strips are stored in the BOTTOM-UP orientation, as
+//! returned by the TIFF functions, no matter the internal tif's orientation
+//! storage.
+UCHAR *TifReader::getStrip(int stripIndex, bool is64) {
+  if (is64 != m_strips64 || stripIndex < m_firstStrip ||
+      stripIndex >= m_firstStrip + m_stripsCount || m_x0 < m_stripsX0 ||
+      m_x1 > m_stripsX1) {
+    // Decode the strips that will be read next, up to the buffer size
+    int lastStrip  = std::max(m_lastRow / m_rowsPerStrip, stripIndex);
+    int maxCount   = std::max(maxStripsBufferSize / m_stripSize, 1);
+    int stripCount = std::min(lastStrip - stripIndex + 1, maxCount);
+
+    decodeStrips(stripIndex, stripCount, is64);
+  }
+
+  return m_stripBuffer + (stripIndex - m_firstStrip) * m_stripSize;
+}
+
+//------------------------------------------------------------
+
+void TifReader::decodeStrips(int firstStrip, int count, bool is64) {
+  if (!m_tmpRas || m_tmpRas->getLx() < count * m_stripSize) {
+    if (m_tmpRas) m_tmpRas->unlock();
+
+    m_tmpRas = TRasterGR8P(count * m_stripSize, 1);
+    m_tmpRas->lock();
+
+    m_stripBuffer = m_tmpRas->getRawData();
+  }
+
+  m_firstStrip  = firstStrip;
+  m_stripsCount = count;
+  m_strips64    = is64;
+
+  // Tiled images are decoded only in the tiles covering the read region
+  bool tiled = TIFFIsTiled(m_tiff);
+  m_stripsX0 = tiled ? m_x0 : 0;
+  m_stripsX1 = tiled ? m_x1 : m_info.m_lx - 1;
+
+  // Each thread decodes through a distinct handle, since TIFF handles are
+  // not thread-safe
+  std::vector<TIFF *> tiffs;
+
+  int t, threadsCount = std::min(count, decodePool()->maxThreadCount());
+  if (threadsCount > 1)
+    for (t = 0; t < threadsCount; ++t) {
+      TIFF *tiff = getDecodeTiff(t);
+      if (!tiff) break;
+
+      tiffs.push_back(tiff);
+    }
+
+  if (tiffs.size() < 2) {
+    std::vector<UCHAR> samples;
+    for (int s = 0; s < count; ++s)
+      decodeStrip(m_tiff, firstStrip + s, m_stripBuffer + s * m_stripSize,
+                  is64, samples);
     return;
   }
 
-  int stripIndex = m_row / m_rowsPerStrip;
-  if (m_stripIndex != stripIndex) {
-    // Retrieve the strip holding current row. Please, observe that
-    // TIFF functions will return the strip buffer in the BOTTOM-UP orientation,
-    // no matter the internal tif's orientation storage
+  std::atomic<int> nextStrip(0);
 
-    m_stripIndex = stripIndex;
+  auto decode = [&](TIFF *tiff) {
+    std::vector<UCHAR> samples;
 
-    if (TIFFIsTiled(m_tiff)) {
-      // Retrieve tiles size
-      uint32 tileWidth = 0, tileHeight = 0;
-      TIFFGetField(m_tiff, TIFFTAG_TILEWIDTH, &tileWidth);
-      TIFFGetField(m_tiff, TIFFTAG_TILELENGTH, &tileHeight);
-      assert(tileWidth > 0 && tileHeight > 0);
+    int s;
+    while ((s = nextStrip++) < count)
+      decodeStrip(tiff, firstStrip + s, m_stripBuffer + s * m_stripSize, is64,
+                  samples);
+  };
 
-      // Allocate a sufficient buffer to store a single tile
-      int tileSize = tileWidth * tileHeight;
-      std::unique_ptr<uint64[]> tile(new uint64[tileSize]);
+  // The calling thread takes part in decoding
+  QSemaphore done;
+  for (t = 1; t < (int)tiffs.size(); ++t)
+    decodePool()->start(new DecodeTask(std::bind(decode, tiffs[t]), &done));
 
-      int x = 0;
-      int y = tileHeight * m_stripIndex;
+  decode(tiffs[0]);
+  done.acquire((int)tiffs.size() - 1);
+}
 
-      // In case it's the last tiles row, the tile size might exceed the image
-      // bounds
-      int lastTy = std::min((int)tileHeight, m_info.m_ly - y);
+//------------------------------------------------------------
 
-      // Traverse the tiles row
-      while (x < m_info.m_lx) {
-        int ret = TIFFReadRGBATile_64(m_tiff, x, y, tile.get());
-        assert(ret);
+void TifReader::decodeStrip(TIFF *tiff, int stripIndex, UCHAR *buffer,
+                            bool is64, std::vector<UCHAR> &samples) {
+  const int pixelSize = is64 ? 8 : 4;
 
-        int tileRowSize = std::min((int)tileWidth, m_info.m_lx - x) * pixelSize;
+  if (TIFFIsTiled(tiff)) {
+    // Retrieve tiles size
+    uint32 tileWidth = 0, tileHeight = 0;
+    TIFFGetField(tiff, TIFFTAG_TILEWIDTH, &tileWidth);
+    TIFFGetField(tiff, TIFFTAG_TILELENGTH, &tileHeight);
+    assert(tileWidth > 0 && tileHeight > 0);
 
-        // Copy the tile rows in the corresponding output strip rows
-        for (int ty = 0; ty < lastTy; ++ty) {
-          memcpy(m_stripBuffer + (ty * m_rowLength + x) * pixelSize,
-                 (UCHAR *)tile.get() + ty * tileWidth * pixelSize, tileRowSize);
-        }
+    // Allocate a sufficient buffer to store a single tile
+    int tileSize = tileWidth * tileHeight;
+    std::unique_ptr<uint64[]> tile(new uint64[tileSize]);
 
-        x += tileWidth;
+    int y = tileHeight * stripIndex;
+
+    // In case it's the last tiles row, the tile size might exceed the image
+    // bounds
+    int lastTy = std::min((int)tileHeight, m_info.m_ly - y);
+
+    // Traverse the tiles row, skipping the tiles outside the read region
+    for (int x = m_x0 - m_x0 % (int)tileWidth; x <= m_x1; x += tileWidth) {
+      int ret = is64 ? TIFFReadRGBATile_64(tiff, x, y, tile.get())
+                     : TIFFReadRGBATile(tiff, x, y, (uint32 *)tile.get());
+      assert(ret);
+
+      int tileRowSize = std::min((int)tileWidth, m_info.m_lx - x) * pixelSize;
+
+      // Copy the tile rows in the corresponding output strip rows
+      for (int ty = 0; ty < lastTy; ++ty) {
+        memcpy(buffer + (ty * m_rowLength + x) * pixelSize,
+               (UCHAR *)tile.get() + ty * tileWidth * pixelSize, tileRowSize);
       }
-    } else {
-      int y  = m_rowsPerStrip * m_stripIndex;
-      int ok = TIFFReadRGBAStrip_64(m_tiff, y, (uint64 *)m_stripBuffer);
-      assert(ok);
     }
+  } else if (m_nativeStrips && is64 == (m_info.m_bitsPerSample == 16)) {
+    tmsize_t rowSize = TIFFScanlineSize(tiff);
+    samples.resize(TIFFStripSize(tiff));
+
+    tmsize_t size =
+        TIFFReadEncodedStrip(tiff, stripIndex, &samples[0], samples.size());
+    assert(size > 0);
+
+    int rowsCount =
+        std::min(m_rowsPerStrip, m_info.m_ly - m_rowsPerStrip * stripIndex);
+    if (size < rowsCount * rowSize)
+      rowsCount = (int)(std::max<tmsize_t>(size, 0) / rowSize);
+
+    // Rows are stored bottom-up, as TIFFReadRGBAStrip() does
+    for (int r = 0; r < rowsCount; ++r) {
+      int row     = m_bottomUp ? r : rowsCount - 1 - r;
+      UCHAR *line = buffer + row * m_rowLength * pixelSize;
+
+      if (is64)
+        convertRow((USHORT *)&samples[r * rowSize], (USHORT *)line, m_info.m_lx,
+                   m_spp);
+      else
+        convertRow(&samples[r * rowSize], (uint32 *)line, m_info.m_lx, m_spp,
+                   m_premultiply);
+    }
+  } else {
+    int y  = m_rowsPerStrip * stripIndex;
+    int ok = is64 ? TIFFReadRGBAStrip_64(tiff, y, (uint64 *)buffer)
+                  : TIFFReadRGBAStrip(tiff, y, (uint32 *)buffer);
+    assert(ok);
   }
+}
+
+//------------------------------------------------------------
+
+#include "timage_io.h"
+
+void TifReader::readLine(short *buffer, int x0, int x1, int shrink) {
+  assert(shrink > 0);
+
+  const int pixelSize = 8;
+  int stripRowSize    = m_rowLength * pixelSize;
+
+  if (m_row < m_info.m_y0 || m_row > m_info.m_y1) {
+    memset(buffer, 0, (x1 - x0 + 1) * pixelSize);
+    m_row++;
+    return;
+  }
+
+  int stripIndex     = m_row / m_rowsPerStrip;
+  UCHAR *stripBuffer = getStrip(stripIndex, true);
 
   uint16 orient = ORIENTATION_TOPLEFT;
   TIFFGetField(m_tiff, TIFFTAG_ORIENTATION, &orient);
@@ -500,7 +876,7 @@ void TifReader::readLine(short *buffer, int x0, int x1, int shrink) {
     // necessarily at
     // m_rowsPerStrip multiples). So, we must adjust for that.
 
-    r = std::min(m_rowsPerStrip, m_info.m_ly - m_rowsPerStrip * m_stripIndex) -
+    r = std::min(m_rowsPerStrip, m_info.m_ly - m_rowsPerStrip * stripIndex) -
         1 - (m_row % m_rowsPerStrip);
     break;
 
@@ -514,7 +890,7 @@ void TifReader::readLine(short *buffer, int x0, int x1, int shrink) {
 
   // Finally, copy the strip row to the output row buffer
   TPixel64 *pix = (TPixel64 *)buffer;
-  USHORT *v     = (USHORT *)(m_stripBuffer + r * stripRowSize);
+  USHORT *v     = (USHORT *)(stripBuffer + r * stripRowSize);
 
   pix += x0;
   v += 4 * x0;
@@ -572,44 +948,8 @@ void TifReader::readLine(char *buffer, int x0, int x1, int shrink) {
     return;
   }
 
-  int stripIndex = m_row / m_rowsPerStrip;
-  if (m_stripIndex != stripIndex) {
-    m_stripIndex = stripIndex;
-
-    if (TIFFIsTiled(m_tiff)) {
-      uint32 tileWidth = 0, tileHeight = 0;
-      TIFFGetField(m_tiff, TIFFTAG_TILEWIDTH, &tileWidth);
-      TIFFGetField(m_tiff, TIFFTAG_TILELENGTH, &tileHeight);
-      assert(tileWidth > 0 && tileHeight > 0);
-
-      int tileSize = tileWidth * tileHeight;
-      std::unique_ptr<uint32[]> tile(new uint32[tileSize]);
-
-      int x = 0;
-      int y = tileHeight * m_stripIndex;
-
-      int lastTy = std::min((int)tileHeight, m_info.m_ly - y);
-
-      while (x < m_info.m_lx) {
-        int ret = TIFFReadRGBATile(m_tiff, x, y, tile.get());
-        assert(ret);
-
-        int tileRowSize =
-            std::min((int)tileWidth, (int)(m_info.m_lx - x)) * pixelSize;
-
-        for (int ty = 0; ty < lastTy; ++ty) {
-          memcpy(m_stripBuffer + (ty * m_rowLength + x) * pixelSize,
-                 (UCHAR *)tile.get() + ty * tileWidth * pixelSize, tileRowSize);
-        }
-
-        x += tileWidth;
-      }
-    } else {
-      int y  = m_rowsPerStrip * m_stripIndex;
-      int ok = TIFFReadRGBAStrip(m_tiff, y, (uint32 *)m_stripBuffer);
-      assert(ok);
-    }
-  }
+  int stripIndex     = m_row / m_rowsPerStrip;
+  UCHAR *stripBuffer = getStrip(stripIndex, false);
 
   uint16 orient = ORIENTATION_TOPLEFT;
   TIFFGetField(m_tiff, TIFFTAG_ORIENTATION, &orient);
@@ -629,7 +969,7 @@ void TifReader::readLine(char *buffer, int x0, int x1, int shrink) {
     // necessarily at
     // m_rowsPerStrip multiples). So, we must adjust for that.
 
-    r = std::min(m_rowsPerStrip, m_info.m_ly - m_rowsPerStrip * m_stripIndex) -
+    r = std::min(m_rowsPerStrip, m_info.m_ly - m_rowsPerStrip * stripIndex) -
         1 - (m_row % m_rowsPerStrip);
     break;
 
@@ -642,7 +982,7 @@ void TifReader::readLine(char *buffer, int x0, int x1, int shrink) {
   }
 
   TPixel32 *pix = (TPixel32 *)buffer;
-  uint32 *v     = (uint32 *)(m_stripBuffer + r * stripRowSize);
+  uint32 *v     = (uint32 *)(stripBuffer + r * stripRowSize);
 
   pix += x0;
   v += x0;
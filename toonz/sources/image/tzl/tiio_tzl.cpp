@@ -20,6 +20,19 @@
 #include "trasterimage.h"
 
 #include <QByteArray>
+#include <QDateTime>
+#include <QFileInfo>
+#include <QMutex>
+#include <QSaveFile>
+#include <QThreadPool>
+
+#include <cstdlib>
+
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
 
 #if !defined(TNZ_LITTLE_ENDIAN)
 TNZ_LITTLE_ENDIAN undefined !!
@@ -103,8 +116,6 @@ static int tfwrite(double *data, unsigned int count, FILE *f) {
 
 namespace {
 
-bool erasedFrame;  // True if at least one frame has been removed.
-
 bool writeVersionAndCreator(FILE *chan, const char *version, QString creator) {
   if (!chan) return false;
   tfwrite(version, strlen(version), chan);
@@ -297,6 +308,256 @@ bool readHeaderAndOffsets(FILE *chan, TzlOffsetMap &frameOffsTable,
 
   return true;
 }
+
+//-------------------------------------------------------------------
+
+//! Header data and offset tables of the TLV files already opened by level
+//! readers, so that further readers of the same file (e.g. one per render
+//! thread) need not parse them again. An entry is valid as long as the size
+//! and modification time of its file are unchanged.
+class IndexCache {
+public:
+  struct Index {
+    qint64 m_size;
+    QDateTime m_lastModified;
+
+    TzlOffsetMap m_frameOffsTable, m_iconOffsTable;
+    TDimension m_res;
+    int m_version;
+    QString m_creator;
+  };
+
+private:
+  QMutex m_mutex;
+  std::map<QString, Index> m_indices;
+
+public:
+  static IndexCache *instance() {
+    static IndexCache theInstance;
+    return &theInstance;
+  }
+
+  bool get(const QFileInfo &fi, Index &index) {
+    QMutexLocker locker(&m_mutex);
+
+    std::map<QString, Index>::iterator it =
+        m_indices.find(fi.absoluteFilePath());
+    if (it == m_indices.end()) return false;
+
+    if (it->second.m_size != fi.size() ||
+        it->second.m_lastModified != fi.lastModified()) {
+      m_indices.erase(it);
+      return false;
+    }
+
+    index = it->second;
+    return true;
+  }
+
+  void set(const QFileInfo &fi, Index &index) {
+    index.m_size         = fi.size();
+    index.m_lastModified = fi.lastModified();
+
+    QMutexLocker locker(&m_mutex);
+    m_indices[fi.absoluteFilePath()] = index;
+  }
+
+  void remove(const TFilePath &fp) {
+    QMutexLocker locker(&m_mutex);
+    m_indices.erase(QFileInfo(fp.getQString()).absoluteFilePath());
+  }
+};
+
+//-------------------------------------------------------------------
+
+void appendTINT32(QByteArray &data, TINT32 value) {
+#if !TNZ_LITTLE_ENDIAN
+  value = swapTINT32(value);
+#endif
+  data.append((const char *)&value, sizeof(TINT32));
+}
+
+//-------------------------------------------------------------------
+
+//! Returns the specified offset table, in the format of the file version.
+QByteArray offsetTableData(const TzlOffsetMap &table, int version) {
+  QByteArray data;
+
+  TzlOffsetMap::const_iterator it;
+  for (it = table.begin(); it != table.end(); ++it) {
+    QByteArray suffix = it->first.getLetter().toUtf8();
+
+    appendTINT32(data, it->first.getNumber());
+    if (version >= 15) {  // write the suffix length before data
+      appendTINT32(data, suffix.size());
+      data.append(suffix);
+    } else  // write only the first byte
+      data.append(suffix.constData(), 1);
+    appendTINT32(data, it->second.m_offs);
+    appendTINT32(data, it->second.m_length);
+  }
+
+  return data;
+}
+
+//-------------------------------------------------------------------
+
+//! Flushes the buffered data of the file down to the disk.
+void flushFile(FILE *chan) {
+  fflush(chan);
+#ifdef _WIN32
+  _commit(_fileno(chan));
+#else
+  fsync(fileno(chan));
+#endif
+}
+
+//-------------------------------------------------------------------
+
+//! Compacts TLV files in a background thread. Compaction copies the chunks
+//! still referenced by the offset tables as they are - without decoding
+//! them - to a new file, which atomically replaces the original one. Files
+//! are never compacted while a writer has them open.
+class Compactor {
+  class Task final : public QRunnable {
+    TFilePath m_path;
+
+  public:
+    Task(const TFilePath &path) : m_path(path) {}
+    void run() override;
+  };
+
+  QMutex m_mutex;  //!< Held by compactions for their whole duration
+  std::map<QString, int> m_writersCount;
+  QThreadPool m_pool;
+
+public:
+  Compactor() { m_pool.setMaxThreadCount(1); }
+
+  static Compactor *instance() {
+    static Compactor theInstance;
+    return &theInstance;
+  }
+
+  void addWriter(const TFilePath &fp) {
+    QMutexLocker locker(&m_mutex);
+    ++m_writersCount[QFileInfo(fp.getQString()).absoluteFilePath()];
+  }
+
+  void removeWriter(const TFilePath &fp) {
+    QMutexLocker locker(&m_mutex);
+
+    std::map<QString, int>::iterator it =
+        m_writersCount.find(QFileInfo(fp.getQString()).absoluteFilePath());
+    if (it != m_writersCount.end() && --it->second <= 0)
+      m_writersCount.erase(it);
+  }
+
+  void compact(const TFilePath &fp) { m_pool.start(new Task(fp)); }
+
+private:
+  static bool compactFile(const TFilePath &fp);
+};
+
+//-------------------------------------------------------------------
+
+void Compactor::Task::run() {
+  Compactor *compactor = Compactor::instance();
+  QMutexLocker locker(&compactor->m_mutex);
+
+  if (compactor->m_writersCount.count(
+          QFileInfo(m_path.getQString()).absoluteFilePath()))
+    return;
+
+  compactFile(m_path);
+}
+
+//-------------------------------------------------------------------
+
+bool Compactor::compactFile(const TFilePath &fp) {
+  QFileInfo fi(fp.getQString());
+  qint64 size            = fi.size();
+  QDateTime lastModified = fi.lastModified();
+
+  FILE *chan = fopen(fp, "rb");
+  if (!chan) return false;
+
+  TzlOffsetMap frameOffsTable, iconOffsTable;
+  TDimension res;
+  int version = 0;
+  QString creator;
+  if (!readHeaderAndOffsets(chan, frameOffsTable, iconOffsTable, res, version,
+                            creator, 0, 0, 0, 0) ||
+      version < 13) {
+    fclose(chan);
+    return false;
+  }
+
+  // MAGIC [CREATOR] HDR_SIZE LX LY FRAME_COUNT OFFSET_TABLE_POS
+  // ICON_OFFSET_TABLE_POS CODEC
+  TINT32 tablesPosPos = 8 + (version >= 14 ? CREATOR_LENGTH : 0) +
+                        4 * sizeof(TINT32);
+  TINT32 pos = tablesPosPos + 2 * sizeof(TINT32) + 4 * sizeof(char);
+
+  QSaveFile file(fp.getQString());
+  if (!file.open(QIODevice::WriteOnly)) {
+    fclose(chan);
+    return false;
+  }
+
+  std::vector<char> buffer(pos);
+
+  auto copy = [&](TINT32 offs, TINT32 length) {
+    buffer.resize(length);
+    return length > 0 && fseek(chan, offs, SEEK_SET) == 0 &&
+           fread(&buffer[0], length, 1, chan) == 1 &&
+           file.write(&buffer[0], length) == length;
+  };
+
+  bool ok = copy(0, pos);
+
+  // Each frame is followed by its icon, as in files saved from scratch
+  TzlOffsetMap newFrameOffsTable, newIconOffsTable;
+
+  TzlOffsetMap::iterator it, iconIt;
+  for (it = frameOffsTable.begin(); ok && it != frameOffsTable.end(); ++it) {
+    iconIt = iconOffsTable.find(it->first);
+    ok     = iconIt != iconOffsTable.end() &&
+         copy(it->second.m_offs, it->second.m_length) &&
+         copy(iconIt->second.m_offs, iconIt->second.m_length);
+    if (!ok) break;
+
+    newFrameOffsTable[it->first] = TzlChunk(pos, it->second.m_length);
+    pos += it->second.m_length;
+    newIconOffsTable[it->first] = TzlChunk(pos, iconIt->second.m_length);
+    pos += iconIt->second.m_length;
+  }
+
+  fclose(chan);
+
+  if (ok) {
+    QByteArray tables   = offsetTableData(newFrameOffsTable, version);
+    TINT32 iconTablePos = pos + tables.size();
+    tables += offsetTableData(newIconOffsTable, version);
+
+    QByteArray tablesPos;
+    appendTINT32(tablesPos, pos);
+    appendTINT32(tablesPos, iconTablePos);
+
+    ok = file.write(tables) == tables.size() && file.seek(tablesPosPos) &&
+         file.write(tablesPos) == tablesPos.size();
+  }
+
+  // Give up if the file was modified in the meantime
+  fi.refresh();
+  if (!ok || fi.size() != size || fi.lastModified() != lastModified) {
+    file.cancelWriting();
+    return false;
+  }
+
+  return file.commit();
+}
+
 }  // namespace
 
 static bool adjustIconAspectRatio(TDimension &outDimension,
@@ -446,6 +707,71 @@ public:
   RasType m_rasType;
 };
 
+//-------------------------------------------------------------------
+
+// Frame chunks start with SAVEBOX_X0 SAVEBOX_Y0 SAVEBOX_LX SAVEBOX_LY
+// BUFFER_SIZE XDPI YDPI, icon chunks with ICON_LX ICON_LY BUFFER_SIZE
+const TINT32 frameHeaderSize = 5 * sizeof(TINT32) + 2 * sizeof(double);
+const TINT32 iconHeaderSize  = 3 * sizeof(TINT32);
+
+//-------------------------------------------------------------------
+
+TINT32 readTINT32(const UCHAR *&data) {
+  TINT32 value;
+  memcpy(&value, data, sizeof(TINT32));
+  data += sizeof(TINT32);
+#if !TNZ_LITTLE_ENDIAN
+  value = swapTINT32(value);
+#endif
+  return value;
+}
+
+//-------------------------------------------------------------------
+
+double readDouble(const UCHAR *&data) {
+  double value;
+  memcpy(&value, data, sizeof(double));
+  data += sizeof(double);
+#if !TNZ_LITTLE_ENDIAN
+  reverse((char *)&value, sizeof(double));
+#endif
+  return value;
+}
+
+//-------------------------------------------------------------------
+
+//! Decompresses a raster buffer read from the file. On little endian
+//! machines the buffer is passed to the codec as is, without copies.
+bool decompressRaster(const UCHAR *buff, TINT32 buffSize, TRasterP &ras,
+                      bool safeMode) {
+#if !TNZ_LITTLE_ENDIAN
+  std::vector<UCHAR> swappedBuff(buff, buff + buffSize);
+  Header *header    = (Header *)&swappedBuff[0];
+  header->m_lx      = swapTINT32(header->m_lx);
+  header->m_ly      = swapTINT32(header->m_ly);
+  header->m_rasType = (Header::RasType)swapTINT32(header->m_rasType);
+  buff              = &swappedBuff[0];
+#endif
+
+  TRasterCodecLZO codec("LZO", false);
+  if (!codec.decompress(buff, buffSize, ras, safeMode)) return false;
+
+#if !TNZ_LITTLE_ENDIAN
+  ras->lock();
+  for (int y = 0; y < ras->getLy(); ++y) {
+    TINT32 *pix    = ((TINT32 *)ras->getRawData(0, y));
+    TINT32 *endPix = pix + ras->getLx();
+    while (pix < endPix) {
+      *pix = swapTINT32(*pix);
+      pix++;
+    }
+  }
+  ras->unlock();
+#endif
+
+  return true;
+}
+
 }  // namespace
 
 //-------------------------------------------------------------------
@@ -493,8 +819,8 @@ void TLevelWriterTzl::buildFreeChunksTable() {
   }
   assert(lastOccupiedPos < m_offsetTablePos);
   if (lastOccupiedPos + 1 < m_offsetTablePos)
-    m_freeChunks.insert(
-        TzlChunk(lastOccupiedPos + 1, m_offsetTablePos - lastOccupiedPos));
+    m_freeChunks.insert(TzlChunk(lastOccupiedPos + 1,
+                                 m_offsetTablePos - lastOccupiedPos - 1));
 }
 
 //===================================================================
@@ -517,7 +843,6 @@ TLevelWriterTzl::TLevelWriterTzl(const TFilePath &path, TPropertyGroup *info)
     , m_updatedIconsSize(false)
     , m_currentIconSize(0, 0)
     , m_iconSize(TDimension(80, 60))
-    , m_userIconSize(TDimension(80, 60))
     , m_adjustRatio(false)
     , m_codec(new TRasterCodecLZO("LZO", true))
     , m_overwritePaletteFlag(true) {
@@ -525,7 +850,6 @@ TLevelWriterTzl::TLevelWriterTzl(const TFilePath &path, TPropertyGroup *info)
   m_palettePath = path.withNoFrame().withType("tpl");
   TFileStatus fs(path);
   m_magic     = (m_version == 14) ? "TLV14B1a" : "TLV15B1a";  // actual version
-  erasedFrame = false;
   // version TLV10B1a: first version
   // version TLV11B1a: added frameIds
   // version TLV12B1a: incremental writings
@@ -533,20 +857,36 @@ TLevelWriterTzl::TLevelWriterTzl(const TFilePath &path, TPropertyGroup *info)
   // version TLV14B1a: add creator string (fixed size = CREATOR_LENGTH char)
   // version TLV15B1a: support multiple suffixes
 
+  IndexCache::instance()->remove(path);
+  Compactor::instance()->addWriter(path);
+
   if (fs.doesExist()) {
+    // The destructor, which unregisters the writer, is not called on throws
+    auto fail = [this, &path](const std::string &msg) {
+      if (m_chan) fclose(m_chan);
+      delete m_codec;
+      Compactor::instance()->removeWriter(path);
+      throw TSystemException(path, msg);
+    };
+
     // if (!fs.isWritable())
     m_chan = fopen(path, "rb+");
     /*--- 誰かが開いている、または権限が無いとき ---*/
     if (!m_chan) {
-      throw TSystemException(path, "can't fopen.");
+      fail("can't fopen.");
     }
     /*--- TLVファイルのヘッダが正しく読めなかった場合 ---*/
     if (!readHeaderAndOffsets(m_chan, m_frameOffsTable, m_iconOffsTable, m_res,
                               m_version, m_creator, &m_frameCount,
                               &m_offsetTablePos, &m_iconOffsetTablePos, 0)) {
-      throw TSystemException(path, "can't readHeaderAndOffsets.");
+      fail("can't readHeaderAndOffsets.");
     } else {
       if (m_version >= 12) buildFreeChunksTable();
+
+      // The tables on disk must stay valid until the new ones are written
+      fseek(m_chan, 0, SEEK_END);
+      m_offsetTablePos = ftell(m_chan);
+
       m_headerWritten = true;
       m_exists        = true;
       if (m_version >= 14)
@@ -575,14 +915,20 @@ TLevelWriterTzl::TLevelWriterTzl(const TFilePath &path, TPropertyGroup *info)
 
 TLevelWriterTzl::~TLevelWriterTzl() {
   if (m_version < currentVersion()) {
-    if (!convertToLatestVersion()) return;
+    if (!convertToLatestVersion()) {
+      Compactor::instance()->removeWriter(m_path);
+      return;
+    }
     assert(m_version == currentVersion());
   }
   delete m_codec;
 
   TINT32 offsetMapPos     = 0;
   TINT32 iconOffsetMapPos = 0;
-  if (!m_chan) return;
+  if (!m_chan) {
+    Compactor::instance()->removeWriter(m_path);
+    return;
+  }
 
   assert(m_frameCount == (int)m_frameOffsTable.size());
   assert(m_frameCount == (int)m_iconOffsTable.size());
@@ -590,46 +936,14 @@ TLevelWriterTzl::~TLevelWriterTzl() {
   offsetMapPos = (m_exists ? m_offsetTablePos : ftell(m_chan));
   fseek(m_chan, offsetMapPos, SEEK_SET);
 
-  TzlOffsetMap::iterator it = m_frameOffsTable.begin();
-  for (; it != m_frameOffsTable.end(); ++it) {
-    TFrameId fid      = it->first;
-    TINT32 num        = fid.getNumber();
-    QByteArray suffix = fid.getLetter().toUtf8();
-    TINT32 offs       = it->second.m_offs;
-    TINT32 length     = it->second.m_length;
-    tfwrite(&num, 1, m_chan);
-    if (m_version >= 15) {  // write the suffix length before data
-      TINT32 suffixLength = suffix.size();
-      tfwrite(&suffixLength, 1, m_chan);
-      tfwrite(suffix.constData(), suffixLength, m_chan);
-    } else  // write only the first byte
-      tfwrite(suffix.constData(), 1, m_chan);
-    tfwrite(&offs, 1, m_chan);
-    tfwrite(&length, 1, m_chan);
-  }
-
   // Write Icon Offset Table after frameOffsTable
-  iconOffsetMapPos =
-      ftell(m_chan);  //(m_exists?m_iconOffsetTablePos: ftell(m_chan));
-  fseek(m_chan, iconOffsetMapPos, SEEK_SET);
+  QByteArray tables = offsetTableData(m_frameOffsTable, m_version);
+  iconOffsetMapPos  = offsetMapPos + tables.size();
+  tables += offsetTableData(m_iconOffsTable, m_version);
+  tfwrite(tables.constData(), tables.size(), m_chan);
 
-  TzlOffsetMap::iterator iconIt = m_iconOffsTable.begin();
-  for (; iconIt != m_iconOffsTable.end(); ++iconIt) {
-    TFrameId fid           = iconIt->first;
-    TINT32 num             = fid.getNumber();
-    QByteArray suffix      = fid.getLetter().toUtf8();
-    TINT32 thumbnailOffs   = iconIt->second.m_offs;
-    TINT32 thumbnailLength = iconIt->second.m_length;
-    tfwrite(&num, 1, m_chan);
-    if (m_version >= 15) {  // write the suffix length before data
-      TINT32 suffixLength = suffix.size();
-      tfwrite(&suffixLength, 1, m_chan);
-      tfwrite(suffix.constData(), suffixLength, m_chan);
-    } else  // write only the first byte
-      tfwrite(suffix.constData(), 1, m_chan);
-    tfwrite(&thumbnailOffs, 1, m_chan);
-    tfwrite(&thumbnailLength, 1, m_chan);
-  }
+  // Frames and tables must reach the disk before the header refers to them
+  flushFile(m_chan);
 
   fseek(m_chan, m_frameCountPos, SEEK_SET);
   TINT32 frameCount = m_frameCount;
@@ -637,9 +951,12 @@ TLevelWriterTzl::~TLevelWriterTzl() {
   tfwrite(&frameCount, 1, m_chan);
   tfwrite(&offsetMapPos, 1, m_chan);
   tfwrite(&iconOffsetMapPos, 1, m_chan);
+  flushFile(m_chan);
   fclose(m_chan);
   m_chan = 0;
 
+  IndexCache::instance()->remove(m_path);
+
   if (m_palette && m_overwritePaletteFlag &&
       (m_palette->getDirtyFlag() ||
        !TSystem::doesExistFileOrLevel(m_palettePath))) {
@@ -658,11 +975,17 @@ TLevelWriterTzl::~TLevelWriterTzl() {
     }
   }
   // Se lo spazio libero (cioè la somma di tutti i buchi che si sono creati tra
-  // i frame)
-  // è maggiore di una certa soglia oppure è stato rimosso almeno un frame
-  // allora ottimizzo il file
-  // (in pratica risalvo il file da capo senza buchi).
-  if (getFreeSpace() > 0.3 || erasedFrame) optimize();
+  // i frame) è maggiore di una certa soglia allora compatto il file in
+  // background
+  if (m_exists && m_version >= 13) {
+    m_offsetTablePos = offsetMapPos;
+    m_freeChunks.clear();
+    m_sessionChunks.clear();
+    buildFreeChunksTable();
+  }
+
+  Compactor::instance()->removeWriter(m_path);
+  if (getFreeSpace() > 0.3) Compactor::instance()->compact(m_path);
 }
 
 //-------------------------------------------------------------------
@@ -727,6 +1050,17 @@ void TLevelWriterTzl::addFreeChunk(TINT32 offs, TINT32 length) {
   }
   if (it == m_freeChunks.end()) m_freeChunks.insert(TzlChunk(offs, length));
 }
+
+//-------------------------------------------------------------------
+
+//! Chunks referenced by the offset tables on disk cannot be overwritten
+//! before the new tables are written - the space they occupy is reclaimed
+//! by later saves, or by compaction. Chunks written by this writer are not
+//! referenced yet, and are reused immediately.
+void TLevelWriterTzl::releaseChunk(const TzlChunk &chunk) {
+  if (m_sessionChunks.erase(chunk.m_offs) || !m_exists)
+    addFreeChunk(chunk.m_offs, chunk.m_length);
+}
 //-------------------------------------------------------------------
 
 TINT32 TLevelWriterTzl::findSavingChunk(const TFrameId &fid, TINT32 length,
@@ -736,13 +1070,13 @@ TINT32 TLevelWriterTzl::findSavingChunk(const TFrameId &fid, TINT32 length,
   // uno contiguo.
   if (!isIcon) {
     if ((it = m_frameOffsTable.find(fid)) != m_frameOffsTable.end()) {
-      addFreeChunk(it->second.m_offs, it->second.m_length);
+      releaseChunk(it->second);
       m_frameOffsTable.erase(it);
     } else
       m_frameCount++;
   } else {
     if ((it = m_iconOffsTable.find(fid)) != m_iconOffsTable.end()) {
-      addFreeChunk(it->second.m_offs, it->second.m_length);
+      releaseChunk(it->second);
       m_iconOffsTable.erase(it);
     }
   }
@@ -769,9 +1103,11 @@ TINT32 TLevelWriterTzl::findSavingChunk(const TFrameId &fid, TINT32 length,
     } else
       assert(found->m_length == length);
     m_freeChunks.erase(found);
+    m_sessionChunks.insert(_offset);
     return _offset;
   } else {
     m_offsetTablePos += length;
+    m_sessionChunks.insert(m_offsetTablePos - length);
     return m_offsetTablePos - length;
   }
 }
@@ -892,6 +1228,9 @@ bool TLevelWriterTzl::convertToLatestVersion() {
     return false;
   m_freeChunks.clear();
   buildFreeChunksTable();
+  fseek(m_chan, 0, SEEK_END);
+  m_offsetTablePos = ftell(m_chan);
+
   m_headerWritten = true;
   m_exists        = true;
   m_frameCountPos = 8 + CREATOR_LENGTH + 3 * sizeof(TINT32);
@@ -1222,7 +1561,7 @@ void TLevelWriterTzl::remove(const TFrameId &fid) {
   if (it == m_frameOffsTable.end()) return;
   // aggiungo spazio vuoto
   // m_freeChunks.insert(TzlChunk(it->second.m_offs, it->second.m_length));
-  addFreeChunk(it->second.m_offs, it->second.m_length);
+  releaseChunk(it->second);
   // cancello l'immagine dalla tabella
   m_frameOffsTable.erase(it);
 
@@ -1234,10 +1573,9 @@ void TLevelWriterTzl::remove(const TFrameId &fid) {
     // aggiungo spazio vuoto
     // m_freeChunks.insert(TzlChunk(iconIt->second.m_offs,
     // iconIt->second.m_length));
-    addFreeChunk(iconIt->second.m_offs, iconIt->second.m_length);
+    releaseChunk(iconIt->second);
     // Cancello la relativa icona
     m_iconOffsTable.erase(iconIt);
-    erasedFrame = true;
   }
 }
 
@@ -1246,10 +1584,7 @@ void TLevelWriterTzl::remove(const TFrameId &fid) {
 void TLevelWriterTzl::setIconSize(TDimension iconSize) {
   assert(iconSize.lx > 0 && iconSize.ly > 0);
 
-  m_iconSize     = TDimension(iconSize.lx, iconSize.ly);
-  m_userIconSize = TDimension(
-      iconSize.lx, iconSize.ly);  // Used in TLevelWriterTzl::optimize().
-                                  // Observe that m_iconSize may change below.
+  m_iconSize = TDimension(iconSize.lx, iconSize.ly);
   if (m_version >= 13 && m_exists) {
     // A supported level file already exists at the specified path
 
@@ -1395,44 +1730,6 @@ float TLevelWriterTzl::getFreeSpace() {
   }
   return 0;
 }
-// creo il file ottimizzato, cioè senza spazi liberi
-bool TLevelWriterTzl::optimize() {
-  TFileStatus fs(m_path);
-  assert(fs.doesExist());
-
-  std::string tempName = "~" + m_path.getName() + "tmp&.tlv";
-  TFilePath tempPath =
-      TSystem::getTempDir() + tempName;  // Path temporaneo del file ottimizzato
-
-  if (TSystem::doesExistFileOrLevel(tempPath)) TSystem::deleteFile(tempPath);
-
-  TLevelWriterP lw(tempPath);
-
-  TLevelReaderP lr(m_path);
-  lw->setIconSize(m_userIconSize);
-  TLevelP level = lr->loadInfo();
-  if (!level || level->getFrameCount() == 0) return false;
-  TLevel::Iterator levelIt = level->begin();
-  for (; levelIt != level->end(); ++levelIt) {
-    TToonzImageP img = lr->getFrameReader(levelIt->first)->load();
-    assert(img);
-    lw->getFrameWriter(levelIt->first)->save(img);
-  }
-  lr = TLevelReaderP();
-  lw = TLevelWriterP();
-
-  // Se il file tempPath (ottimizzato) è stato creato
-  // lo copio sostituendolo ad m_path
-  if (TSystem::doesExistFileOrLevel(tempPath)) {
-    assert(m_path != tempPath);
-    if (TSystem::doesExistFileOrLevel(m_path))
-      TSystem::deleteFile(m_path);  // Cancello il file non ottimizzato
-    TSystem::copyFile(m_path, tempPath);
-    TSystem::deleteFile(tempPath);
-  } else
-    return false;
-  return true;
-}
 
 //===================================================================
 //
@@ -1474,6 +1771,8 @@ void TLevelReaderTzl::readPalette() {
 TLevelReaderTzl::TLevelReaderTzl(const TFilePath &path)
     : TLevelReader(path)
     , m_chan(0)
+    , m_map(0)
+    , m_mapSize(0)
     , m_res(0, 0)
     , m_xDpi(0)
     , m_yDpi(0)
@@ -1486,9 +1785,53 @@ TLevelReaderTzl::TLevelReaderTzl(const TFilePath &path)
 
   if (!m_chan) return;
 
-  if (!readHeaderAndOffsets(m_chan, m_frameOffsTable, m_iconOffsTable, m_res,
-                            m_version, m_creator, 0, 0, 0, m_level))
-    return;
+  QFileInfo fi(path.getQString());
+
+  // Setting TOONZ_TLV_PLAIN_READS makes each reader parse the file and read
+  // its frames through m_chan, as a baseline for the benchmarks
+  const bool plainReads = std::getenv("TOONZ_TLV_PLAIN_READS") != 0;
+
+  IndexCache::Index index;
+  if (!plainReads && IndexCache::instance()->get(fi, index)) {
+    m_frameOffsTable = index.m_frameOffsTable;
+    m_iconOffsTable  = index.m_iconOffsTable;
+    m_res            = index.m_res;
+    m_version        = index.m_version;
+    m_creator        = index.m_creator;
+
+    TzlOffsetMap::iterator it;
+    for (it = m_frameOffsTable.begin(); it != m_frameOffsTable.end(); ++it)
+      m_level->setFrame(it->first, TImageP());
+  } else {
+    if (!readHeaderAndOffsets(m_chan, m_frameOffsTable, m_iconOffsTable,
+                              m_res, m_version, m_creator, 0, 0, 0, m_level))
+      return;
+
+    // Older versions complete their tables while loading frames
+    if (m_version >= 11) {
+      index.m_frameOffsTable = m_frameOffsTable;
+      index.m_iconOffsTable  = m_iconOffsTable;
+      index.m_res            = m_res;
+      index.m_version        = m_version;
+      index.m_creator        = m_creator;
+      IndexCache::instance()->set(fi, index);
+    }
+  }
+
+  // Frames are read straight from the mapping - without seeks, nor copies.
+  // Level files are never truncated in place: writers only overwrite and
+  // append, while replacing or compacting a level creates a new file, so
+  // the mapped pages stay valid. Truncation by another process would fault,
+  // as with any mapping. Windows forbids removing mapped files, which would
+  // make the level unsaveable while a reader is alive.
+#ifndef _WIN32
+  m_file.setFileName(path.getQString());
+  if (!plainReads && m_file.open(QIODevice::ReadOnly)) {
+    m_mapSize = m_file.size();
+    m_map     = m_file.map(0, m_mapSize);
+    if (!m_map) m_file.close();
+  }
+#endif
 
   TFilePath historyFp = path.withNoFrame().withType("hst");
   FILE *historyChan   = fopen(historyFp, "r");
@@ -1524,6 +1867,26 @@ TLevelReaderTzl::~TLevelReaderTzl() {
 
 //-------------------------------------------------------------------
 
+const UCHAR *TLevelReaderTzl::readChunk(TINT32 offs, TINT32 length,
+                                        std::vector<UCHAR> &buffer) {
+  if (offs <= 0 || length <= 0) return 0;
+
+  // Chunks appended after the mapping was made are read from the file
+  if (m_map && (qint64)offs + length <= m_mapSize) return m_map + offs;
+
+  if (!m_chan) return 0;
+
+  buffer.resize(length);
+
+  QMutexLocker locker(&m_chanMutex);
+  fseek(m_chan, offs, SEEK_SET);
+  if (fread(&buffer[0], length, 1, m_chan) != 1) return 0;
+
+  return &buffer[0];
+}
+
+//-------------------------------------------------------------------
+
 TLevelP TLevelReaderTzl::loadInfo() {
   if (m_level && m_level->getPalette() == 0 && m_readPalette) readPalette();
   return m_level;
@@ -1548,18 +1911,16 @@ bool TLevelReaderTzl::getIconSize(TDimension &iconSize) {
   if (m_iconOffsTable.empty()) return false;
   if (m_version < 13) return false;
   assert(m_chan);
-  TINT32 currentPos         = ftell(m_chan);
   TzlOffsetMap::iterator it = m_iconOffsTable.begin();
-  TINT32 offs               = it->second.m_offs;
 
-  fseek(m_chan, offs, SEEK_SET);
-  TINT32 iconLx = 0, iconLy = 0;
+  std::vector<UCHAR> buffer;
+  const UCHAR *data = readChunk(it->second.m_offs, iconHeaderSize, buffer);
+  if (!data) return false;
+
   // leggo la dimensione delle iconcine nel file
-  fread(&iconLx, sizeof(TINT32), 1, m_chan);
-  fread(&iconLy, sizeof(TINT32), 1, m_chan);
+  TINT32 iconLx = readTINT32(data);
+  TINT32 iconLy = readTINT32(data);
   assert(iconLx > 0 && iconLy > 0);
-  // return to the current position
-  fseek(m_chan, currentPos, SEEK_SET);
   iconSize = TDimension(iconLx, iconLy);
   return true;
 }
@@ -1583,6 +1944,7 @@ TImageReaderTzl::TImageReaderTzl(const TFilePath &f, const TFrameId &fid,
 
 TImageP TImageReaderTzl::load10() {
   FILE *chan = m_lrp->m_chan;
+  QMutexLocker locker(&m_lrp->m_chanMutex);
 
   if (!chan) return TImageP();
 
@@ -1714,6 +2076,7 @@ m_lrp->m_frameIndex = m_frameIndex;*/
 
 TImageP TImageReaderTzl::load11() {
   FILE *chan = m_lrp->m_chan;
+  QMutexLocker locker(&m_lrp->m_chanMutex);
 
   if (!chan) return TImageP();
 
@@ -1835,15 +2198,7 @@ m_lrp->m_frameIndex = m_frameIndex;*/
 //-------------------------------------------------------------------
 
 TImageP TImageReaderTzl::load13() {
-  FILE *chan = m_lrp->m_chan;
-
-  if (!chan) return TImageP();
-  // SAVEBOX_X0 SAVEBOX_Y0 SAVEBOX_LX SAVEBOX_LY BUFFER_SIZE
-  TINT32 sbx0, sby0, sblx, sbly;
-  TINT32 actualBuffSize;
-  double xdpi = 1, ydpi = 1;
-  TINT32 imgBuffSize = 0;
-  UCHAR *imgBuff     = 0;
+  if (!m_lrp->m_chan) return TImageP();
   TINT32 iconLx = 0, iconLy = 0;
   assert(!m_lrp->m_frameOffsTable.empty());
   assert(!m_lrp->m_iconOffsTable.empty());
@@ -1854,63 +2209,39 @@ TImageP TImageReaderTzl::load13() {
       iconIt == m_lrp->m_iconOffsTable.end())
     return 0;
 
-  fseek(chan, it->second.m_offs, SEEK_SET);
-  fread(&sbx0, sizeof(TINT32), 1, chan);
-  fread(&sby0, sizeof(TINT32), 1, chan);
-  fread(&sblx, sizeof(TINT32), 1, chan);
-  fread(&sbly, sizeof(TINT32), 1, chan);
-  fread(&actualBuffSize, sizeof(TINT32), 1, chan);
-  fread(&xdpi, sizeof(double), 1, chan);
-  fread(&ydpi, sizeof(double), 1, chan);
+  // SAVEBOX_X0 SAVEBOX_Y0 SAVEBOX_LX SAVEBOX_LY BUFFER_SIZE
+  std::vector<UCHAR> buffer;
+  const UCHAR *data =
+      m_lrp->readChunk(it->second.m_offs, frameHeaderSize, buffer);
+  if (!data) return TImageP();
+
+  TINT32 sbx0           = readTINT32(data);
+  TINT32 sby0           = readTINT32(data);
+  TINT32 sblx           = readTINT32(data);
+  TINT32 sbly           = readTINT32(data);
+  TINT32 actualBuffSize = readTINT32(data);
+  double xdpi           = readDouble(data);
+  double ydpi           = readDouble(data);
 
-#if !TNZ_LITTLE_ENDIAN
-  sbx0           = swapTINT32(sbx0);
-  sby0           = swapTINT32(sby0);
-  sblx           = swapTINT32(sblx);
-  sbly           = swapTINT32(sbly);
-  actualBuffSize = swapTINT32(actualBuffSize);
-  reverse((char *)&xdpi, sizeof(double));
-  reverse((char *)&ydpi, sizeof(double));
-#endif
   // Carico l'icona dal file
   if (m_isIcon) {
-    fseek(chan, iconIt->second.m_offs, SEEK_SET);
-    fread(&iconLx, sizeof(TINT32), 1, chan);
-    fread(&iconLy, sizeof(TINT32), 1, chan);
+    data = m_lrp->readChunk(iconIt->second.m_offs, iconHeaderSize, buffer);
+    if (!data) return TImageP();
+
+    iconLx = readTINT32(data);
+    iconLy = readTINT32(data);
     assert(iconLx > 0 && iconLy > 0);
     if (iconLx <= 0 || iconLy <= 0) throw TException();
-    fread(&actualBuffSize, sizeof(TINT32), 1, chan);
+    actualBuffSize = readTINT32(data);
 
-    imgBuffSize = (iconLx * iconLy * sizeof(TPixelCM32));
-    imgBuff     = new UCHAR[imgBuffSize];
-    fread(imgBuff, actualBuffSize, 1, chan);
+    const UCHAR *imgBuff = m_lrp->readChunk(
+        iconIt->second.m_offs + iconHeaderSize, actualBuffSize, buffer);
+    if (!imgBuff) return TImageP();
 
-#if !TNZ_LITTLE_ENDIAN
-    Header *header    = (Header *)imgBuff;
-    header->m_lx      = swapTINT32(header->m_lx);
-    header->m_ly      = swapTINT32(header->m_ly);
-    header->m_rasType = (Header::RasType)swapTINT32(header->m_rasType);
-#endif
-    TRasterCodecLZO codec("LZO", false);
     TRasterP ras;
-    if (!codec.decompress(imgBuff, actualBuffSize, ras, m_safeMode))
+    if (!decompressRaster(imgBuff, actualBuffSize, ras, m_safeMode))
       return TImageP();
     assert((TRasterCM32P)ras);
-    delete[] imgBuff;
-
-#if !TNZ_LITTLE_ENDIAN
-
-    for (int y = 0; y < ras->getLy(); ++y) {
-      ras->lock();
-      TINT32 *pix    = ((TINT32 *)ras->getRawData(0, y));
-      TINT32 *endPix = pix + ras->getLx();
-      while (pix < endPix) {
-        *pix = swapTINT32(*pix);
-        pix++;
-      }
-      ras->unlock();
-    }
-#endif
 
     /*
             TINT32 iconsbx0 = tround((double)iconLx*sbx0/m_lrp->m_res.lx);
@@ -1956,49 +2287,14 @@ TImageP TImageReaderTzl::load13() {
     return ti;
   }
 
-  TRasterCM32P raux = TRasterCM32P(m_lx, m_ly);
-  raux->lock();
-  imgBuff = (UCHAR *)raux->getRawData();  // new UCHAR[imgBuffSize];
-  // imgBuff = new UCHAR[imgBuffSize];
-  // imgBuffSize = m_lx*m_ly*sizeof(TPixelCM32);
-  // assert(actualBuffSize <= imgBuffSize);
-
-  // imgBuff = new UCHAR[imgBuffSize];
-  // int ret =
-  fread(imgBuff, actualBuffSize, 1, chan);
-  // assert(ret==1);
+  const UCHAR *imgBuff = m_lrp->readChunk(
+      it->second.m_offs + frameHeaderSize, actualBuffSize, buffer);
+  if (!imgBuff) return TImageP();
 
-  Header *header = (Header *)imgBuff;
-
-#if !TNZ_LITTLE_ENDIAN
-  header->m_lx      = swapTINT32(header->m_lx);
-  header->m_ly      = swapTINT32(header->m_ly);
-  header->m_rasType = (Header::RasType)swapTINT32(header->m_rasType);
-#endif
-
-  TRasterCodecLZO codec("LZO", false);
   TRasterP ras;
-  if (!codec.decompress(imgBuff, actualBuffSize, ras, m_safeMode))
+  if (!decompressRaster(imgBuff, actualBuffSize, ras, m_safeMode))
     return TImageP();
   assert((TRasterCM32P)ras);
-  assert(ras->getLx() == header->m_lx);
-  assert(ras->getLy() == header->m_ly);
-
-#if !TNZ_LITTLE_ENDIAN
-
-  for (int y = 0; y < ras->getLy(); ++y) {
-    ras->lock();
-    TINT32 *pix    = ((TINT32 *)ras->getRawData(0, y));
-    TINT32 *endPix = pix + ras->getLx();
-    while (pix < endPix) {
-      *pix = swapTINT32(*pix);
-      pix++;
-    }
-    ras->unlock();
-  }
-
-// codec.compress(ras, 1, &imgBuff, actualBuffSize);
-#endif
 
   TRect savebox(TPoint(sbx0, sby0), TDimension(sblx, sbly));
   TDimension imgSize(m_lrp->m_res.lx, m_lrp->m_res.ly);
@@ -2012,8 +2308,6 @@ TImageP TImageReaderTzl::load13() {
     fullRas->extractT(savebox)->copy(ras);
     ras = fullRas;
   }
-  raux->unlock();
-  raux = TRasterCM32P();
 
   // delete [] imgBuff;
 
@@ -2064,15 +2358,7 @@ static TRect applyShrinkAndRegion(TRasterP &ras, int shrink, TRect region,
 //-------------------------------------------------------------------
 
 TImageP TImageReaderTzl::load14() {
-  FILE *chan = m_lrp->m_chan;
-
-  if (!chan) return TImageP();
-  // SAVEBOX_X0 SAVEBOX_Y0 SAVEBOX_LX SAVEBOX_LY BUFFER_SIZE
-  TINT32 sbx0 = 0, sby0 = 0, sblx, sbly;
-  TINT32 actualBuffSize;
-  double xdpi = 1, ydpi = 1;
-  // TINT32 imgBuffSize = 0;
-  UCHAR *imgBuff = 0;
+  if (!m_lrp->m_chan) return TImageP();
   TINT32 iconLx = 0, iconLy = 0;
   assert(!m_lrp->m_frameOffsTable.empty());
   assert(!m_lrp->m_iconOffsTable.empty());
@@ -2087,77 +2373,48 @@ TImageP TImageReaderTzl::load14() {
       iconIt == m_lrp->m_iconOffsTable.end())
     throw TException("Loading tlv: frame ID not found.");
 
-  fseek(chan, it->second.m_offs, SEEK_SET);
-  fread(&sbx0, sizeof(TINT32), 1, chan);
-  fread(&sby0, sizeof(TINT32), 1, chan);
-  fread(&sblx, sizeof(TINT32), 1, chan);
-  fread(&sbly, sizeof(TINT32), 1, chan);
-  fread(&actualBuffSize, sizeof(TINT32), 1, chan);
-  fread(&xdpi, sizeof(double), 1, chan);
-  fread(&ydpi, sizeof(double), 1, chan);
+  // SAVEBOX_X0 SAVEBOX_Y0 SAVEBOX_LX SAVEBOX_LY BUFFER_SIZE
+  std::vector<UCHAR> buffer;
+  const UCHAR *data =
+      m_lrp->readChunk(it->second.m_offs, frameHeaderSize, buffer);
+  if (!data) throw TException("Loading tlv: frame header error.");
+
+  TINT32 sbx0           = readTINT32(data);
+  TINT32 sby0           = readTINT32(data);
+  TINT32 sblx           = readTINT32(data);
+  TINT32 sbly           = readTINT32(data);
+  TINT32 actualBuffSize = readTINT32(data);
+  double xdpi           = readDouble(data);
+  double ydpi           = readDouble(data);
 
   if (sbx0 < 0 || sby0 < 0 || sblx < 0 || sbly < 0 || sblx > m_lx ||
       sbly > m_ly)
     throw TException("Loading tlv: savebox dimension error.");
 
-#if !TNZ_LITTLE_ENDIAN
-  sbx0           = swapTINT32(sbx0);
-  sby0           = swapTINT32(sby0);
-  sblx           = swapTINT32(sblx);
-  sbly           = swapTINT32(sbly);
-  actualBuffSize = swapTINT32(actualBuffSize);
-  reverse((char *)&xdpi, sizeof(double));
-  reverse((char *)&ydpi, sizeof(double));
-#endif
-
   // Carico l'icona dal file
   if (m_isIcon) {
-    fseek(chan, iconIt->second.m_offs, SEEK_SET);
-    fread(&iconLx, sizeof(TINT32), 1, chan);
-    fread(&iconLy, sizeof(TINT32), 1, chan);
+    data = m_lrp->readChunk(iconIt->second.m_offs, iconHeaderSize, buffer);
+    if (!data) throw TException("Loading tlv: icon header error.");
+
+    iconLx = readTINT32(data);
+    iconLy = readTINT32(data);
     assert(iconLx > 0 && iconLy > 0);
     if (iconLx < 0 || iconLy < 0 || iconLx > m_lx || iconLy > m_ly)
       throw TException("Loading tlv: bad icon size.");
-    fread(&actualBuffSize, sizeof(TINT32), 1, chan);
+    actualBuffSize = readTINT32(data);
 
     if (actualBuffSize <= 0 ||
         actualBuffSize > (int)(iconLx * iconLx * sizeof(TPixelCM32)))
       throw TException("Loading tlv: icon buffer size error.");
 
-    TRasterCM32P raux = TRasterCM32P(iconLx, iconLy);
-    if (!raux) return TImageP();
-    raux->lock();
-    imgBuff = (UCHAR *)raux->getRawData();  // new UCHAR[imgBuffSize];
-    fread(imgBuff, actualBuffSize, 1, chan);
+    const UCHAR *imgBuff = m_lrp->readChunk(
+        iconIt->second.m_offs + iconHeaderSize, actualBuffSize, buffer);
+    if (!imgBuff) throw TException("Loading tlv: icon buffer error.");
 
-#if !TNZ_LITTLE_ENDIAN
-    Header *header    = (Header *)imgBuff;
-    header->m_lx      = swapTINT32(header->m_lx);
-    header->m_ly      = swapTINT32(header->m_ly);
-    header->m_rasType = (Header::RasType)swapTINT32(header->m_rasType);
-#endif
-
-    TRasterCodecLZO codec("LZO", false);
     TRasterP ras;
-    if (!codec.decompress(imgBuff, actualBuffSize, ras, m_safeMode))
+    if (!decompressRaster(imgBuff, actualBuffSize, ras, m_safeMode))
       return TImageP();
     assert((TRasterCM32P)ras);
-    raux->unlock();
-    raux = TRasterCM32P();
-
-#if !TNZ_LITTLE_ENDIAN
-
-    for (int y = 0; y < ras->getLy(); ++y) {
-      ras->lock();
-      TINT32 *pix    = ((TINT32 *)ras->getRawData(0, y));
-      TINT32 *endPix = pix + ras->getLx();
-      while (pix < endPix) {
-        *pix = swapTINT32(*pix);
-        pix++;
-      }
-      ras->unlock();
-    }
-#endif
 
     /*
             TINT32 iconsbx0 = tround((double)iconLx*sbx0/m_lrp->m_res.lx);
@@ -2220,58 +2477,28 @@ TImageP TImageReaderTzl::load14() {
     ti->setPalette(m_lrp->m_level->getPalette());
     return ti;
   }
-  if (actualBuffSize <= 0 ||
+  if (actualBuffSize <= (TINT32)sizeof(Header) ||
       actualBuffSize > (int)(m_lx * m_ly * sizeof(TPixelCM32)))
     throw TException("Loading tlv: buffer size error");
 
-  TRasterCM32P raux = TRasterCM32P(m_lx, m_ly);
-
-  // imgBuffSize = m_lx*m_ly*sizeof(TPixelCM32);
-
-  raux->lock();
-  imgBuff = (UCHAR *)raux->getRawData();  // new UCHAR[imgBuffSize];
-  // int ret =
-
-  fread(imgBuff, actualBuffSize, 1, chan);
-  // assert(ret==1);
+  const UCHAR *imgBuff = m_lrp->readChunk(
+      it->second.m_offs + frameHeaderSize, actualBuffSize, buffer);
+  if (!imgBuff) throw TException("Loading tlv: frame buffer error.");
 
-  Header *header = (Header *)imgBuff;
-
-#if !TNZ_LITTLE_ENDIAN
-  header->m_lx      = swapTINT32(header->m_lx);
-  header->m_ly      = swapTINT32(header->m_ly);
-  header->m_rasType = (Header::RasType)swapTINT32(header->m_rasType);
-#endif
-
-  TRasterCodecLZO codec("LZO", false);
   TRasterP ras;
-  if (!codec.decompress(imgBuff, actualBuffSize, ras, m_safeMode))
+  if (!decompressRaster(imgBuff, actualBuffSize, ras, m_safeMode))
     return TImageP();
   assert((TRasterCM32P)ras);
-  assert(ras->getLx() == header->m_lx);
-  assert(ras->getLy() == header->m_ly);
-  if (ras->getLx() != header->m_lx)
+
+  const UCHAR *headerData = imgBuff;
+  TINT32 headerLx         = readTINT32(headerData);
+  TINT32 headerLy         = readTINT32(headerData);
+  assert(ras->getLx() == headerLx);
+  assert(ras->getLy() == headerLy);
+  if (ras->getLx() != headerLx)
     throw TException("Loading tlv: lx dimension error.");
-  if (ras->getLy() != header->m_ly)
+  if (ras->getLy() != headerLy)
     throw TException("Loading tlv: ly dimension error.");
-  raux->unlock();
-  raux = TRasterCM32P();
-
-#if !TNZ_LITTLE_ENDIAN
-
-  for (int y = 0; y < ras->getLy(); ++y) {
-    ras->lock();
-    TINT32 *pix    = ((TINT32 *)ras->getRawData(0, y));
-    TINT32 *endPix = pix + ras->getLx();
-    while (pix < endPix) {
-      *pix = swapTINT32(*pix);
-      pix++;
-    }
-    ras->unlock();
-  }
-
-// codec.compress(ras, 1, &imgBuff, actualBuffSize);
-#endif
 
   TRect savebox(TPoint(sbx0, sby0), TDimension(sblx, sbly));
   TDimension imgSize(m_lrp->m_res.lx, m_lrp->m_res.ly);
@@ -2364,41 +2591,25 @@ TImageP TImageReaderTzl::load() {
 
 const TImageInfo *TImageReaderTzl::getImageInfo11() const {
   assert(!m_lrp->m_frameOffsTable.empty());
-  FILE *chan = m_lrp->m_chan;
-  if (!chan) return 0;
+  if (!m_lrp->m_chan) return 0;
 
   TzlOffsetMap::iterator it = m_lrp->m_frameOffsTable.find(m_fid);
 
   if (it == m_lrp->m_frameOffsTable.end()) return 0;
 
-  fseek(chan, it->second.m_offs, SEEK_SET);
-
   // SAVEBOX_X0 SAVEBOX_Y0 SAVEBOX_LX SAVEBOX_LY BUFFER_SIZE
-  TINT32 sbx0, sby0, sblx, sbly;
-  TINT32 actualBuffSize;
-  double xdpi = 1, ydpi = 1;
-  //  TINT32 imgBuffSize = 0;
-
-  // int pos = ftell(chan);
-
-  fread(&sbx0, sizeof(TINT32), 1, chan);
-  fread(&sby0, sizeof(TINT32), 1, chan);
-  fread(&sblx, sizeof(TINT32), 1, chan);
-  fread(&sbly, sizeof(TINT32), 1, chan);
-  fread(&actualBuffSize, sizeof(TINT32), 1, chan);
-
-  fread(&xdpi, sizeof(double), 1, chan);
-  fread(&ydpi, sizeof(double), 1, chan);
-
-#if !TNZ_LITTLE_ENDIAN
-  sbx0           = swapTINT32(sbx0);
-  sby0           = swapTINT32(sby0);
-  sblx           = swapTINT32(sblx);
-  sbly           = swapTINT32(sbly);
-  actualBuffSize = swapTINT32(actualBuffSize);
-  reverse((char *)&xdpi, sizeof(double));
-  reverse((char *)&ydpi, sizeof(double));
-#endif
+  std::vector<UCHAR> buffer;
+  const UCHAR *data =
+      m_lrp->readChunk(it->second.m_offs, frameHeaderSize, buffer);
+  if (!data) return 0;
+
+  TINT32 sbx0 = readTINT32(data);
+  TINT32 sby0 = readTINT32(data);
+  TINT32 sblx = readTINT32(data);
+  TINT32 sbly = readTINT32(data);
+  readTINT32(data);  // actualBuffSize
+  double xdpi = readDouble(data);
+  double ydpi = readDouble(data);
 
   static TImageInfo info;
   info.m_x0   = sbx0;
@@ -2418,6 +2629,7 @@ const TImageInfo *TImageReaderTzl::getImageInfo11() const {
 
 const TImageInfo *TImageReaderTzl::getImageInfo10() const {
   FILE *chan = m_lrp->m_chan;
+  QMutexLocker locker(&m_lrp->m_chanMutex);
   if (!chan) return 0;
 
   // SAVEBOX_X0 SAVEBOX_Y0 SAVEBOX_LX SAVEBOX_LY BUFFER_SIZE
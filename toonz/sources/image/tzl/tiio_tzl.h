@@ -5,6 +5,10 @@
 
 #include "tlevel_io.h"
 #include <set>
+#include <vector>
+
+#include <QFile>
+#include <QMutex>
 
 class TImageWriterTzl;
 class TImageReaderTzl;
@@ -30,6 +34,13 @@ private:
 typedef std::map<TFrameId, TzlChunk> TzlOffsetMap;
 class TRasterCodecLZO;
 
+/*!
+  Existing files are saved incrementally: new frames and icons are appended
+  to the file (or fill space no longer referenced on disk) and the offset
+  tables are rewritten at its end, the header being updated to point to them
+  as last step. An interrupted save leaves the previously saved level intact.
+  Files whose free space grows too large are compacted in the background.
+*/
 class TLevelWriterTzl final : public TLevelWriter {
   // bool m_paletteWritten;
   bool m_headerWritten;
@@ -42,6 +53,8 @@ class TLevelWriterTzl final : public TLevelWriter {
   TzlOffsetMap m_frameOffsTable;
   TzlOffsetMap m_iconOffsTable;
   std::set<TzlChunk> m_freeChunks;
+  std::set<TINT32> m_sessionChunks;  //!< Offsets of the chunks written by
+                                     //!< this writer
   bool m_exists;
   TPalette *m_palette;
   TDimension m_res;
@@ -51,7 +64,6 @@ class TLevelWriterTzl final : public TLevelWriter {
   const char *m_magic;
   int m_version;
   bool m_updatedIconsSize;
-  TDimension m_userIconSize;  // IconSize settata dall'utente
   TDimension
       m_iconSize;  // IconSize in the file according to image aspect ratio.
   TDimension m_currentIconSize;  // If file exists this is the current IconSize
@@ -100,12 +112,6 @@ public:
      tutto lo spazio è libero.
    */
   float getFreeSpace();
-  /*!
-     Save the file without freeSpace.
-     Salva tutti i frame in maniera continua, senza buchi.
-     Return TRUE if successfully.
-   */
-  bool optimize();
 
 public:
   static TLevelWriter *create(const TFilePath &f, TPropertyGroup *winfo) {
@@ -122,6 +128,7 @@ private:
   void writeHeader(const TDimension &size);
   void buildFreeChunksTable();
   void addFreeChunk(TINT32 offs, TINT32 length);
+  void releaseChunk(const TzlChunk &chunk);
   TINT32 findSavingChunk(const TFrameId &fid, TINT32 length,
                          bool isIcon = false);
   // not implemented
@@ -133,6 +140,13 @@ private:
 
 /*!
   TLevelReaderTzl:
+\n\n
+  The file is memory-mapped when possible, and the offset tables of files
+  with version 11 and above are shared among the readers of the same file
+  until it is modified. Frames and icons of levels with version 13 and above
+  can be loaded concurrently from different threads. Setting the
+  TOONZ_TLV_PLAIN_READS environment variable disables both the mapping and
+  the sharing.
  */
 class TLevelReaderTzl final : public TLevelReader {
 public:
@@ -164,6 +178,10 @@ Return an image with Reader information
 
 private:
   FILE *m_chan;
+  QMutex m_chanMutex;  //!< Serializes the accesses to m_chan
+  QFile m_file;
+  const UCHAR *m_map;  //!< Mapping of the whole file, or 0
+  qint64 m_mapSize;    //!< Size of the file when it was mapped
   TLevelP m_level;
   TDimension m_res;
   double m_xDpi, m_yDpi;
@@ -182,6 +200,13 @@ public:
 
 private:
   void readPalette();
+  /*!
+    Returns the specified bytes of the file - pointing into the file mapping
+    when available, or read into buffer otherwise. Returns 0 if they cannot
+    be read. Can be invoked concurrently.
+  */
+  const UCHAR *readChunk(TINT32 offs, TINT32 length,
+                         std::vector<UCHAR> &buffer);
   // not implemented
   TLevelReaderTzl(const TLevelReaderTzl &);
   TLevelReaderTzl &operator=(const TLevelReaderTzl &);
@@ -60,6 +60,12 @@ public:
   // If not implemented returns 0;
   virtual int skipLines(int lineCount) = 0;
 
+  // Notifies that the next lines to be read are in the [row0, row1] range -
+  // counted in the reader's row order, like skipLines() and readLine() do -
+  // and only their [x0, x1] columns are needed. Readers decoding images by
+  // blocks may use it to decode just the blocks involved, and in advance.
+  virtual void setReadRegion(int x0, int row0, int x1, int row1) {}
+
   virtual RowOrder getRowOrder() const { return BOTTOM2TOP; }
   virtual bool read16BitIsEnabled() const { return false; }
 
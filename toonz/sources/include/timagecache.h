@@ -4,6 +4,7 @@
 #define TIMAGECACHE_H
 
 #include <memory>
+#include <functional>
 
 // TnzCore includes
 #include "tcommon.h"
@@ -155,6 +156,32 @@ public:
   // compress id (in memory)
   void compress(const std::string &id);
 
+  //! Sets the uncompressed images size (KB) above which the cache starts
+  //! compressing its least recently used images in background, and the size
+  //! it brings them back to. A zero high watermark leaves compression to
+  //! memory shortages only.
+  void setWatermarks(UINT lowWatermark, UINT highWatermark);
+  void getWatermarks(UINT &lowWatermark, UINT &highWatermark) const;
+
+  //! Returns the high watermark (KB) used by default: a quarter of the
+  //! physical memory. The default low watermark is 3/4 of it.
+  static UINT getDefaultHighWatermark();
+
+  //! The cache maintenance counters, accumulated since startup.
+  struct Statistics {
+    TUINT64 m_compressedBytes;  //!< Image bytes compressed in memory.
+    TUINT64 m_spilledBytes;     //!< Bytes shipped to the swap folder.
+    TUINT64 m_stallTime;        //!< Time (ms) spent waiting for free memory
+                                //!  by threads adding or retrieving images.
+  };
+
+  Statistics getStatistics() const;
+
+  //! Registers a function invoked by the maintenance thread when memory runs
+  //! short, before compressing images: memory kept outside the cache for
+  //! reuse (e.g. idle render buffers) should be released there.
+  void addMemoryPressureHandler(const std::function<void()> &handler);
+
 private:
   TImageCache();
   ~TImageCache();
@@ -258,18 +258,6 @@ inline bool isMovieTypeOpaque(const TFilePath &fp) {
 
 //-----------------------------------------------------------
 
-inline bool isSequencialRequired(std::string type) {
-  return (type == "mov" || type == "avi" || type == "3gp");
-}
-
-//-----------------------------------------------------------
-
-inline bool isSequencialRequired(const TFilePath &fp) {
-  std::string type(fp.getType());
-  return isSequencialRequired(type);
-}
-
-//-----------------------------------------------------------
 
 inline bool isMultipleFrameType(std::string type) {
   return (type == "tlv" || type == "tzl" || type == "pli" || type == "mov" ||
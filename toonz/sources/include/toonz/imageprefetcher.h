@@ -0,0 +1,98 @@
+#pragma once
+
+#ifndef IMAGEPREFETCHER_H
+#define IMAGEPREFETCHER_H
+
+#include <memory>
+
+// TnzCore includes
+#include "tcommon.h"
+
+#undef DVAPI
+#undef DVVAR
+#ifdef TOONZLIB_EXPORTS
+#define DVAPI DV_EXPORT_API
+#define DVVAR DV_EXPORT_VAR
+#else
+#define DVAPI DV_IMPORT_API
+#define DVVAR DV_IMPORT_VAR
+#endif
+
+//=====================================================
+
+//  Forward declarations
+
+class TXsheet;
+class TXshSimpleLevel;
+
+//=====================================================
+
+//***************************************************************************************
+//    ImagePrefetcher declaration
+//***************************************************************************************
+
+//! ImagePrefetcher loads the images that are about to be shown by a playback
+//! in background, so that the viewers find them in the TImageCache.
+/*!
+    Viewers notify the prefetcher each time they show a frame, along with the
+    playback step and frame rate. The images of the frames that will follow
+    are then built - through the ImageBuilders bound in the ImageManager - on
+    a dedicated thread pool, nearest frames first.
+    \n\n
+    Each notification supersedes the previous one: requests that did not
+    start yet are discarded, so that seeks do not leave stale loads queued.
+    \n\n
+    The prefetcher also counts how many of the shown frames were already
+    cached, which is the fraction of frames that playback could show without
+    waiting for a load. The hit rate is reported to the TRenderTrace, when
+    enabled, at each shown frame.
+*/
+
+class DVAPI ImagePrefetcher {
+public:
+  struct Counters {
+    TINT64 m_hitsCount;      //!< Shown images that were already cached
+    TINT64 m_missesCount;    //!< Shown images that had to be loaded
+    TINT64 m_requestsCount;  //!< Images scheduled for prefetching
+    TINT64 m_loadsCount;     //!< Images actually loaded by the prefetcher
+  };
+
+public:
+  static ImagePrefetcher *instance();
+
+  //! Notifies that the specified xsheet row is being shown, prefetching the
+  //! images of the visible columns in the rows that follow, by step.
+  void prefetch(TXsheet *xsh, int row, int step, double fps);
+
+  //! Notifies that the specified frame of a level is being shown, prefetching
+  //! the frames that follow, by step.
+  void prefetch(TXshSimpleLevel *sl, int frameIndex, int step, double fps);
+
+  //! Discards all pending requests.
+  void cancel();
+
+  //! Sets the time span covered by the prefetched frames, in seconds.
+  void setLookAhead(double seconds);
+  double getLookAhead() const;
+
+  //! Sets the maximum number of frames prefetched for each notification.
+  void setMaximumFramesCount(int count);
+  int getMaximumFramesCount() const;
+
+  Counters getCounters() const;
+  void resetCounters();
+
+private:
+  class Imp;
+  std::unique_ptr<Imp> m_imp;
+
+private:
+  ImagePrefetcher();
+  ~ImagePrefetcher();
+
+  // Not copyable
+  ImagePrefetcher(const ImagePrefetcher &);
+  ImagePrefetcher &operator=(const ImagePrefetcher &);
+};
+
+#endif  // IMAGEPREFETCHER_H
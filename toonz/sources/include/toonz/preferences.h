@@ -123,6 +123,7 @@ public:
   void enableAutosave();
   void setAutosavePeriod();
   void setUndoMemorySize();
+  void setImageCacheSize();
   // Interface
   void setPixelsOnly();
   void setUnits();
@@ -172,6 +173,7 @@ public:
   }
   bool isStartupPopupEnabled() { return getBoolValue(startupPopupEnabled); }
   int getUndoMemorySize() const { return getIntValue(undoMemorySize); }
+  int getImageCacheSize() const { return getIntValue(imageCacheSize); }
   int getDefaultTaskChunkSize() const { return getIntValue(taskchunksize); }
   bool isReplaceAfterSaveLevelAsEnabled() const {
     return getBoolValue(replaceAfterSaveLevelAs);
@@ -288,7 +290,6 @@ public:
   QString getFfmpegPath() const { return getStringValue(ffmpegPath); }
   int getFfmpegTimeout() { return getIntValue(ffmpegTimeout); }
   QString getFastRenderPath() const { return getStringValue(fastRenderPath); }
-  bool getFfmpegMultiThread() const { return getBoolValue(ffmpegMultiThread); }
   QString getRhubarbPath() const { return getStringValue(rhubarbPath); }
   int getRhubarbTimeout() { return getIntValue(rhubarbTimeout); }
 
@@ -7,6 +7,7 @@ enum PreferencesItemId {
   rasterOptimizedMemory,
   startupPopupEnabled,
   undoMemorySize,
+  imageCacheSize,
   taskchunksize,
   sceneNumberingEnabled,
   watchFileSystemEnabled,
@@ -79,7 +80,6 @@ enum PreferencesItemId {
   ffmpegPath,
   ffmpegTimeout,
   fastRenderPath,
-  ffmpegMultiThread,
   rhubarbPath,
   rhubarbTimeout,
 
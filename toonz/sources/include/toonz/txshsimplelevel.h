@@ -204,6 +204,13 @@ table) it returns the proper insertion index
   TImageP getFullsampledFrame(const TFrameId &fid,
                               UCHAR imgManagerParamsMask) const;
 
+  //! Returns the specified region of the fullsampled frame, in image pixels.
+  //! Raster formats supporting it read just the required region from file.
+  //! Such partial images are never cached - however, if the whole image is
+  //! already cached, it is returned instead.
+  TImageP getFullsampledFrame(const TFrameId &fid, UCHAR imgManagerParamsMask,
+                              const TRect &region) const;
+
   TImageInfo *getFrameInfo(const TFrameId &fid, bool toBeModified);
   TImageP getFrameIcon(const TFrameId &fid) const;
 
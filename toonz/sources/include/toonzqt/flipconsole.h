@@ -264,6 +264,7 @@ public:
   void showCurrentFrame();
   int getCurrentFrame() const { return m_currentFrame; }
   int getCurrentFps() const { return m_fps; }
+  bool isPlayingBackward() const { return m_reverse; }
   void setChecked(UINT button, bool state);
   bool isChecked(UINT button) const;
   void setCurrentFrame(int frame, bool forceResetting = false);
@@ -0,0 +1,97 @@
+#pragma once
+
+#ifndef TPERSISTENTRENDERCACHE_H
+#define TPERSISTENTRENDERCACHE_H
+
+#include <memory>
+
+#include "tcommon.h"
+#include "tfilepath.h"
+
+#undef DVAPI
+#undef DVVAR
+#ifdef TFX_EXPORTS
+#define DVAPI DV_EXPORT_API
+#define DVVAR DV_EXPORT_VAR
+#else
+#define DVAPI DV_IMPORT_API
+#define DVVAR DV_IMPORT_VAR
+#endif
+
+//=======================================================================
+
+//  Forward declarations
+class TTile;
+class TRenderSettings;
+
+//=======================================================================
+
+//=====================================
+//    TPersistentRenderCache class
+//-------------------------------------
+
+/*!
+  TPersistentRenderCache stores fx render results on disk, so that they
+  survive the render process and can be reloaded by later sessions (or later
+  tcomposer runs) whenever the same fx subtree is rendered again with the
+  same settings.
+\n\n
+  Results are keyed by a hash of the fx alias - which already describes the
+  whole input subtree and the parameter values at the rendered frame - of the
+  render settings and of the tile geometry. Level columns contribute the
+  modification time of the files they read (see fileStamp()), so that
+  re-saved levels invalidate the results depending on them.
+\n\n
+  The cache is disabled until a root folder is specified. Only results whose
+  computation took at least getMinimumComputeTime() milliseconds are stored,
+  and the least recently accessed entries are purged whenever the folder
+  grows above the maximum size.
+*/
+class DVAPI TPersistentRenderCache {
+  class Imp;
+  std::unique_ptr<Imp> m_imp;
+
+public:
+  static TPersistentRenderCache *instance();
+
+  //! Sets the folder hosting the cache, enabling it. An empty path disables
+  //! the cache.
+  void setRoot(const TFilePath &root);
+  TFilePath getRoot() const;
+
+  bool isEnabled() const;
+
+  //! Sets the maximum size of the cache folder, in MB.
+  void setMaximumSize(int sizeMB);
+  int getMaximumSize() const;
+
+  void setMinimumComputeTime(int ms);
+  int getMinimumComputeTime() const;
+
+  //! Returns the dependency stamp of a file read by a level column. Files
+  //! with unsaved modifications return a stamp preventing persistence.
+  std::string fileStamp(const TFilePath &decodedPath, bool isDirty) const;
+
+  //! Returns the key of the specified fx result, or an empty string if the
+  //! result must not be persisted.
+  std::string getKey(const std::string &alias, const TRenderSettings &rs,
+                     const TTile &tile) const;
+
+  //! Loads the entry associated with key into the tile's raster. Returns
+  //! false if no compatible entry exists.
+  bool load(const std::string &key, TTile &tile);
+  void save(const std::string &key, const TTile &tile);
+
+  //! Removes all the entries from the cache folder.
+  void clear();
+
+private:
+  TPersistentRenderCache();
+  ~TPersistentRenderCache();
+
+  // Not copyable
+  TPersistentRenderCache(const TPersistentRenderCache &);
+  TPersistentRenderCache &operator=(const TPersistentRenderCache &);
+};
+
+#endif  // TPERSISTENTRENDERCACHE_H
@@ -0,0 +1,84 @@
+#pragma once
+
+#ifndef TRASTERARENA_H
+#define TRASTERARENA_H
+
+#include <memory>
+
+#include "tcommon.h"
+#include "traster.h"
+
+#undef DVAPI
+#undef DVVAR
+#ifdef TFX_EXPORTS
+#define DVAPI DV_EXPORT_API
+#define DVVAR DV_EXPORT_VAR
+#else
+#define DVAPI DV_IMPORT_API
+#define DVVAR DV_IMPORT_VAR
+#endif
+
+//=======================================================================
+
+//=====================================
+//    TRasterArena class
+//-------------------------------------
+
+/*!
+  TRasterArena recycles the rasters allocated by render processes - frame
+  rasters and fx tiles alike - so that steady-state rendering does not
+  allocate (and page-fault) large buffers on each frame.
+\n\n
+  Rasters are grouped in size classes, keyed by pixel type, width and height
+  rounded up to a fraction of its magnitude. Requested rasters are extracted
+  from the bottom rows of a raster of the matching class - so their wrap
+  always equals their width - and the class raster becomes available again
+  as soon as all the references to the extracted raster are released. No
+  explicit release is required.
+\n\n
+  Idle rasters are kept across renders, up to getMaximumIdleSize() MB (256
+  by default), and are all released when the image cache reports a memory
+  shortage. Small rasters are not worth recycling and are always allocated
+  directly.
+*/
+class DVAPI TRasterArena {
+  class Imp;
+  std::unique_ptr<Imp> m_imp;
+
+public:
+  struct Counters {
+    TINT64 m_allocationsCount;  //!< Class rasters allocated
+    TINT64 m_allocatedBytes;    //!< Bytes allocated by the above
+    TINT64 m_recyclesCount;     //!< Requests served by idle class rasters
+    TINT64 m_directCount;       //!< Requests too small to be recycled
+    TINT64 m_size;              //!< Bytes currently owned by the arena
+  };
+
+public:
+  static TRasterArena *instance();
+
+  //! Returns a cleared raster of the specified size and bpp (32, 64 or 128).
+  TRasterP getRaster(const TDimension &size, int bpp);
+
+  //! Sets the maximum size of the idle rasters kept by the arena, in MB.
+  void setMaximumIdleSize(int sizeMB);
+  int getMaximumIdleSize() const;
+
+  //! Releases the least recently used idle rasters in excess of the maximum
+  //! idle size.
+  void trim();
+  //! Releases all the idle rasters.
+  void clear();
+
+  Counters getCounters() const;
+
+private:
+  TRasterArena();
+  ~TRasterArena();
+
+  // Not copyable
+  TRasterArena(const TRasterArena &);
+  TRasterArena &operator=(const TRasterArena &);
+};
+
+#endif  // TRASTERARENA_H
@@ -280,6 +280,11 @@ public:
 
   void enableComputeInFloat(bool on);
   bool canComputeInFloat() const;
+
+  //! Declares that each output pixel depends only on the input pixels at the
+  //! same position. See getLocalityRadius().
+  void enablePointwiseCompute(bool on);
+  bool isPointwiseCompute() const;
   virtual bool toBeComputedInLinearColorSpace(bool settingsIsLinear,
                                               bool tileIsLinear) const {
     return false;
@@ -303,6 +308,16 @@ public:
 
   virtual bool allowUserCacheOnPort(int port) { return true; }
 
+  //! Declares the locality of doCompute(): fxs whose output pixels depend
+  //! only on input pixels at most the returned distance away (0 for pointwise
+  //! fxs) can be computed on separate horizontal bands of the output tile,
+  //! which the renderer distributes among idle cores. -1 means that the whole
+  //! tile must be computed at once: the default, unless the fx enabled
+  //! pointwise compute.
+  virtual int getLocalityRadius(double frame, const TRenderSettings &info) {
+    return isPointwiseCompute() ? 0 : -1;
+  }
+
   virtual bool isPlugin() const { return false; };
 
 private:
@@ -201,6 +201,7 @@ public:
   TEdge *popBackEdge();
 
   void moveSubregionsTo(TRegion *r);
+  void moveSubregionsTo(std::vector<TRegion *> &regions);
   // it returns the  style of the region before filling or -1 if not filled.
   int fill(const TPointD &p, int styleId);
 
@@ -13,11 +13,23 @@ public:
 
   TRectD m_bbox;
 
-  TRegionOutline() : m_doAntialiasing(false) {}
+  //! Triangles covering the outline, as consecutive vertex triplets. They are
+  //! built on demand by TTessellator::triangulate(), and must be invalidated
+  //! whenever the boundaries are edited.
+  PointVector m_triangles;
+  bool m_trianglesValid;
+
+  TRegionOutline() : m_doAntialiasing(false), m_trianglesValid(false) {}
 
   void clear() {
     m_exterior.clear();
     m_interior.clear();
+    invalidateTriangles();
+  }
+
+  void invalidateTriangles() {
+    m_triangles.clear();
+    m_trianglesValid = false;
   }
 };
 
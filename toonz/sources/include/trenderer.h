@@ -3,6 +3,8 @@
 #ifndef TRENDERER_INCLUDED
 #define TRENDERER_INCLUDED
 
+#include <functional>
+
 #include "trasterfx.h"
 
 #undef DVAPI
@@ -217,6 +219,9 @@ public:
 
   void setThreadsCount(int nThreads);
 
+  static void runSubtasks(const std::vector<std::function<void()>> &funcs);
+  static int idleThreadsCount();
+
   static TRenderer instance();
 
   unsigned long rendererId();
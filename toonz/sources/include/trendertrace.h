@@ -0,0 +1,108 @@
+#pragma once
+
+#ifndef TRENDERTRACE_H
+#define TRENDERTRACE_H
+
+#include <atomic>
+#include <memory>
+
+#include "tcommon.h"
+#include "tfilepath.h"
+
+#undef DVAPI
+#undef DVVAR
+#ifdef TFX_EXPORTS
+#define DVAPI DV_EXPORT_API
+#define DVVAR DV_EXPORT_VAR
+#else
+#define DVAPI DV_IMPORT_API
+#define DVVAR DV_IMPORT_VAR
+#endif
+
+//=======================================================================
+
+//=====================================
+//    TRenderTrace class
+//-------------------------------------
+
+/*!
+  TRenderTrace records the activity of render processes - frames, fx
+  computations, cache hits and misses, raster allocations - and writes it
+  in the Chrome trace-event JSON format, which can be inspected with
+  chrome://tracing or similar viewers.
+\n\n
+  Tracing is disabled by default. It can be started either explicitly
+  through start(), or by setting the TOONZ_RENDER_TRACE environment variable
+  to the output file path. When disabled, each tracing point costs a single
+  atomic load.
+*/
+class DVAPI TRenderTrace {
+  class Imp;
+  std::unique_ptr<Imp> m_imp;
+
+  std::atomic<bool> m_enabled;
+
+public:
+  //! Records a complete event spanning the lifetime of the scope object.
+  //! Arguments should be supplied only if isActive() returns true.
+  class DVAPI Scope {
+    std::string m_name, m_args;
+    const char *m_category;
+    TINT64 m_begin;
+    bool m_active;
+
+  public:
+    Scope(const char *category);
+    ~Scope();
+
+    bool isActive() const { return m_active; }
+
+    void setName(const std::string &name) { m_name = name; }
+    void addArg(const std::string &name, const std::string &value);
+    void addArg(const std::string &name, TINT64 value);
+
+  private:
+    // Not copyable
+    Scope(const Scope &);
+    Scope &operator=(const Scope &);
+  };
+
+public:
+  static TRenderTrace *instance();
+
+  bool isEnabled() const {
+    return m_enabled.load(std::memory_order_relaxed);
+  }
+
+  //! Starts recording events, which will be written to the specified file
+  //! by stop().
+  void start(const TFilePath &path);
+  //! Stops recording and writes the recorded events. Returns false if the
+  //! output file could not be written.
+  bool stop();
+
+  //! Returns the time elapsed since start(), in microseconds.
+  TINT64 now() const;
+
+  //! Returns a JSON member suitable for the events' args string. Multiple
+  //! members must be separated by commas.
+  static std::string arg(const std::string &name, const std::string &value);
+  static std::string arg(const std::string &name, TINT64 value);
+
+  void addCompleteEvent(const std::string &name, const char *category,
+                        TINT64 begin, TINT64 end,
+                        const std::string &args = std::string());
+  void addInstantEvent(const std::string &name, const char *category,
+                       const std::string &args = std::string());
+  void addCounterEvent(const std::string &name, TINT64 value);
+
+private:
+  TRenderTrace();
+  ~TRenderTrace();
+
+  // Not copyable
+  TRenderTrace(const TRenderTrace &);
+  TRenderTrace &operator=(const TRenderTrace &);
+};
+
+#endif  // TRENDERTRACE_H
@@ -3,6 +3,9 @@
 #include "trastercm.h"
 #include "texception.h"
 
+#include <vector>
+#include <functional>
+
 #undef DVAPI
 #undef DVVAR
 #ifdef TROP_EXPORTS
@@ -385,6 +388,21 @@ DVAPI void erodilate(const TRasterP &rin, const TRasterP &rout, double radius,
 DVAPI void swapRBChannels(const TRaster32P &r);
 #endif
 
+typedef void (*SubtasksRunner)(const std::vector<std::function<void()>> &);
+
+//! Calls the specified functions, possibly concurrently, and returns when all
+//! of them are done. Used by operations splitting their work in independent
+//! parts, like resample(). The functions are called in sequence unless a
+//! runner was installed through setSubtasksRunner().
+DVAPI void runSubtasks(const std::vector<std::function<void()>> &funcs);
+
+//! Installs the runner of runSubtasks() - typically by render processes,
+//! distributing the functions among their idle threads.
+DVAPI void setSubtasksRunner(SubtasksRunner runner);
+
+//! Returns the installed runner of runSubtasks(), or 0 if none.
+DVAPI SubtasksRunner getSubtasksRunner();
+
 ///////////////////////////////////////
 //  Utilities for Toonz 4.6 porting  //
 ///////////////////////////////////////
@@ -247,11 +247,22 @@ same that getThickPointAtLength but return a TPointD
     return convert(getThickPointAtLength(s));
   }
 
+  /*!
+Same as getThickPointAtLength(), for each of the passed lengths. Lengths
+sorted in increasing order are evaluated walking the stroke only once.
+*/
+  void getThickPointsAtLength(const std::vector<double> &lengths,
+                              std::vector<TThickPoint> &points) const;
+
   /*!
 Return parameter in (based on arc length)
 */
   double getParameterAtLength(double s) const;
 
+  //! Same as getParameterAtLength(), for each of the passed lengths.
+  void getParametersAtLength(const std::vector<double> &lengths,
+                             std::vector<double> &ws) const;
+
   /*!
 Return parameter for a control point
 \note if control point is not on curve return middle value between
@@ -223,9 +223,14 @@ enum CPUExtensions {
   CpuSupportsSse2 = 0x00000020L,
   // CpuSupports3DNow      = 0x00000040L,
   // CpuSupports3DNowExt   = 0x00000080L
+  CpuSupportsAvx2   = 0x00000100L,
+  CpuSupportsAvx512 = 0x00000200L  //!< AVX-512 Foundation
 };
 
-/*! returns a bit mask containing the CPU extensions supported */
+/*! returns a bit mask containing the CPU extensions supported - both by the
+    processor and by the OS. Extensions are detected once, at the first call.
+    The TOONZ_CPU_EXTENSIONS environment variable, if set, is a mask limiting
+    the reported extensions (eg 0x30 restricts kernels to SSE2). */
 DVAPI long getCPUExtensions();
 
 /*! enables/disables the CPU extensions, if available*/
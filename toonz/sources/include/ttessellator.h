@@ -34,6 +34,13 @@ public:
                           TRegionOutline &outline, TPixel32 color) = 0;
   virtual void tessellate(const TColorFunction *cf, const bool antiAliasing,
                           TRegionOutline &outline, TRaster32P texture) = 0;
+
+  /*!
+    Stores in outline.m_triangles the triangles filling the outline's exterior
+    minus its interior, unless they were already built. No OpenGL is
+    involved, so outlines can be triangulated in advance on any thread.
+  */
+  static void triangulate(TRegionOutline &outline);
 };
 
 //=============================================================================
@@ -42,33 +49,7 @@ public:
 //=============================================================================
 
 class DVAPI TglTessellator final : public TTessellator {
-public:
-  // TThread::Mutex m_mutex;
-
-  class DVAPI GLTess {
-  public:
-#ifdef GLU_VERSION_1_2
-    GLUtesselator *m_tess;
-#else
-#ifdef GLU_VERSION_1_1
-    GLUtriangulatorObj *m_tess;
-#else
-    void *m_tess;
-#endif
-#endif
-
-    GLTess();
-    ~GLTess();
-  };
-
-private:
-  // static GLTess m_glTess;
-
-  void doTessellate(GLTess &glTess, const TColorFunction *cf,
-                    const bool antiAliasing, TRegionOutline &outline);
-  void doTessellate(GLTess &glTess, const TColorFunction *cf,
-                    const bool antiAliasing, TRegionOutline outline,
-                    const TAffine &aff);
+  void drawTriangles(const TRegionOutline &outline, bool textured);
 
 public:
   // void tessellate(const TVectorRenderData &rd, TRegionOutline &outline );
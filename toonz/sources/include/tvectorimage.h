@@ -308,6 +308,11 @@ get the stroke nearest at point
    * render, should be disabled!
    */
   void enableMinimizeEdges(bool enabled);
+
+  /*! if enabled, changing some strokes recomputes only the regions around
+   * them; the others are kept, together with their fill. Enabled by default.
+   */
+  void enableLocalRegionComputing(bool enabled);
   /*! Creates a new Image using the selected strokes. If removeFlag==true then
      removes selected strokes
       It includes (in the new image) the color information too.
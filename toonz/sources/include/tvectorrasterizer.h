@@ -0,0 +1,54 @@
+#pragma once
+
+#ifndef TVECTORRASTERIZER_H
+#define TVECTORRASTERIZER_H
+
+// TnzCore includes
+#include "traster.h"
+
+#undef DVAPI
+#undef DVVAR
+
+#ifdef TVRENDER_EXPORTS
+#define DVAPI DV_EXPORT_API
+#define DVVAR DV_EXPORT_VAR
+#else
+#define DVAPI DV_IMPORT_API
+#define DVVAR DV_IMPORT_VAR
+#endif
+
+//=================================================
+
+//    Forward declarations
+
+class TVectorImage;
+class TVectorRenderData;
+
+//=================================================
+
+//*******************************************************************************
+//    Vector images software rasterization
+//*******************************************************************************
+
+/*!
+  \brief    Draws a vector image over the specified raster, using the CPU only.
+
+  \details  The image is drawn like tglDraw() would in a GL context bound to
+            the raster: \a rd's affine maps image coordinates to raster
+            pixels, strokes are filled through their outlines, and regions
+            through their boundaries - with coverage-based antialiasing.
+            No GL context is required, and the function can be invoked
+            concurrently on different rasters.
+
+  \warning  Only plain solid color styles are supported. Should the image
+            show any other style, the raster is left untouched and \p false
+            is returned - so that the image can be drawn through OpenGL
+            instead.
+
+  \return   Whether the image could be drawn.
+*/
+DVAPI bool rasterizeVectorImage(const TRaster32P &ras,
+                                const TVectorRenderData &rd,
+                                const TVectorImage *vim);
+
+#endif  // TVECTORRASTERIZER_H
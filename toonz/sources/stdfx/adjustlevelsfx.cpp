@@ -96,6 +96,7 @@ public:
     m_gamma_m->setValueRange(0.0, 200.0);
 
     enableComputeInFloat(true);
+    enablePointwiseCompute(true);
   }
 
   ~AdjustLevelsFx(){};
@@ -21,6 +21,7 @@ public:
     addInputPort("Source", m_input);
 
     enableComputeInFloat(true);
+    enablePointwiseCompute(true);
   }
 
   ~Bright_ContFx(){};
@@ -85,6 +85,7 @@ public:
     m_m_m->setValueRange(0, 1);
 
     enableComputeInFloat(true);
+    enablePointwiseCompute(true);
   }
   ~ChannelMixerFx(){};
 
@@ -18,6 +18,7 @@ public:
     m_gamma->setValueRange(0.0, 200.0);
 
     enableComputeInFloat(true);
+    enablePointwiseCompute(true);
   }
 
   ~GammaFx(){};
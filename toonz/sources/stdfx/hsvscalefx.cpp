@@ -41,6 +41,7 @@ public:
     m_satScale->setValueRange(0, (std::numeric_limits<double>::max)());
     m_valueScale->setValueRange(0, (std::numeric_limits<double>::max)());
     addInputPort("Source", m_input);
+    enablePointwiseCompute(true);
   }
 
   ~HSVScaleFx(){};
@@ -410,6 +410,7 @@ TBlendForeBackRasterFx::TBlendForeBackRasterFx(bool clipping_mask,
     bindParam(this, "alpha_rendering", this->m_alpha_rendering);
   }
   enableComputeInFloat(true);
+  enablePointwiseCompute(true);
 
   // version 1: Gamma had been diretory specified
   // version 2: Gamma is computed by rs.m_colorSpaceGamma + gammaAdjust
@@ -57,6 +57,7 @@ public:
     this->m_ref_mode->addItem(-1, "Nothing");
 
     enableComputeInFloat(true);
+    enablePointwiseCompute(true);
   }
   bool doGetBBox(double frame, TRectD &bBox,
                  const TRenderSettings &info) override {
@@ -20,6 +20,7 @@ public:
     bindParam(this, "green", this->m_green);
     bindParam(this, "blue", this->m_blue);
     bindParam(this, "alpha", this->m_alpha);
+    enablePointwiseCompute(true);
   }
   bool doGetBBox(double frame, TRectD &bBox,
                  const TRenderSettings &info) override {
@@ -23,6 +23,7 @@ public:
 
     ret = getParams()->getParam(0)->isKeyframe(0);
     addInputPort("Source", m_input);
+    enablePointwiseCompute(true);
   }
 
   ~MultiToneFx(){};
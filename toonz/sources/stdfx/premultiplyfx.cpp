@@ -13,6 +13,7 @@ public:
   PremultiplyFx() {
     addInputPort("Source", m_input);
     enableComputeInFloat(true);
+    enablePointwiseCompute(true);
   }
   ~PremultiplyFx(){};
 
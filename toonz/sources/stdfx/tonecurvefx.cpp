@@ -121,6 +121,7 @@ public:
     addInputPort("Source", m_input);
 
     enableComputeInFloat(true);
+    enablePointwiseCompute(true);
   }
 
   ~ToneCurveFx(){};
@@ -48,6 +48,8 @@
 #include "tunit.h"
 #include "tenv.h"
 #include "tpassivecachemanager.h"
+#include "tpersistentrendercache.h"
+#include "trendertrace.h"
 // #include "tcacheresourcepool.h"
 
 // TnzCore includes
@@ -610,9 +612,16 @@ int main(int argc, char *argv[]) {
   StringQualifier nthreads("-nthreads n", "Number of rendering threads");
   StringQualifier tileSize("-maxtilesize n",
                            "Enable tile rendering of max n MB per tile");
+  FilePathQualifier renderCache("-rendercache folderpath",
+                                "Persistent render cache folder");
+  IntQualifier renderCacheSize("-rendercachesize n",
+                               "Persistent render cache size, in MB");
+  FilePathQualifier traceFile("-trace file.json",
+                              "Write a Chrome trace of the render process");
   StringQualifier tmsg("-tmsg val", "only internal use");
   usageLine = srcName + dstName + range + stepOpt + shrinkOpt + multimedia +
-              farmData + idq + nthreads + tileSize + tmsg;
+              farmData + idq + nthreads + tileSize + renderCache +
+              renderCacheSize + traceFile + tmsg;
 
   // system path qualifiers
   std::map<QString, std::unique_ptr<TCli::QualifierT<TFilePath>>>
@@ -978,6 +987,23 @@ int main(int argc, char *argv[]) {
     // TPassiveCacheManager...
     TPassiveCacheManager::instance()->setEnabled(false);
 
+    // Results of unchanged fx subtrees can instead be retrieved from the
+    // persistent cache, if one was specified
+    if (renderCache.isSelected()) {
+      TPersistentRenderCache *persistentCache =
+          TPersistentRenderCache::instance();
+      if (renderCacheSize.isSelected())
+        persistentCache->setMaximumSize(renderCacheSize.getValue());
+
+      persistentCache->setRoot(renderCache.getValue());
+      if (persistentCache->isEnabled())
+        m_userLog->info("Render cache: " +
+                        renderCache.getValue().getQString().toStdString());
+      else
+        m_userLog->warning("Cannot use render cache folder " +
+                           renderCache.getValue().getQString().toStdString());
+    }
+
 #ifdef _WIN32
 #ifndef x64
     // On 32-bit architecture, there could be cases in which initialization
@@ -996,9 +1022,16 @@ int main(int argc, char *argv[]) {
 #endif
 #endif
 
+    if (traceFile.isSelected())
+      TRenderTrace::instance()->start(traceFile.getValue());
+
     framePair = generateMovie(scene, theDstFilePath, r0, r1, step, shrink,
                               threadCount, maxTileSize);
 
+    if (traceFile.isSelected() && !TRenderTrace::instance()->stop())
+      m_userLog->warning("Cannot write trace file " +
+                         traceFile.getValue().getQString().toStdString());
+
     Sw1.stop();
 
     m_userLog->info(
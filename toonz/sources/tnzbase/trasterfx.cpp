@@ -5,6 +5,7 @@
 // Core-system includes
 #include "tsystem.h"
 #include "tthreadmessage.h"
+#include "tconvert.h"
 
 // Fx basics
 #include "tparamcontainer.h"
@@ -19,8 +20,14 @@
 // Optimization components
 #include "trenderresourcemanager.h"
 #include "tfxcachemanager.h"
+#include "tpersistentrendercache.h"
+#include "trendertrace.h"
+#include "trasterarena.h"
 #include "trenderer.h"
 
+// Qt includes
+#include <QElapsedTimer>
+
 // Diagnostics
 // #define DIAGNOSTICS
 #ifdef DIAGNOSTICS
@@ -371,6 +378,8 @@ class FxResourceBuilder final : public ResourceBuilder {
   TRasterFxP m_rfx;
   double m_frame;
   const TRenderSettings *m_rs;
+  std::string m_alias;
+  const char *m_persistentAccess;  //!< "hit" or "miss", if looked up
 
   TTile *m_outTile;
   TTile *m_currTile;
@@ -385,10 +394,15 @@ public:
       , m_rfx(fx)
       , m_frame(frame)
       , m_rs(&rs)
+      , m_alias(resourceName)
+      , m_persistentAccess(0)
       , m_currTile(0) {}
 
   inline void build(TTile &tile);
 
+  //! Returns the outcome of the last persistent cache lookup, or 0.
+  const char *persistentAccess() const { return m_persistentAccess; }
+
 protected:
   void simCompute(const TRectD &rect) override {
     TRectD rectCpy(
@@ -397,6 +411,7 @@ protected:
   }
 
   void buildTileToCalculate(const TRectD &tileRect);
+  void computeInBands(int radius);
   void compute(const TRectD &tileRect) override;
 
   void upload(TCacheResourceP &resource) override;
@@ -438,7 +453,11 @@ void FxResourceBuilder::buildTileToCalculate(const TRectD &tileGeom) {
     ras = outRas->extract(rect);
     ras->clear();
   } else {
-    ras = outRas->create(requiredSize.lx, requiredSize.ly);
+    if ((TRaster32P)outRas || (TRaster64P)outRas || (TRasterFP)outRas)
+      ras = TRasterArena::instance()->getRaster(requiredSize,
+                                                outRas->getPixelSize() * 8);
+    else
+      ras = outRas->create(requiredSize.lx, requiredSize.ly);
     ras->setLinear(outRas->isLinear());
   }
 
@@ -449,6 +468,42 @@ void FxResourceBuilder::buildTileToCalculate(const TRectD &tileGeom) {
 
 //------------------------------------------------------------------------------
 
+//! Splits the tile to be calculated in horizontal bands, computed concurrently
+//! by the cores left idle by the render processes. Each band requests its own
+//! input tiles, so the bands must be tall enough (with respect to the locality
+//! radius) to keep the overlapping input areas negligible.
+void FxResourceBuilder::computeInBands(int radius) {
+  const int minBandHeight = 64;
+
+  TRasterP ras(m_currTile->getRaster());
+  int lx = ras->getLx(), ly = ras->getLy();
+
+  int bandsCount =
+      std::min(TRenderer::idleThreadsCount() + 1,
+               ly / std::max(minBandHeight, 8 * radius));
+  if (bandsCount < 2) {
+    m_rfx->doCompute(*m_currTile, m_frame, *m_rs);
+    return;
+  }
+
+  std::vector<std::function<void()>> bands;
+  bands.reserve(bandsCount);
+
+  for (int i = 0; i < bandsCount; ++i) {
+    int y0 = ly * i / bandsCount, y1 = ly * (i + 1) / bandsCount;
+    TPointD pos(m_currTile->m_pos + TPointD(0, y0));
+
+    bands.push_back([this, ras, lx, y0, y1, pos]() {
+      TTile band(ras->extract(0, y0, lx - 1, y1 - 1), pos);
+      m_rfx->doCompute(band, m_frame, *m_rs);
+    });
+  }
+
+  TRenderer::runSubtasks(bands);
+}
+
+//------------------------------------------------------------------------------
+
 void FxResourceBuilder::compute(const TRectD &tileRect) {
 #ifdef DIAGNOSTICS
   TStopWatch sw;
@@ -456,7 +511,40 @@ void FxResourceBuilder::compute(const TRectD &tileRect) {
 #endif
 
   buildTileToCalculate(tileRect);
-  m_rfx->doCompute(*m_currTile, m_frame, *m_rs);
+
+  // Reload the tile if a previous session stored it in the persistent cache.
+  // The computed tile is then uploaded to the resource as usual, and since
+  // the inputs won't be computed, their predicted references are depleted
+  // like for tiles downloaded from the resource.
+  TPersistentRenderCache *persistentCache = TPersistentRenderCache::instance();
+
+  std::string persistentKey;
+  if (persistentCache->isEnabled() && !m_rs->m_isSwatch)
+    persistentKey = persistentCache->getKey(m_alias, *m_rs, *m_currTile);
+
+  if (!persistentKey.empty()) {
+    bool hit           = persistentCache->load(persistentKey, *m_currTile);
+    m_persistentAccess = hit ? "hit" : "miss";
+    if (hit) {
+      simCompute(tileRect);
+      return;
+    }
+  }
+
+  QElapsedTimer computeTimer;
+  computeTimer.start();
+
+  int radius = m_rfx->getLocalityRadius(m_frame, *m_rs);
+  if (radius >= 0)
+    computeInBands(radius);
+  else
+    m_rfx->doCompute(*m_currTile, m_frame, *m_rs);
+
+  // Store only complete results which are expensive enough to be worth a
+  // disk access
+  if (!persistentKey.empty() && !(m_rs->m_isCanceled && *m_rs->m_isCanceled) &&
+      computeTimer.elapsed() >= persistentCache->getMinimumComputeTime())
+    persistentCache->save(persistentKey, *m_currTile);
 
 #ifdef DIAGNOSTICS
   sw.stop();
@@ -500,12 +588,14 @@ public:
 
   bool m_canComputeInFloat;
   bool m_canComputeInLinearColorSpace;
+  bool m_pointwiseCompute;
 
   TRasterFxImp()
       : m_cacheEnabled(false)
       , m_isEnabled(true)
       , m_cachedTile(0)
-      , m_canComputeInFloat(false) {}
+      , m_canComputeInFloat(false)
+      , m_pointwiseCompute(false) {}
 
   ~TRasterFxImp() {}
 
@@ -535,6 +625,9 @@ public:
 
   void enableComputeInFloat(bool on) { m_canComputeInFloat = on; }
   bool canComputeInFloat() { return m_canComputeInFloat; }
+
+  void enablePointwiseCompute(bool on) { m_pointwiseCompute = on; }
+  bool isPointwiseCompute() { return m_pointwiseCompute; }
 };
 
 //--------------------------------------------------
@@ -791,32 +884,38 @@ void TRasterFx::allocateAndCompute(TTile &tile, const TPointD &pos,
     bool isLinear = templateRas->isLinear();
     templateRas = 0;  // Release the reference to templateRas before allocation
 
-    TRasterP tileRas;
+    int bpp;
     if (ras32)
-      tileRas = TRaster32P(size.lx, size.ly);
+      bpp = 32;
     else if (ras64)
-      tileRas = TRaster64P(size.lx, size.ly);
+      bpp = 64;
     else if (rasF)
-      tileRas = TRasterFP(size.lx, size.ly);
+      bpp = 128;
     else {
       assert(false);
       return;
     }
+
+    TRasterP tileRas(TRasterArena::instance()->getRaster(size, bpp));
     tileRas->setLinear(isLinear);
     tile.setRaster(tileRas);
   } else {
-    if (info.m_bpp == 32) {
-      TRaster32P tileRas(size.lx, size.ly);
-      tile.setRaster(tileRas);
-    } else if (info.m_bpp == 64) {
-      TRaster64P tileRas(size.lx, size.ly);
-      tile.setRaster(tileRas);
-    } else if (info.m_bpp == 128) {
-      TRasterFP tileRas(size.lx, size.ly);
-      tile.setRaster(tileRas);
-    } else
-      assert(false);
-    tile.getRaster()->setLinear(info.m_linearColorSpace);
+    assert(info.m_bpp == 32 || info.m_bpp == 64 || info.m_bpp == 128);
+
+    TRasterP tileRas(TRasterArena::instance()->getRaster(size, info.m_bpp));
+    tileRas->setLinear(info.m_linearColorSpace);
+    tile.setRaster(tileRas);
+  }
+
+  TRenderTrace *trace = TRenderTrace::instance();
+  if (trace->isEnabled()) {
+    TRasterP ras(tile.getRaster());
+    trace->addInstantEvent(
+        "Allocate tile", "memory",
+        TRenderTrace::arg("lx", ras->getLx()) + "," +
+            TRenderTrace::arg("ly", ras->getLy()) + "," +
+            TRenderTrace::arg("bytes", TINT64(ras->getLx()) * ras->getLy() *
+                                           ras->getPixelSize()));
   }
 
   tile.m_pos = pos;
@@ -952,9 +1051,22 @@ void TRasterFx::compute(TTile &tile, double frame,
 #endif
 
   // Invoke the fx-specific computation process
+  TRenderTrace::Scope traceScope("fx");
+  if (traceScope.isActive()) {
+    TDimension size(interestingTile.getRaster()->getSize());
+    traceScope.setName(::to_string(getFxId()));
+    traceScope.addArg("type", getFxType());
+    traceScope.addArg("frame", QString::number(frame + 1).toStdString());
+    traceScope.addArg("lx", size.lx);
+    traceScope.addArg("ly", size.ly);
+  }
+
   FxResourceBuilder rBuilder(alias, this, info, frame);
   rBuilder.build(interestingTile);
 
+  if (traceScope.isActive() && rBuilder.persistentAccess())
+    traceScope.addArg("persistent", rBuilder.persistentAccess());
+
   // convert to linear
   if (isLinear != computeInLinear) {
     if (isLinear)  //  && !computeInLinear
@@ -1148,6 +1260,18 @@ void TRasterFx::enableComputeInFloat(bool on) {
   m_rasFxImp->enableComputeInFloat(on);
 }
 
+//--------------------------------------------------
+
+bool TRasterFx::isPointwiseCompute() const {
+  return m_rasFxImp->isPointwiseCompute();
+}
+
+//--------------------------------------------------
+
+void TRasterFx::enablePointwiseCompute(bool on) {
+  m_rasFxImp->enablePointwiseCompute(on);
+}
+
 //==============================================================================
 //
 // TRenderSettings
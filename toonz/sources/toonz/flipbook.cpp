@@ -48,6 +48,7 @@
 #include "toonz/tcamera.h"
 #include "toonz/preferences.h"
 #include "toonz/tproject.h"
+#include "toonz/imageprefetcher.h"
 
 // Image painting
 #include "toonz/imagepainter.h"
@@ -1684,6 +1685,16 @@ void FlipBook::onDrawFrame(int frame, const ImagePainter::VisualSettings &vs,
     m_imageViewer->setVisual(vs);
     m_imageViewer->setTimerAndTargetInstant(timer, targetInstant);
 
+    // During playback, load the frames that follow in background
+    if (timer && m_xl) {
+      int from, to, step, fps = m_flipConsole->getCurrentFps();
+      m_flipConsole->getFrameRange(from, to, step);
+      if (m_flipConsole->isPlayingBackward()) step = -step;
+
+      ImagePrefetcher::instance()->prefetch(m_xl, frame - 1, step,
+                                            std::abs(fps));
+    }
+
     TImageP img = getCurrentImage(frame);
 
     if (!img) return;
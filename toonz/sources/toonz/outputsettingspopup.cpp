@@ -23,7 +23,6 @@
 #include "toonz/toonzscene.h"
 #include "toonz/txsheet.h"
 #include "toonz/tstageobjecttree.h"
-#include "toonz/preferences.h"
 #include "toutputproperties.h"
 #include "toonz/tcamera.h"
 #include "toonz/boardsettings.h"
@@ -180,7 +179,6 @@ OutputSettingsPopup::OutputSettingsPopup(bool isPreview)
     , m_applyShrinkChk(nullptr)
     , m_outputCameraOm(nullptr)
     , m_isPreviewSettings(isPreview)
-    , m_allowMT(Preferences::instance()->getFfmpegMultiThread())
     , m_presetCombo(nullptr)
     , m_syncColorSettingsButton(nullptr) {
   setWindowTitle(isPreview ? tr("Preview Settings") : tr("Output Settings"));
@@ -950,11 +948,6 @@ void OutputSettingsPopup::updateField() {
     m_multimediaOm->setCurrentIndex(prop->getMultimediaRendering());
   }
 
-  // Refresh format if allow-multithread was toggled
-  if (m_allowMT != Preferences::instance()->getFfmpegMultiThread()) {
-    onFormatChanged(m_fileFormat->currentText());
-  }
-
   // camera
   if (m_outputCameraOm) {
     m_outputCameraOm->blockSignals(true);
@@ -1174,14 +1167,13 @@ void OutputSettingsPopup::onNameChanged() {
 /*! Set current scene output format to new format set in popup field.
  */
 void OutputSettingsPopup::onFormatChanged(const QString &str) {
-  auto isMultiRenderInvalid = [](std::string ext, bool allowMT) -> bool {
-    return (!allowMT && (ext == "mp4" || ext == "gif" || ext == "webm")) ||
-           ext == "spritesheet";
+  auto isMultiRenderInvalid = [](std::string ext) -> bool {
+    return ext == "spritesheet";
   };
 
   TOutputProperties *prop = getProperties();
   bool wasMultiRenderInvalid =
-      isMultiRenderInvalid(prop->getPath().getType(), m_allowMT);
+      isMultiRenderInvalid(prop->getPath().getType());
   // remove sepchar, ..
   TFilePath fp = prop->getPath().withNoFrame().withType(str.toStdString());
   // .. then add sepchar for sequencial image formats
@@ -1191,10 +1183,9 @@ void OutputSettingsPopup::onFormatChanged(const QString &str) {
     prop->setPath(fp);
     TApp::instance()->getCurrentScene()->setDirtyFlag(true);
   }
-  m_allowMT = Preferences::instance()->getFfmpegMultiThread();
 
   if (m_presetCombo) m_presetCombo->setCurrentIndex(0);
-  if (isMultiRenderInvalid(str.toStdString(), m_allowMT)) {
+  if (isMultiRenderInvalid(str.toStdString())) {
     m_threadsComboOm->setDisabled(true);
     m_threadsComboOm->setCurrentIndex(0);
   } else {
@@ -1203,6 +1203,7 @@ QString PreferencesPopup::getUIString(PreferencesItemId id) {
       {autosaveOtherFilesEnabled, tr("Automatically Save Non-Scene Files")},
       {startupPopupEnabled, tr("Show Startup Window when OpenToonz Starts")},
       {undoMemorySize, tr("Undo Memory Size (MB):")},
+      {imageCacheSize, tr("Image Cache Size (MB, 0 = Automatic):")},
       {taskchunksize, tr("Render Task Chunk Size:")},
       {replaceAfterSaveLevelAs,
        tr("Replace Toonz Level after SaveLevelAs command")},
@@ -1274,8 +1275,6 @@ QString PreferencesPopup::getUIString(PreferencesItemId id) {
       {ffmpegPath, tr("FFmpeg Path:")},
       {ffmpegTimeout, tr("FFmpeg Timeout:")},
       {fastRenderPath, tr("Fast Render Path:")},
-      {ffmpegMultiThread,
-       tr("Allow Multi-Thread in FFMPEG Rendering (UNSTABLE)")},
       {rhubarbPath, tr("Rhubarb Path:")},
       {rhubarbTimeout, tr("Rhubarb Timeout:")},
 
@@ -1629,6 +1628,7 @@ QWidget* PreferencesPopup::createGeneralPage() {
   insertUI(rasterOptimizedMemory, lay);
   insertUI(startupPopupEnabled, lay);
   insertUI(undoMemorySize, lay);
+  insertUI(imageCacheSize, lay);
   insertUI(taskchunksize, lay);
   insertUI(sceneNumberingEnabled, lay);
   insertUI(watchFileSystemEnabled, lay);
@@ -1935,13 +1935,6 @@ QWidget* PreferencesPopup::createImportExportPage() {
            lay);
   insertUI(fastRenderPath, lay);
 
-  putLabel("", lay);
-  putLabel(
-      tr("Enabling multi-thread rendering will render significantly faster \n"
-         "but a random crash might occur, use at your own risk."),
-      lay);
-  insertUI(ffmpegMultiThread, lay);
-
   lay->setRowStretch(lay->rowCount(), 1);
   insertFootNote(lay);
   widget->setLayout(lay);
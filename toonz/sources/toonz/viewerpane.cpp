@@ -28,6 +28,7 @@
 #include "toutputproperties.h"
 #include "toonz/preferences.h"
 #include "toonz/tproject.h"
+#include "toonz/imageprefetcher.h"
 
 // TnzQt includes
 #include "toonzqt/menubarcommand.h"
@@ -269,6 +270,21 @@ void BaseViewerPanel::onDrawFrame(int frame,
                            // to rewind
       m_flipConsole->setCurrentFrame(frame);
     }
+  } else if (frameHandle->isPlaying()) {
+    // Load the frames that playback is about to show in background
+    int from, to, step, fps = m_flipConsole->getCurrentFps();
+    m_flipConsole->getFrameRange(from, to, step);
+    if (m_flipConsole->isPlayingBackward()) step = -step;
+
+    ImagePrefetcher *prefetcher = ImagePrefetcher::instance();
+    if (frameHandle->isEditingLevel()) {
+      TXshLevel *level = app->getCurrentLevel()->getLevel();
+      if (level && level->getSimpleLevel())
+        prefetcher->prefetch(level->getSimpleLevel(), frame - 1, step,
+                             std::abs(fps));
+    } else
+      prefetcher->prefetch(app->getCurrentXsheet()->getXsheet(), frame - 1,
+                           step, std::abs(fps));
   }
 
   // assert(frame >= 0); // frame can be negative in rare cases
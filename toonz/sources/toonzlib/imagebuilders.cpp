@@ -131,6 +131,10 @@ TImageP ImageLoader::build(int imFlags, void *extData) {
     if (isTlvIcon)
       img = ir->loadIcon();  // TODO: Why just in the tlv case??
     else {
+      assert(data->m_region.isEmpty() ||
+             (imFlags & ImageManager::dontPutInCache));
+      if (!data->m_region.isEmpty()) ir->setRegion(data->m_region);
+
       ir->setShrink(subsampling);
       img = ir->load();
     }
@@ -43,6 +43,9 @@ public:
     //!< 'the currently stored one' if an image is already cached, or
     //!< m_sl's subsampling property otherwise)
     bool m_icon;  //!< Whether the icon (if any) should be loaded instead
+    TRect m_region;  //!< The image region to be loaded, in fullsampled pixels
+                     //!< (empty meaning the whole image). Partial images are
+                     //!< never cached.
     
     TPointD m_cameraDPI;  // for Rasterizer
 
@@ -53,6 +56,7 @@ public:
         , m_fid(fid)
         , m_subs(subs)
         , m_icon(icon)
+        , m_region()
         , m_cameraDPI(Stage::inch, Stage::inch) {}
   };
 
@@ -0,0 +1,323 @@
+
+
+// TnzLib includes
+#include "toonz/imagemanager.h"
+#include "toonz/txsheet.h"
+#include "toonz/txshcolumn.h"
+#include "toonz/txshcell.h"
+#include "toonz/txshsimplelevel.h"
+#include "toonz/txshchildlevel.h"
+
+// TnzBase includes
+#include "trendertrace.h"
+
+// Qt includes
+#include <QMutex>
+#include <QRunnable>
+#include <QThread>
+#include <QThreadPool>
+
+// STD includes
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <set>
+#include <vector>
+
+#include "toonz/imageprefetcher.h"
+
+//****************************************************************************
+//    Local namespace stuff
+//****************************************************************************
+
+namespace {
+
+// Sub-xsheets are not followed beyond this depth
+const int maxXsheetDepth = 8;
+
+//-----------------------------------------------------------------------
+
+struct Frame {
+  TXshSimpleLevelP m_level;
+  TFrameId m_fid;
+};
+
+//-----------------------------------------------------------------------
+
+void collectFrames(TXsheet *xsh, int row, std::vector<Frame> &frames,
+                   int depth = 0) {
+  if (row < 0) return;
+
+  int c, cCount = xsh->getColumnCount();
+  for (c = 0; c < cCount; ++c) {
+    TXshColumn *column = xsh->getColumn(c);
+    if (!column || column->isEmpty() || !column->isCamstandVisible()) continue;
+
+    const TXshCell &cell = xsh->getCell(row, c);
+    if (TXshSimpleLevel *sl = cell.getSimpleLevel()) {
+      Frame frame = {sl, cell.getFrameId()};
+      frames.push_back(frame);
+    } else if (TXshChildLevel *cl = cell.getChildLevel()) {
+      if (depth < maxXsheetDepth)
+        collectFrames(cl->getXsheet(), cell.getFrameId().getNumber() - 1,
+                      frames, depth + 1);
+    }
+  }
+}
+
+//-----------------------------------------------------------------------
+
+void collectFrames(TXshSimpleLevel *sl, int frameIndex,
+                   std::vector<Frame> &frames) {
+  if (frameIndex < 0 || frameIndex >= sl->getFrameCount()) return;
+
+  Frame frame = {sl, sl->index2fid(frameIndex)};
+  frames.push_back(frame);
+}
+
+}  // namespace
+
+//****************************************************************************
+//    ImagePrefetcher::Imp  definition
+//****************************************************************************
+
+class ImagePrefetcher::Imp {
+public:
+  class Task final : public QRunnable {
+    Imp *m_imp;
+    Frame m_frame;
+    int m_generation;
+
+  public:
+    Task(Imp *imp, const Frame &frame, int generation)
+        : m_imp(imp), m_frame(frame), m_generation(generation) {}
+
+    void run() override;
+  };
+
+public:
+  QThreadPool m_pool;
+  std::atomic<int> m_generation;  //!< Incremented by each notification
+
+  mutable QMutex m_mutex;
+  double m_lookAhead;
+  int m_maxFramesCount;
+  Counters m_counters;
+
+public:
+  Imp() : m_generation(0), m_lookAhead(1.0), m_maxFramesCount(24) {
+    m_counters.m_hitsCount = m_counters.m_missesCount = 0;
+    m_counters.m_requestsCount = m_counters.m_loadsCount = 0;
+
+    // Leave room to the GUI thread and to renders
+    m_pool.setMaxThreadCount(std::max(QThread::idealThreadCount() / 2, 1));
+  }
+
+  int framesCount(double fps) const;
+
+  void countShown(const std::vector<Frame> &frames);
+  void schedule(const std::vector<std::vector<Frame>> &frames);
+};
+
+//-----------------------------------------------------------------------
+
+void ImagePrefetcher::Imp::Task::run() {
+  if (m_generation != m_imp->m_generation) return;
+
+  const std::string &id = m_frame.m_level->getImageId(m_frame.m_fid);
+  if (ImageManager::instance()->isCached(id)) return;
+
+  try {
+    m_frame.m_level->getFrame(m_frame.m_fid, false);
+  } catch (...) {
+    // Failures will be reported when the frame is actually shown
+    return;
+  }
+
+  QMutexLocker locker(&m_imp->m_mutex);
+  ++m_imp->m_counters.m_loadsCount;
+}
+
+//-----------------------------------------------------------------------
+
+//! Returns the number of frames to be prefetched at the specified fps.
+int ImagePrefetcher::Imp::framesCount(double fps) const {
+  QMutexLocker locker(&m_mutex);
+
+  int count = (fps > 0) ? (int)std::ceil(fps * m_lookAhead) : m_maxFramesCount;
+  return std::max(std::min(count, m_maxFramesCount), 1);
+}
+
+//-----------------------------------------------------------------------
+
+void ImagePrefetcher::Imp::countShown(const std::vector<Frame> &frames) {
+  ImageManager *im = ImageManager::instance();
+
+  int hits = 0, misses = 0;
+  for (const Frame &frame : frames) {
+    const std::string &id = frame.m_level->getImageId(frame.m_fid);
+    if (!im->isBound(id)) continue;
+
+    if (im->isCached(id))
+      ++hits;
+    else
+      ++misses;
+  }
+
+  Counters counters;
+  {
+    QMutexLocker locker(&m_mutex);
+    m_counters.m_hitsCount += hits;
+    m_counters.m_missesCount += misses;
+    counters = m_counters;
+  }
+
+  // The hit rate since the last reset is traced along with the render
+  // counters - playbacks reset it when they start
+  TRenderTrace *trace = TRenderTrace::instance();
+  if (trace->isEnabled()) {
+    TINT64 shown = counters.m_hitsCount + counters.m_missesCount;
+    if (shown > 0)
+      trace->addCounterEvent("Prefetch hit rate (%)",
+                             100 * counters.m_hitsCount / shown);
+    trace->addCounterEvent("Prefetch loads", counters.m_loadsCount);
+  }
+}
+
+//-----------------------------------------------------------------------
+
+//! Replaces the pending requests with the specified frames, given in order
+//! of distance from the shown one.
+void ImagePrefetcher::Imp::schedule(
+    const std::vector<std::vector<Frame>> &frames) {
+  int generation = ++m_generation;
+  m_pool.clear();
+
+  ImageManager *im = ImageManager::instance();
+
+  std::set<std::string> scheduledIds;
+  int requests = 0, priority = (int)frames.size();
+
+  for (const std::vector<Frame> &rowFrames : frames) {
+    for (const Frame &frame : rowFrames) {
+      std::string id = frame.m_level->getImageId(frame.m_fid);
+      if (!scheduledIds.insert(id).second || !im->isBound(id) ||
+          im->isCached(id))
+        continue;
+
+      m_pool.start(new Task(this, frame, generation), priority);
+      ++requests;
+    }
+    --priority;
+  }
+
+  QMutexLocker locker(&m_mutex);
+  m_counters.m_requestsCount += requests;
+}
+
+//****************************************************************************
+//    ImagePrefetcher  implementation
+//****************************************************************************
+
+ImagePrefetcher::ImagePrefetcher() : m_imp(new Imp) {}
+
+//-----------------------------------------------------------------------
+
+ImagePrefetcher::~ImagePrefetcher() { cancel(); }
+
+//-----------------------------------------------------------------------
+
+ImagePrefetcher *ImagePrefetcher::instance() {
+  static ImagePrefetcher theInstance;
+  return &theInstance;
+}
+
+//-----------------------------------------------------------------------
+
+void ImagePrefetcher::prefetch(TXsheet *xsh, int row, int step, double fps) {
+  if (!xsh) return;
+  if (step == 0) step = 1;
+
+  std::vector<Frame> shownFrames;
+  collectFrames(xsh, row, shownFrames);
+  m_imp->countShown(shownFrames);
+
+  int r, count = m_imp->framesCount(fps);
+
+  std::vector<std::vector<Frame>> frames(count);
+  for (r = 0; r < count; ++r)
+    collectFrames(xsh, row + (r + 1) * step, frames[r]);
+
+  m_imp->schedule(frames);
+}
+
+//-----------------------------------------------------------------------
+
+void ImagePrefetcher::prefetch(TXshSimpleLevel *sl, int frameIndex, int step,
+                               double fps) {
+  if (!sl) return;
+  if (step == 0) step = 1;
+
+  std::vector<Frame> shownFrames;
+  collectFrames(sl, frameIndex, shownFrames);
+  m_imp->countShown(shownFrames);
+
+  int f, count = m_imp->framesCount(fps);
+
+  std::vector<std::vector<Frame>> frames(count);
+  for (f = 0; f < count; ++f)
+    collectFrames(sl, frameIndex + (f + 1) * step, frames[f]);
+
+  m_imp->schedule(frames);
+}
+
+//-----------------------------------------------------------------------
+
+void ImagePrefetcher::cancel() {
+  ++m_imp->m_generation;
+  m_imp->m_pool.clear();
+}
+
+//-----------------------------------------------------------------------
+
+void ImagePrefetcher::setLookAhead(double seconds) {
+  QMutexLocker locker(&m_imp->m_mutex);
+  m_imp->m_lookAhead = std::max(seconds, 0.0);
+}
+
+//-----------------------------------------------------------------------
+
+double ImagePrefetcher::getLookAhead() const {
+  QMutexLocker locker(&m_imp->m_mutex);
+  return m_imp->m_lookAhead;
+}
+
+//-----------------------------------------------------------------------
+
+void ImagePrefetcher::setMaximumFramesCount(int count) {
+  QMutexLocker locker(&m_imp->m_mutex);
+  m_imp->m_maxFramesCount = std::max(count, 1);
+}
+
+//-----------------------------------------------------------------------
+
+int ImagePrefetcher::getMaximumFramesCount() const {
+  QMutexLocker locker(&m_imp->m_mutex);
+  return m_imp->m_maxFramesCount;
+}
+
+//-----------------------------------------------------------------------
+
+ImagePrefetcher::Counters ImagePrefetcher::getCounters() const {
+  QMutexLocker locker(&m_imp->m_mutex);
+  return m_imp->m_counters;
+}
+
+//-----------------------------------------------------------------------
+
+void ImagePrefetcher::resetCounters() {
+  QMutexLocker locker(&m_imp->m_mutex);
+
+  m_imp->m_counters.m_hitsCount = m_imp->m_counters.m_missesCount = 0;
+  m_imp->m_counters.m_requestsCount = m_imp->m_counters.m_loadsCount = 0;
+}
@@ -29,7 +29,6 @@
 
 // Qt includes
 #include <QCoreApplication>
-#include <QTimer>
 
 #include "toonz/movierenderer.h"
 
@@ -138,8 +137,6 @@ public:
   bool m_cacheResults;
   bool m_preview;
   bool m_movieType;
-  bool m_seqRequired;
-  bool m_waitAfterFinish;
 
 public:
   Imp(ToonzScene *scene, const TFilePath &moviePath, int threadCount,
@@ -202,15 +199,13 @@ MovieRenderer::Imp::Imp(ToonzScene *scene, const TFilePath &moviePath,
     , m_failure(false)  //  AFTER the first completed raster gets processed
     , m_cacheResults(cacheResults)
     , m_preview(moviePath.isEmpty())
-    , m_movieType(isMovieType(moviePath))
-    , m_seqRequired(isSequencialRequired(moviePath)) {
+    , m_movieType(isMovieType(moviePath)) {
   m_renderCacheId =
       m_fp.withName(m_fp.getName() + "#RENDERID" +
                     QString::number(m_renderSessionId).toStdString())
           .getLevelName();
 
   m_renderer.addPort(this);
-  m_waitAfterFinish = m_movieType && !m_seqRequired && threadCount > 1;
 }
 
 //---------------------------------------------------------
@@ -534,8 +529,8 @@ void MovieRenderer::Imp::doRenderRasterCompleted(const RenderData &renderData) {
 
   QMutexLocker locker(&m_mutex);
 
-  bool allowMT    = Preferences::instance()->getFfmpegMultiThread();
-  bool requireSeq = allowMT ? m_seqRequired : m_movieType;
+  // Movie writers encode frames as they come: always save them in sequence
+  bool requireSeq = m_movieType;
 
   // Build soundtrack at the first time a frame is completed - and the filetype
   // is that of a movie.
@@ -750,8 +745,8 @@ void MovieRenderer::Imp::onRenderFailure(const RenderData &renderData,
                               // No sense making it later in this case!
   m_failure = true;
 
-  bool allowMT    = Preferences::instance()->getFfmpegMultiThread();
-  bool requireSeq = allowMT ? m_seqRequired : m_movieType;
+  // Movie writers encode frames as they come: always save them in sequence
+  bool requireSeq = m_movieType;
 
   // If the saver object has already been destroyed - or it was never
   // created to begin with, nothing to be done
@@ -805,15 +800,6 @@ void MovieRenderer::Imp::onRenderFinished(bool isCanceled) {
           ? m_fp
           : TFilePath(getPreviewName(m_renderSessionId).toStdWString()));
 
-  if (m_waitAfterFinish) {
-    // Wait half a second to add some stability before finalizing
-    QEventLoop eloop;
-    QTimer timer;
-    timer.connect(&timer, &QTimer::timeout, &eloop, &QEventLoop::quit);
-    timer.start(500);
-    eloop.exec();
-  }
-
   // Close updaters. After this, the output levels should be finalized on disk.
   m_levelUpdaterA.reset();
   m_levelUpdaterB.reset();
@@ -16,9 +16,14 @@
 #include "tsystem.h"
 #include "tconvert.h"
 #include "tundo.h"
+#include "timagecache.h"
 #include "tbigmemorymanager.h"
 #include "timage_io.h"
 
+// STD includes
+#include <algorithm>
+#include <climits>
+
 // Qt includes
 #include <QSettings>
 #include <QStringList>
@@ -267,6 +272,7 @@ Preferences::Preferences() {
   setUnits();
   setCameraUnits();
   setUndoMemorySize();
+  setImageCacheSize();
 
   // Load level formats
   getDefaultLevelFormats(m_levelFormats);
@@ -372,6 +378,7 @@ void Preferences::definePreferenceItems() {
          false);
   define(startupPopupEnabled, "startupPopupEnabled", QMetaType::Bool, true);
   define(undoMemorySize, "undoMemorySize", QMetaType::Int, 100, 0, 2000);
+  define(imageCacheSize, "imageCacheSize", QMetaType::Int, 0, 0, 1048576);
   define(taskchunksize, "taskchunksize", QMetaType::Int, 10, 1, 2000);
   define(sceneNumberingEnabled, "sceneNumberingEnabled", QMetaType::Bool,
          false);
@@ -383,6 +390,7 @@ void Preferences::definePreferenceItems() {
          (int)ProjectFolderOnly);
 
   setCallBack(undoMemorySize, &Preferences::setUndoMemorySize);
+  setCallBack(imageCacheSize, &Preferences::setImageCacheSize);
 
   // Interface
   define(CurrentStyleSheetName, "CurrentStyleSheetName", QMetaType::QString,
@@ -498,7 +506,6 @@ void Preferences::definePreferenceItems() {
   define(ffmpegTimeout, "ffmpegTimeout", QMetaType::Int, 600, 1,
          std::numeric_limits<int>::max());
   define(fastRenderPath, "fastRenderPath", QMetaType::QString, "desktop");
-  define(ffmpegMultiThread, "ffmpegMultiThread", QMetaType::Bool, false);
   define(rhubarbPath, "rhubarbPath", QMetaType::QString, "");
   define(rhubarbTimeout, "rhubarbTimeout", QMetaType::Int, 600, 0,
          std::numeric_limits<int>::max());
@@ -953,6 +960,17 @@ void Preferences::setUndoMemorySize() {
 
 //-----------------------------------------------------------------
 
+void Preferences::setImageCacheSize() {
+  // The cache compresses its images in background beyond this size; 0 picks
+  // the cache default
+  TINT64 high = (TINT64)getIntValue(imageCacheSize) << 10;  // KB
+  if (high == 0) high = TImageCache::getDefaultHighWatermark();
+  high = std::min<TINT64>(high, UINT_MAX);
+  TImageCache::instance()->setWatermarks((UINT)(high - high / 4), (UINT)high);
+}
+
+//-----------------------------------------------------------------
+
 void Preferences::setPixelsOnly() {
   bool pixelSelected = getBoolValue(pixelsOnly);
   if (pixelSelected)
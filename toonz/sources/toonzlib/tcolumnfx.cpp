@@ -15,6 +15,7 @@
 #include "tropcm.h"
 #include "tofflinegl.h"
 #include "tvectorrenderdata.h"
+#include "tvectorrasterizer.h"
 
 // TnzBase includes
 #include "ttzpimagefx.h"
@@ -22,6 +23,7 @@
 #include "tzeraryfx.h"
 #include "trenderer.h"
 #include "tfxcachemanager.h"
+#include "tpersistentrendercache.h"
 
 // TnzLib includes
 #include "toonz/toonzscene.h"
@@ -736,6 +738,7 @@ class LevelFxBuilder final : public ResourceBuilder {
   // bool m_64bit;
 
   TRect m_rasBounds;
+  TPoint m_loadedPos;  //!< Position of m_loadedRas in the image
 
 public:
   LevelFxBuilder(const std::string &resourceName, double frame,
@@ -757,8 +760,13 @@ public:
     // if (m_linear)
     //   flag = flag | ImageManager::isLinearEnabled;
 
-    // Load the image
-    TImageP img(m_sl->getFullsampledFrame(m_fid, flag));
+    // Load the image. Fullcolor levels may be required just a part of it.
+    TRect region(tround(tileRect.x0), tround(tileRect.y0),
+                 tround(tileRect.x1) - 1, tround(tileRect.y1) - 1);
+
+    TImageP img(m_sl->getType() == OVL_XSHLEVEL
+                    ? m_sl->getFullsampledFrame(m_fid, flag, region)
+                    : m_sl->getFullsampledFrame(m_fid, flag));
 
     if (!img) return;
 
@@ -772,28 +780,47 @@ public:
 
     if (timg) m_palette = timg->getPalette();
 
-    assert(tileRect ==
-           TRectD(0, 0, m_loadedRas->getLx(), m_loadedRas->getLy()));
+    // Readers not supporting regions, or an already cached image, return the
+    // whole image
+    if (m_loadedRas->getSize() != region.getSize()) {
+      TRect extractRect(region);
+      m_loadedRas = m_loadedRas->extract(extractRect);
+    }
+
+    m_loadedPos = region.getP00();
+
+    assert(m_loadedRas->getSize() == region.getSize());
   }
 
   void simCompute(const TRectD &rect) override {}
 
   void upload(TCacheResourceP &resource) override {
     assert(m_loadedRas);
-    resource->upload(TPoint(), m_loadedRas);
+    resource->upload(m_loadedPos, m_loadedRas);
     if (m_palette) resource->uploadPalette(m_palette);
   }
 
   bool download(TCacheResourceP &resource) override {
-    // If the image has been loaded in this builder, just use it
-    if (m_loadedRas) return true;
+    // If the image has been loaded in this builder, just use it - the loaded
+    // region may include the ones declared by other tiles, though
+    if (m_loadedRas) {
+      TRect loadedRect(m_loadedRas->getBounds() + m_loadedPos);
+      if (loadedRect != m_rasBounds && loadedRect.contains(m_rasBounds)) {
+        TRect extractRect(m_rasBounds - m_loadedPos);
+        m_loadedRas = m_loadedRas->extract(extractRect);
+        m_loadedPos = m_rasBounds.getP00();
+      }
+
+      return true;
+    }
 
     // If the image has yet to be loaded by this builder, skip without
     // allocating anything
     if (resource->canDownloadAll(m_rasBounds)) {
       m_loadedRas = resource->buildCompatibleRaster(m_rasBounds.getSize());
+      m_loadedPos = m_rasBounds.getP00();
       resource->downloadPalette(m_palette);
-      return resource->downloadAll(TPoint(), m_loadedRas);
+      return resource->downloadAll(m_loadedPos, m_loadedRas);
     } else
       return false;
   }
@@ -811,6 +838,68 @@ public:
   }
 };
 
+//-------------------------------------------------------------------
+
+//! Returns whether the level image can be loaded just in the part required to
+//! render \a rect, and that part in \a region - which is empty if the image
+//! is not required at all.
+static bool getLoadingRegion(TXshSimpleLevel *sl, const TImageInfo &imageInfo,
+                             const TRectD &rect, const TRenderSettings &info,
+                             TRect &region) {
+  // Colormap images and the fullcolor filters below need the whole image
+  if (sl->getType() != OVL_XSHLEVEL || !info.m_affine.isTranslation() ||
+      sl->getProperties()->antialiasSoftness() > 0 ||
+      TXshSimpleLevel::m_fillFullColorRaster)
+    return false;
+
+  // Place the rect in the image's reference
+  TRectD regionD(rect + TPointD(0.5 * imageInfo.m_lx - info.m_affine.a13,
+                                0.5 * imageInfo.m_ly - info.m_affine.a23));
+  regionD *= TRectD(0, 0, imageInfo.m_lx, imageInfo.m_ly);
+
+  if (regionD.x0 >= regionD.x1 || regionD.y0 >= regionD.y1) {
+    region = TRect();
+    return true;
+  }
+
+  region = TRect(tfloor(regionD.x0), tfloor(regionD.y0),
+                 tceil(regionD.x1) - 1, tceil(regionD.y1) - 1);
+
+  // Whole images are loaded as usual
+  return region != TRect(0, 0, imageInfo.m_lx - 1, imageInfo.m_ly - 1);
+}
+
+//-------------------------------------------------------------------
+
+//! Draws the vector image in the tile with the CPU rasterizer, provided that
+//! it supports the image's styles.
+static bool rasterizeVector(TTile &tile, const TVectorImage *vi,
+                            const TVectorRenderData &rd, double frame) {
+  TRasterP tileRas(tile.getRaster());
+
+  TRaster32P ras32(tileRas);
+  if (!ras32) ras32 = TRaster32P(tileRas->getSize());
+
+  ras32->clear();
+
+  // Animated palettes must be locked against concurrent TPalette::setFrame()
+  TPalette *palette = vi->getPalette();
+  bool isAnimated   = palette->isAnimated();
+  if (isAnimated) palette->mutex()->lock();
+
+  int oldFrame = palette->getFrame();
+  palette->setFrame((int)frame);
+  bool done = rasterizeVectorImage(ras32, rd, vi);
+  palette->setFrame(oldFrame);
+
+  if (isAnimated) palette->mutex()->unlock();
+
+  if (done && ras32.getPointer() != tileRas.getPointer())
+    TRop::copy(tileRas, ras32);
+
+  return done;
+}
+
 //****************************************************************************************
 //    TLevelColumnFx  implementation
 //****************************************************************************************
@@ -955,14 +1044,25 @@ void TLevelColumnFx::doDryCompute(TRectD &rect, double frame,
 
   TImageInfo imageInfo;
   getImageInfo(imageInfo, sl, cell.m_frameId);
-  TRectD imgRect(0, 0, imageInfo.m_lx, imageInfo.m_ly);
+  TRect loadRect(0, 0, imageInfo.m_lx - 1, imageInfo.m_ly - 1);
+
+  // Fullcolor images may be loaded just in the part needed by rect. The
+  // regions declared by all the tiles are merged in a single resource.
+  TRect region;
+  if (getLoadingRegion(sl, imageInfo, rect, info, region)) {
+    if (region.isEmpty()) return;
+    loadRect = region;
+  }
+
+  TRectD loadRectD(loadRect.x0, loadRect.y0, loadRect.x1 + 1,
+                   loadRect.y1 + 1);
 
   if (renderStatus == TRenderer::FIRSTRUN) {
-    ResourceBuilder::declareResource(alias, 0, imgRect, frame, info, false);
+    ResourceBuilder::declareResource(alias, 0, loadRectD, frame, info, false);
   } else {
     LevelFxBuilder builder(alias, frame, info, sl, cell.m_frameId);
-    builder.setRasBounds(TRect(0, 0, imageInfo.m_lx - 1, imageInfo.m_ly - 1));
-    builder.simBuild(imgRect);
+    builder.setRasBounds(loadRect);
+    builder.simBuild(loadRectD);
   }
 }
 
@@ -1000,6 +1100,16 @@ void TLevelColumnFx::doCompute(TTile &tile, double frame,
   TImageP img;
   TImageInfo imageInfo;
 
+  // Extract the required geometry
+  TRect tileBounds(tile.getRaster()->getBounds());
+  TRectD tileRectD = TRectD(tileBounds.x0, tileBounds.y0, tileBounds.x1 + 1,
+                            tileBounds.y1 + 1) +
+                     tile.m_pos;
+
+  // The loaded image's region, if just a part of the image is loaded
+  TRect region;
+  bool loadRegion = false;
+
   // Now, fetch the image
   if (sl->getType() != PLI_XSHLEVEL) {
     // Raster case
@@ -1007,10 +1117,17 @@ void TLevelColumnFx::doCompute(TTile &tile, double frame,
                            info, sl, fid);
 
     getImageInfo(imageInfo, sl, fid);
-    TRectD imgRect(0, 0, imageInfo.m_lx, imageInfo.m_ly);
+    TRect loadRect(0, 0, imageInfo.m_lx - 1, imageInfo.m_ly - 1);
 
-    builder.setRasBounds(TRect(0, 0, imageInfo.m_lx - 1, imageInfo.m_ly - 1));
-    builder.build(imgRect);
+    loadRegion = getLoadingRegion(sl, imageInfo, tileRectD, info, region);
+    if (loadRegion) {
+      if (region.isEmpty()) return;
+      loadRect = region;
+    }
+
+    builder.setRasBounds(loadRect);
+    builder.build(TRectD(loadRect.x0, loadRect.y0, loadRect.x1 + 1,
+                         loadRect.y1 + 1));
 
     img = builder.getImage();
   } else {
@@ -1022,12 +1139,6 @@ void TLevelColumnFx::doCompute(TTile &tile, double frame,
     }
   }
 
-  // Extract the required geometry
-  TRect tileBounds(tile.getRaster()->getBounds());
-  TRectD tileRectD = TRectD(tileBounds.x0, tileBounds.y0, tileBounds.x1 + 1,
-                            tileBounds.y1 + 1) +
-                     tile.m_pos;
-
   // To be sure, if there is no image, return.
   if (!img) return;
 
@@ -1041,7 +1152,6 @@ void TLevelColumnFx::doCompute(TTile &tile, double frame,
       // Deal separately
       applyTzpFxsOnVector(vectorImage, tile, frame, info);
     } else {
-      QMutexLocker m(&m_mutex);
       bBox = info.m_affine * vectorImage->getBBox();
       TDimension size(tile.getRaster()->getSize());
 
@@ -1053,7 +1163,6 @@ void TLevelColumnFx::doCompute(TTile &tile, double frame,
       TPalette *vpalette = vectorImage->getPalette();
       assert(vpalette);
       m_isCachable = !vpalette->isAnimated();
-      int oldFrame = vpalette->getFrame();
 
       TVectorRenderData rd(TVectorRenderData::ProductionSettings(), aff,
                            TRect(size), vpalette);
@@ -1062,6 +1171,13 @@ void TLevelColumnFx::doCompute(TTile &tile, double frame,
       if (info.m_quality == TRenderSettings::ClosestPixel_FilterResampleQuality)
         rd.m_antiAliasing = false;
 
+      // Plain colored images are rasterized on the CPU, directly in the tile -
+      // render threads do not need to share the column's GL context then
+      if (rasterizeVector(tile, vectorImage.getPointer(), rd, frame)) return;
+
+      QMutexLocker m(&m_mutex);
+      int oldFrame = vpalette->getFrame();
+
       if (!m_offlineContext || m_offlineContext->getLx() < size.lx ||
           m_offlineContext->getLy() < size.ly) {
         if (m_offlineContext) delete m_offlineContext;
@@ -1203,8 +1319,11 @@ void TLevelColumnFx::doCompute(TTile &tile, double frame,
     }
 
     if (ras) {
-      double lx_2 = ras->getLx() / 2.0;
-      double ly_2 = ras->getLy() / 2.0;
+      // Partially loaded images are placed at the region's origin
+      TPoint rasPos = loadRegion ? region.getP00() : TPoint();
+
+      double lx_2 = (loadRegion ? imageInfo.m_lx : ras->getLx()) / 2.0;
+      double ly_2 = (loadRegion ? imageInfo.m_ly : ras->getLy()) / 2.0;
 
       TRenderSettings infoAux(info);
       assert(info.m_affine.isTranslation());
@@ -1220,7 +1339,7 @@ void TLevelColumnFx::doCompute(TTile &tile, double frame,
         inTileRectD =
             TRectD(saveBox.x0, saveBox.y0, saveBox.x1 + 1, saveBox.y1 + 1);
       } else {
-        TRect rasBounds(ras->getBounds());
+        TRect rasBounds(ras->getBounds() + rasPos);
         inTileRectD = TRectD(rasBounds.x0, rasBounds.y0, rasBounds.x1 + 1,
                              rasBounds.y1 + 1);
       }
@@ -1235,6 +1354,7 @@ void TLevelColumnFx::doCompute(TTile &tile, double frame,
       // Output that intersection in the requested tile
       TRect inTileRect(tround(inTileRectD.x0), tround(inTileRectD.y0),
                        tround(inTileRectD.x1) - 1, tround(inTileRectD.y1) - 1);
+      inTileRect -= rasPos;
       TTile inTile(ras->extract(inTileRect),
                    inTileRectD.getP00() + TPointD(-lx_2, -ly_2));
 
@@ -1560,6 +1680,17 @@ std::string TLevelColumnFx::getAlias(double frame,
       rdata += "column_0";
   }
 
+  // Results stored on disk must be invalidated by any change to the level
+  // files, including those made by other applications
+  TPersistentRenderCache *persistentCache = TPersistentRenderCache::instance();
+  if (persistentCache->isEnabled()) {
+    TPalette *palette = sl->getPalette();
+    bool isDirty = sl->getDirtyFlag() || (palette && palette->getDirtyFlag());
+
+    rdata += persistentCache->fileStamp(sl->getScene()->decodeFilePath(fp),
+                                        isDirty);
+  }
+
   return getFxType() + "[" + ::to_string(fp.getWideString()) + "," + rdata +
          "]";
 }
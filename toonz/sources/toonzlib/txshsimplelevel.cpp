@@ -698,6 +698,28 @@ TImageP TXshSimpleLevel::getFullsampledFrame(const TFrameId &fid,
 
 //-----------------------------------------------------------------------------
 
+TImageP TXshSimpleLevel::getFullsampledFrame(const TFrameId &fid,
+                                             UCHAR imFlags,
+                                             const TRect &region) const {
+  assert(m_type != UNKNOWN_XSHLEVEL);
+  assert(!(imFlags & ImageManager::toBeModified));
+
+  if (region.isEmpty()) return getFullsampledFrame(fid, imFlags);
+
+  FramesSet::const_iterator it = m_frames.find(fid);
+  if (it == m_frames.end()) return TRasterImageP();
+
+  std::string imageId = getImageId(fid);
+
+  ImageLoader::BuildExtData extData(this, fid, 1);
+  extData.m_region = region;
+
+  return ImageManager::instance()->getImage(
+      imageId, imFlags | ImageManager::dontPutInCache, &extData);
+}
+
+//-----------------------------------------------------------------------------
+
 std::string TXshSimpleLevel::getIconId(const TFrameId &fid,
                                        int frameStatus) const {
   return "icon:" + getImageId(fid, frameStatus);
@@ -14,6 +14,7 @@
 #include "toonz/preferences.h"
 #include "toonz/tframehandle.h"
 #include "toonz/toonzfolders.h"
+#include "toonz/imageprefetcher.h"
 
 // TnzBase includes
 #include "tenv.h"
@@ -1626,7 +1627,11 @@ void FlipConsole::doButtonPressed(UINT button) {
     if (m_fpsField) m_fpsField->setLineEditBackgroundColor(Qt::red);
 
     m_playbackExecutor.resetFps(m_fps);
-    if (!m_playbackExecutor.isRunning()) m_playbackExecutor.start();
+    if (!m_playbackExecutor.isRunning()) {
+      // Prefetch hit rates are counted per playback
+      ImagePrefetcher::instance()->resetCounters();
+      m_playbackExecutor.start();
+    }
     m_isLinkedPlaying = linked;
 
     m_reverse = (m_fps < 0);